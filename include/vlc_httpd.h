@@ -116,6 +116,14 @@ VLC_API void httpd_UrlDelete( httpd_url_t * );
 
 VLC_API char* httpd_ClientIP( const httpd_client_t *cl, char *, int * );
 VLC_API char* httpd_ServerIP( const httpd_client_t *cl, char *, int * );
+/**
+ * Keeps the answer of an URL callback open after its current body.
+ *
+ * The callback is then polled again, with the body offset it left in the
+ * answer, until it sets that offset to zero. This allows answering requests
+ * for data that is not available yet without blocking the server.
+ */
+VLC_API void httpd_ClientModeStream( httpd_client_t *cl );
 
 /* High level */
 
@@ -42,6 +42,23 @@ extern "C" {
  * Stream output modules interface
  */
 
+/** Number of buckets of the stream output duration histograms */
+#define SOUT_STATS_BUCKETS 20
+
+/**
+ * Distribution of durations measured in a stream output
+ *
+ * The first bucket counts the durations below 2 us, bucket i those between
+ * 2^i and 2^(i+1) us, and the last one all the longer durations.
+ */
+struct sout_stats_histogram
+{
+    uint64_t   count; /**< durations measured */
+    vlc_tick_t total; /**< sum of the durations */
+    vlc_tick_t max;   /**< longest duration */
+    uint64_t   buckets[SOUT_STATS_BUCKETS];
+};
+
 /**
  * \defgroup sout_access Access output
  * Raw output byte streams
@@ -70,6 +87,29 @@ enum access_out_query_e
 {
     ACCESS_OUT_CONTROLS_PACE, /* arg1=bool *, can fail (assume true) */
     ACCESS_OUT_CAN_SEEK, /* arg1=bool *, can fail (assume false) */
+    ACCESS_OUT_GET_DATAGRAM_STATS, /* arg1=struct sout_datagram_stats *,
+                                      can fail */
+};
+
+/** Counters of a datagram access output, since it was opened */
+struct sout_datagram_stats
+{
+    uint64_t datagrams; /**< datagrams sent */
+    uint64_t syscalls;  /**< system calls sending datagrams */
+    uint64_t late;      /**< datagrams sent after their date */
+    uint64_t dropped;   /**< datagrams not sent */
+};
+
+/** Counters of an access output, since it was created, with
+ * sout-stats-interval set */
+struct sout_access_out_stats
+{
+    uint64_t blocks; /**< blocks written */
+    uint64_t bytes;  /**< bytes written */
+    struct sout_stats_histogram time;    /**< time spent writing a block */
+    struct sout_stats_histogram latency; /**< time since the stream output
+                                              input reached the timestamp of
+                                              a written block */
 };
 
 VLC_API sout_access_out_t * sout_AccessOutNew( vlc_object_t *, const char *psz_access, const char *psz_name ) VLC_USED;
@@ -80,6 +120,8 @@ VLC_API int sout_AccessOutSeek( sout_access_out_t *, off_t );
 VLC_API ssize_t sout_AccessOutRead( sout_access_out_t *, block_t * );
 VLC_API ssize_t sout_AccessOutWrite( sout_access_out_t *, block_t * );
 VLC_API int sout_AccessOutControl( sout_access_out_t *, int, ... );
+VLC_API void sout_AccessOutGetStats( sout_access_out_t *,
+                                     struct sout_access_out_stats * );
 
 static inline bool sout_AccessOutCanControlPace( sout_access_out_t *p_ao )
 {
@@ -134,6 +176,36 @@ enum sout_mux_query_e
     MUX_CAN_ADD_STREAM_WHILE_MUXING,    /* arg1= bool *,      res=cannot fail */
     /* properties */
     MUX_GET_MIME,                       /* arg1= char **            res=can fail    */
+    /* statistics */
+    MUX_GET_CBR_STATS,  /* arg1= struct sout_mux_cbr_stats *, res=can fail */
+};
+
+/** Counters of a constant bitrate multiplexer, since it was opened */
+struct sout_mux_cbr_stats
+{
+    uint64_t   packets;          /**< packets sent, stuffing included */
+    uint64_t   null_packets;     /**< null packets sent */
+    uint64_t   pcr_packets;      /**< packets sent only to carry a PCR */
+    uint64_t   overflows;        /**< slices exceeding the mux rate */
+    vlc_tick_t pcr_interval_max; /**< longest interval between two PCRs */
+    vlc_tick_t delay_max;        /**< longest delay of a packet behind its
+                                      schedule */
+    unsigned   pcr_accuracy_max; /**< largest PCR rounding error (ns) */
+};
+
+/** Counters of a multiplexer, since it was created
+ *
+ * Like the other stream output counters, they stay zero unless
+ * sout-stats-interval is set. */
+struct sout_mux_stats
+{
+    uint64_t blocks;      /**< blocks queued in the input FIFOs */
+    uint64_t bytes;       /**< bytes queued in the input FIFOs */
+    size_t   depth;       /**< blocks left in the input FIFOs after muxing */
+    size_t   depth_bytes; /**< bytes left in the input FIFOs after muxing */
+    size_t   depth_max;   /**< most blocks left in the input FIFOs */
+    struct sout_stats_histogram time; /**< time spent muxing, writing to
+                                           the access output included */
 };
 
 struct sout_input_t
@@ -152,6 +224,7 @@ VLC_API void sout_MuxDelete( sout_mux_t * );
 VLC_API int sout_MuxSendBuffer( sout_mux_t *, sout_input_t  *, block_t * );
 VLC_API int sout_MuxGetStream(sout_mux_t *, unsigned, vlc_tick_t *);
 VLC_API void sout_MuxFlush( sout_mux_t *, sout_input_t * );
+VLC_API void sout_MuxGetStats( sout_mux_t *, struct sout_mux_stats * );
 
 static inline int sout_MuxControl( sout_mux_t *p_mux, int i_query, ... )
 {
@@ -170,6 +243,31 @@ enum sout_stream_query_e {
     SOUT_STREAM_WANTS_SUBSTREAMS,  /* arg1=bool *, res=can fail (assume false) */
     SOUT_STREAM_ID_SPU_HIGHLIGHT,  /* arg1=void *, arg2=const vlc_spu_highlight_t *, res=can fail */
     SOUT_STREAM_IS_SYNCHRONOUS, /* arg1=bool *, can fail (assume false) */
+    SOUT_STREAM_GET_BRANCH_STATS, /* arg1=unsigned, arg2=struct
+                                     sout_stream_branch_stats *, can fail */
+};
+
+/** Counters of a branch of a fan-out stream output, since it was opened */
+struct sout_stream_branch_stats
+{
+    uint64_t blocks;  /**< blocks sent */
+    uint64_t bytes;   /**< bytes sent */
+    uint64_t copies;  /**< blocks sent as a copy of their data */
+    uint64_t dropped; /**< blocks not sent */
+};
+
+/** Counters of a stream output module, since it was created, with
+ * sout-stats-interval set */
+struct sout_stream_stats
+{
+    uint64_t blocks_in;  /**< blocks sent to the stream */
+    uint64_t bytes_in;   /**< bytes sent to the stream */
+    uint64_t blocks_out; /**< blocks the stream sent to the next ones */
+    uint64_t bytes_out;  /**< bytes the stream sent to the next ones */
+    uint64_t errors;     /**< blocks the stream failed to send */
+    struct sout_stats_histogram time; /**< time spent sending a block, less
+                                           the time spent in the next
+                                           streams */
 };
 
 struct sout_stream_operations {
@@ -201,6 +299,10 @@ VLC_API void sout_StreamIdDel(sout_stream_t *s, void *id);
 VLC_API int sout_StreamIdSend( sout_stream_t *s, void *id, block_t *b);
 VLC_API void sout_StreamFlush(sout_stream_t *s, void *id);
 VLC_API int sout_StreamControlVa(sout_stream_t *s, int i_query, va_list args);
+VLC_API int sout_StreamGetStats(sout_stream_t *s,
+                                struct sout_stream_stats *stats);
+VLC_API char *sout_StreamChainGetStats(sout_stream_t *first,
+                                       sout_stream_t *end) VLC_USED;
 
 static inline int sout_StreamControl( sout_stream_t *s, int i_query, ... )
 {
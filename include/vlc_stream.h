@@ -156,6 +156,8 @@ enum stream_query_e
     STREAM_CAN_FASTSEEK,        /**< arg1= bool *   res=cannot fail*/
     STREAM_CAN_PAUSE,           /**< arg1= bool *   res=cannot fail*/
     STREAM_CAN_CONTROL_PACE,    /**< arg1= bool *   res=cannot fail*/
+    STREAM_IS_MAPPED,           /**< arg1= bool *   res=can fail: blocks map
+                                     the data, without copying it */
     /* */
     STREAM_GET_SIZE=6,          /**< arg1= uint64_t *     res=can fail */
 
@@ -52,6 +52,9 @@
 #   include <unistd.h>
 #endif
 #include <dirent.h>
+#ifdef HAVE_MMAP
+#   include <sys/mman.h>
+#endif
 
 #include <vlc_common.h>
 #include "fs.h"
@@ -68,8 +71,20 @@ typedef struct
     int fd;
 
     bool b_pace_control;
+#ifdef HAVE_MMAP
+    /* Memory mapped mode */
+    uint64_t offset;
+    uint64_t size;
+    size_t page_size;
+    bool sequential;
+#endif
 } access_sys_t;
 
+/* Size of the file windows mapped in memory, as a multiple of the page
+ * size. This bounds the address space used by each block, so that files
+ * larger than the address space can be mapped. */
+#define MMAP_WINDOW (UINT32_C(8) << 20)
+
 #if !defined (_WIN32) && !defined (__OS2__)
 static bool IsRemote (int fd)
 {
@@ -128,6 +143,10 @@ static bool IsRemote (const char *path)
 
 static ssize_t Read (stream_t *, void *, size_t);
 static int FileSeek (stream_t *, uint64_t);
+#ifdef HAVE_MMAP
+static block_t *BlockMmap (stream_t *, bool *);
+static int FileSeekMmap (stream_t *, uint64_t);
+#endif
 static int FileControl (stream_t *, int, va_list);
 
 /*****************************************************************************
@@ -231,6 +250,23 @@ int FileOpen( vlc_object_t *p_this )
             fcntl (fd, F_RDAHEAD, 0);
         else
             fcntl (fd, F_RDAHEAD, 1);
+#endif
+#ifdef HAVE_MMAP
+        /* Serve the blocks straight from the page cache. Remote files may
+         * be truncated behind our back, which would crash the process. */
+        if (S_ISREG (st.st_mode)
+         && var_InheritBool (p_access, "file-mmap")
+         && !IsRemote(fd, p_access->psz_filepath))
+        {
+            p_access->pf_read = NULL;
+            p_access->pf_block = BlockMmap;
+            p_access->pf_seek = FileSeekMmap;
+            p_sys->offset = 0;
+            p_sys->size = st.st_size;
+            p_sys->page_size = sysconf (_SC_PAGESIZE);
+            p_sys->sequential = true;
+            msg_Dbg (p_access, "mapping file in memory");
+        }
 #endif
     }
     else
@@ -253,7 +289,7 @@ void FileClose (vlc_object_t * p_this)
 {
     stream_t     *p_access = (stream_t*)p_this;
 
-    if (p_access->pf_read == NULL)
+    if (p_access->pf_read == NULL && p_access->pf_block == NULL)
     {
         DirClose (p_this);
         return;
@@ -287,6 +323,76 @@ static ssize_t Read (stream_t *p_access, void *p_buffer, size_t i_len)
     return val;
 }
 
+#ifdef HAVE_MMAP
+/*****************************************************************************
+ * BlockMmap: map the next window of the file
+ *****************************************************************************/
+static block_t *BlockMmap (stream_t *p_access, bool *restrict eof)
+{
+    access_sys_t *p_sys = p_access->p_sys;
+
+    if (p_sys->offset >= p_sys->size)
+    {
+        /* The file may be growing */
+        struct stat st;
+
+        if (fstat (p_sys->fd, &st) == 0)
+            p_sys->size = st.st_size;
+        if (p_sys->offset >= p_sys->size)
+        {
+            *eof = true;
+            return NULL;
+        }
+    }
+
+    /* The mapping must start on a page boundary */
+    uint64_t start = p_sys->offset & ~(uint64_t)(p_sys->page_size - 1);
+    size_t skip = p_sys->offset - start;
+    size_t length = MMAP_WINDOW;
+
+    if (length > p_sys->size - start)
+        length = p_sys->size - start;
+
+    void *addr = mmap (NULL, length, PROT_READ, MAP_SHARED, p_sys->fd, start);
+    if (addr == MAP_FAILED)
+    {
+        msg_Err (p_access, "cannot map file: %s", vlc_strerror_c(errno));
+        *eof = true;
+        return NULL;
+    }
+
+    /* Let the kernel read ahead of the demuxer. Once the file is read
+     * sequentially, also start reading this window and the next one in the
+     * background, but not after a seek, as the demuxer may be probing. */
+    madvise (addr, length, MADV_SEQUENTIAL);
+    if (p_sys->sequential)
+    {
+        madvise (addr, length, MADV_WILLNEED);
+        posix_fadvise (p_sys->fd, start + length, MMAP_WINDOW,
+                       POSIX_FADV_WILLNEED);
+    }
+
+    block_t *block = block_mmap_Alloc (addr, length);
+    if (unlikely(block == NULL))
+        return NULL;
+
+    block->p_buffer += skip;
+    block->i_buffer -= skip;
+    p_sys->offset = start + length;
+    p_sys->sequential = true;
+    return block;
+}
+
+static int FileSeekMmap (stream_t *p_access, uint64_t i_pos)
+{
+    access_sys_t *sys = p_access->p_sys;
+
+    sys->sequential = false;
+    sys->offset = i_pos;
+    return VLC_SUCCESS;
+}
+#endif
+
 /*****************************************************************************
  * Seek: seek to a specific location in a file
  *****************************************************************************/
@@ -322,6 +428,13 @@ static int FileControl( stream_t *p_access, int i_query, va_list args )
             *pb_bool = p_sys->b_pace_control;
             break;
 
+#ifdef HAVE_MMAP
+        case STREAM_IS_MAPPED:
+            pb_bool = va_arg( args, bool * );
+            *pb_bool = (p_access->pf_block == BlockMmap);
+            break;
+#endif
+
         case STREAM_GET_SIZE:
         {
             struct stat st;
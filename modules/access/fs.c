@@ -36,6 +36,10 @@ vlc_module_begin ()
     set_category( CAT_INPUT )
     set_subcategory( SUBCAT_INPUT_ACCESS )
     add_obsolete_string( "file-cat" )
+    add_bool( "file-mmap", false, N_("Memory map local files"),
+              N_("Read local files through memory mappings rather than "
+                 "copying their data. The file must not be truncated "
+                 "while it is being read."), true )
     set_capability( "access", 50 )
     add_shortcut( "file", "fd", "stream" )
     set_callbacks( FileOpen, FileClose )
@@ -0,0 +1,596 @@
+/*****************************************************************************
+ * uring.c: asynchronous file input using io_uring
+ *****************************************************************************
+ * Copyright (C) 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <assert.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <poll.h>
+#ifdef HAVE_LINUX_MAGIC_H
+# include <sys/vfs.h>
+# include <linux/magic.h>
+#endif
+
+#include <liburing.h>
+
+#include <vlc_common.h>
+#include <vlc_access.h>
+#include <vlc_block.h>
+#include <vlc_fs.h>
+#include <vlc_interrupt.h>
+#include <vlc_plugin.h>
+
+/* O_DIRECT requires the buffers, the offsets and the lengths of the reads
+ * to be aligned on the logical block size of the device */
+#define URING_ALIGN 4096
+/* Read latency histogram: bucket 0 is below 2 us, bucket i covers
+ * [2^i, 2^(i+1)) us and the last bucket is open */
+#define URING_BUCKETS 24
+
+enum uring_state
+{
+    URING_IDLE,
+    URING_PENDING,
+    URING_DONE,
+    URING_CANCELED, /* still owned by the kernel */
+};
+
+struct uring_read
+{
+    block_t *block;
+    uint64_t offset;
+    vlc_tick_t date;
+    int res;
+    enum uring_state state;
+};
+
+typedef struct
+{
+    int fd;
+    struct io_uring ring;
+    bool direct;
+    bool remote; /* on a network file system */
+
+    size_t block_size;
+    unsigned depth;
+    struct uring_read *reads;
+
+    /* Reads ahead of the position, in file order */
+    unsigned *queue;
+    unsigned head;
+    unsigned count;
+    /* Reads owned by the kernel, including the canceled ones */
+    unsigned inflight;
+
+    uint64_t offset; /* position */
+    uint64_t ahead; /* offset of the next read to submit */
+    uint64_t size;
+
+    struct
+    {
+        uint64_t count;
+        vlc_tick_t total;
+        vlc_tick_t max;
+        uint64_t buckets[URING_BUCKETS];
+    } latency;
+} access_sys_t;
+
+static uint64_t AlignDown(uint64_t offset)
+{
+    return offset & ~(uint64_t)(URING_ALIGN - 1);
+}
+
+static void LatencyAdd(access_sys_t *sys, vlc_tick_t latency)
+{
+    unsigned i = 0;
+
+    for (vlc_tick_t us = US_FROM_VLC_TICK(latency);
+         us >= 2 && i < URING_BUCKETS - 1; us >>= 1)
+        i++;
+    sys->latency.buckets[i]++;
+    sys->latency.count++;
+    sys->latency.total += latency;
+    if (latency > sys->latency.max)
+        sys->latency.max = latency;
+}
+
+static void LatencyDump(stream_t *access)
+{
+    access_sys_t *sys = access->p_sys;
+
+    if (sys->latency.count == 0)
+        return;
+
+    msg_Dbg(access, "%"PRIu64" reads, latency mean %"PRId64" us, "
+            "max %"PRId64" us", sys->latency.count,
+            US_FROM_VLC_TICK(sys->latency.total) / sys->latency.count,
+            US_FROM_VLC_TICK(sys->latency.max));
+    for (unsigned i = 0; i < URING_BUCKETS; i++)
+        if (sys->latency.buckets[i] > 0)
+            msg_Dbg(access, " %8"PRIu64" us: %"PRIu64,
+                    i > 0 ? UINT64_C(1) << i : 0, sys->latency.buckets[i]);
+}
+
+/**
+ * Fills the queue with reads ahead of the position.
+ */
+static void Submit(stream_t *access)
+{
+    access_sys_t *sys = access->p_sys;
+    unsigned submitted = 0;
+
+    for (unsigned i = 0;
+         i < sys->depth && sys->count < sys->depth && sys->ahead < sys->size;
+         i++)
+    {
+        struct uring_read *read = &sys->reads[i];
+
+        if (read->state != URING_IDLE)
+            continue;
+
+        void *buf = aligned_alloc(URING_ALIGN, sys->block_size);
+        if (unlikely(buf == NULL))
+            break;
+        read->block = block_heap_Alloc(buf, sys->block_size);
+        if (unlikely(read->block == NULL))
+            break;
+
+        struct io_uring_sqe *sqe = io_uring_get_sqe(&sys->ring);
+        if (sqe == NULL)
+        {
+            block_Release(read->block);
+            read->block = NULL;
+            break;
+        }
+
+        io_uring_prep_read(sqe, sys->fd, read->block->p_buffer,
+                           sys->block_size, sys->ahead);
+        io_uring_sqe_set_data(sqe, read);
+        read->offset = sys->ahead;
+        read->date = vlc_tick_now();
+        read->state = URING_PENDING;
+
+        sys->queue[(sys->head + sys->count++) % sys->depth] = i;
+        sys->ahead += sys->block_size;
+        sys->inflight++;
+        submitted++;
+    }
+
+    if (submitted > 0)
+    {
+        int val = io_uring_submit(&sys->ring);
+        if (val < 0)
+            msg_Err(access, "cannot submit reads: %s",
+                    vlc_strerror_c(-val));
+    }
+}
+
+/**
+ * Drops a read that is not needed anymore.
+ */
+static void Drop(access_sys_t *sys, struct uring_read *read)
+{
+    if (read->state == URING_PENDING)
+    {
+        struct io_uring_sqe *sqe = io_uring_get_sqe(&sys->ring);
+
+        /* The kernel looks the read up as the cancellation is submitted, so
+         * that the read can be reused as soon as it has completed. Without
+         * a submission entry, the read completes in vain. */
+        if (sqe != NULL)
+        {
+            io_uring_prep_cancel(sqe, read, 0);
+            io_uring_sqe_set_data(sqe, NULL);
+        }
+        read->state = URING_CANCELED;
+        return;
+    }
+
+    assert(read->state == URING_DONE);
+    block_Release(read->block);
+    read->block = NULL;
+    read->state = URING_IDLE;
+}
+
+static struct uring_read *Head(access_sys_t *sys)
+{
+    return &sys->reads[sys->queue[sys->head]];
+}
+
+static struct uring_read *Pop(access_sys_t *sys)
+{
+    struct uring_read *read = Head(sys);
+
+    assert(sys->count > 0);
+    sys->head = (sys->head + 1) % sys->depth;
+    sys->count--;
+    return read;
+}
+
+/**
+ * Cancels all the reads ahead, and restarts reading from the position.
+ */
+static void Flush(stream_t *access)
+{
+    access_sys_t *sys = access->p_sys;
+
+    while (sys->count > 0)
+        Drop(sys, Pop(sys));
+    io_uring_submit(&sys->ring);
+    sys->ahead = AlignDown(sys->offset);
+}
+
+static void Complete(access_sys_t *sys, struct io_uring_cqe *cqe)
+{
+    struct uring_read *read = io_uring_cqe_get_data(cqe);
+
+    if (read == NULL)
+        return; /* cancellation request */
+
+    sys->inflight--;
+    if (read->state == URING_CANCELED)
+    {
+        block_Release(read->block);
+        read->block = NULL;
+        read->state = URING_IDLE;
+        return;
+    }
+
+    assert(read->state == URING_PENDING);
+    LatencyAdd(sys, vlc_tick_now() - read->date);
+    read->res = cqe->res;
+    read->state = URING_DONE;
+}
+
+/**
+ * Waits for reads to complete, and processes them.
+ *
+ * @return 0 on success, -1 if interrupted
+ */
+static int Reap(stream_t *access)
+{
+    access_sys_t *sys = access->p_sys;
+    struct io_uring_cqe *cqe;
+
+    while (io_uring_peek_cqe(&sys->ring, &cqe) != 0)
+    {
+        struct pollfd ufd = { .fd = sys->ring.ring_fd, .events = POLLIN };
+        if (vlc_poll_i11e(&ufd, 1, -1) < 0)
+            return -1;
+    }
+
+    do
+    {
+        Complete(sys, cqe);
+        io_uring_cqe_seen(&sys->ring, cqe);
+    }
+    while (io_uring_peek_cqe(&sys->ring, &cqe) == 0);
+    return 0;
+}
+
+static bool UpdateSize(stream_t *access)
+{
+    access_sys_t *sys = access->p_sys;
+    struct stat st;
+
+    if (fstat(sys->fd, &st) || (uint64_t)st.st_size == sys->size)
+        return false;
+    sys->size = st.st_size;
+    return true;
+}
+
+static block_t *Block(stream_t *access, bool *restrict eof)
+{
+    access_sys_t *sys = access->p_sys;
+    struct uring_read *read;
+
+    for (;;)
+    {
+        Submit(access);
+
+        if (sys->count > 0)
+        {
+            if (Head(sys)->state != URING_DONE)
+            {
+                if (Reap(access))
+                    return NULL;
+                continue;
+            }
+
+            read = Pop(sys);
+            if (read->res == -EINTR || read->res == -EAGAIN)
+            {   /* Read it again */
+                Drop(sys, read);
+                Flush(access);
+                continue;
+            }
+            if (read->res < 0)
+            {
+                msg_Err(access, "read error: %s",
+                        vlc_strerror_c(-read->res));
+                Drop(sys, read);
+                Flush(access);
+                *eof = true;
+                return NULL;
+            }
+
+            assert(sys->offset >= read->offset);
+            size_t skip = sys->offset - read->offset;
+            if ((size_t)read->res > skip)
+                break;
+
+            /* Past the end of the file, which may have shrunk */
+            Drop(sys, read);
+            Flush(access);
+            UpdateSize(access);
+            if (sys->offset >= sys->size)
+            {
+                *eof = true;
+                return NULL;
+            }
+            continue;
+        }
+
+        /* Wait for the canceled reads to free their slots */
+        if (sys->inflight > 0)
+        {
+            if (Reap(access))
+                return NULL;
+            continue;
+        }
+
+        /* End of the file, unless it is growing */
+        if (sys->offset < sys->size || !UpdateSize(access)
+         || sys->offset >= sys->size)
+        {
+            *eof = true;
+            return NULL;
+        }
+    }
+
+    block_t *block = read->block;
+    size_t skip = sys->offset - read->offset;
+
+    read->block = NULL;
+    read->state = URING_IDLE;
+    block->p_buffer += skip;
+    block->i_buffer = read->res - skip;
+    sys->offset += block->i_buffer;
+
+    /* A short read ends the queue, start again from the actual position */
+    if ((size_t)read->res < sys->block_size)
+        Flush(access);
+    else
+        Submit(access);
+    return block;
+}
+
+static int Seek(stream_t *access, uint64_t offset)
+{
+    access_sys_t *sys = access->p_sys;
+
+    sys->offset = offset;
+
+    /* Keep the reads ahead of the new position */
+    while (sys->count > 0)
+    {
+        struct uring_read *read = Head(sys);
+
+        if (offset < read->offset)
+            break;
+        if (offset < read->offset + sys->block_size)
+        {
+            io_uring_submit(&sys->ring);
+            return VLC_SUCCESS;
+        }
+        Drop(sys, Pop(sys));
+    }
+    Flush(access);
+    return VLC_SUCCESS;
+}
+
+/* Same as the file module: network file systems get the network caching */
+static bool IsRemote(int fd)
+{
+#ifdef HAVE_LINUX_MAGIC_H
+    struct statfs stf;
+
+    if (fstatfs(fd, &stf))
+        return false;
+
+    switch ((unsigned long)stf.f_type)
+    {
+        case AFS_SUPER_MAGIC:
+        case CODA_SUPER_MAGIC:
+        case NCP_SUPER_MAGIC:
+        case NFS_SUPER_MAGIC:
+        case SMB_SUPER_MAGIC:
+        case 0xFF534D42 /*CIFS_MAGIC_NUMBER*/:
+            return true;
+    }
+#else
+    (void) fd;
+#endif
+    return false;
+}
+
+static int Control(stream_t *access, int query, va_list args)
+{
+    access_sys_t *sys = access->p_sys;
+
+    switch (query)
+    {
+        case STREAM_CAN_SEEK:
+        case STREAM_CAN_FASTSEEK:
+        case STREAM_CAN_PAUSE:
+        case STREAM_CAN_CONTROL_PACE:
+            *va_arg(args, bool *) = true;
+            break;
+
+        case STREAM_GET_SIZE:
+            UpdateSize(access);
+            *va_arg(args, uint64_t *) = sys->size;
+            break;
+
+        case STREAM_GET_PTS_DELAY:
+            *va_arg(args, vlc_tick_t *) = VLC_TICK_FROM_MS(
+                var_InheritInteger(access, sys->remote ? "network-caching"
+                                                       : "file-caching"));
+            break;
+
+        case STREAM_SET_PAUSE_STATE:
+            break;
+
+        default:
+            return VLC_EGENERIC;
+    }
+    return VLC_SUCCESS;
+}
+
+static int Open(vlc_object_t *obj)
+{
+    stream_t *access = (stream_t *)obj;
+
+    if (access->psz_filepath == NULL
+     || !var_InheritBool(access, "file-uring")
+     /* Leave the memory mapped mode to the file module */
+     || var_InheritBool(access, "file-mmap"))
+        return VLC_EGENERIC;
+
+    bool direct = var_InheritBool(access, "uring-direct");
+    int fd = vlc_open(access->psz_filepath,
+                      O_RDONLY | O_NONBLOCK | (direct ? O_DIRECT : 0));
+    if (fd == -1 && direct && errno == EINVAL)
+    {
+        msg_Warn(access, "direct I/O not supported");
+        direct = false;
+        fd = vlc_open(access->psz_filepath, O_RDONLY | O_NONBLOCK);
+    }
+    if (fd == -1)
+        return VLC_EGENERIC; /* the file module will report the error */
+
+    struct stat st;
+    if (fstat(fd, &st) || !S_ISREG(st.st_mode))
+        goto error;
+
+    access_sys_t *sys = vlc_obj_malloc(obj, sizeof (*sys));
+    if (unlikely(sys == NULL))
+        goto error;
+
+    sys->fd = fd;
+    sys->direct = direct;
+    sys->remote = IsRemote(fd);
+    sys->depth = var_InheritInteger(access, "uring-depth");
+    sys->block_size = var_InheritInteger(access, "uring-block-size") * 1024;
+    sys->block_size = (sys->block_size + URING_ALIGN - 1)
+                    & ~(size_t)(URING_ALIGN - 1);
+    sys->reads = vlc_obj_calloc(obj, sys->depth, sizeof (*sys->reads));
+    sys->queue = vlc_obj_calloc(obj, sys->depth, sizeof (*sys->queue));
+    if (unlikely(sys->reads == NULL || sys->queue == NULL))
+        goto error;
+    sys->head = sys->count = sys->inflight = 0;
+    sys->offset = sys->ahead = 0;
+    sys->size = st.st_size;
+    memset(&sys->latency, 0, sizeof (sys->latency));
+
+    /* Each read may need a cancellation entry too */
+    int val = io_uring_queue_init(2 * sys->depth, &sys->ring, 0);
+    if (val < 0)
+    {   /* Not supported by the kernel, or forbidden */
+        msg_Dbg(access, "io_uring not available: %s", vlc_strerror_c(-val));
+        goto error;
+    }
+
+    msg_Dbg(access, "reading %u blocks of %zu bytes ahead%s", sys->depth,
+            sys->block_size, direct ? " with direct I/O" : "");
+    access->pf_read = NULL;
+    access->pf_block = Block;
+    access->pf_seek = Seek;
+    access->pf_control = Control;
+    access->p_sys = sys;
+
+    /* Demuxers will need the beginning of the file for probing. */
+    Submit(access);
+    return VLC_SUCCESS;
+
+error:
+    vlc_close(fd);
+    return VLC_EGENERIC;
+}
+
+static void Close(vlc_object_t *obj)
+{
+    stream_t *access = (stream_t *)obj;
+    access_sys_t *sys = access->p_sys;
+
+    Flush(access);
+    /* The kernel may still write to the canceled buffers */
+    while (sys->inflight > 0)
+    {
+        struct io_uring_cqe *cqe;
+
+        if (io_uring_wait_cqe(&sys->ring, &cqe) < 0)
+            break;
+        Complete(sys, cqe);
+        io_uring_cqe_seen(&sys->ring, cqe);
+    }
+
+    LatencyDump(access);
+    io_uring_queue_exit(&sys->ring);
+    vlc_close(sys->fd);
+}
+
+#define URING_TEXT N_("Asynchronous file input")
+#define URING_LONGTEXT N_( \
+    "Read local files with io_uring instead of the file input, keeping " \
+    "several reads outstanding ahead of the playback position.")
+#define DEPTH_TEXT N_("Read queue depth")
+#define DEPTH_LONGTEXT N_( \
+    "Number of reads kept outstanding ahead of the playback position.")
+#define BLOCK_SIZE_TEXT N_("Read size (KiB)")
+#define BLOCK_SIZE_LONGTEXT N_( \
+    "Size of each read. It is rounded up to a multiple of 4 KiB.")
+#define DIRECT_TEXT N_("Direct I/O")
+#define DIRECT_LONGTEXT N_( \
+    "Read the file without going through the page cache. This is useful " \
+    "for very large sequential reads which will not be read again.")
+
+vlc_module_begin()
+    set_shortname(N_("io_uring"))
+    set_description(N_("Asynchronous file input"))
+    set_category(CAT_INPUT)
+    set_subcategory(SUBCAT_INPUT_ACCESS)
+    add_bool("file-uring", false, URING_TEXT, URING_LONGTEXT, true)
+    add_integer_with_range("uring-depth", 8, 1, 64,
+                           DEPTH_TEXT, DEPTH_LONGTEXT, true)
+    add_integer_with_range("uring-block-size", 1024, 4, 65536,
+                           BLOCK_SIZE_TEXT, BLOCK_SIZE_LONGTEXT, true)
+    add_bool("uring-direct", false, DIRECT_TEXT, DIRECT_LONGTEXT, true)
+    set_capability("access", 60)
+    add_shortcut("file")
+    set_callbacks(Open, Close)
+vlc_module_end()
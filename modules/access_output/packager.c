@@ -0,0 +1,1240 @@
+/*****************************************************************************
+ * packager.c: low latency HLS and DASH packager
+ *****************************************************************************
+ * Copyright (C) 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Preamble
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdint.h>
+#include <time.h>
+
+#include <vlc_common.h>
+#include <vlc_plugin.h>
+#include <vlc_sout.h>
+#include <vlc_block.h>
+#include <vlc_httpd.h>
+#include <vlc_memstream.h>
+
+/*****************************************************************************
+ * Module descriptor
+ *****************************************************************************/
+static int  Open ( vlc_object_t * );
+static void Close( vlc_object_t * );
+
+#define SOUT_CFG_PREFIX "sout-packager-"
+
+#define SEGLEN_TEXT N_("Segment length")
+#define SEGLEN_LONGTEXT N_("Minimum length of the segments in seconds. " \
+                           "Segments are cut at the first independent " \
+                           "chunk after this length.")
+#define SEGMENTS_TEXT N_("Number of segments")
+#define SEGMENTS_LONGTEXT N_("Number of complete segments kept in memory " \
+                             "and listed in the manifests.")
+#define MEMORY_TEXT N_("Memory limit")
+#define MEMORY_LONGTEXT N_("Maximum size in MiB of the segments kept in " \
+                           "memory. The oldest segments are dropped first.")
+
+vlc_module_begin ()
+    set_description( N_("Low latency HLS and DASH packager") )
+    set_shortname( "Packager" )
+    set_capability( "sout access", 0 )
+    add_shortcut( "packager", "llhls" )
+    set_category( CAT_SOUT )
+    set_subcategory( SUBCAT_SOUT_ACO )
+    add_integer( SOUT_CFG_PREFIX "seglen", 2, SEGLEN_TEXT, SEGLEN_LONGTEXT,
+                 false )
+        change_integer_range( 1, 60 )
+    add_integer( SOUT_CFG_PREFIX "segments", 6, SEGMENTS_TEXT,
+                 SEGMENTS_LONGTEXT, false )
+        change_integer_range( 2, 1000 )
+    add_integer( SOUT_CFG_PREFIX "memory", 64, MEMORY_TEXT, MEMORY_LONGTEXT,
+                 true )
+        change_integer_range( 1, 4096 )
+    set_callbacks( Open, Close )
+vlc_module_end ()
+
+
+/*****************************************************************************
+ * Exported prototypes
+ *****************************************************************************/
+static const char *const ppsz_sout_options[] = {
+    "seglen", "segments", "memory", NULL
+};
+
+static ssize_t Write( sout_access_out_t *, block_t * );
+static int Control( sout_access_out_t *, int, va_list );
+
+typedef struct packager_segment_t packager_segment_t;
+typedef struct packager_part_t packager_part_t;
+
+/* A chunk made of one moof and its mdat, the partial segment of LL-HLS */
+struct packager_part_t
+{
+    sout_access_out_t  *p_access;
+    packager_segment_t *p_segment; /* NULL until its data comes */
+    uint64_t            i_number;  /* across segments */
+    unsigned            i_index;   /* in its segment */
+
+    uint8_t            *p_data;
+    size_t              i_data;
+    size_t              i_alloc;
+    vlc_tick_t          i_start;
+    vlc_tick_t          i_end;
+    bool                b_independent;
+    bool                b_complete;
+
+    httpd_url_t        *p_url;
+    packager_part_t    *p_next;
+};
+
+struct packager_segment_t
+{
+    sout_access_out_t  *p_access;
+    uint64_t            i_sequence;
+
+    packager_part_t    *p_first;
+    packager_part_t    *p_last;
+    unsigned            i_parts;
+    size_t              i_size;
+    vlc_tick_t          i_start;
+    vlc_tick_t          i_end;
+    bool                b_complete;
+
+    httpd_url_t        *p_url;
+    packager_segment_t *p_next;
+};
+
+enum packager_box_target
+{
+    BOX_SKIP,
+    BOX_INIT,
+    BOX_PART,
+};
+
+typedef struct
+{
+    httpd_host_t       *p_host;
+    char               *psz_path; /* with a trailing slash */
+    httpd_url_t        *p_init_url;
+    httpd_url_t        *p_m3u8_url;
+    httpd_url_t        *p_mpd_url;
+
+    vlc_tick_t          i_seglen;
+    unsigned            i_window;
+    size_t              i_max_size;
+
+    /* store, shared with the httpd callbacks */
+    vlc_mutex_t         lock;
+    uint8_t            *p_init;
+    size_t              i_init;
+    size_t              i_init_alloc;
+    bool                b_init_complete;
+
+    packager_segment_t *p_first;  /* oldest */
+    packager_segment_t *p_last;   /* current */
+    unsigned            i_complete_segments;
+    size_t              i_size;
+    packager_segment_t *p_next_segment; /* announced, not started */
+    packager_part_t    *p_next_part;    /* first incomplete part */
+
+    vlc_tick_t          i_origin;       /* media time of the first part */
+    int64_t             i_origin_ms;    /* wall clock of the first part */
+    vlc_tick_t          i_part_target;
+    vlc_tick_t          i_target;
+
+    /* ISO BMFF box parser, only used by Write */
+    uint8_t             box_header[16];
+    unsigned            i_box_header;
+    uint64_t            i_box_left;
+    bool                b_box_mdat;
+    bool                b_box_moov;
+    enum packager_box_target box_target;
+    packager_part_t    *p_part;       /* receiving */
+    vlc_tick_t          i_part_dts;   /* first sample of the part */
+    vlc_tick_t          i_last_end;
+} sout_access_out_sys_t;
+
+static int InitCallback( httpd_callback_sys_t *, httpd_client_t *,
+                         httpd_message_t *, const httpd_message_t * );
+static int M3u8Callback( httpd_callback_sys_t *, httpd_client_t *,
+                         httpd_message_t *, const httpd_message_t * );
+static int MpdCallback( httpd_callback_sys_t *, httpd_client_t *,
+                        httpd_message_t *, const httpd_message_t * );
+static int PartCallback( httpd_callback_sys_t *, httpd_client_t *,
+                         httpd_message_t *, const httpd_message_t * );
+static int SegmentCallback( httpd_callback_sys_t *, httpd_client_t *,
+                            httpd_message_t *, const httpd_message_t * );
+
+static httpd_url_t *UrlNew( sout_access_out_t *p_access, const char *psz_name,
+                            httpd_callback_t pf_callback, void *p_data )
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+    char *psz_url;
+
+    if( asprintf( &psz_url, "%s%s", p_sys->psz_path, psz_name ) < 0 )
+        return NULL;
+
+    httpd_url_t *p_url = httpd_UrlNew( p_sys->p_host, psz_url, NULL, NULL );
+    if( p_url == NULL )
+        msg_Err( p_access, "cannot add url %s", psz_url );
+    else
+        httpd_UrlCatch( p_url, HTTPD_MSG_GET, pf_callback, p_data );
+    free( psz_url );
+    return p_url;
+}
+
+static packager_part_t *PartNew( sout_access_out_t *p_access,
+                                 uint64_t i_number )
+{
+    packager_part_t *p_part = calloc( 1, sizeof( *p_part ) );
+    if( unlikely(p_part == NULL) )
+        return NULL;
+
+    p_part->p_access = p_access;
+    p_part->i_number = i_number;
+    p_part->i_start = p_part->i_end = VLC_TICK_INVALID;
+
+    /* Registered before its data comes, for the preload hints */
+    char psz_name[32];
+    snprintf( psz_name, sizeof( psz_name ), "part-%"PRIu64".m4s", i_number );
+    p_part->p_url = UrlNew( p_access, psz_name, PartCallback,
+                            (httpd_callback_sys_t *)p_part );
+    return p_part;
+}
+
+static void PartDelete( packager_part_t *p_part )
+{
+    if( p_part->p_url != NULL )
+        httpd_UrlDelete( p_part->p_url );
+    free( p_part->p_data );
+    free( p_part );
+}
+
+static packager_segment_t *SegmentNew( sout_access_out_t *p_access,
+                                       uint64_t i_sequence )
+{
+    packager_segment_t *p_segment = calloc( 1, sizeof( *p_segment ) );
+    if( unlikely(p_segment == NULL) )
+        return NULL;
+
+    p_segment->p_access = p_access;
+    p_segment->i_sequence = i_sequence;
+    p_segment->i_start = p_segment->i_end = VLC_TICK_INVALID;
+
+    /* Registered before its data comes, for the DASH clients which request
+     * it as soon as its first chunk is available */
+    char psz_name[32];
+    snprintf( psz_name, sizeof( psz_name ), "seg-%"PRIu64".m4s", i_sequence );
+    p_segment->p_url = UrlNew( p_access, psz_name, SegmentCallback,
+                               (httpd_callback_sys_t *)p_segment );
+    return p_segment;
+}
+
+static void SegmentDelete( packager_segment_t *p_segment )
+{
+    /* Remove the urls first, so that no callback can see the parts */
+    if( p_segment->p_url != NULL )
+        httpd_UrlDelete( p_segment->p_url );
+    while( p_segment->p_first != NULL )
+    {
+        packager_part_t *p_part = p_segment->p_first;
+
+        p_segment->p_first = p_part->p_next;
+        PartDelete( p_part );
+    }
+    free( p_segment );
+}
+
+/*****************************************************************************
+ * Open: start the HTTP server
+ *****************************************************************************/
+static int Open( vlc_object_t *p_this )
+{
+    sout_access_out_t       *p_access = (sout_access_out_t*)p_this;
+    sout_access_out_sys_t   *p_sys;
+
+    if( !( p_sys = p_access->p_sys = calloc( 1, sizeof( *p_sys ) ) ) )
+        return VLC_ENOMEM;
+
+    config_ChainParse( p_access, SOUT_CFG_PREFIX, ppsz_sout_options, p_access->p_cfg );
+
+    p_sys->i_seglen = vlc_tick_from_sec(
+                        var_GetInteger( p_access, SOUT_CFG_PREFIX "seglen" ) );
+    p_sys->i_window = var_GetInteger( p_access, SOUT_CFG_PREFIX "segments" );
+    p_sys->i_max_size = (size_t)var_GetInteger( p_access,
+                                                SOUT_CFG_PREFIX "memory" ) << 20;
+
+    /* Same host and port syntax as the http access output */
+    const char *path = p_access->psz_path;
+    path += strcspn( path, "/" );
+    if( path > p_access->psz_path )
+    {
+        const char *port = strrchr( p_access->psz_path, ':' );
+        if( port != NULL && strchr( port, ']' ) != NULL )
+            port = NULL; /* IPv6 numeral */
+        if( port != p_access->psz_path )
+        {
+            int len = (port ? port : path) - p_access->psz_path;
+            char host[len + 1];
+            strncpy( host, p_access->psz_path, len );
+            host[len] = '\0';
+
+            var_Create( p_access, "http-host", VLC_VAR_STRING );
+            var_SetString( p_access, "http-host", host );
+        }
+        if( port != NULL )
+        {
+            int bind_port = atoi( port + 1 );
+            if( bind_port > 0 )
+            {
+                var_Create( p_access, "http-port", VLC_VAR_INTEGER );
+                var_SetInteger( p_access, "http-port", bind_port );
+            }
+        }
+    }
+    if( asprintf( &p_sys->psz_path, "%s%s", path,
+                  path[0] && path[strlen( path ) - 1] == '/' ? "" : "/" ) < 0 )
+    {
+        free( p_sys );
+        return VLC_ENOMEM;
+    }
+
+    p_sys->p_host = vlc_http_HostNew( VLC_OBJECT(p_access) );
+    if( p_sys->p_host == NULL )
+    {
+        msg_Err( p_access, "cannot start HTTP server" );
+        free( p_sys->psz_path );
+        free( p_sys );
+        return VLC_EGENERIC;
+    }
+
+    vlc_mutex_init( &p_sys->lock );
+    p_sys->i_origin = VLC_TICK_INVALID;
+    p_sys->i_last_end = VLC_TICK_INVALID;
+    p_sys->box_target = BOX_SKIP;
+
+    p_sys->p_init_url = UrlNew( p_access, "init.mp4", InitCallback,
+                                (httpd_callback_sys_t *)p_access );
+    p_sys->p_m3u8_url = UrlNew( p_access, "index.m3u8", M3u8Callback,
+                                (httpd_callback_sys_t *)p_access );
+    p_sys->p_mpd_url = UrlNew( p_access, "index.mpd", MpdCallback,
+                               (httpd_callback_sys_t *)p_access );
+    p_sys->p_next_segment = SegmentNew( p_access, 0 );
+    p_sys->p_next_part = PartNew( p_access, 0 );
+
+    if( p_sys->p_init_url == NULL || p_sys->p_m3u8_url == NULL
+     || p_sys->p_mpd_url == NULL || p_sys->p_next_segment == NULL
+     || p_sys->p_next_part == NULL )
+    {
+        Close( p_this );
+        return VLC_EGENERIC;
+    }
+
+    msg_Dbg( p_access, "serving %sindex.m3u8 and %sindex.mpd",
+             p_sys->psz_path, p_sys->psz_path );
+
+    p_access->pf_write       = Write;
+    p_access->pf_control     = Control;
+
+    return VLC_SUCCESS;
+}
+
+/*****************************************************************************
+ * Close: stop serving the segments
+ *****************************************************************************/
+static void Close( vlc_object_t * p_this )
+{
+    sout_access_out_t       *p_access = (sout_access_out_t*)p_this;
+    sout_access_out_sys_t   *p_sys = p_access->p_sys;
+
+    if( p_sys->p_m3u8_url != NULL )
+        httpd_UrlDelete( p_sys->p_m3u8_url );
+    if( p_sys->p_mpd_url != NULL )
+        httpd_UrlDelete( p_sys->p_mpd_url );
+    if( p_sys->p_init_url != NULL )
+        httpd_UrlDelete( p_sys->p_init_url );
+
+    /* The part being received is either in its segment or the next one */
+    if( p_sys->p_next_part != NULL && p_sys->p_next_part->p_segment == NULL )
+        PartDelete( p_sys->p_next_part );
+    if( p_sys->p_next_segment != NULL )
+        SegmentDelete( p_sys->p_next_segment );
+    while( p_sys->p_first != NULL )
+    {
+        packager_segment_t *p_segment = p_sys->p_first;
+
+        p_sys->p_first = p_segment->p_next;
+        SegmentDelete( p_segment );
+    }
+
+    httpd_HostDelete( p_sys->p_host );
+
+    free( p_sys->p_init );
+    free( p_sys->psz_path );
+
+    msg_Dbg( p_access, "Close" );
+
+    free( p_sys );
+}
+
+static int Control( sout_access_out_t *p_access, int i_query, va_list args )
+{
+    (void)p_access;
+
+    switch( i_query )
+    {
+        case ACCESS_OUT_CONTROLS_PACE:
+            *va_arg( args, bool * ) = false;
+            break;
+
+        default:
+            return VLC_EGENERIC;
+    }
+    return VLC_SUCCESS;
+}
+
+/*****************************************************************************
+ * Store
+ *****************************************************************************/
+
+static int Append( uint8_t **pp_data, size_t *pi_data, size_t *pi_alloc,
+                   const uint8_t *p_buf, size_t i_buf )
+{
+    if( *pi_data + i_buf > *pi_alloc )
+    {
+        size_t i_alloc = __MAX( *pi_alloc * 2, *pi_data + i_buf );
+        uint8_t *p_data = realloc( *pp_data, i_alloc );
+        if( unlikely(p_data == NULL) )
+            return VLC_ENOMEM;
+        *pp_data = p_data;
+        *pi_alloc = i_alloc;
+    }
+    memcpy( *pp_data + *pi_data, p_buf, i_buf );
+    *pi_data += i_buf;
+    return VLC_SUCCESS;
+}
+
+/* Drops the oldest segments out of the window or of the memory limit */
+static void Evict( sout_access_out_t *p_access )
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+    packager_segment_t *p_evicted = NULL, **pp_evicted = &p_evicted;
+
+    vlc_mutex_lock( &p_sys->lock );
+    while( p_sys->p_first != p_sys->p_last
+        && ( p_sys->i_complete_segments > p_sys->i_window
+          || p_sys->i_size > p_sys->i_max_size ) )
+    {
+        packager_segment_t *p_segment = p_sys->p_first;
+
+        p_sys->p_first = p_segment->p_next;
+        p_sys->i_complete_segments--;
+        p_sys->i_size -= p_segment->i_size;
+        p_segment->p_next = NULL;
+        *pp_evicted = p_segment;
+        pp_evicted = &p_segment->p_next;
+    }
+    vlc_mutex_unlock( &p_sys->lock );
+
+    /* The httpd callbacks run with the host lock held, so the urls are
+     * removed without the store lock */
+    while( p_evicted != NULL )
+    {
+        packager_segment_t *p_segment = p_evicted;
+
+        msg_Dbg( p_access, "dropping segment %"PRIu64, p_segment->i_sequence );
+        p_evicted = p_segment->p_next;
+        SegmentDelete( p_segment );
+    }
+}
+
+static void PartStart( sout_access_out_t *p_access, bool b_independent )
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+    packager_part_t *p_part = p_sys->p_next_part;
+    packager_segment_t *p_current = p_sys->p_last;
+    bool b_new_segment = p_current == NULL
+        || ( b_independent && p_current->i_end != VLC_TICK_INVALID
+          && p_current->i_end - p_current->i_start >= p_sys->i_seglen );
+
+    /* Retry after an allocation failure */
+    if( p_part == NULL )
+    {
+        p_part = PartNew( p_access, p_current != NULL
+                                    ? p_current->p_last->i_number + 1 : 0 );
+        vlc_mutex_lock( &p_sys->lock );
+        p_sys->p_next_part = p_part;
+        vlc_mutex_unlock( &p_sys->lock );
+    }
+    if( b_new_segment && p_sys->p_next_segment == NULL )
+    {
+        packager_segment_t *p_next = SegmentNew( p_access, p_current != NULL
+                                                 ? p_current->i_sequence + 1
+                                                 : 0 );
+        vlc_mutex_lock( &p_sys->lock );
+        p_sys->p_next_segment = p_next;
+        vlc_mutex_unlock( &p_sys->lock );
+    }
+
+    if( p_part == NULL
+     || ( b_new_segment && p_sys->p_next_segment == NULL ) )
+    {
+        /* Out of memory, drop the chunk */
+        p_sys->p_part = NULL;
+        return;
+    }
+
+    vlc_mutex_lock( &p_sys->lock );
+    if( b_new_segment )
+    {
+        packager_segment_t *p_segment = p_sys->p_next_segment;
+
+        if( p_current != NULL )
+        {
+            p_current->b_complete = true;
+            p_sys->i_complete_segments++;
+            if( p_current->i_end - p_current->i_start > p_sys->i_target )
+                p_sys->i_target = p_current->i_end - p_current->i_start;
+            p_current->p_next = p_segment;
+        }
+        else
+            p_sys->p_first = p_segment;
+        p_sys->p_last = p_current = p_segment;
+        p_sys->p_next_segment = NULL;
+    }
+
+    p_part->p_segment = p_current;
+    p_part->i_index = p_current->i_parts++;
+    p_part->b_independent = b_independent;
+    if( p_current->p_last != NULL )
+        p_current->p_last->p_next = p_part;
+    else
+        p_current->p_first = p_part;
+    p_current->p_last = p_part;
+    vlc_mutex_unlock( &p_sys->lock );
+
+    p_sys->p_part = p_part;
+    p_sys->i_part_dts = VLC_TICK_INVALID;
+
+    if( b_new_segment )
+    {
+        msg_Dbg( p_access, "starting segment %"PRIu64, p_current->i_sequence );
+        packager_segment_t *p_next = SegmentNew( p_access,
+                                                 p_current->i_sequence + 1 );
+        vlc_mutex_lock( &p_sys->lock );
+        p_sys->p_next_segment = p_next;
+        vlc_mutex_unlock( &p_sys->lock );
+        Evict( p_access );
+    }
+}
+
+static void PartEnd( sout_access_out_t *p_access )
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+    packager_part_t *p_part = p_sys->p_part;
+    packager_segment_t *p_segment = p_part->p_segment;
+
+    /* The parts follow each other, whatever the track of their samples */
+    vlc_tick_t i_start = p_sys->i_last_end != VLC_TICK_INVALID
+                       ? p_sys->i_last_end : p_sys->i_part_dts;
+    vlc_tick_t i_end = p_part->i_end;
+    if( i_start == VLC_TICK_INVALID || i_end == VLC_TICK_INVALID )
+        i_start = i_end = VLC_TICK_0;
+    else if( i_end < i_start )
+        i_end = i_start;
+    p_sys->i_last_end = i_end;
+
+    vlc_mutex_lock( &p_sys->lock );
+    p_part->i_start = i_start;
+    p_part->i_end = i_end;
+    p_part->b_complete = true;
+    if( p_segment->i_start == VLC_TICK_INVALID )
+        p_segment->i_start = i_start;
+    p_segment->i_end = i_end;
+    if( p_sys->i_origin == VLC_TICK_INVALID )
+    {
+        struct timespec ts;
+
+        timespec_get( &ts, TIME_UTC );
+        p_sys->i_origin = i_start;
+        p_sys->i_origin_ms = ts.tv_sec * INT64_C(1000) + ts.tv_nsec / 1000000
+                           - MS_FROM_VLC_TICK(i_end - i_start);
+    }
+    if( i_end - i_start > p_sys->i_part_target )
+        p_sys->i_part_target = i_end - i_start;
+    vlc_mutex_unlock( &p_sys->lock );
+
+    p_sys->p_part = NULL;
+
+    packager_part_t *p_next = PartNew( p_access, p_part->i_number + 1 );
+    vlc_mutex_lock( &p_sys->lock );
+    p_sys->p_next_part = p_next;
+    vlc_mutex_unlock( &p_sys->lock );
+}
+
+static void Feed( sout_access_out_t *p_access, const block_t *p_block,
+                  const uint8_t *p_buf, size_t i_buf )
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+    int i_ret = VLC_SUCCESS;
+
+    switch( p_sys->box_target )
+    {
+        case BOX_SKIP:
+            return;
+
+        case BOX_INIT:
+            vlc_mutex_lock( &p_sys->lock );
+            i_ret = Append( &p_sys->p_init, &p_sys->i_init,
+                            &p_sys->i_init_alloc, p_buf, i_buf );
+            vlc_mutex_unlock( &p_sys->lock );
+            break;
+
+        case BOX_PART:
+        {
+            packager_part_t *p_part = p_sys->p_part;
+
+            vlc_mutex_lock( &p_sys->lock );
+            i_ret = Append( &p_part->p_data, &p_part->i_data,
+                            &p_part->i_alloc, p_buf, i_buf );
+            if( i_ret == VLC_SUCCESS )
+            {
+                p_part->p_segment->i_size += i_buf;
+                p_sys->i_size += i_buf;
+            }
+            vlc_mutex_unlock( &p_sys->lock );
+
+            /* The samples of the mdat keep their timestamps */
+            if( p_sys->b_box_mdat && p_block->i_dts != VLC_TICK_INVALID )
+            {
+                if( p_sys->i_part_dts == VLC_TICK_INVALID
+                 || p_block->i_dts < p_sys->i_part_dts )
+                    p_sys->i_part_dts = p_block->i_dts;
+                if( p_part->i_end == VLC_TICK_INVALID
+                 || p_block->i_dts + p_block->i_length > p_part->i_end )
+                    p_part->i_end = p_block->i_dts + p_block->i_length;
+            }
+            break;
+        }
+    }
+
+    if( i_ret != VLC_SUCCESS )
+    {
+        msg_Err( p_access, "cannot store %zu bytes", i_buf );
+        p_sys->box_target = BOX_SKIP;
+    }
+}
+
+static void BoxStart( sout_access_out_t *p_access, const char *psz_type,
+                      bool b_independent )
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+
+    p_sys->b_box_mdat = !memcmp( psz_type, "mdat", 4 );
+    p_sys->b_box_moov = !memcmp( psz_type, "moov", 4 );
+
+    if( !memcmp( psz_type, "ftyp", 4 ) )
+    {
+        /* A new initialization segment replaces the previous one */
+        vlc_mutex_lock( &p_sys->lock );
+        p_sys->i_init = 0;
+        p_sys->b_init_complete = false;
+        vlc_mutex_unlock( &p_sys->lock );
+        p_sys->box_target = BOX_INIT;
+    }
+    else if( p_sys->b_box_moov )
+        p_sys->box_target = BOX_INIT;
+    else if( !memcmp( psz_type, "moof", 4 ) )
+    {
+        if( p_sys->p_part != NULL ) /* truncated mdat */
+            PartEnd( p_access );
+        PartStart( p_access, b_independent );
+        p_sys->box_target = p_sys->p_part != NULL ? BOX_PART : BOX_SKIP;
+    }
+    else if( p_sys->b_box_mdat && p_sys->p_part != NULL )
+        p_sys->box_target = BOX_PART;
+    else
+        p_sys->box_target = BOX_SKIP; /* mfra, free... */
+}
+
+static void BoxEnd( sout_access_out_t *p_access )
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+
+    if( p_sys->b_box_moov )
+    {
+        vlc_mutex_lock( &p_sys->lock );
+        p_sys->b_init_complete = true;
+        vlc_mutex_unlock( &p_sys->lock );
+    }
+    else if( p_sys->b_box_mdat && p_sys->p_part != NULL )
+        PartEnd( p_access );
+    p_sys->box_target = BOX_SKIP;
+    p_sys->b_box_mdat = p_sys->b_box_moov = false;
+}
+
+/*****************************************************************************
+ * Write: split the fragmented MP4 stream into chunks and segments
+ *****************************************************************************/
+static ssize_t Write( sout_access_out_t *p_access, block_t *p_buffer )
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+    ssize_t i_len = 0;
+
+    while( p_buffer )
+    {
+        const uint8_t *p = p_buffer->p_buffer;
+        size_t i_left = p_buffer->i_buffer;
+
+        while( i_left > 0 )
+        {
+            if( p_sys->i_box_left > 0 )
+            {
+                size_t i_copy = __MIN( i_left, p_sys->i_box_left );
+
+                Feed( p_access, p_buffer, p, i_copy );
+                p += i_copy;
+                i_left -= i_copy;
+                p_sys->i_box_left -= i_copy;
+                if( p_sys->i_box_left == 0 )
+                    BoxEnd( p_access );
+                continue;
+            }
+
+            /* Gather the box header, with its 64 bits size if any */
+            unsigned i_header = 8;
+            if( p_sys->i_box_header >= 4 && GetDWBE( p_sys->box_header ) == 1 )
+                i_header = 16;
+            size_t i_copy = __MIN( i_left, i_header - p_sys->i_box_header );
+            memcpy( &p_sys->box_header[p_sys->i_box_header], p, i_copy );
+            p_sys->i_box_header += i_copy;
+            p += i_copy;
+            i_left -= i_copy;
+
+            if( p_sys->i_box_header < 8 || ( p_sys->i_box_header < 16
+                  && GetDWBE( p_sys->box_header ) == 1 ) )
+                continue;
+
+            uint64_t i_size = GetDWBE( p_sys->box_header );
+            if( i_size == 1 )
+                i_size = GetQWBE( &p_sys->box_header[8] );
+            else if( i_size == 0 )
+                i_size = UINT64_MAX; /* up to the end */
+
+            p_sys->i_box_header = 0;
+            if( i_size < i_header )
+            {
+                msg_Err( p_access, "invalid box size %"PRIu64, i_size );
+                continue;
+            }
+
+            BoxStart( p_access, (const char *)&p_sys->box_header[4],
+                      p_buffer->i_flags & BLOCK_FLAG_TYPE_I );
+            Feed( p_access, p_buffer, p_sys->box_header, i_header );
+            p_sys->i_box_left = i_size - i_header;
+            if( p_sys->i_box_left == 0 )
+                BoxEnd( p_access );
+        }
+
+        i_len += p_buffer->i_buffer;
+
+        block_t *p_next = p_buffer->p_next;
+        block_Release( p_buffer );
+        p_buffer = p_next;
+    }
+
+    return i_len;
+}
+
+/*****************************************************************************
+ * HTTP
+ *****************************************************************************/
+
+static void AnswerInit( httpd_message_t *answer, int i_status,
+                        const char *psz_mime )
+{
+    answer->i_proto  = HTTPD_PROTO_HTTP;
+    answer->i_version= 1;
+    answer->i_type   = HTTPD_MSG_ANSWER;
+    answer->i_status = i_status;
+
+    if( psz_mime != NULL )
+        httpd_MsgAdd( answer, "Content-Type", "%s", psz_mime );
+    httpd_MsgAdd( answer, "Access-Control-Allow-Origin", "*" );
+}
+
+static void AnswerBody( httpd_message_t *answer, uint8_t *p_body,
+                        size_t i_body )
+{
+    answer->p_body = p_body;
+    answer->i_body = i_body;
+    httpd_MsgAdd( answer, "Content-Length", "%zu", i_body );
+}
+
+/* Starts an answer whose body is not known yet: it is sent in chunks to the
+ * HTTP/1.1 clients, so that they keep their connection, and its length is
+ * given by the end of the connection for the others */
+static void AnswerDefer( httpd_client_t *cl, httpd_message_t *answer,
+                         const httpd_message_t *query, int64_t i_offset )
+{
+    if( query->i_version > 0 )
+        httpd_MsgAdd( answer, "Transfer-Encoding", "chunked" );
+    else
+        httpd_MsgAdd( answer, "Connection", "close" );
+    answer->i_body_offset = i_offset;
+    httpd_ClientModeStream( cl );
+}
+
+/* Gives more of the body of a deferred answer, the last one with a zero
+ * offset */
+static void AnswerNext( httpd_message_t *answer, const httpd_message_t *query,
+                        uint8_t *p_data, size_t i_data, int64_t i_offset )
+{
+    answer->i_proto  = HTTPD_PROTO_HTTP;
+    answer->i_version= 1;
+    answer->i_type   = HTTPD_MSG_ANSWER;
+    answer->p_body   = p_data;
+    answer->i_body   = i_data;
+    answer->i_body_offset = i_offset;
+
+    if( query->i_version == 0 )
+        return;
+
+    struct vlc_memstream ms;
+
+    if( vlc_memstream_open( &ms ) == 0 )
+    {
+        if( i_data > 0 )
+        {
+            vlc_memstream_printf( &ms, "%zx\r\n", i_data );
+            vlc_memstream_write( &ms, p_data, i_data );
+            vlc_memstream_puts( &ms, "\r\n" );
+        }
+        if( i_offset == 0 )
+            vlc_memstream_puts( &ms, "0\r\n\r\n" );
+        if( vlc_memstream_close( &ms ) == 0 )
+        {
+            free( p_data );
+            answer->p_body = (uint8_t *)ms.ptr;
+            answer->i_body = ms.length;
+            return;
+        }
+    }
+
+    /* The body cannot be framed, give up on the connection */
+    free( p_data );
+    answer->p_body = NULL;
+    answer->i_body = 0;
+    answer->i_body_offset = 0;
+    httpd_MsgAdd( answer, "Connection", "close" );
+}
+
+/* Copies the data of the parts from the given position */
+static uint8_t *Concat( const packager_part_t *p_part,
+                        const packager_part_t *p_end, size_t i_pos,
+                        size_t *pi_size )
+{
+    size_t i_size = 0;
+
+    for( const packager_part_t *p = p_part; p != p_end; p = p->p_next )
+        i_size += p->i_data;
+    *pi_size = i_size;
+    if( i_size <= i_pos )
+        return NULL;
+
+    uint8_t *p_body = malloc( i_size - i_pos ), *p_out = p_body;
+    if( unlikely(p_body == NULL) )
+        return NULL;
+
+    for( const packager_part_t *p = p_part; p != p_end; p = p->p_next )
+    {
+        if( i_pos >= p->i_data )
+        {
+            i_pos -= p->i_data;
+            continue;
+        }
+        memcpy( p_out, p->p_data + i_pos, p->i_data - i_pos );
+        p_out += p->i_data - i_pos;
+        i_pos = 0;
+    }
+    return p_body;
+}
+
+/* Answers a part or a segment, while it is received if needed. The body
+ * offset of a deferred answer is one past the size already sent. */
+static void AnswerMedia( httpd_client_t *cl, httpd_message_t *answer,
+                         const httpd_message_t *query,
+                         const packager_part_t *p_part,
+                         const packager_part_t *p_end, bool b_complete )
+{
+    size_t i_size;
+
+    if( answer->i_body_offset == 0 )
+    {
+        AnswerInit( answer, 200, "video/mp4" );
+        if( b_complete )
+        {
+            uint8_t *p_body = Concat( p_part, p_end, 0, &i_size );
+
+            httpd_MsgAdd( answer, "Cache-Control", "max-age=3600" );
+            AnswerBody( answer, p_body, p_body != NULL ? i_size : 0 );
+            return;
+        }
+        httpd_MsgAdd( answer, "Cache-Control", "no-cache" );
+        AnswerDefer( cl, answer, query, 1 );
+    }
+
+    const size_t i_pos = answer->i_body_offset - 1;
+    uint8_t *p_body = Concat( p_part, p_end, i_pos, &i_size );
+    if( p_body == NULL && !b_complete )
+        return; /* wait */
+
+    AnswerNext( answer, query, p_body, p_body != NULL ? i_size - i_pos : 0,
+                b_complete ? 0 : 1 + i_size );
+}
+
+static int InitCallback( httpd_callback_sys_t *p_data, httpd_client_t *cl,
+                         httpd_message_t *answer, const httpd_message_t *query )
+{
+    sout_access_out_t *p_access = (sout_access_out_t *)p_data;
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+    VLC_UNUSED(cl);
+
+    if( answer == NULL || query == NULL )
+        return VLC_SUCCESS;
+
+    vlc_mutex_lock( &p_sys->lock );
+    if( !p_sys->b_init_complete )
+    {
+        vlc_mutex_unlock( &p_sys->lock );
+        return VLC_EGENERIC; /* not found */
+    }
+
+    uint8_t *p_body = malloc( p_sys->i_init );
+    if( p_body != NULL )
+        memcpy( p_body, p_sys->p_init, p_sys->i_init );
+    vlc_mutex_unlock( &p_sys->lock );
+    if( unlikely(p_body == NULL) )
+        return VLC_ENOMEM;
+
+    AnswerInit( answer, 200, "video/mp4" );
+    httpd_MsgAdd( answer, "Cache-Control", "no-cache" );
+    AnswerBody( answer, p_body, p_sys->i_init );
+    return VLC_SUCCESS;
+}
+
+static int PartCallback( httpd_callback_sys_t *p_data, httpd_client_t *cl,
+                         httpd_message_t *answer, const httpd_message_t *query )
+{
+    packager_part_t *p_part = (packager_part_t *)p_data;
+    sout_access_out_sys_t *p_sys = p_part->p_access->p_sys;
+
+    if( answer == NULL || query == NULL )
+        return VLC_SUCCESS;
+
+    vlc_mutex_lock( &p_sys->lock );
+    AnswerMedia( cl, answer, query, p_part, p_part->p_next,
+                 p_part->b_complete );
+    vlc_mutex_unlock( &p_sys->lock );
+    return VLC_SUCCESS;
+}
+
+static int SegmentCallback( httpd_callback_sys_t *p_data, httpd_client_t *cl,
+                            httpd_message_t *answer,
+                            const httpd_message_t *query )
+{
+    packager_segment_t *p_segment = (packager_segment_t *)p_data;
+    sout_access_out_sys_t *p_sys = p_segment->p_access->p_sys;
+
+    if( answer == NULL || query == NULL )
+        return VLC_SUCCESS;
+
+    vlc_mutex_lock( &p_sys->lock );
+    AnswerMedia( cl, answer, query, p_segment->p_first, NULL,
+                 p_segment->b_complete );
+    vlc_mutex_unlock( &p_sys->lock );
+    return VLC_SUCCESS;
+}
+
+/* Tells whether the playlist has the part of a segment, or the segment
+ * itself if i_part is negative */
+static bool M3u8Has( const sout_access_out_sys_t *p_sys, uint64_t i_msn,
+                     int64_t i_part )
+{
+    const packager_segment_t *p_last = p_sys->p_last;
+
+    if( p_last == NULL )
+        return false;
+    if( i_msn < p_last->i_sequence )
+        return true;
+    if( i_msn > p_last->i_sequence )
+        return false;
+    if( i_part < 0 )
+        return p_last->b_complete;
+
+    unsigned i_complete = 0;
+    for( const packager_part_t *p = p_last->p_first; p; p = p->p_next )
+        if( p->b_complete )
+            i_complete++;
+    return (uint64_t)i_part < i_complete;
+}
+
+static char *M3u8( const sout_access_out_sys_t *p_sys, size_t *pi_size )
+{
+    struct vlc_memstream ms;
+    const vlc_tick_t i_target = p_sys->i_target > 0 ? p_sys->i_target
+                                                    : p_sys->i_seglen;
+
+    if( vlc_memstream_open( &ms ) )
+        return NULL;
+
+    vlc_memstream_printf( &ms,
+        "#EXTM3U\n"
+        "#EXT-X-VERSION:9\n"
+        "#EXT-X-TARGETDURATION:%u\n"
+        "#EXT-X-SERVER-CONTROL:CAN-BLOCK-RELOAD=YES,PART-HOLD-BACK=%.3f\n"
+        "#EXT-X-PART-INF:PART-TARGET=%.3f\n"
+        "#EXT-X-MEDIA-SEQUENCE:%"PRIu64"\n"
+        "#EXT-X-MAP:URI=\"init.mp4\"\n",
+        (unsigned)SEC_FROM_VLC_TICK(i_target + VLC_TICK_FROM_SEC(1) - 1),
+        3 * secf_from_vlc_tick( p_sys->i_part_target ),
+        secf_from_vlc_tick( p_sys->i_part_target ),
+        p_sys->p_first->i_sequence );
+
+    /* The parts are only listed for the last segments */
+    for( const packager_segment_t *p_segment = p_sys->p_first; p_segment;
+         p_segment = p_segment->p_next )
+    {
+        if( p_segment->i_sequence + 3 > p_sys->p_last->i_sequence )
+        {
+            for( const packager_part_t *p = p_segment->p_first;
+                 p && p->b_complete; p = p->p_next )
+                vlc_memstream_printf( &ms,
+                    "#EXT-X-PART:DURATION=%.3f,URI=\"part-%"PRIu64".m4s\"%s\n",
+                    secf_from_vlc_tick( p->i_end - p->i_start ), p->i_number,
+                    p->b_independent ? ",INDEPENDENT=YES" : "" );
+        }
+        if( p_segment->b_complete )
+            vlc_memstream_printf( &ms, "#EXTINF:%.3f,\nseg-%"PRIu64".m4s\n",
+                secf_from_vlc_tick( p_segment->i_end - p_segment->i_start ),
+                p_segment->i_sequence );
+    }
+
+    if( p_sys->p_next_part != NULL )
+        vlc_memstream_printf( &ms,
+            "#EXT-X-PRELOAD-HINT:TYPE=PART,URI=\"part-%"PRIu64".m4s\"\n",
+            p_sys->p_next_part->i_number );
+
+    if( vlc_memstream_close( &ms ) )
+        return NULL;
+    *pi_size = ms.length;
+    return ms.ptr;
+}
+
+static int M3u8Callback( httpd_callback_sys_t *p_data, httpd_client_t *cl,
+                         httpd_message_t *answer, const httpd_message_t *query )
+{
+    sout_access_out_t *p_access = (sout_access_out_t *)p_data;
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+
+    if( answer == NULL || query == NULL )
+        return VLC_SUCCESS;
+
+    /* Blocking playlist reload */
+    int64_t i_msn = -1, i_part = -1;
+    for( const char *psz = (const char *)query->psz_args; psz && *psz; )
+    {
+        long long i_val;
+
+        if( sscanf( psz, "_HLS_msn=%lld", &i_val ) == 1 )
+            i_msn = i_val;
+        else if( sscanf( psz, "_HLS_part=%lld", &i_val ) == 1 )
+            i_part = i_val;
+        psz = strchr( psz, '&' );
+        if( psz != NULL )
+            psz++;
+    }
+
+    vlc_mutex_lock( &p_sys->lock );
+    if( p_sys->p_last == NULL || !p_sys->b_init_complete
+     || p_sys->p_first->p_first == NULL || !p_sys->p_first->p_first->b_complete )
+    {
+        vlc_mutex_unlock( &p_sys->lock );
+        return VLC_EGENERIC; /* not found */
+    }
+
+    bool b_ready = i_msn < 0 || M3u8Has( p_sys, i_msn, i_part );
+    if( answer->i_body_offset == 0 )
+    {
+        if( i_msn > (int64_t)p_sys->p_last->i_sequence + 2 )
+        {
+            vlc_mutex_unlock( &p_sys->lock );
+            AnswerInit( answer, 400, NULL );
+            AnswerBody( answer, NULL, 0 );
+            return VLC_SUCCESS;
+        }
+
+        AnswerInit( answer, 200, "application/vnd.apple.mpegurl" );
+        httpd_MsgAdd( answer, "Cache-Control", "no-cache" );
+        if( !b_ready )
+        {
+            /* The offset holds the deadline of the request */
+            const vlc_tick_t i_target = p_sys->i_target > 0 ? p_sys->i_target
+                                                            : p_sys->i_seglen;
+            AnswerDefer( cl, answer, query, vlc_tick_now() + 3 * i_target );
+            vlc_mutex_unlock( &p_sys->lock );
+            return VLC_SUCCESS;
+        }
+    }
+    else if( !b_ready && vlc_tick_now() < answer->i_body_offset )
+    {
+        vlc_mutex_unlock( &p_sys->lock );
+        return VLC_SUCCESS; /* wait */
+    }
+
+    size_t i_size;
+    char *psz_m3u8 = M3u8( p_sys, &i_size );
+    vlc_mutex_unlock( &p_sys->lock );
+    if( unlikely(psz_m3u8 == NULL) )
+        return VLC_ENOMEM;
+
+    if( answer->i_body_offset == 0 )
+        AnswerBody( answer, (uint8_t *)psz_m3u8, i_size );
+    else
+        AnswerNext( answer, query, (uint8_t *)psz_m3u8, i_size, 0 );
+    return VLC_SUCCESS;
+}
+
+static void PrintTime( struct vlc_memstream *ms, int64_t i_ms )
+{
+    time_t t = i_ms / 1000;
+    struct tm tm;
+    char psz_date[32];
+
+    gmtime_r( &t, &tm );
+    strftime( psz_date, sizeof( psz_date ), "%Y-%m-%dT%H:%M:%S", &tm );
+    vlc_memstream_printf( ms, "%s.%03dZ", psz_date, (int)(i_ms % 1000) );
+}
+
+static char *Mpd( const sout_access_out_sys_t *p_sys, size_t *pi_size )
+{
+    struct vlc_memstream ms;
+    const vlc_tick_t i_target = p_sys->i_target > 0 ? p_sys->i_target
+                                                    : p_sys->i_seglen;
+    vlc_tick_t i_duration = 0;
+    size_t i_bytes = 0;
+
+    for( const packager_segment_t *p_segment = p_sys->p_first; p_segment;
+         p_segment = p_segment->p_next )
+        if( p_segment->b_complete )
+        {
+            i_duration += p_segment->i_end - p_segment->i_start;
+            i_bytes += p_segment->i_size;
+        }
+
+    struct timespec ts;
+    timespec_get( &ts, TIME_UTC );
+
+    if( vlc_memstream_open( &ms ) )
+        return NULL;
+
+    vlc_memstream_puts( &ms,
+        "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+        "<MPD xmlns=\"urn:mpeg:dash:schema:mpd:2011\" "
+        "profiles=\"urn:mpeg:dash:profile:isoff-live:2011\" type=\"dynamic\" "
+        "availabilityStartTime=\"" );
+    PrintTime( &ms, p_sys->i_origin_ms );
+    vlc_memstream_puts( &ms, "\" publishTime=\"" );
+    PrintTime( &ms, ts.tv_sec * INT64_C(1000) + ts.tv_nsec / 1000000 );
+    vlc_memstream_printf( &ms,
+        "\" minimumUpdatePeriod=\"PT%.3fS\" minBufferTime=\"PT%.3fS\" "
+        "timeShiftBufferDepth=\"PT%.3fS\" maxSegmentDuration=\"PT%.3fS\">\n"
+        " <Period id=\"0\" start=\"PT0S\">\n"
+        "  <AdaptationSet id=\"0\" mimeType=\"video/mp4\" "
+        "segmentAlignment=\"true\" startWithSAP=\"1\">\n"
+        "   <Representation id=\"0\" bandwidth=\"%"PRIu64"\">\n"
+        "    <SegmentTemplate timescale=\"1000\" initialization=\"init.mp4\" "
+        "media=\"seg-$Number$.m4s\" startNumber=\"%"PRIu64"\" "
+        "availabilityTimeOffset=\"%.3f\" availabilityTimeComplete=\"false\">\n"
+        "     <SegmentTimeline>\n",
+        secf_from_vlc_tick( i_target ),
+        secf_from_vlc_tick( 3 * p_sys->i_part_target ),
+        secf_from_vlc_tick( i_duration ), secf_from_vlc_tick( i_target ),
+        i_duration > 0 ? (uint64_t)i_bytes * 8 * CLOCK_FREQ / i_duration : 1,
+        p_sys->p_first->i_sequence,
+        secf_from_vlc_tick( i_target - p_sys->i_part_target ) );
+
+    for( const packager_segment_t *p_segment = p_sys->p_first; p_segment;
+         p_segment = p_segment->p_next )
+        if( p_segment->b_complete )
+            vlc_memstream_printf( &ms,
+                "      <S t=\"%"PRId64"\" d=\"%"PRId64"\"/>\n",
+                MS_FROM_VLC_TICK(p_segment->i_start - p_sys->i_origin),
+                MS_FROM_VLC_TICK(p_segment->i_end - p_segment->i_start) );
+
+    vlc_memstream_puts( &ms,
+        "     </SegmentTimeline>\n"
+        "    </SegmentTemplate>\n"
+        "   </Representation>\n"
+        "  </AdaptationSet>\n"
+        " </Period>\n"
+        " <UTCTiming schemeIdUri=\"urn:mpeg:dash:utc:direct:2014\" value=\"" );
+    PrintTime( &ms, ts.tv_sec * INT64_C(1000) + ts.tv_nsec / 1000000 );
+    vlc_memstream_puts( &ms, "\"/>\n</MPD>\n" );
+
+    if( vlc_memstream_close( &ms ) )
+        return NULL;
+    *pi_size = ms.length;
+    return ms.ptr;
+}
+
+static int MpdCallback( httpd_callback_sys_t *p_data, httpd_client_t *cl,
+                        httpd_message_t *answer, const httpd_message_t *query )
+{
+    sout_access_out_t *p_access = (sout_access_out_t *)p_data;
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+    VLC_UNUSED(cl);
+
+    if( answer == NULL || query == NULL )
+        return VLC_SUCCESS;
+
+    vlc_mutex_lock( &p_sys->lock );
+    if( p_sys->p_first == NULL || !p_sys->p_first->b_complete
+     || !p_sys->b_init_complete )
+    {
+        vlc_mutex_unlock( &p_sys->lock );
+        return VLC_EGENERIC; /* not found */
+    }
+
+    size_t i_size;
+    char *psz_mpd = Mpd( p_sys, &i_size );
+    vlc_mutex_unlock( &p_sys->lock );
+    if( unlikely(psz_mpd == NULL) )
+        return VLC_ENOMEM;
+
+    AnswerInit( answer, 200, "application/dash+xml" );
+    httpd_MsgAdd( answer, "Cache-Control", "no-cache" );
+    AnswerBody( answer, (uint8_t *)psz_mpd, i_size );
+    return VLC_SUCCESS;
+}
@@ -35,6 +35,7 @@
 #include <unistd.h>
 #include <assert.h>
 #include <errno.h>
+#include <stdatomic.h>
 
 #include <vlc_queue.h>
 #include <vlc_sout.h>
@@ -46,11 +47,26 @@
 #elif defined (HAVE_SYS_SOCKET_H)
 #   include <sys/socket.h>
 #endif
+#ifdef __linux__
+#   include <netinet/udp.h>
+#   include <linux/net_tstamp.h>
+#endif
 
 #include <vlc_network.h>
 
 #define MAX_EMPTY_BLOCKS 200
 
+/* Datagrams sent later than this after their date are late */
+#define LATE_DELAY VLC_TICK_FROM_MS(20)
+
+#ifdef HAVE_SENDMMSG
+# define BATCH_MAX 64
+/* Datagrams are given to the kernel this long before their date */
+# define TXTIME_HORIZON VLC_TICK_FROM_MS(20)
+# define GSO_MAX_SEGMENTS 64
+# define GSO_MAX_SIZE 61440
+#endif
+
 /*****************************************************************************
  * Module descriptor
  *****************************************************************************/
@@ -71,6 +87,22 @@ static void Close( vlc_object_t * );
                           "helps reducing the scheduling load on " \
                           "heavily-loaded systems." )
 
+#define BATCH_TEXT N_("Datagrams per system call")
+#define BATCH_LONGTEXT N_("Sends up to this number of datagrams at once, " \
+                          "in a single system call, where supported.")
+
+#define GSO_TEXT N_("UDP segmentation offload")
+#define GSO_LONGTEXT N_("Hands consecutive datagrams of the same size to " \
+                        "the kernel as a single buffer (UDP GSO), where " \
+                        "supported. Only used when sending several " \
+                        "datagrams per system call.")
+
+#define TXTIME_TEXT N_("Kernel pacing")
+#define TXTIME_LONGTEXT N_("Gives the datagrams to the kernel ahead of " \
+                           "time, with their send time (SO_TXTIME), " \
+                           "instead of waiting for it. This requires the " \
+                           "fq packet scheduler on the output interface.")
+
 vlc_module_begin ()
     set_description( N_("UDP stream output") )
     set_shortname( "UDP" )
@@ -79,6 +111,11 @@ vlc_module_begin ()
     add_integer( SOUT_CFG_PREFIX "caching", DEFAULT_PTS_DELAY / 1000, CACHING_TEXT, CACHING_LONGTEXT, true )
     add_integer( SOUT_CFG_PREFIX "group", 1, GROUP_TEXT, GROUP_LONGTEXT,
                                  true )
+    add_integer_with_range( SOUT_CFG_PREFIX "batch", 1, 1, 64,
+                            BATCH_TEXT, BATCH_LONGTEXT, true )
+    add_bool( SOUT_CFG_PREFIX "gso", false, GSO_TEXT, GSO_LONGTEXT, true )
+    add_bool( SOUT_CFG_PREFIX "txtime", false, TXTIME_TEXT, TXTIME_LONGTEXT,
+              true )
 
     set_capability( "sout access", 0 )
     add_shortcut( "udp" )
@@ -92,6 +129,9 @@ vlc_module_end ()
 static const char *const ppsz_sout_options[] = {
     "caching",
     "group",
+    "batch",
+    "gso",
+    "txtime",
     NULL
 };
 
@@ -107,6 +147,9 @@ static ssize_t Write   ( sout_access_out_t *, block_t * );
 static int Control( sout_access_out_t *, int, va_list );
 
 static void* ThreadWrite( void * );
+#ifdef HAVE_SENDMMSG
+static void* ThreadWriteBatch( void * );
+#endif
 
 typedef struct
 {
@@ -120,6 +163,16 @@ typedef struct
     block_t      *p_buffer;
 
     vlc_thread_t  thread;
+
+    unsigned      i_batch;
+    bool          b_gso;
+    bool          b_txtime;
+
+    /* Counters, written by the thread */
+    atomic_uintmax_t datagrams;
+    atomic_uintmax_t syscalls;
+    atomic_uintmax_t late;
+    atomic_uintmax_t dropped;
 } sout_access_out_sys_t;
 
 #define DEFAULT_PORT 1234
@@ -211,8 +264,65 @@ static int Open( vlc_object_t *p_this )
     p_sys->dead = false;
     vlc_queue_Init(&p_sys->queue, offsetof (block_t, p_next));
     p_sys->p_buffer = NULL;
+    atomic_init( &p_sys->datagrams, 0 );
+    atomic_init( &p_sys->syscalls, 0 );
+    atomic_init( &p_sys->late, 0 );
+    atomic_init( &p_sys->dropped, 0 );
+
+    void *(*entry)( void * ) = ThreadWrite;
+
+    p_sys->i_batch = var_GetInteger( p_access, SOUT_CFG_PREFIX "batch" );
+    p_sys->b_gso = var_GetBool( p_access, SOUT_CFG_PREFIX "gso" );
+    p_sys->b_txtime = var_GetBool( p_access, SOUT_CFG_PREFIX "txtime" );
+#ifdef HAVE_SENDMMSG
+    p_sys->i_batch = VLC_CLIP( p_sys->i_batch, 1, BATCH_MAX );
+# ifdef UDP_SEGMENT
+    if( p_sys->b_gso && p_sys->i_batch > 1 )
+    {
+        /* Probe the support, the size is set per system call */
+        int size = 0;
+        if( setsockopt( i_handle, SOL_UDP, UDP_SEGMENT,
+                        &size, sizeof (size) ) )
+        {
+            msg_Warn( p_access, "UDP segmentation offload not supported: %s",
+                      vlc_strerror_c(errno) );
+            p_sys->b_gso = false;
+        }
+    }
+    else
+# endif
+        p_sys->b_gso = false;
+# ifdef SO_TXTIME
+    if( p_sys->b_txtime )
+    {
+        /* vlc_tick_now() is based on the monotonic clock */
+        const struct sock_txtime cfg = { .clockid = CLOCK_MONOTONIC };
+        if( setsockopt( i_handle, SOL_SOCKET, SO_TXTIME,
+                        &cfg, sizeof (cfg) ) )
+        {
+            msg_Warn( p_access, "kernel pacing not supported: %s",
+                      vlc_strerror_c(errno) );
+            p_sys->b_txtime = false;
+        }
+    }
+# else
+    p_sys->b_txtime = false;
+# endif
+    if( p_sys->i_batch > 1 || p_sys->b_txtime )
+    {
+        msg_Dbg( p_access, "sending up to %u datagrams at once%s%s",
+                 p_sys->i_batch, p_sys->b_gso ? ", with GSO" : "",
+                 p_sys->b_txtime ? ", paced by the kernel" : "" );
+        entry = ThreadWriteBatch;
+    }
+#else
+    if( p_sys->i_batch > 1 || p_sys->b_gso || p_sys->b_txtime )
+        msg_Warn( p_access, "batched sending not supported" );
+    p_sys->i_batch = 1;
+    p_sys->b_gso = p_sys->b_txtime = false;
+#endif
 
-    if( vlc_clone( &p_sys->thread, ThreadWrite, p_access,
+    if( vlc_clone( &p_sys->thread, entry, p_access,
                            VLC_THREAD_PRIORITY_HIGHEST ) )
     {
         msg_Err( p_access, "cannot spawn sout access thread" );
@@ -246,7 +356,7 @@ static void Close( vlc_object_t * p_this )
 
 static int Control( sout_access_out_t *p_access, int i_query, va_list args )
 {
-    (void)p_access;
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
 
     switch( i_query )
     {
@@ -254,6 +364,22 @@ static int Control( sout_access_out_t *p_access, int i_query, va_list args )
             *va_arg( args, bool * ) = false;
             break;
 
+        case ACCESS_OUT_GET_DATAGRAM_STATS:
+        {
+            struct sout_datagram_stats *stats =
+                va_arg( args, struct sout_datagram_stats * );
+
+            stats->datagrams = atomic_load_explicit( &p_sys->datagrams,
+                                                     memory_order_relaxed );
+            stats->syscalls = atomic_load_explicit( &p_sys->syscalls,
+                                                    memory_order_relaxed );
+            stats->late = atomic_load_explicit( &p_sys->late,
+                                                memory_order_relaxed );
+            stats->dropped = atomic_load_explicit( &p_sys->dropped,
+                                                   memory_order_relaxed );
+            break;
+        }
+
         default:
             return VLC_EGENERIC;
     }
@@ -346,6 +472,11 @@ static ssize_t Write( sout_access_out_t *p_access, block_t *p_buffer )
     return i_len;
 }
 
+static void Count( atomic_uintmax_t *counter, uintmax_t n )
+{
+    atomic_fetch_add_explicit( counter, n, memory_order_relaxed );
+}
+
 /*****************************************************************************
  * ThreadWrite: Write a packet on the network at the good time.
  *****************************************************************************/
@@ -378,6 +509,7 @@ static void* ThreadWrite( void *data )
 
                 i_date_last = i_date;
                 i_dropped_packets++;
+                Count( &p_sys->dropped, 1 );
                 continue;
             }
             else if( i_date - i_date_last < VLC_TICK_FROM_MS(-1) )
@@ -394,8 +526,14 @@ static void* ThreadWrite( void *data )
             vlc_tick_wait( i_date );
             i_to_send = i_group;
         }
+        Count( &p_sys->syscalls, 1 );
         if ( send( p_sys->i_handle, p_pk->p_buffer, p_pk->i_buffer, 0 ) == -1 )
+        {
             msg_Warn( p_access, "send error: %s", vlc_strerror_c(errno) );
+            Count( &p_sys->dropped, 1 );
+        }
+        else
+            Count( &p_sys->datagrams, 1 );
 
         if( i_dropped_packets )
         {
@@ -407,8 +545,9 @@ static void* ThreadWrite( void *data )
 
 #if 1
         i_date = vlc_tick_now() - i_date;
-        if ( i_date > VLC_TICK_FROM_MS(20) )
+        if ( i_date > LATE_DELAY )
         {
+            Count( &p_sys->late, 1 );
             msg_Dbg( p_access, "packet has been sent too late (%"PRId64 ")",
                      i_date );
         }
@@ -419,3 +558,249 @@ static void* ThreadWrite( void *data )
     }
     return NULL;
 }
+
+#ifdef HAVE_SENDMMSG
+typedef struct
+{
+    struct mmsghdr msgs[BATCH_MAX];
+    struct iovec   iov[BATCH_MAX];
+    union
+    {
+        char buf[CMSG_SPACE(sizeof (uint64_t))
+                 + CMSG_SPACE(sizeof (uint16_t))];
+        struct cmsghdr align;
+    } control[BATCH_MAX];
+    unsigned       segments[BATCH_MAX];
+    block_t       *blocks[BATCH_MAX];
+    vlc_tick_t     dates[BATCH_MAX];
+    unsigned       count;
+} udp_batch_t;
+
+/*****************************************************************************
+ * BuildMessage: Put the datagrams from first in the message m.
+ *****************************************************************************
+ * With GSO, the following datagrams of the same size, but the last one which
+ * can be shorter, go in the same message. With SO_TXTIME, they must also be
+ * sent at the same time.
+ *****************************************************************************/
+static unsigned BuildMessage( sout_access_out_sys_t *p_sys, udp_batch_t *b,
+                              unsigned first, unsigned m )
+{
+    struct msghdr *hdr = &b->msgs[m].msg_hdr;
+    const size_t i_size = b->blocks[first]->i_buffer;
+    size_t i_total = i_size;
+    unsigned i_segs = 1;
+
+    while( p_sys->b_gso && first + i_segs < b->count
+        && i_segs < GSO_MAX_SEGMENTS )
+    {
+        const size_t i_next = b->blocks[first + i_segs]->i_buffer;
+
+        if( i_next > i_size || i_total + i_next > GSO_MAX_SIZE
+         || (p_sys->b_txtime && b->dates[first + i_segs] != b->dates[first]) )
+            break;
+        i_total += i_next;
+        i_segs++;
+        if( i_next < i_size )
+            break;
+    }
+
+    memset( hdr, 0, sizeof (*hdr) );
+    hdr->msg_iov = b->iov + first;
+    hdr->msg_iovlen = i_segs;
+    hdr->msg_control = b->control[m].buf;
+    hdr->msg_controllen = sizeof (b->control[m].buf);
+    memset( b->control[m].buf, 0, sizeof (b->control[m].buf) );
+
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR( hdr );
+    size_t i_control = 0;
+
+#ifdef SO_TXTIME
+    if( p_sys->b_txtime )
+    {
+        const uint64_t txtime = NS_FROM_VLC_TICK( b->dates[first] );
+
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_TXTIME;
+        cmsg->cmsg_len = CMSG_LEN( sizeof (txtime) );
+        memcpy( CMSG_DATA( cmsg ), &txtime, sizeof (txtime) );
+        i_control += CMSG_SPACE( sizeof (txtime) );
+        cmsg = CMSG_NXTHDR( hdr, cmsg );
+    }
+#endif
+#ifdef UDP_SEGMENT
+    if( i_segs > 1 )
+    {
+        const uint16_t gso = i_size;
+
+        cmsg->cmsg_level = SOL_UDP;
+        cmsg->cmsg_type = UDP_SEGMENT;
+        cmsg->cmsg_len = CMSG_LEN( sizeof (gso) );
+        memcpy( CMSG_DATA( cmsg ), &gso, sizeof (gso) );
+        i_control += CMSG_SPACE( sizeof (gso) );
+    }
+#endif
+    hdr->msg_controllen = i_control;
+    if( i_control == 0 )
+        hdr->msg_control = NULL;
+
+    b->segments[m] = i_segs;
+    return i_segs;
+}
+
+/*****************************************************************************
+ * SendBatch: Send the datagrams of a batch, with as few calls as possible.
+ *****************************************************************************/
+static void SendBatch( sout_access_out_t *p_access, udp_batch_t *b )
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+    const vlc_tick_t now = vlc_tick_now();
+    unsigned i_late = 0;
+
+    for( unsigned i = 0; i < b->count; i++ )
+    {
+        b->iov[i].iov_base = b->blocks[i]->p_buffer;
+        b->iov[i].iov_len = b->blocks[i]->i_buffer;
+        if( now - b->dates[i] > LATE_DELAY )
+            i_late++;
+    }
+    if( i_late > 0 )
+    {
+        msg_Dbg( p_access, "%u packets sent too late (%"PRId64 ")",
+                 i_late, now - b->dates[0] );
+        Count( &p_sys->late, i_late );
+    }
+
+    for( unsigned i = 0; i < b->count; )
+    {
+        unsigned i_msgs = 0;
+
+        for( unsigned j = i; j < b->count; i_msgs++ )
+            j += BuildMessage( p_sys, b, j, i_msgs );
+
+        int i_sent = sendmmsg( p_sys->i_handle, b->msgs, i_msgs, 0 );
+        Count( &p_sys->syscalls, 1 );
+
+        if( i_sent < 0 )
+        {
+            if( errno == EINTR )
+                continue;
+            if( p_sys->b_gso && (errno == EIO || errno == EINVAL) )
+            {
+                msg_Warn( p_access, "UDP segmentation offload failed: %s",
+                          vlc_strerror_c(errno) );
+                p_sys->b_gso = false;
+                continue;
+            }
+            msg_Warn( p_access, "send error: %s", vlc_strerror_c(errno) );
+            /* Skip the first message */
+            Count( &p_sys->dropped, b->segments[0] );
+            i += b->segments[0];
+            continue;
+        }
+
+        unsigned i_datagrams = 0;
+        for( int m = 0; m < i_sent; m++ )
+            i_datagrams += b->segments[m];
+        Count( &p_sys->datagrams, i_datagrams );
+        i += i_datagrams;
+    }
+
+    for( unsigned i = 0; i < b->count; i++ )
+        block_Release( b->blocks[i] );
+    b->count = 0;
+}
+
+/*****************************************************************************
+ * ThreadWriteBatch: Write packets on the network by batches.
+ *****************************************************************************
+ * Without kernel pacing, a batch ends with a packet carrying a PCR, and is
+ * sent at the time of its last packet, as groups are. With kernel pacing,
+ * a batch holds the packets to send before the horizon, each with its
+ * time, and the thread only waits when there are none.
+ *****************************************************************************/
+static void* ThreadWriteBatch( void *data )
+{
+    sout_access_out_t *p_access = data;
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+    udp_batch_t batch = { .count = 0 };
+    block_t *p_pending = NULL, **pp_pending_last = &p_pending;
+    vlc_tick_t i_date_last = VLC_TICK_INVALID;
+    unsigned i_dropped_packets = 0;
+
+    for( ;; )
+    {
+        /* Take all the queued packets, wait if there are none */
+        vlc_queue_Lock( &p_sys->queue );
+        while( p_pending == NULL && vlc_queue_IsEmpty( &p_sys->queue )
+            && !p_sys->dead )
+            vlc_queue_Wait( &p_sys->queue );
+        block_t *p_queued = vlc_queue_DequeueAllUnlocked( &p_sys->queue );
+        vlc_queue_Unlock( &p_sys->queue );
+
+        if( p_queued != NULL )
+            block_ChainLastAppend( &pp_pending_last, p_queued );
+
+        if( p_pending == NULL )
+            break;
+
+        const vlc_tick_t now = vlc_tick_now();
+
+        while( p_pending != NULL && batch.count < p_sys->i_batch )
+        {
+            block_t *p_pk = p_pending;
+            const vlc_tick_t i_date = p_sys->i_caching + p_pk->i_dts;
+
+            if( p_sys->b_txtime && i_date > now + TXTIME_HORIZON )
+                break;
+
+            p_pending = p_pk->p_next;
+            if( p_pending == NULL )
+                pp_pending_last = &p_pending;
+            p_pk->p_next = NULL;
+
+            if( i_date_last != VLC_TICK_INVALID
+             && i_date - i_date_last > VLC_TICK_FROM_SEC(2) )
+            {
+                if( !i_dropped_packets )
+                    msg_Dbg( p_access, "mmh, hole (%"PRId64" > 2s) -> drop",
+                             i_date - i_date_last );
+                block_Release( p_pk );
+                i_date_last = i_date;
+                i_dropped_packets++;
+                Count( &p_sys->dropped, 1 );
+                continue;
+            }
+            i_date_last = i_date;
+
+            batch.blocks[batch.count] = p_pk;
+            batch.dates[batch.count] = i_date;
+            batch.count++;
+
+            if( !p_sys->b_txtime && (p_pk->i_flags & BLOCK_FLAG_CLOCK) )
+                break;
+        }
+
+        if( batch.count == 0 )
+        {
+            /* Too early to hand the next packet to the kernel: wait for
+             * half the horizon worth of packets to be due */
+            if( p_pending != NULL )
+                vlc_tick_wait( p_sys->i_caching + p_pending->i_dts
+                               - TXTIME_HORIZON / 2 );
+            continue;
+        }
+
+        if( i_dropped_packets )
+        {
+            msg_Dbg( p_access, "dropped %i packets", i_dropped_packets );
+            i_dropped_packets = 0;
+        }
+
+        if( !p_sys->b_txtime )
+            vlc_tick_wait( batch.dates[batch.count - 1] );
+        SendBatch( p_access, &batch );
+    }
+    return NULL;
+}
+#endif
@@ -0,0 +1,501 @@
+/*****************************************************************************
+ * convolver.c : uniformly partitioned FFT convolution
+ *****************************************************************************
+ * Copyright (C) 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <assert.h>
+#include <math.h>
+
+#include <vlc_common.h>
+#include <vlc_cpu.h>
+
+#include "convolver.h"
+
+/*
+ * The spectra are those of real signals of 2 * block samples, so only
+ * block + 1 bins are kept. Such a transform is computed with a complex
+ * transform of block points, on the even samples as real parts and the odd
+ * samples as imaginary parts.
+ */
+struct conv_engine
+{
+    unsigned inputs;
+    unsigned outputs;
+    unsigned block;
+    unsigned parts;
+    unsigned head;
+    size_t bins;            /* block + 1 rounded up to CONV_BINS_ALIGN */
+    conv_muladd_t muladd;
+
+    float *twiddle;         /* exp(-2 pi i k / block), k < block / 2 */
+    float *rtwiddle;        /* exp(-pi i k / block), k <= block */
+    unsigned *bitrev;
+
+    float *filters;         /* spectra of the partitions of the responses */
+    float *fdl;             /* spectra of the last parts blocks per input */
+    float *time;            /* last 2 * block samples per input */
+    float *acc;             /* per output accumulated spectrum */
+    float *tail;            /* per output spectrum of the tail */
+    float *work;            /* 2 * block samples */
+    unsigned slot;          /* slot of the current block in the fdl */
+
+    bool threaded;
+    bool quit;
+    unsigned tail_slot;
+    vlc_sem_t start;
+    vlc_sem_t done;
+    vlc_thread_t thread;
+};
+
+void conv_MulAdd_C(float *restrict acc_re, float *restrict acc_im,
+                   const float *x_re, const float *x_im,
+                   const float *h_re, const float *h_im, size_t bins)
+{
+    for (size_t k = 0; k < bins; k++)
+    {
+        acc_re[k] += x_re[k] * h_re[k] - x_im[k] * h_im[k];
+        acc_im[k] += x_re[k] * h_im[k] + x_im[k] * h_re[k];
+    }
+}
+
+#ifdef HAVE_SSE2_INTRINSICS
+# include <emmintrin.h>
+
+__attribute__ ((__target__ ("sse2")))
+static void MulAddSSE2(float *restrict acc_re, float *restrict acc_im,
+                       const float *x_re, const float *x_im,
+                       const float *h_re, const float *h_im, size_t bins)
+{
+    for (size_t k = 0; k < bins; k += 4)
+    {
+        const __m128 xr = _mm_load_ps(x_re + k), xi = _mm_load_ps(x_im + k);
+        const __m128 hr = _mm_load_ps(h_re + k), hi = _mm_load_ps(h_im + k);
+        const __m128 re = _mm_sub_ps(_mm_mul_ps(xr, hr), _mm_mul_ps(xi, hi));
+        const __m128 im = _mm_add_ps(_mm_mul_ps(xr, hi), _mm_mul_ps(xi, hr));
+
+        _mm_store_ps(acc_re + k, _mm_add_ps(_mm_load_ps(acc_re + k), re));
+        _mm_store_ps(acc_im + k, _mm_add_ps(_mm_load_ps(acc_im + k), im));
+    }
+}
+#endif
+
+#ifdef HAVE_AVX2_INTRINSICS
+# include <immintrin.h>
+
+__attribute__ ((__target__ ("avx2")))
+static void MulAddAVX2(float *restrict acc_re, float *restrict acc_im,
+                       const float *x_re, const float *x_im,
+                       const float *h_re, const float *h_im, size_t bins)
+{
+    for (size_t k = 0; k < bins; k += 8)
+    {
+        const __m256 xr = _mm256_load_ps(x_re + k);
+        const __m256 xi = _mm256_load_ps(x_im + k);
+        const __m256 hr = _mm256_load_ps(h_re + k);
+        const __m256 hi = _mm256_load_ps(h_im + k);
+        const __m256 re = _mm256_sub_ps(_mm256_mul_ps(xr, hr),
+                                        _mm256_mul_ps(xi, hi));
+        const __m256 im = _mm256_add_ps(_mm256_mul_ps(xr, hi),
+                                        _mm256_mul_ps(xi, hr));
+
+        _mm256_store_ps(acc_re + k,
+                        _mm256_add_ps(_mm256_load_ps(acc_re + k), re));
+        _mm256_store_ps(acc_im + k,
+                        _mm256_add_ps(_mm256_load_ps(acc_im + k), im));
+    }
+}
+#endif
+
+#ifdef __ARM_NEON
+# include <arm_neon.h>
+
+static void MulAddNEON(float *restrict acc_re, float *restrict acc_im,
+                       const float *x_re, const float *x_im,
+                       const float *h_re, const float *h_im, size_t bins)
+{
+    for (size_t k = 0; k < bins; k += 4)
+    {
+        const float32x4_t xr = vld1q_f32(x_re + k), xi = vld1q_f32(x_im + k);
+        const float32x4_t hr = vld1q_f32(h_re + k), hi = vld1q_f32(h_im + k);
+        const float32x4_t re = vsubq_f32(vmulq_f32(xr, hr),
+                                         vmulq_f32(xi, hi));
+        const float32x4_t im = vaddq_f32(vmulq_f32(xr, hi),
+                                         vmulq_f32(xi, hr));
+
+        vst1q_f32(acc_re + k, vaddq_f32(vld1q_f32(acc_re + k), re));
+        vst1q_f32(acc_im + k, vaddq_f32(vld1q_f32(acc_im + k), im));
+    }
+}
+#endif
+
+conv_muladd_t conv_GetMulAdd(void)
+{
+#ifdef HAVE_AVX2_INTRINSICS
+    if (vlc_CPU_AVX2())
+        return MulAddAVX2;
+#endif
+#ifdef HAVE_SSE2_INTRINSICS
+    if (vlc_CPU_SSE2())
+        return MulAddSSE2;
+#endif
+#ifdef __ARM_NEON
+    if (vlc_CPU_ARM_NEON())
+        return MulAddNEON;
+#endif
+    return conv_MulAdd_C;
+}
+
+/* In place radix-2 complex FFT of block interleaved points, not scaled */
+static void FFT(const conv_engine_t *e, float *z, bool inverse)
+{
+    const unsigned n = e->block;
+
+    for (unsigned i = 0; i < n; i++)
+    {
+        const unsigned j = e->bitrev[i];
+
+        if (i < j)
+        {
+            float re = z[2 * i], im = z[2 * i + 1];
+            z[2 * i] = z[2 * j];
+            z[2 * i + 1] = z[2 * j + 1];
+            z[2 * j] = re;
+            z[2 * j + 1] = im;
+        }
+    }
+
+    for (unsigned half = 1, step = n / 2; half < n; half *= 2, step /= 2)
+        for (unsigned k = 0; k < half; k++)
+        {
+            const float wr = e->twiddle[2 * k * step];
+            const float wi = inverse ? -e->twiddle[2 * k * step + 1]
+                                     : e->twiddle[2 * k * step + 1];
+
+            for (unsigned i = k; i < n; i += 2 * half)
+            {
+                float *a = z + 2 * i, *b = z + 2 * (i + half);
+                const float tr = b[0] * wr - b[1] * wi;
+                const float ti = b[0] * wi + b[1] * wr;
+
+                b[0] = a[0] - tr;
+                b[1] = a[1] - ti;
+                a[0] += tr;
+                a[1] += ti;
+            }
+        }
+}
+
+/* Spectrum of the 2 * block real samples of e->work, scaled */
+static void RealFFT(const conv_engine_t *e, float *re, float *im,
+                    float scale)
+{
+    const unsigned n = e->block;
+    float *z = e->work;
+
+    FFT(e, z, false);
+
+    for (unsigned k = 0; k < n; k++)
+    {
+        const unsigned j = (n - k) % n;
+        const float zr = z[2 * k], zi = z[2 * k + 1];
+        const float cr = z[2 * j], ci = -z[2 * j + 1];
+        /* Spectra of the even and of the odd samples */
+        const float er = .5f * (zr + cr), ei = .5f * (zi + ci);
+        const float o_re = .5f * (zi - ci), o_im = -.5f * (zr - cr);
+        const float wr = e->rtwiddle[2 * k], wi = e->rtwiddle[2 * k + 1];
+
+        re[k] = scale * (er + o_re * wr - o_im * wi);
+        im[k] = scale * (ei + o_re * wi + o_im * wr);
+    }
+    re[n] = scale * (z[0] - z[1]);
+    im[n] = 0.f;
+    im[0] = 0.f;
+    for (size_t k = n + 1; k < e->bins; k++)
+        re[k] = im[k] = 0.f;
+}
+
+/* 2 * block real samples in e->work from a spectrum, scaled by block */
+static void RealIFFT(const conv_engine_t *e, const float *re,
+                     const float *im)
+{
+    const unsigned n = e->block;
+    float *z = e->work;
+
+    for (unsigned k = 0; k < n; k++)
+    {
+        const float xr = re[k], xi = im[k];
+        const float cr = re[n - k], ci = -im[n - k];
+        const float er = .5f * (xr + cr), ei = .5f * (xi + ci);
+        const float dr = .5f * (xr - cr), di = .5f * (xi - ci);
+        /* Times the conjugated twiddle */
+        const float wr = e->rtwiddle[2 * k], wi = -e->rtwiddle[2 * k + 1];
+        const float o_re = dr * wr - di * wi, o_im = dr * wi + di * wr;
+
+        z[2 * k] = er - o_im;
+        z[2 * k + 1] = ei + o_re;
+    }
+
+    FFT(e, z, true);
+}
+
+static float *Spectrum(float *base, size_t index, size_t bins)
+{
+    return base + 2 * bins * index;
+}
+
+static float *Filter(const conv_engine_t *e, unsigned i, unsigned o,
+                     unsigned p)
+{
+    return Spectrum(e->filters, ((size_t)i * e->outputs + o) * e->parts + p,
+                    e->bins);
+}
+
+static float *Delayed(const conv_engine_t *e, unsigned i, unsigned slot)
+{
+    return Spectrum(e->fdl, (size_t)i * e->parts + slot, e->bins);
+}
+
+/* Accumulates the partitions [from, to) for the block of a slot */
+static void Accumulate(const conv_engine_t *e, float *acc, unsigned slot,
+                       unsigned from, unsigned to)
+{
+    const size_t bins = e->bins;
+
+    for (unsigned o = 0; o < e->outputs; o++)
+    {
+        float *re = Spectrum(acc, o, bins), *im = re + bins;
+
+        memset(re, 0, 2 * bins * sizeof (float));
+        for (unsigned i = 0; i < e->inputs; i++)
+            for (unsigned p = from; p < to; p++)
+            {
+                const float *x = Delayed(e, i, (slot + e->parts - p)
+                                               % e->parts);
+                const float *h = Filter(e, i, o, p);
+
+                e->muladd(re, im, x, x + bins, h, h + bins, bins);
+            }
+    }
+}
+
+static void *Worker(void *data)
+{
+    conv_engine_t *e = data;
+
+    for (;;)
+    {
+        vlc_sem_wait(&e->start);
+        if (e->quit)
+            break;
+        Accumulate(e, e->tail, e->tail_slot, e->head, e->parts);
+        vlc_sem_post(&e->done);
+    }
+    return NULL;
+}
+
+static void *AllocSpectra(size_t count, size_t bins)
+{
+    float *p = aligned_alloc(64, count * 2 * bins * sizeof (float));
+
+    if (likely(p != NULL))
+        memset(p, 0, count * 2 * bins * sizeof (float));
+    return p;
+}
+
+conv_engine_t *conv_New(unsigned inputs, unsigned outputs, unsigned block,
+                        const float *ir, size_t length, unsigned head,
+                        bool threaded)
+{
+    if (inputs == 0 || outputs == 0 || block < 16 || block > 16384
+     || (block & (block - 1)) != 0 || length == 0)
+        return NULL;
+
+    conv_engine_t *e = calloc(1, sizeof (*e));
+    if (unlikely(e == NULL))
+        return NULL;
+
+    e->inputs = inputs;
+    e->outputs = outputs;
+    e->block = block;
+    e->parts = (length + block - 1) / block;
+    e->head = head < 1 ? 1 : head > e->parts ? e->parts : head;
+    e->bins = (block + CONV_BINS_ALIGN) & ~(size_t)(CONV_BINS_ALIGN - 1);
+    e->muladd = conv_GetMulAdd();
+
+    e->twiddle = vlc_alloc(block, sizeof (float));
+    e->rtwiddle = vlc_alloc(2 * (block + 1), sizeof (float));
+    e->bitrev = vlc_alloc(block, sizeof (unsigned));
+    e->filters = AllocSpectra((size_t)inputs * outputs * e->parts, e->bins);
+    e->fdl = AllocSpectra((size_t)inputs * e->parts, e->bins);
+    e->acc = AllocSpectra(outputs, e->bins);
+    e->tail = AllocSpectra(outputs, e->bins);
+    e->time = vlc_alloc((size_t)inputs * 2 * block, sizeof (float));
+    e->work = aligned_alloc(64, 2 * block * sizeof (float));
+    if (unlikely(e->twiddle == NULL || e->rtwiddle == NULL
+              || e->bitrev == NULL || e->filters == NULL || e->fdl == NULL
+              || e->acc == NULL || e->tail == NULL || e->time == NULL
+              || e->work == NULL))
+        goto error;
+
+    for (unsigned k = 0; k < block / 2; k++)
+    {
+        e->twiddle[2 * k] = cos(2. * M_PI * k / block);
+        e->twiddle[2 * k + 1] = -sin(2. * M_PI * k / block);
+    }
+    for (unsigned k = 0; k <= block; k++)
+    {
+        e->rtwiddle[2 * k] = cos(M_PI * k / block);
+        e->rtwiddle[2 * k + 1] = -sin(M_PI * k / block);
+    }
+    for (unsigned i = 0, bits = vlc_ctz(block); i < block; i++)
+    {
+        unsigned r = 0;
+
+        for (unsigned b = 0; b < bits; b++)
+            r |= ((i >> b) & 1) << (bits - 1 - b);
+        e->bitrev[i] = r;
+    }
+
+    /* The inverse transform is scaled by block */
+    for (unsigned i = 0; i < inputs; i++)
+        for (unsigned o = 0; o < outputs; o++)
+        {
+            const float *h = ir + ((size_t)i * outputs + o) * length;
+
+            for (unsigned p = 0; p < e->parts; p++)
+            {
+                const size_t off = (size_t)p * block;
+                const size_t taps = length - off < block ? length - off
+                                                         : block;
+                float *spectrum = Filter(e, i, o, p);
+
+                memcpy(e->work, h + off, taps * sizeof (float));
+                memset(e->work + taps, 0,
+                       (2 * block - taps) * sizeof (float));
+                RealFFT(e, spectrum, spectrum + e->bins, 1.f / block);
+            }
+        }
+
+    memset(e->time, 0, (size_t)inputs * 2 * block * sizeof (float));
+
+    e->threaded = threaded && e->head < e->parts;
+    if (e->threaded)
+    {
+        vlc_sem_init(&e->start, 0);
+        /* The tail of the first block is silent */
+        vlc_sem_init(&e->done, 1);
+        if (vlc_clone(&e->thread, Worker, e, VLC_THREAD_PRIORITY_AUDIO))
+            goto error;
+    }
+    return e;
+
+error:
+    e->threaded = false;
+    conv_Delete(e);
+    return NULL;
+}
+
+void conv_Delete(conv_engine_t *e)
+{
+    if (e->threaded)
+    {
+        vlc_sem_wait(&e->done);
+        e->quit = true;
+        vlc_sem_post(&e->start);
+        vlc_join(e->thread, NULL);
+    }
+    aligned_free(e->work);
+    free(e->time);
+    aligned_free(e->tail);
+    aligned_free(e->acc);
+    aligned_free(e->fdl);
+    aligned_free(e->filters);
+    free(e->bitrev);
+    free(e->rtwiddle);
+    free(e->twiddle);
+    free(e);
+}
+
+void conv_Process(conv_engine_t *e, const float *in, float *out)
+{
+    const unsigned n = e->block;
+    const size_t bins = e->bins;
+
+    for (unsigned i = 0; i < e->inputs; i++)
+    {
+        float *time = e->time + (size_t)i * 2 * n;
+        float *x = Delayed(e, i, e->slot);
+
+        memcpy(time, time + n, n * sizeof (float));
+        for (unsigned k = 0; k < n; k++)
+            time[n + k] = in[(size_t)k * e->inputs + i];
+        memcpy(e->work, time, 2 * n * sizeof (float));
+        RealFFT(e, x, x + bins, 1.f);
+    }
+
+    /* The tail only depends on the past blocks */
+    if (e->threaded)
+        vlc_sem_wait(&e->done);
+    else
+        Accumulate(e, e->tail, e->slot, e->head, e->parts);
+
+    Accumulate(e, e->acc, e->slot, 0, e->head);
+    for (size_t k = 0; k < e->outputs * 2 * bins; k++)
+        e->acc[k] += e->tail[k];
+
+    if (e->threaded)
+    {
+        e->tail_slot = (e->slot + 1) % e->parts;
+        vlc_sem_post(&e->start);
+    }
+
+    for (unsigned o = 0; o < e->outputs; o++)
+    {
+        const float *re = Spectrum(e->acc, o, bins);
+
+        RealIFFT(e, re, re + bins);
+        for (unsigned k = 0; k < n; k++)
+            out[(size_t)k * e->outputs + o] = e->work[n + k];
+    }
+
+    e->slot = (e->slot + 1) % e->parts;
+}
+
+void conv_Reset(conv_engine_t *e)
+{
+    if (e->threaded)
+        vlc_sem_wait(&e->done);
+
+    memset(e->fdl, 0, (size_t)e->inputs * e->parts * 2 * e->bins
+                      * sizeof (float));
+    memset(e->tail, 0, (size_t)e->outputs * 2 * e->bins * sizeof (float));
+    memset(e->time, 0, (size_t)e->inputs * 2 * e->block * sizeof (float));
+    e->slot = 0;
+
+    if (e->threaded)
+        vlc_sem_post(&e->done);
+}
+
+unsigned conv_Partitions(const conv_engine_t *e)
+{
+    return e->parts;
+}
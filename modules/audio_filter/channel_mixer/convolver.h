@@ -0,0 +1,97 @@
+/*****************************************************************************
+ * convolver.h : uniformly partitioned FFT convolution
+ *****************************************************************************
+ * Copyright (C) 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_CONVOLVER_H
+#define VLC_CONVOLVER_H 1
+
+/**
+ * \file
+ * Convolves several input channels with a matrix of impulse responses,
+ * output channel o being the sum over the input channels i of input i
+ * convolved with the response (i, o).
+ *
+ * The responses are cut in partitions of one block, each partition being
+ * applied in the frequency domain (overlap-save) to the spectrum of the
+ * matching past input block. The first partitions are computed with each
+ * block; the others, the tail, only depend on past blocks and can be
+ * computed by a worker thread while the next block is being received.
+ */
+
+/* Number of spectrum bins of the vectors are multiples of this */
+#define CONV_BINS_ALIGN 16
+
+/**
+ * Multiplies two vectors of complex numbers and adds the products to a
+ * third one: acc += x * h.
+ *
+ * The complex numbers are split in real and imaginary parts, all the
+ * vectors are 64-byte aligned and bins is a multiple of CONV_BINS_ALIGN.
+ */
+typedef void (*conv_muladd_t)(float *restrict acc_re, float *restrict acc_im,
+                              const float *x_re, const float *x_im,
+                              const float *h_re, const float *h_im,
+                              size_t bins);
+
+/** Reference implementation */
+void conv_MulAdd_C(float *restrict acc_re, float *restrict acc_im,
+                   const float *x_re, const float *x_im,
+                   const float *h_re, const float *h_im, size_t bins);
+
+/** Best implementation for the CPU */
+conv_muladd_t conv_GetMulAdd(void);
+
+typedef struct conv_engine conv_engine_t;
+
+/**
+ * Creates a convolution engine.
+ *
+ * \param inputs number of input channels
+ * \param outputs number of output channels
+ * \param block frames per block, a power of 2 from 16 to 16384
+ * \param ir responses, ir[(i * outputs + o) * length + k] being tap k of
+ *           the response of input i for output o
+ * \param length taps per response
+ * \param head partitions computed with each block, the others are the tail
+ * \param threaded whether to compute the tail from a worker thread; the
+ *                 output is exactly the same either way
+ * \return the engine, or NULL on error
+ */
+conv_engine_t *conv_New(unsigned inputs, unsigned outputs, unsigned block,
+                        const float *ir, size_t length, unsigned head,
+                        bool threaded);
+void conv_Delete(conv_engine_t *);
+
+/**
+ * Convolves a block.
+ *
+ * \param in block frames of inputs interleaved channels
+ * \param out block frames of outputs interleaved channels
+ */
+void conv_Process(conv_engine_t *, const float *in, float *out);
+
+/**
+ * Forgets the past input blocks.
+ */
+void conv_Reset(conv_engine_t *);
+
+/** Number of partitions of the responses */
+unsigned conv_Partitions(const conv_engine_t *);
+
+#endif
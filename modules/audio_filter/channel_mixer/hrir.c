@@ -0,0 +1,673 @@
+/*****************************************************************************
+ * hrir.c : binaural rendering by convolution with impulse responses
+ *****************************************************************************
+ * Copyright (C) 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+
+#include <vlc_common.h>
+#include <vlc_plugin.h>
+#include <vlc_aout.h>
+#include <vlc_filter.h>
+#include <vlc_block.h>
+#include <vlc_fs.h>
+
+#include "convolver.h"
+
+#define CFG_PREFIX "hrir-"
+
+/* Longest response loaded from a file (s) */
+#define MAX_LENGTH 10
+/* Response frames computed with each block when offloading the tail */
+#define HEAD_SAMPLES 4096
+/* Length of the synthetic responses (ms) */
+#define SYNTH_LENGTH_MS 350
+#define SYNTH_RT60 .3
+
+/*
+ * Each input channel is convolved with a response per ear, the output
+ * being the sum for each ear. The convolution works on whole blocks, so
+ * the output is delayed by one block.
+ */
+typedef struct
+{
+    conv_engine_t *conv;
+    unsigned inputs;
+    unsigned block;
+    unsigned pos;       /* frames in the current block */
+    float *in;          /* current input block */
+    float *out;         /* output of the last block */
+    float *silence;     /* a block of input silence */
+    vlc_tick_t next_pts;
+} filter_sys_t;
+
+/* Speakers of the HeSuVi 14 channels layout */
+enum
+{
+    SPK_FL, SPK_FR, SPK_FC, SPK_SL, SPK_SR, SPK_BL, SPK_BR,
+};
+
+/* HeSuVi channels of the speakers for the left and right ears */
+static const uint8_t hesuvi_channels[][2] =
+{
+    [SPK_FL] = { 0, 1 },
+    [SPK_FR] = { 8, 7 },
+    [SPK_FC] = { 6, 13 },
+    [SPK_SL] = { 2, 3 },
+    [SPK_SR] = { 10, 9 },
+    [SPK_BL] = { 4, 5 },
+    [SPK_BR] = { 12, 11 },
+};
+
+/* Input channels, in the VLC order */
+static unsigned Speakers(const audio_format_t *fmt, uint32_t *chans)
+{
+    unsigned count = 0;
+
+    for (unsigned i = 0; pi_vlc_chan_order_wg4[i] != 0; i++)
+        if (fmt->i_physical_channels & pi_vlc_chan_order_wg4[i])
+            chans[count++] = pi_vlc_chan_order_wg4[i];
+    return count;
+}
+
+/* Azimuth of a speaker, in degrees clockwise from the front */
+static double Azimuth(uint32_t chan, bool sides)
+{
+    switch (chan)
+    {
+        case AOUT_CHAN_LEFT:        return -30.;
+        case AOUT_CHAN_RIGHT:       return 30.;
+        case AOUT_CHAN_MIDDLELEFT:  return -90.;
+        case AOUT_CHAN_MIDDLERIGHT: return 90.;
+        case AOUT_CHAN_REARLEFT:    return sides ? -140. : -110.;
+        case AOUT_CHAN_REARRIGHT:   return sides ? 140. : 110.;
+        case AOUT_CHAN_REARCENTER:  return 180.;
+        default:                    return 0.;
+    }
+}
+
+/*****************************************************************************
+ * Synthetic responses
+ *****************************************************************************/
+static float Noise(uint32_t *seed)
+{
+    *seed = *seed * 1103515245 + 12345;
+    return (int)(*seed >> 8) / (float)(1 << 23) - 1.f;
+}
+
+static void LowPass(float *buf, size_t length, unsigned rate, double cutoff)
+{
+    const float a = exp(-2. * M_PI * cutoff / rate);
+    float y = 0.f;
+
+    for (size_t k = 0; k < length; k++)
+        buf[k] = y = (1.f - a) * buf[k] + a * y;
+}
+
+/* Adds a windowed sinc impulse at a fractional position */
+static void Impulse(float *buf, size_t length, double pos, float gain)
+{
+    const int width = 16;
+
+    for (int k = floor(pos) - width + 1; k <= floor(pos) + width; k++)
+    {
+        if (k < 0 || (size_t)k >= length)
+            continue;
+
+        const double x = k - pos;
+        const double w = .5 + .5 * cos(M_PI * x / width);
+        buf[k] += gain * w * (x != 0. ? sin(M_PI * x) / (M_PI * x) : 1.);
+    }
+}
+
+/*
+ * Spherical head model: Woodworth interaural time difference, shadowing of
+ * the far ear and of the rear sources, a few early reflections and an
+ * exponentially decaying diffuse tail.
+ */
+static void Synthesize(float *h, size_t length, unsigned rate,
+                       double azimuth, unsigned ear, unsigned seed)
+{
+    const double theta = azimuth * M_PI / 180.;
+    const double lateral = ear ? sin(theta) : -sin(theta);
+    const double front = cos(theta);
+    const double itd = 0.0875 / 343. * (asin(fabs(lateral))
+                                        + fabs(lateral));
+    const double delay = 32. + (lateral < 0. ? itd * rate : 0.);
+    const size_t direct = 2 * 32 + ceil(itd * rate) + 32;
+    uint32_t state = seed * 2 + ear + 1;
+
+    memset(h, 0, length * sizeof (*h));
+
+    /* Direct path */
+    Impulse(h, direct, delay, lateral < 0. ? 1. + .3 * lateral
+                                           : 1. + .2 * lateral);
+    if (lateral < 0.)
+        LowPass(h, direct, rate, 20000. * pow(.075, -lateral));
+    if (front < 0.)
+        LowPass(h, direct, rate, 20000. * pow(.4, -front));
+
+    /* Early reflections */
+    static const double reflections[] = { 3.1, 4.7, 6.3, 8.9, 11.2, 14.9 };
+    for (unsigned r = 0; r < ARRAY_SIZE(reflections); r++)
+    {
+        const double ms = reflections[r] * (1. + .1 * Noise(&state));
+        const double pos = delay + ms * rate / 1000.;
+        const float gain = .45f * powf(.8f, r) * (((r ^ ear) & 1) ? .6f
+                                                                  : 1.f);
+
+        if (pos + 16 < length)
+            Impulse(h, length, pos, gain);
+    }
+
+    /* Diffuse tail */
+    const size_t start = delay + rate / 64;
+    const double decay = -6.91 / (SYNTH_RT60 * rate);
+    float lp = 0.f;
+
+    for (size_t k = start; k < length; k++)
+    {
+        lp = .6f * lp + .4f * Noise(&state);
+        h[k] += .08f * lp * exp(decay * (k - start));
+    }
+}
+
+/*****************************************************************************
+ * Responses from WAVE files
+ *****************************************************************************/
+static float *LoadWave(vlc_object_t *obj, const char *path,
+                       unsigned *restrict channels, unsigned *restrict rate,
+                       size_t *restrict frames)
+{
+    FILE *file = vlc_fopen(path, "rb");
+    if (file == NULL)
+    {
+        msg_Err(obj, "cannot open %s: %s", path, vlc_strerror_c(errno));
+        return NULL;
+    }
+
+    uint8_t hdr[40];
+    unsigned format = 0, bits = 0;
+    float *data = NULL;
+
+    *channels = 0;
+    if (fread(hdr, 1, 12, file) != 12 || memcmp(hdr, "RIFF", 4)
+     || memcmp(hdr + 8, "WAVE", 4))
+        goto error;
+
+    while (fread(hdr, 1, 8, file) == 8)
+    {
+        uint32_t size = GetDWLE(hdr + 4);
+
+        if (!memcmp(hdr, "fmt ", 4))
+        {
+            if (size < 16 || fread(hdr, 1, __MIN(size, 40), file)
+                             != __MIN(size, 40))
+                goto error;
+            format = GetWLE(hdr);
+            *channels = GetWLE(hdr + 2);
+            *rate = GetDWLE(hdr + 4);
+            bits = GetWLE(hdr + 14);
+            if (format == 0xFFFE && size >= 40)
+                format = GetWLE(hdr + 24);
+            size -= __MIN(size, 40);
+        }
+        else if (!memcmp(hdr, "data", 4) && *channels > 0)
+        {
+            const unsigned bytes = bits / 8;
+
+            if (*channels > 64 || *rate == 0 || bits % 8 || bytes == 0
+             || (format == 1 && bytes > 4) || (format == 3 && bytes != 4)
+             || (format != 1 && format != 3))
+                goto error;
+
+            *frames = size / (bytes * *channels);
+            if (*frames > (size_t)MAX_LENGTH * *rate)
+            {
+                msg_Warn(obj, "truncating the responses to %d s",
+                         MAX_LENGTH);
+                *frames = (size_t)MAX_LENGTH * *rate;
+            }
+
+            const size_t count = *frames * *channels;
+            uint8_t *raw = vlc_alloc(count, bytes);
+            data = vlc_alloc(count, sizeof (*data));
+            if (raw == NULL || data == NULL
+             || fread(raw, bytes, count, file) != count)
+            {
+                free(raw);
+                goto error;
+            }
+
+            for (size_t k = 0; k < count; k++)
+            {
+                const uint8_t *p = raw + k * bytes;
+                uint32_t v = 0;
+
+                for (unsigned b = 0; b < bytes; b++)
+                    v |= (uint32_t)p[b] << (8 * b);
+
+                if (format == 3)
+                    memcpy(data + k, &v, sizeof (v));
+                else if (bytes == 1)
+                    data[k] = ((int)v - 128) / 128.f;
+                else
+                    data[k] = (int32_t)(v << (32 - bits)) / 2147483648.f;
+            }
+            free(raw);
+            fclose(file);
+            return data;
+        }
+        if (fseek(file, size + (size & 1), SEEK_CUR))
+            break;
+    }
+
+error:
+    msg_Err(obj, "unsupported WAVE file %s", path);
+    free(data);
+    fclose(file);
+    return NULL;
+}
+
+/* Windowed sinc resampling of interleaved frames */
+static float *Resample(const float *in, size_t frames, unsigned channels,
+                       unsigned from, unsigned to, size_t *restrict length)
+{
+    const double ratio = (double)from / to;
+    const double cutoff = from > to ? (double)to / from : 1.;
+    const double width = 16. / cutoff;
+    const size_t count = ((uint64_t)frames * to + from - 1) / from;
+    float *out = vlc_alloc(count * channels, sizeof (*out));
+
+    if (unlikely(out == NULL))
+        return NULL;
+
+    for (size_t j = 0; j < count; j++)
+    {
+        const double t = j * ratio;
+        const long first = __MAX(0, lrint(ceil(t - width)));
+        const long last = __MIN((long)frames - 1, lrint(floor(t + width)));
+
+        for (unsigned c = 0; c < channels; c++)
+            out[j * channels + c] = 0.f;
+        for (long k = first; k <= last; k++)
+        {
+            const double x = (t - k) * cutoff;
+            const double w = .5 + .5 * cos(M_PI * (t - k) / width);
+            const float h = cutoff * w
+                          * (x != 0. ? sin(M_PI * x) / (M_PI * x) : 1.);
+
+            for (unsigned c = 0; c < channels; c++)
+                out[j * channels + c] += h * in[k * channels + c];
+        }
+    }
+    *length = count;
+    return out;
+}
+
+/* Channels of a HeSuVi file for an input channel and an ear */
+static void HeSuViChannels(uint32_t chan, bool sides, unsigned ear,
+                           unsigned *a, unsigned *b)
+{
+    unsigned spk;
+
+    switch (chan)
+    {
+        case AOUT_CHAN_LEFT:        spk = SPK_FL; break;
+        case AOUT_CHAN_RIGHT:       spk = SPK_FR; break;
+        case AOUT_CHAN_MIDDLELEFT:  spk = SPK_SL; break;
+        case AOUT_CHAN_MIDDLERIGHT: spk = SPK_SR; break;
+        /* The 5.1 surrounds are side speakers */
+        case AOUT_CHAN_REARLEFT:    spk = sides ? SPK_BL : SPK_SL; break;
+        case AOUT_CHAN_REARRIGHT:   spk = sides ? SPK_BR : SPK_SR; break;
+        case AOUT_CHAN_REARCENTER:
+            *a = hesuvi_channels[SPK_BL][ear];
+            *b = hesuvi_channels[SPK_BR][ear];
+            return;
+        default:                    spk = SPK_FC; break;
+    }
+    *a = *b = hesuvi_channels[spk][ear];
+}
+
+/*
+ * Loads the responses of the input channels, from a file with either the
+ * 14 channels of HeSuVi or a pair of channels per input channel, or from
+ * the head model.
+ */
+static float *LoadResponses(filter_t *filter, const uint32_t *chans,
+                            unsigned inputs, size_t *restrict length)
+{
+    const unsigned rate = filter->fmt_in.audio.i_rate;
+    const bool sides = (filter->fmt_in.audio.i_physical_channels
+                        & AOUT_CHANS_MIDDLE) != 0;
+    char *path = var_InheritString(filter, CFG_PREFIX "file");
+    float *ir;
+
+    if (path != NULL && path[0] != '\0')
+    {
+        unsigned channels, file_rate;
+        size_t frames;
+        float *wave = LoadWave(VLC_OBJECT(filter), path, &channels,
+                               &file_rate, &frames);
+        free(path);
+        if (wave == NULL)
+            return NULL;
+
+        if (frames == 0 || (channels != 14 && channels != 2 * inputs))
+        {
+            msg_Err(filter, "%u channels responses for %u channels input",
+                    channels, inputs);
+            free(wave);
+            return NULL;
+        }
+
+        if (file_rate != rate)
+        {
+            float *resampled = Resample(wave, frames, channels, file_rate,
+                                        rate, &frames);
+            free(wave);
+            if (resampled == NULL)
+                return NULL;
+            wave = resampled;
+        }
+
+        ir = vlc_alloc((size_t)inputs * 2 * frames, sizeof (*ir));
+        if (unlikely(ir == NULL))
+        {
+            free(wave);
+            return NULL;
+        }
+
+        for (unsigned i = 0; i < inputs; i++)
+            for (unsigned ear = 0; ear < 2; ear++)
+            {
+                float *h = ir + ((size_t)i * 2 + ear) * frames;
+                unsigned a, b;
+
+                if (channels == 14)
+                    HeSuViChannels(chans[i], sides, ear, &a, &b);
+                else
+                    a = b = 2 * i + ear;
+
+                for (size_t k = 0; k < frames; k++)
+                    h[k] = .5f * (wave[k * channels + a]
+                                  + wave[k * channels + b]);
+            }
+        free(wave);
+        *length = frames;
+    }
+    else
+    {
+        const size_t frames = (size_t)rate * SYNTH_LENGTH_MS / 1000;
+
+        free(path);
+        ir = vlc_alloc((size_t)inputs * 2 * frames, sizeof (*ir));
+        if (unlikely(ir == NULL))
+            return NULL;
+
+        /* Unity power for uncorrelated inputs at the loudest ear */
+        double energy[2] = { 0., 0. };
+
+        for (unsigned i = 0; i < inputs; i++)
+            for (unsigned ear = 0; ear < 2; ear++)
+            {
+                float *h = ir + ((size_t)i * 2 + ear) * frames;
+
+                Synthesize(h, frames, rate, Azimuth(chans[i], sides), ear,
+                           i);
+                if (chans[i] != AOUT_CHAN_LFE)
+                    for (size_t k = 0; k < frames; k++)
+                        energy[ear] += h[k] * h[k];
+            }
+
+        const float scale = 1. / sqrt(__MAX(__MAX(energy[0], energy[1]),
+                                            1e-9));
+        for (size_t k = 0; k < (size_t)inputs * 2 * frames; k++)
+            ir[k] *= scale;
+        *length = frames;
+    }
+
+    const float gain = powf(10.f, var_InheritFloat(filter, CFG_PREFIX "gain")
+                                  / 20.f);
+    for (size_t k = 0; k < (size_t)inputs * 2 * *length; k++)
+        ir[k] *= gain;
+    return ir;
+}
+
+/*****************************************************************************
+ * Filter
+ *****************************************************************************/
+static void Run(filter_sys_t *sys, const float *in, float *out,
+                size_t frames)
+{
+    while (frames > 0)
+    {
+        const size_t n = __MIN(sys->block - sys->pos, frames);
+
+        memcpy(sys->in + (size_t)sys->pos * sys->inputs, in,
+               n * sys->inputs * sizeof (float));
+        memcpy(out, sys->out + (size_t)sys->pos * 2, n * 2 * sizeof (float));
+        in += n * sys->inputs;
+        out += n * 2;
+        frames -= n;
+        sys->pos += n;
+
+        if (sys->pos == sys->block)
+        {
+            conv_Process(sys->conv, sys->in, sys->out);
+            sys->pos = 0;
+        }
+    }
+}
+
+static block_t *Filter(filter_t *filter, block_t *in)
+{
+    filter_sys_t *sys = filter->p_sys;
+    const size_t frames = in->i_nb_samples;
+
+    if (frames == 0)
+    {
+        block_Release(in);
+        return NULL;
+    }
+
+    block_t *out = block_Alloc(frames * 2 * sizeof (float));
+    if (unlikely(out == NULL))
+    {
+        block_Release(in);
+        return NULL;
+    }
+
+    /* The output is delayed by one partition of the convolution */
+    out->i_nb_samples = frames;
+    out->i_pts = in->i_pts;
+    if (out->i_pts != VLC_TICK_INVALID)
+        out->i_pts -= vlc_tick_from_samples(sys->block,
+                                            filter->fmt_in.audio.i_rate);
+    out->i_dts = out->i_pts;
+    out->i_length = in->i_length;
+    if (out->i_pts != VLC_TICK_INVALID)
+        sys->next_pts = out->i_pts + out->i_length;
+
+    Run(sys, (const float *)in->p_buffer, (float *)out->p_buffer, frames);
+    block_Release(in);
+    return out;
+}
+
+static void Reset(filter_sys_t *sys)
+{
+    conv_Reset(sys->conv);
+    memset(sys->out, 0, sys->block * 2 * sizeof (float));
+    sys->pos = 0;
+    sys->next_pts = VLC_TICK_INVALID;
+}
+
+/* Outputs the delayed block */
+static block_t *Drain(filter_t *filter)
+{
+    filter_sys_t *sys = filter->p_sys;
+
+    if (sys->next_pts == VLC_TICK_INVALID)
+        return NULL;
+
+    block_t *out = block_Alloc(sys->block * 2 * sizeof (float));
+    if (likely(out != NULL))
+    {
+        out->i_nb_samples = sys->block;
+        out->i_pts = out->i_dts = sys->next_pts;
+        out->i_length = vlc_tick_from_samples(sys->block,
+                                              filter->fmt_in.audio.i_rate);
+        Run(sys, sys->silence, (float *)out->p_buffer, sys->block);
+    }
+    Reset(sys);
+    return out;
+}
+
+static void Flush(filter_t *filter)
+{
+    Reset(filter->p_sys);
+}
+
+static void Close(filter_t *filter)
+{
+    filter_sys_t *sys = filter->p_sys;
+
+    conv_Delete(sys->conv);
+    free(sys->silence);
+    free(sys->out);
+    free(sys->in);
+    free(sys);
+}
+
+static int Open(vlc_object_t *obj)
+{
+    filter_t *filter = (filter_t *)obj;
+    const unsigned rate = filter->fmt_in.audio.i_rate;
+
+    /* Activate this filter only with stereo devices */
+    if (filter->fmt_out.audio.i_physical_channels != AOUT_CHANS_STEREO
+     || filter->fmt_in.audio.channel_type != AUDIO_CHANNEL_TYPE_BITMAP
+     || rate == 0)
+    {
+        msg_Dbg(filter, "filter discarded (incompatible format)");
+        return VLC_EGENERIC;
+    }
+
+    uint32_t chans[AOUT_CHAN_MAX];
+    const unsigned inputs = Speakers(&filter->fmt_in.audio, chans);
+    if (inputs == 0)
+        return VLC_EGENERIC;
+
+    unsigned block = var_InheritInteger(filter, CFG_PREFIX "partition");
+    if (block < 32 || block > 8192 || (block & (block - 1)) != 0)
+    {
+        msg_Err(filter, "invalid partition size %u", block);
+        return VLC_EGENERIC;
+    }
+
+    size_t length;
+    float *ir = LoadResponses(filter, chans, inputs, &length);
+    if (ir == NULL)
+        return VLC_EGENERIC;
+
+    filter_sys_t *sys = calloc(1, sizeof (*sys));
+    if (unlikely(sys == NULL))
+    {
+        free(ir);
+        return VLC_ENOMEM;
+    }
+
+    sys->inputs = inputs;
+    sys->block = block;
+    sys->conv = conv_New(inputs, 2, block, ir, length,
+                         __MAX(HEAD_SAMPLES / block, 1u),
+                         var_InheritBool(filter, CFG_PREFIX "thread"));
+    free(ir);
+    sys->in = vlc_alloc((size_t)block * inputs, sizeof (float));
+    sys->out = vlc_alloc((size_t)block * 2, sizeof (float));
+    sys->silence = calloc((size_t)block * inputs, sizeof (float));
+    if (unlikely(sys->conv == NULL || sys->in == NULL || sys->out == NULL
+              || sys->silence == NULL))
+    {
+        if (sys->conv != NULL)
+            conv_Delete(sys->conv);
+        free(sys->silence);
+        free(sys->out);
+        free(sys->in);
+        free(sys);
+        return VLC_ENOMEM;
+    }
+    filter->p_sys = sys;
+    Reset(sys);
+
+    msg_Dbg(filter, "%u channels, %zu taps in %u partitions of %u frames",
+            inputs, length, conv_Partitions(sys->conv), block);
+
+    filter->fmt_in.audio.i_format = VLC_CODEC_FL32;
+    filter->fmt_out.audio.i_format = VLC_CODEC_FL32;
+    filter->fmt_out.audio.i_rate = rate;
+    aout_FormatPrepare(&filter->fmt_in.audio);
+    aout_FormatPrepare(&filter->fmt_out.audio);
+
+    static const struct vlc_filter_operations filter_ops =
+    {
+        .filter_audio = Filter, .drain_audio = Drain, .flush = Flush,
+        .close = Close,
+    };
+    filter->ops = &filter_ops;
+    return VLC_SUCCESS;
+}
+
+#define FILE_TEXT N_("Impulse responses file")
+#define FILE_LONGTEXT N_( \
+    "WAVE file of head related or room impulse responses, either in the " \
+    "14 channels HeSuVi layout or with a left and right ear pair of " \
+    "channels per input channel. A spherical head model is used if empty.")
+#define PARTITION_TEXT N_("Partition size")
+#define PARTITION_LONGTEXT N_( \
+    "Frames per convolution block, a power of 2. This is also the latency " \
+    "added by the filter.")
+#define THREAD_TEXT N_("Offload long responses to a thread")
+#define THREAD_LONGTEXT N_( \
+    "Computes the late part of the responses from a separate thread.")
+#define GAIN_TEXT N_("Gain (dB)")
+#define GAIN_LONGTEXT N_("Gain applied to the impulse responses.")
+
+vlc_module_begin()
+    set_shortname(N_("HRIR"))
+    set_description(N_("Binaural rendering with impulse responses"))
+    set_help(N_("Renders any source format from mono to 8.1 to headphones "
+                "by convolution with head related impulse responses."))
+    set_category(CAT_AUDIO)
+    set_subcategory(SUBCAT_AUDIO_AFILTER)
+    add_loadfile(CFG_PREFIX "file", NULL, FILE_TEXT, FILE_LONGTEXT)
+    add_integer(CFG_PREFIX "partition", 256, PARTITION_TEXT,
+                PARTITION_LONGTEXT, true)
+    add_bool(CFG_PREFIX "thread", true, THREAD_TEXT, THREAD_LONGTEXT, true)
+    add_float_with_range(CFG_PREFIX "gain", 0.f, -30.f, 12.f,
+                         GAIN_TEXT, GAIN_LONGTEXT, false)
+    set_capability("audio filter", 0)
+    set_callback(Open)
+    add_shortcut("hrir")
+vlc_module_end()
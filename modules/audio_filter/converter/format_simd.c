@@ -0,0 +1,1138 @@
+/*****************************************************************************
+ * format_simd.c : SIMD PCM format conversions
+ *****************************************************************************
+ * Copyright (C) 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <math.h>
+
+#include <vlc_common.h>
+#include <vlc_cpu.h>
+#include <vlc_fourcc.h>
+
+#include "format_simd.h"
+
+/*
+ * Every conversion goes through 32-bit integers: integer samples are loaded
+ * as S32, floating point samples are scaled, dithered, clipped and rounded
+ * to the range of the destination. The vector versions process 8 samples at
+ * a time, the remaining ones use the scalar code, so that sample i always
+ * draws its dither from the lane i % 8.
+ */
+
+void pcm_DitherInit(pcm_dither_t *dither, uint32_t seed)
+{
+    for (unsigned i = 0; i < PCM_DITHER_LANES; i++)
+    {
+        uint32_t x = (seed + i) * UINT32_C(2654435761);
+        /* xorshift never leaves zero */
+        dither->lanes[i] = x ? x : 1;
+    }
+}
+
+static inline uint32_t DitherNext(uint32_t *state)
+{
+    uint32_t x = *state;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+/* Difference of two uniform 16-bit values: triangular in ]-1, 1[ */
+static inline float Tpdf(uint32_t r)
+{
+    return (float)((int32_t)(r & 0xffff) - (int32_t)(r >> 16))
+           * (1.f / 65536.f);
+}
+
+static inline float Dither(pcm_dither_t *dither, size_t i)
+{
+    return Tpdf(DitherNext(&dither->lanes[i % PCM_DITHER_LANES]));
+}
+
+/*** Scalar ***/
+
+static inline int32_t LoadU8(const void *p, size_t i)
+{
+    return ((int32_t)((const uint8_t *)p)[i] - 128) * (1 << 24);
+}
+
+static inline int32_t LoadS16(const void *p, size_t i)
+{
+    return ((const int16_t *)p)[i] * (1 << 16);
+}
+
+static inline int32_t LoadS32(const void *p, size_t i)
+{
+    return ((const int32_t *)p)[i];
+}
+
+static inline void StoreU8(void *p, size_t i, int32_t v)
+{
+    ((uint8_t *)p)[i] = (v >> 24) + 128;
+}
+
+static inline void StoreS16(void *p, size_t i, int32_t v)
+{
+    ((int16_t *)p)[i] = v >> 16;
+}
+
+static inline void StoreS32(void *p, size_t i, int32_t v)
+{
+    ((int32_t *)p)[i] = v;
+}
+
+static inline void StoreFL32(void *p, size_t i, int32_t v)
+{
+    ((float *)p)[i] = (float)v * (1.f / 2147483648.f);
+}
+
+static inline void StoreFL64(void *p, size_t i, int32_t v)
+{
+    ((double *)p)[i] = (double)v * (1. / 2147483648.);
+}
+
+/* Stores of samples already in the range of the destination */
+static inline void StoreU8Scaled(void *p, size_t i, int32_t v)
+{
+    ((uint8_t *)p)[i] = v + 128;
+}
+
+static inline void StoreS16Scaled(void *p, size_t i, int32_t v)
+{
+    ((int16_t *)p)[i] = v;
+}
+
+#define StoreS32Scaled StoreS32
+
+static inline int32_t RoundFL32(float v, float lo, float hi)
+{
+    if (!(v > lo)) /* NaN too */
+        return lo;
+    /* 2^31 is the only float above INT32_MAX left */
+    if (v >= hi)
+        return hi >= 2147483648.f ? INT32_MAX : hi;
+    return lrintf(v);
+}
+
+static inline int32_t RoundFL64(double v, double lo, double hi)
+{
+    if (!(v > lo))
+        return lo;
+    if (v >= hi)
+        return hi;
+    return lrint(v);
+}
+
+#define SAMPLE_INT(src, dst) \
+static inline void Sample##src##to##dst(void *d, const void *s, size_t i, \
+                                        pcm_dither_t *dither, bool dithered) \
+{ \
+    VLC_UNUSED(dither); VLC_UNUSED(dithered); \
+    Store##dst(d, i, Load##src(s, i)); \
+}
+
+#define SAMPLE_FLOAT(src, type, dst, scale, lo, hi) \
+static inline void Sample##src##to##dst(void *d, const void *s, size_t i, \
+                                        pcm_dither_t *dither, bool dithered) \
+{ \
+    type v = ((const type *)s)[i] * scale; \
+    if (dithered) \
+        v += Dither(dither, i); \
+    Store##dst##Scaled(d, i, Round##src(v, lo, hi)); \
+}
+
+#define SAMPLE_CAST(src, stype, dst, dtype) \
+static inline void Sample##src##to##dst(void *d, const void *s, size_t i, \
+                                        pcm_dither_t *dither, bool dithered) \
+{ \
+    VLC_UNUSED(dither); VLC_UNUSED(dithered); \
+    ((dtype *)d)[i] = ((const stype *)s)[i]; \
+}
+
+SAMPLE_INT(U8, S16)
+SAMPLE_INT(U8, S32)
+SAMPLE_INT(U8, FL32)
+SAMPLE_INT(U8, FL64)
+SAMPLE_INT(S16, U8)
+SAMPLE_INT(S16, S32)
+SAMPLE_INT(S16, FL32)
+SAMPLE_INT(S16, FL64)
+SAMPLE_INT(S32, U8)
+SAMPLE_INT(S32, S16)
+SAMPLE_INT(S32, FL32)
+SAMPLE_INT(S32, FL64)
+SAMPLE_FLOAT(FL32, float, U8, 128.f, -128.f, 127.f)
+SAMPLE_FLOAT(FL32, float, S16, 32768.f, -32768.f, 32767.f)
+SAMPLE_FLOAT(FL32, float, S32, 2147483648.f, -2147483648.f, 2147483648.f)
+SAMPLE_CAST(FL32, float, FL64, double)
+SAMPLE_FLOAT(FL64, double, U8, 128., -128., 127.)
+SAMPLE_FLOAT(FL64, double, S16, 32768., -32768., 32767.)
+SAMPLE_FLOAT(FL64, double, S32, 2147483648., -2147483648., 2147483647.)
+SAMPLE_CAST(FL64, double, FL32, float)
+
+#define CONVERT_C(src, dst, suffix, dithered) \
+static void src##to##dst##suffix##_C(void *d, const void *s, size_t n, \
+                                     pcm_dither_t *dither) \
+{ \
+    for (size_t i = 0; i < n; i++) \
+        Sample##src##to##dst(d, s, i, dither, dithered); \
+}
+
+/*** SSE2 ***/
+
+#ifdef HAVE_SSE2_INTRINSICS
+# include <emmintrin.h>
+
+__attribute__ ((__target__ ("sse2")))
+static inline __m128 TpdfSSE2(__m128i *state)
+{
+    __m128i x = *state;
+
+    x = _mm_xor_si128(x, _mm_slli_epi32(x, 13));
+    x = _mm_xor_si128(x, _mm_srli_epi32(x, 17));
+    x = _mm_xor_si128(x, _mm_slli_epi32(x, 5));
+    *state = x;
+
+    __m128i d = _mm_sub_epi32(_mm_and_si128(x, _mm_set1_epi32(0xffff)),
+                              _mm_srli_epi32(x, 16));
+    return _mm_mul_ps(_mm_cvtepi32_ps(d), _mm_set1_ps(1.f / 65536.f));
+}
+
+__attribute__ ((__target__ ("sse2")))
+static inline void LoadU8SSE2(const void *p, size_t i, __m128i *a, __m128i *b)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i sign = _mm_set1_epi32(INT32_MIN);
+    __m128i v = _mm_loadl_epi64((const __m128i *)((const uint8_t *)p + i));
+
+    v = _mm_unpacklo_epi8(zero, v);
+    *a = _mm_xor_si128(_mm_unpacklo_epi16(zero, v), sign);
+    *b = _mm_xor_si128(_mm_unpackhi_epi16(zero, v), sign);
+}
+
+__attribute__ ((__target__ ("sse2")))
+static inline void LoadS16SSE2(const void *p, size_t i, __m128i *a, __m128i *b)
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i v = _mm_loadu_si128((const __m128i *)((const int16_t *)p + i));
+
+    *a = _mm_unpacklo_epi16(zero, v);
+    *b = _mm_unpackhi_epi16(zero, v);
+}
+
+__attribute__ ((__target__ ("sse2")))
+static inline void LoadS32SSE2(const void *p, size_t i, __m128i *a, __m128i *b)
+{
+    *a = _mm_loadu_si128((const __m128i *)((const int32_t *)p + i));
+    *b = _mm_loadu_si128((const __m128i *)((const int32_t *)p + i + 4));
+}
+
+__attribute__ ((__target__ ("sse2")))
+static inline void StoreU8ScaledSSE2(void *p, size_t i, __m128i a, __m128i b)
+{
+    __m128i v = _mm_packs_epi32(a, b);
+
+    v = _mm_xor_si128(_mm_packs_epi16(v, v), _mm_set1_epi8(-128));
+    _mm_storel_epi64((__m128i *)((uint8_t *)p + i), v);
+}
+
+__attribute__ ((__target__ ("sse2")))
+static inline void StoreS16ScaledSSE2(void *p, size_t i, __m128i a, __m128i b)
+{
+    _mm_storeu_si128((__m128i *)((int16_t *)p + i), _mm_packs_epi32(a, b));
+}
+
+__attribute__ ((__target__ ("sse2")))
+static inline void StoreS32SSE2(void *p, size_t i, __m128i a, __m128i b)
+{
+    _mm_storeu_si128((__m128i *)((int32_t *)p + i), a);
+    _mm_storeu_si128((__m128i *)((int32_t *)p + i + 4), b);
+}
+
+#define StoreS32ScaledSSE2 StoreS32SSE2
+
+__attribute__ ((__target__ ("sse2")))
+static inline void StoreU8SSE2(void *p, size_t i, __m128i a, __m128i b)
+{
+    StoreU8ScaledSSE2(p, i, _mm_srai_epi32(a, 24), _mm_srai_epi32(b, 24));
+}
+
+__attribute__ ((__target__ ("sse2")))
+static inline void StoreS16SSE2(void *p, size_t i, __m128i a, __m128i b)
+{
+    StoreS16ScaledSSE2(p, i, _mm_srai_epi32(a, 16), _mm_srai_epi32(b, 16));
+}
+
+__attribute__ ((__target__ ("sse2")))
+static inline void StoreFL32SSE2(void *p, size_t i, __m128i a, __m128i b)
+{
+    const __m128 scale = _mm_set1_ps(1.f / 2147483648.f);
+    float *d = (float *)p + i;
+
+    _mm_storeu_ps(d, _mm_mul_ps(_mm_cvtepi32_ps(a), scale));
+    _mm_storeu_ps(d + 4, _mm_mul_ps(_mm_cvtepi32_ps(b), scale));
+}
+
+__attribute__ ((__target__ ("sse2")))
+static inline void StoreFL64SSE2(void *p, size_t i, __m128i a, __m128i b)
+{
+    const __m128d scale = _mm_set1_pd(1. / 2147483648.);
+    double *d = (double *)p + i;
+
+    _mm_storeu_pd(d, _mm_mul_pd(_mm_cvtepi32_pd(a), scale));
+    _mm_storeu_pd(d + 2, _mm_mul_pd(_mm_cvtepi32_pd(_mm_unpackhi_epi64(a, a)),
+                                    scale));
+    _mm_storeu_pd(d + 4, _mm_mul_pd(_mm_cvtepi32_pd(b), scale));
+    _mm_storeu_pd(d + 6, _mm_mul_pd(_mm_cvtepi32_pd(_mm_unpackhi_epi64(b, b)),
+                                    scale));
+}
+
+__attribute__ ((__target__ ("sse2")))
+static inline __m128i RoundPSSSE2(__m128 s, float lo, float hi)
+{
+    s = _mm_min_ps(_mm_max_ps(s, _mm_set1_ps(lo)), _mm_set1_ps(hi));
+
+    __m128i r = _mm_cvtps_epi32(s);
+    if (hi >= 2147483648.f) /* 0x80000000 to INT32_MAX on overflow */
+        r = _mm_xor_si128(r, _mm_castps_si128(
+                _mm_cmpge_ps(s, _mm_set1_ps(2147483648.f))));
+    return r;
+}
+
+__attribute__ ((__target__ ("sse2")))
+static inline void RoundFL32SSE2(const void *p, size_t i, float scale,
+                                 float lo, float hi, bool dithered,
+                                 __m128 da, __m128 db, __m128i *a, __m128i *b)
+{
+    const float *s = (const float *)p + i;
+    __m128 x = _mm_mul_ps(_mm_loadu_ps(s), _mm_set1_ps(scale));
+    __m128 y = _mm_mul_ps(_mm_loadu_ps(s + 4), _mm_set1_ps(scale));
+
+    if (dithered)
+    {
+        x = _mm_add_ps(x, da);
+        y = _mm_add_ps(y, db);
+    }
+    *a = RoundPSSSE2(x, lo, hi);
+    *b = RoundPSSSE2(y, lo, hi);
+}
+
+__attribute__ ((__target__ ("sse2")))
+static inline __m128i RoundPDSSE2(const double *s, double scale, double lo,
+                                  double hi, bool dithered, __m128 d)
+{
+    __m128d x = _mm_mul_pd(_mm_loadu_pd(s), _mm_set1_pd(scale));
+    __m128d y = _mm_mul_pd(_mm_loadu_pd(s + 2), _mm_set1_pd(scale));
+
+    if (dithered)
+    {
+        x = _mm_add_pd(x, _mm_cvtps_pd(d));
+        y = _mm_add_pd(y, _mm_cvtps_pd(_mm_movehl_ps(d, d)));
+    }
+    x = _mm_min_pd(_mm_max_pd(x, _mm_set1_pd(lo)), _mm_set1_pd(hi));
+    y = _mm_min_pd(_mm_max_pd(y, _mm_set1_pd(lo)), _mm_set1_pd(hi));
+    return _mm_unpacklo_epi64(_mm_cvtpd_epi32(x), _mm_cvtpd_epi32(y));
+}
+
+__attribute__ ((__target__ ("sse2")))
+static inline void RoundFL64SSE2(const void *p, size_t i, double scale,
+                                 double lo, double hi, bool dithered,
+                                 __m128 da, __m128 db, __m128i *a, __m128i *b)
+{
+    const double *s = (const double *)p + i;
+
+    *a = RoundPDSSE2(s, scale, lo, hi, dithered, da);
+    *b = RoundPDSSE2(s + 4, scale, lo, hi, dithered, db);
+}
+
+#define CONVERT_INT_SSE2(src, dst) \
+__attribute__ ((__target__ ("sse2"))) \
+static void src##to##dst##_SSE2(void *d, const void *s, size_t n, \
+                                pcm_dither_t *dither) \
+{ \
+    size_t i = 0; \
+    for (; i + 8 <= n; i += 8) \
+    { \
+        __m128i a, b; \
+        Load##src##SSE2(s, i, &a, &b); \
+        Store##dst##SSE2(d, i, a, b); \
+    } \
+    for (; i < n; i++) \
+        Sample##src##to##dst(d, s, i, dither, false); \
+}
+
+#define CONVERT_FLOAT_SSE2(src, dst, suffix, dithered, scale, lo, hi) \
+__attribute__ ((__target__ ("sse2"))) \
+static void src##to##dst##suffix##_SSE2(void *d, const void *s, size_t n, \
+                                        pcm_dither_t *dither) \
+{ \
+    __m128i la = _mm_setzero_si128(), lb = _mm_setzero_si128(); \
+    size_t i = 0; \
+    if (dithered) \
+    { \
+        la = _mm_loadu_si128((const __m128i *)dither->lanes); \
+        lb = _mm_loadu_si128((const __m128i *)(dither->lanes + 4)); \
+    } \
+    for (; i + 8 <= n; i += 8) \
+    { \
+        __m128 da = _mm_setzero_ps(), db = _mm_setzero_ps(); \
+        __m128i a, b; \
+        if (dithered) \
+        { \
+            da = TpdfSSE2(&la); \
+            db = TpdfSSE2(&lb); \
+        } \
+        Round##src##SSE2(s, i, scale, lo, hi, dithered, da, db, &a, &b); \
+        Store##dst##ScaledSSE2(d, i, a, b); \
+    } \
+    if (dithered) \
+    { \
+        _mm_storeu_si128((__m128i *)dither->lanes, la); \
+        _mm_storeu_si128((__m128i *)(dither->lanes + 4), lb); \
+    } \
+    for (; i < n; i++) \
+        Sample##src##to##dst(d, s, i, dither, dithered); \
+}
+
+__attribute__ ((__target__ ("sse2")))
+static void FL32toFL64_SSE2(void *d, const void *s, size_t n,
+                            pcm_dither_t *dither)
+{
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        const float *in = (const float *)s + i;
+        double *out = (double *)d + i;
+        __m128 x = _mm_loadu_ps(in), y = _mm_loadu_ps(in + 4);
+
+        _mm_storeu_pd(out, _mm_cvtps_pd(x));
+        _mm_storeu_pd(out + 2, _mm_cvtps_pd(_mm_movehl_ps(x, x)));
+        _mm_storeu_pd(out + 4, _mm_cvtps_pd(y));
+        _mm_storeu_pd(out + 6, _mm_cvtps_pd(_mm_movehl_ps(y, y)));
+    }
+    for (; i < n; i++)
+        SampleFL32toFL64(d, s, i, dither, false);
+}
+
+__attribute__ ((__target__ ("sse2")))
+static void FL64toFL32_SSE2(void *d, const void *s, size_t n,
+                            pcm_dither_t *dither)
+{
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        const double *in = (const double *)s + i;
+        float *out = (float *)d + i;
+        __m128 x = _mm_movelh_ps(_mm_cvtpd_ps(_mm_loadu_pd(in)),
+                                 _mm_cvtpd_ps(_mm_loadu_pd(in + 2)));
+        __m128 y = _mm_movelh_ps(_mm_cvtpd_ps(_mm_loadu_pd(in + 4)),
+                                 _mm_cvtpd_ps(_mm_loadu_pd(in + 6)));
+
+        _mm_storeu_ps(out, x);
+        _mm_storeu_ps(out + 4, y);
+    }
+    for (; i < n; i++)
+        SampleFL64toFL32(d, s, i, dither, false);
+}
+
+CONVERT_INT_SSE2(U8, S16)
+CONVERT_INT_SSE2(U8, S32)
+CONVERT_INT_SSE2(U8, FL32)
+CONVERT_INT_SSE2(U8, FL64)
+CONVERT_INT_SSE2(S16, U8)
+CONVERT_INT_SSE2(S16, S32)
+CONVERT_INT_SSE2(S16, FL32)
+CONVERT_INT_SSE2(S16, FL64)
+CONVERT_INT_SSE2(S32, U8)
+CONVERT_INT_SSE2(S32, S16)
+CONVERT_INT_SSE2(S32, FL32)
+CONVERT_INT_SSE2(S32, FL64)
+CONVERT_FLOAT_SSE2(FL32, U8, , false, 128.f, -128.f, 127.f)
+CONVERT_FLOAT_SSE2(FL32, U8, D, true, 128.f, -128.f, 127.f)
+CONVERT_FLOAT_SSE2(FL32, S16, , false, 32768.f, -32768.f, 32767.f)
+CONVERT_FLOAT_SSE2(FL32, S16, D, true, 32768.f, -32768.f, 32767.f)
+CONVERT_FLOAT_SSE2(FL32, S32, , false,
+                   2147483648.f, -2147483648.f, 2147483648.f)
+CONVERT_FLOAT_SSE2(FL64, U8, , false, 128., -128., 127.)
+CONVERT_FLOAT_SSE2(FL64, U8, D, true, 128., -128., 127.)
+CONVERT_FLOAT_SSE2(FL64, S16, , false, 32768., -32768., 32767.)
+CONVERT_FLOAT_SSE2(FL64, S16, D, true, 32768., -32768., 32767.)
+CONVERT_FLOAT_SSE2(FL64, S32, , false,
+                   2147483648., -2147483648., 2147483647.)
+#endif
+
+/*** AVX2 ***/
+
+#ifdef HAVE_AVX2_INTRINSICS
+# include <immintrin.h>
+
+__attribute__ ((__target__ ("avx2")))
+static inline __m256 TpdfAVX2(__m256i *state)
+{
+    __m256i x = *state;
+
+    x = _mm256_xor_si256(x, _mm256_slli_epi32(x, 13));
+    x = _mm256_xor_si256(x, _mm256_srli_epi32(x, 17));
+    x = _mm256_xor_si256(x, _mm256_slli_epi32(x, 5));
+    *state = x;
+
+    __m256i d = _mm256_sub_epi32(
+        _mm256_and_si256(x, _mm256_set1_epi32(0xffff)),
+        _mm256_srli_epi32(x, 16));
+    return _mm256_mul_ps(_mm256_cvtepi32_ps(d),
+                         _mm256_set1_ps(1.f / 65536.f));
+}
+
+__attribute__ ((__target__ ("avx2")))
+static inline __m256i LoadU8AVX2(const void *p, size_t i)
+{
+    __m128i v = _mm_loadl_epi64((const __m128i *)((const uint8_t *)p + i));
+
+    return _mm256_xor_si256(_mm256_slli_epi32(_mm256_cvtepu8_epi32(v), 24),
+                            _mm256_set1_epi32(INT32_MIN));
+}
+
+__attribute__ ((__target__ ("avx2")))
+static inline __m256i LoadS16AVX2(const void *p, size_t i)
+{
+    __m128i v = _mm_loadu_si128((const __m128i *)((const int16_t *)p + i));
+
+    return _mm256_slli_epi32(_mm256_cvtepi16_epi32(v), 16);
+}
+
+__attribute__ ((__target__ ("avx2")))
+static inline __m256i LoadS32AVX2(const void *p, size_t i)
+{
+    return _mm256_loadu_si256((const __m256i *)((const int32_t *)p + i));
+}
+
+__attribute__ ((__target__ ("avx2")))
+static inline __m128i Pack16AVX2(__m256i v)
+{
+    return _mm_packs_epi32(_mm256_castsi256_si128(v),
+                           _mm256_extracti128_si256(v, 1));
+}
+
+__attribute__ ((__target__ ("avx2")))
+static inline void StoreU8ScaledAVX2(void *p, size_t i, __m256i v)
+{
+    __m128i w = Pack16AVX2(v);
+
+    w = _mm_xor_si128(_mm_packs_epi16(w, w), _mm_set1_epi8(-128));
+    _mm_storel_epi64((__m128i *)((uint8_t *)p + i), w);
+}
+
+__attribute__ ((__target__ ("avx2")))
+static inline void StoreS16ScaledAVX2(void *p, size_t i, __m256i v)
+{
+    _mm_storeu_si128((__m128i *)((int16_t *)p + i), Pack16AVX2(v));
+}
+
+__attribute__ ((__target__ ("avx2")))
+static inline void StoreS32AVX2(void *p, size_t i, __m256i v)
+{
+    _mm256_storeu_si256((__m256i *)((int32_t *)p + i), v);
+}
+
+#define StoreS32ScaledAVX2 StoreS32AVX2
+
+__attribute__ ((__target__ ("avx2")))
+static inline void StoreU8AVX2(void *p, size_t i, __m256i v)
+{
+    StoreU8ScaledAVX2(p, i, _mm256_srai_epi32(v, 24));
+}
+
+__attribute__ ((__target__ ("avx2")))
+static inline void StoreS16AVX2(void *p, size_t i, __m256i v)
+{
+    StoreS16ScaledAVX2(p, i, _mm256_srai_epi32(v, 16));
+}
+
+__attribute__ ((__target__ ("avx2")))
+static inline void StoreFL32AVX2(void *p, size_t i, __m256i v)
+{
+    _mm256_storeu_ps((float *)p + i,
+                     _mm256_mul_ps(_mm256_cvtepi32_ps(v),
+                                   _mm256_set1_ps(1.f / 2147483648.f)));
+}
+
+__attribute__ ((__target__ ("avx2")))
+static inline void StoreFL64AVX2(void *p, size_t i, __m256i v)
+{
+    const __m256d scale = _mm256_set1_pd(1. / 2147483648.);
+    double *d = (double *)p + i;
+
+    _mm256_storeu_pd(d, _mm256_mul_pd(
+        _mm256_cvtepi32_pd(_mm256_castsi256_si128(v)), scale));
+    _mm256_storeu_pd(d + 4, _mm256_mul_pd(
+        _mm256_cvtepi32_pd(_mm256_extracti128_si256(v, 1)), scale));
+}
+
+__attribute__ ((__target__ ("avx2")))
+static inline __m256i RoundFL32AVX2(const void *p, size_t i, float scale,
+                                    float lo, float hi, bool dithered,
+                                    __m256 d)
+{
+    __m256 s = _mm256_mul_ps(_mm256_loadu_ps((const float *)p + i),
+                             _mm256_set1_ps(scale));
+
+    if (dithered)
+        s = _mm256_add_ps(s, d);
+    s = _mm256_min_ps(_mm256_max_ps(s, _mm256_set1_ps(lo)),
+                      _mm256_set1_ps(hi));
+
+    __m256i r = _mm256_cvtps_epi32(s);
+    if (hi >= 2147483648.f) /* 0x80000000 to INT32_MAX on overflow */
+        r = _mm256_xor_si256(r, _mm256_castps_si256(
+                _mm256_cmp_ps(s, _mm256_set1_ps(2147483648.f), _CMP_GE_OQ)));
+    return r;
+}
+
+__attribute__ ((__target__ ("avx2")))
+static inline __m128i RoundPDAVX2(const double *s, double scale, double lo,
+                                  double hi, bool dithered, __m128 d)
+{
+    __m256d x = _mm256_mul_pd(_mm256_loadu_pd(s), _mm256_set1_pd(scale));
+
+    if (dithered)
+        x = _mm256_add_pd(x, _mm256_cvtps_pd(d));
+    x = _mm256_min_pd(_mm256_max_pd(x, _mm256_set1_pd(lo)),
+                      _mm256_set1_pd(hi));
+    return _mm256_cvtpd_epi32(x);
+}
+
+__attribute__ ((__target__ ("avx2")))
+static inline __m256i RoundFL64AVX2(const void *p, size_t i, double scale,
+                                    double lo, double hi, bool dithered,
+                                    __m256 d)
+{
+    const double *s = (const double *)p + i;
+    __m128i a = RoundPDAVX2(s, scale, lo, hi, dithered,
+                            _mm256_castps256_ps128(d));
+    __m128i b = RoundPDAVX2(s + 4, scale, lo, hi, dithered,
+                            _mm256_extractf128_ps(d, 1));
+
+    return _mm256_inserti128_si256(_mm256_castsi128_si256(a), b, 1);
+}
+
+#define CONVERT_INT_AVX2(src, dst) \
+__attribute__ ((__target__ ("avx2"))) \
+static void src##to##dst##_AVX2(void *d, const void *s, size_t n, \
+                                pcm_dither_t *dither) \
+{ \
+    size_t i = 0; \
+    for (; i + 8 <= n; i += 8) \
+        Store##dst##AVX2(d, i, Load##src##AVX2(s, i)); \
+    for (; i < n; i++) \
+        Sample##src##to##dst(d, s, i, dither, false); \
+}
+
+#define CONVERT_FLOAT_AVX2(src, dst, suffix, dithered, scale, lo, hi) \
+__attribute__ ((__target__ ("avx2"))) \
+static void src##to##dst##suffix##_AVX2(void *d, const void *s, size_t n, \
+                                        pcm_dither_t *dither) \
+{ \
+    __m256i lanes = _mm256_setzero_si256(); \
+    size_t i = 0; \
+    if (dithered) \
+        lanes = _mm256_loadu_si256((const __m256i *)dither->lanes); \
+    for (; i + 8 <= n; i += 8) \
+    { \
+        __m256 dv = dithered ? TpdfAVX2(&lanes) : _mm256_setzero_ps(); \
+        Store##dst##ScaledAVX2(d, i, Round##src##AVX2(s, i, scale, lo, hi, \
+                                                      dithered, dv)); \
+    } \
+    if (dithered) \
+        _mm256_storeu_si256((__m256i *)dither->lanes, lanes); \
+    for (; i < n; i++) \
+        Sample##src##to##dst(d, s, i, dither, dithered); \
+}
+
+__attribute__ ((__target__ ("avx2")))
+static void FL32toFL64_AVX2(void *d, const void *s, size_t n,
+                            pcm_dither_t *dither)
+{
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        __m256 x = _mm256_loadu_ps((const float *)s + i);
+        double *out = (double *)d + i;
+
+        _mm256_storeu_pd(out, _mm256_cvtps_pd(_mm256_castps256_ps128(x)));
+        _mm256_storeu_pd(out + 4, _mm256_cvtps_pd(_mm256_extractf128_ps(x, 1)));
+    }
+    for (; i < n; i++)
+        SampleFL32toFL64(d, s, i, dither, false);
+}
+
+__attribute__ ((__target__ ("avx2")))
+static void FL64toFL32_AVX2(void *d, const void *s, size_t n,
+                            pcm_dither_t *dither)
+{
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        const double *in = (const double *)s + i;
+        __m128 x = _mm256_cvtpd_ps(_mm256_loadu_pd(in));
+        __m128 y = _mm256_cvtpd_ps(_mm256_loadu_pd(in + 4));
+
+        _mm_storeu_ps((float *)d + i, x);
+        _mm_storeu_ps((float *)d + i + 4, y);
+    }
+    for (; i < n; i++)
+        SampleFL64toFL32(d, s, i, dither, false);
+}
+
+CONVERT_INT_AVX2(U8, S16)
+CONVERT_INT_AVX2(U8, S32)
+CONVERT_INT_AVX2(U8, FL32)
+CONVERT_INT_AVX2(U8, FL64)
+CONVERT_INT_AVX2(S16, U8)
+CONVERT_INT_AVX2(S16, S32)
+CONVERT_INT_AVX2(S16, FL32)
+CONVERT_INT_AVX2(S16, FL64)
+CONVERT_INT_AVX2(S32, U8)
+CONVERT_INT_AVX2(S32, S16)
+CONVERT_INT_AVX2(S32, FL32)
+CONVERT_INT_AVX2(S32, FL64)
+CONVERT_FLOAT_AVX2(FL32, U8, , false, 128.f, -128.f, 127.f)
+CONVERT_FLOAT_AVX2(FL32, U8, D, true, 128.f, -128.f, 127.f)
+CONVERT_FLOAT_AVX2(FL32, S16, , false, 32768.f, -32768.f, 32767.f)
+CONVERT_FLOAT_AVX2(FL32, S16, D, true, 32768.f, -32768.f, 32767.f)
+CONVERT_FLOAT_AVX2(FL32, S32, , false,
+                   2147483648.f, -2147483648.f, 2147483648.f)
+CONVERT_FLOAT_AVX2(FL64, U8, , false, 128., -128., 127.)
+CONVERT_FLOAT_AVX2(FL64, U8, D, true, 128., -128., 127.)
+CONVERT_FLOAT_AVX2(FL64, S16, , false, 32768., -32768., 32767.)
+CONVERT_FLOAT_AVX2(FL64, S16, D, true, 32768., -32768., 32767.)
+CONVERT_FLOAT_AVX2(FL64, S32, , false,
+                   2147483648., -2147483648., 2147483647.)
+#endif
+
+/*** NEON ***/
+
+/* Rounding to nearest and double vectors need AArch64 */
+#if defined(__ARM_NEON) && defined(__aarch64__)
+# define HAVE_NEON_CONVERSIONS 1
+# include <arm_neon.h>
+
+static inline float32x4_t TpdfNEON(uint32x4_t *state)
+{
+    uint32x4_t x = *state;
+
+    x = veorq_u32(x, vshlq_n_u32(x, 13));
+    x = veorq_u32(x, vshrq_n_u32(x, 17));
+    x = veorq_u32(x, vshlq_n_u32(x, 5));
+    *state = x;
+
+    int32x4_t d = vsubq_s32(
+        vreinterpretq_s32_u32(vandq_u32(x, vdupq_n_u32(0xffff))),
+        vreinterpretq_s32_u32(vshrq_n_u32(x, 16)));
+    return vmulq_n_f32(vcvtq_f32_s32(d), 1.f / 65536.f);
+}
+
+static inline void LoadU8NEON(const void *p, size_t i,
+                              int32x4_t *a, int32x4_t *b)
+{
+    const uint32x4_t sign = vdupq_n_u32(0x80000000);
+    uint16x8_t v = vmovl_u8(vld1_u8((const uint8_t *)p + i));
+
+    *a = vreinterpretq_s32_u32(veorq_u32(
+            vshlq_n_u32(vmovl_u16(vget_low_u16(v)), 24), sign));
+    *b = vreinterpretq_s32_u32(veorq_u32(
+            vshlq_n_u32(vmovl_u16(vget_high_u16(v)), 24), sign));
+}
+
+static inline void LoadS16NEON(const void *p, size_t i,
+                               int32x4_t *a, int32x4_t *b)
+{
+    int16x8_t v = vld1q_s16((const int16_t *)p + i);
+
+    *a = vshll_n_s16(vget_low_s16(v), 16);
+    *b = vshll_n_s16(vget_high_s16(v), 16);
+}
+
+static inline void LoadS32NEON(const void *p, size_t i,
+                               int32x4_t *a, int32x4_t *b)
+{
+    *a = vld1q_s32((const int32_t *)p + i);
+    *b = vld1q_s32((const int32_t *)p + i + 4);
+}
+
+static inline void StoreU8ScaledNEON(void *p, size_t i,
+                                     int32x4_t a, int32x4_t b)
+{
+    int8x8_t v = vmovn_s16(vcombine_s16(vmovn_s32(a), vmovn_s32(b)));
+
+    vst1_u8((uint8_t *)p + i,
+            veor_u8(vreinterpret_u8_s8(v), vdup_n_u8(0x80)));
+}
+
+static inline void StoreS16ScaledNEON(void *p, size_t i,
+                                      int32x4_t a, int32x4_t b)
+{
+    vst1q_s16((int16_t *)p + i, vcombine_s16(vmovn_s32(a), vmovn_s32(b)));
+}
+
+static inline void StoreS32NEON(void *p, size_t i, int32x4_t a, int32x4_t b)
+{
+    vst1q_s32((int32_t *)p + i, a);
+    vst1q_s32((int32_t *)p + i + 4, b);
+}
+
+#define StoreS32ScaledNEON StoreS32NEON
+
+static inline void StoreU8NEON(void *p, size_t i, int32x4_t a, int32x4_t b)
+{
+    StoreU8ScaledNEON(p, i, vshrq_n_s32(a, 24), vshrq_n_s32(b, 24));
+}
+
+static inline void StoreS16NEON(void *p, size_t i, int32x4_t a, int32x4_t b)
+{
+    vst1q_s16((int16_t *)p + i,
+              vcombine_s16(vshrn_n_s32(a, 16), vshrn_n_s32(b, 16)));
+}
+
+static inline void StoreFL32NEON(void *p, size_t i, int32x4_t a, int32x4_t b)
+{
+    float *d = (float *)p + i;
+
+    vst1q_f32(d, vmulq_n_f32(vcvtq_f32_s32(a), 1.f / 2147483648.f));
+    vst1q_f32(d + 4, vmulq_n_f32(vcvtq_f32_s32(b), 1.f / 2147483648.f));
+}
+
+static inline void StoreFL64NEON(void *p, size_t i, int32x4_t a, int32x4_t b)
+{
+    const double scale = 1. / 2147483648.;
+    double *d = (double *)p + i;
+
+    vst1q_f64(d, vmulq_n_f64(vcvtq_f64_s64(vmovl_s32(vget_low_s32(a))),
+                             scale));
+    vst1q_f64(d + 2, vmulq_n_f64(vcvtq_f64_s64(vmovl_s32(vget_high_s32(a))),
+                                 scale));
+    vst1q_f64(d + 4, vmulq_n_f64(vcvtq_f64_s64(vmovl_s32(vget_low_s32(b))),
+                                 scale));
+    vst1q_f64(d + 6, vmulq_n_f64(vcvtq_f64_s64(vmovl_s32(vget_high_s32(b))),
+                                 scale));
+}
+
+static inline int32x4_t RoundPSNEON(const float *s, float scale, float lo,
+                                    float hi, bool dithered, float32x4_t d)
+{
+    float32x4_t x = vmulq_n_f32(vld1q_f32(s), scale);
+
+    if (dithered)
+        x = vaddq_f32(x, d);
+    /* the number wins over NaN, the conversion saturates */
+    x = vminnmq_f32(vmaxnmq_f32(x, vdupq_n_f32(lo)), vdupq_n_f32(hi));
+    return vcvtnq_s32_f32(x);
+}
+
+static inline void RoundFL32NEON(const void *p, size_t i, float scale,
+                                 float lo, float hi, bool dithered,
+                                 float32x4_t da, float32x4_t db,
+                                 int32x4_t *a, int32x4_t *b)
+{
+    const float *s = (const float *)p + i;
+
+    *a = RoundPSNEON(s, scale, lo, hi, dithered, da);
+    *b = RoundPSNEON(s + 4, scale, lo, hi, dithered, db);
+}
+
+static inline int32x2_t RoundPDNEON(const double *s, double scale, double lo,
+                                    double hi, float64x2_t d, bool dithered)
+{
+    float64x2_t x = vmulq_n_f64(vld1q_f64(s), scale);
+
+    if (dithered)
+        x = vaddq_f64(x, d);
+    x = vminnmq_f64(vmaxnmq_f64(x, vdupq_n_f64(lo)), vdupq_n_f64(hi));
+    return vmovn_s64(vcvtnq_s64_f64(x));
+}
+
+static inline int32x4_t RoundPD4NEON(const double *s, double scale, double lo,
+                                     double hi, bool dithered, float32x4_t d)
+{
+    return vcombine_s32(
+        RoundPDNEON(s, scale, lo, hi, vcvt_f64_f32(vget_low_f32(d)),
+                    dithered),
+        RoundPDNEON(s + 2, scale, lo, hi, vcvt_high_f64_f32(d), dithered));
+}
+
+static inline void RoundFL64NEON(const void *p, size_t i, double scale,
+                                 double lo, double hi, bool dithered,
+                                 float32x4_t da, float32x4_t db,
+                                 int32x4_t *a, int32x4_t *b)
+{
+    const double *s = (const double *)p + i;
+
+    *a = RoundPD4NEON(s, scale, lo, hi, dithered, da);
+    *b = RoundPD4NEON(s + 4, scale, lo, hi, dithered, db);
+}
+
+#define CONVERT_INT_NEON(src, dst) \
+static void src##to##dst##_NEON(void *d, const void *s, size_t n, \
+                                pcm_dither_t *dither) \
+{ \
+    size_t i = 0; \
+    for (; i + 8 <= n; i += 8) \
+    { \
+        int32x4_t a, b; \
+        Load##src##NEON(s, i, &a, &b); \
+        Store##dst##NEON(d, i, a, b); \
+    } \
+    for (; i < n; i++) \
+        Sample##src##to##dst(d, s, i, dither, false); \
+}
+
+#define CONVERT_FLOAT_NEON(src, dst, suffix, dithered, scale, lo, hi) \
+static void src##to##dst##suffix##_NEON(void *d, const void *s, size_t n, \
+                                        pcm_dither_t *dither) \
+{ \
+    uint32x4_t la = vdupq_n_u32(0), lb = vdupq_n_u32(0); \
+    size_t i = 0; \
+    if (dithered) \
+    { \
+        la = vld1q_u32(dither->lanes); \
+        lb = vld1q_u32(dither->lanes + 4); \
+    } \
+    for (; i + 8 <= n; i += 8) \
+    { \
+        float32x4_t da = vdupq_n_f32(0.f), db = vdupq_n_f32(0.f); \
+        int32x4_t a, b; \
+        if (dithered) \
+        { \
+            da = TpdfNEON(&la); \
+            db = TpdfNEON(&lb); \
+        } \
+        Round##src##NEON(s, i, scale, lo, hi, dithered, da, db, &a, &b); \
+        Store##dst##ScaledNEON(d, i, a, b); \
+    } \
+    if (dithered) \
+    { \
+        vst1q_u32(dither->lanes, la); \
+        vst1q_u32(dither->lanes + 4, lb); \
+    } \
+    for (; i < n; i++) \
+        Sample##src##to##dst(d, s, i, dither, dithered); \
+}
+
+static void FL32toFL64_NEON(void *d, const void *s, size_t n,
+                            pcm_dither_t *dither)
+{
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        const float *in = (const float *)s + i;
+        double *out = (double *)d + i;
+        float32x4_t x = vld1q_f32(in), y = vld1q_f32(in + 4);
+
+        vst1q_f64(out, vcvt_f64_f32(vget_low_f32(x)));
+        vst1q_f64(out + 2, vcvt_high_f64_f32(x));
+        vst1q_f64(out + 4, vcvt_f64_f32(vget_low_f32(y)));
+        vst1q_f64(out + 6, vcvt_high_f64_f32(y));
+    }
+    for (; i < n; i++)
+        SampleFL32toFL64(d, s, i, dither, false);
+}
+
+static void FL64toFL32_NEON(void *d, const void *s, size_t n,
+                            pcm_dither_t *dither)
+{
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        const double *in = (const double *)s + i;
+        float *out = (float *)d + i;
+
+        vst1q_f32(out, vcombine_f32(vcvt_f32_f64(vld1q_f64(in)),
+                                    vcvt_f32_f64(vld1q_f64(in + 2))));
+        vst1q_f32(out + 4, vcombine_f32(vcvt_f32_f64(vld1q_f64(in + 4)),
+                                        vcvt_f32_f64(vld1q_f64(in + 6))));
+    }
+    for (; i < n; i++)
+        SampleFL64toFL32(d, s, i, dither, false);
+}
+
+CONVERT_INT_NEON(U8, S16)
+CONVERT_INT_NEON(U8, S32)
+CONVERT_INT_NEON(U8, FL32)
+CONVERT_INT_NEON(U8, FL64)
+CONVERT_INT_NEON(S16, U8)
+CONVERT_INT_NEON(S16, S32)
+CONVERT_INT_NEON(S16, FL32)
+CONVERT_INT_NEON(S16, FL64)
+CONVERT_INT_NEON(S32, U8)
+CONVERT_INT_NEON(S32, S16)
+CONVERT_INT_NEON(S32, FL32)
+CONVERT_INT_NEON(S32, FL64)
+CONVERT_FLOAT_NEON(FL32, U8, , false, 128.f, -128.f, 127.f)
+CONVERT_FLOAT_NEON(FL32, U8, D, true, 128.f, -128.f, 127.f)
+CONVERT_FLOAT_NEON(FL32, S16, , false, 32768.f, -32768.f, 32767.f)
+CONVERT_FLOAT_NEON(FL32, S16, D, true, 32768.f, -32768.f, 32767.f)
+CONVERT_FLOAT_NEON(FL32, S32, , false,
+                   2147483648.f, -2147483648.f, 2147483648.f)
+CONVERT_FLOAT_NEON(FL64, U8, , false, 128., -128., 127.)
+CONVERT_FLOAT_NEON(FL64, U8, D, true, 128., -128., 127.)
+CONVERT_FLOAT_NEON(FL64, S16, , false, 32768., -32768., 32767.)
+CONVERT_FLOAT_NEON(FL64, S16, D, true, 32768., -32768., 32767.)
+CONVERT_FLOAT_NEON(FL64, S32, , false,
+                   2147483648., -2147483648., 2147483647.)
+#endif
+
+/*** Dispatch ***/
+
+CONVERT_C(U8, S16, , false)
+CONVERT_C(U8, S32, , false)
+CONVERT_C(U8, FL32, , false)
+CONVERT_C(U8, FL64, , false)
+CONVERT_C(S16, U8, , false)
+CONVERT_C(S16, S32, , false)
+CONVERT_C(S16, FL32, , false)
+CONVERT_C(S16, FL64, , false)
+CONVERT_C(S32, U8, , false)
+CONVERT_C(S32, S16, , false)
+CONVERT_C(S32, FL32, , false)
+CONVERT_C(S32, FL64, , false)
+CONVERT_C(FL32, U8, , false)
+CONVERT_C(FL32, U8, D, true)
+CONVERT_C(FL32, S16, , false)
+CONVERT_C(FL32, S16, D, true)
+CONVERT_C(FL32, S32, , false)
+CONVERT_C(FL32, FL64, , false)
+CONVERT_C(FL64, U8, , false)
+CONVERT_C(FL64, U8, D, true)
+CONVERT_C(FL64, S16, , false)
+CONVERT_C(FL64, S16, D, true)
+CONVERT_C(FL64, S32, , false)
+CONVERT_C(FL64, FL32, , false)
+
+#ifdef HAVE_SSE2_INTRINSICS
+# define SSE2_IMPL(name) name##_SSE2
+#else
+# define SSE2_IMPL(name) NULL
+#endif
+#ifdef HAVE_AVX2_INTRINSICS
+# define AVX2_IMPL(name) name##_AVX2
+#else
+# define AVX2_IMPL(name) NULL
+#endif
+#ifdef HAVE_NEON_CONVERSIONS
+# define NEON_IMPL(name) name##_NEON
+#else
+# define NEON_IMPL(name) NULL
+#endif
+
+#define CONVERSION(src, dst, dither, name) \
+    { VLC_CODEC_##src, VLC_CODEC_##dst, dither, { \
+        [PCM_CVT_ISA_C] = name##_C, \
+        [PCM_CVT_ISA_SSE2] = SSE2_IMPL(name), \
+        [PCM_CVT_ISA_AVX2] = AVX2_IMPL(name), \
+        [PCM_CVT_ISA_NEON] = NEON_IMPL(name), \
+    } }
+
+static const struct
+{
+    vlc_fourcc_t src;
+    vlc_fourcc_t dst;
+    bool dither;
+    pcm_convert_t impl[PCM_CVT_ISA_COUNT];
+} conversions[] =
+{
+    CONVERSION(U8, S16N, false, U8toS16),
+    CONVERSION(U8, S32N, false, U8toS32),
+    CONVERSION(U8, FL32, false, U8toFL32),
+    CONVERSION(U8, FL64, false, U8toFL64),
+    CONVERSION(S16N, U8, false, S16toU8),
+    CONVERSION(S16N, S32N, false, S16toS32),
+    CONVERSION(S16N, FL32, false, S16toFL32),
+    CONVERSION(S16N, FL64, false, S16toFL64),
+    CONVERSION(S32N, U8, false, S32toU8),
+    CONVERSION(S32N, S16N, false, S32toS16),
+    CONVERSION(S32N, FL32, false, S32toFL32),
+    CONVERSION(S32N, FL64, false, S32toFL64),
+    CONVERSION(FL32, U8, false, FL32toU8),
+    CONVERSION(FL32, U8, true, FL32toU8D),
+    CONVERSION(FL32, S16N, false, FL32toS16),
+    CONVERSION(FL32, S16N, true, FL32toS16D),
+    CONVERSION(FL32, S32N, false, FL32toS32),
+    CONVERSION(FL32, FL64, false, FL32toFL64),
+    CONVERSION(FL64, U8, false, FL64toU8),
+    CONVERSION(FL64, U8, true, FL64toU8D),
+    CONVERSION(FL64, S16N, false, FL64toS16),
+    CONVERSION(FL64, S16N, true, FL64toS16D),
+    CONVERSION(FL64, S32N, false, FL64toS32),
+    CONVERSION(FL64, FL32, false, FL64toFL32),
+};
+
+static bool IsaAvailable(int isa)
+{
+    switch (isa)
+    {
+        case PCM_CVT_ISA_C:
+            return true;
+#ifdef HAVE_SSE2_INTRINSICS
+        case PCM_CVT_ISA_SSE2:
+            return vlc_CPU_SSE2();
+#endif
+#ifdef HAVE_AVX2_INTRINSICS
+        case PCM_CVT_ISA_AVX2:
+            return vlc_CPU_AVX2();
+#endif
+#ifdef HAVE_NEON_CONVERSIONS
+        case PCM_CVT_ISA_NEON:
+            return vlc_CPU_ARM_NEON();
+#endif
+        default:
+            return false;
+    }
+}
+
+pcm_convert_t pcm_GetConversion(vlc_fourcc_t src, vlc_fourcc_t dst,
+                                bool dither, int isa)
+{
+    size_t found = ARRAY_SIZE(conversions);
+
+    /* the dithered variant, if any, follows the plain one */
+    for (size_t i = 0; i < ARRAY_SIZE(conversions); i++)
+        if (conversions[i].src == src && conversions[i].dst == dst)
+        {
+            found = i;
+            if (conversions[i].dither == dither)
+                break;
+        }
+    if (found == ARRAY_SIZE(conversions))
+        return NULL;
+
+    if (isa == PCM_CVT_ISA_AUTO)
+    {
+        for (isa = PCM_CVT_ISA_COUNT - 1; isa > PCM_CVT_ISA_C; isa--)
+            if (conversions[found].impl[isa] != NULL && IsaAvailable(isa))
+                break;
+    }
+    else if (!IsaAvailable(isa))
+        return NULL;
+    return conversions[found].impl[isa];
+}
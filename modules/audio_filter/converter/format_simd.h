@@ -0,0 +1,81 @@
+/*****************************************************************************
+ * format_simd.h : SIMD PCM format conversions
+ *****************************************************************************
+ * Copyright (C) 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_AUDIO_FORMAT_SIMD_H
+#define VLC_AUDIO_FORMAT_SIMD_H 1
+
+/**
+ * \file
+ * Converts samples between U8, S16N, S32N, FL32 and FL64.
+ *
+ * Integer samples are scaled as is, floating point samples are rounded to
+ * the nearest integer, ties to even, after being clipped to the integer
+ * range. NaN converts to the lowest integer.
+ *
+ * All the implementations produce exactly the same samples as the C one,
+ * dither included, whatever the length and the alignment of the buffers.
+ * Conversions to smaller samples can be done in place.
+ */
+
+enum pcm_cvt_isa
+{
+    PCM_CVT_ISA_AUTO = -1, /**< best implementation available */
+    PCM_CVT_ISA_C,
+    PCM_CVT_ISA_SSE2,
+    PCM_CVT_ISA_AVX2,
+    PCM_CVT_ISA_NEON,
+    PCM_CVT_ISA_COUNT,
+};
+
+#define PCM_DITHER_LANES 8
+
+/**
+ * Dither generator: sample i of a conversion uses the lane i modulo
+ * PCM_DITHER_LANES.
+ */
+typedef struct
+{
+    uint32_t lanes[PCM_DITHER_LANES];
+} pcm_dither_t;
+
+/**
+ * Converts count samples.
+ *
+ * \param dither state of the dither generator, only used by the dithered
+ * conversions
+ */
+typedef void (*pcm_convert_t)(void *dst, const void *src, size_t count,
+                              pcm_dither_t *dither);
+
+void pcm_DitherInit(pcm_dither_t *, uint32_t seed);
+
+/**
+ * Returns a conversion.
+ *
+ * \param dither whether to add triangular dither of one LSB peak, only
+ * applies to floating point to U8 or S16N conversions
+ * \param isa one of pcm_cvt_isa
+ * \return the conversion, or NULL if the pair of formats is not handled or
+ * if the requested implementation is not available
+ */
+pcm_convert_t pcm_GetConversion(vlc_fourcc_t src, vlc_fourcc_t dst,
+                                bool dither, int isa);
+
+#endif
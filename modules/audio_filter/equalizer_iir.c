@@ -0,0 +1,547 @@
+/*****************************************************************************
+ * equalizer_iir.c: Equalizer band-pass filter bank
+ *****************************************************************************
+ * Copyright © 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <assert.h>
+
+#include <vlc_common.h>
+#include <vlc_cpu.h>
+
+#include "equalizer_iir.h"
+
+/*
+ * Every band is a second order band-pass filter:
+ *   y[n] = alpha * (x[n] - x[n-2]) + gamma * y[n-1] - beta * y[n-2]
+ *
+ * The channels are processed one after the other, so that the state of a
+ * channel stays in registers for the whole buffer, and the bands of a
+ * channel are processed together in vectors.
+ */
+
+static float BankC(const eqz_coeffs_t *c, eqz_state_t *s, float in)
+{
+    float o = 0.f;
+
+    for (unsigned j = 0; j < c->bands; j++)
+    {
+        const float y = c->alpha[j] * (in - s->x[1]) + c->gamma[j] * s->y0[j]
+                      - c->beta[j] * s->y1[j];
+
+        s->y1[j] = s->y0[j];
+        s->y0[j] = y;
+        o += y * c->amp[j];
+    }
+    s->x[1] = s->x[0];
+    s->x[0] = in;
+    return o;
+}
+
+void eqz_Filter_C(const eqz_coeffs_t *coeffs, eqz_state_t *state,
+                  eqz_state_t *state2, float gain, float *buf, size_t frames,
+                  unsigned channels)
+{
+    /* Work on copies, so that the stores to the buffer do not reload them */
+    const eqz_coeffs_t c = *coeffs;
+
+    for (unsigned ch = 0; ch < channels; ch++)
+    {
+        eqz_state_t s = state[ch];
+        float *p = buf + ch;
+
+        if (state2 == NULL)
+        {
+            for (size_t i = 0; i < frames; i++, p += channels)
+            {
+                const float in = *p;
+                *p = gain * (EQZ_IN_FACTOR * in + BankC(&c, &s, in));
+            }
+        }
+        else
+        {
+            eqz_state_t s2 = state2[ch];
+
+            for (size_t i = 0; i < frames; i++, p += channels)
+            {
+                const float in = *p;
+                const float in2 = EQZ_IN_FACTOR * in + BankC(&c, &s, in);
+                *p = gain * (EQZ_IN_FACTOR * in2 + BankC(&c, &s2, in2));
+            }
+            state2[ch] = s2;
+        }
+        state[ch] = s;
+    }
+}
+
+#ifdef HAVE_SSE2_INTRINSICS
+# include <emmintrin.h>
+
+typedef struct
+{
+    __m128 alpha[EQZ_LANES / 4], beta[EQZ_LANES / 4];
+    __m128 gamma[EQZ_LANES / 4], amp[EQZ_LANES / 4];
+} bank_sse2_t;
+
+typedef struct
+{
+    __m128 y0[EQZ_LANES / 4], y1[EQZ_LANES / 4];
+    float x[2];
+} state_sse2_t;
+
+__attribute__ ((__target__ ("sse2")))
+static inline float BankSSE2(const bank_sse2_t *b, state_sse2_t *s, float in)
+{
+    const __m128 d = _mm_set1_ps(in - s->x[1]);
+    __m128 sum = _mm_setzero_ps();
+
+    for (unsigned v = 0; v < EQZ_LANES / 4; v++)
+    {
+        const __m128 y = _mm_sub_ps(
+            _mm_add_ps(_mm_mul_ps(b->alpha[v], d),
+                       _mm_mul_ps(b->gamma[v], s->y0[v])),
+            _mm_mul_ps(b->beta[v], s->y1[v]));
+
+        s->y1[v] = s->y0[v];
+        s->y0[v] = y;
+        sum = _mm_add_ps(sum, _mm_mul_ps(y, b->amp[v]));
+    }
+    s->x[1] = s->x[0];
+    s->x[0] = in;
+
+    sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+    sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+    return _mm_cvtss_f32(sum);
+}
+
+__attribute__ ((__target__ ("sse2")))
+static void LoadSSE2(state_sse2_t *dst, const eqz_state_t *src)
+{
+    for (unsigned v = 0; v < EQZ_LANES / 4; v++)
+    {
+        dst->y0[v] = _mm_load_ps(src->y0 + 4 * v);
+        dst->y1[v] = _mm_load_ps(src->y1 + 4 * v);
+    }
+    dst->x[0] = src->x[0];
+    dst->x[1] = src->x[1];
+}
+
+__attribute__ ((__target__ ("sse2")))
+static void StoreSSE2(eqz_state_t *dst, const state_sse2_t *src)
+{
+    for (unsigned v = 0; v < EQZ_LANES / 4; v++)
+    {
+        _mm_store_ps(dst->y0 + 4 * v, src->y0[v]);
+        _mm_store_ps(dst->y1 + 4 * v, src->y1[v]);
+    }
+    dst->x[0] = src->x[0];
+    dst->x[1] = src->x[1];
+}
+
+__attribute__ ((__target__ ("sse2")))
+static void FilterSSE2(const eqz_coeffs_t *coeffs, eqz_state_t *state,
+                       eqz_state_t *state2, float gain, float *buf,
+                       size_t frames, unsigned channels)
+{
+    bank_sse2_t b;
+
+    for (unsigned v = 0; v < EQZ_LANES / 4; v++)
+    {
+        b.alpha[v] = _mm_load_ps(coeffs->alpha + 4 * v);
+        b.beta[v] = _mm_load_ps(coeffs->beta + 4 * v);
+        b.gamma[v] = _mm_load_ps(coeffs->gamma + 4 * v);
+        b.amp[v] = _mm_load_ps(coeffs->amp + 4 * v);
+    }
+
+    for (unsigned ch = 0; ch < channels; ch++)
+    {
+        state_sse2_t s;
+        float *p = buf + ch;
+
+        LoadSSE2(&s, &state[ch]);
+        if (state2 == NULL)
+        {
+            for (size_t i = 0; i < frames; i++, p += channels)
+            {
+                const float in = *p;
+                *p = gain * (EQZ_IN_FACTOR * in + BankSSE2(&b, &s, in));
+            }
+        }
+        else
+        {
+            state_sse2_t s2;
+
+            LoadSSE2(&s2, &state2[ch]);
+            for (size_t i = 0; i < frames; i++, p += channels)
+            {
+                const float in = *p;
+                const float in2 = EQZ_IN_FACTOR * in + BankSSE2(&b, &s, in);
+                *p = gain * (EQZ_IN_FACTOR * in2 + BankSSE2(&b, &s2, in2));
+            }
+            StoreSSE2(&state2[ch], &s2);
+        }
+        StoreSSE2(&state[ch], &s);
+    }
+}
+#endif
+
+#ifdef HAVE_AVX2_INTRINSICS
+# include <immintrin.h>
+
+typedef struct
+{
+    __m256 alpha[EQZ_LANES / 8], beta[EQZ_LANES / 8];
+    __m256 gamma[EQZ_LANES / 8], amp[EQZ_LANES / 8];
+} bank_avx2_t;
+
+typedef struct
+{
+    __m256 y0[EQZ_LANES / 8], y1[EQZ_LANES / 8];
+    float x[2];
+} state_avx2_t;
+
+__attribute__ ((__target__ ("avx2")))
+static inline float BankAVX2(const bank_avx2_t *b, state_avx2_t *s, float in)
+{
+    const __m256 d = _mm256_set1_ps(in - s->x[1]);
+    __m256 sum = _mm256_setzero_ps();
+
+    for (unsigned v = 0; v < EQZ_LANES / 8; v++)
+    {
+        const __m256 y = _mm256_sub_ps(
+            _mm256_add_ps(_mm256_mul_ps(b->alpha[v], d),
+                          _mm256_mul_ps(b->gamma[v], s->y0[v])),
+            _mm256_mul_ps(b->beta[v], s->y1[v]));
+
+        s->y1[v] = s->y0[v];
+        s->y0[v] = y;
+        sum = _mm256_add_ps(sum, _mm256_mul_ps(y, b->amp[v]));
+    }
+    s->x[1] = s->x[0];
+    s->x[0] = in;
+
+    __m128 v = _mm_add_ps(_mm256_castps256_ps128(sum),
+                          _mm256_extractf128_ps(sum, 1));
+    v = _mm_add_ps(v, _mm_movehl_ps(v, v));
+    v = _mm_add_ss(v, _mm_shuffle_ps(v, v, 1));
+    return _mm_cvtss_f32(v);
+}
+
+__attribute__ ((__target__ ("avx2")))
+static void LoadAVX2(state_avx2_t *dst, const eqz_state_t *src)
+{
+    for (unsigned v = 0; v < EQZ_LANES / 8; v++)
+    {
+        dst->y0[v] = _mm256_load_ps(src->y0 + 8 * v);
+        dst->y1[v] = _mm256_load_ps(src->y1 + 8 * v);
+    }
+    dst->x[0] = src->x[0];
+    dst->x[1] = src->x[1];
+}
+
+__attribute__ ((__target__ ("avx2")))
+static void StoreAVX2(eqz_state_t *dst, const state_avx2_t *src)
+{
+    for (unsigned v = 0; v < EQZ_LANES / 8; v++)
+    {
+        _mm256_store_ps(dst->y0 + 8 * v, src->y0[v]);
+        _mm256_store_ps(dst->y1 + 8 * v, src->y1[v]);
+    }
+    dst->x[0] = src->x[0];
+    dst->x[1] = src->x[1];
+}
+
+__attribute__ ((__target__ ("avx2")))
+static void FilterAVX2(const eqz_coeffs_t *coeffs, eqz_state_t *state,
+                       eqz_state_t *state2, float gain, float *buf,
+                       size_t frames, unsigned channels)
+{
+    bank_avx2_t b;
+
+    for (unsigned v = 0; v < EQZ_LANES / 8; v++)
+    {
+        b.alpha[v] = _mm256_load_ps(coeffs->alpha + 8 * v);
+        b.beta[v] = _mm256_load_ps(coeffs->beta + 8 * v);
+        b.gamma[v] = _mm256_load_ps(coeffs->gamma + 8 * v);
+        b.amp[v] = _mm256_load_ps(coeffs->amp + 8 * v);
+    }
+
+    for (unsigned ch = 0; ch < channels; ch++)
+    {
+        state_avx2_t s;
+        float *p = buf + ch;
+
+        LoadAVX2(&s, &state[ch]);
+        if (state2 == NULL)
+        {
+            for (size_t i = 0; i < frames; i++, p += channels)
+            {
+                const float in = *p;
+                *p = gain * (EQZ_IN_FACTOR * in + BankAVX2(&b, &s, in));
+            }
+        }
+        else
+        {
+            state_avx2_t s2;
+
+            LoadAVX2(&s2, &state2[ch]);
+            for (size_t i = 0; i < frames; i++, p += channels)
+            {
+                const float in = *p;
+                const float in2 = EQZ_IN_FACTOR * in + BankAVX2(&b, &s, in);
+                *p = gain * (EQZ_IN_FACTOR * in2 + BankAVX2(&b, &s2, in2));
+            }
+            StoreAVX2(&state2[ch], &s2);
+        }
+        StoreAVX2(&state[ch], &s);
+    }
+}
+#endif
+
+#ifdef HAVE_AVX512_INTRINSICS
+# include <immintrin.h>
+
+typedef struct
+{
+    __m512 y0, y1;
+    float x[2];
+} state_avx512_t;
+
+__attribute__ ((__target__ ("avx512f")))
+static inline float BankAVX512(__m512 alpha, __m512 beta, __m512 gamma,
+                               __m512 amp, state_avx512_t *s, float in)
+{
+    const __m512 d = _mm512_set1_ps(in - s->x[1]);
+    const __m512 y = _mm512_sub_ps(
+        _mm512_add_ps(_mm512_mul_ps(alpha, d), _mm512_mul_ps(gamma, s->y0)),
+        _mm512_mul_ps(beta, s->y1));
+
+    s->y1 = s->y0;
+    s->y0 = y;
+    s->x[1] = s->x[0];
+    s->x[0] = in;
+    return _mm512_reduce_add_ps(_mm512_mul_ps(y, amp));
+}
+
+__attribute__ ((__target__ ("avx512f")))
+static void LoadAVX512(state_avx512_t *dst, const eqz_state_t *src)
+{
+    dst->y0 = _mm512_load_ps(src->y0);
+    dst->y1 = _mm512_load_ps(src->y1);
+    dst->x[0] = src->x[0];
+    dst->x[1] = src->x[1];
+}
+
+__attribute__ ((__target__ ("avx512f")))
+static void StoreAVX512(eqz_state_t *dst, const state_avx512_t *src)
+{
+    _mm512_store_ps(dst->y0, src->y0);
+    _mm512_store_ps(dst->y1, src->y1);
+    dst->x[0] = src->x[0];
+    dst->x[1] = src->x[1];
+}
+
+__attribute__ ((__target__ ("avx512f")))
+static void FilterAVX512(const eqz_coeffs_t *coeffs, eqz_state_t *state,
+                         eqz_state_t *state2, float gain, float *buf,
+                         size_t frames, unsigned channels)
+{
+    static_assert (EQZ_LANES == 16, "one vector per bank");
+    const __m512 alpha = _mm512_load_ps(coeffs->alpha);
+    const __m512 beta = _mm512_load_ps(coeffs->beta);
+    const __m512 gamma = _mm512_load_ps(coeffs->gamma);
+    const __m512 amp = _mm512_load_ps(coeffs->amp);
+
+    for (unsigned ch = 0; ch < channels; ch++)
+    {
+        state_avx512_t s;
+        float *p = buf + ch;
+
+        LoadAVX512(&s, &state[ch]);
+        if (state2 == NULL)
+        {
+            for (size_t i = 0; i < frames; i++, p += channels)
+            {
+                const float in = *p;
+                *p = gain * (EQZ_IN_FACTOR * in
+                             + BankAVX512(alpha, beta, gamma, amp, &s, in));
+            }
+        }
+        else
+        {
+            state_avx512_t s2;
+
+            LoadAVX512(&s2, &state2[ch]);
+            for (size_t i = 0; i < frames; i++, p += channels)
+            {
+                const float in = *p;
+                const float in2 = EQZ_IN_FACTOR * in
+                                + BankAVX512(alpha, beta, gamma, amp, &s, in);
+                *p = gain * (EQZ_IN_FACTOR * in2
+                             + BankAVX512(alpha, beta, gamma, amp, &s2, in2));
+            }
+            StoreAVX512(&state2[ch], &s2);
+        }
+        StoreAVX512(&state[ch], &s);
+    }
+}
+#endif
+
+#ifdef __ARM_NEON
+# include <arm_neon.h>
+
+typedef struct
+{
+    float32x4_t alpha[EQZ_LANES / 4], beta[EQZ_LANES / 4];
+    float32x4_t gamma[EQZ_LANES / 4], amp[EQZ_LANES / 4];
+} bank_neon_t;
+
+typedef struct
+{
+    float32x4_t y0[EQZ_LANES / 4], y1[EQZ_LANES / 4];
+    float x[2];
+} state_neon_t;
+
+static inline float BankNEON(const bank_neon_t *b, state_neon_t *s, float in)
+{
+    const float32x4_t d = vdupq_n_f32(in - s->x[1]);
+    float32x4_t sum = vdupq_n_f32(0);
+
+    for (unsigned v = 0; v < EQZ_LANES / 4; v++)
+    {
+        const float32x4_t y = vsubq_f32(
+            vaddq_f32(vmulq_f32(b->alpha[v], d),
+                      vmulq_f32(b->gamma[v], s->y0[v])),
+            vmulq_f32(b->beta[v], s->y1[v]));
+
+        s->y1[v] = s->y0[v];
+        s->y0[v] = y;
+        sum = vaddq_f32(sum, vmulq_f32(y, b->amp[v]));
+    }
+    s->x[1] = s->x[0];
+    s->x[0] = in;
+
+    float32x2_t v = vadd_f32(vget_low_f32(sum), vget_high_f32(sum));
+    return vget_lane_f32(vpadd_f32(v, v), 0);
+}
+
+static void LoadNEON(state_neon_t *dst, const eqz_state_t *src)
+{
+    for (unsigned v = 0; v < EQZ_LANES / 4; v++)
+    {
+        dst->y0[v] = vld1q_f32(src->y0 + 4 * v);
+        dst->y1[v] = vld1q_f32(src->y1 + 4 * v);
+    }
+    dst->x[0] = src->x[0];
+    dst->x[1] = src->x[1];
+}
+
+static void StoreNEON(eqz_state_t *dst, const state_neon_t *src)
+{
+    for (unsigned v = 0; v < EQZ_LANES / 4; v++)
+    {
+        vst1q_f32(dst->y0 + 4 * v, src->y0[v]);
+        vst1q_f32(dst->y1 + 4 * v, src->y1[v]);
+    }
+    dst->x[0] = src->x[0];
+    dst->x[1] = src->x[1];
+}
+
+static void FilterNEON(const eqz_coeffs_t *coeffs, eqz_state_t *state,
+                       eqz_state_t *state2, float gain, float *buf,
+                       size_t frames, unsigned channels)
+{
+    bank_neon_t b;
+
+    for (unsigned v = 0; v < EQZ_LANES / 4; v++)
+    {
+        b.alpha[v] = vld1q_f32(coeffs->alpha + 4 * v);
+        b.beta[v] = vld1q_f32(coeffs->beta + 4 * v);
+        b.gamma[v] = vld1q_f32(coeffs->gamma + 4 * v);
+        b.amp[v] = vld1q_f32(coeffs->amp + 4 * v);
+    }
+
+    for (unsigned ch = 0; ch < channels; ch++)
+    {
+        state_neon_t s;
+        float *p = buf + ch;
+
+        LoadNEON(&s, &state[ch]);
+        if (state2 == NULL)
+        {
+            for (size_t i = 0; i < frames; i++, p += channels)
+            {
+                const float in = *p;
+                *p = gain * (EQZ_IN_FACTOR * in + BankNEON(&b, &s, in));
+            }
+        }
+        else
+        {
+            state_neon_t s2;
+
+            LoadNEON(&s2, &state2[ch]);
+            for (size_t i = 0; i < frames; i++, p += channels)
+            {
+                const float in = *p;
+                const float in2 = EQZ_IN_FACTOR * in + BankNEON(&b, &s, in);
+                *p = gain * (EQZ_IN_FACTOR * in2 + BankNEON(&b, &s2, in2));
+            }
+            StoreNEON(&state2[ch], &s2);
+        }
+        StoreNEON(&state[ch], &s);
+    }
+}
+#endif
+
+void eqz_Filter(const eqz_coeffs_t *coeffs, eqz_state_t *state,
+                eqz_state_t *state2, float gain, float *buf, size_t frames,
+                unsigned channels)
+{
+#ifdef HAVE_AVX512_INTRINSICS
+    if (vlc_CPU_AVX512())
+    {
+        FilterAVX512(coeffs, state, state2, gain, buf, frames, channels);
+        return;
+    }
+#endif
+#ifdef HAVE_AVX2_INTRINSICS
+    if (vlc_CPU_AVX2())
+    {
+        FilterAVX2(coeffs, state, state2, gain, buf, frames, channels);
+        return;
+    }
+#endif
+#ifdef HAVE_SSE2_INTRINSICS
+    if (vlc_CPU_SSE2())
+    {
+        FilterSSE2(coeffs, state, state2, gain, buf, frames, channels);
+        return;
+    }
+#endif
+#ifdef __ARM_NEON
+    if (vlc_CPU_ARM_NEON())
+    {
+        FilterNEON(coeffs, state, state2, gain, buf, frames, channels);
+        return;
+    }
+#endif
+    eqz_Filter_C(coeffs, state, state2, gain, buf, frames, channels);
+}
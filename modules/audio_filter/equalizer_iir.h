@@ -0,0 +1,77 @@
+/*****************************************************************************
+ * equalizer_iir.h: Equalizer band-pass filter bank
+ *****************************************************************************
+ * Copyright © 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_EQUALIZER_IIR_H
+#define VLC_EQUALIZER_IIR_H 1
+
+#include <stdalign.h>
+
+/* Bands are stored band-major, padded to the widest vector size. The padding
+ * bands have zero coefficients and zero state, so they always output 0.
+ * The structures below must be allocated with aligned_alloc(). */
+#define EQZ_LANES 16
+
+#define EQZ_IN_FACTOR (0.25f)
+
+typedef struct
+{
+    alignas (64) float alpha[EQZ_LANES];
+    alignas (64) float beta[EQZ_LANES];
+    alignas (64) float gamma[EQZ_LANES];
+    alignas (64) float amp[EQZ_LANES];  /* per band amp */
+    unsigned bands;
+} eqz_coeffs_t;
+
+/* Per channel state */
+typedef struct
+{
+    alignas (64) float y0[EQZ_LANES];   /* last output of each band */
+    alignas (64) float y1[EQZ_LANES];   /* output before the last one */
+    float x[2];                         /* last two inputs */
+} eqz_state_t;
+
+/**
+ * Equalizes interleaved samples in place.
+ *
+ * Each sample x becomes gain * (EQZ_IN_FACTOR * x + sum(amp * band(x))).
+ * With a second state, the result of the first pass, without the gain,
+ * goes through the bank again.
+ *
+ * The band outputs are summed in band order.
+ *
+ * \param state array of one state per channel
+ * \param state2 array of one state per channel for the second pass, or NULL
+ */
+void eqz_Filter_C(const eqz_coeffs_t *coeffs, eqz_state_t *state,
+                  eqz_state_t *state2, float gain, float *buf, size_t frames,
+                  unsigned channels);
+
+/**
+ * Same as eqz_Filter_C(), with the bands processed in vectors.
+ *
+ * The band outputs are computed with the same operations, but they are
+ * summed in a different order, and the compiler may fuse the multiplications
+ * with the additions.
+ */
+void eqz_Filter(const eqz_coeffs_t *coeffs, eqz_state_t *state,
+                eqz_state_t *state2, float gain, float *buf, size_t frames,
+                unsigned channels);
+
+#endif
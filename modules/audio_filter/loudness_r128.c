@@ -0,0 +1,585 @@
+/*****************************************************************************
+ * loudness_r128.c: ITU-R BS.1770 loudness and true peak measurement
+ *****************************************************************************
+ * Copyright © 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <assert.h>
+#include <math.h>
+
+#include <vlc_common.h>
+#include <vlc_cpu.h>
+
+#include "loudness_r128.h"
+
+/* Gates, in LUFS and LU */
+#define ABSOLUTE_GATE (-70.)
+#define RELATIVE_GATE (-10.)
+
+void r128_KWeightInit(r128_kweight_t *kw, unsigned rate)
+{
+    /* Same filters as BS.1770, for any rate */
+    double f0 = 1681.974450955533;
+    double gain = 3.999843853973347;
+    double q = 0.7071752369554196;
+    double k = tan(M_PI * f0 / rate);
+    double vh = pow(10., gain / 20.);
+    double vb = pow(vh, 0.4996667741545416);
+    double a0 = 1. + k / q + k * k;
+
+    kw->shelf[0] = (vh + vb * k / q + k * k) / a0;
+    kw->shelf[1] = 2. * (k * k - vh) / a0;
+    kw->shelf[2] = (vh - vb * k / q + k * k) / a0;
+    kw->shelf[3] = 2. * (k * k - 1.) / a0;
+    kw->shelf[4] = (1. - k / q + k * k) / a0;
+
+    f0 = 38.13547087602444;
+    q = 0.5003270373238773;
+    k = tan(M_PI * f0 / rate);
+    a0 = 1. + k / q + k * k;
+
+    kw->highpass[0] = 1.f;
+    kw->highpass[1] = -2.f;
+    kw->highpass[2] = 1.f;
+    kw->highpass[3] = 2. * (k * k - 1.) / a0;
+    kw->highpass[4] = (1. - k / q + k * k) / a0;
+}
+
+void r128_KWeight_C(const r128_kweight_t *kw, float *state, const float *in,
+                    unsigned channels, size_t stride, size_t count,
+                    float *sums)
+{
+    const float *s = kw->shelf, *h = kw->highpass;
+
+    for (unsigned c = 0; c < channels; c++)
+    {
+        float s1 = state[c], s2 = state[R128_LANES + c];
+        float h1 = state[2 * R128_LANES + c], h2 = state[3 * R128_LANES + c];
+        float sum = 0.f;
+
+        for (size_t i = 0; i < count; i++)
+        {
+            const float x = in[i * stride + c];
+            const float y = s[0] * x + s1;
+
+            s1 = s[1] * x - s[3] * y + s2;
+            s2 = s[2] * x - s[4] * y;
+
+            const float z = h[0] * y + h1;
+
+            h1 = h[1] * y - h[3] * z + h2;
+            h2 = h[2] * y - h[4] * z;
+            sum += z * z;
+        }
+
+        state[c] = s1;
+        state[R128_LANES + c] = s2;
+        state[2 * R128_LANES + c] = h1;
+        state[3 * R128_LANES + c] = h2;
+        sums[c] = sum;
+    }
+}
+
+void r128_Interpolate_C(const float (*coeffs)[4], const float *in,
+                        size_t count, float *peaks)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        float peak = peaks[i];
+
+        for (unsigned k = 0; k < 4; k++)
+        {
+            float v = 0.f;
+
+            for (unsigned j = 0; j < R128_TP_TAPS; j++)
+                v += coeffs[j][k] * in[i + j];
+            v = fabsf(v);
+            if (v > peak)
+                peak = v;
+        }
+        peaks[i] = peak;
+    }
+}
+
+#ifdef HAVE_SSE2_INTRINSICS
+# include <emmintrin.h>
+
+/* Loads the first n floats of a frame, zeroes the other lanes */
+__attribute__ ((__target__ ("sse2")))
+static inline __m128 LoadLanesSSE2(const float *p, unsigned n)
+{
+    switch (n)
+    {
+        case 1:
+            return _mm_load_ss(p);
+        case 2:
+            return _mm_castsi128_ps(_mm_loadl_epi64((const __m128i *)p));
+        case 3:
+            return _mm_movelh_ps(
+                _mm_castsi128_ps(_mm_loadl_epi64((const __m128i *)p)),
+                _mm_load_ss(p + 2));
+        default:
+            return _mm_loadu_ps(p);
+    }
+}
+
+__attribute__ ((__target__ ("sse2")))
+static void KWeightSSE2(const r128_kweight_t *kw, float *state,
+                        const float *in, unsigned channels, size_t stride,
+                        size_t count, float *sums)
+{
+    const __m128 sb0 = _mm_set1_ps(kw->shelf[0]);
+    const __m128 sb1 = _mm_set1_ps(kw->shelf[1]);
+    const __m128 sb2 = _mm_set1_ps(kw->shelf[2]);
+    const __m128 sa1 = _mm_set1_ps(kw->shelf[3]);
+    const __m128 sa2 = _mm_set1_ps(kw->shelf[4]);
+    const __m128 ha1 = _mm_set1_ps(kw->highpass[3]);
+    const __m128 ha2 = _mm_set1_ps(kw->highpass[4]);
+    __m128 s1 = _mm_loadu_ps(state);
+    __m128 s2 = _mm_loadu_ps(state + R128_LANES);
+    __m128 h1 = _mm_loadu_ps(state + 2 * R128_LANES);
+    __m128 h2 = _mm_loadu_ps(state + 3 * R128_LANES);
+    __m128 sum = _mm_setzero_ps();
+
+    for (size_t i = 0; i < count; i++)
+    {
+        const __m128 x = LoadLanesSSE2(in + i * stride, channels);
+        const __m128 y = _mm_add_ps(_mm_mul_ps(sb0, x), s1);
+
+        s1 = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(sb1, x), _mm_mul_ps(sa1, y)),
+                        s2);
+        s2 = _mm_sub_ps(_mm_mul_ps(sb2, x), _mm_mul_ps(sa2, y));
+
+        /* b0 = b2 = 1, b1 = -2 */
+        const __m128 z = _mm_add_ps(y, h1);
+
+        h1 = _mm_add_ps(_mm_sub_ps(_mm_sub_ps(_mm_setzero_ps(),
+                                              _mm_add_ps(y, y)),
+                                   _mm_mul_ps(ha1, z)), h2);
+        h2 = _mm_sub_ps(y, _mm_mul_ps(ha2, z));
+        sum = _mm_add_ps(sum, _mm_mul_ps(z, z));
+    }
+
+    float out[R128_LANES];
+
+    _mm_storeu_ps(state, s1);
+    _mm_storeu_ps(state + R128_LANES, s2);
+    _mm_storeu_ps(state + 2 * R128_LANES, h1);
+    _mm_storeu_ps(state + 3 * R128_LANES, h2);
+    _mm_storeu_ps(out, sum);
+    for (unsigned c = 0; c < channels; c++)
+        sums[c] = out[c];
+}
+
+__attribute__ ((__target__ ("sse2")))
+static void InterpolateSSE2(const float (*coeffs)[4], const float *in,
+                            size_t count, float *peaks)
+{
+    const __m128 sign = _mm_set1_ps(-0.f);
+    __m128 c[R128_TP_TAPS];
+
+    for (unsigned j = 0; j < R128_TP_TAPS; j++)
+        c[j] = _mm_loadu_ps(coeffs[j]);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        __m128 acc = _mm_mul_ps(c[0], _mm_set1_ps(in[i]));
+
+        for (unsigned j = 1; j < R128_TP_TAPS; j++)
+            acc = _mm_add_ps(acc, _mm_mul_ps(c[j], _mm_set1_ps(in[i + j])));
+
+        acc = _mm_andnot_ps(sign, acc);
+        acc = _mm_max_ps(acc, _mm_shuffle_ps(acc, acc, 0x4E));
+        acc = _mm_max_ps(acc, _mm_shuffle_ps(acc, acc, 0xB1));
+        acc = _mm_max_ss(acc, _mm_load_ss(peaks + i));
+        _mm_store_ss(peaks + i, acc);
+    }
+}
+#endif
+
+#ifdef __ARM_NEON
+# include <arm_neon.h>
+
+static void KWeightNEON(const r128_kweight_t *kw, float *state,
+                        const float *in, unsigned channels, size_t stride,
+                        size_t count, float *sums)
+{
+    const float32x4_t sb0 = vdupq_n_f32(kw->shelf[0]);
+    const float32x4_t sb1 = vdupq_n_f32(kw->shelf[1]);
+    const float32x4_t sb2 = vdupq_n_f32(kw->shelf[2]);
+    const float32x4_t sa1 = vdupq_n_f32(kw->shelf[3]);
+    const float32x4_t sa2 = vdupq_n_f32(kw->shelf[4]);
+    const float32x4_t ha1 = vdupq_n_f32(kw->highpass[3]);
+    const float32x4_t ha2 = vdupq_n_f32(kw->highpass[4]);
+    float32x4_t s1 = vld1q_f32(state);
+    float32x4_t s2 = vld1q_f32(state + R128_LANES);
+    float32x4_t h1 = vld1q_f32(state + 2 * R128_LANES);
+    float32x4_t h2 = vld1q_f32(state + 3 * R128_LANES);
+    float32x4_t sum = vdupq_n_f32(0.f);
+    float frame[R128_LANES] = { 0.f, 0.f, 0.f, 0.f };
+
+    for (size_t i = 0; i < count; i++)
+    {
+        float32x4_t x;
+
+        if (channels == R128_LANES)
+            x = vld1q_f32(in + i * stride);
+        else
+        {
+            memcpy(frame, in + i * stride, channels * sizeof (float));
+            x = vld1q_f32(frame);
+        }
+
+        const float32x4_t y = vmlaq_f32(s1, sb0, x);
+
+        s1 = vmlsq_f32(vmlaq_f32(s2, sb1, x), sa1, y);
+        s2 = vmlsq_f32(vmulq_f32(sb2, x), sa2, y);
+
+        /* b0 = b2 = 1, b1 = -2 */
+        const float32x4_t z = vaddq_f32(y, h1);
+
+        h1 = vmlsq_f32(vsubq_f32(h2, vaddq_f32(y, y)), ha1, z);
+        h2 = vmlsq_f32(y, ha2, z);
+        sum = vmlaq_f32(sum, z, z);
+    }
+
+    float out[R128_LANES];
+
+    vst1q_f32(state, s1);
+    vst1q_f32(state + R128_LANES, s2);
+    vst1q_f32(state + 2 * R128_LANES, h1);
+    vst1q_f32(state + 3 * R128_LANES, h2);
+    vst1q_f32(out, sum);
+    for (unsigned c = 0; c < channels; c++)
+        sums[c] = out[c];
+}
+
+static void InterpolateNEON(const float (*coeffs)[4], const float *in,
+                            size_t count, float *peaks)
+{
+    float32x4_t c[R128_TP_TAPS];
+
+    for (unsigned j = 0; j < R128_TP_TAPS; j++)
+        c[j] = vld1q_f32(coeffs[j]);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        float32x4_t acc = vmulq_n_f32(c[0], in[i]);
+
+        for (unsigned j = 1; j < R128_TP_TAPS; j++)
+            acc = vmlaq_n_f32(acc, c[j], in[i + j]);
+
+        acc = vabsq_f32(acc);
+
+        float32x2_t m = vpmax_f32(vget_low_f32(acc), vget_high_f32(acc));
+        m = vpmax_f32(m, m);
+
+        const float peak = vget_lane_f32(m, 0);
+        if (peak > peaks[i])
+            peaks[i] = peak;
+    }
+}
+#endif
+
+void r128_KWeight(const r128_kweight_t *kw, float *state, const float *in,
+                  unsigned channels, size_t stride, size_t count, float *sums)
+{
+    assert(channels <= R128_LANES);
+#ifdef HAVE_SSE2_INTRINSICS
+    if (vlc_CPU_SSE2())
+    {
+        KWeightSSE2(kw, state, in, channels, stride, count, sums);
+        return;
+    }
+#endif
+#ifdef __ARM_NEON
+    if (vlc_CPU_ARM_NEON())
+    {
+        KWeightNEON(kw, state, in, channels, stride, count, sums);
+        return;
+    }
+#endif
+    r128_KWeight_C(kw, state, in, channels, stride, count, sums);
+}
+
+void r128_Interpolate(const float (*coeffs)[4], const float *in,
+                      size_t count, float *peaks)
+{
+#ifdef HAVE_SSE2_INTRINSICS
+    if (vlc_CPU_SSE2())
+    {
+        InterpolateSSE2(coeffs, in, count, peaks);
+        return;
+    }
+#endif
+#ifdef __ARM_NEON
+    if (vlc_CPU_ARM_NEON())
+    {
+        InterpolateNEON(coeffs, in, count, peaks);
+        return;
+    }
+#endif
+    r128_Interpolate_C(coeffs, in, count, peaks);
+}
+
+int r128_MeterInit(r128_meter_t *meter, unsigned rate, unsigned channels,
+                   const float *weights, unsigned window)
+{
+    meter->rate = rate;
+    meter->channels = channels;
+    meter->lanes = (channels + R128_LANES - 1) / R128_LANES * R128_LANES;
+    meter->subblock = (rate + 5) / 10;
+    meter->size = window < 30 ? 30 : window;
+    r128_KWeightInit(&meter->kweight, rate);
+
+    meter->state = vlc_alloc(4 * meter->lanes, sizeof (*meter->state));
+    meter->weights = calloc(meter->lanes, sizeof (*meter->weights));
+    meter->sums = vlc_alloc(meter->lanes, sizeof (*meter->sums));
+    meter->energies = vlc_alloc(meter->size, sizeof (*meter->energies));
+    if (unlikely(meter->state == NULL || meter->weights == NULL
+              || meter->sums == NULL || meter->energies == NULL))
+    {
+        r128_MeterClean(meter);
+        return VLC_ENOMEM;
+    }
+
+    memcpy(meter->weights, weights, channels * sizeof (*weights));
+    r128_MeterReset(meter);
+    return VLC_SUCCESS;
+}
+
+void r128_MeterClean(r128_meter_t *meter)
+{
+    free(meter->energies);
+    free(meter->sums);
+    free(meter->weights);
+    free(meter->state);
+}
+
+void r128_MeterReset(r128_meter_t *meter)
+{
+    memset(meter->state, 0, 4 * meter->lanes * sizeof (*meter->state));
+    for (unsigned c = 0; c < meter->lanes; c++)
+        meter->sums[c] = 0.;
+    meter->frames = 0;
+    meter->pos = 0;
+    meter->count = 0;
+}
+
+bool r128_Add(r128_meter_t *meter, const float *frames, size_t count)
+{
+    float sums[R128_LANES];
+
+    assert(count <= r128_Remaining(meter));
+
+    for (unsigned g = 0; g < meter->channels; g += R128_LANES)
+    {
+        unsigned n = meter->channels - g;
+        if (n > R128_LANES)
+            n = R128_LANES;
+
+        r128_KWeight(&meter->kweight, meter->state + 4 * g, frames + g, n,
+                     meter->channels, count, sums);
+        for (unsigned c = 0; c < n; c++)
+            meter->sums[g + c] += sums[c];
+    }
+
+    meter->frames += count;
+    if (meter->frames < meter->subblock)
+        return false;
+
+    double energy = 0.;
+    for (unsigned c = 0; c < meter->channels; c++)
+    {
+        energy += meter->weights[c] * meter->sums[c];
+        meter->sums[c] = 0.;
+    }
+
+    meter->energies[meter->pos] = energy / meter->subblock;
+    meter->pos = (meter->pos + 1) % meter->size;
+    if (meter->count < meter->size)
+        meter->count++;
+    meter->frames = 0;
+    return true;
+}
+
+static double Loudness(double energy)
+{
+    return energy > 0. ? -0.691 + 10. * log10(energy) : -HUGE_VAL;
+}
+
+static double Energy(double loudness)
+{
+    return pow(10., (loudness + 0.691) / 10.);
+}
+
+/* Mean of n sub-blocks, the last one being skip sub-blocks before the
+ * newest one */
+static double Mean(const r128_meter_t *meter, unsigned skip, unsigned n)
+{
+    unsigned pos = (meter->pos + meter->size - skip - n) % meter->size;
+    double sum = 0.;
+
+    for (unsigned i = 0; i < n; i++)
+    {
+        sum += meter->energies[pos];
+        pos = (pos + 1) % meter->size;
+    }
+    return sum / n;
+}
+
+double r128_Momentary(const r128_meter_t *meter)
+{
+    if (meter->count < 4)
+        return -HUGE_VAL;
+    return Loudness(Mean(meter, 0, 4));
+}
+
+double r128_ShortTerm(const r128_meter_t *meter)
+{
+    if (meter->count < 4)
+        return -HUGE_VAL;
+    return Loudness(Mean(meter, 0, meter->count < 30 ? meter->count : 30));
+}
+
+double r128_Gated(const r128_meter_t *meter)
+{
+    if (meter->count < 4)
+        return -HUGE_VAL;
+
+    const unsigned blocks = meter->count - 3;
+    const double absolute = Energy(ABSOLUTE_GATE);
+    double sum = 0.;
+    unsigned n = 0;
+
+    for (unsigned b = 0; b < blocks; b++)
+    {
+        const double energy = Mean(meter, b, 4);
+        if (energy > absolute)
+        {
+            sum += energy;
+            n++;
+        }
+    }
+    if (n == 0)
+        return -HUGE_VAL;
+
+    const double relative = sum / n * pow(10., RELATIVE_GATE / 10.);
+
+    sum = 0.;
+    n = 0;
+    for (unsigned b = 0; b < blocks; b++)
+    {
+        const double energy = Mean(meter, b, 4);
+        if (energy > absolute && energy > relative)
+        {
+            sum += energy;
+            n++;
+        }
+    }
+    return Loudness(sum / n);
+}
+
+int r128_TruePeakInit(r128_truepeak_t *tp, unsigned rate, unsigned channels)
+{
+    const int center = R128_TP_TAPS / 2 - 1;
+
+    for (unsigned k = 0; k < 4; k++)
+    {
+        double sum = 0.;
+
+        for (unsigned j = 0; j < R128_TP_TAPS; j++)
+        {
+            /* Windowed sinc, from the frame center to center + 1 */
+            const double t = (int)j - center - k / 4.;
+            double v;
+
+            if (rate >= 96000)
+                v = (int)j == center; /* already oversampled enough */
+            else if (t == 0.)
+                v = 1.;
+            else
+            {
+                const double w = cos(M_PI * t / (R128_TP_TAPS + 1));
+                v = sin(M_PI * t) / (M_PI * t) * w * w;
+            }
+            tp->coeffs[j][k] = v;
+            sum += v;
+        }
+        for (unsigned j = 0; j < R128_TP_TAPS; j++)
+            tp->coeffs[j][k] /= sum;
+    }
+
+    tp->channels = channels;
+    tp->scratch = NULL;
+    tp->scratch_size = 0;
+    tp->history = vlc_alloc((R128_TP_TAPS - 1) * channels,
+                            sizeof (*tp->history));
+    if (unlikely(tp->history == NULL))
+        return VLC_ENOMEM;
+    r128_TruePeakReset(tp);
+    return VLC_SUCCESS;
+}
+
+void r128_TruePeakClean(r128_truepeak_t *tp)
+{
+    free(tp->scratch);
+    free(tp->history);
+}
+
+void r128_TruePeakReset(r128_truepeak_t *tp)
+{
+    memset(tp->history, 0,
+           (R128_TP_TAPS - 1) * tp->channels * sizeof (*tp->history));
+}
+
+int r128_TruePeak(r128_truepeak_t *tp, const float *frames, size_t count,
+                  float *peaks)
+{
+    const size_t size = R128_TP_TAPS - 1 + count;
+
+    if (size > tp->scratch_size)
+    {
+        float *scratch = vlc_reallocarray(tp->scratch, size,
+                                          sizeof (*scratch));
+        if (unlikely(scratch == NULL))
+            return VLC_ENOMEM;
+        tp->scratch = scratch;
+        tp->scratch_size = size;
+    }
+
+    for (size_t i = 0; i < count; i++)
+        peaks[i] = 0.f;
+
+    for (unsigned c = 0; c < tp->channels; c++)
+    {
+        float *history = tp->history + c * (R128_TP_TAPS - 1);
+        float *in = tp->scratch;
+
+        memcpy(in, history, (R128_TP_TAPS - 1) * sizeof (*in));
+        for (size_t i = 0; i < count; i++)
+            in[R128_TP_TAPS - 1 + i] = frames[i * tp->channels + c];
+
+        r128_Interpolate((const float (*)[4])tp->coeffs, in, count, peaks);
+        memcpy(history, in + count, (R128_TP_TAPS - 1) * sizeof (*in));
+    }
+    return VLC_SUCCESS;
+}
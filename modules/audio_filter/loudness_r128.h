@@ -0,0 +1,172 @@
+/*****************************************************************************
+ * loudness_r128.h: ITU-R BS.1770 loudness and true peak measurement
+ *****************************************************************************
+ * Copyright © 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_LOUDNESS_R128_H
+#define VLC_LOUDNESS_R128_H 1
+
+/* Channels filtered together by the K-weighting kernels */
+#define R128_LANES 4
+
+/* Taps per phase of the true peak interpolator */
+#define R128_TP_TAPS 12
+/* Delay of the true peak interpolator, in frames */
+#define R128_TP_DELAY 5
+
+/**
+ * K-weighting filter: high shelf then high pass biquads, with
+ * b0 b1 b2 a1 a2 coefficients each.
+ */
+typedef struct
+{
+    float shelf[5];
+    float highpass[5];
+} r128_kweight_t;
+
+/**
+ * Loudness meter.
+ *
+ * Frames are added by 100 ms sub-blocks, the loudness is computed from the
+ * mean squares of the last sub-blocks, as 400 ms blocks overlapping by
+ * 75 %.
+ */
+typedef struct
+{
+    unsigned rate;
+    unsigned channels;
+    unsigned lanes;         /**< channels rounded up to R128_LANES */
+    size_t subblock;        /**< frames per sub-block */
+    size_t frames;          /**< frames in the current sub-block */
+
+    r128_kweight_t kweight;
+    float *state;           /**< 4 values per lane, R128_LANES lanes a group */
+    float *weights;         /**< per lane */
+    double *sums;           /**< per lane, current sub-block */
+
+    double *energies;       /**< weighted mean squares of the sub-blocks */
+    unsigned size;
+    unsigned pos;
+    unsigned count;
+} r128_meter_t;
+
+/**
+ * True peak meter: 4 times oversampling for rates below 96 kHz.
+ */
+typedef struct
+{
+    float coeffs[R128_TP_TAPS][4];  /**< tap major, one lane per phase */
+    unsigned channels;
+    float *history;         /**< R128_TP_TAPS - 1 frames per channel */
+    float *scratch;
+    size_t scratch_size;
+} r128_truepeak_t;
+
+/**
+ * Computes the K-weighting coefficients for a sample rate.
+ */
+void r128_KWeightInit(r128_kweight_t *, unsigned rate);
+
+/**
+ * Initializes a meter.
+ *
+ * \param weights channel weights (1 for front, 1.41 for surround, 0 for LFE)
+ * \param window sub-blocks kept for r128_Gated(), at least 30
+ */
+int r128_MeterInit(r128_meter_t *, unsigned rate, unsigned channels,
+                   const float *weights, unsigned window);
+void r128_MeterClean(r128_meter_t *);
+void r128_MeterReset(r128_meter_t *);
+
+/**
+ * Frames to add to complete the current sub-block.
+ */
+static inline size_t r128_Remaining(const r128_meter_t *meter)
+{
+    return meter->subblock - meter->frames;
+}
+
+/**
+ * Adds no more than r128_Remaining() interleaved frames.
+ *
+ * \return true if this completed a sub-block
+ */
+bool r128_Add(r128_meter_t *, const float *frames, size_t count);
+
+/**
+ * Loudness of the last 400 ms, in LUFS, or -HUGE_VAL.
+ */
+double r128_Momentary(const r128_meter_t *);
+
+/**
+ * Loudness of the last 3 s, in LUFS, or -HUGE_VAL.
+ */
+double r128_ShortTerm(const r128_meter_t *);
+
+/**
+ * Gated loudness over the window (integrated loudness when the window
+ * holds the whole program), in LUFS, or -HUGE_VAL if everything is below
+ * the absolute gate.
+ */
+double r128_Gated(const r128_meter_t *);
+
+/**
+ * K-weights frames of up to R128_LANES channels and returns the sum of
+ * their squares per channel.
+ *
+ * \param state 4 values per lane, R128_LANES lanes
+ * \param stride floats between two frames
+ */
+void r128_KWeight_C(const r128_kweight_t *, float *state, const float *in,
+                    unsigned channels, size_t stride, size_t count,
+                    float *sums);
+
+/**
+ * Same as r128_KWeight_C(), vectorized.
+ */
+void r128_KWeight(const r128_kweight_t *, float *state, const float *in,
+                  unsigned channels, size_t stride, size_t count,
+                  float *sums);
+
+int r128_TruePeakInit(r128_truepeak_t *, unsigned rate, unsigned channels);
+void r128_TruePeakClean(r128_truepeak_t *);
+void r128_TruePeakReset(r128_truepeak_t *);
+
+/**
+ * Measures the true peak of interleaved frames.
+ *
+ * peaks[i] is the highest absolute value over all the channels between the
+ * frames i - R128_TP_DELAY - 1 and i - R128_TP_DELAY.
+ */
+int r128_TruePeak(r128_truepeak_t *, const float *frames, size_t count,
+                  float *peaks);
+
+/**
+ * Interpolates one channel: for i below count, raises peaks[i] to the
+ * highest absolute value of the phases from in[i] to in[i + taps - 1].
+ */
+void r128_Interpolate_C(const float (*coeffs)[4], const float *in,
+                        size_t count, float *peaks);
+
+/**
+ * Same as r128_Interpolate_C(), vectorized.
+ */
+void r128_Interpolate(const float (*coeffs)[4], const float *in,
+                      size_t count, float *peaks);
+
+#endif
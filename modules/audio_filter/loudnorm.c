@@ -0,0 +1,478 @@
+/*****************************************************************************
+ * loudnorm.c: EBU R128 loudness normalization with a true peak limiter
+ *****************************************************************************
+ * Copyright © 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <assert.h>
+#include <math.h>
+
+#include <vlc_common.h>
+#include <vlc_plugin.h>
+#include <vlc_aout.h>
+#include <vlc_filter.h>
+
+#include "loudness_r128.h"
+
+#define CFG_PREFIX "loudnorm-"
+
+/* Limiter attack and release */
+#define LIMITER_MS 5
+
+/*
+ * The input is measured as soon as it comes, then delayed by the lookahead
+ * before being gained, so that the gain follows the loudness changes in
+ * time. The gained frames then go through a true peak limiter: the gain
+ * needed for each peak is spread, by a sliding minimum then a moving
+ * average over the limiter window, from a window before the peak to a
+ * window after it.
+ */
+typedef struct
+{
+    r128_meter_t meter;
+    r128_truepeak_t tp;
+    unsigned channels;
+
+    float target;       /* LUFS */
+    float max_gain;     /* dB */
+    float ceiling;      /* linear */
+
+    /* Loudness lookahead */
+    float *delay;
+    size_t delay_size;
+    size_t delay_pos;
+    float gain;
+    float gain_step;
+    size_t gain_ramp;   /* frames until the gain reaches its target */
+
+    /* True peak limiter */
+    size_t window;
+    float *limit;       /* window + R128_TP_DELAY + 1 gained frames */
+    size_t limit_size;
+    float *min_gain;    /* sliding minimum of the needed gains, */
+    uint64_t *min_index;/* over window + 1 frames */
+    size_t min_head;
+    size_t min_count;
+    float *box;         /* last window minimums */
+    size_t box_pos;
+    double box_sum;
+    uint64_t index;     /* frames through the limiter */
+
+    float *scratch;     /* gained frames */
+    float *peaks;
+    size_t scratch_size;
+
+    size_t latency;     /* frames */
+    size_t skip;        /* frames to drop until the pipeline is filled */
+    vlc_tick_t next_pts;
+} filter_sys_t;
+
+static void Reset(filter_sys_t *sys)
+{
+    r128_MeterReset(&sys->meter);
+    r128_TruePeakReset(&sys->tp);
+
+    memset(sys->delay, 0, sys->delay_size * sys->channels * sizeof (float));
+    sys->delay_pos = 0;
+
+    memset(sys->limit, 0, sys->limit_size * sys->channels * sizeof (float));
+    sys->min_head = sys->min_count = 0;
+    for (size_t i = 0; i < sys->window; i++)
+        sys->box[i] = 1.f;
+    sys->box_pos = 0;
+    sys->box_sum = sys->window;
+    sys->index = 0;
+
+    sys->skip = sys->latency;
+    sys->next_pts = VLC_TICK_INVALID;
+}
+
+static void UpdateGain(filter_sys_t *sys)
+{
+    const double loudness = r128_Gated(&sys->meter);
+
+    if (loudness == -HUGE_VAL)
+        return; /* silence, keep the gain */
+
+    float db = sys->target - loudness;
+    if (db > sys->max_gain)
+        db = sys->max_gain;
+    if (db < -sys->max_gain)
+        db = -sys->max_gain;
+
+    const float gain = powf(10.f, db / 20.f);
+
+    sys->gain_ramp = sys->meter.subblock;
+    sys->gain_step = (gain - sys->gain) / sys->gain_ramp;
+}
+
+/* Swaps frames with the oldest ones of the lookahead, then gains them */
+static void Delay(filter_sys_t *sys, const float *in, float *out,
+                  size_t count)
+{
+    const unsigned channels = sys->channels;
+
+    if (sys->delay_size == 0)
+        memcpy(out, in, count * channels * sizeof (float));
+
+    for (size_t done = 0; done < count && sys->delay_size > 0;)
+    {
+        size_t n = sys->delay_size - sys->delay_pos;
+        if (n > count - done)
+            n = count - done;
+
+        float *ring = sys->delay + sys->delay_pos * channels;
+
+        memcpy(out + done * channels, ring, n * channels * sizeof (float));
+        memcpy(ring, in + done * channels, n * channels * sizeof (float));
+        done += n;
+        sys->delay_pos = (sys->delay_pos + n) % sys->delay_size;
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+        if (sys->gain_ramp > 0)
+        {
+            sys->gain += sys->gain_step;
+            sys->gain_ramp--;
+        }
+        for (unsigned c = 0; c < channels; c++)
+            out[i * channels + c] *= sys->gain;
+    }
+}
+
+/* Limits count gained frames, returns the number of output frames */
+static size_t Limit(filter_sys_t *sys, const float *in, const float *peaks,
+                    float *out, size_t count)
+{
+    const unsigned channels = sys->channels;
+    const size_t window = sys->window;
+    size_t written = 0;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        const float need = peaks[i] > sys->ceiling
+                         ? sys->ceiling / peaks[i] : 1.f;
+        const size_t size = window + 1;
+
+        /* Sliding minimum of the needed gains */
+        if (sys->min_count > 0
+         && sys->min_index[sys->min_head] + window < sys->index)
+        {
+            sys->min_head = (sys->min_head + 1) % size;
+            sys->min_count--;
+        }
+        while (sys->min_count > 0)
+        {
+            size_t back = (sys->min_head + sys->min_count - 1) % size;
+            if (sys->min_gain[back] < need)
+                break;
+            sys->min_count--;
+        }
+
+        size_t back = (sys->min_head + sys->min_count) % size;
+        sys->min_gain[back] = need;
+        sys->min_index[back] = sys->index;
+        sys->min_count++;
+
+        /* Moving average of the minimums */
+        const float min = sys->min_gain[sys->min_head];
+
+        sys->box_sum += min - sys->box[sys->box_pos];
+        sys->box[sys->box_pos] = min;
+        sys->box_pos = (sys->box_pos + 1) % window;
+
+        float gain = sys->box_sum / window;
+        if (gain > 1.f)
+            gain = 1.f;
+
+        /* The gain is the one of the frame a limiter window and the true
+         * peak delay before, the oldest one */
+        float *frame = sys->limit + (sys->index % sys->limit_size) * channels;
+        const float *oldest = sys->limit
+                            + ((sys->index + 1) % sys->limit_size) * channels;
+
+        if (sys->skip > 0)
+            sys->skip--;
+        else
+        {
+            for (unsigned c = 0; c < channels; c++)
+                out[written * channels + c] = oldest[c] * gain;
+            written++;
+        }
+        memcpy(frame, in + i * channels, channels * sizeof (float));
+        sys->index++;
+    }
+    return written;
+}
+
+/* Processes frames in place, returns the number of output frames */
+static size_t Process(filter_t *filter, float *buf, size_t count,
+                      bool measure)
+{
+    filter_sys_t *sys = filter->p_sys;
+    const unsigned channels = sys->channels;
+    size_t in = 0, out = 0;
+
+    while (in < count)
+    {
+        size_t n = r128_Remaining(&sys->meter);
+        if (n > count - in)
+            n = count - in;
+
+        if (measure && r128_Add(&sys->meter, buf + in * channels, n))
+            UpdateGain(sys);
+
+        Delay(sys, buf + in * channels, sys->scratch, n);
+        if (r128_TruePeak(&sys->tp, sys->scratch, n, sys->peaks))
+            /* Do not limit rather than dropping frames */
+            memset(sys->peaks, 0, n * sizeof (float));
+        out += Limit(sys, sys->scratch, sys->peaks, buf + out * channels, n);
+        in += n;
+    }
+    return out;
+}
+
+static block_t *Filter(filter_t *filter, block_t *block)
+{
+    filter_sys_t *sys = filter->p_sys;
+    const size_t skip = sys->skip;
+
+    block->i_nb_samples = Process(filter, (float *)block->p_buffer,
+                                  block->i_nb_samples, true);
+    block->i_buffer = block->i_nb_samples * sys->channels * sizeof (float);
+
+    /* Frames come out the latency later */
+    if (block->i_pts != VLC_TICK_INVALID)
+        block->i_pts -= vlc_tick_from_samples(sys->latency - skip,
+                                              filter->fmt_in.audio.i_rate);
+    else
+        block->i_pts = sys->next_pts;
+    block->i_dts = block->i_pts;
+    block->i_length = vlc_tick_from_samples(block->i_nb_samples,
+                                            filter->fmt_in.audio.i_rate);
+    if (block->i_pts != VLC_TICK_INVALID)
+        sys->next_pts = block->i_pts + block->i_length;
+
+    if (block->i_nb_samples == 0)
+    {
+        block_Release(block);
+        return NULL;
+    }
+    return block;
+}
+
+static block_t *Drain(filter_t *filter)
+{
+    filter_sys_t *sys = filter->p_sys;
+    const size_t frames = sys->latency - sys->skip;
+
+    if (frames == 0)
+        return NULL;
+
+    block_t *block = block_Alloc(sys->latency * sys->channels
+                                 * sizeof (float));
+    if (unlikely(block == NULL))
+        return NULL;
+
+    /* Push silence, unmeasured, through the pipeline */
+    memset(block->p_buffer, 0, block->i_buffer);
+    block->i_nb_samples = Process(filter, (float *)block->p_buffer,
+                                  sys->latency, false);
+    assert(block->i_nb_samples == frames);
+    block->i_buffer = frames * sys->channels * sizeof (float);
+    block->i_pts = block->i_dts = sys->next_pts;
+    block->i_length = vlc_tick_from_samples(frames,
+                                            filter->fmt_in.audio.i_rate);
+
+    Reset(sys);
+    return block;
+}
+
+static void Flush(filter_t *filter)
+{
+    Reset(filter->p_sys);
+}
+
+static void Close(filter_t *filter)
+{
+    filter_sys_t *sys = filter->p_sys;
+
+    free(sys->peaks);
+    free(sys->scratch);
+    free(sys->box);
+    free(sys->min_index);
+    free(sys->min_gain);
+    free(sys->limit);
+    free(sys->delay);
+    r128_TruePeakClean(&sys->tp);
+    r128_MeterClean(&sys->meter);
+    free(sys);
+}
+
+/* BS.1770 weights, in the VLC channel order */
+static void Weights(const audio_format_t *fmt, float *weights)
+{
+    unsigned c = 0;
+
+    for (unsigned i = 0; pi_vlc_chan_order_wg4[i] != 0; i++)
+    {
+        const uint32_t chan = pi_vlc_chan_order_wg4[i];
+
+        if (!(fmt->i_physical_channels & chan))
+            continue;
+        if (chan == AOUT_CHAN_LFE)
+            weights[c++] = 0.f;
+        else if (chan & (AOUT_CHAN_MIDDLELEFT | AOUT_CHAN_MIDDLERIGHT
+                       | AOUT_CHAN_REARLEFT | AOUT_CHAN_REARRIGHT
+                       | AOUT_CHAN_REARCENTER))
+            weights[c++] = 1.41f;
+        else
+            weights[c++] = 1.f;
+    }
+    while (c < fmt->i_channels)
+        weights[c++] = 1.f;
+}
+
+static int Open(vlc_object_t *obj)
+{
+    filter_t *filter = (filter_t *)obj;
+    const unsigned rate = filter->fmt_in.audio.i_rate;
+
+    filter->fmt_in.audio.i_format = VLC_CODEC_FL32;
+    aout_FormatPrepare(&filter->fmt_in.audio);
+    filter->fmt_out.audio = filter->fmt_in.audio;
+
+    const unsigned channels = filter->fmt_in.audio.i_channels;
+    if (channels == 0 || rate == 0)
+        return VLC_EGENERIC;
+
+    filter_sys_t *sys = calloc(1, sizeof (*sys));
+    if (unlikely(sys == NULL))
+        return VLC_ENOMEM;
+    filter->p_sys = sys;
+
+    sys->channels = channels;
+    sys->target = var_InheritFloat(filter, CFG_PREFIX "target");
+    sys->max_gain = var_InheritFloat(filter, CFG_PREFIX "max-gain");
+    sys->ceiling = powf(10.f, var_InheritFloat(filter, CFG_PREFIX "true-peak")
+                              / 20.f);
+
+    unsigned window = var_InheritInteger(filter, CFG_PREFIX "window");
+    if (window < 3)
+        window = 3;
+    vlc_tick_t lookahead =
+        VLC_TICK_FROM_MS(var_InheritInteger(filter, CFG_PREFIX "lookahead"));
+    if (lookahead < VLC_TICK_FROM_MS(LIMITER_MS))
+        lookahead = VLC_TICK_FROM_MS(LIMITER_MS);
+
+    sys->window = samples_from_vlc_tick(VLC_TICK_FROM_MS(LIMITER_MS), rate);
+    if (sys->window == 0)
+        sys->window = 1;
+    sys->delay_size = samples_from_vlc_tick(lookahead, rate);
+    if (sys->delay_size < sys->window)
+        sys->delay_size = sys->window;
+    sys->delay_size -= sys->window;
+    sys->limit_size = sys->window + R128_TP_DELAY + 1;
+    sys->latency = sys->delay_size + sys->limit_size - 1;
+    sys->gain = 1.f;
+
+    float weights[INPUT_CHAN_MAX];
+    Weights(&filter->fmt_in.audio, weights);
+
+    if (r128_MeterInit(&sys->meter, rate, channels, weights, window * 10))
+        goto error_meter;
+    if (r128_TruePeakInit(&sys->tp, rate, channels))
+        goto error_tp;
+
+    sys->scratch_size = sys->meter.subblock;
+    sys->delay = vlc_alloc(sys->delay_size * channels, sizeof (float));
+    sys->limit = vlc_alloc(sys->limit_size * channels, sizeof (float));
+    sys->min_gain = vlc_alloc(sys->window + 1, sizeof (float));
+    sys->min_index = vlc_alloc(sys->window + 1, sizeof (uint64_t));
+    sys->box = vlc_alloc(sys->window, sizeof (float));
+    sys->scratch = vlc_alloc(sys->scratch_size * channels, sizeof (float));
+    sys->peaks = vlc_alloc(sys->scratch_size, sizeof (float));
+    if (unlikely((sys->delay == NULL && sys->delay_size > 0)
+              || sys->limit == NULL || sys->min_gain == NULL
+              || sys->min_index == NULL || sys->box == NULL
+              || sys->scratch == NULL || sys->peaks == NULL))
+    {
+        Close(filter);
+        return VLC_ENOMEM;
+    }
+    Reset(sys);
+
+    msg_Dbg(filter, "normalizing to %.1f LUFS, %.1f dBTP, %zu ms latency",
+            sys->target, 20.f * log10f(sys->ceiling),
+            sys->latency * 1000 / rate);
+
+    static const struct vlc_filter_operations filter_ops = {
+        .filter_audio = Filter, .drain_audio = Drain, .flush = Flush,
+        .close = Close,
+    };
+    filter->ops = &filter_ops;
+    return VLC_SUCCESS;
+
+error_tp:
+    r128_MeterClean(&sys->meter);
+error_meter:
+    free(sys);
+    return VLC_ENOMEM;
+}
+
+#define TARGET_TEXT N_("Target loudness (LUFS)")
+#define TARGET_LONGTEXT N_( \
+    "Integrated loudness to normalize to, -23 LUFS for EBU R 128.")
+#define TRUE_PEAK_TEXT N_("True peak ceiling (dBTP)")
+#define TRUE_PEAK_LONGTEXT N_( \
+    "The output true peaks are limited below this level.")
+#define LOOKAHEAD_TEXT N_("Lookahead (ms)")
+#define LOOKAHEAD_LONGTEXT N_( \
+    "How far ahead the loudness is measured, which is also the latency " \
+    "added by the filter.")
+#define WINDOW_TEXT N_("Measurement window (s)")
+#define WINDOW_LONGTEXT N_( \
+    "Duration over which the gated loudness is measured. Longer windows " \
+    "change the gain more slowly.")
+#define MAX_GAIN_TEXT N_("Maximum gain (dB)")
+#define MAX_GAIN_LONGTEXT N_( \
+    "Highest amplification or attenuation applied to reach the target.")
+
+vlc_module_begin()
+    set_shortname(N_("Loudness normalizer"))
+    set_description(N_("EBU R 128 loudness normalizer"))
+    set_category(CAT_AUDIO)
+    set_subcategory(SUBCAT_AUDIO_AFILTER)
+    add_float_with_range(CFG_PREFIX "target", -23.f, -70.f, 0.f,
+                         TARGET_TEXT, TARGET_LONGTEXT, false)
+    add_float_with_range(CFG_PREFIX "true-peak", -1.f, -20.f, 0.f,
+                         TRUE_PEAK_TEXT, TRUE_PEAK_LONGTEXT, false)
+    add_integer_with_range(CFG_PREFIX "lookahead", 300, 10, 3000,
+                           LOOKAHEAD_TEXT, LOOKAHEAD_LONGTEXT, false)
+    add_integer_with_range(CFG_PREFIX "window", 10, 3, 60,
+                           WINDOW_TEXT, WINDOW_LONGTEXT, false)
+    add_float_with_range(CFG_PREFIX "max-gain", 15.f, 0.f, 40.f,
+                         MAX_GAIN_TEXT, MAX_GAIN_LONGTEXT, false)
+    set_capability("audio filter", 0)
+    set_callback(Open)
+    add_shortcut("loudnorm")
+vlc_module_end()
@@ -0,0 +1,618 @@
+/*****************************************************************************
+ * polyphase.c: polyphase FIR resampler
+ *****************************************************************************
+ * Copyright © 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Preamble
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <assert.h>
+#include <math.h>
+
+#include <vlc_common.h>
+#include <vlc_aout.h>
+#include <vlc_filter.h>
+#include <vlc_plugin.h>
+
+#include "polyphase_fir.h"
+
+#define QUALITY_TEXT N_("Resampling quality")
+#define QUALITY_LONGTEXT N_("Resampling quality, from fastest to best")
+
+static const int quality_values[] = { 0, 1, 2, 3 };
+static const char *const quality_texts[] = {
+    N_("Fast"), N_("Medium"), N_("High"), N_("Very high"),
+};
+
+static const struct
+{
+    unsigned taps;      /* when upsampling */
+    double attenuation; /* dB */
+} qualities[] = {
+    {  32,  60. },
+    {  48,  80. },
+    {  96, 100. },
+    { 160, 120. },
+};
+
+static int OpenConverter(vlc_object_t *);
+static int OpenResampler(vlc_object_t *);
+
+vlc_module_begin()
+    set_shortname(N_("Polyphase"))
+    set_description(N_("Polyphase FIR audio resampler"))
+    set_category(CAT_AUDIO)
+    set_subcategory(SUBCAT_AUDIO_RESAMPLER)
+    add_integer("polyphase-resampler-quality", 2,
+                QUALITY_TEXT, QUALITY_LONGTEXT, true)
+        change_integer_list(quality_values, quality_texts)
+    set_capability("audio converter", 45)
+    set_callback(OpenConverter)
+
+    add_submodule()
+    set_capability("audio resampler", 45)
+    set_callback(OpenResampler)
+    add_shortcut("polyphase")
+vlc_module_end()
+
+/* Rate ratios with more phases use the interpolated table */
+#define MAX_FIXED_PHASES 1024
+/* Phases of the interpolated table, 2^VAR_PHASE_BITS */
+#define VAR_PHASE_BITS 8
+/* Output frames computed at once */
+#define POINTS 64
+
+typedef struct
+{
+    unsigned base_taps;
+    double attenuation;
+
+    polyphase_table_t fixed;    /* exact phases of the nominal rates */
+    unsigned fixed_rate;        /* input rate of the fixed table */
+    unsigned fixed_step;        /* phases per output frame */
+    polyphase_table_t var;      /* interpolated phases, for other rates */
+    const polyphase_table_t *table; /* table in use, NULL if none yet */
+
+    float *hist;        /* planar input history */
+    size_t stride;      /* frames allocated per channel */
+    size_t avail;       /* frames in the history */
+    unsigned taps;      /* filter length the history is laid out for */
+    size_t pos;         /* first input frame of the next output frame */
+    /* The next output frame is after the input frame pos + taps / 2 - 1,
+     * by phase / fixed.phases frames with the fixed table, or by
+     * frac * 2^-32 frames with the interpolated table. */
+    unsigned phase;
+    uint32_t frac;
+    vlc_tick_t next_pts;
+
+    float *scratch;     /* interpolated coefficients */
+    unsigned scratch_taps;
+    polyphase_point_t points[POINTS];
+} filter_sys_t;
+
+static size_t Center(const filter_sys_t *sys)
+{
+    return sys->pos + sys->taps / 2 - 1;
+}
+
+/* Grows the history so that it can hold frames */
+static int Reserve(filter_t *filter, size_t frames)
+{
+    filter_sys_t *sys = filter->p_sys;
+    const unsigned channels = filter->fmt_in.audio.i_channels;
+
+    if (frames <= sys->stride)
+        return VLC_SUCCESS;
+
+    const size_t stride = frames + frames / 2;
+    float *hist = vlc_alloc(stride * channels, sizeof (float));
+    if (unlikely(hist == NULL))
+        return VLC_ENOMEM;
+
+    for (unsigned c = 0; c < channels; c++)
+        memcpy(hist + c * stride, sys->hist + c * sys->stride,
+               sys->avail * sizeof (float));
+    free(sys->hist);
+    sys->hist = hist;
+    sys->stride = stride;
+    return VLC_SUCCESS;
+}
+
+/* Deinterleaves input frames at the end of the history */
+static int Append(filter_t *filter, const float *buf, size_t frames)
+{
+    filter_sys_t *sys = filter->p_sys;
+    const unsigned channels = filter->fmt_in.audio.i_channels;
+
+    if (Reserve(filter, sys->avail + frames))
+        return VLC_ENOMEM;
+
+    for (unsigned c = 0; c < channels; c++)
+    {
+        float *dst = sys->hist + c * sys->stride + sys->avail;
+
+        if (buf != NULL)
+            for (size_t j = 0; j < frames; j++)
+                dst[j] = buf[j * channels + c];
+        else
+            memset(dst, 0, frames * sizeof (float));
+    }
+    sys->avail += frames;
+    return VLC_SUCCESS;
+}
+
+/* Drops the frames before pos */
+static void Discard(filter_t *filter)
+{
+    filter_sys_t *sys = filter->p_sys;
+    const unsigned channels = filter->fmt_in.audio.i_channels;
+
+    if (sys->pos == 0)
+        return;
+
+    assert(sys->pos <= sys->avail);
+    sys->avail -= sys->pos;
+    for (unsigned c = 0; c < channels; c++)
+    {
+        float *hist = sys->hist + c * sys->stride;
+
+        memmove(hist, hist + sys->pos, sys->avail * sizeof (float));
+    }
+    sys->pos = 0;
+}
+
+/* Moves the next output frame after the input frame center, padding the
+ * history with silence if it does not reach back enough */
+static int SetCenter(filter_t *filter, size_t center)
+{
+    filter_sys_t *sys = filter->p_sys;
+    const unsigned channels = filter->fmt_in.audio.i_channels;
+    const size_t before = sys->taps / 2 - 1;
+
+    if (center < before)
+    {
+        const size_t pad = before - center;
+
+        if (Reserve(filter, sys->avail + pad))
+            return VLC_ENOMEM;
+
+        for (unsigned c = 0; c < channels; c++)
+        {
+            float *hist = sys->hist + c * sys->stride;
+
+            memmove(hist + pad, hist, sys->avail * sizeof (float));
+            memset(hist, 0, pad * sizeof (float));
+        }
+        sys->avail += pad;
+        center += pad;
+    }
+    sys->pos = center - before;
+    return VLC_SUCCESS;
+}
+
+static int Reset(filter_t *filter)
+{
+    filter_sys_t *sys = filter->p_sys;
+
+    sys->avail = 0;
+    sys->pos = 0;
+    sys->phase = 0;
+    sys->frac = 0;
+    sys->next_pts = VLC_TICK_INVALID;
+    return SetCenter(filter, 0);
+}
+
+/* Selects the table for the input rate */
+static int SetTable(filter_t *filter, unsigned in_rate)
+{
+    filter_sys_t *sys = filter->p_sys;
+    const unsigned out_rate = filter->fmt_out.audio.i_rate;
+    const polyphase_table_t *table;
+
+    if (sys->fixed.coeffs != NULL && in_rate == sys->fixed_rate)
+        table = &sys->fixed;
+    else
+    {
+        const double ratio = (double)out_rate / in_rate;
+        const double cutoff = ratio < 1. ? ratio : 1.;
+        const double var_cutoff = sys->var.ratio < 1. ? sys->var.ratio : 1.;
+
+        /* Clock drift correction barely moves the cut-off frequency, but the
+         * playback rate can */
+        if (sys->var.coeffs == NULL || fabs(cutoff / var_cutoff - 1.) > .01)
+        {
+            polyphase_table_t var;
+
+            if (polyphase_TableInit(&var, 1 << VAR_PHASE_BITS, ratio,
+                                    sys->base_taps, sys->attenuation))
+                return VLC_ENOMEM;
+            if (var.taps > sys->scratch_taps)
+            {
+                float *scratch = aligned_alloc(64, var.taps * sizeof (float));
+                if (unlikely(scratch == NULL))
+                {
+                    polyphase_TableClean(&var);
+                    return VLC_ENOMEM;
+                }
+                aligned_free(sys->scratch);
+                sys->scratch = scratch;
+                sys->scratch_taps = var.taps;
+            }
+            if (sys->var.coeffs != NULL)
+                polyphase_TableClean(&sys->var);
+            sys->var = var;
+        }
+        table = &sys->var;
+    }
+
+    if (table->taps != sys->taps)
+    {
+        const size_t center = Center(sys);
+
+        sys->taps = table->taps;
+        if (SetCenter(filter, center))
+            return VLC_ENOMEM;
+    }
+
+    if (table != sys->table)
+    {
+        if (table == &sys->fixed)
+            sys->phase = ((uint64_t)sys->frac * sys->fixed.phases) >> 32;
+        else if (sys->table == &sys->fixed)
+            sys->frac = ((uint64_t)sys->phase << 32) / sys->fixed.phases;
+        sys->table = table;
+    }
+    return VLC_SUCCESS;
+}
+
+/* Computes all the output frames the history allows */
+static block_t *Process(filter_t *filter, unsigned in_rate)
+{
+    filter_sys_t *sys = filter->p_sys;
+    const polyphase_table_t *table = sys->table;
+    const unsigned channels = filter->fmt_in.audio.i_channels;
+    const unsigned out_rate = filter->fmt_out.audio.i_rate;
+    const unsigned taps = table->taps;
+    size_t max = 0;
+
+    if (sys->pos + taps <= sys->avail)
+        max = (sys->avail - sys->pos - taps + 1) * (uint64_t)out_rate
+              / in_rate + 2;
+
+    block_t *out = block_Alloc(max * filter->fmt_out.audio.i_bytes_per_frame);
+    if (unlikely(out == NULL))
+        return NULL;
+
+    const float *in[AOUT_CHAN_MAX];
+    for (unsigned c = 0; c < channels; c++)
+        in[c] = sys->hist + c * sys->stride;
+
+    float *dst = (float *)out->p_buffer;
+    const uint64_t step = ((uint64_t)in_rate << 32) / out_rate;
+    size_t count = 0;
+
+    while (count < max && sys->pos + taps <= sys->avail)
+    {
+        unsigned n = 0;
+
+        if (table == &sys->fixed)
+        {
+            const unsigned phases = table->phases;
+
+            for (; n < POINTS && count + n < max
+                   && sys->pos + taps <= sys->avail; n++)
+            {
+                polyphase_point_t *pt = &sys->points[n];
+
+                pt->row = polyphase_TableRow(table, sys->phase);
+                pt->next = NULL;
+                pt->frac = 0.f;
+                pt->offset = sys->pos;
+
+                sys->phase += sys->fixed_step;
+                sys->pos += sys->phase / phases;
+                sys->phase %= phases;
+            }
+        }
+        else
+        {
+            for (; n < POINTS && count + n < max
+                   && sys->pos + taps <= sys->avail; n++)
+            {
+                polyphase_point_t *pt = &sys->points[n];
+                const unsigned phase = sys->frac >> (32 - VAR_PHASE_BITS);
+                const uint32_t mask = (UINT32_C(1) << (32 - VAR_PHASE_BITS)) - 1;
+
+                pt->row = polyphase_TableRow(table, phase);
+                pt->next = pt->row + taps;
+                pt->frac = (sys->frac & mask) * (1.f / (mask + 1.f));
+                pt->offset = sys->pos;
+
+                const uint64_t next = sys->frac + step;
+                sys->pos += next >> 32;
+                sys->frac = next;
+            }
+        }
+
+        polyphase_Filter(dst + count * channels, channels, in, sys->points,
+                         n, taps, sys->scratch);
+        count += n;
+    }
+
+    /* Keep the frames needed by the next output frames. The filters are
+     * much longer than the step, so pos is still within the history. */
+    Discard(filter);
+
+    out->i_buffer = count * filter->fmt_out.audio.i_bytes_per_frame;
+    out->i_nb_samples = count;
+    out->i_pts = out->i_dts = sys->next_pts;
+    out->i_length = vlc_tick_from_samples(count, out_rate);
+    if (sys->next_pts != VLC_TICK_INVALID)
+        sys->next_pts += out->i_length;
+    return out;
+}
+
+/* Number of received input frames not output yet */
+static size_t Pending(const filter_sys_t *sys)
+{
+    const size_t center = Center(sys);
+
+    return sys->avail > center ? sys->avail - center : 0;
+}
+
+static void UpdatePts(filter_t *filter, const block_t *in, size_t pending,
+                      unsigned in_rate)
+{
+    filter_sys_t *sys = filter->p_sys;
+
+    if (in->i_pts != VLC_TICK_INVALID)
+        sys->next_pts = in->i_pts - vlc_tick_from_samples(pending, in_rate);
+}
+
+/* Outputs the pending frames as they are, followed by room for extra
+ * frames */
+static block_t *Unfiltered(filter_t *filter, size_t extra)
+{
+    filter_sys_t *sys = filter->p_sys;
+    const unsigned channels = filter->fmt_in.audio.i_channels;
+    const size_t pending = Pending(sys);
+    const size_t center = Center(sys);
+
+    block_t *out = block_Alloc((pending + extra)
+                               * filter->fmt_in.audio.i_bytes_per_frame);
+    if (unlikely(out == NULL))
+        return NULL;
+
+    float *dst = (float *)out->p_buffer;
+    for (size_t j = 0; j < pending; j++)
+        for (unsigned c = 0; c < channels; c++)
+            *(dst++) = sys->hist[c * sys->stride + center + j];
+
+    out->i_nb_samples = pending + extra;
+    out->i_pts = out->i_dts = sys->next_pts;
+    out->i_length = vlc_tick_from_samples(out->i_nb_samples,
+                                          filter->fmt_in.audio.i_rate);
+    return out;
+}
+
+/* Same input and output rates: outputs the pending frames, then the block
+ * as is, keeping only the history needed to resample again */
+static block_t *Bypass(filter_t *filter, block_t *in)
+{
+    filter_sys_t *sys = filter->p_sys;
+    const unsigned channels = filter->fmt_in.audio.i_channels;
+    const size_t framesize = filter->fmt_in.audio.i_bytes_per_frame;
+    const size_t pending = Pending(sys);
+    const size_t before = sys->taps / 2 - 1;
+    const size_t frames = in->i_nb_samples;
+    block_t *out = in;
+
+    if (pending > 0)
+    {
+        UpdatePts(filter, in, pending, filter->fmt_in.audio.i_rate);
+        out = Unfiltered(filter, frames);
+        if (unlikely(out == NULL))
+        {
+            block_Release(in);
+            return NULL;
+        }
+        memcpy(out->p_buffer + pending * framesize, in->p_buffer,
+               frames * framesize);
+        out->i_flags = in->i_flags;
+    }
+
+    /* Only the last frames are needed, copy no more */
+    const size_t tail = frames < before ? frames : before;
+    if (Append(filter, (const float *)in->p_buffer + (frames - tail) * channels,
+               tail) == VLC_SUCCESS)
+    {
+        if (SetCenter(filter, sys->avail) == VLC_SUCCESS)
+            Discard(filter);
+    }
+    sys->phase = 0;
+    sys->frac = 0;
+    sys->next_pts = VLC_TICK_INVALID;
+
+    if (out != in)
+        block_Release(in);
+    return out;
+}
+
+static block_t *Resample(filter_t *filter, block_t *in)
+{
+    filter_sys_t *sys = filter->p_sys;
+    const unsigned in_rate = filter->fmt_in.audio.i_rate;
+
+    if (in->i_flags & BLOCK_FLAG_DISCONTINUITY)
+        Reset(filter);
+
+    if (in_rate == filter->fmt_out.audio.i_rate)
+        return Bypass(filter, in);
+
+    if (SetTable(filter, in_rate))
+        goto error;
+
+    UpdatePts(filter, in, Pending(sys), in_rate);
+
+    if (Append(filter, (const float *)in->p_buffer, in->i_nb_samples))
+        goto error;
+
+    block_t *out = Process(filter, in_rate);
+    if (out != NULL)
+        out->i_flags = in->i_flags;
+    block_Release(in);
+    return out;
+
+error:
+    block_Release(in);
+    return NULL;
+}
+
+static block_t *Drain(filter_t *filter)
+{
+    filter_sys_t *sys = filter->p_sys;
+    const unsigned in_rate = filter->fmt_in.audio.i_rate;
+    block_t *out = NULL;
+
+    if (Pending(sys) > 0)
+    {
+        if (in_rate == filter->fmt_out.audio.i_rate)
+            out = Unfiltered(filter, 0);
+        else if (SetTable(filter, in_rate) == VLC_SUCCESS
+              && Append(filter, NULL, sys->taps / 2) == VLC_SUCCESS)
+            out = Process(filter, in_rate);
+    }
+
+    Reset(filter);
+    return out;
+}
+
+static void Flush(filter_t *filter)
+{
+    Reset(filter);
+}
+
+static void Close(filter_t *filter)
+{
+    filter_sys_t *sys = filter->p_sys;
+
+    if (sys->fixed.coeffs != NULL)
+        polyphase_TableClean(&sys->fixed);
+    if (sys->var.coeffs != NULL)
+        polyphase_TableClean(&sys->var);
+    aligned_free(sys->scratch);
+    free(sys->hist);
+    free(sys);
+}
+
+static unsigned gcd(unsigned a, unsigned b)
+{
+    while (b != 0)
+    {
+        const unsigned r = a % b;
+        a = b;
+        b = r;
+    }
+    return a;
+}
+
+static int Open(vlc_object_t *obj)
+{
+    filter_t *filter = (filter_t *)obj;
+    const audio_format_t *fmt_in = &filter->fmt_in.audio;
+    const audio_format_t *fmt_out = &filter->fmt_out.audio;
+
+    if (fmt_in->i_format != VLC_CODEC_FL32
+     || fmt_out->i_format != VLC_CODEC_FL32
+     || fmt_in->i_channels != fmt_out->i_channels
+     || fmt_in->i_channels > AOUT_CHAN_MAX
+     || fmt_in->i_rate == 0 || fmt_out->i_rate == 0)
+        return VLC_EGENERIC;
+
+    filter_sys_t *sys = calloc(1, sizeof (*sys));
+    if (unlikely(sys == NULL))
+        return VLC_ENOMEM;
+    filter->p_sys = sys;
+
+    int64_t quality = var_InheritInteger(filter, "polyphase-resampler-quality");
+    if (quality < 0)
+        quality = 0;
+    else if (quality >= (int64_t)ARRAY_SIZE(qualities))
+        quality = ARRAY_SIZE(qualities) - 1;
+    sys->base_taps = qualities[quality].taps;
+    sys->attenuation = qualities[quality].attenuation;
+
+    /* Exact phases for the nominal rates: L output frames for M input
+     * frames, with L phases and a step of M phases */
+    const unsigned g = gcd(fmt_in->i_rate, fmt_out->i_rate);
+    const unsigned phases = fmt_out->i_rate / g;
+
+    if (fmt_in->i_rate != fmt_out->i_rate && phases <= MAX_FIXED_PHASES)
+    {
+        if (polyphase_TableInit(&sys->fixed, phases,
+                                (double)fmt_out->i_rate / fmt_in->i_rate,
+                                sys->base_taps, sys->attenuation))
+            goto error;
+        sys->fixed_rate = fmt_in->i_rate;
+        sys->fixed_step = fmt_in->i_rate / g;
+    }
+
+    /* Even with the same rates, keep enough history to resample */
+    sys->taps = polyphase_Taps((double)fmt_out->i_rate / fmt_in->i_rate,
+                               sys->base_taps);
+    if (Reset(filter))
+        goto error;
+
+    msg_Dbg(filter, "%u Hz to %u Hz, %s phases, %u taps",
+            fmt_in->i_rate, fmt_out->i_rate,
+            sys->fixed.coeffs != NULL ? "exact" : "interpolated", sys->taps);
+
+    static const struct vlc_filter_operations filter_ops =
+    {
+        .filter_audio = Resample,
+        .drain_audio = Drain,
+        .flush = Flush,
+        .close = Close,
+    };
+    filter->ops = &filter_ops;
+    return VLC_SUCCESS;
+
+error:
+    Close(filter);
+    return VLC_ENOMEM;
+}
+
+static int OpenResampler(vlc_object_t *obj)
+{
+    return Open(obj);
+}
+
+static int OpenConverter(vlc_object_t *obj)
+{
+    filter_t *filter = (filter_t *)obj;
+
+    /* Only convert the rate */
+    if (filter->fmt_in.audio.i_rate == filter->fmt_out.audio.i_rate)
+        return VLC_EGENERIC;
+    return Open(obj);
+}
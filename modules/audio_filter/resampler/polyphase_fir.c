@@ -0,0 +1,317 @@
+/*****************************************************************************
+ * polyphase_fir.c: polyphase FIR resampling filters
+ *****************************************************************************
+ * Copyright © 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <math.h>
+
+#include <vlc_common.h>
+#include <vlc_cpu.h>
+
+#include "polyphase_fir.h"
+
+/* Zeroth order modified Bessel function of the first kind */
+static double BesselI0(double x)
+{
+    double sum = 1., term = 1.;
+
+    for (unsigned k = 1; term > sum * 1e-21; k++)
+    {
+        const double t = x / (2 * k);
+        term *= t * t;
+        sum += term;
+    }
+    return sum;
+}
+
+unsigned polyphase_Taps(double ratio, unsigned base_taps)
+{
+    const unsigned taps = ceil(ratio < 1. ? base_taps / ratio : base_taps);
+
+    return (taps + POLYPHASE_TAPS_ALIGN - 1) & ~(POLYPHASE_TAPS_ALIGN - 1);
+}
+
+int polyphase_TableInit(polyphase_table_t *table, unsigned phases,
+                        double ratio, unsigned base_taps, double attenuation)
+{
+    /* Cut-off frequency relative to the input rate */
+    const double scale = ratio < 1. ? ratio : 1.;
+    const unsigned taps = polyphase_Taps(ratio, base_taps);
+
+    /* Kaiser window design: transition band width, in cycles per input
+     * frame, and shape parameter */
+    const double width = (attenuation - 7.95) / (14.36 * taps);
+    const double cutoff = .5 * scale - .5 * width;
+    const double beta = attenuation > 50.
+        ? .1102 * (attenuation - 8.7)
+        : .5842 * pow(attenuation - 21., .4) + .07886 * (attenuation - 21.);
+    const double half = taps / 2;
+    const double i0_beta = BesselI0(beta);
+
+    table->coeffs = aligned_alloc(64, (phases + 1) * taps * sizeof (float));
+    if (unlikely(table->coeffs == NULL))
+        return VLC_ENOMEM;
+    table->phases = phases;
+    table->taps = taps;
+    table->ratio = ratio;
+
+    for (unsigned p = 0; p <= phases; p++)
+    {
+        float *row = table->coeffs + (size_t)p * taps;
+        double h[taps], sum = 0.;
+
+        for (unsigned k = 0; k < taps; k++)
+        {
+            /* Distance from the output instant, in input frames */
+            const double t = k - (half - 1.) - (double)p / phases;
+            const double r = t / half;
+
+            h[k] = 2. * cutoff;
+            if (t != 0.)
+                h[k] *= sin(2. * M_PI * cutoff * t) / (2. * M_PI * cutoff * t);
+            h[k] *= r * r < 1. ? BesselI0(beta * sqrt(1. - r * r)) / i0_beta
+                               : 0.;
+            sum += h[k];
+        }
+
+        /* Unity gain at DC for every phase */
+        for (unsigned k = 0; k < taps; k++)
+            row[k] = h[k] / sum;
+    }
+    return VLC_SUCCESS;
+}
+
+void polyphase_TableClean(polyphase_table_t *table)
+{
+    aligned_free(table->coeffs);
+}
+
+void polyphase_Filter_C(float *out, unsigned channels, const float *const *in,
+                        const polyphase_point_t *points, unsigned count,
+                        unsigned taps, float *scratch)
+{
+    for (unsigned j = 0; j < count; j++)
+    {
+        const float *h = points[j].row;
+
+        if (points[j].next != NULL)
+        {
+            const float w = points[j].frac;
+
+            for (unsigned k = 0; k < taps; k++)
+                scratch[k] = h[k] + w * (points[j].next[k] - h[k]);
+            h = scratch;
+        }
+
+        for (unsigned c = 0; c < channels; c++)
+        {
+            const float *x = in[c] + points[j].offset;
+            float sum = 0.f;
+
+            for (unsigned k = 0; k < taps; k++)
+                sum += h[k] * x[k];
+            *(out++) = sum;
+        }
+    }
+}
+
+#ifdef HAVE_SSE2_INTRINSICS
+# include <emmintrin.h>
+
+__attribute__ ((__target__ ("sse2")))
+static void FilterSSE2(float *out, unsigned channels, const float *const *in,
+                       const polyphase_point_t *points, unsigned count,
+                       unsigned taps, float *scratch)
+{
+    for (unsigned j = 0; j < count; j++)
+    {
+        const float *h = points[j].row;
+
+        if (points[j].next != NULL)
+        {
+            const __m128 w = _mm_set1_ps(points[j].frac);
+
+            for (unsigned k = 0; k < taps; k += 4)
+            {
+                const __m128 a = _mm_load_ps(h + k);
+                const __m128 b = _mm_load_ps(points[j].next + k);
+                _mm_store_ps(scratch + k,
+                             _mm_add_ps(a, _mm_mul_ps(w, _mm_sub_ps(b, a))));
+            }
+            h = scratch;
+        }
+
+        for (unsigned c = 0; c < channels; c++)
+        {
+            const float *x = in[c] + points[j].offset;
+            __m128 acc0 = _mm_setzero_ps(), acc1 = _mm_setzero_ps();
+            __m128 acc2 = _mm_setzero_ps(), acc3 = _mm_setzero_ps();
+
+            for (unsigned k = 0; k < taps; k += 16)
+            {
+                acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_load_ps(h + k),
+                                                   _mm_loadu_ps(x + k)));
+                acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_load_ps(h + k + 4),
+                                                   _mm_loadu_ps(x + k + 4)));
+                acc2 = _mm_add_ps(acc2, _mm_mul_ps(_mm_load_ps(h + k + 8),
+                                                   _mm_loadu_ps(x + k + 8)));
+                acc3 = _mm_add_ps(acc3, _mm_mul_ps(_mm_load_ps(h + k + 12),
+                                                   _mm_loadu_ps(x + k + 12)));
+            }
+
+            acc0 = _mm_add_ps(_mm_add_ps(acc0, acc1), _mm_add_ps(acc2, acc3));
+            acc0 = _mm_add_ps(acc0, _mm_movehl_ps(acc0, acc0));
+            acc0 = _mm_add_ss(acc0, _mm_shuffle_ps(acc0, acc0, 1));
+            *(out++) = _mm_cvtss_f32(acc0);
+        }
+    }
+}
+#endif
+
+#ifdef HAVE_AVX2_INTRINSICS
+# include <immintrin.h>
+
+__attribute__ ((__target__ ("avx2")))
+static void FilterAVX2(float *out, unsigned channels, const float *const *in,
+                       const polyphase_point_t *points, unsigned count,
+                       unsigned taps, float *scratch)
+{
+    for (unsigned j = 0; j < count; j++)
+    {
+        const float *h = points[j].row;
+
+        if (points[j].next != NULL)
+        {
+            const __m256 w = _mm256_set1_ps(points[j].frac);
+
+            for (unsigned k = 0; k < taps; k += 8)
+            {
+                const __m256 a = _mm256_load_ps(h + k);
+                const __m256 b = _mm256_load_ps(points[j].next + k);
+                _mm256_store_ps(scratch + k,
+                    _mm256_add_ps(a, _mm256_mul_ps(w, _mm256_sub_ps(b, a))));
+            }
+            h = scratch;
+        }
+
+        for (unsigned c = 0; c < channels; c++)
+        {
+            const float *x = in[c] + points[j].offset;
+            __m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps();
+
+            for (unsigned k = 0; k < taps; k += 16)
+            {
+                acc0 = _mm256_add_ps(acc0,
+                    _mm256_mul_ps(_mm256_load_ps(h + k),
+                                  _mm256_loadu_ps(x + k)));
+                acc1 = _mm256_add_ps(acc1,
+                    _mm256_mul_ps(_mm256_load_ps(h + k + 8),
+                                  _mm256_loadu_ps(x + k + 8)));
+            }
+
+            acc0 = _mm256_add_ps(acc0, acc1);
+            __m128 v = _mm_add_ps(_mm256_castps256_ps128(acc0),
+                                  _mm256_extractf128_ps(acc0, 1));
+            v = _mm_add_ps(v, _mm_movehl_ps(v, v));
+            v = _mm_add_ss(v, _mm_shuffle_ps(v, v, 1));
+            *(out++) = _mm_cvtss_f32(v);
+        }
+    }
+}
+#endif
+
+#ifdef __ARM_NEON
+# include <arm_neon.h>
+
+static void FilterNEON(float *out, unsigned channels, const float *const *in,
+                       const polyphase_point_t *points, unsigned count,
+                       unsigned taps, float *scratch)
+{
+    for (unsigned j = 0; j < count; j++)
+    {
+        const float *h = points[j].row;
+
+        if (points[j].next != NULL)
+        {
+            const float32x4_t w = vdupq_n_f32(points[j].frac);
+
+            for (unsigned k = 0; k < taps; k += 4)
+            {
+                const float32x4_t a = vld1q_f32(h + k);
+                const float32x4_t b = vld1q_f32(points[j].next + k);
+                vst1q_f32(scratch + k, vmlaq_f32(a, w, vsubq_f32(b, a)));
+            }
+            h = scratch;
+        }
+
+        for (unsigned c = 0; c < channels; c++)
+        {
+            const float *x = in[c] + points[j].offset;
+            float32x4_t acc0 = vdupq_n_f32(0), acc1 = vdupq_n_f32(0);
+            float32x4_t acc2 = vdupq_n_f32(0), acc3 = vdupq_n_f32(0);
+
+            for (unsigned k = 0; k < taps; k += 16)
+            {
+                acc0 = vmlaq_f32(acc0, vld1q_f32(h + k), vld1q_f32(x + k));
+                acc1 = vmlaq_f32(acc1, vld1q_f32(h + k + 4),
+                                 vld1q_f32(x + k + 4));
+                acc2 = vmlaq_f32(acc2, vld1q_f32(h + k + 8),
+                                 vld1q_f32(x + k + 8));
+                acc3 = vmlaq_f32(acc3, vld1q_f32(h + k + 12),
+                                 vld1q_f32(x + k + 12));
+            }
+
+            acc0 = vaddq_f32(vaddq_f32(acc0, acc1), vaddq_f32(acc2, acc3));
+            float32x2_t v = vadd_f32(vget_low_f32(acc0), vget_high_f32(acc0));
+            *(out++) = vget_lane_f32(vpadd_f32(v, v), 0);
+        }
+    }
+}
+#endif
+
+void polyphase_Filter(float *out, unsigned channels, const float *const *in,
+                      const polyphase_point_t *points, unsigned count,
+                      unsigned taps, float *scratch)
+{
+#ifdef HAVE_AVX2_INTRINSICS
+    if (vlc_CPU_AVX2())
+    {
+        FilterAVX2(out, channels, in, points, count, taps, scratch);
+        return;
+    }
+#endif
+#ifdef HAVE_SSE2_INTRINSICS
+    if (vlc_CPU_SSE2())
+    {
+        FilterSSE2(out, channels, in, points, count, taps, scratch);
+        return;
+    }
+#endif
+#ifdef __ARM_NEON
+    if (vlc_CPU_ARM_NEON())
+    {
+        FilterNEON(out, channels, in, points, count, taps, scratch);
+        return;
+    }
+#endif
+    polyphase_Filter_C(out, channels, in, points, count, taps, scratch);
+}
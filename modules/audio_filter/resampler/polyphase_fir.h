@@ -0,0 +1,97 @@
+/*****************************************************************************
+ * polyphase_fir.h: polyphase FIR resampling filters
+ *****************************************************************************
+ * Copyright © 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_POLYPHASE_FIR_H
+#define VLC_POLYPHASE_FIR_H 1
+
+/* Number of taps of the filters are multiples of this */
+#define POLYPHASE_TAPS_ALIGN 16
+
+/**
+ * Kaiser windowed sinc low-pass filter, sampled at phases positions between
+ * two input frames.
+ *
+ * Row p of the table holds the taps computing the output at p / phases
+ * frames after the input frame taps / 2 - 1, from taps input frames.
+ * There are phases + 1 rows, so that the phases can be interpolated.
+ */
+typedef struct
+{
+    float *coeffs;      /**< 64-byte aligned rows of taps coefficients */
+    unsigned phases;
+    unsigned taps;
+    double ratio;       /**< output rate / input rate */
+} polyphase_table_t;
+
+/**
+ * Number of taps of the filters of a rate ratio.
+ */
+unsigned polyphase_Taps(double ratio, unsigned base_taps);
+
+/**
+ * Designs the filters of a rate ratio.
+ *
+ * The cut-off frequency is set so that the stop band starts at the lowest
+ * Nyquist frequency of the input and output rates.
+ *
+ * \param base_taps number of taps when upsampling, scaled up when
+ *                  downsampling to keep the same transition band
+ * \param attenuation stop band attenuation (dB)
+ */
+int polyphase_TableInit(polyphase_table_t *, unsigned phases, double ratio,
+                        unsigned base_taps, double attenuation);
+void polyphase_TableClean(polyphase_table_t *);
+
+static inline const float *polyphase_TableRow(const polyphase_table_t *table,
+                                              unsigned phase)
+{
+    return table->coeffs + (size_t)phase * table->taps;
+}
+
+/** An output frame */
+typedef struct
+{
+    const float *row;   /**< taps coefficients */
+    const float *next;  /**< coefficients of the next phase, or NULL */
+    float frac;         /**< interpolation weight of the next phase */
+    size_t offset;      /**< first input frame */
+} polyphase_point_t;
+
+/**
+ * Computes interleaved output frames from planar input channels.
+ *
+ * out[j * channels + c] is the sum over k below taps of
+ * h[k] * in[c][points[j].offset + k], h being the coefficients of the point,
+ * or their interpolation with the next phase ones.
+ *
+ * \param scratch 64-byte aligned buffer of taps floats
+ */
+void polyphase_Filter_C(float *out, unsigned channels, const float *const *in,
+                        const polyphase_point_t *points, unsigned count,
+                        unsigned taps, float *scratch);
+
+/**
+ * Same as polyphase_Filter_C(), vectorized.
+ */
+void polyphase_Filter(float *out, unsigned channels, const float *const *in,
+                      const polyphase_point_t *points, unsigned count,
+                      unsigned taps, float *scratch);
+
+#endif
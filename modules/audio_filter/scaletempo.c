@@ -37,6 +37,8 @@
 #include <string.h> /* for memset */
 #include <limits.h> /* form INT_MIN */
 
+#include "scaletempo_search.h"
+
 /*****************************************************************************
  * Module descriptor
  *****************************************************************************/
@@ -128,6 +130,7 @@ typedef struct
     unsigned  frames_search;
     void     *buf_pre_corr;
     void     *table_window;
+    float    *buf_corr;
     unsigned(*best_overlap_offset)( filter_t *p_filter );
 #ifdef PITCH_SHIFTER
     /* pitch */
@@ -143,9 +146,7 @@ static unsigned best_overlap_offset_float( filter_t *p_filter )
 {
     filter_sys_t *p = p_filter->p_sys;
     float *pw, *po, *ppc, *search_start;
-    float best_corr = INT_MIN;
-    unsigned best_off = 0;
-    unsigned i, off;
+    unsigned i, best_off;
 
     pw  = p->table_window;
     po  = p->buf_overlap;
@@ -155,20 +156,12 @@ static unsigned best_overlap_offset_float( filter_t *p_filter )
       *ppc++ = *pw++ * *po++;
     }
 
+    /* Vectorized cross correlation, same choice as a sample order search */
     search_start = (float *)p->buf_queue + p->samples_per_frame;
-    for( off = 0; off < p->frames_search; off++ ) {
-      float corr = 0;
-      float *ps = search_start;
-      ppc = p->buf_pre_corr;
-      for( i = p->samples_per_frame; i < p->samples_overlap; i++ ) {
-        corr += *ppc++ * *ps++;
-      }
-      if( corr > best_corr ) {
-        best_corr = corr;
-        best_off  = off;
-      }
-      search_start += p->samples_per_frame;
-    }
+    best_off = scaletempo_BestOffset( p->buf_pre_corr, search_start,
+                                      p->samples_overlap - p->samples_per_frame,
+                                      p->samples_per_frame, p->frames_search,
+                                      p->buf_corr );
 
     return best_off * p->bytes_per_frame;
 }
@@ -342,7 +335,8 @@ static int reinit_buffers( filter_t *p_filter )
         unsigned bytes_pre_corr = ( p->samples_overlap - p->samples_per_frame ) * 4; /* sizeof (int32|float) */
         p->buf_pre_corr = malloc( bytes_pre_corr );
         p->table_window = malloc( bytes_pre_corr );
-        if( ! p->buf_pre_corr || ! p->table_window )
+        p->buf_corr     = vlc_alloc( p->frames_search, sizeof(*p->buf_corr) );
+        if( ! p->buf_pre_corr || ! p->table_window || ! p->buf_corr )
             return VLC_ENOMEM;
         float *pw = p->table_window;
         for( i = 1; i<frames_overlap; i++ )
@@ -430,6 +424,7 @@ static int Open( vlc_object_t *p_this )
     p_sys->table_blend    = NULL;
     p_sys->buf_pre_corr   = NULL;
     p_sys->table_window   = NULL;
+    p_sys->buf_corr       = NULL;
     p_sys->bytes_overlap  = 0;
     p_sys->bytes_queued   = 0;
     p_sys->bytes_to_slide = 0;
@@ -533,6 +528,7 @@ static void Close( filter_t *p_filter )
     free( p_sys->table_blend );
     free( p_sys->buf_pre_corr );
     free( p_sys->table_window );
+    free( p_sys->buf_corr );
     free( p_sys );
 }
 
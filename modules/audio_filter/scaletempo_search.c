@@ -0,0 +1,342 @@
+/*****************************************************************************
+ * scaletempo_search.c: Scaletempo best overlap search
+ *****************************************************************************
+ * Copyright © 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <float.h>
+#include <limits.h>
+#include <math.h>
+
+#include <vlc_common.h>
+#include <vlc_cpu.h>
+
+#include "scaletempo_search.h"
+
+/*
+ * The vectorized sums add the products in another order than the reference
+ * loop, so they can differ by a few ulps and pick another offset among
+ * nearly equal correlations. For any summation order, the error of a float
+ * dot product of n terms is at most gamma(n) = n.u / (1 - n.u) times the sum
+ * of the absolute values of the products, u being the unit roundoff. That
+ * sum is bounded by the product of the norms of both vectors (Cauchy-Schwarz).
+ *
+ * Any offset whose vectorized correlation, plus twice that bound, reaches the
+ * best vectorized correlation minus twice its bound might be the reference
+ * winner. Those few offsets are computed again in sample order.
+ */
+
+/* Reference correlation, in sample order */
+static float Correlate(const float *pre_corr, const float *search,
+                       unsigned samples)
+{
+    float corr = 0;
+    for (unsigned i = 0; i < samples; i++)
+        corr += *pre_corr++ * *search++;
+    return corr;
+}
+
+unsigned scaletempo_BestOffset_C(const float *pre_corr, const float *search,
+                                 unsigned samples, unsigned samples_per_frame,
+                                 unsigned frames)
+{
+    float best_corr = INT_MIN;
+    unsigned best_off = 0;
+
+    for (unsigned off = 0; off < frames; off++)
+    {
+        float corr = Correlate(pre_corr, search, samples);
+        if (corr > best_corr)
+        {
+            best_corr = corr;
+            best_off  = off;
+        }
+        search += samples_per_frame;
+    }
+    return best_off;
+}
+
+static void CorrelateAllC(const float *pre_corr, const float *search,
+                          unsigned samples, unsigned samples_per_frame,
+                          unsigned frames, float *corr)
+{
+    for (unsigned off = 0; off < frames; off++)
+    {
+        float acc[4] = { 0, 0, 0, 0 };
+        unsigned i = 0;
+
+        for (; i + 4 <= samples; i += 4)
+            for (unsigned j = 0; j < 4; j++)
+                acc[j] += pre_corr[i + j] * search[i + j];
+        for (; i < samples; i++)
+            acc[0] += pre_corr[i] * search[i];
+
+        corr[off] = (acc[0] + acc[1]) + (acc[2] + acc[3]);
+        search += samples_per_frame;
+    }
+}
+
+#ifdef HAVE_SSE2_INTRINSICS
+# include <emmintrin.h>
+
+__attribute__ ((__target__ ("sse2")))
+static void CorrelateAllSSE2(const float *pre_corr, const float *search,
+                             unsigned samples, unsigned samples_per_frame,
+                             unsigned frames, float *corr)
+{
+    for (unsigned off = 0; off < frames; off++)
+    {
+        __m128 acc0 = _mm_setzero_ps(), acc1 = _mm_setzero_ps();
+        __m128 acc2 = _mm_setzero_ps(), acc3 = _mm_setzero_ps();
+        unsigned i = 0;
+
+        for (; i + 16 <= samples; i += 16)
+        {
+            acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(pre_corr + i),
+                                               _mm_loadu_ps(search + i)));
+            acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(pre_corr + i + 4),
+                                               _mm_loadu_ps(search + i + 4)));
+            acc2 = _mm_add_ps(acc2, _mm_mul_ps(_mm_loadu_ps(pre_corr + i + 8),
+                                               _mm_loadu_ps(search + i + 8)));
+            acc3 = _mm_add_ps(acc3, _mm_mul_ps(_mm_loadu_ps(pre_corr + i + 12),
+                                               _mm_loadu_ps(search + i + 12)));
+        }
+        for (; i + 4 <= samples; i += 4)
+            acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(pre_corr + i),
+                                               _mm_loadu_ps(search + i)));
+
+        acc0 = _mm_add_ps(_mm_add_ps(acc0, acc1), _mm_add_ps(acc2, acc3));
+        acc0 = _mm_add_ps(acc0, _mm_movehl_ps(acc0, acc0));
+        acc0 = _mm_add_ss(acc0, _mm_shuffle_ps(acc0, acc0, 1));
+
+        float sum = _mm_cvtss_f32(acc0);
+        for (; i < samples; i++)
+            sum += pre_corr[i] * search[i];
+        corr[off] = sum;
+        search += samples_per_frame;
+    }
+}
+#endif
+
+#ifdef HAVE_AVX2_INTRINSICS
+# include <immintrin.h>
+
+__attribute__ ((__target__ ("avx2")))
+static void CorrelateAllAVX2(const float *pre_corr, const float *search,
+                             unsigned samples, unsigned samples_per_frame,
+                             unsigned frames, float *corr)
+{
+    for (unsigned off = 0; off < frames; off++)
+    {
+        __m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps();
+        __m256 acc2 = _mm256_setzero_ps(), acc3 = _mm256_setzero_ps();
+        unsigned i = 0;
+
+        for (; i + 32 <= samples; i += 32)
+        {
+            acc0 = _mm256_add_ps(acc0,
+                _mm256_mul_ps(_mm256_loadu_ps(pre_corr + i),
+                              _mm256_loadu_ps(search + i)));
+            acc1 = _mm256_add_ps(acc1,
+                _mm256_mul_ps(_mm256_loadu_ps(pre_corr + i + 8),
+                              _mm256_loadu_ps(search + i + 8)));
+            acc2 = _mm256_add_ps(acc2,
+                _mm256_mul_ps(_mm256_loadu_ps(pre_corr + i + 16),
+                              _mm256_loadu_ps(search + i + 16)));
+            acc3 = _mm256_add_ps(acc3,
+                _mm256_mul_ps(_mm256_loadu_ps(pre_corr + i + 24),
+                              _mm256_loadu_ps(search + i + 24)));
+        }
+        for (; i + 8 <= samples; i += 8)
+            acc0 = _mm256_add_ps(acc0,
+                _mm256_mul_ps(_mm256_loadu_ps(pre_corr + i),
+                              _mm256_loadu_ps(search + i)));
+
+        acc0 = _mm256_add_ps(_mm256_add_ps(acc0, acc1),
+                             _mm256_add_ps(acc2, acc3));
+        __m128 v = _mm_add_ps(_mm256_castps256_ps128(acc0),
+                              _mm256_extractf128_ps(acc0, 1));
+        v = _mm_add_ps(v, _mm_movehl_ps(v, v));
+        v = _mm_add_ss(v, _mm_shuffle_ps(v, v, 1));
+
+        float sum = _mm_cvtss_f32(v);
+        for (; i < samples; i++)
+            sum += pre_corr[i] * search[i];
+        corr[off] = sum;
+        search += samples_per_frame;
+    }
+}
+#endif
+
+#ifdef __ARM_NEON
+# include <arm_neon.h>
+
+static void CorrelateAllNEON(const float *pre_corr, const float *search,
+                             unsigned samples, unsigned samples_per_frame,
+                             unsigned frames, float *corr)
+{
+    for (unsigned off = 0; off < frames; off++)
+    {
+        float32x4_t acc0 = vdupq_n_f32(0), acc1 = vdupq_n_f32(0);
+        float32x4_t acc2 = vdupq_n_f32(0), acc3 = vdupq_n_f32(0);
+        unsigned i = 0;
+
+        for (; i + 16 <= samples; i += 16)
+        {
+            acc0 = vmlaq_f32(acc0, vld1q_f32(pre_corr + i),
+                             vld1q_f32(search + i));
+            acc1 = vmlaq_f32(acc1, vld1q_f32(pre_corr + i + 4),
+                             vld1q_f32(search + i + 4));
+            acc2 = vmlaq_f32(acc2, vld1q_f32(pre_corr + i + 8),
+                             vld1q_f32(search + i + 8));
+            acc3 = vmlaq_f32(acc3, vld1q_f32(pre_corr + i + 12),
+                             vld1q_f32(search + i + 12));
+        }
+        for (; i + 4 <= samples; i += 4)
+            acc0 = vmlaq_f32(acc0, vld1q_f32(pre_corr + i),
+                             vld1q_f32(search + i));
+
+        acc0 = vaddq_f32(vaddq_f32(acc0, acc1), vaddq_f32(acc2, acc3));
+        float32x2_t v = vadd_f32(vget_low_f32(acc0), vget_high_f32(acc0));
+
+        float sum = vget_lane_f32(vpadd_f32(v, v), 0);
+        for (; i < samples; i++)
+            sum += pre_corr[i] * search[i];
+        corr[off] = sum;
+        search += samples_per_frame;
+    }
+}
+#endif
+
+static void CorrelateAll(const float *pre_corr, const float *search,
+                         unsigned samples, unsigned samples_per_frame,
+                         unsigned frames, float *corr)
+{
+#ifdef HAVE_AVX2_INTRINSICS
+    if (vlc_CPU_AVX2())
+    {
+        CorrelateAllAVX2(pre_corr, search, samples, samples_per_frame,
+                         frames, corr);
+        return;
+    }
+#endif
+#ifdef HAVE_SSE2_INTRINSICS
+    if (vlc_CPU_SSE2())
+    {
+        CorrelateAllSSE2(pre_corr, search, samples, samples_per_frame,
+                         frames, corr);
+        return;
+    }
+#endif
+#ifdef __ARM_NEON
+    if (vlc_CPU_ARM_NEON())
+    {
+        CorrelateAllNEON(pre_corr, search, samples, samples_per_frame,
+                         frames, corr);
+        return;
+    }
+#endif
+    CorrelateAllC(pre_corr, search, samples, samples_per_frame, frames, corr);
+}
+
+static double Energy(const float *p, unsigned samples)
+{
+    double energy = 0;
+    for (unsigned i = 0; i < samples; i++)
+        energy += (double)p[i] * p[i];
+    return energy;
+}
+
+/* Sliding energy of the search windows */
+static double NextEnergy(double energy, const float *search, unsigned samples,
+                         unsigned samples_per_frame)
+{
+    energy += Energy(search + samples, samples_per_frame)
+            - Energy(search, samples_per_frame);
+    return energy > 0. ? energy : 0.;
+}
+
+unsigned scaletempo_BestOffset(const float *pre_corr, const float *search,
+                               unsigned samples, unsigned samples_per_frame,
+                               unsigned frames, float *corr)
+{
+    const double u = FLT_EPSILON / 2.;
+    if (samples * u >= .5)
+        return scaletempo_BestOffset_C(pre_corr, search, samples,
+                                       samples_per_frame, frames);
+
+    CorrelateAll(pre_corr, search, samples, samples_per_frame, frames, corr);
+
+    /* Twice the error bound of one sum, with some slack for the rounding of
+     * the bound itself, for the drift of the sliding energy, and for
+     * underflowing products */
+    const double gamma = samples * u / (1. - samples * u);
+    const double scale = 2. * gamma * sqrt(Energy(pre_corr, samples)) * 1.01;
+    const double slack = 1e-10 * Energy(search, samples +
+                                        (frames - 1) * samples_per_frame);
+    const double tiny = 4. * samples * FLT_MIN;
+
+    double energy = Energy(search, samples);
+    double threshold = -INFINITY;
+    const float *ps = search;
+
+    for (unsigned off = 0; off < frames; off++)
+    {
+        if (!isfinite(corr[off]))
+            return scaletempo_BestOffset_C(pre_corr, search, samples,
+                                           samples_per_frame, frames);
+
+        const double low = corr[off] - (scale * sqrt(energy + slack) + tiny);
+        if (low > threshold)
+            threshold = low;
+
+        if (off + 1 < frames)
+            energy = NextEnergy(energy, ps, samples, samples_per_frame);
+        ps += samples_per_frame;
+    }
+    if (!isfinite(threshold))
+        return scaletempo_BestOffset_C(pre_corr, search, samples,
+                                       samples_per_frame, frames);
+
+    /* Compute the candidates again in sample order, in offset order */
+    float best_corr = INT_MIN;
+    unsigned best_off = 0;
+
+    energy = Energy(search, samples);
+    ps = search;
+    for (unsigned off = 0; off < frames; off++)
+    {
+        if (corr[off] + (scale * sqrt(energy + slack) + tiny) >= threshold)
+        {
+            float exact = Correlate(pre_corr, ps, samples);
+            if (exact > best_corr)
+            {
+                best_corr = exact;
+                best_off  = off;
+            }
+        }
+
+        if (off + 1 < frames)
+            energy = NextEnergy(energy, ps, samples, samples_per_frame);
+        ps += samples_per_frame;
+    }
+    return best_off;
+}
@@ -0,0 +1,49 @@
+/*****************************************************************************
+ * scaletempo_search.h: Scaletempo best overlap search
+ *****************************************************************************
+ * Copyright © 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_SCALETEMPO_SEARCH_H
+#define VLC_SCALETEMPO_SEARCH_H 1
+
+/**
+ * Finds the frame offset maximizing the correlation between the windowed
+ * overlap and the search buffer.
+ *
+ * The correlation of offset off is the float sum, in sample order, of
+ * pre_corr[i] * search[off * samples_per_frame + i] for i below samples.
+ * The first offset with the highest correlation wins.
+ */
+unsigned scaletempo_BestOffset_C(const float *pre_corr, const float *search,
+                                 unsigned samples, unsigned samples_per_frame,
+                                 unsigned frames);
+
+/**
+ * Same as scaletempo_BestOffset_C(), with vectorized correlations.
+ *
+ * The offsets the vectorized sums can not tell apart from the best one are
+ * computed again in sample order, so that both functions always return the
+ * same offset.
+ *
+ * \param corr scratch buffer of frames floats
+ */
+unsigned scaletempo_BestOffset(const float *pre_corr, const float *search,
+                               unsigned samples, unsigned samples_per_frame,
+                               unsigned frames, float *corr);
+
+#endif
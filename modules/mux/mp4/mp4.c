@@ -54,6 +54,14 @@
     "\"Fast Start\" files are optimized for downloads and allow the user " \
     "to start previewing the file while it is downloading.")
 
+#define CHUNK_TEXT N_("Chunk duration (ms)")
+#define CHUNK_LONGTEXT N_(\
+    "Write the fragmented and streamable MP4 as CMAF chunks of this " \
+    "duration, each with its own moof and mdat, as soon as all the tracks " \
+    "have the samples of the chunk. Chunks start on a common timeline for " \
+    "all the tracks and restart at each key frame. 0 writes whole " \
+    "fragments.")
+
 static int  Open   (vlc_object_t *);
 static void Close  (vlc_object_t *);
 static void CloseFrag  (vlc_object_t *);
@@ -69,6 +77,9 @@ vlc_module_begin ()
     add_bool(SOUT_CFG_PREFIX "faststart", false,
               FASTSTART_TEXT, FASTSTART_LONGTEXT,
               true)
+    add_integer(SOUT_CFG_PREFIX "chunk-duration", 0, CHUNK_TEXT,
+                CHUNK_LONGTEXT, true)
+        change_integer_range(0, 10000)
     set_capability("sout mux", 5)
     add_shortcut("mp4", "mov", "3gp")
     set_callbacks(Open, Close)
@@ -88,7 +99,7 @@ vlc_module_end ()
  * Exported prototypes
  *****************************************************************************/
 static const char *const ppsz_sout_options[] = {
-    "faststart", NULL
+    "faststart", "chunk-duration", NULL
 };
 
 static int Control(sout_mux_t *, int, va_list);
@@ -174,6 +185,8 @@ typedef struct
     /* mp4frag */
     vlc_tick_t     i_written_duration;
     uint32_t       i_mfhd_sequence;
+    vlc_tick_t     i_chunk_duration; /* 0 if whole fragments */
+    vlc_tick_t     i_chunk_end;
 } sout_mux_sys_t;
 
 static void mp4_stream_Delete(mp4_stream_t *p_stream)
@@ -292,6 +305,14 @@ static int Open(vlc_object_t *p_this)
     p_sys->i_written_duration= 0;
     p_sys->i_start_dts = VLC_TICK_INVALID;
     p_sys->i_mfhd_sequence = 1;
+    p_sys->i_chunk_duration = 0;
+    p_sys->i_chunk_end = 0;
+    if(options & FRAGMENTED)
+    {
+        p_sys->i_chunk_duration = VLC_TICK_FROM_MS(
+                    var_GetInteger(p_mux, SOUT_CFG_PREFIX "chunk-duration"));
+        p_sys->i_chunk_end = p_sys->i_chunk_duration;
+    }
 
     p_mux->p_sys        = p_sys;
     p_mux->pf_control   = Control;
@@ -307,6 +328,11 @@ static int Open(vlc_object_t *p_this)
     else
     {
         mp4mux_SetBrand(p_sys->muxh, BRAND_isom, 0x0);
+        if(p_sys->i_chunk_duration)
+        {
+            mp4mux_AddExtraBrand(p_sys->muxh, BRAND_iso6);
+            mp4mux_AddExtraBrand(p_sys->muxh, BRAND_cmfc);
+        }
     }
 
     return VLC_SUCCESS;
@@ -1288,9 +1314,11 @@ static void WriteFragments(sout_mux_t *p_mux, bool b_flush)
 {
     sout_mux_sys_t *p_sys = (sout_mux_sys_t*) p_mux->p_sys;
     bo_t *moof = NULL;
-    vlc_tick_t i_barrier_time = p_sys->i_written_duration + FRAGMENT_LENGTH;
+    vlc_tick_t i_barrier_time = p_sys->i_chunk_duration ? p_sys->i_chunk_end
+                              : p_sys->i_written_duration + FRAGMENT_LENGTH;
     size_t i_mdat_size = 0;
     bool b_has_samples = false;
+    bool b_independent = true;
 
     if(!p_sys->b_header_sent)
     {
@@ -1309,6 +1337,10 @@ static void WriteFragments(sout_mux_t *p_mux, bool b_flush)
         {
             b_has_samples = true;
 
+            if (p_stream->b_hasiframes &&
+                !(p_stream->read.p_first->p_block->i_flags & BLOCK_FLAG_TYPE_I))
+                b_independent = false;
+
             /* set a barrier so we try to align to keyframe */
             if (p_stream->b_hasiframes &&
                     p_stream->i_last_iframe_time > p_stream->i_written_duration &&
@@ -1334,9 +1366,14 @@ static void WriteFragments(sout_mux_t *p_mux, bool b_flush)
 
     if (moof)
     {
+        /* only chunks starting with key frames are stream access points */
+        if (p_sys->i_chunk_duration && !b_independent)
+            moof->b->i_flags &= ~BLOCK_FLAG_TYPE_I;
+
         msg_Dbg(p_mux, "writing moof @ %"PRId64, p_sys->i_pos);
         p_sys->i_pos += bo_size(moof);
-        assert(moof->b->i_flags & BLOCK_FLAG_TYPE_I); /* http sout */
+        assert(p_sys->i_chunk_duration ||
+               (moof->b->i_flags & BLOCK_FLAG_TYPE_I)); /* http sout */
         box_send(p_mux, moof);
         msg_Dbg(p_mux, "writing mdat @ %"PRId64, p_sys->i_pos);
         WriteFragmentMDAT(p_mux, i_mdat_size);
@@ -1345,9 +1382,16 @@ static void WriteFragments(sout_mux_t *p_mux, bool b_flush)
         for (unsigned int i = 0; i < p_sys->i_nb_streams; i++)
         {
             mp4_stream_t *p_stream = p_sys->pp_streams[i];
-            p_stream->i_last_iframe_time = 0;
+            /* a chunk does not reach the key frames read past its end */
+            if (!p_sys->i_chunk_duration ||
+                p_stream->i_last_iframe_time <= i_barrier_time)
+                p_stream->i_last_iframe_time = 0;
         }
     }
+
+    /* the next chunks follow the key frame that ended this one */
+    if (p_sys->i_chunk_duration)
+        p_sys->i_chunk_end = i_barrier_time + p_sys->i_chunk_duration;
 }
 
 /* Do an entry length fixup using only its own info.
@@ -1401,6 +1445,20 @@ static void CloseFrag(vlc_object_t *p_this)
         }
     }
 
+    /* cut the remaining chunks, except the last one */
+    if (p_sys->i_chunk_duration)
+    {
+        vlc_tick_t i_max_read_duration = 0;
+        for (unsigned int i = 0; i < p_sys->i_nb_streams; i++)
+        {
+            const mp4_stream_t *p_stream = p_sys->pp_streams[i];
+            if (mp4mux_track_GetDuration(p_stream->tinfo) > i_max_read_duration)
+                i_max_read_duration = mp4mux_track_GetDuration(p_stream->tinfo);
+        }
+        while (p_sys->i_chunk_end < i_max_read_duration)
+            WriteFragments(p_mux, false);
+    }
+
     /* and force creating a fragment from it */
     WriteFragments(p_mux, true);
 
@@ -1432,16 +1490,10 @@ static void CloseFrag(vlc_object_t *p_this)
     free(p_sys);
 }
 
-static int MuxFrag(sout_mux_t *p_mux)
+static int MuxFragStream(sout_mux_t *p_mux, sout_input_t *p_input, mp4_stream_t *p_stream)
 {
     sout_mux_sys_t *p_sys = (sout_mux_sys_t*) p_mux->p_sys;
 
-    int i_stream = sout_MuxGetStream(p_mux, 1, NULL);
-    if (i_stream < 0)
-        return VLC_SUCCESS;
-
-    sout_input_t *p_input  = p_mux->pp_inputs[i_stream];
-    mp4_stream_t *p_stream = (mp4_stream_t*) p_input->p_sys;
     block_t *p_currentblock = BlockDequeue(p_input, p_stream);
     if( !p_currentblock )
         return VLC_SUCCESS;
@@ -1476,7 +1528,8 @@ static int MuxFrag(sout_mux_t *p_mux)
         p_stream->p_held_entry = NULL;
 
         if (p_stream->b_hasiframes && (p_heldblock->i_flags & BLOCK_FLAG_TYPE_I) &&
-            mp4mux_track_GetDuration(p_stream->tinfo) - p_sys->i_written_duration < FRAGMENT_LENGTH)
+            (p_sys->i_chunk_duration ||
+             mp4mux_track_GetDuration(p_stream->tinfo) - p_sys->i_written_duration < FRAGMENT_LENGTH))
         {
             /* Flag the last iframe time, we'll use it as boundary so it will start
                next fragment */
@@ -1529,8 +1582,35 @@ static int MuxFrag(sout_mux_t *p_mux)
     p_sys->i_written_duration = i_min_written_duration;
 
     /* we have prerolled enough to know all streams, and have enough date to create a fragment */
-    if (p_stream->read.p_first && p_sys->i_read_duration - p_sys->i_written_duration >= FRAGMENT_LENGTH)
+    if (p_sys->i_chunk_duration)
+    {
+        /* write each chunk as soon as all the tracks have reached its end */
+        while (p_sys->i_read_duration >= p_sys->i_chunk_end)
+            WriteFragments(p_mux, false);
+    }
+    else if (p_stream->read.p_first && p_sys->i_read_duration - p_sys->i_written_duration >= FRAGMENT_LENGTH)
         WriteFragments(p_mux, false);
 
     return VLC_SUCCESS;
 }
+
+static int MuxFrag(sout_mux_t *p_mux)
+{
+    int i_ret = VLC_SUCCESS;
+
+    /* do not keep the samples in the input fifos, so that the chunks are
+     * written as soon as they are complete */
+    do
+    {
+        int i_stream = sout_MuxGetStream(p_mux, 1, NULL);
+        if (i_stream < 0)
+            break;
+
+        sout_input_t *p_input  = p_mux->pp_inputs[i_stream];
+        mp4_stream_t *p_stream = (mp4_stream_t*)p_input->p_sys;
+
+        i_ret = MuxFragStream(p_mux, p_input, p_stream);
+    } while( i_ret == VLC_SUCCESS );
+
+    return i_ret;
+}
@@ -26,10 +26,23 @@
 # include "config.h"
 #endif
 
+#include <assert.h>
+
 #include <vlc_common.h>
+#include <vlc_cpu.h>
 
 #include "csa.h"
 
+#ifdef HAVE_SSE2_INTRINSICS
+# include <emmintrin.h>
+#endif
+#ifdef HAVE_AVX2_INTRINSICS
+# include <immintrin.h>
+#endif
+#ifdef __ARM_NEON
+# include <arm_neon.h>
+#endif
+
 struct csa_t
 {
     /* odd and even keys */
@@ -75,7 +88,7 @@ void csa_Delete( csa_t *c )
 /*****************************************************************************
  * csa_SetCW:
  *****************************************************************************/
-int csa_SetCW( vlc_object_t *p_caller, csa_t *c, char *psz_ck, bool set_odd )
+int csa_SetCW( vlc_object_t *p_caller, csa_t *c, const char *psz_ck, bool set_odd )
 {
     if ( !c )
     {
@@ -610,3 +623,286 @@ static void csa_BlockCypher( uint8_t kk[57], uint8_t bd[8], uint8_t ib[8] )
     }
 }
 
+
+/*****************************************************************************
+ * Bitsliced implementation
+ *****************************************************************************/
+
+/* Smallest number of packets worth a parallel (de)scrambling */
+#define CSA_BATCH_MIN 4
+
+struct csa_job
+{
+    uint8_t *p;     /* payload */
+    int      n;     /* 8-byte blocks */
+    int      residue;
+};
+
+typedef void (*csa_batch_t)( const uint8_t ck[8], const uint8_t kk[57],
+                             const struct csa_job *, unsigned count );
+
+#define BS_LANES 64
+#define BS_WORD uint64_t
+#define BS_ZERO UINT64_C(0)
+#define BS_ONES (~UINT64_C(0))
+#define BS_SPLAT(c) (UINT64_C(0x0101010101010101) * (c))
+#define BS_XOR(a, b) ((a) ^ (b))
+#define BS_AND(a, b) ((a) & (b))
+#define BS_OR(a, b) ((a) | (b))
+#define BS_ANDNOT(a, b) ((a) & ~(b))
+#define BS_NOT(a) (~(a))
+#define BS_SHL(a, n) ((a) << (n))
+#define BS_SHR(a, n) ((a) >> (n))
+#define BS_FN(name) name##_64
+#define BS_TARGET
+#include "csa_bs.h"
+#undef BS_TARGET
+#undef BS_FN
+#undef BS_SHR
+#undef BS_SHL
+#undef BS_NOT
+#undef BS_ANDNOT
+#undef BS_OR
+#undef BS_AND
+#undef BS_XOR
+#undef BS_SPLAT
+#undef BS_ONES
+#undef BS_ZERO
+#undef BS_WORD
+#undef BS_LANES
+
+#ifdef HAVE_SSE2_INTRINSICS
+#define BS_LANES 128
+#define BS_WORD __m128i
+#define BS_ZERO _mm_setzero_si128()
+#define BS_ONES _mm_set1_epi32(-1)
+#define BS_SPLAT(c) _mm_set1_epi8((char)(c))
+#define BS_XOR(a, b) _mm_xor_si128(a, b)
+#define BS_AND(a, b) _mm_and_si128(a, b)
+#define BS_OR(a, b) _mm_or_si128(a, b)
+#define BS_ANDNOT(a, b) _mm_andnot_si128(b, a)
+#define BS_NOT(a) _mm_xor_si128(a, BS_ONES)
+#define BS_SHL(a, n) _mm_slli_epi64(a, n)
+#define BS_SHR(a, n) _mm_srli_epi64(a, n)
+#define BS_FN(name) name##_sse2
+#define BS_TARGET __attribute__ ((__target__ ("sse2")))
+#include "csa_bs.h"
+#undef BS_TARGET
+#undef BS_FN
+#undef BS_SHR
+#undef BS_SHL
+#undef BS_NOT
+#undef BS_ANDNOT
+#undef BS_OR
+#undef BS_AND
+#undef BS_XOR
+#undef BS_SPLAT
+#undef BS_ONES
+#undef BS_ZERO
+#undef BS_WORD
+#undef BS_LANES
+#endif
+
+#ifdef HAVE_AVX2_INTRINSICS
+#define BS_LANES 256
+#define BS_WORD __m256i
+#define BS_ZERO _mm256_setzero_si256()
+#define BS_ONES _mm256_set1_epi32(-1)
+#define BS_SPLAT(c) _mm256_set1_epi8((char)(c))
+#define BS_XOR(a, b) _mm256_xor_si256(a, b)
+#define BS_AND(a, b) _mm256_and_si256(a, b)
+#define BS_OR(a, b) _mm256_or_si256(a, b)
+#define BS_ANDNOT(a, b) _mm256_andnot_si256(b, a)
+#define BS_NOT(a) _mm256_xor_si256(a, BS_ONES)
+#define BS_SHL(a, n) _mm256_slli_epi64(a, n)
+#define BS_SHR(a, n) _mm256_srli_epi64(a, n)
+#define BS_FN(name) name##_avx2
+#define BS_TARGET __attribute__ ((__target__ ("avx2")))
+#include "csa_bs.h"
+#undef BS_TARGET
+#undef BS_FN
+#undef BS_SHR
+#undef BS_SHL
+#undef BS_NOT
+#undef BS_ANDNOT
+#undef BS_OR
+#undef BS_AND
+#undef BS_XOR
+#undef BS_SPLAT
+#undef BS_ONES
+#undef BS_ZERO
+#undef BS_WORD
+#undef BS_LANES
+#endif
+
+#ifdef __ARM_NEON
+#define BS_LANES 128
+#define BS_WORD uint8x16_t
+#define BS_ZERO vdupq_n_u8(0)
+#define BS_ONES vdupq_n_u8(0xff)
+#define BS_SPLAT(c) vdupq_n_u8(c)
+#define BS_XOR(a, b) veorq_u8(a, b)
+#define BS_AND(a, b) vandq_u8(a, b)
+#define BS_OR(a, b) vorrq_u8(a, b)
+#define BS_ANDNOT(a, b) vbicq_u8(a, b)
+#define BS_NOT(a) vmvnq_u8(a)
+#define BS_SHL(a, n) \
+    vreinterpretq_u8_u64(vshlq_n_u64(vreinterpretq_u64_u8(a), n))
+#define BS_SHR(a, n) \
+    vreinterpretq_u8_u64(vshrq_n_u64(vreinterpretq_u64_u8(a), n))
+#define BS_FN(name) name##_neon
+#define BS_TARGET
+#include "csa_bs.h"
+#undef BS_TARGET
+#undef BS_FN
+#undef BS_SHR
+#undef BS_SHL
+#undef BS_NOT
+#undef BS_ANDNOT
+#undef BS_OR
+#undef BS_AND
+#undef BS_XOR
+#undef BS_SPLAT
+#undef BS_ONES
+#undef BS_ZERO
+#undef BS_WORD
+#undef BS_LANES
+#endif
+
+/* Selects the narrowest implementation for count packets, or the widest */
+static unsigned csa_BatchSelect( unsigned count, bool decrypt,
+                                 csa_batch_t *pf )
+{
+#ifdef HAVE_AVX2_INTRINSICS
+    if( count > 128 && vlc_CPU_AVX2() )
+    {
+        *pf = decrypt ? Decrypt_avx2 : Encrypt_avx2;
+        return 256;
+    }
+#endif
+#ifdef HAVE_SSE2_INTRINSICS
+    if( count > 64 && vlc_CPU_SSE2() )
+    {
+        *pf = decrypt ? Decrypt_sse2 : Encrypt_sse2;
+        return 128;
+    }
+#endif
+#ifdef __ARM_NEON
+    if( count > 64 && vlc_CPU_ARM_NEON() )
+    {
+        *pf = decrypt ? Decrypt_neon : Encrypt_neon;
+        return 128;
+    }
+#endif
+    *pf = decrypt ? Decrypt_64 : Encrypt_64;
+    return 64;
+}
+
+static void csa_BatchRun( const uint8_t ck[8], const uint8_t kk[57],
+                          bool decrypt, const struct csa_job *jobs,
+                          unsigned count )
+{
+    while( count > 0 )
+    {
+        csa_batch_t pf;
+        unsigned lanes = csa_BatchSelect( count, decrypt, &pf );
+
+        if( lanes > count )
+            lanes = count;
+        pf( ck, kk, jobs, lanes );
+        jobs += lanes;
+        count -= lanes;
+    }
+}
+
+/*****************************************************************************
+ * csa_DecryptBatch:
+ *****************************************************************************/
+void csa_DecryptBatch( csa_t *c, uint8_t *const *pkts, unsigned count,
+                       int i_pkt_size )
+{
+    while( count >= CSA_BATCH_MIN )
+    {
+        /* even and odd key packets */
+        struct csa_job jobs[2][CSA_BATCH_MAX];
+        unsigned i_jobs[2] = { 0, 0 };
+        unsigned i_count = __MIN( count, CSA_BATCH_MAX );
+
+        for( unsigned i = 0; i < i_count; i++ )
+        {
+            uint8_t *pkt = pkts[i];
+            int i_hdr = 4;
+
+            /* transport scrambling control */
+            if( (pkt[3]&0x80) == 0 )
+                continue;
+
+            const bool odd = pkt[3]&0x40;
+            pkt[3] &= 0x3f;
+
+            if( pkt[3]&0x20 )
+                i_hdr += pkt[4] + 1;
+            if( 188 - i_hdr < 8 || i_pkt_size - i_hdr < 0 )
+                continue;
+
+            struct csa_job *job = &jobs[odd][i_jobs[odd]++];
+            job->p = &pkt[i_hdr];
+            job->n = (i_pkt_size - i_hdr) / 8;
+            job->residue = (i_pkt_size - i_hdr) % 8;
+        }
+
+        csa_BatchRun( c->e_ck, c->e_kk, true, jobs[0], i_jobs[0] );
+        csa_BatchRun( c->o_ck, c->o_kk, true, jobs[1], i_jobs[1] );
+        pkts += i_count;
+        count -= i_count;
+    }
+
+    for( unsigned i = 0; i < count; i++ )
+        csa_Decrypt( c, pkts[i], i_pkt_size );
+}
+
+/*****************************************************************************
+ * csa_EncryptBatch:
+ *****************************************************************************/
+void csa_EncryptBatch( csa_t *c, uint8_t *const *pkts, unsigned count,
+                       int i_pkt_size )
+{
+    while( count >= CSA_BATCH_MIN )
+    {
+        struct csa_job jobs[CSA_BATCH_MAX];
+        unsigned i_jobs = 0;
+        unsigned i_count = __MIN( count, CSA_BATCH_MAX );
+
+        for( unsigned i = 0; i < i_count; i++ )
+        {
+            uint8_t *pkt = pkts[i];
+            int i_hdr = 4;
+
+            /* set transport scrambling control */
+            pkt[3] |= c->use_odd ? 0xc0 : 0x80;
+
+            if( pkt[3]&0x20 )
+                i_hdr += pkt[4] + 1;
+            if( i_pkt_size - i_hdr < 8 )
+            {
+                pkt[3] &= 0x3f;
+                continue;
+            }
+
+            struct csa_job *job = &jobs[i_jobs++];
+            job->p = &pkt[i_hdr];
+            job->n = (i_pkt_size - i_hdr) / 8;
+            job->residue = (i_pkt_size - i_hdr) % 8;
+        }
+
+        if( c->use_odd )
+            csa_BatchRun( c->o_ck, c->o_kk, false, jobs, i_jobs );
+        else
+            csa_BatchRun( c->e_ck, c->e_kk, false, jobs, i_jobs );
+        pkts += i_count;
+        count -= i_count;
+    }
+
+    for( unsigned i = 0; i < count; i++ )
+        csa_Encrypt( c, pkts[i], i_pkt_size );
+}
@@ -30,14 +30,28 @@ typedef struct csa_t csa_t;
 #define csa_UseKey  __csa_UseKey
 #define csa_Decrypt __csa_decrypt
 #define csa_Encrypt __csa_encrypt
+#define csa_DecryptBatch __csa_decrypt_batch
+#define csa_EncryptBatch __csa_encrypt_batch
+
+/* Maximum number of packets (de)scrambled in parallel */
+#define CSA_BATCH_MAX 256
 
 csa_t *csa_New( void );
 void   csa_Delete( csa_t * );
 
-int    csa_SetCW( vlc_object_t *p_caller, csa_t *c, char *psz_ck, bool odd );
+int    csa_SetCW( vlc_object_t *p_caller, csa_t *c, const char *psz_ck, bool odd );
 int    csa_UseKey( vlc_object_t *p_caller, csa_t *, bool use_odd );
 
 void   csa_Decrypt( csa_t *, uint8_t *pkt, int i_pkt_size );
 void   csa_Encrypt( csa_t *, uint8_t *pkt, int i_pkt_size );
 
+/*
+ * Same as csa_Decrypt/csa_Encrypt on each packet, but processing up to
+ * CSA_BATCH_MAX packets in parallel with a bitsliced implementation.
+ */
+void   csa_DecryptBatch( csa_t *, uint8_t *const *pkts, unsigned count,
+                         int i_pkt_size );
+void   csa_EncryptBatch( csa_t *, uint8_t *const *pkts, unsigned count,
+                         int i_pkt_size );
+
 #endif /* _CSA_H */
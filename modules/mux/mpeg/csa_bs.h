@@ -0,0 +1,697 @@
+/*****************************************************************************
+ * csa_bs.h: bitsliced CSA scrambler/descrambler
+ *****************************************************************************
+ * Copyright (C) 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*
+ * This file is included by csa.c once per vector type, with:
+ *  - BS_WORD the vector type and BS_LANES its number of bits,
+ *  - BS_ZERO, BS_ONES and BS_SPLAT(c), the vector of bytes c,
+ *  - BS_XOR, BS_AND, BS_OR, BS_ANDNOT(a, b) = a & ~b and BS_NOT,
+ *  - BS_SHL and BS_SHR, shifting the 64-bit elements of a vector,
+ *  - BS_FN(name), the name of the functions for this vector type,
+ *  - BS_TARGET, the attributes of these functions.
+ *
+ * Each lane processes one packet. The stream cipher is bitsliced: a vector
+ * holds the same bit of the state for all the lanes, the bit of lane l
+ * being bit l % 8 of byte l / 8 of the vector. The block cipher is
+ * byte-sliced, as its 8-bit S-box has no small circuit: a slice of 8
+ * vectors holds one byte for each lane, the byte of lane l being byte l / 8
+ * of vector l % 8. Transposing the 8x8 bit matrices of a slice thus yields
+ * the bitsliced vectors of its 8 bits, and conversely.
+ */
+
+#define BS_BYTES (BS_LANES / 8)
+#define BS_INDEX(l) (((l) % 8) * BS_BYTES + (l) / 8)
+
+/* Registers A[k] and B[k] of iteration t of the stream cipher */
+#define RA(k, m) s->a[t + 10 - (k)][m]
+#define RB(k, m) s->b[t + 10 - (k)][m]
+
+#define BS_SWAP(a, b, n, mask) \
+    do { \
+        const BS_WORD tmp = BS_AND(BS_XOR(BS_SHR(a, n), b), BS_SPLAT(mask)); \
+        b = BS_XOR(b, tmp); \
+        a = BS_XOR(a, BS_SHL(tmp, n)); \
+    } while (0)
+
+/* Transposes the 8x8 bit matrices of 8 vectors */
+static BS_TARGET void BS_FN(Transpose)(BS_WORD v[8])
+{
+    for (unsigned i = 0; i < 4; i++)
+        BS_SWAP(v[i], v[i + 4], 4, 0x0f);
+    for (unsigned i = 0; i < 8; i += (i & 1) ? 3 : 1)
+        BS_SWAP(v[i], v[i + 2], 2, 0x33);
+    for (unsigned i = 0; i < 8; i += 2)
+        BS_SWAP(v[i], v[i + 1], 1, 0x55);
+}
+
+/* Loads the bytes of the packets in a slice, zero for a NULL packet */
+static BS_TARGET void BS_FN(Gather)(BS_WORD slices[8][8],
+                                    uint8_t *const *src, unsigned count)
+{
+    if (count < BS_LANES)
+        memset(slices, 0, sizeof (BS_WORD [8][8]));
+    for (unsigned j = 0; j < 8; j++)
+    {
+        uint8_t *slice = (uint8_t *)slices[j];
+
+        for (unsigned l = 0; l < count; l++)
+            slice[BS_INDEX(l)] = (src[l] != NULL) ? src[l][j] : 0;
+    }
+}
+
+/* Stores the bytes of a slice in the packets, skipping the NULL ones */
+static BS_TARGET void BS_FN(Scatter)(BS_WORD slices[8][8],
+                                     uint8_t *const *dst, unsigned count)
+{
+    for (unsigned l = 0; l < count; l++)
+        if (dst[l] != NULL)
+            for (unsigned j = 0; j < 8; j++)
+                dst[l][j] = ((const uint8_t *)slices[j])[BS_INDEX(l)];
+}
+
+/*** Stream cipher ***/
+
+/* Circuits of the S-boxes, x4 being the most significant input bit */
+static BS_TARGET inline void BS_FN(StreamSbox1)(BS_WORD x4, BS_WORD x3,
+                                                BS_WORD x2, BS_WORD x1,
+                                                BS_WORD x0,
+                                                BS_WORD *hi, BS_WORD *lo)
+{
+    const BS_WORD t0 = BS_NOT(x4);
+    const BS_WORD t1 = BS_XOR(x0, t0);
+    const BS_WORD t2 = BS_OR(x3, t1);
+    const BS_WORD t3 = BS_NOT(x3);
+    const BS_WORD t4 = BS_XOR(x0, t3);
+    const BS_WORD t5 = BS_OR(x0, x3);
+    const BS_WORD t6 = BS_AND(x4, t5);
+    const BS_WORD t7 = BS_XOR(t4, t6);
+    const BS_WORD t8 = BS_AND(x1, t7);
+    const BS_WORD t9 = BS_XOR(t2, t8);
+    const BS_WORD t10 = BS_OR(x1, x4);
+    const BS_WORD t11 = BS_XOR(x0, t10);
+    const BS_WORD t12 = BS_OR(x3, t11);
+    const BS_WORD t13 = BS_AND(x2, t12);
+    const BS_WORD t14 = BS_XOR(t9, t13);
+    const BS_WORD t15 = BS_AND(x0, x4);
+    const BS_WORD t16 = BS_XOR(x1, t15);
+    const BS_WORD t17 = BS_OR(x1, t1);
+    const BS_WORD t18 = BS_AND(x3, t17);
+    const BS_WORD t19 = BS_XOR(t16, t18);
+    const BS_WORD t20 = BS_AND(x3, x4);
+    const BS_WORD t21 = BS_OR(x0, t20);
+    const BS_WORD t22 = BS_AND(x2, t21);
+    const BS_WORD t23 = BS_XOR(t19, t22);
+    *hi = t14;
+    *lo = t23;
+}
+
+static BS_TARGET inline void BS_FN(StreamSbox2)(BS_WORD x4, BS_WORD x3,
+                                                BS_WORD x2, BS_WORD x1,
+                                                BS_WORD x0,
+                                                BS_WORD *hi, BS_WORD *lo)
+{
+    const BS_WORD t0 = BS_NOT(x3);
+    const BS_WORD t1 = BS_XOR(x1, t0);
+    const BS_WORD t2 = BS_XOR(x0, t1);
+    const BS_WORD t3 = BS_OR(x0, x1);
+    const BS_WORD t4 = BS_AND(x3, t3);
+    const BS_WORD t5 = BS_AND(x4, t4);
+    const BS_WORD t6 = BS_XOR(t2, t5);
+    const BS_WORD t7 = BS_XOR(x1, x3);
+    const BS_WORD t8 = BS_AND(x4, t7);
+    const BS_WORD t9 = BS_XOR(t3, t8);
+    const BS_WORD t10 = BS_AND(x2, t9);
+    const BS_WORD t11 = BS_XOR(t6, t10);
+    const BS_WORD t12 = BS_ANDNOT(x2, x4);
+    const BS_WORD t13 = BS_NOT(t12);
+    const BS_WORD t14 = BS_XOR(x1, t13);
+    const BS_WORD t15 = BS_AND(x1, x4);
+    const BS_WORD t16 = BS_XOR(x2, t15);
+    const BS_WORD t17 = BS_AND(x0, t16);
+    const BS_WORD t18 = BS_XOR(t14, t17);
+    const BS_WORD t19 = BS_XOR(x1, x2);
+    const BS_WORD t20 = BS_AND(x0, t19);
+    const BS_WORD t21 = BS_OR(x4, t20);
+    const BS_WORD t22 = BS_AND(x3, t21);
+    const BS_WORD t23 = BS_XOR(t18, t22);
+    *hi = t11;
+    *lo = t23;
+}
+
+static BS_TARGET inline void BS_FN(StreamSbox3)(BS_WORD x4, BS_WORD x3,
+                                                BS_WORD x2, BS_WORD x1,
+                                                BS_WORD x0,
+                                                BS_WORD *hi, BS_WORD *lo)
+{
+    const BS_WORD t0 = BS_NOT(x4);
+    const BS_WORD t1 = BS_XOR(x3, t0);
+    const BS_WORD t2 = BS_ANDNOT(t1, x1);
+    const BS_WORD t3 = BS_ANDNOT(t2, x0);
+    const BS_WORD t4 = BS_ANDNOT(x4, x3);
+    const BS_WORD t5 = BS_XOR(x1, t4);
+    const BS_WORD t6 = BS_AND(x0, t5);
+    const BS_WORD t7 = BS_OR(t3, t6);
+    const BS_WORD t8 = BS_XOR(x0, x3);
+    const BS_WORD t9 = BS_OR(x4, t8);
+    const BS_WORD t10 = BS_OR(x1, t9);
+    const BS_WORD t11 = BS_AND(x2, t10);
+    const BS_WORD t12 = BS_XOR(t7, t11);
+    const BS_WORD t13 = BS_XOR(x3, x4);
+    const BS_WORD t14 = BS_XOR(x1, t13);
+    const BS_WORD t15 = BS_XOR(x1, x2);
+    const BS_WORD t16 = BS_AND(x0, t15);
+    const BS_WORD t17 = BS_XOR(t14, t16);
+    *hi = t12;
+    *lo = t17;
+}
+
+static BS_TARGET inline void BS_FN(StreamSbox4)(BS_WORD x4, BS_WORD x3,
+                                                BS_WORD x2, BS_WORD x1,
+                                                BS_WORD x0,
+                                                BS_WORD *hi, BS_WORD *lo)
+{
+    const BS_WORD t0 = BS_NOT(x4);
+    const BS_WORD t1 = BS_OR(x1, t0);
+    const BS_WORD t2 = BS_XOR(x2, t1);
+    const BS_WORD t3 = BS_ANDNOT(t2, x0);
+    const BS_WORD t4 = BS_ANDNOT(x1, x4);
+    const BS_WORD t5 = BS_OR(x2, t4);
+    const BS_WORD t6 = BS_AND(x0, t5);
+    const BS_WORD t7 = BS_OR(t3, t6);
+    const BS_WORD t8 = BS_ANDNOT(x0, x1);
+    const BS_WORD t9 = BS_ANDNOT(x4, t8);
+    const BS_WORD t10 = BS_NOT(t9);
+    const BS_WORD t11 = BS_OR(x1, x4);
+    const BS_WORD t12 = BS_AND(x2, t11);
+    const BS_WORD t13 = BS_XOR(t10, t12);
+    const BS_WORD t14 = BS_AND(x3, t13);
+    const BS_WORD t15 = BS_XOR(t7, t14);
+    const BS_WORD t16 = BS_NOT(x2);
+    const BS_WORD t17 = BS_OR(x2, x4);
+    const BS_WORD t18 = BS_AND(x3, t17);
+    const BS_WORD t19 = BS_XOR(t16, t18);
+    const BS_WORD t20 = BS_OR(x3, x4);
+    const BS_WORD t21 = BS_AND(x0, t20);
+    const BS_WORD t22 = BS_XOR(t19, t21);
+    const BS_WORD t23 = BS_ANDNOT(t22, x1);
+    const BS_WORD t24 = BS_XOR(x2, x4);
+    const BS_WORD t25 = BS_ANDNOT(t24, x3);
+    const BS_WORD t26 = BS_OR(x2, t0);
+    const BS_WORD t27 = BS_AND(x0, t26);
+    const BS_WORD t28 = BS_XOR(t25, t27);
+    const BS_WORD t29 = BS_AND(x1, t28);
+    const BS_WORD t30 = BS_OR(t23, t29);
+    *hi = t15;
+    *lo = t30;
+}
+
+static BS_TARGET inline void BS_FN(StreamSbox5)(BS_WORD x4, BS_WORD x3,
+                                                BS_WORD x2, BS_WORD x1,
+                                                BS_WORD x0,
+                                                BS_WORD *hi, BS_WORD *lo)
+{
+    const BS_WORD t0 = BS_NOT(x3);
+    const BS_WORD t1 = BS_AND(x2, x4);
+    const BS_WORD t2 = BS_XOR(t0, t1);
+    const BS_WORD t3 = BS_NOT(x4);
+    const BS_WORD t4 = BS_ANDNOT(t3, x2);
+    const BS_WORD t5 = BS_OR(x3, t4);
+    const BS_WORD t6 = BS_AND(x1, t5);
+    const BS_WORD t7 = BS_XOR(t2, t6);
+    const BS_WORD t8 = BS_ANDNOT(t7, x0);
+    const BS_WORD t9 = BS_OR(x2, x4);
+    const BS_WORD t10 = BS_ANDNOT(t9, x3);
+    const BS_WORD t11 = BS_ANDNOT(x3, x2);
+    const BS_WORD t12 = BS_OR(x4, t11);
+    const BS_WORD t13 = BS_AND(x1, t12);
+    const BS_WORD t14 = BS_XOR(t10, t13);
+    const BS_WORD t15 = BS_AND(x0, t14);
+    const BS_WORD t16 = BS_OR(t8, t15);
+    const BS_WORD t17 = BS_AND(x1, x3);
+    const BS_WORD t18 = BS_XOR(x2, t17);
+    const BS_WORD t19 = BS_XOR(x1, x3);
+    const BS_WORD t20 = BS_OR(x2, t19);
+    const BS_WORD t21 = BS_AND(x0, t20);
+    const BS_WORD t22 = BS_XOR(t18, t21);
+    const BS_WORD t23 = BS_XOR(x2, x3);
+    const BS_WORD t24 = BS_ANDNOT(t23, x1);
+    const BS_WORD t25 = BS_OR(x0, t24);
+    const BS_WORD t26 = BS_AND(x4, t25);
+    const BS_WORD t27 = BS_XOR(t22, t26);
+    *hi = t16;
+    *lo = t27;
+}
+
+static BS_TARGET inline void BS_FN(StreamSbox6)(BS_WORD x4, BS_WORD x3,
+                                                BS_WORD x2, BS_WORD x1,
+                                                BS_WORD x0,
+                                                BS_WORD *hi, BS_WORD *lo)
+{
+    const BS_WORD t0 = BS_XOR(x1, x4);
+    const BS_WORD t1 = BS_AND(x3, x4);
+    const BS_WORD t2 = BS_XOR(x3, x4);
+    const BS_WORD t3 = BS_AND(x1, t2);
+    const BS_WORD t4 = BS_XOR(t1, t3);
+    const BS_WORD t5 = BS_AND(x0, t4);
+    const BS_WORD t6 = BS_XOR(t0, t5);
+    const BS_WORD t7 = BS_OR(x0, x3);
+    const BS_WORD t8 = BS_AND(x2, t7);
+    const BS_WORD t9 = BS_XOR(t6, t8);
+    const BS_WORD t10 = BS_ANDNOT(x2, x3);
+    const BS_WORD t11 = BS_XOR(x0, t10);
+    const BS_WORD t12 = BS_ANDNOT(x2, x4);
+    const BS_WORD t13 = BS_OR(x3, t12);
+    const BS_WORD t14 = BS_OR(x2, x4);
+    const BS_WORD t15 = BS_XOR(t14, t1);
+    const BS_WORD t16 = BS_AND(x0, t15);
+    const BS_WORD t17 = BS_XOR(t13, t16);
+    const BS_WORD t18 = BS_AND(x1, t17);
+    const BS_WORD t19 = BS_XOR(t11, t18);
+    *hi = t9;
+    *lo = t19;
+}
+
+static BS_TARGET inline void BS_FN(StreamSbox7)(BS_WORD x4, BS_WORD x3,
+                                                BS_WORD x2, BS_WORD x1,
+                                                BS_WORD x0,
+                                                BS_WORD *hi, BS_WORD *lo)
+{
+    const BS_WORD t0 = BS_XOR(x0, x2);
+    const BS_WORD t1 = BS_ANDNOT(t0, x4);
+    const BS_WORD t2 = BS_XOR(x3, t1);
+    const BS_WORD t3 = BS_OR(x3, x4);
+    const BS_WORD t4 = BS_ANDNOT(x0, t3);
+    const BS_WORD t5 = BS_NOT(t4);
+    const BS_WORD t6 = BS_ANDNOT(x4, x3);
+    const BS_WORD t7 = BS_AND(x0, x4);
+    const BS_WORD t8 = BS_XOR(t6, t7);
+    const BS_WORD t9 = BS_AND(x2, t8);
+    const BS_WORD t10 = BS_XOR(t5, t9);
+    const BS_WORD t11 = BS_AND(x1, t10);
+    const BS_WORD t12 = BS_XOR(t2, t11);
+    const BS_WORD t13 = BS_OR(x2, x3);
+    const BS_WORD t14 = BS_XOR(x4, t13);
+    const BS_WORD t15 = BS_XOR(x0, t14);
+    const BS_WORD t16 = BS_AND(x3, x4);
+    const BS_WORD t17 = BS_XOR(x2, t16);
+    const BS_WORD t18 = BS_OR(x0, t17);
+    const BS_WORD t19 = BS_AND(x1, t18);
+    const BS_WORD t20 = BS_XOR(t15, t19);
+    *hi = t12;
+    *lo = t20;
+}
+
+struct BS_FN(stream)
+{
+    /* The shift registers, A[k] of iteration t being a[t + 10 - k] */
+    BS_WORD a[10 + 32][4];
+    BS_WORD b[10 + 32][4];
+    BS_WORD x[4], y[4], z[4];
+    BS_WORD d[4], e[4], f[4];
+    BS_WORD p, q, r;
+};
+
+static BS_TARGET void BS_FN(StreamInit)(struct BS_FN(stream) *s,
+                                        const uint8_t ck[8])
+{
+    const unsigned t = 0;
+
+    /* The first 32 bits of CK in A[1]..A[8], the last ones in B[1]..B[8] */
+    for (unsigned k = 1; k <= 10; k++)
+    {
+        const unsigned shift = (k & 1) ? 4 : 0;
+        const unsigned an = (k <= 8) ? (ck[(k - 1) / 2] >> shift) & 0xf : 0;
+        const unsigned bn = (k <= 8) ? (ck[4 + (k - 1) / 2] >> shift) & 0xf : 0;
+
+        for (unsigned m = 0; m < 4; m++)
+        {
+            RA(k, m) = ((an >> m) & 1) ? BS_ONES : BS_ZERO;
+            RB(k, m) = ((bn >> m) & 1) ? BS_ONES : BS_ZERO;
+        }
+    }
+
+    for (unsigned m = 0; m < 4; m++)
+        s->x[m] = s->y[m] = s->z[m] = s->d[m] = s->e[m] = s->f[m] = BS_ZERO;
+    s->p = s->q = s->r = BS_ZERO;
+}
+
+/**
+ * Clocks the stream cipher for 8 bytes.
+ *
+ * \param in NULL, or the initialisation bytes during initialisation, bit b
+ *           of byte i being in[8 * i + b]
+ * \param out the output bytes, in the same layout
+ */
+static BS_TARGET void BS_FN(StreamRun)(struct BS_FN(stream) *s,
+                                       const BS_WORD *in, BS_WORD out[64])
+{
+    for (unsigned t = 0; t < 32; t++)
+    {
+        BS_WORD s1h, s1l, s2h, s2l, s3h, s3l, s4h, s4l;
+        BS_WORD s5h, s5l, s6h, s6l, s7h, s7l;
+
+        BS_FN(StreamSbox1)(RA(4, 0), RA(1, 2), RA(6, 1), RA(7, 3), RA(9, 0),
+                           &s1h, &s1l);
+        BS_FN(StreamSbox2)(RA(2, 1), RA(3, 2), RA(6, 3), RA(7, 0), RA(9, 1),
+                           &s2h, &s2l);
+        BS_FN(StreamSbox3)(RA(1, 3), RA(2, 0), RA(5, 1), RA(5, 3), RA(6, 2),
+                           &s3h, &s3l);
+        BS_FN(StreamSbox4)(RA(3, 3), RA(1, 1), RA(2, 3), RA(4, 2), RA(8, 0),
+                           &s4h, &s4l);
+        BS_FN(StreamSbox5)(RA(5, 2), RA(4, 3), RA(6, 0), RA(8, 1), RA(9, 2),
+                           &s5h, &s5l);
+        BS_FN(StreamSbox6)(RA(3, 1), RA(4, 1), RA(5, 0), RA(7, 2), RA(9, 3),
+                           &s6h, &s6l);
+        BS_FN(StreamSbox7)(RA(2, 2), RA(3, 0), RA(7, 1), RA(8, 2), RA(8, 3),
+                           &s7h, &s7l);
+
+        /* 4x4 xor producing the extra nibble for T3 */
+        BS_WORD extra[4];
+        extra[3] = BS_XOR(BS_XOR(RB(3, 0), RB(6, 1)),
+                          BS_XOR(RB(7, 2), RB(9, 3)));
+        extra[2] = BS_XOR(BS_XOR(RB(6, 0), RB(8, 1)),
+                          BS_XOR(RB(3, 3), RB(4, 2)));
+        extra[1] = BS_XOR(BS_XOR(RB(5, 3), RB(8, 2)),
+                          BS_XOR(RB(4, 0), RB(5, 1)));
+        extra[0] = BS_XOR(BS_XOR(RB(9, 2), RB(6, 3)),
+                          BS_XOR(RB(3, 1), RB(8, 0)));
+
+        /* T1 and T2, with the input nibbles during initialisation */
+        BS_WORD next_a[4], next_b[4];
+        for (unsigned m = 0; m < 4; m++)
+        {
+            next_a[m] = BS_XOR(RA(10, m), s->x[m]);
+            next_b[m] = BS_XOR(BS_XOR(RB(7, m), RB(10, m)), s->y[m]);
+        }
+        if (in != NULL)
+        {
+            const BS_WORD *in1 = in + 8 * (t / 4) + 4, *in2 = in1 - 4;
+
+            if (t & 1)
+            {
+                const BS_WORD *swap = in1;
+                in1 = in2;
+                in2 = swap;
+            }
+            for (unsigned m = 0; m < 4; m++)
+            {
+                next_a[m] = BS_XOR(next_a[m], BS_XOR(s->d[m], in1[m]));
+                next_b[m] = BS_XOR(next_b[m], in2[m]);
+            }
+        }
+
+        /* If p, T2 is rotated left */
+        const BS_WORD b3 = next_b[3];
+        for (unsigned m = 3; m > 0; m--)
+            next_b[m] = BS_XOR(next_b[m], BS_AND(s->p, BS_XOR(next_b[m],
+                                                              next_b[m - 1])));
+        next_b[0] = BS_XOR(next_b[0], BS_AND(s->p, BS_XOR(next_b[0], b3)));
+
+        /* T3 */
+        for (unsigned m = 0; m < 4; m++)
+            s->d[m] = BS_XOR(BS_XOR(s->e[m], s->z[m]), extra[m]);
+
+        /* T4: if q, F = Z + E + r with r the carry, otherwise F = E */
+        BS_WORD carry = s->r;
+        for (unsigned m = 0; m < 4; m++)
+        {
+            const BS_WORD ze = BS_XOR(s->z[m], s->e[m]);
+            const BS_WORD sum = BS_XOR(ze, carry);
+            const BS_WORD next_e = s->f[m];
+
+            carry = BS_OR(BS_AND(s->z[m], s->e[m]), BS_AND(carry, ze));
+            s->f[m] = BS_XOR(s->e[m], BS_AND(s->q, BS_XOR(sum, s->e[m])));
+            s->e[m] = next_e;
+        }
+        s->r = BS_XOR(s->r, BS_AND(s->q, BS_XOR(carry, s->r)));
+
+        for (unsigned m = 0; m < 4; m++)
+        {
+            s->a[t + 10][m] = next_a[m];
+            s->b[t + 10][m] = next_b[m];
+        }
+
+        s->x[3] = s4l; s->x[2] = s3l; s->x[1] = s2h; s->x[0] = s1h;
+        s->y[3] = s6l; s->y[2] = s5l; s->y[1] = s4h; s->y[0] = s3h;
+        s->z[3] = s2l; s->z[2] = s1l; s->z[1] = s6h; s->z[0] = s5h;
+        s->p = s7h;
+        s->q = s7l;
+
+        /* 2 output bits per iteration, each the xor of 2 bits of D */
+        BS_WORD *op = out + 8 * (t / 4) + 6 - 2 * (t % 4);
+        op[1] = BS_XOR(s->d[3], s->d[2]);
+        op[0] = BS_XOR(s->d[1], s->d[0]);
+    }
+
+    memcpy(s->a, s->a + 32, sizeof (s->a[0]) * 10);
+    memcpy(s->b, s->b + 32, sizeof (s->b[0]) * 10);
+}
+
+/* Clocks the stream cipher for 8 bytes, in a slice */
+static BS_TARGET void BS_FN(StreamSlices)(struct BS_FN(stream) *s,
+                                          BS_WORD slices[8][8])
+{
+    BS_WORD out[64];
+
+    BS_FN(StreamRun)(s, NULL, out);
+    for (unsigned j = 0; j < 8; j++)
+    {
+        memcpy(slices[j], out + 8 * j, sizeof (slices[j]));
+        BS_FN(Transpose)(slices[j]);
+    }
+}
+
+/* Initialises the stream cipher with the first block of the packets */
+static BS_TARGET void BS_FN(StreamStart)(struct BS_FN(stream) *s,
+                                         const uint8_t ck[8],
+                                         const struct csa_job *jobs,
+                                         unsigned count)
+{
+    BS_WORD slices[8][8], out[64];
+    uint8_t *src[BS_LANES];
+
+    for (unsigned l = 0; l < count; l++)
+        src[l] = jobs[l].p;
+    BS_FN(Gather)(slices, src, count);
+    for (unsigned j = 0; j < 8; j++)
+        BS_FN(Transpose)(slices[j]);
+
+    BS_FN(StreamInit)(s, ck);
+    BS_FN(StreamRun)(s, &slices[0][0], out);
+}
+
+/* Xors the key stream into the packets, after the first block */
+static BS_TARGET void BS_FN(StreamXor)(struct BS_FN(stream) *s,
+                                       const struct csa_job *jobs,
+                                       unsigned count)
+{
+    int last = 0;
+
+    /* The residue follows the last block, but the first one */
+    for (unsigned l = 0; l < count; l++)
+    {
+        const int n = __MAX(jobs[l].n, 1);
+        last = __MAX(last, jobs[l].residue ? n : n - 1);
+    }
+
+    for (int k = 1; k <= last; k++)
+    {
+        BS_WORD slices[8][8];
+
+        BS_FN(StreamSlices)(s, slices);
+        for (unsigned l = 0; l < count; l++)
+        {
+            const struct csa_job *job = &jobs[l];
+            const uint8_t *ks = (const uint8_t *)slices;
+            uint8_t *p = job->p + 8 * k;
+            int length = 0;
+
+            if (k < job->n)
+                length = 8;
+            else if (k == __MAX(job->n, 1))
+                length = job->residue;
+            for (int j = 0; j < length; j++)
+                p[j] ^= ks[j * BS_LANES + BS_INDEX(l)];
+        }
+    }
+}
+
+/*** Block cipher ***/
+
+/* Xors the permutation of the S-box outputs into a slice */
+static BS_TARGET void BS_FN(BlockPerm)(BS_WORD dst[8], const BS_WORD src[8])
+{
+    for (unsigned w = 0; w < 8; w++)
+    {
+        const BS_WORD v = src[w];
+        BS_WORD perm;
+
+        perm = BS_AND(BS_SHL(v, 1), BS_SPLAT(0x52));
+        perm = BS_OR(perm, BS_AND(BS_SHL(v, 3), BS_SPLAT(0x20)));
+        perm = BS_OR(perm, BS_AND(BS_SHL(v, 6), BS_SPLAT(0x80)));
+        perm = BS_OR(perm, BS_AND(BS_SHR(v, 2), BS_SPLAT(0x04)));
+        perm = BS_OR(perm, BS_AND(BS_SHR(v, 4), BS_SPLAT(0x08)));
+        perm = BS_OR(perm, BS_AND(BS_SHR(v, 6), BS_SPLAT(0x01)));
+        dst[w] = BS_XOR(dst[w], perm);
+    }
+}
+
+static BS_TARGET void BS_FN(BlockSbox)(BS_WORD dst[8], const BS_WORD src[8],
+                                       uint8_t key)
+{
+    const uint8_t *in = (const uint8_t *)src;
+    uint8_t *out = (uint8_t *)dst;
+
+    for (unsigned l = 0; l < BS_LANES; l++)
+        out[l] = block_sbox[key ^ in[l]];
+}
+
+/*
+ * The registers R[1]..R[8] are the 8 slices, renamed by each round rather
+ * than moved: R[j] of round o, counting from 0, is slice (j - 1 + o) % 8
+ * when enciphering and slice (j - 1 - o) % 8 when deciphering, which are
+ * back to slice j - 1 after the 56 rounds.
+ */
+static BS_TARGET void BS_FN(BlockCypher)(const uint8_t kk[57],
+                                         BS_WORD r[8][8])
+{
+    for (unsigned o = 0; o < 56; o++)
+    {
+        BS_WORD *r1 = r[o % 8], *r3 = r[(o + 2) % 8];
+        BS_WORD *r4 = r[(o + 3) % 8], *r5 = r[(o + 4) % 8];
+        BS_WORD *r7 = r[(o + 6) % 8], *r8 = r[(o + 7) % 8];
+        BS_WORD sbox_out[8];
+
+        /* loop over kk[1]..kk[56] */
+        BS_FN(BlockSbox)(sbox_out, r8, kk[1 + o]);
+        for (unsigned w = 0; w < 8; w++)
+        {
+            r3[w] = BS_XOR(r3[w], r1[w]);
+            r4[w] = BS_XOR(r4[w], r1[w]);
+            r5[w] = BS_XOR(r5[w], r1[w]);
+            r1[w] = BS_XOR(r1[w], sbox_out[w]);
+        }
+        BS_FN(BlockPerm)(r7, sbox_out);
+    }
+}
+
+static BS_TARGET void BS_FN(BlockDecypher)(const uint8_t kk[57],
+                                           BS_WORD r[8][8])
+{
+    for (unsigned o = 0; o < 56; o++)
+    {
+        BS_WORD *r2 = r[(65 - o) % 8], *r3 = r[(66 - o) % 8];
+        BS_WORD *r4 = r[(67 - o) % 8], *r6 = r[(69 - o) % 8];
+        BS_WORD *r7 = r[(70 - o) % 8], *r8 = r[(71 - o) % 8];
+        BS_WORD sbox_out[8];
+
+        /* loop over kk[56]..kk[1] */
+        BS_FN(BlockSbox)(sbox_out, r7, kk[56 - o]);
+        for (unsigned w = 0; w < 8; w++)
+        {
+            r8[w] = BS_XOR(r8[w], sbox_out[w]);
+            r2[w] = BS_XOR(r2[w], r8[w]);
+            r3[w] = BS_XOR(r3[w], r8[w]);
+            r4[w] = BS_XOR(r4[w], r8[w]);
+        }
+        BS_FN(BlockPerm)(r6, sbox_out);
+    }
+}
+
+/*** Packets ***/
+
+static BS_TARGET void BS_FN(Encrypt)(const uint8_t ck[8],
+                                     const uint8_t kk[57],
+                                     const struct csa_job *jobs,
+                                     unsigned count)
+{
+    BS_WORD block[8][8], chain[8][8];
+    uint8_t *src[BS_LANES];
+    int blocks = 0;
+
+    assert(count <= BS_LANES);
+    for (unsigned l = 0; l < count; l++)
+        blocks = __MAX(blocks, jobs[l].n);
+
+    /* Block cipher, chained from the last block of each packet */
+    memset(chain, 0, sizeof (chain));
+    for (int i = 0; i < blocks; i++)
+    {
+        for (unsigned l = 0; l < count; l++)
+            src[l] = (i < jobs[l].n) ? jobs[l].p + 8 * (jobs[l].n - 1 - i)
+                                     : NULL;
+        BS_FN(Gather)(block, src, count);
+        for (unsigned j = 0; j < 8; j++)
+            for (unsigned w = 0; w < 8; w++)
+                block[j][w] = BS_XOR(block[j][w], chain[j][w]);
+        BS_FN(BlockCypher)(kk, block);
+        BS_FN(Scatter)(block, src, count);
+        memcpy(chain, block, sizeof (chain));
+    }
+
+    /* Stream cipher, initialised with the first block */
+    struct BS_FN(stream) s;
+    BS_FN(StreamStart)(&s, ck, jobs, count);
+    BS_FN(StreamXor)(&s, jobs, count);
+}
+
+static BS_TARGET void BS_FN(Decrypt)(const uint8_t ck[8],
+                                     const uint8_t kk[57],
+                                     const struct csa_job *jobs,
+                                     unsigned count)
+{
+    BS_WORD block[8][8], chain[8][8];
+    uint8_t *src[BS_LANES], *next[BS_LANES];
+    int blocks = 0;
+
+    assert(count <= BS_LANES);
+    for (unsigned l = 0; l < count; l++)
+        blocks = __MAX(blocks, jobs[l].n);
+
+    /* Stream cipher, initialised with the first block */
+    struct BS_FN(stream) s;
+    BS_FN(StreamStart)(&s, ck, jobs, count);
+    BS_FN(StreamXor)(&s, jobs, count);
+
+    /* Block cipher, chained with the next block, zero after the last one */
+    for (int i = 0; i < blocks; i++)
+    {
+        for (unsigned l = 0; l < count; l++)
+        {
+            const struct csa_job *job = &jobs[l];
+
+            src[l] = (i < job->n) ? job->p + 8 * i : NULL;
+            next[l] = (i + 1 < job->n) ? job->p + 8 * (i + 1) : NULL;
+        }
+        BS_FN(Gather)(block, src, count);
+        BS_FN(Gather)(chain, next, count);
+        BS_FN(BlockDecypher)(kk, block);
+        for (unsigned j = 0; j < 8; j++)
+            for (unsigned w = 0; w < 8; w++)
+                block[j][w] = BS_XOR(block[j][w], chain[j][w]);
+        BS_FN(Scatter)(block, src, count);
+    }
+}
+
+#undef BS_SWAP
+#undef RB
+#undef RA
+#undef BS_INDEX
+#undef BS_BYTES
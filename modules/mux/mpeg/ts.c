@@ -31,6 +31,7 @@
 # include "config.h"
 #endif
 
+#include <assert.h>
 #include <limits.h>
 
 #include <vlc_common.h>
@@ -46,6 +47,7 @@
 #include "pes.h"
 #include "csa.h"
 #include "tsutil.h"
+#include "ts_pool.h"
 #include "streams.h"
 
 # include <dvbpsi/dvbpsi.h>
@@ -187,6 +189,15 @@ static const char *const ts_standards_list_text[] =
     "The encryption routines subtract the TS-header from the value before " \
     "encrypting." )
 
+#define BLOCK_PACKETS_TEXT N_("TS packets per output block")
+#define BLOCK_PACKETS_LONGTEXT N_("Number of TS packets written in each " \
+  "block passed to the access output. The default fills an UDP datagram." )
+
+#define MUXRATE_TEXT N_("Mux rate (bits/s)")
+#define MUXRATE_LONGTEXT N_("Send a constant bitrate stream, completed " \
+  "with null packets, at the given rate. The PCR interval is then at most " \
+  "40 ms. 0 sends a variable bitrate stream." )
+
 #define SOUT_CFG_PREFIX "sout-ts-"
 #define MAX_PMT 64       /* Maximum number of programs. FIXME: I just chose an arbitrary number. Where is the maximum in the spec? */
 #define MAX_PMT_PID 64       /* Maximum pids in each pmt.  FIXME: I just chose an arbitrary number. Where is the maximum in the spec? */
@@ -229,6 +240,8 @@ vlc_module_begin ()
     add_integer( SOUT_CFG_PREFIX "bmin", 0, BMIN_TEXT, BMIN_LONGTEXT, true)
     add_integer( SOUT_CFG_PREFIX "bmax", 0, BMAX_TEXT, BMAX_LONGTEXT, true)
     add_integer( SOUT_CFG_PREFIX "dts-delay", 400, DTS_TEXT, DTS_LONGTEXT, true)
+    add_integer( SOUT_CFG_PREFIX "muxrate", 0, MUXRATE_TEXT, MUXRATE_LONGTEXT, true)
+        change_integer_range( 0, 1000000000 )
 
     add_bool( SOUT_CFG_PREFIX "crypt-audio", true, ACRYPT_TEXT, ACRYPT_LONGTEXT, true)
     add_bool( SOUT_CFG_PREFIX "crypt-video", true, VCRYPT_TEXT, VCRYPT_LONGTEXT, true)
@@ -237,6 +250,10 @@ vlc_module_begin ()
     add_string( SOUT_CFG_PREFIX "csa-use", "1",  CU_TEXT,   CU_LONGTEXT,   true)
     add_integer(SOUT_CFG_PREFIX "csa-pkt", 188,  CPKT_TEXT, CPKT_LONGTEXT, true)
 
+    add_integer(SOUT_CFG_PREFIX "block-packets", 7, BLOCK_PACKETS_TEXT,
+                BLOCK_PACKETS_LONGTEXT, true)
+        change_integer_range( 1, 256 )
+
     set_callbacks( Open, Close )
 vlc_module_end ()
 
@@ -249,7 +266,7 @@ static const char *const ppsz_sout_options[] = {
     "netid", "sdtdesc",
     "es-id-pid", "shaping", "pcr", "bmin", "bmax", "use-key-frames",
     "dts-delay", "csa-ck", "csa2-ck", "csa-use", "csa-pkt", "crypt-audio", "crypt-video",
-    "muxpmt", "program-pmt", "alignment",
+    "muxpmt", "program-pmt", "alignment", "block-packets", "muxrate",
     NULL
 };
 
@@ -340,6 +357,15 @@ typedef struct
     pes_state_t  state;
 } sout_input_sys_t;
 
+/* A TS packet written in an output block */
+typedef struct
+{
+    uint8_t         *p_data;
+    vlc_tick_t      i_dts;
+    vlc_tick_t      i_length;
+    uint32_t        i_flags;
+} ts_packet_t;
+
 typedef struct
 {
     sout_input_t    *p_pcr_input;
@@ -385,6 +411,29 @@ typedef struct
     int             i_csa_pkt_size;
     bool            b_crypt_audio;
     bool            b_crypt_video;
+
+    /* output blocks of the muxed slice, and their packets */
+    ts_pool_t       *p_pool;
+    block_t         *p_blocks;
+    block_t         **pp_blocks_last;
+    block_t         *p_block;   /* block being written, NULL to cut */
+    ts_packet_t     *p_packets;
+    int             i_packets;
+    int             i_packets_max;
+    int             i_sent;     /* packets already sent */
+
+    /* constant bitrate output */
+    uint64_t        i_muxrate;  /* bits/s, 0 for variable bitrate */
+    bool            b_cbr_started;
+    uint64_t        i_cbr_pcr;  /* 27 MHz clock of the next packet */
+    uint64_t        i_cbr_frac; /* and its fraction, in 1/i_muxrate */
+    uint64_t        i_cbr_last_pcr;
+    int             i_cbr_pcr_pid;
+    int             i_cbr_pcr_cc; /* last sent on the PCR PID, -1 if none */
+    block_t         *p_cbr_block;
+
+    vlc_mutex_t     stats_lock;
+    struct sout_mux_cbr_stats stats;
 } sout_mux_sys_t;
 
 
@@ -473,15 +522,17 @@ static int Mux      ( sout_mux_t * );
 
 static block_t *FixPES( sout_mux_t *p_mux, block_fifo_t *p_fifo );
 static block_t *Add_ADTS( block_t *, const es_format_t * );
-static void TSSchedule  ( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
+static void TSSchedule  ( sout_mux_t *p_mux, int i_first, int i_packet_count,
                           vlc_tick_t i_pcr_length, vlc_tick_t i_pcr_dts );
-static void TSDate      ( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
+static void TSDate      ( sout_mux_t *p_mux, int i_first, int i_packet_count,
                           vlc_tick_t i_pcr_length, vlc_tick_t i_pcr_dts );
-static void GetPAT( sout_mux_t *p_mux, sout_buffer_chain_t *c );
-static void GetPMT( sout_mux_t *p_mux, sout_buffer_chain_t *c );
+static void GetPAT( sout_mux_t *p_mux );
+static void GetPMT( sout_mux_t *p_mux );
 
-static block_t *TSNew( sout_mux_t *p_mux, sout_input_sys_t *p_stream, bool b_pcr );
-static void TSSetPCR( block_t *p_ts, vlc_tick_t i_dts );
+static bool TSIsKeyFrame( const sout_input_sys_t *p_stream );
+static ts_packet_t *TSNew( sout_mux_t *p_mux, sout_input_sys_t *p_stream, bool b_pcr );
+static void TSSetPCR( uint8_t *p_ts, vlc_tick_t i_dts );
+static void TSWritePCR( uint8_t *p_ts, uint64_t i_base, unsigned i_ext );
 
 static csa_t *csaSetup( vlc_object_t *p_this )
 {
@@ -550,9 +601,20 @@ static int Open( vlc_object_t *p_this )
         return VLC_ENOMEM;
     p_sys->i_num_pmt = 1;
 
+    int64_t i_block_packets = var_GetInteger( p_mux,
+                                              SOUT_CFG_PREFIX "block-packets" );
+    p_sys->p_pool = ts_pool_New( VLC_CLIP( i_block_packets, 1, 256 ) );
+    if( !p_sys->p_pool )
+    {
+        free( p_sys );
+        return VLC_ENOMEM;
+    }
+    p_sys->pp_blocks_last = &p_sys->p_blocks;
+
     p_sys->p_dvbpsi = dvbpsi_new( &dvbpsi_messages, DVBPSI_MSG_DEBUG );
     if( !p_sys->p_dvbpsi )
     {
+        ts_pool_Release( p_sys->p_pool );
         free( p_sys );
         return VLC_ENOMEM;
     }
@@ -735,6 +797,18 @@ static int Open( vlc_object_t *p_this )
     var_Get( p_mux, SOUT_CFG_PREFIX "dts-delay", &val );
     p_sys->i_dts_delay = VLC_TICK_FROM_MS(val.i_int);
 
+    p_sys->i_muxrate = var_GetInteger( p_mux, SOUT_CFG_PREFIX "muxrate" );
+    p_sys->i_cbr_pcr_pid = -1;
+    vlc_mutex_init( &p_sys->stats_lock );
+    if( p_sys->i_muxrate > 0 )
+    {
+        /* TR 101 290 PCR repetition */
+        if( p_sys->i_pcr_delay > VLC_TICK_FROM_MS(40) )
+            p_sys->i_pcr_delay = VLC_TICK_FROM_MS(40);
+        msg_Dbg( p_mux, "constant bitrate of %"PRIu64" bits/s",
+                 p_sys->i_muxrate );
+    }
+
     msg_Dbg( p_mux, "shaping=%"PRId64" pcr=%"PRId64" dts_delay=%"PRId64,
              p_sys->i_shaping_delay, p_sys->i_pcr_delay, p_sys->i_dts_delay );
 
@@ -777,6 +851,17 @@ static void Close( vlc_object_t * p_this )
         free( p_sys->sdt.desc[i].psz_provider );
     }
 
+    msg_Dbg( p_mux, "%u output blocks allocated",
+             ts_pool_Count( p_sys->p_pool ) );
+    if( p_sys->i_muxrate > 0 && p_sys->stats.packets > 0 )
+        msg_Dbg( p_mux, "multiplex fill %.1f%%, %"PRIu64" overflows, "
+                 "max PCR interval %"PRId64" us",
+                 100. * (p_sys->stats.packets - p_sys->stats.null_packets
+                         - p_sys->stats.pcr_packets) / p_sys->stats.packets,
+                 p_sys->stats.overflows, p_sys->stats.pcr_interval_max );
+    block_ChainRelease( p_sys->p_blocks );
+    ts_pool_Release( p_sys->p_pool );
+    free( p_sys->p_packets );
     free( p_sys );
 }
 
@@ -839,7 +924,7 @@ static int ActiveKeyCallback( vlc_object_t *p_this, char const *psz_cmd,
  *****************************************************************************/
 static int Control( sout_mux_t *p_mux, int i_query, va_list args )
 {
-    VLC_UNUSED(p_mux);
+    sout_mux_sys_t *p_sys = p_mux->p_sys;
     bool *pb_bool;
     char **ppsz;
 
@@ -855,6 +940,19 @@ static int Control( sout_mux_t *p_mux, int i_query, va_list args )
         *ppsz = strdup( "video/mp2t" );
         return VLC_SUCCESS;
 
+    case MUX_GET_CBR_STATS:
+    {
+        if( p_sys->i_muxrate == 0 )
+            return VLC_EGENERIC;
+
+        struct sout_mux_cbr_stats *p_stats =
+            va_arg( args, struct sout_mux_cbr_stats * );
+        vlc_mutex_lock( &p_sys->stats_lock );
+        *p_stats = p_sys->stats;
+        vlc_mutex_unlock( &p_sys->stats_lock );
+        return VLC_SUCCESS;
+    }
+
     default:
         return VLC_EGENERIC;
     }
@@ -1036,16 +1134,10 @@ static void DelStream( sout_mux_t *p_mux, sout_input_t *p_input )
     p_sys->i_pmt_version_number %= 32;
 }
 
-static void SetHeader( sout_buffer_chain_t *c,
-                        int depth )
+static void SetHeader( sout_mux_sys_t *p_sys, int i_packet )
 {
-    block_t *p_ts = BufferChainPeek( c );
-    while( depth > 0 )
-    {
-        p_ts = p_ts->p_next;
-        depth--;
-    }
-    p_ts->i_flags |= BLOCK_FLAG_HEADER;
+    if( likely(i_packet < p_sys->i_packets) )
+        p_sys->p_packets[i_packet].i_flags |= BLOCK_FLAG_HEADER;
 }
 
 static block_t *Pack_Opus(block_t *p_data)
@@ -1196,7 +1288,6 @@ static bool MuxStreams(sout_mux_t *p_mux )
     sout_mux_sys_t  *p_sys = p_mux->p_sys;
     sout_input_sys_t *p_pcr_stream = (sout_input_sys_t*)p_sys->p_pcr_input->p_sys;
 
-    sout_buffer_chain_t chain_ts;
     vlc_tick_t i_shaping_delay = p_pcr_stream->state.b_key_frame
         ? p_pcr_stream->state.i_pes_length
         : p_sys->i_shaping_delay;
@@ -1485,13 +1576,16 @@ static bool MuxStreams(sout_mux_t *p_mux )
     i_packet_count += (8 * i_pcr_length / p_sys->i_pcr_delay + 175) / 176;
 
     /* 3: mux PES into TS */
-    BufferChainInit( &chain_ts );
+    assert( p_sys->p_blocks == NULL );
+    p_sys->p_block = NULL;
+    p_sys->i_packets = 0;
+    p_sys->i_sent = 0;
     /* append PAT/PMT  -> FIXME with big pcr delay it won't have enough pat/pmt */
     bool pat_was_previous = true; //This is to prevent unnecessary double PAT/PMT insertions
-    GetPAT( p_mux, &chain_ts );
-    GetPMT( p_mux, &chain_ts );
+    GetPAT( p_mux );
+    GetPMT( p_mux );
     int i_packet_pos = 0;
-    i_packet_count += chain_ts.i_depth;
+    i_packet_count += p_sys->i_packets;
     /* msg_Dbg( p_mux, "estimated pck=%d", i_packet_count ); */
 
     const vlc_tick_t i_pcr_dts = p_pcr_stream->state.i_pes_dts;
@@ -1535,42 +1629,42 @@ static bool MuxStreams(sout_mux_t *p_mux )
             p_sys->i_pcr = i_pcr_dts + packet_length;
         }
 
-        /* Build the TS packet */
-        block_t *p_ts = TSNew( p_mux, p_stream, b_pcr );
-        if( p_sys->csa != NULL &&
-             (p_input->p_fmt->i_cat != AUDIO_ES || p_sys->b_crypt_audio) &&
-             (p_input->p_fmt->i_cat != VIDEO_ES || p_sys->b_crypt_video) )
-        {
-            p_ts->i_flags |= BLOCK_FLAG_SCRAMBLED;
-        }
-        i_packet_pos++;
-
         /* Write PAT/PMT before every keyframe if use-key-frames is enabled,
          * this helps to do segmenting with livehttp-output so it can cut segment
          * and start new one with pat,pmt,keyframe*/
         if( ( p_sys->b_use_key_frames ) &&
             ( p_input->p_fmt->i_cat == VIDEO_ES ) &&
-            ( p_ts->i_flags & BLOCK_FLAG_TYPE_I ) )
+            TSIsKeyFrame( p_stream ) )
         {
             if( likely( !pat_was_previous ) )
             {
-                int startcount = chain_ts.i_depth;
-                GetPAT( p_mux, &chain_ts );
-                GetPMT( p_mux, &chain_ts );
-                SetHeader( &chain_ts, startcount );
-                i_packet_count += (chain_ts.i_depth - startcount );
+                int startcount = p_sys->i_packets;
+                p_sys->p_block = NULL; /* the header starts a block */
+                GetPAT( p_mux );
+                GetPMT( p_mux );
+                SetHeader( p_sys, startcount );
+                i_packet_count += (p_sys->i_packets - startcount );
             } else {
-                SetHeader( &chain_ts, 0); //We just inserted pat/pmt,so just flag it instead of adding new one
+                SetHeader( p_sys, 0); //We just inserted pat/pmt,so just flag it instead of adding new one
             }
         }
         pat_was_previous = false;
 
-        /* */
-        BufferChainAppend( &chain_ts, p_ts );
+        /* Build the TS packet */
+        ts_packet_t *p_ts = TSNew( p_mux, p_stream, b_pcr );
+        if( unlikely(p_ts == NULL) )
+            break;
+        if( p_sys->csa != NULL &&
+             (p_input->p_fmt->i_cat != AUDIO_ES || p_sys->b_crypt_audio) &&
+             (p_input->p_fmt->i_cat != VIDEO_ES || p_sys->b_crypt_video) )
+        {
+            p_ts->i_flags |= BLOCK_FLAG_SCRAMBLED;
+        }
+        i_packet_pos++;
     }
 
     /* 4: date and send */
-    TSSchedule( p_mux, &chain_ts, i_pcr_length, i_pcr_dts );
+    TSSchedule( p_mux, 0, p_sys->i_packets, i_pcr_length, i_pcr_dts );
     return false;
 }
 
@@ -1705,14 +1799,56 @@ static block_t *Add_ADTS( block_t *p_data, const es_format_t *p_fmt )
     return p_new_block;
 }
 
-static void TSSchedule( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
+/* Appends a packet to the output blocks, allocating a new block from the
+ * pool if there is none or it is full */
+static ts_packet_t *TSPacketNew( sout_mux_sys_t *p_sys )
+{
+    if( p_sys->i_packets == p_sys->i_packets_max )
+    {
+        int i_max = p_sys->i_packets_max ? 2 * p_sys->i_packets_max : 256;
+        ts_packet_t *p_packets = realloc( p_sys->p_packets,
+                                          i_max * sizeof( *p_packets ) );
+        if( unlikely(p_packets == NULL) )
+            return NULL;
+        p_sys->p_packets = p_packets;
+        p_sys->i_packets_max = i_max;
+    }
+
+    block_t *p_block = p_sys->p_block;
+    if( p_block == NULL || p_block->i_buffer == p_block->i_size )
+    {
+        p_block = ts_pool_Get( p_sys->p_pool );
+        if( unlikely(p_block == NULL) )
+            return NULL;
+        block_ChainLastAppend( &p_sys->pp_blocks_last, p_block );
+        p_sys->p_block = p_block;
+    }
+
+    ts_packet_t *p_ts = &p_sys->p_packets[p_sys->i_packets++];
+    p_ts->p_data   = &p_block->p_buffer[p_block->i_buffer];
+    p_ts->i_dts    = VLC_TICK_INVALID;
+    p_ts->i_length = 0;
+    p_ts->i_flags  = 0;
+    p_block->i_buffer += 188;
+    return p_ts;
+}
+
+/* PEStoTS callback for the PSI tables */
+static void TSPacketAppend( void *p_opaque, block_t *p_block )
+{
+    sout_mux_t *p_mux = p_opaque;
+    ts_packet_t *p_ts = TSPacketNew( p_mux->p_sys );
+
+    if( likely(p_ts != NULL) )
+        memcpy( p_ts->p_data, p_block->p_buffer, 188 );
+    block_Release( p_block );
+}
+
+static void TSSchedule( sout_mux_t *p_mux, int i_first, int i_packet_count,
                         vlc_tick_t i_pcr_length, vlc_tick_t i_pcr_dts )
 {
     sout_mux_sys_t  *p_sys = p_mux->p_sys;
-    sout_buffer_chain_t new_chain;
-    int i_packet_count = p_chain_ts->i_depth;
-
-    BufferChainInit( &new_chain );
+    ts_packet_t *p_packets = &p_sys->p_packets[i_first];
 
     if ( unlikely(i_pcr_length <= 0) )
     {
@@ -1721,48 +1857,319 @@ static void TSSchedule( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
 
     for (int i = 0; i < i_packet_count; i++ )
     {
-        block_t *p_ts = BufferChainGet( p_chain_ts );
+        ts_packet_t *p_ts = &p_packets[i];
         vlc_tick_t i_new_dts = i_pcr_dts + i_pcr_length * i / i_packet_count;
 
-        BufferChainAppend( &new_chain, p_ts );
-
         if (!p_ts->i_dts || p_ts->i_dts + p_sys->i_dts_delay * 2/3 >= i_new_dts)
             continue;
 
         vlc_tick_t i_max_diff = i_new_dts - p_ts->i_dts;
         vlc_tick_t i_cut_dts = p_ts->i_dts;
+        int i_cut = i + 1;
 
-        while( (p_ts = BufferChainPeek( p_chain_ts )) )
+        for( ; i_cut < i_packet_count; i_cut++ )
         {
-            i_new_dts = i_pcr_dts + i_pcr_length * i++ / i_packet_count;
+            p_ts = &p_packets[i_cut];
+            i_new_dts = i_pcr_dts + i_pcr_length * (i_cut - 1) / i_packet_count;
             if( p_ts->i_dts >= i_pcr_dts &&
                 i_new_dts - p_ts->i_dts >= i_max_diff )
                break;
-            p_ts = BufferChainGet( p_chain_ts );
-            BufferChainAppend( &new_chain, p_ts );
             i_max_diff = i_new_dts - p_ts->i_dts;
             i_cut_dts = p_ts->i_dts;
         }
         msg_Dbg( p_mux, "adjusting rate at %"PRId64"/%"PRId64" (%d/%d)",
-                 i_cut_dts - i_pcr_dts, i_pcr_length, new_chain.i_depth,
-                 p_chain_ts->i_depth );
-        if ( new_chain.i_depth )
-            TSDate( p_mux, &new_chain, i_cut_dts - i_pcr_dts, i_pcr_dts );
-        if ( p_chain_ts->i_depth )
-            TSSchedule( p_mux, p_chain_ts, i_pcr_dts + i_pcr_length - i_cut_dts,
-                        i_cut_dts );
+                 i_cut_dts - i_pcr_dts, i_pcr_length, i_cut,
+                 i_packet_count - i_cut );
+        TSDate( p_mux, i_first, i_cut, i_cut_dts - i_pcr_dts, i_pcr_dts );
+        if ( i_cut < i_packet_count )
+            TSSchedule( p_mux, i_first + i_cut, i_packet_count - i_cut,
+                        i_pcr_dts + i_pcr_length - i_cut_dts, i_cut_dts );
         return;
     }
 
-    if ( new_chain.i_depth )
-        TSDate( p_mux, &new_chain, i_pcr_length, i_pcr_dts );
+    if ( i_packet_count )
+        TSDate( p_mux, i_first, i_packet_count, i_pcr_length, i_pcr_dts );
 }
 
-static void TSDate( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
+static void TSScramble( sout_mux_sys_t *p_sys, uint8_t *const *pp_pkts,
+                        unsigned i_count )
+{
+    vlc_mutex_lock( &p_sys->csa_lock );
+    csa_EncryptBatch( p_sys->csa, pp_pkts, i_count, p_sys->i_csa_pkt_size );
+    vlc_mutex_unlock( &p_sys->csa_lock );
+}
+
+static void TSSetBlockInfo( block_t *p_block, const ts_packet_t *p_ts,
+                            int i_count )
+{
+    p_block->i_dts    = p_ts[0].i_dts;
+    p_block->i_length = 0;
+    p_block->i_flags  = p_ts[0].i_flags & (BLOCK_FLAG_TYPE_I|BLOCK_FLAG_HEADER);
+
+    for (int i = 0; i < i_count; i++ )
+    {
+        p_block->i_length += p_ts[i].i_length;
+        p_block->i_flags  |= p_ts[i].i_flags & BLOCK_FLAG_CLOCK;
+    }
+}
+
+/* Sends the output blocks whose packets are all dated */
+static void TSSend( sout_mux_t *p_mux, int i_dated )
+{
+    sout_mux_sys_t  *p_sys = p_mux->p_sys;
+    block_t *p_block;
+
+    while( (p_block = p_sys->p_blocks) != NULL )
+    {
+        int i_count = p_block->i_buffer / 188;
+        if( p_sys->i_sent + i_count > i_dated )
+            break;
+
+        const ts_packet_t *p_ts = &p_sys->p_packets[p_sys->i_sent];
+        p_sys->i_sent += i_count;
+        p_sys->p_blocks = p_block->p_next;
+        if( p_sys->p_blocks == NULL )
+            p_sys->pp_blocks_last = &p_sys->p_blocks;
+        p_block->p_next = NULL;
+
+        if( p_sys->i_muxrate > 0 )
+        {
+            /* already copied to the constant bitrate output */
+            block_Release( p_block );
+            continue;
+        }
+
+        /* The access outputs expect the header packet in its own block */
+        if( (p_ts->i_flags & BLOCK_FLAG_HEADER) && i_count > 1 )
+        {
+            block_t *p_header = block_Alloc( 188 );
+            if( likely(p_header != NULL) )
+            {
+                memcpy( p_header->p_buffer, p_block->p_buffer, 188 );
+                TSSetBlockInfo( p_header, p_ts, 1 );
+                sout_AccessOutWrite( p_mux->p_access, p_header );
+
+                p_block->p_buffer += 188;
+                p_block->i_buffer -= 188;
+                p_ts++;
+                i_count--;
+            }
+        }
+
+        TSSetBlockInfo( p_block, p_ts, i_count );
+        sout_AccessOutWrite( p_mux->p_access, p_block );
+    }
+}
+
+/*
+ * Constant bitrate output
+ *
+ * Each output packet has a slot of 188 * 8 / muxrate seconds, its 27 MHz
+ * clock being kept exactly with a fraction in 1/muxrate. The packets of a
+ * slice are spread over the slots up to the end of the slice, the other
+ * slots carrying null packets, or PCR only packets when a PCR is due.
+ * The PCRs are the clock of their slot.
+ */
+#define TS_CBR_SLOT_27MHZ (UINT64_C(188 * 8) * 27000000)
+
+static vlc_tick_t TSCbrDate( const sout_mux_sys_t *p_sys )
+{
+    return p_sys->first_dts + VLC_TICK_FROM_US(p_sys->i_cbr_pcr / 27);
+}
+
+static void TSCbrFlush( sout_mux_t *p_mux )
+{
+    sout_mux_sys_t *p_sys = p_mux->p_sys;
+
+    if( p_sys->p_cbr_block != NULL )
+    {
+        sout_AccessOutWrite( p_mux->p_access, p_sys->p_cbr_block );
+        p_sys->p_cbr_block = NULL;
+    }
+}
+
+/* Returns the next packet of the output blocks */
+static uint8_t *TSCbrPacket( sout_mux_t *p_mux, uint32_t i_flags,
+                             vlc_tick_t i_dts, vlc_tick_t i_length )
+{
+    sout_mux_sys_t *p_sys = p_mux->p_sys;
+    block_t *p_block = p_sys->p_cbr_block;
+
+    /* Keyframes start a block and the header packet is alone */
+    if( p_block != NULL &&
+        ( p_block->i_buffer == p_block->i_size ||
+          (p_block->i_flags & BLOCK_FLAG_HEADER) ||
+          (i_flags & (BLOCK_FLAG_TYPE_I|BLOCK_FLAG_HEADER)) ) )
+        TSCbrFlush( p_mux );
+
+    p_block = p_sys->p_cbr_block;
+    if( p_block == NULL )
+    {
+        p_block = ts_pool_Get( p_sys->p_pool );
+        if( unlikely(p_block == NULL) )
+            return NULL;
+        p_block->i_dts    = i_dts;
+        p_block->i_length = 0;
+        p_block->i_flags  = i_flags & (BLOCK_FLAG_TYPE_I|BLOCK_FLAG_HEADER);
+        p_sys->p_cbr_block = p_block;
+    }
+
+    uint8_t *p_data = &p_block->p_buffer[p_block->i_buffer];
+    p_block->i_buffer += 188;
+    p_block->i_length += i_length;
+    p_block->i_flags  |= i_flags & BLOCK_FLAG_CLOCK;
+    return p_data;
+}
+
+static void TSCbrSetPCR( sout_mux_sys_t *p_sys, uint8_t *p_data,
+                         struct sout_mux_cbr_stats *p_stats )
+{
+    TSWritePCR( p_data, p_sys->i_cbr_pcr / 300, p_sys->i_cbr_pcr % 300 );
+
+    vlc_tick_t i_interval = VLC_TICK_FROM_US(
+        (p_sys->i_cbr_pcr - p_sys->i_cbr_last_pcr) / 27 );
+    if( p_stats->pcr_interval_max < i_interval )
+        p_stats->pcr_interval_max = i_interval;
+
+    /* the PCR is truncated to the 27 MHz clock */
+    unsigned i_error = p_sys->i_cbr_frac * 1000 / (27 * p_sys->i_muxrate);
+    if( p_stats->pcr_accuracy_max < i_error )
+        p_stats->pcr_accuracy_max = i_error;
+
+    p_sys->i_cbr_last_pcr = p_sys->i_cbr_pcr;
+}
+
+static void TSSendCBR( sout_mux_t *p_mux, int i_first, int i_packet_count,
+                       vlc_tick_t i_end )
+{
+    sout_mux_sys_t *p_sys = p_mux->p_sys;
+    sout_input_sys_t *p_pcr_stream =
+        (sout_input_sys_t*)p_sys->p_pcr_input->p_sys;
+    const ts_packet_t *p_packets = &p_sys->p_packets[i_first];
+    const uint64_t i_step = TS_CBR_SLOT_27MHZ / p_sys->i_muxrate;
+    const uint64_t i_step_frac = TS_CBR_SLOT_27MHZ % p_sys->i_muxrate;
+    const vlc_tick_t i_length = vlc_tick_from_samples( 188 * 8,
+                                                       p_sys->i_muxrate );
+    const vlc_tick_t i_latency = p_sys->i_shaping_delay * 3 / 2;
+    struct sout_mux_cbr_stats stats = { 0 };
+
+    if( !p_sys->b_cbr_started )
+    {
+        vlc_tick_t i_start = p_packets[0].i_dts - i_latency - p_sys->first_dts;
+
+        p_sys->i_cbr_pcr = US_FROM_VLC_TICK( __MAX(i_start, 0) ) * 27;
+        p_sys->i_cbr_frac = 0;
+        p_sys->i_cbr_last_pcr = p_sys->i_cbr_pcr;
+        p_sys->b_cbr_started = true;
+    }
+    if( p_sys->i_cbr_pcr_pid != p_pcr_stream->ts.i_pid )
+    {
+        p_sys->i_cbr_pcr_pid = p_pcr_stream->ts.i_pid;
+        p_sys->i_cbr_pcr_cc = -1;
+    }
+
+    /* Slots until the end of the slice */
+    uint64_t i_slots = 0;
+    vlc_tick_t i_date = TSCbrDate( p_sys );
+    if( i_end > i_date )
+        i_slots = (uint64_t)US_FROM_VLC_TICK(i_end - i_date) * 27
+                  * p_sys->i_muxrate / TS_CBR_SLOT_27MHZ;
+    if( i_slots < (uint64_t)i_packet_count )
+    {
+        msg_Warn( p_mux, "mux rate exceeded (%d packets for %"PRIu64" slots)",
+                  i_packet_count, i_slots );
+        i_slots = i_packet_count;
+        stats.overflows++;
+    }
+
+    /* leave some margin for the slots taken by the packets of the slice */
+    const uint64_t i_pcr_interval =
+        US_FROM_VLC_TICK(p_sys->i_pcr_delay) * 27 * 9 / 10;
+    int i = 0;
+
+    for( uint64_t k = 0; k < i_slots; k++ )
+    {
+        const vlc_tick_t i_dts = TSCbrDate( p_sys ) + i_latency;
+        uint8_t *p_data;
+
+        if( i < i_packet_count && (uint64_t)i * i_slots / i_packet_count <= k )
+        {
+            const ts_packet_t *p_ts = &p_packets[i++];
+
+            p_data = TSCbrPacket( p_mux, p_ts->i_flags, i_dts, i_length );
+            if( likely(p_data != NULL) )
+            {
+                memcpy( p_data, p_ts->p_data, 188 );
+                if( p_ts->i_flags & BLOCK_FLAG_CLOCK )
+                    TSCbrSetPCR( p_sys, p_data, &stats );
+                if( ( ( (p_data[1] & 0x1f) << 8 ) | p_data[2] )
+                    == p_sys->i_cbr_pcr_pid )
+                    p_sys->i_cbr_pcr_cc = p_data[3] & 0x0f;
+            }
+            if( stats.delay_max < i_dts - p_ts->i_dts )
+                stats.delay_max = i_dts - p_ts->i_dts;
+        }
+        else if( p_sys->i_cbr_pcr_cc >= 0 &&
+                 p_sys->i_cbr_pcr - p_sys->i_cbr_last_pcr >= i_pcr_interval )
+        {
+            /* PCR only packet, without payload nor continuity increment */
+            p_data = TSCbrPacket( p_mux, BLOCK_FLAG_CLOCK, i_dts, i_length );
+            if( likely(p_data != NULL) )
+            {
+                const int i_pid = p_sys->i_cbr_pcr_pid;
+
+                p_data[0] = 0x47;
+                p_data[1] = ( i_pid >> 8 )&0x1f;
+                p_data[2] = i_pid & 0xff;
+                p_data[3] = 0x20 | p_sys->i_cbr_pcr_cc;
+                p_data[4] = 183;
+                p_data[5] = 1 << 4; /* PCR_flag */
+                memset( &p_data[12], 0xff, 176 );
+                TSCbrSetPCR( p_sys, p_data, &stats );
+            }
+            stats.pcr_packets++;
+        }
+        else
+        {
+            p_data = TSCbrPacket( p_mux, 0, i_dts, i_length );
+            if( likely(p_data != NULL) )
+            {
+                p_data[0] = 0x47;
+                p_data[1] = 0x1f;
+                p_data[2] = 0xff;
+                p_data[3] = 0x10;
+                memset( &p_data[4], 0xff, 184 );
+            }
+            stats.null_packets++;
+        }
+
+        p_sys->i_cbr_pcr += i_step;
+        p_sys->i_cbr_frac += i_step_frac;
+        if( p_sys->i_cbr_frac >= p_sys->i_muxrate )
+        {
+            p_sys->i_cbr_frac -= p_sys->i_muxrate;
+            p_sys->i_cbr_pcr++;
+        }
+    }
+    TSCbrFlush( p_mux );
+
+    vlc_mutex_lock( &p_sys->stats_lock );
+    p_sys->stats.packets += i_slots;
+    p_sys->stats.null_packets += stats.null_packets;
+    p_sys->stats.pcr_packets += stats.pcr_packets;
+    p_sys->stats.overflows += stats.overflows;
+    p_sys->stats.pcr_interval_max = __MAX(p_sys->stats.pcr_interval_max,
+                                          stats.pcr_interval_max);
+    p_sys->stats.delay_max = __MAX(p_sys->stats.delay_max, stats.delay_max);
+    p_sys->stats.pcr_accuracy_max = __MAX(p_sys->stats.pcr_accuracy_max,
+                                          stats.pcr_accuracy_max);
+    vlc_mutex_unlock( &p_sys->stats_lock );
+}
+
+static void TSDate( sout_mux_t *p_mux, int i_first, int i_packet_count,
                     vlc_tick_t i_pcr_length, vlc_tick_t i_pcr_dts )
 {
     sout_mux_sys_t  *p_sys = p_mux->p_sys;
-    int i_packet_count = p_chain_ts->i_depth;
 
     if ( likely(i_pcr_length / 1000 > 0) )
     {
@@ -1784,37 +2191,57 @@ static void TSDate( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
     }
 
     /* msg_Dbg( p_mux, "real pck=%d", i_packet_count ); */
-    for (int i = 0; i < i_packet_count; i++ )
+    uint8_t *pp_scrambled[CSA_BATCH_MAX];
+    unsigned i_scrambled = 0;
+    ts_packet_t *p_ts = &p_sys->p_packets[i_first];
+
+    for (int i = 0; i < i_packet_count; i++, p_ts++ )
     {
-        block_t *p_ts = BufferChainGet( p_chain_ts );
         vlc_tick_t i_new_dts = i_pcr_dts + i_pcr_length * i / i_packet_count;
 
         p_ts->i_dts    = i_new_dts;
         p_ts->i_length = i_pcr_length / i_packet_count;
 
-        if( p_ts->i_flags & BLOCK_FLAG_CLOCK )
+        if( (p_ts->i_flags & BLOCK_FLAG_CLOCK) && p_sys->i_muxrate == 0 )
         {
             /* msg_Dbg( p_mux, "pcr=%lld ms", p_ts->i_dts / 1000 ); */
-            TSSetPCR( p_ts, p_ts->i_dts - p_sys->first_dts );
+            TSSetPCR( p_ts->p_data, p_ts->i_dts - p_sys->first_dts );
         }
         if( p_ts->i_flags & BLOCK_FLAG_SCRAMBLED )
         {
-            vlc_mutex_lock( &p_sys->csa_lock );
-            csa_Encrypt( p_sys->csa, p_ts->p_buffer, p_sys->i_csa_pkt_size );
-            vlc_mutex_unlock( &p_sys->csa_lock );
+            /* scramble the packets of the slice in parallel */
+            pp_scrambled[i_scrambled++] = p_ts->p_data;
+            if( i_scrambled == CSA_BATCH_MAX )
+            {
+                TSScramble( p_sys, pp_scrambled, i_scrambled );
+                i_scrambled = 0;
+            }
         }
 
         /* latency */
         p_ts->i_dts += p_sys->i_shaping_delay * 3 / 2;
-
-        sout_AccessOutWrite( p_mux->p_access, p_ts );
     }
+    if( i_scrambled > 0 )
+        TSScramble( p_sys, pp_scrambled, i_scrambled );
+
+    if( p_sys->i_muxrate > 0 )
+        TSSendCBR( p_mux, i_first, i_packet_count, i_pcr_dts + i_pcr_length );
+    TSSend( p_mux, i_first + i_packet_count );
 }
 
-static block_t *TSNew( sout_mux_t *p_mux, sout_input_sys_t *p_stream,
-                       bool b_pcr )
+static bool TSIsKeyFrame( const sout_input_sys_t *p_stream )
 {
-    VLC_UNUSED(p_mux);
+    const block_t *p_pes = p_stream->state.chain_pes.p_first;
+
+    return p_stream->state.i_pes_used <= 0 &&
+           !(p_pes->i_flags & BLOCK_FLAG_NO_KEYFRAME) &&
+           (p_pes->i_flags & BLOCK_FLAG_TYPE_I);
+}
+
+static ts_packet_t *TSNew( sout_mux_t *p_mux, sout_input_sys_t *p_stream,
+                           bool b_pcr )
+{
+    sout_mux_sys_t *p_sys = p_mux->p_sys;
     block_t *p_pes = p_stream->state.chain_pes.p_first;
 
     bool b_new_pes = false;
@@ -1834,20 +2261,28 @@ static block_t *TSNew( sout_mux_t *p_mux, sout_input_sys_t *p_stream,
         b_adaptation_field = true;
     }
 
-    block_t *p_ts = block_Alloc( 188 );
+    /* keyframes start a new output block */
+    bool b_key_frame = TSIsKeyFrame( p_stream );
+    if( b_key_frame )
+        p_sys->p_block = NULL;
 
-    if (b_new_pes && !(p_pes->i_flags & BLOCK_FLAG_NO_KEYFRAME) && p_pes->i_flags & BLOCK_FLAG_TYPE_I)
+    ts_packet_t *p_ts = TSPacketNew( p_sys );
+    if( unlikely(p_ts == NULL) )
+        return NULL;
+
+    if( b_key_frame )
     {
         p_ts->i_flags |= BLOCK_FLAG_TYPE_I;
     }
 
     p_ts->i_dts = p_pes->i_dts;
 
-    p_ts->p_buffer[0] = 0x47;
-    p_ts->p_buffer[1] = ( b_new_pes ? 0x40 : 0x00 ) |
+    uint8_t *p_buffer = p_ts->p_data;
+    p_buffer[0] = 0x47;
+    p_buffer[1] = ( b_new_pes ? 0x40 : 0x00 ) |
         ( ( p_stream->ts.i_pid >> 8 )&0x1f );
-    p_ts->p_buffer[2] = p_stream->ts.i_pid & 0xff;
-    p_ts->p_buffer[3] = ( b_adaptation_field ? 0x30 : 0x10 ) |
+    p_buffer[2] = p_stream->ts.i_pid & 0xff;
+    p_buffer[3] = ( b_adaptation_field ? 0x30 : 0x10 ) |
         p_stream->ts.i_continuity_counter;
 
     p_stream->ts.i_continuity_counter = (p_stream->ts.i_continuity_counter+1)%16;
@@ -1860,28 +2295,28 @@ static block_t *TSNew( sout_mux_t *p_mux, sout_input_sys_t *p_stream,
         {
             p_ts->i_flags |= BLOCK_FLAG_CLOCK;
 
-            p_ts->p_buffer[4] = 7 + i_stuffing;
-            p_ts->p_buffer[5] = 1 << 4; /* PCR_flag */
+            p_buffer[4] = 7 + i_stuffing;
+            p_buffer[5] = 1 << 4; /* PCR_flag */
             if( p_stream->ts.b_discontinuity )
             {
-                p_ts->p_buffer[5] |= 0x80; /* flag TS dicontinuity */
+                p_buffer[5] |= 0x80; /* flag TS dicontinuity */
                 p_stream->ts.b_discontinuity = false;
             }
-            memset(&p_ts->p_buffer[12], 0xff, i_stuffing);
+            memset(&p_buffer[12], 0xff, i_stuffing);
         }
         else
         {
-            p_ts->p_buffer[4] = --i_stuffing;
+            p_buffer[4] = --i_stuffing;
             if( i_stuffing-- )
             {
-                p_ts->p_buffer[5] = 0;
-                memset(&p_ts->p_buffer[6], 0xff, i_stuffing);
+                p_buffer[5] = 0;
+                memset(&p_buffer[6], 0xff, i_stuffing);
             }
         }
     }
 
     /* copy payload */
-    memcpy( &p_ts->p_buffer[188 - i_payload],
+    memcpy( &p_buffer[188 - i_payload],
             &p_pes->p_buffer[p_stream->state.i_pes_used], i_payload );
 
     p_stream->state.i_pes_used += i_payload;
@@ -1914,31 +2349,35 @@ static block_t *TSNew( sout_mux_t *p_mux, sout_input_sys_t *p_stream,
     return p_ts;
 }
 
-static void TSSetPCR( block_t *p_ts, vlc_tick_t i_dts )
+static void TSSetPCR( uint8_t *p_ts, vlc_tick_t i_dts )
+{
+    /* we don't set PCR extension */
+    TSWritePCR( p_ts, TO_SCALE_NZ(i_dts), 0 );
+}
+
+static void TSWritePCR( uint8_t *p_ts, uint64_t i_base, unsigned i_ext )
 {
-    int64_t i_pcr = TO_SCALE_NZ(i_dts);
-
-    p_ts->p_buffer[6]  = ( i_pcr >> 25 )&0xff;
-    p_ts->p_buffer[7]  = ( i_pcr >> 17 )&0xff;
-    p_ts->p_buffer[8]  = ( i_pcr >> 9  )&0xff;
-    p_ts->p_buffer[9]  = ( i_pcr >> 1  )&0xff;
-    p_ts->p_buffer[10] = ( i_pcr << 7  )&0x80;
-    p_ts->p_buffer[10] |= 0x7e;
-    p_ts->p_buffer[11] = 0; /* we don't set PCR extension */
+    p_ts[6]  = ( i_base >> 25 )&0xff;
+    p_ts[7]  = ( i_base >> 17 )&0xff;
+    p_ts[8]  = ( i_base >> 9  )&0xff;
+    p_ts[9]  = ( i_base >> 1  )&0xff;
+    p_ts[10] = ( i_base << 7  )&0x80;
+    p_ts[10] |= 0x7e | ( i_ext >> 8 );
+    p_ts[11] = i_ext & 0xff;
 }
 
-void GetPAT( sout_mux_t *p_mux, sout_buffer_chain_t *c )
+void GetPAT( sout_mux_t *p_mux )
 {
     sout_mux_sys_t       *p_sys = p_mux->p_sys;
 
     BuildPAT( p_sys->p_dvbpsi,
-              c, (PEStoTSCallback)BufferChainAppend,
+              p_mux, TSPacketAppend,
               p_sys->i_tsid, p_sys->i_pat_version_number,
               &p_sys->pat,
               p_sys->i_num_pmt, p_sys->pmt, p_sys->i_pmt_program_number );
 }
 
-static void GetPMT( sout_mux_t *p_mux, sout_buffer_chain_t *c )
+static void GetPMT( sout_mux_t *p_mux )
 {
     sout_mux_sys_t *p_sys = p_mux->p_sys;
     pes_mapped_stream_t mappeds[p_mux->i_nb_inputs];
@@ -1960,7 +2399,7 @@ static void GetPMT( sout_mux_t *p_mux, sout_buffer_chain_t *c )
     }
 
     BuildPMT( p_sys->p_dvbpsi, VLC_OBJECT(p_mux), p_sys->standard,
-              c, (PEStoTSCallback)BufferChainAppend,
+              p_mux, TSPacketAppend,
               p_sys->i_tsid, p_sys->i_pmt_version_number,
               ((sout_input_sys_t *)p_sys->p_pcr_input->p_sys)->ts.i_pid,
               &p_sys->sdt,
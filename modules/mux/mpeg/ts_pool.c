@@ -0,0 +1,158 @@
+/*****************************************************************************
+ * ts_pool.c: pool of TS output blocks
+ *****************************************************************************
+ * Copyright (C) 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+
+#include "ts_pool.h"
+
+#define TS_POOL_ALIGN 64
+
+typedef struct ts_pool_block_t ts_pool_block_t;
+
+struct ts_pool_block_t
+{
+    block_t          self;
+    ts_pool_t       *p_pool;
+    ts_pool_block_t *p_next;
+};
+
+struct ts_pool_t
+{
+    vlc_mutex_t      lock;
+    ts_pool_block_t *p_free;
+    unsigned         i_refs; /* owner and blocks in use */
+    unsigned         i_count;
+    unsigned         i_packets;
+};
+
+static size_t ts_pool_HeaderSize( void )
+{
+    return (sizeof( ts_pool_block_t ) + TS_POOL_ALIGN - 1)
+           & ~(size_t)(TS_POOL_ALIGN - 1);
+}
+
+static void ts_pool_Destroy( ts_pool_t *p_pool )
+{
+    ts_pool_block_t *p_block = p_pool->p_free;
+
+    while( p_block != NULL )
+    {
+        ts_pool_block_t *p_next = p_block->p_next;
+        aligned_free( p_block );
+        p_block = p_next;
+    }
+    free( p_pool );
+}
+
+static void ts_pool_Unref( ts_pool_t *p_pool )
+{
+    vlc_mutex_lock( &p_pool->lock );
+    bool b_last = --p_pool->i_refs == 0;
+    vlc_mutex_unlock( &p_pool->lock );
+
+    if( b_last )
+        ts_pool_Destroy( p_pool );
+}
+
+static void ts_pool_BlockRelease( block_t *p_block )
+{
+    ts_pool_block_t *p_pool_block = container_of( p_block, ts_pool_block_t,
+                                                  self );
+    ts_pool_t *p_pool = p_pool_block->p_pool;
+
+    vlc_mutex_lock( &p_pool->lock );
+    p_pool_block->p_next = p_pool->p_free;
+    p_pool->p_free = p_pool_block;
+    vlc_mutex_unlock( &p_pool->lock );
+
+    ts_pool_Unref( p_pool );
+}
+
+static const struct vlc_block_callbacks ts_pool_block_cbs =
+{
+    ts_pool_BlockRelease,
+};
+
+ts_pool_t *ts_pool_New( unsigned i_packets )
+{
+    ts_pool_t *p_pool = malloc( sizeof( *p_pool ) );
+    if( unlikely(p_pool == NULL) )
+        return NULL;
+
+    vlc_mutex_init( &p_pool->lock );
+    p_pool->p_free = NULL;
+    p_pool->i_refs = 1;
+    p_pool->i_count = 0;
+    p_pool->i_packets = i_packets;
+    return p_pool;
+}
+
+void ts_pool_Release( ts_pool_t *p_pool )
+{
+    ts_pool_Unref( p_pool );
+}
+
+block_t *ts_pool_Get( ts_pool_t *p_pool )
+{
+    const size_t i_header = ts_pool_HeaderSize();
+    const size_t i_size = p_pool->i_packets * 188;
+    const size_t i_alloc = i_header + ((i_size + TS_POOL_ALIGN - 1)
+                                       & ~(size_t)(TS_POOL_ALIGN - 1));
+
+    vlc_mutex_lock( &p_pool->lock );
+    ts_pool_block_t *p_pool_block = p_pool->p_free;
+    if( p_pool_block != NULL )
+        p_pool->p_free = p_pool_block->p_next;
+    p_pool->i_refs++;
+    vlc_mutex_unlock( &p_pool->lock );
+
+    if( p_pool_block == NULL )
+    {
+        p_pool_block = aligned_alloc( TS_POOL_ALIGN, i_alloc );
+        if( unlikely(p_pool_block == NULL) )
+        {
+            ts_pool_Unref( p_pool );
+            return NULL;
+        }
+        p_pool_block->p_pool = p_pool;
+
+        vlc_mutex_lock( &p_pool->lock );
+        p_pool->i_count++;
+        vlc_mutex_unlock( &p_pool->lock );
+    }
+
+    block_t *p_block = block_Init( &p_pool_block->self, &ts_pool_block_cbs,
+                                   (uint8_t *)p_pool_block + i_header, i_size );
+    p_block->i_buffer = 0;
+    return p_block;
+}
+
+unsigned ts_pool_Count( ts_pool_t *p_pool )
+{
+    vlc_mutex_lock( &p_pool->lock );
+    unsigned i_count = p_pool->i_count;
+    vlc_mutex_unlock( &p_pool->lock );
+    return i_count;
+}
@@ -0,0 +1,39 @@
+/*****************************************************************************
+ * ts_pool.h: pool of TS output blocks
+ *****************************************************************************
+ * Copyright (C) 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifndef VLC_MPEG_TS_POOL_H_
+#define VLC_MPEG_TS_POOL_H_
+
+/*
+ * Blocks holding up to a fixed number of TS packets, recycled when
+ * released by the access output, from any thread. The pool is destroyed
+ * once released by its owner and all its blocks are released.
+ */
+typedef struct ts_pool_t ts_pool_t;
+
+ts_pool_t *ts_pool_New( unsigned i_packets );
+void       ts_pool_Release( ts_pool_t * );
+
+/* Returns an empty block (i_buffer is 0) of i_packets * 188 bytes */
+block_t   *ts_pool_Get( ts_pool_t * );
+
+/* Number of blocks allocated so far */
+unsigned   ts_pool_Count( ts_pool_t * );
+
+#endif
@@ -281,6 +281,14 @@ static int Open(vlc_object_t *obj)
     if (s->s->pf_block == NULL)
         return VLC_EGENERIC;
 
+    /* Blocks mapping the data of the source are already large and in
+     * memory: copying them into the cache would only add a copy. The core
+     * stream can serve reads and peeks from them as is. */
+    bool mapped;
+    if (vlc_stream_Control(s->s, STREAM_IS_MAPPED, &mapped) == VLC_SUCCESS
+     && mapped)
+        return VLC_EGENERIC;
+
     stream_sys_t *sys = malloc(sizeof (*sys));
     if (unlikely(sys == NULL))
         return VLC_ENOMEM;
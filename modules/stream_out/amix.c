@@ -0,0 +1,505 @@
+/*****************************************************************************
+ * amix.c: mix the audio elementary streams into one
+ *****************************************************************************
+ * Copyright © 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Preamble
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+#include <vlc_plugin.h>
+#include <vlc_aout.h>
+#include <vlc_block.h>
+#include <vlc_charset.h>
+#include <vlc_codec.h>
+#include <vlc_modules.h>
+#include <vlc_sout.h>
+
+#include "amix_mixer.h"
+
+#define SOUT_CFG_PREFIX "sout-amix-"
+
+/* Mixed blocks duration */
+#define CHUNK_MS 20
+
+typedef struct
+{
+    void *downstream_id;    /* not mixed, sent as is */
+
+    decoder_t *decoder;
+    vlc_mutex_t lock;       /* decoder output */
+    es_format_t decoder_out;
+    block_t *decoded;
+    block_t **decoded_last;
+
+    aout_filters_t *filters;
+    audio_format_t filters_in;
+    amix_input_t *input;
+} sout_stream_id_sys_t;
+
+typedef struct
+{
+    amix_mixer_t mixer;
+    audio_format_t fmt;     /* mixed format */
+    void *downstream_id;    /* mixed ES */
+    int es_id;
+    unsigned inputs;
+    float gain;
+    char *gains;
+} sout_stream_sys_t;
+
+struct decoder_owner
+{
+    decoder_t dec;
+    sout_stream_id_sys_t *id;
+};
+
+static inline struct decoder_owner *dec_get_owner(decoder_t *dec)
+{
+    return container_of(dec, struct decoder_owner, dec);
+}
+
+static int DecoderUpdateFormat(decoder_t *dec)
+{
+    sout_stream_id_sys_t *id = dec_get_owner(dec)->id;
+
+    dec->fmt_out.audio.i_format = dec->fmt_out.i_codec;
+    aout_FormatPrepare(&dec->fmt_out.audio);
+
+    if (!AOUT_FMT_LINEAR(&dec->fmt_out.audio))
+        return VLC_EGENERIC;
+
+    vlc_mutex_lock(&id->lock);
+    es_format_Clean(&id->decoder_out);
+    es_format_Copy(&id->decoder_out, &dec->fmt_out);
+    vlc_mutex_unlock(&id->lock);
+    return VLC_SUCCESS;
+}
+
+static void DecoderQueue(decoder_t *dec, block_t *block)
+{
+    sout_stream_id_sys_t *id = dec_get_owner(dec)->id;
+
+    vlc_mutex_lock(&id->lock);
+    *id->decoded_last = block;
+    id->decoded_last = &block->p_next;
+    vlc_mutex_unlock(&id->lock);
+}
+
+/* Gain of an ES, from the "id=gain" list or the default one */
+static float GetGain(const sout_stream_sys_t *sys, int es_id)
+{
+    const char *str = sys->gains;
+
+    while (str != NULL && *str != '\0')
+    {
+        char *end;
+        long id = strtol(str, &end, 10);
+
+        if (*end == '=' && id == es_id)
+            return us_strtof(end + 1, NULL);
+
+        str = strchr(str, ',');
+        if (str != NULL)
+            str++;
+    }
+    return sys->gain;
+}
+
+static void Output(sout_stream_t *stream, bool drain)
+{
+    sout_stream_sys_t *sys = stream->p_sys;
+    block_t *block;
+
+    while ((block = amix_Mix(&sys->mixer, drain)) != NULL)
+    {
+        if (sys->downstream_id != NULL)
+            sout_StreamIdSend(stream->p_next, sys->downstream_id, block);
+        else
+            block_Release(block);
+    }
+}
+
+static void *Add(sout_stream_t *stream, const es_format_t *fmt)
+{
+    sout_stream_sys_t *sys = stream->p_sys;
+
+    sout_stream_id_sys_t *id = calloc(1, sizeof (*id));
+    if (unlikely(id == NULL))
+        return NULL;
+
+    if (fmt->i_cat != AUDIO_ES)
+    {
+        id->downstream_id = sout_StreamIdAdd(stream->p_next, fmt);
+        if (id->downstream_id == NULL)
+        {
+            free(id);
+            return NULL;
+        }
+        return id;
+    }
+
+    vlc_mutex_init(&id->lock);
+    es_format_Init(&id->decoder_out, AUDIO_ES, 0);
+    id->decoded_last = &id->decoded;
+
+    struct decoder_owner *owner = vlc_object_create(stream, sizeof (*owner));
+    if (unlikely(owner == NULL))
+        goto error;
+    owner->id = id;
+    id->decoder = &owner->dec;
+    decoder_Init(id->decoder, fmt);
+
+    static const struct decoder_owner_callbacks dec_cbs =
+    {
+        .audio = {
+            .format_update = DecoderUpdateFormat,
+            .queue = DecoderQueue,
+        },
+    };
+    id->decoder->cbs = &dec_cbs;
+    id->decoder->pf_decode = NULL;
+    id->decoder->p_module = module_need_var(id->decoder, "audio decoder",
+                                            "codec");
+    if (id->decoder->p_module == NULL)
+    {
+        msg_Err(stream, "cannot find audio decoder for %4.4s",
+                (const char *)&fmt->i_codec);
+        decoder_Destroy(id->decoder);
+        goto error;
+    }
+
+    id->input = amix_AddInput(&sys->mixer, GetGain(sys, fmt->i_id));
+    if (unlikely(id->input == NULL))
+    {
+        decoder_Destroy(id->decoder);
+        goto error;
+    }
+
+    /* The first mixed ES creates the mixed output */
+    if (sys->downstream_id == NULL)
+    {
+        es_format_t out;
+
+        es_format_Init(&out, AUDIO_ES, VLC_CODEC_FL32);
+        out.audio = sys->fmt;
+        out.i_id = sys->es_id >= 0 ? sys->es_id : fmt->i_id;
+        out.i_group = fmt->i_group;
+        out.i_bitrate = sys->fmt.i_rate * sys->fmt.i_bytes_per_frame * 8;
+        sys->downstream_id = sout_StreamIdAdd(stream->p_next, &out);
+        es_format_Clean(&out);
+        if (sys->downstream_id == NULL)
+            msg_Err(stream, "cannot output the mixed stream");
+    }
+
+    msg_Dbg(stream, "mixing ES %d (%4.4s) with gain %.2f", fmt->i_id,
+            (const char *)&fmt->i_codec, id->input->gain);
+    sys->inputs++;
+    return id;
+
+error:
+    es_format_Clean(&id->decoder_out);
+    free(id);
+    return NULL;
+}
+
+static void Drain(sout_stream_t *stream, sout_stream_id_sys_t *id)
+{
+    sout_stream_sys_t *sys = stream->p_sys;
+    block_t *block = aout_FiltersDrain(id->filters);
+
+    if (block != NULL)
+    {
+        amix_Queue(&sys->mixer, id->input, (const float *)block->p_buffer,
+                   block->i_nb_samples, block->i_pts);
+        block_Release(block);
+    }
+}
+
+/* Converts decoded frames to the mixed format */
+static block_t *Convert(sout_stream_t *stream, sout_stream_id_sys_t *id,
+                        block_t *block)
+{
+    sout_stream_sys_t *sys = stream->p_sys;
+    audio_format_t fmt;
+
+    vlc_mutex_lock(&id->lock);
+    fmt = id->decoder_out.audio;
+    vlc_mutex_unlock(&id->lock);
+
+    if (id->filters == NULL || !AOUT_FMTS_IDENTICAL(&fmt, &id->filters_in))
+    {
+        if (id->filters != NULL)
+        {
+            Drain(stream, id);
+            aout_FiltersDelete(stream, id->filters);
+        }
+
+        var_Create(stream, "audio-time-stretch", VLC_VAR_BOOL);
+        var_Create(stream, "audio-filter", VLC_VAR_STRING);
+        id->filters = aout_FiltersNew(stream, &fmt, &sys->fmt, NULL);
+        var_Destroy(stream, "audio-filter");
+        var_Destroy(stream, "audio-time-stretch");
+        if (id->filters == NULL)
+        {
+            msg_Err(stream, "cannot convert %4.4s/%uHz to the mixed format",
+                    (const char *)&fmt.i_format, fmt.i_rate);
+            if (block != NULL)
+                block_Release(block);
+            return NULL;
+        }
+        id->filters_in = fmt;
+    }
+
+    return aout_FiltersPlay(id->filters, block, 1.f);
+}
+
+static void Mix(sout_stream_t *stream, sout_stream_id_sys_t *id,
+                block_t *block)
+{
+    sout_stream_sys_t *sys = stream->p_sys;
+
+    while (block != NULL)
+    {
+        block_t *next = block->p_next;
+        block->p_next = NULL;
+
+        block_t *out = Convert(stream, id, block);
+        if (out != NULL)
+        {
+            amix_Queue(&sys->mixer, id->input, (const float *)out->p_buffer,
+                       out->i_nb_samples, out->i_pts);
+            block_Release(out);
+        }
+        block = next;
+    }
+}
+
+static int Decode(sout_stream_t *stream, sout_stream_id_sys_t *id,
+                  block_t *block)
+{
+    int ret = id->decoder->pf_decode(id->decoder, block);
+
+    vlc_mutex_lock(&id->lock);
+    block_t *decoded = id->decoded;
+    id->decoded = NULL;
+    id->decoded_last = &id->decoded;
+    vlc_mutex_unlock(&id->lock);
+
+    Mix(stream, id, decoded);
+    return ret == VLCDEC_SUCCESS ? VLC_SUCCESS : VLC_EGENERIC;
+}
+
+static void Del(sout_stream_t *stream, void *_id)
+{
+    sout_stream_sys_t *sys = stream->p_sys;
+    sout_stream_id_sys_t *id = _id;
+
+    if (id->decoder == NULL)
+    {
+        sout_StreamIdDel(stream->p_next, id->downstream_id);
+        free(id);
+        return;
+    }
+
+    /* Drain the decoder and the converters */
+    Decode(stream, id, NULL);
+    if (id->filters != NULL)
+    {
+        Drain(stream, id);
+        aout_FiltersDelete(stream, id->filters);
+    }
+    decoder_Destroy(id->decoder);
+
+    amix_EndInput(&sys->mixer, id->input);
+    Output(stream, --sys->inputs == 0);
+
+    if (sys->inputs == 0)
+    {
+        msg_Dbg(stream, "%"PRIu64" late, %"PRIu64" overlapping, %"PRIu64
+                " missing frames, %"PRIu64" gap frames, %"PRIu64" restarts",
+                sys->mixer.late, sys->mixer.overlaps, sys->mixer.missing,
+                sys->mixer.gaps, sys->mixer.restarts);
+        if (sys->downstream_id != NULL)
+        {
+            sout_StreamIdDel(stream->p_next, sys->downstream_id);
+            sys->downstream_id = NULL;
+        }
+    }
+
+    es_format_Clean(&id->decoder_out);
+    free(id);
+}
+
+static int Send(sout_stream_t *stream, void *_id, block_t *block)
+{
+    sout_stream_id_sys_t *id = _id;
+
+    if (id->decoder == NULL)
+        return sout_StreamIdSend(stream->p_next, id->downstream_id, block);
+
+    int ret = VLC_SUCCESS;
+    while (block != NULL)
+    {
+        block_t *next = block->p_next;
+        block->p_next = NULL;
+
+        if (Decode(stream, id, block))
+            ret = VLC_EGENERIC;
+        block = next;
+    }
+
+    Output(stream, false);
+    return ret;
+}
+
+static void Flush(sout_stream_t *stream, void *_id)
+{
+    sout_stream_sys_t *sys = stream->p_sys;
+    sout_stream_id_sys_t *id = _id;
+
+    if (id->decoder == NULL)
+    {
+        sout_StreamFlush(stream->p_next, id->downstream_id);
+        return;
+    }
+
+    if (id->decoder->pf_flush != NULL)
+        id->decoder->pf_flush(id->decoder);
+    if (id->filters != NULL)
+        aout_FiltersFlush(id->filters);
+
+    vlc_mutex_lock(&id->lock);
+    block_ChainRelease(id->decoded);
+    id->decoded = NULL;
+    id->decoded_last = &id->decoded;
+    vlc_mutex_unlock(&id->lock);
+
+    /* The mix restarts at the next timestamps of all the inputs */
+    amix_Flush(&sys->mixer);
+    if (sys->downstream_id != NULL)
+        sout_StreamFlush(stream->p_next, sys->downstream_id);
+}
+
+static const struct sout_stream_operations ops = {
+    Add, Del, Send, NULL, Flush,
+};
+
+static const char *const ppsz_sout_options[] = {
+    "rate", "channels", "latency", "gain", "gains", "id", NULL
+};
+
+static int Open(vlc_object_t *obj)
+{
+    sout_stream_t *stream = (sout_stream_t *)obj;
+
+    if (stream->p_next == NULL)
+        return VLC_EGENERIC;
+
+    config_ChainParse(stream, SOUT_CFG_PREFIX, ppsz_sout_options,
+                      stream->p_cfg);
+
+    sout_stream_sys_t *sys = calloc(1, sizeof (*sys));
+    if (unlikely(sys == NULL))
+        return VLC_ENOMEM;
+
+    unsigned rate = var_GetInteger(stream, SOUT_CFG_PREFIX "rate");
+    unsigned channels = var_GetInteger(stream, SOUT_CFG_PREFIX "channels");
+    vlc_tick_t latency =
+        VLC_TICK_FROM_MS(var_GetInteger(stream, SOUT_CFG_PREFIX "latency"));
+
+    if (rate < 8000 || rate > 384000)
+        rate = 48000;
+    if (channels == 0 || channels > 8)
+        channels = 2;
+    if (latency < VLC_TICK_FROM_MS(CHUNK_MS))
+        latency = VLC_TICK_FROM_MS(CHUNK_MS);
+
+    sys->fmt.i_format = VLC_CODEC_FL32;
+    sys->fmt.i_rate = rate;
+    sys->fmt.i_physical_channels = vlc_chan_maps[channels];
+    sys->fmt.i_chan_mode = 0;
+    aout_FormatPrepare(&sys->fmt);
+
+    sys->gain = var_GetFloat(stream, SOUT_CFG_PREFIX "gain");
+    sys->gains = var_GetNonEmptyString(stream, SOUT_CFG_PREFIX "gains");
+    sys->es_id = var_GetInteger(stream, SOUT_CFG_PREFIX "id");
+
+    /* Inputs slightly off the time line are not realigned */
+    amix_Init(&sys->mixer, rate, sys->fmt.i_channels,
+              rate * CHUNK_MS / 1000, latency, VLC_TICK_FROM_MS(CHUNK_MS) / 2);
+
+    msg_Dbg(stream, "mixing to %u Hz, %u channels, %"PRId64" ms latency",
+            rate, sys->fmt.i_channels, MS_FROM_VLC_TICK(latency));
+
+    stream->p_sys = sys;
+    stream->ops = &ops;
+    return VLC_SUCCESS;
+}
+
+static void Close(vlc_object_t *obj)
+{
+    sout_stream_t *stream = (sout_stream_t *)obj;
+    sout_stream_sys_t *sys = stream->p_sys;
+
+    amix_Clean(&sys->mixer);
+    free(sys->gains);
+    free(sys);
+}
+
+#define RATE_TEXT N_("Sample rate")
+#define RATE_LONGTEXT N_("Sample rate of the mixed audio.")
+#define CHANNELS_TEXT N_("Channels")
+#define CHANNELS_LONGTEXT N_("Number of channels of the mixed audio.")
+#define LATENCY_TEXT N_("Latency (ms)")
+#define LATENCY_LONGTEXT N_( \
+    "How long to wait for late audio streams before mixing without them.")
+#define GAIN_TEXT N_("Gain")
+#define GAIN_LONGTEXT N_("Gain of the audio streams.")
+#define GAINS_TEXT N_("Gains per stream")
+#define GAINS_LONGTEXT N_( \
+    "Comma separated list of id=gain, overriding the gain of the audio " \
+    "streams with these ids.")
+#define ID_TEXT N_("Elementary Stream ID")
+#define ID_LONGTEXT N_( \
+    "Identifier of the mixed stream, the one of the first audio stream " \
+    "if negative.")
+
+vlc_module_begin()
+    set_shortname(N_("Audio mixer"))
+    set_description(N_("Mix the audio streams into one"))
+    set_capability("sout filter", 50)
+    add_shortcut("amix")
+    set_category(CAT_SOUT)
+    set_subcategory(SUBCAT_SOUT_STREAM)
+    set_callbacks(Open, Close)
+    add_integer(SOUT_CFG_PREFIX "rate", 48000, RATE_TEXT, RATE_LONGTEXT,
+                false)
+    add_integer_with_range(SOUT_CFG_PREFIX "channels", 2, 1, 8,
+                           CHANNELS_TEXT, CHANNELS_LONGTEXT, false)
+    add_integer(SOUT_CFG_PREFIX "latency", 200, LATENCY_TEXT,
+                LATENCY_LONGTEXT, false)
+    add_float(SOUT_CFG_PREFIX "gain", 1.f, GAIN_TEXT, GAIN_LONGTEXT, false)
+    add_string(SOUT_CFG_PREFIX "gains", NULL, GAINS_TEXT, GAINS_LONGTEXT,
+               false)
+    add_integer(SOUT_CFG_PREFIX "id", -1, ID_TEXT, ID_LONGTEXT, false)
+vlc_module_end()
@@ -0,0 +1,428 @@
+/*****************************************************************************
+ * amix_mixer.c: time aligned mixing of audio inputs
+ *****************************************************************************
+ * Copyright © 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+#include <vlc_cpu.h>
+
+#include "amix_mixer.h"
+
+void amix_Init(amix_mixer_t *mixer, unsigned rate, unsigned channels,
+               unsigned chunk, vlc_tick_t latency, vlc_tick_t tolerance)
+{
+    mixer->rate = rate;
+    mixer->channels = channels;
+    mixer->chunk = chunk;
+    mixer->latency = latency;
+    mixer->tolerance = tolerance;
+    mixer->start = VLC_TICK_INVALID;
+    mixer->mixed = 0;
+    vlc_list_init(&mixer->inputs);
+    mixer->late = mixer->gaps = mixer->overlaps = 0;
+    mixer->missing = mixer->restarts = 0;
+}
+
+void amix_Clean(amix_mixer_t *mixer)
+{
+    amix_input_t *input;
+
+    vlc_list_foreach(input, &mixer->inputs, node)
+        amix_DelInput(mixer, input);
+}
+
+amix_input_t *amix_AddInput(amix_mixer_t *mixer, float gain)
+{
+    amix_input_t *input = malloc(sizeof (*input));
+    if (unlikely(input == NULL))
+        return NULL;
+
+    input->gain = gain;
+    input->buf = NULL;
+    input->size = 0;
+    input->frames = 0;
+    input->pts = VLC_TICK_INVALID;
+    input->base = 0;
+    input->eos = false;
+    vlc_list_append(&input->node, &mixer->inputs);
+    return input;
+}
+
+void amix_DelInput(amix_mixer_t *mixer, amix_input_t *input)
+{
+    VLC_UNUSED(mixer);
+    vlc_list_remove(&input->node);
+    free(input->buf);
+    free(input);
+}
+
+void amix_EndInput(amix_mixer_t *mixer, amix_input_t *input)
+{
+    if (input->frames == 0)
+        amix_DelInput(mixer, input);
+    else
+        input->eos = true;
+}
+
+void amix_Flush(amix_mixer_t *mixer)
+{
+    amix_input_t *input;
+
+    vlc_list_foreach(input, &mixer->inputs, node)
+    {
+        if (input->eos)
+            amix_DelInput(mixer, input);
+        else
+        {
+            input->frames = 0;
+            input->pts = VLC_TICK_INVALID;
+            input->base = 0;
+        }
+    }
+    mixer->start = VLC_TICK_INVALID;
+    mixer->mixed = 0;
+}
+
+/* Time of a queued frame */
+static vlc_tick_t InputTime(const amix_mixer_t *mixer,
+                            const amix_input_t *input, size_t frame)
+{
+    return input->pts + vlc_tick_from_samples(input->base + frame,
+                                              mixer->rate);
+}
+
+static int Reserve(amix_mixer_t *mixer, amix_input_t *input, size_t frames)
+{
+    if (frames <= input->size)
+        return VLC_SUCCESS;
+
+    const size_t size = frames + frames / 2;
+    float *buf = vlc_reallocarray(input->buf, size * mixer->channels,
+                                  sizeof (float));
+    if (unlikely(buf == NULL))
+        return VLC_ENOMEM;
+    input->buf = buf;
+    input->size = size;
+    return VLC_SUCCESS;
+}
+
+/* Drops the first queued frames */
+static void Dequeue(amix_mixer_t *mixer, amix_input_t *input, size_t frames)
+{
+    if (frames >= input->frames)
+        frames = input->frames;
+
+    input->frames -= frames;
+    input->base += frames;
+    memmove(input->buf, input->buf + frames * mixer->channels,
+            input->frames * mixer->channels * sizeof (float));
+}
+
+int amix_Queue(amix_mixer_t *mixer, amix_input_t *input, const float *frames,
+               size_t count, vlc_tick_t pts)
+{
+    const unsigned channels = mixer->channels;
+
+    if (count == 0)
+        return VLC_SUCCESS;
+
+    if (input->pts == VLC_TICK_INVALID)
+    {
+        if (pts == VLC_TICK_INVALID)
+            return VLC_SUCCESS; /* cannot place it */
+        input->pts = pts;
+        input->base = 0;
+    }
+    else if (pts != VLC_TICK_INVALID)
+    {
+        const vlc_tick_t delta = pts - InputTime(mixer, input, input->frames);
+
+        if (delta > mixer->latency || delta < -mixer->latency)
+        {
+            input->frames = 0;
+            input->pts = pts;
+            input->base = 0;
+            mixer->restarts++;
+
+            /* Going back in time restarts the mix too, else the input would
+             * only be late from now on */
+            if (mixer->start != VLC_TICK_INVALID
+             && pts < mixer->start - mixer->latency
+                      + vlc_tick_from_samples(mixer->mixed, mixer->rate))
+                mixer->start = VLC_TICK_INVALID;
+        }
+        else if (delta > mixer->tolerance)
+        {
+            const size_t gap = samples_from_vlc_tick(delta, mixer->rate);
+
+            if (Reserve(mixer, input, input->frames + gap))
+                return VLC_ENOMEM;
+            memset(input->buf + input->frames * channels, 0,
+                   gap * channels * sizeof (float));
+            input->frames += gap;
+            mixer->gaps += gap;
+        }
+        else if (delta < -mixer->tolerance)
+        {
+            size_t overlap = samples_from_vlc_tick(-delta, mixer->rate);
+
+            if (overlap > count)
+                overlap = count;
+            frames += overlap * channels;
+            count -= overlap;
+            mixer->overlaps += overlap;
+        }
+    }
+
+    if (Reserve(mixer, input, input->frames + count))
+        return VLC_ENOMEM;
+    memcpy(input->buf + input->frames * channels, frames,
+           count * channels * sizeof (float));
+    input->frames += count;
+    return VLC_SUCCESS;
+}
+
+/* Starts the mix at the earliest input */
+static bool Start(amix_mixer_t *mixer, bool drain)
+{
+    vlc_tick_t first = VLC_TICK_INVALID, last = VLC_TICK_INVALID;
+    bool all = true;
+    amix_input_t *input;
+
+    vlc_list_foreach(input, &mixer->inputs, node)
+    {
+        if (input->frames == 0)
+        {
+            all = false;
+            continue;
+        }
+
+        const vlc_tick_t begin = InputTime(mixer, input, 0);
+        const vlc_tick_t end = InputTime(mixer, input, input->frames);
+
+        if (first == VLC_TICK_INVALID || begin < first)
+            first = begin;
+        if (last == VLC_TICK_INVALID || end > last)
+            last = end;
+    }
+
+    if (first == VLC_TICK_INVALID)
+        return false;
+    if (!all && !drain && last - first < mixer->latency)
+        return false;
+
+    mixer->start = first;
+    mixer->mixed = 0;
+    return true;
+}
+
+block_t *amix_Mix(amix_mixer_t *mixer, bool drain)
+{
+    const unsigned channels = mixer->channels;
+    amix_input_t *input;
+
+    if (mixer->start == VLC_TICK_INVALID && !Start(mixer, drain))
+        return NULL;
+
+    const vlc_tick_t begin = mixer->start
+        + vlc_tick_from_samples(mixer->mixed, mixer->rate);
+    const vlc_tick_t end = mixer->start
+        + vlc_tick_from_samples(mixer->mixed + mixer->chunk, mixer->rate);
+    vlc_tick_t last = VLC_TICK_INVALID;
+    bool ready = true, any = false;
+
+    vlc_list_foreach(input, &mixer->inputs, node)
+    {
+        /* Drop what comes too late */
+        if (input->frames > 0 && InputTime(mixer, input, 0) < begin)
+        {
+            size_t late = samples_from_vlc_tick(
+                begin - InputTime(mixer, input, 0), mixer->rate);
+
+            if (late > input->frames)
+                late = input->frames;
+            Dequeue(mixer, input, late);
+            mixer->late += late;
+        }
+
+        if (input->frames == 0)
+        {
+            if (input->eos)
+                amix_DelInput(mixer, input);
+            else
+                ready = false;
+            continue;
+        }
+
+        const vlc_tick_t input_end = InputTime(mixer, input, input->frames);
+        if (input_end < end && !input->eos)
+            ready = false;
+        if (last == VLC_TICK_INVALID || input_end > last)
+            last = input_end;
+        any = true;
+    }
+
+    if (!any)
+        return NULL;
+    /* Wait for the lagging inputs, but not beyond the latency */
+    if (!ready && !drain && last - end < mixer->latency)
+        return NULL;
+
+    block_t *out = block_Alloc(mixer->chunk * channels * sizeof (float));
+    if (unlikely(out == NULL))
+        return NULL;
+
+    float *dst = (float *)out->p_buffer;
+    memset(dst, 0, out->i_buffer);
+
+    vlc_list_foreach(input, &mixer->inputs, node)
+    {
+        size_t offset = 0, count = 0;
+
+        if (input->frames > 0)
+        {
+            offset = samples_from_vlc_tick(InputTime(mixer, input, 0) - begin,
+                                           mixer->rate);
+            if (offset < mixer->chunk)
+            {
+                count = mixer->chunk - offset;
+                if (count > input->frames)
+                    count = input->frames;
+                amix_Accumulate(dst + offset * channels, input->buf,
+                                input->gain, count * channels);
+                Dequeue(mixer, input, count);
+            }
+        }
+
+        if (!input->eos && offset + count < mixer->chunk
+         && (input->frames == 0
+          || InputTime(mixer, input, 0) < end))
+            mixer->missing += mixer->chunk - offset - count;
+
+        if (input->eos && input->frames == 0)
+            amix_DelInput(mixer, input);
+    }
+
+    out->i_nb_samples = mixer->chunk;
+    out->i_pts = out->i_dts = begin;
+    out->i_length = end - begin;
+    mixer->mixed += mixer->chunk;
+    return out;
+}
+
+void amix_Accumulate_C(float *dst, const float *src, float gain, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+        dst[i] += gain * src[i];
+}
+
+#ifdef HAVE_SSE2_INTRINSICS
+# include <emmintrin.h>
+
+__attribute__ ((__target__ ("sse2")))
+static void AccumulateSSE2(float *dst, const float *src, float gain, size_t n)
+{
+    const __m128 g = _mm_set1_ps(gain);
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8)
+    {
+        __m128 a = _mm_loadu_ps(dst + i), b = _mm_loadu_ps(dst + i + 4);
+
+        a = _mm_add_ps(a, _mm_mul_ps(g, _mm_loadu_ps(src + i)));
+        b = _mm_add_ps(b, _mm_mul_ps(g, _mm_loadu_ps(src + i + 4)));
+        _mm_storeu_ps(dst + i, a);
+        _mm_storeu_ps(dst + i + 4, b);
+    }
+    amix_Accumulate_C(dst + i, src + i, gain, n - i);
+}
+#endif
+
+#ifdef HAVE_AVX2_INTRINSICS
+# include <immintrin.h>
+
+__attribute__ ((__target__ ("avx2")))
+static void AccumulateAVX2(float *dst, const float *src, float gain, size_t n)
+{
+    const __m256 g = _mm256_set1_ps(gain);
+    size_t i = 0;
+
+    for (; i + 16 <= n; i += 16)
+    {
+        __m256 a = _mm256_loadu_ps(dst + i), b = _mm256_loadu_ps(dst + i + 8);
+
+        a = _mm256_add_ps(a, _mm256_mul_ps(g, _mm256_loadu_ps(src + i)));
+        b = _mm256_add_ps(b, _mm256_mul_ps(g, _mm256_loadu_ps(src + i + 8)));
+        _mm256_storeu_ps(dst + i, a);
+        _mm256_storeu_ps(dst + i + 8, b);
+    }
+    amix_Accumulate_C(dst + i, src + i, gain, n - i);
+}
+#endif
+
+#ifdef __ARM_NEON
+# include <arm_neon.h>
+
+static void AccumulateNEON(float *dst, const float *src, float gain, size_t n)
+{
+    const float32x4_t g = vdupq_n_f32(gain);
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8)
+    {
+        float32x4_t a = vld1q_f32(dst + i), b = vld1q_f32(dst + i + 4);
+
+        a = vmlaq_f32(a, g, vld1q_f32(src + i));
+        b = vmlaq_f32(b, g, vld1q_f32(src + i + 4));
+        vst1q_f32(dst + i, a);
+        vst1q_f32(dst + i + 4, b);
+    }
+    amix_Accumulate_C(dst + i, src + i, gain, n - i);
+}
+#endif
+
+void amix_Accumulate(float *dst, const float *src, float gain, size_t n)
+{
+#ifdef HAVE_AVX2_INTRINSICS
+    if (vlc_CPU_AVX2())
+    {
+        AccumulateAVX2(dst, src, gain, n);
+        return;
+    }
+#endif
+#ifdef HAVE_SSE2_INTRINSICS
+    if (vlc_CPU_SSE2())
+    {
+        AccumulateSSE2(dst, src, gain, n);
+        return;
+    }
+#endif
+#ifdef __ARM_NEON
+    if (vlc_CPU_ARM_NEON())
+    {
+        AccumulateNEON(dst, src, gain, n);
+        return;
+    }
+#endif
+    amix_Accumulate_C(dst, src, gain, n);
+}
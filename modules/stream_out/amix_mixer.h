@@ -0,0 +1,115 @@
+/*****************************************************************************
+ * amix_mixer.h: time aligned mixing of audio inputs
+ *****************************************************************************
+ * Copyright © 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_AMIX_MIXER_H
+#define VLC_AMIX_MIXER_H 1
+
+#include <vlc_list.h>
+
+/**
+ * Queue of interleaved float frames of one input, starting at a given time.
+ */
+typedef struct
+{
+    float gain;
+    float *buf;
+    size_t size;        /**< allocated frames */
+    size_t frames;      /**< queued frames */
+    vlc_tick_t pts;     /**< time of the frame at base, or VLC_TICK_INVALID */
+    size_t base;        /**< frames dequeued since pts */
+    bool eos;           /**< no more frames will be queued */
+    struct vlc_list node;
+} amix_input_t;
+
+typedef struct
+{
+    unsigned rate;
+    unsigned channels;
+    unsigned chunk;         /**< frames per mixed block */
+    vlc_tick_t latency;     /**< how long to wait for late inputs */
+    vlc_tick_t tolerance;   /**< timestamp jitter absorbed by the inputs */
+
+    vlc_tick_t start;       /**< time of the first mixed frame */
+    uint64_t mixed;         /**< mixed frames since start */
+    struct vlc_list inputs;
+
+    /* Statistics, in frames */
+    uint64_t late;          /**< dropped as they came after being mixed */
+    uint64_t gaps;          /**< silence inserted in timestamp gaps */
+    uint64_t overlaps;      /**< dropped as they overlapped previous ones */
+    uint64_t missing;       /**< mixed as silence as their input lagged */
+    uint64_t restarts;      /**< timestamp discontinuities beyond latency */
+} amix_mixer_t;
+
+void amix_Init(amix_mixer_t *, unsigned rate, unsigned channels,
+               unsigned chunk, vlc_tick_t latency, vlc_tick_t tolerance);
+void amix_Clean(amix_mixer_t *);
+
+amix_input_t *amix_AddInput(amix_mixer_t *, float gain);
+
+/**
+ * Removes an input, whether its frames were mixed or not.
+ */
+void amix_DelInput(amix_mixer_t *, amix_input_t *);
+
+/**
+ * Ends an input: it does not hold the mix back anymore, and it is removed
+ * once its queued frames are mixed.
+ */
+void amix_EndInput(amix_mixer_t *, amix_input_t *);
+
+/**
+ * Drops all the queued frames and restarts the mix at the next frames.
+ */
+void amix_Flush(amix_mixer_t *);
+
+/**
+ * Queues frames of an input.
+ *
+ * Frames following the queued ones within the tolerance are appended as
+ * is. Gaps are filled with silence and overlapping frames are dropped.
+ * Beyond the latency, the queued frames are dropped and the input restarts
+ * at the new timestamp.
+ */
+int amix_Queue(amix_mixer_t *, amix_input_t *, const float *frames,
+               size_t count, vlc_tick_t pts);
+
+/**
+ * Mixes the next chunk of frames.
+ *
+ * A chunk is mixed once all the inputs have queued it, or once an input
+ * is ahead of it by the latency, or, when draining, once any input has
+ * frames in it. Inputs without frames for the chunk are silent.
+ *
+ * \return a block of chunk frames, or NULL if none is ready
+ */
+block_t *amix_Mix(amix_mixer_t *, bool drain);
+
+/**
+ * Adds gain * src to dst.
+ */
+void amix_Accumulate_C(float *dst, const float *src, float gain, size_t n);
+
+/**
+ * Same as amix_Accumulate_C(), vectorized.
+ */
+void amix_Accumulate(float *dst, const float *src, float gain, size_t n);
+
+#endif
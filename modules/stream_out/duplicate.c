@@ -28,6 +28,8 @@
 # include "config.h"
 #endif
 
+#include <stdatomic.h>
+
 #include <vlc_common.h>
 #include <vlc_plugin.h>
 #include <vlc_sout.h>
@@ -62,19 +64,58 @@ static int   Send( sout_stream_t *, void *, block_t * );
 
 typedef struct
 {
-    int             i_nb_streams;
-    sout_stream_t   **pp_streams;
+    sout_stream_t   *p_stream;
+    char            *psz_select;
+    bool            b_share; /* the chain does not write into the blocks */
+
+    atomic_uintmax_t blocks;
+    atomic_uintmax_t bytes;
+    atomic_uintmax_t copies;
+    atomic_uintmax_t dropped;
+} duplicate_branch_t;
 
-    int             i_nb_select;
-    char            **ppsz_select;
+typedef struct
+{
+    int             i_nb_streams;
+    duplicate_branch_t **pp_branches;
 } sout_stream_sys_t;
 
+typedef struct
+{
+    duplicate_branch_t *p_branch;
+    void               *id;
+} duplicate_route_t;
+
 typedef struct
 {
     int                 i_nb_ids;
     void                **pp_ids;
+
+    /* The branches which the ES is sent to, the ones which get copies
+     * first */
+    duplicate_route_t   *p_routes;
+    unsigned            i_routes;
+    unsigned            i_copy_routes;
 } sout_stream_id_sys_t;
 
+/* The data of a block shared by several branches: each branch gets its own
+ * block_t, whose buffer is the one of the original block, released with the
+ * last of them. Growing such a block copies it. */
+typedef struct duplicate_payload_t duplicate_payload_t;
+
+typedef struct
+{
+    block_t             self;
+    duplicate_payload_t *p_payload;
+} duplicate_view_t;
+
+struct duplicate_payload_t
+{
+    atomic_uint         refs;
+    block_t             *p_block;
+    duplicate_view_t    views[];
+};
+
 static bool ESSelected( struct vlc_logger *, const es_format_t *fmt,
                         char *psz_select );
 
@@ -95,11 +136,32 @@ static int Control( sout_stream_t *p_stream, int i_query, va_list args )
             for( int i = 0; i < id->i_nb_ids; i++ )
             {
                 if( id->pp_ids[i] )
-                    sout_StreamControl( p_sys->pp_streams[i], i_query,
-                                        id->pp_ids[i], spu_hl );
+                    sout_StreamControl( p_sys->pp_branches[i]->p_stream,
+                                        i_query, id->pp_ids[i], spu_hl );
             }
             return VLC_SUCCESS;
         }
+
+        case SOUT_STREAM_GET_BRANCH_STATS:
+        {
+            unsigned i_branch = va_arg( args, unsigned );
+            struct sout_stream_branch_stats *stats =
+                va_arg( args, struct sout_stream_branch_stats * );
+
+            if( i_branch >= (unsigned)p_sys->i_nb_streams )
+                return VLC_EGENERIC;
+
+            duplicate_branch_t *p_branch = p_sys->pp_branches[i_branch];
+            stats->blocks = atomic_load_explicit( &p_branch->blocks,
+                                                  memory_order_relaxed );
+            stats->bytes = atomic_load_explicit( &p_branch->bytes,
+                                                 memory_order_relaxed );
+            stats->copies = atomic_load_explicit( &p_branch->copies,
+                                                  memory_order_relaxed );
+            stats->dropped = atomic_load_explicit( &p_branch->dropped,
+                                                   memory_order_relaxed );
+            return VLC_SUCCESS;
+        }
     }
 
     return VLC_EGENERIC;
@@ -124,10 +186,10 @@ static int Open( vlc_object_t *p_this )
     if( !p_sys )
         return VLC_ENOMEM;
 
-    TAB_INIT( p_sys->i_nb_streams, p_sys->pp_streams );
-    TAB_INIT( p_sys->i_nb_select, p_sys->ppsz_select );
+    TAB_INIT( p_sys->i_nb_streams, p_sys->pp_branches );
 
     char **ppsz_select = NULL;
+    duplicate_branch_t *p_last = NULL;
 
     for( p_cfg = p_stream->p_cfg; p_cfg != NULL; p_cfg = p_cfg->p_next )
     {
@@ -141,10 +203,26 @@ static int Open( vlc_object_t *p_this )
 
             if( s )
             {
-                TAB_APPEND( p_sys->i_nb_streams, p_sys->pp_streams, s );
-                TAB_APPEND( p_sys->i_nb_select,  p_sys->ppsz_select, NULL );
-                ppsz_select = &p_sys->ppsz_select[p_sys->i_nb_select - 1];
+                duplicate_branch_t *p_branch = malloc( sizeof( *p_branch ) );
+                if( unlikely(p_branch == NULL) )
+                {
+                    sout_StreamChainDelete( s, p_stream->p_next );
+                    continue;
+                }
+                p_branch->p_stream = s;
+                p_branch->psz_select = NULL;
+                p_branch->b_share = false;
+                atomic_init( &p_branch->blocks, 0 );
+                atomic_init( &p_branch->bytes, 0 );
+                atomic_init( &p_branch->copies, 0 );
+                atomic_init( &p_branch->dropped, 0 );
+
+                TAB_APPEND( p_sys->i_nb_streams, p_sys->pp_branches, p_branch );
+                ppsz_select = &p_branch->psz_select;
+                p_last = p_branch;
             }
+            else
+                p_last = NULL;
         }
         else if( !strncmp( p_cfg->psz_name, "select", strlen( "select" ) ) )
         {
@@ -164,6 +242,18 @@ static int Open( vlc_object_t *p_this )
                 }
             }
         }
+        else if( !strcmp( p_cfg->psz_name, "share" ) )
+        {
+            /* The previous destination leaves the data of its blocks
+             * untouched, unlike muxers converting them in place */
+            if( p_last == NULL )
+                msg_Err( p_stream, " * ignore share" );
+            else
+            {
+                msg_Dbg( p_stream, " * share the blocks" );
+                p_last->b_share = true;
+            }
+        }
         else
         {
             msg_Err( p_stream, " * ignore unknown option `%s'", p_cfg->psz_name );
@@ -194,11 +284,23 @@ static void Close( vlc_object_t * p_this )
     msg_Dbg( p_stream, "closing a duplication" );
     for( int i = 0; i < p_sys->i_nb_streams; i++ )
     {
-        sout_StreamChainDelete(p_sys->pp_streams[i], p_stream->p_next);
-        free( p_sys->ppsz_select[i] );
+        duplicate_branch_t *p_branch = p_sys->pp_branches[i];
+
+        msg_Dbg( p_stream, "output %d: %ju blocks, %ju bytes, %ju copied, "
+                 "%ju dropped", i,
+                 atomic_load_explicit( &p_branch->blocks,
+                                       memory_order_relaxed ),
+                 atomic_load_explicit( &p_branch->bytes,
+                                       memory_order_relaxed ),
+                 atomic_load_explicit( &p_branch->copies,
+                                       memory_order_relaxed ),
+                 atomic_load_explicit( &p_branch->dropped,
+                                       memory_order_relaxed ) );
+        sout_StreamChainDelete(p_branch->p_stream, p_stream->p_next);
+        free( p_branch->psz_select );
+        free( p_branch );
     }
-    free( p_sys->pp_streams );
-    free( p_sys->ppsz_select );
+    free( p_sys->pp_branches );
 
     free( p_sys );
 }
@@ -217,6 +319,8 @@ static void *Add( sout_stream_t *p_stream, const es_format_t *p_fmt )
         return NULL;
 
     TAB_INIT( id->i_nb_ids, id->pp_ids );
+    id->p_routes = NULL;
+    id->i_routes = id->i_copy_routes = 0;
 
     msg_Dbg( p_stream, "duplicated a new stream codec=%4.4s (es=%d group=%d)",
              (char*)&p_fmt->i_codec, p_fmt->i_id, p_fmt->i_group );
@@ -226,9 +330,9 @@ static void *Add( sout_stream_t *p_stream, const es_format_t *p_fmt )
         void *id_new = NULL;
 
         if( ESSelected( p_stream->obj.logger, p_fmt,
-                        p_sys->ppsz_select[i_stream] ) )
+                        p_sys->pp_branches[i_stream]->psz_select ) )
         {
-            sout_stream_t *out = p_sys->pp_streams[i_stream];
+            sout_stream_t *out = p_sys->pp_branches[i_stream]->p_stream;
 
             id_new = (void*)sout_StreamIdAdd( out, p_fmt );
             if( id_new )
@@ -257,6 +361,28 @@ static void *Add( sout_stream_t *p_stream, const es_format_t *p_fmt )
         return NULL;
     }
 
+    /* Route the blocks of the ES only to the branches which took it */
+    id->p_routes = vlc_alloc( i_valid_streams, sizeof( *id->p_routes ) );
+    if( unlikely(id->p_routes == NULL) )
+    {
+        Del( p_stream, id );
+        return NULL;
+    }
+    for( int pass = 0; pass < 2; pass++ )
+        for( i_stream = 0; i_stream < p_sys->i_nb_streams; i_stream++ )
+        {
+            duplicate_branch_t *p_branch = p_sys->pp_branches[i_stream];
+
+            if( id->pp_ids[i_stream] == NULL
+             || p_branch->b_share != (pass == 1) )
+                continue;
+            id->p_routes[id->i_routes].p_branch = p_branch;
+            id->p_routes[id->i_routes].id = id->pp_ids[i_stream];
+            id->i_routes++;
+            if( !p_branch->b_share )
+                id->i_copy_routes++;
+        }
+
     return id;
 }
 
@@ -273,11 +399,12 @@ static void Del( sout_stream_t *p_stream, void *_id )
     {
         if( id->pp_ids[i_stream] )
         {
-            sout_stream_t *out = p_sys->pp_streams[i_stream];
+            sout_stream_t *out = p_sys->pp_branches[i_stream]->p_stream;
             sout_StreamIdDel( out, id->pp_ids[i_stream] );
         }
     }
 
+    free( id->p_routes );
     free( id->pp_ids );
     free( id );
 }
@@ -285,42 +412,116 @@ static void Del( sout_stream_t *p_stream, void *_id )
 /*****************************************************************************
  * Send:
  *****************************************************************************/
+static void ViewRelease( block_t *p_block )
+{
+    duplicate_view_t *p_view = container_of( p_block, duplicate_view_t, self );
+    duplicate_payload_t *p_payload = p_view->p_payload;
+
+    if( atomic_fetch_sub_explicit( &p_payload->refs, 1,
+                                   memory_order_acq_rel ) == 1 )
+    {
+        block_Release( p_payload->p_block );
+        free( p_payload );
+    }
+}
+
+static const struct vlc_block_callbacks view_cbs =
+{
+    ViewRelease,
+};
+
+/* Shares the data of a block between count blocks */
+static duplicate_payload_t *PayloadNew( block_t *p_block, unsigned i_count )
+{
+    duplicate_payload_t *p_payload =
+        malloc( sizeof( *p_payload ) + i_count * sizeof( duplicate_view_t ) );
+    if( unlikely(p_payload == NULL) )
+        return NULL;
+
+    atomic_init( &p_payload->refs, i_count );
+    p_payload->p_block = p_block;
+    for( unsigned i = 0; i < i_count; i++ )
+    {
+        block_t *p_view = &p_payload->views[i].self;
+
+        p_payload->views[i].p_payload = p_payload;
+        block_Init( p_view, &view_cbs, p_block->p_buffer, p_block->i_buffer );
+        block_CopyProperties( p_view, p_block );
+    }
+    return p_payload;
+}
+
+static void SendRoute( const duplicate_route_t *p_route, block_t *p_block,
+                       bool b_copied )
+{
+    duplicate_branch_t *p_branch = p_route->p_branch;
+
+    if( unlikely(p_block == NULL) )
+    {
+        atomic_fetch_add_explicit( &p_branch->dropped, 1,
+                                   memory_order_relaxed );
+        return;
+    }
+
+    const size_t i_size = p_block->i_buffer;
+    if( b_copied )
+        atomic_fetch_add_explicit( &p_branch->copies, 1,
+                                   memory_order_relaxed );
+    if( sout_StreamIdSend( p_branch->p_stream, p_route->id, p_block ) )
+        atomic_fetch_add_explicit( &p_branch->dropped, 1,
+                                   memory_order_relaxed );
+    else
+    {
+        atomic_fetch_add_explicit( &p_branch->blocks, 1,
+                                   memory_order_relaxed );
+        atomic_fetch_add_explicit( &p_branch->bytes, i_size,
+                                   memory_order_relaxed );
+    }
+}
+
 static int Send( sout_stream_t *p_stream, void *_id, block_t *p_buffer )
 {
-    sout_stream_sys_t *p_sys = p_stream->p_sys;
     sout_stream_id_sys_t *id = (sout_stream_id_sys_t *)_id;
-    sout_stream_t     *p_dup_stream;
-    int               i_stream;
+    const unsigned i_shared = id->i_routes - id->i_copy_routes;
+    VLC_UNUSED(p_stream);
 
     /* Loop through the linked list of buffers */
     while( p_buffer )
     {
         block_t *p_next = p_buffer->p_next;
+        unsigned i_route = 0;
 
         p_buffer->p_next = NULL;
 
-        for( i_stream = 0; i_stream < p_sys->i_nb_streams - 1; i_stream++ )
+        /* The branches which may write into their blocks get copies */
+        for( ; i_route < id->i_copy_routes; i_route++ )
         {
-            p_dup_stream = p_sys->pp_streams[i_stream];
-
-            if( id->pp_ids[i_stream] )
-            {
-                block_t *p_dup = block_Duplicate( p_buffer );
-
-                if( p_dup )
-                    sout_StreamIdSend( p_dup_stream, id->pp_ids[i_stream], p_dup );
-            }
+            if( i_route == id->i_routes - 1 )
+                SendRoute( &id->p_routes[i_route], p_buffer, false );
+            else
+                SendRoute( &id->p_routes[i_route],
+                           block_Duplicate( p_buffer ), true );
         }
 
-        if( i_stream < p_sys->i_nb_streams && id->pp_ids[i_stream] )
-        {
-            p_dup_stream = p_sys->pp_streams[i_stream];
-            sout_StreamIdSend( p_dup_stream, id->pp_ids[i_stream], p_buffer );
-        }
-        else
+        /* The ones given the share option share the data of the block */
+        if( i_shared > 1 )
         {
-            block_Release( p_buffer );
+            duplicate_payload_t *p_payload = PayloadNew( p_buffer, i_shared );
+
+            for( unsigned i = 0; i < i_shared; i++, i_route++ )
+            {
+                if( p_payload != NULL )
+                    SendRoute( &id->p_routes[i_route],
+                               &p_payload->views[i].self, false );
+                else if( i < i_shared - 1 )
+                    SendRoute( &id->p_routes[i_route],
+                               block_Duplicate( p_buffer ), true );
+                else
+                    SendRoute( &id->p_routes[i_route], p_buffer, false );
+            }
         }
+        else if( i_shared == 1 )
+            SendRoute( &id->p_routes[i_route], p_buffer, false );
 
         p_buffer = p_next;
     }
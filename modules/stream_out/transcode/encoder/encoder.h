@@ -45,6 +45,11 @@ typedef struct
                 int          i_priority;
                 uint32_t     pool_size;
             } threads;
+            struct
+            {
+                unsigned int i_count; /* concurrent encoders, 0 if disabled */
+                unsigned int i_frames; /* pictures per chunk */
+            } chunks;
         } video;
         struct
         {
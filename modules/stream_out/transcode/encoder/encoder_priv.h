@@ -31,6 +31,24 @@ struct transcode_encoder_t
     /* output buffers */
     block_t         *p_buffers;
     bool b_threaded;
+
+    /* chunked encoding, protected by lock_out */
+    struct
+    {
+        vlc_thread_t    *p_threads;
+        unsigned         i_threads;
+        unsigned         i_frames;
+        const transcode_encoder_config_t *p_cfg;
+        es_format_t      fmt_out; /* requested output, before any opening */
+        struct transcode_chunk_t *p_first, **pp_last; /* in timeline order */
+        struct transcode_chunk_t *p_current; /* being filled */
+        unsigned         i_count;
+        unsigned         i_pushed;
+        unsigned         i_done;
+        vlc_cond_t       wait;
+        vlc_tick_t       i_last_dts;
+        vlc_tick_t       i_delay; /* of the dates of the chunks */
+    } chunks;
 };
 
 int transcode_encoder_audio_open( transcode_encoder_t *p_enc,
@@ -403,6 +403,331 @@ static void* EncoderThread( void *obj )
     return NULL;
 }
 
+/*
+ * Chunked encoding
+ *
+ * For non-live inputs, the pictures are split into chunks of a fixed number
+ * of pictures, which are encoded concurrently by instances of the encoder
+ * opened anew for each chunk. A chunk thus starts with a keyframe and never
+ * references the pictures of another chunk, like a closed GOP, so that the
+ * chunks can simply be output one after the other, in the timeline order.
+ */
+enum
+{
+    CHUNK_FILLING,
+    CHUNK_QUEUED,
+    CHUNK_ENCODING,
+    CHUNK_DONE,
+};
+
+typedef struct transcode_chunk_t
+{
+    struct transcode_chunk_t *p_next;
+    int                 i_state;
+    bool                b_primary; /* encoded by the opened encoder */
+    unsigned            i_pictures;
+    vlc_picture_chain_t pics;
+    block_t            *p_out;
+} transcode_chunk_t;
+
+struct chunk_encoder
+{
+    encoder_t enc;
+    encoder_t *p_parent;
+};
+
+static vlc_decoder_device *chunk_get_encoder_device( encoder_t *p_encoder )
+{
+    struct chunk_encoder *p_owner =
+        container_of( p_encoder, struct chunk_encoder, enc );
+    encoder_t *p_parent = p_owner->p_parent;
+
+    return p_parent->cbs->video.get_device( p_parent );
+}
+
+static const struct encoder_owner_callbacks chunk_encoder_cbs = {
+    { chunk_get_encoder_device, }
+};
+
+static void ChunkEncode( transcode_encoder_t *p_enc, transcode_chunk_t *p_chunk )
+{
+    const transcode_encoder_config_t *p_cfg = p_enc->chunks.p_cfg;
+    encoder_t *p_parent = p_enc->p_encoder;
+    struct chunk_encoder *p_owner = NULL;
+    encoder_t *p_encoder = NULL;
+    picture_t *p_pic;
+
+    /* The first chunk is encoded by the encoder opened for the muxer, which
+     * is not used otherwise */
+    if( p_chunk->b_primary )
+        p_encoder = p_parent;
+    else
+        p_owner = (struct chunk_encoder *)
+            sout_EncoderCreate( p_parent, sizeof(struct chunk_encoder) );
+
+    if( p_owner != NULL )
+    {
+        p_encoder = &p_owner->enc;
+        p_owner->p_parent = p_parent;
+        if( p_parent->cbs != NULL )
+            p_encoder->cbs = &chunk_encoder_cbs;
+        /* The parent encoder was opened with the same formats */
+        es_format_Copy( &p_encoder->fmt_in, &p_parent->fmt_in );
+        es_format_Copy( &p_encoder->fmt_out, &p_enc->chunks.fmt_out );
+        p_encoder->vctx_in = p_parent->vctx_in;
+        p_encoder->i_threads = p_cfg->video.threads.i_count;
+        p_encoder->p_cfg = p_cfg->p_config_chain;
+        p_encoder->p_module =
+            module_need( p_encoder, "encoder", p_cfg->psz_name, true );
+    }
+
+    if( p_encoder == NULL || p_encoder->p_module == NULL )
+    {
+        msg_Err( p_parent, "cannot open the encoder of a chunk, "
+                 "dropping %u pictures", p_chunk->i_pictures );
+        while( (p_pic = vlc_picture_chain_PopFront( &p_chunk->pics )) != NULL )
+            picture_Release( p_pic );
+    }
+    else
+    {
+        while( (p_pic = vlc_picture_chain_PopFront( &p_chunk->pics )) != NULL )
+        {
+            block_ChainAppend( &p_chunk->p_out,
+                               p_encoder->pf_encode_video( p_encoder, p_pic ) );
+            picture_Release( p_pic );
+        }
+
+        block_t *p_block;
+        while( (p_block = p_encoder->pf_encode_video( p_encoder, NULL )) != NULL )
+            block_ChainAppend( &p_chunk->p_out, p_block );
+
+        /* The opened encoder is closed with the transcode encoder */
+        if( p_owner != NULL )
+            module_unneed( p_encoder, p_encoder->p_module );
+    }
+
+    if( p_owner != NULL )
+    {
+        es_format_Clean( &p_encoder->fmt_in );
+        es_format_Clean( &p_encoder->fmt_out );
+        vlc_object_delete( p_encoder );
+    }
+}
+
+/* Outputs the encoded chunks in order, with the lock held */
+static void ChunksCollect( transcode_encoder_t *p_enc )
+{
+    transcode_chunk_t *p_chunk;
+
+    while( (p_chunk = p_enc->chunks.p_first) != NULL &&
+           p_chunk->i_state == CHUNK_DONE )
+    {
+        p_enc->chunks.p_first = p_chunk->p_next;
+        if( p_enc->chunks.p_first == NULL )
+            p_enc->chunks.pp_last = &p_enc->chunks.p_first;
+        p_enc->chunks.i_count--;
+        p_enc->chunks.i_done++;
+
+        /* The reordering delay at the start of a chunk may make its first
+         * decoding dates overlap the end of the previous chunk. This chunk
+         * and the next ones are then delayed, presentation dates included,
+         * so that the decoding dates keep their spacing, follow the previous
+         * chunk by one frame period and never pass the presentation ones.
+         * The delay only grows up to the reordering delay of the encoder. */
+        const video_format_t *p_vfmt = &p_enc->p_encoder->fmt_in.video;
+        const vlc_tick_t i_period =
+            vlc_tick_from_samples( p_vfmt->i_frame_rate_base,
+                                   p_vfmt->i_frame_rate );
+
+        for( block_t *p_block = p_chunk->p_out; p_block; p_block = p_block->p_next )
+        {
+            if( p_block->i_dts == VLC_TICK_INVALID )
+                continue;
+
+            const vlc_tick_t i_dts = p_block->i_dts + p_enc->chunks.i_delay;
+            if( p_enc->chunks.i_last_dts != VLC_TICK_INVALID &&
+                i_dts < p_enc->chunks.i_last_dts + i_period )
+                p_enc->chunks.i_delay += p_enc->chunks.i_last_dts + i_period
+                                       - i_dts;
+            break;
+        }
+
+        for( block_t *p_block = p_chunk->p_out; p_block; p_block = p_block->p_next )
+        {
+            if( p_block->i_pts != VLC_TICK_INVALID )
+                p_block->i_pts += p_enc->chunks.i_delay;
+            if( p_block->i_dts == VLC_TICK_INVALID )
+                continue;
+            p_block->i_dts += p_enc->chunks.i_delay;
+            p_enc->chunks.i_last_dts = p_block->i_dts;
+        }
+
+        block_ChainAppend( &p_enc->p_buffers, p_chunk->p_out );
+        free( p_chunk );
+    }
+}
+
+static void* ChunkThread( void *obj )
+{
+    transcode_encoder_t *p_enc = obj;
+
+    vlc_mutex_lock( &p_enc->lock_out );
+    for( ;; )
+    {
+        transcode_chunk_t *p_chunk = p_enc->chunks.p_first;
+
+        while( p_chunk != NULL && p_chunk->i_state != CHUNK_QUEUED )
+            p_chunk = p_chunk->p_next;
+
+        if( p_chunk == NULL )
+        {
+            /* Encode what was queued before stopping */
+            if( p_enc->b_abort )
+                break;
+            vlc_cond_wait( &p_enc->cond, &p_enc->lock_out );
+            continue;
+        }
+
+        p_chunk->i_state = CHUNK_ENCODING;
+        vlc_mutex_unlock( &p_enc->lock_out );
+        ChunkEncode( p_enc, p_chunk );
+        vlc_mutex_lock( &p_enc->lock_out );
+        p_chunk->i_state = CHUNK_DONE;
+        ChunksCollect( p_enc );
+        vlc_cond_signal( &p_enc->chunks.wait );
+    }
+    vlc_mutex_unlock( &p_enc->lock_out );
+
+    return NULL;
+}
+
+/* Hands the chunk being filled to the encoders, with the lock held */
+static void ChunkQueue( transcode_encoder_t *p_enc )
+{
+    transcode_chunk_t *p_chunk = p_enc->chunks.p_current;
+
+    if( p_chunk != NULL )
+    {
+        p_chunk->i_state = CHUNK_QUEUED;
+        p_enc->chunks.p_current = NULL;
+        vlc_cond_signal( &p_enc->cond );
+    }
+}
+
+static void ChunksPush( transcode_encoder_t *p_enc, picture_t *p_pic )
+{
+    vlc_mutex_lock( &p_enc->lock_out );
+
+    transcode_chunk_t *p_chunk = p_enc->chunks.p_current;
+    if( p_chunk == NULL )
+    {
+        /* Bound the pictures in memory, while a late chunk holds back the
+         * output of the next ones */
+        while( p_enc->chunks.i_count >= 2 * p_enc->chunks.i_threads )
+            vlc_cond_wait( &p_enc->chunks.wait, &p_enc->lock_out );
+
+        p_chunk = malloc( sizeof(*p_chunk) );
+        if( unlikely(p_chunk == NULL) )
+        {
+            vlc_mutex_unlock( &p_enc->lock_out );
+            return;
+        }
+        p_chunk->p_next = NULL;
+        p_chunk->i_state = CHUNK_FILLING;
+        p_chunk->b_primary = p_enc->chunks.i_pushed++ == 0;
+        p_chunk->i_pictures = 0;
+        vlc_picture_chain_Init( &p_chunk->pics );
+        p_chunk->p_out = NULL;
+
+        *p_enc->chunks.pp_last = p_chunk;
+        p_enc->chunks.pp_last = &p_chunk->p_next;
+        p_enc->chunks.i_count++;
+        p_enc->chunks.p_current = p_chunk;
+    }
+
+    vlc_picture_chain_Append( &p_chunk->pics, picture_Hold( p_pic ) );
+    if( ++p_chunk->i_pictures >= p_enc->chunks.i_frames )
+        ChunkQueue( p_enc );
+
+    vlc_mutex_unlock( &p_enc->lock_out );
+}
+
+static int ChunksStart( transcode_encoder_t *p_enc,
+                        const transcode_encoder_config_t *p_cfg )
+{
+    const unsigned i_count = p_cfg->video.chunks.i_count;
+
+    p_enc->chunks.p_threads = vlc_alloc( i_count, sizeof(vlc_thread_t) );
+    if( !p_enc->chunks.p_threads )
+        return VLC_ENOMEM;
+
+    p_enc->chunks.p_cfg = p_cfg;
+    p_enc->chunks.i_frames = __MAX( p_cfg->video.chunks.i_frames, 1 );
+    p_enc->chunks.p_first = NULL;
+    p_enc->chunks.pp_last = &p_enc->chunks.p_first;
+    p_enc->chunks.p_current = NULL;
+    p_enc->chunks.i_count = 0;
+    p_enc->chunks.i_pushed = 0;
+    p_enc->chunks.i_done = 0;
+    p_enc->chunks.i_last_dts = VLC_TICK_INVALID;
+    p_enc->chunks.i_delay = 0;
+    vlc_cond_init( &p_enc->chunks.wait );
+
+    for( p_enc->chunks.i_threads = 0; p_enc->chunks.i_threads < i_count;
+         p_enc->chunks.i_threads++ )
+        if( vlc_clone( &p_enc->chunks.p_threads[p_enc->chunks.i_threads],
+                       ChunkThread, p_enc, p_cfg->video.threads.i_priority ) )
+            break;
+
+    if( p_enc->chunks.i_threads == 0 )
+    {
+        free( p_enc->chunks.p_threads );
+        p_enc->chunks.p_threads = NULL;
+        return VLC_EGENERIC;
+    }
+    if( p_enc->chunks.i_threads < i_count )
+        msg_Warn( p_enc->p_encoder, "only %u chunk encoders started",
+                  p_enc->chunks.i_threads );
+
+    msg_Dbg( p_enc->p_encoder, "encoding chunks of %u pictures with %u "
+             "concurrent encoders", p_enc->chunks.i_frames,
+             p_enc->chunks.i_threads );
+    return VLC_SUCCESS;
+}
+
+static void ChunksStop( transcode_encoder_t *p_enc )
+{
+    vlc_mutex_lock( &p_enc->lock_out );
+    ChunkQueue( p_enc );
+    p_enc->b_abort = true;
+    vlc_cond_broadcast( &p_enc->cond );
+    vlc_mutex_unlock( &p_enc->lock_out );
+
+    for( unsigned i = 0; i < p_enc->chunks.i_threads; i++ )
+        vlc_join( p_enc->chunks.p_threads[i], NULL );
+    free( p_enc->chunks.p_threads );
+    p_enc->chunks.p_threads = NULL;
+
+    /* Every chunk was encoded and output */
+    assert( p_enc->chunks.p_first == NULL );
+    msg_Dbg( p_enc->p_encoder, "%u chunks encoded", p_enc->chunks.i_done );
+}
+
+static void EncoderThreadsStop( transcode_encoder_t *p_enc )
+{
+    if( p_enc->chunks.i_threads > 0 )
+    {
+        ChunksStop( p_enc );
+        return;
+    }
+
+    vlc_mutex_lock( &p_enc->lock_out );
+    p_enc->b_abort = true;
+    vlc_cond_signal( &p_enc->cond );
+    vlc_mutex_unlock( &p_enc->lock_out );
+    vlc_join( p_enc->thread, NULL );
+}
+
 int transcode_encoder_video_drain( transcode_encoder_t *p_enc, block_t **out )
 {
     if( !p_enc->b_threaded )
@@ -416,13 +741,7 @@ int transcode_encoder_video_drain( transcode_encoder_t *p_enc, block_t **out )
     else
     {
         if( p_enc->b_threaded && !p_enc->b_abort )
-        {
-            vlc_mutex_lock( &p_enc->lock_out );
-            p_enc->b_abort = true;
-            vlc_cond_signal( &p_enc->cond );
-            vlc_mutex_unlock( &p_enc->lock_out );
-            vlc_join( p_enc->thread, NULL );
-        }
+            EncoderThreadsStop( p_enc );
         block_ChainAppend( out, transcode_encoder_get_output_async( p_enc ) );
     }
     return VLC_SUCCESS;
@@ -431,17 +750,16 @@ int transcode_encoder_video_drain( transcode_encoder_t *p_enc, block_t **out )
 void transcode_encoder_video_close( transcode_encoder_t *p_enc )
 {
     if( p_enc->b_threaded && !p_enc->b_abort )
-    {
-        vlc_mutex_lock( &p_enc->lock_out );
-        p_enc->b_abort = true;
-        vlc_cond_signal( &p_enc->cond );
-        vlc_mutex_unlock( &p_enc->lock_out );
-        vlc_join( p_enc->thread, NULL );
-    }
+        EncoderThreadsStop( p_enc );
 
     /* Close encoder */
     module_unneed( p_enc->p_encoder, p_enc->p_encoder->p_module );
     p_enc->p_encoder->p_module = NULL;
+    if( p_enc->chunks.i_threads > 0 )
+    {
+        es_format_Clean( &p_enc->chunks.fmt_out );
+        p_enc->chunks.i_threads = 0;
+    }
 }
 
 int transcode_encoder_video_open( transcode_encoder_t *p_enc,
@@ -450,10 +768,16 @@ int transcode_encoder_video_open( transcode_encoder_t *p_enc,
     p_enc->p_encoder->i_threads = p_cfg->video.threads.i_count;
     p_enc->p_encoder->p_cfg = p_cfg->p_config_chain;
 
+    /* The chunk encoders are opened with the requested output format, while
+     * this one provides the output format to the muxer, and encodes the
+     * first chunk */
+    if( p_cfg->video.chunks.i_count > 0 )
+        es_format_Copy( &p_enc->chunks.fmt_out, &p_enc->p_encoder->fmt_out );
+
     p_enc->p_encoder->p_module =
         module_need( p_enc->p_encoder, "encoder", p_cfg->psz_name, true );
     if( !p_enc->p_encoder->p_module )
-        return VLC_EGENERIC;
+        goto error;
 
     p_enc->p_encoder->fmt_in.video.i_chroma = p_enc->p_encoder->fmt_in.i_codec;
 
@@ -466,7 +790,17 @@ int transcode_encoder_video_open( transcode_encoder_t *p_enc,
     p_enc->p_buffers = NULL;
     p_enc->b_abort = false;
 
-    if( p_cfg->video.threads.i_count > 0 )
+    if( p_cfg->video.chunks.i_count > 0 )
+    {
+        if( ChunksStart( p_enc, p_cfg ) )
+        {
+            module_unneed( p_enc->p_encoder, p_enc->p_encoder->p_module );
+            p_enc->p_encoder->p_module = NULL;
+            goto error;
+        }
+        p_enc->b_threaded = true;
+    }
+    else if( p_cfg->video.threads.i_count > 0 )
     {
         if( vlc_clone( &p_enc->thread, EncoderThread, p_enc, p_cfg->video.threads.i_priority ) )
         {
@@ -478,6 +812,11 @@ int transcode_encoder_video_open( transcode_encoder_t *p_enc,
     }
 
     return VLC_SUCCESS;
+
+error:
+    if( p_cfg->video.chunks.i_count > 0 )
+        es_format_Clean( &p_enc->chunks.fmt_out );
+    return VLC_EGENERIC;
 }
 
 block_t * transcode_encoder_video_encode( transcode_encoder_t *p_enc, picture_t *p_pic )
@@ -487,6 +826,12 @@ block_t * transcode_encoder_video_encode( transcode_encoder_t *p_enc, picture_t
         return p_enc->p_encoder->pf_encode_video( p_enc->p_encoder, p_pic );
     }
 
+    if( p_enc->chunks.i_threads > 0 )
+    {
+        ChunksPush( p_enc, p_pic );
+        return NULL;
+    }
+
     vlc_sem_wait( &p_enc->picture_pool_has_room );
     vlc_mutex_lock( &p_enc->lock_out );
     picture_Hold( p_pic );
@@ -35,6 +35,7 @@
 #include <vlc_plugin.h>
 #include <vlc_sout.h>
 #include <vlc_spu.h>
+#include <vlc_charset.h>
 
 #include "transcode.h"
 
@@ -129,6 +130,22 @@
 #define POOL_TEXT N_("Picture pool size")
 #define POOL_LONGTEXT N_( "Defines how many pictures we allow to be in pool "\
     "between decoder/encoder threads when threads > 0" )
+#define RENDITIONS_TEXT N_("Video renditions")
+#define RENDITIONS_LONGTEXT N_( \
+    "Additional renditions of the video, encoded from the same decoded " \
+    "pictures, each output as its own stream and group. This is a list of " \
+    "name{options} separated by colons, where the options vb, scale, width, " \
+    "height, maxwidth and maxheight override the ones of the main video, " \
+    "e.g. 720p{vb=3000,height=720}:360p{vb=800,height=360}." )
+#define CHUNKS_TEXT N_("Concurrent chunk encoders")
+#define CHUNKS_LONGTEXT N_( \
+    "Splits the video in chunks which are encoded concurrently by this " \
+    "number of independent encoders, each chunk starting with a keyframe. " \
+    "This delays the output by several chunks and is meant for file to file " \
+    "transcoding, not for live streams. 0 disables it." )
+#define CHUNK_FRAMES_TEXT N_("Chunk length")
+#define CHUNK_FRAMES_LONGTEXT N_( \
+    "Number of pictures of each chunk of the concurrent chunk encoders." )
 
 
 static const char *const ppsz_deinterlace_type[] =
@@ -177,6 +194,8 @@ vlc_module_begin ()
                  MAXHEIGHT_LONGTEXT, true )
     add_module_list(SOUT_CFG_PREFIX "vfilter", "video filter", NULL,
                     VFILTER_TEXT, VFILTER_LONGTEXT)
+    add_string( SOUT_CFG_PREFIX "renditions", NULL, RENDITIONS_TEXT,
+                RENDITIONS_LONGTEXT, true )
 
     set_section( N_("Audio"), NULL )
     add_module(SOUT_CFG_PREFIX "aenc", "encoder", NULL,
@@ -215,6 +234,12 @@ vlc_module_begin ()
         change_integer_range( 1, 1000 )
     add_bool( SOUT_CFG_PREFIX "high-priority", false, HP_TEXT, HP_LONGTEXT,
               true )
+    add_integer( SOUT_CFG_PREFIX "chunks", 0, CHUNKS_TEXT, CHUNKS_LONGTEXT,
+                 true )
+        change_integer_range( 0, 32 )
+    add_integer( SOUT_CFG_PREFIX "chunk-frames", 250, CHUNK_FRAMES_TEXT,
+                 CHUNK_FRAMES_LONGTEXT, true )
+        change_integer_range( 1, 100000 )
 
 vlc_module_end ()
 
@@ -224,7 +249,7 @@ static const char *const ppsz_sout_options[] = {
     "deinterlace-module", "threads", "aenc", "acodec", "ab", "alang",
     "afilter", "samplerate", "channels", "senc", "scodec", "soverlay",
     "sfilter", "high-priority", "maxwidth", "maxheight", "pool-size",
-    NULL
+    "chunks", "chunk-frames", "renditions", NULL
 };
 
 /*****************************************************************************
@@ -325,6 +350,8 @@ static void SetVideoEncoderConfig( sout_stream_t *p_stream, transcode_encoder_co
 
     p_cfg->video.threads.i_count = var_GetInteger( p_stream, SOUT_CFG_PREFIX "threads" );
     p_cfg->video.threads.pool_size = var_GetInteger( p_stream, SOUT_CFG_PREFIX "pool-size" );
+    p_cfg->video.chunks.i_count = var_GetInteger( p_stream, SOUT_CFG_PREFIX "chunks" );
+    p_cfg->video.chunks.i_frames = var_GetInteger( p_stream, SOUT_CFG_PREFIX "chunk-frames" );
 
 #if VLC_THREAD_PRIORITY_OUTPUT != VLC_THREAD_PRIORITY_VIDEO
     if( var_GetBool( p_stream, SOUT_CFG_PREFIX "high-priority" ) )
@@ -334,6 +361,78 @@ static void SetVideoEncoderConfig( sout_stream_t *p_stream, transcode_encoder_co
         p_cfg->video.threads.i_priority = VLC_THREAD_PRIORITY_VIDEO;
 }
 
+static void SetVideoRenditionsConfig( sout_stream_t *p_stream,
+                                      sout_stream_sys_t *p_sys,
+                                      const char *psz_renditions )
+{
+    const transcode_encoder_config_t *p_main = &p_sys->venc_cfg;
+    char *psz_string = strdup( psz_renditions );
+
+    while( psz_string && *psz_string )
+    {
+        if( p_sys->i_renditions == TRANSCODE_RENDITIONS_MAX )
+        {
+            msg_Warn( p_stream, "ignoring renditions past the %u first: %s",
+                      TRANSCODE_RENDITIONS_MAX, psz_string );
+            break;
+        }
+
+        transcode_rendition_config_t *p_renditions =
+            realloc( p_sys->p_renditions,
+                     (p_sys->i_renditions + 1) * sizeof(*p_renditions) );
+        if( !p_renditions )
+            break;
+        p_sys->p_renditions = p_renditions;
+
+        transcode_rendition_config_t *p_rend =
+            &p_renditions[p_sys->i_renditions++];
+        transcode_encoder_config_t *p_cfg = &p_rend->enc_cfg;
+        config_chain_t *p_options;
+        char *psz_next = config_ChainCreate( &p_rend->psz_label, &p_options,
+                                             psz_string );
+        free( psz_string );
+        psz_string = psz_next;
+
+        /* Same encoder as the main video */
+        *p_cfg = *p_main;
+        p_cfg->psz_name = p_main->psz_name ? strdup( p_main->psz_name ) : NULL;
+        p_cfg->psz_lang = p_main->psz_lang ? strdup( p_main->psz_lang ) : NULL;
+        p_cfg->p_config_chain = config_ChainDuplicate( p_main->p_config_chain );
+
+        for( config_chain_t *p = p_options; p != NULL; p = p->p_next )
+        {
+            if( p->psz_value == NULL )
+                continue;
+            if( !strcmp( p->psz_name, "vb" ) )
+            {
+                p_cfg->video.i_bitrate = atoi( p->psz_value );
+                if( p_cfg->video.i_bitrate < 16000 )
+                    p_cfg->video.i_bitrate *= 1000;
+            }
+            else if( !strcmp( p->psz_name, "scale" ) )
+                p_cfg->video.f_scale = us_atof( p->psz_value );
+            else if( !strcmp( p->psz_name, "width" ) )
+                p_cfg->video.i_width = atoi( p->psz_value );
+            else if( !strcmp( p->psz_name, "height" ) )
+                p_cfg->video.i_height = atoi( p->psz_value );
+            else if( !strcmp( p->psz_name, "maxwidth" ) )
+                p_cfg->video.i_maxwidth = atoi( p->psz_value );
+            else if( !strcmp( p->psz_name, "maxheight" ) )
+                p_cfg->video.i_maxheight = atoi( p->psz_value );
+            else
+                msg_Warn( p_stream, "unknown option %s of rendition %s",
+                          p->psz_name, p_rend->psz_label );
+        }
+        config_ChainDestroy( p_options );
+
+        msg_Dbg( p_stream, "rendition %s: %ux%u scaling: %f %ukb/s",
+                 p_rend->psz_label, p_cfg->video.i_width,
+                 p_cfg->video.i_height, p_cfg->video.f_scale,
+                 p_cfg->video.i_bitrate / 1000 );
+    }
+    free( psz_string );
+}
+
 static void SetSPUEncoderConfig( sout_stream_t *p_stream, transcode_encoder_config_t *p_cfg )
 {
     char *psz_string = var_GetString( p_stream, SOUT_CFG_PREFIX "senc" );
@@ -423,6 +522,11 @@ static int Open( vlc_object_t *p_this )
                  p_sys->venc_cfg.video.i_bitrate / 1000 );
     }
 
+    psz_string = var_GetString( p_stream, SOUT_CFG_PREFIX "renditions" );
+    if( psz_string && *psz_string && p_sys->venc_cfg.i_codec )
+        SetVideoRenditionsConfig( p_stream, p_sys, psz_string );
+    free( psz_string );
+
     /* Video Filter Parameters */
     sout_filters_config_init( &p_sys->vfilters_cfg );
 
@@ -481,6 +585,12 @@ static void Close( vlc_object_t * p_this )
 
     transcode_encoder_config_clean( &p_sys->venc_cfg );
     sout_filters_config_clean( &p_sys->vfilters_cfg );
+    for( unsigned i = 0; i < p_sys->i_renditions; i++ )
+    {
+        free( p_sys->p_renditions[i].psz_label );
+        transcode_encoder_config_clean( &p_sys->p_renditions[i].enc_cfg );
+    }
+    free( p_sys->p_renditions );
 
     transcode_encoder_config_clean( &p_sys->aenc_cfg );
     sout_filters_config_clean( &p_sys->afilters_cfg );
@@ -692,7 +802,7 @@ static void Del( sout_stream_t *p_stream, void *_id )
             if( id == p_sys->id_video )
                 p_sys->id_video = NULL;
             vlc_mutex_unlock( &p_sys->lock );
-            transcode_video_clean( id );
+            transcode_video_clean( p_stream, id );
             break;
         case SPU_ES:
             decoder_Destroy( id->p_decoder );
@@ -41,6 +41,21 @@ void sout_filters_config_clean( sout_filters_config_t *p_cfg )
 
 typedef struct sout_stream_id_sys_t sout_stream_id_sys_t;
 
+/* A rendition of an adaptive ladder, encoded from the same decoded video */
+typedef struct
+{
+    char *psz_label;
+    transcode_encoder_config_t enc_cfg;
+} transcode_rendition_config_t;
+
+/* Each rendition is output as its own elementary stream and group. The
+ * identifiers also differ from the main ones in their 13 low bits, which the
+ * TS muxer uses as PID with es-id-pid, as long as there are fewer than 32. */
+#define TRANSCODE_RENDITIONS_MAX 31
+#define TRANSCODE_RENDITION_ID(id, i) ((id) + ((i) + 1) * 0x10100)
+
+struct transcode_rendition;
+
 typedef struct
 {
     bool                  b_soverlay;
@@ -52,6 +67,8 @@ typedef struct
     /* Video */
     transcode_encoder_config_t venc_cfg;
     sout_filters_config_t vfilters_cfg;
+    transcode_rendition_config_t *p_renditions;
+    unsigned        i_renditions;
 
     /* SPU */
     transcode_encoder_config_t senc_cfg;
@@ -125,6 +142,8 @@ struct sout_stream_id_sys_t
              spu_t           *p_spu;
              vlc_decoder_device *dec_dev;
              vlc_video_context *enc_vctx_in;
+             struct transcode_rendition *p_renditions;
+             unsigned        i_renditions;
          };
          struct
          {
@@ -201,7 +220,7 @@ int  transcode_audio_init   ( sout_stream_t *, const es_format_t *,
 
 /* VIDEO */
 
-void transcode_video_clean  ( sout_stream_id_sys_t * );
+void transcode_video_clean  ( sout_stream_t *, sout_stream_id_sys_t * );
 int  transcode_video_process( sout_stream_t *, sout_stream_id_sys_t *,
                                      block_t *, block_t ** );
 int transcode_video_get_output_dimensions( sout_stream_id_sys_t *,
@@ -71,6 +71,244 @@ static const struct encoder_owner_callbacks encoder_video_transcode_cbs = {
     { video_get_encoder_device, }
 };
 
+struct transcode_rendition
+{
+    const transcode_rendition_config_t *p_cfg;
+    unsigned             i_index;
+    transcode_encoder_t *encoder;
+    filter_chain_t      *p_conv; /**< converter from the main encoder input */
+    video_format_t       fmt_src;
+    void                *downstream_id;
+    bool                 b_error;
+};
+
+static void RenditionsClean( sout_stream_t *p_stream, sout_stream_id_sys_t *id )
+{
+    for( unsigned i = 0; i < id->i_renditions; i++ )
+    {
+        struct transcode_rendition *p_rend = &id->p_renditions[i];
+
+        transcode_encoder_close( p_rend->encoder );
+        transcode_encoder_delete( p_rend->encoder );
+        transcode_remove_filters( &p_rend->p_conv );
+        video_format_Clean( &p_rend->fmt_src );
+        if( p_rend->downstream_id )
+            sout_StreamIdDel( p_stream->p_next, p_rend->downstream_id );
+    }
+    free( id->p_renditions );
+    id->p_renditions = NULL;
+    id->i_renditions = 0;
+}
+
+static int RenditionsInit( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
+                           const es_format_t *p_enc_fmt_in )
+{
+    sout_stream_sys_t *p_sys = p_stream->p_sys;
+
+    if( p_sys->i_renditions == 0 )
+        return VLC_SUCCESS;
+
+    id->p_renditions = calloc( p_sys->i_renditions, sizeof(*id->p_renditions) );
+    if( !id->p_renditions )
+        return VLC_ENOMEM;
+
+    for( unsigned i = 0; i < p_sys->i_renditions; i++ )
+    {
+        struct transcode_rendition *p_rend = &id->p_renditions[i];
+        struct encoder_owner *p_owner = (struct encoder_owner *)
+            sout_EncoderCreate( p_stream, sizeof(struct encoder_owner) );
+        if( unlikely(p_owner == NULL) )
+            goto error;
+
+        p_owner->id = id;
+        p_owner->enc.cbs = &encoder_video_transcode_cbs;
+        /* Same encoder as the main video, thus same input format */
+        p_rend->encoder = transcode_encoder_new( &p_owner->enc, p_enc_fmt_in );
+        if( !p_rend->encoder )
+            goto error;
+        p_rend->p_cfg = &p_sys->p_renditions[i];
+        p_rend->i_index = i;
+        video_format_Init( &p_rend->fmt_src, 0 );
+        id->i_renditions++;
+    }
+    return VLC_SUCCESS;
+
+error:
+    RenditionsClean( p_stream, id );
+    return VLC_EGENERIC;
+}
+
+static int RenditionOpen( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
+                          struct transcode_rendition *p_rend,
+                          picture_t *p_pic )
+{
+    const video_format_t *p_src = &p_pic->format;
+    transcode_encoder_config_t cfg = p_rend->p_cfg->enc_cfg;
+
+    /* Keep the aspect ratio when only one dimension is set */
+    if( !cfg.video.f_scale && !cfg.video.i_width != !cfg.video.i_height &&
+        p_src->i_visible_width && p_src->i_visible_height )
+    {
+        uint64_t i_num = p_src->i_visible_width, i_den = p_src->i_visible_height;
+
+        if( p_src->i_sar_num && p_src->i_sar_den )
+        {
+            i_num *= p_src->i_sar_num;
+            i_den *= p_src->i_sar_den;
+        }
+        if( cfg.video.i_width )
+            cfg.video.i_height = (cfg.video.i_width * i_den / i_num + 1) & ~1;
+        else
+            cfg.video.i_width = (cfg.video.i_height * i_num / i_den + 1) & ~1;
+    }
+
+    transcode_encoder_video_configure( VLC_OBJECT(p_stream),
+                                       &id->p_decoder->fmt_out.video, &cfg,
+                                       p_src, picture_GetVideoContext( p_pic ),
+                                       p_rend->encoder );
+
+    /* The encoder keeps the configuration, which must outlive it */
+    if( transcode_encoder_open( p_rend->encoder,
+                                &p_rend->p_cfg->enc_cfg ) != VLC_SUCCESS )
+    {
+        msg_Err( p_stream, "cannot open the video encoder of rendition %s",
+                 p_rend->p_cfg->psz_label );
+        return VLC_EGENERIC;
+    }
+
+    if( !p_rend->downstream_id )
+    {
+        es_format_t fmt;
+
+        es_format_Copy( &fmt, transcode_encoder_format_out( p_rend->encoder ) );
+        fmt.i_id = TRANSCODE_RENDITION_ID( id->p_decoder->fmt_in.i_id,
+                                           p_rend->i_index );
+        fmt.i_group = TRANSCODE_RENDITION_ID( id->p_decoder->fmt_in.i_group,
+                                              p_rend->i_index );
+        free( fmt.psz_description );
+        fmt.psz_description = strdup( p_rend->p_cfg->psz_label );
+        p_rend->downstream_id = sout_StreamIdAdd( p_stream->p_next, &fmt );
+        es_format_Clean( &fmt );
+        if( !p_rend->downstream_id )
+        {
+            msg_Err( p_stream, "cannot output rendition %s",
+                     p_rend->p_cfg->psz_label );
+            return VLC_EGENERIC;
+        }
+    }
+
+    msg_Dbg( p_stream, "rendition %s: %ux%u", p_rend->p_cfg->psz_label,
+             transcode_encoder_format_in( p_rend->encoder )->video.i_visible_width,
+             transcode_encoder_format_in( p_rend->encoder )->video.i_visible_height );
+    return VLC_SUCCESS;
+}
+
+static picture_t *RenditionConvert( sout_stream_t *p_stream,
+                                    struct transcode_rendition *p_rend,
+                                    picture_t *p_pic )
+{
+    const es_format_t *p_enc_in = transcode_encoder_format_in( p_rend->encoder );
+
+    /* Share the picture when the encoder takes it as is */
+    if( video_format_IsSimilar( &p_pic->format, &p_enc_in->video ) )
+        return picture_Hold( p_pic );
+
+    if( !p_rend->p_conv ||
+        !video_format_IsSimilar( &p_rend->fmt_src, &p_pic->format ) )
+    {
+        es_format_t fmt;
+
+        transcode_remove_filters( &p_rend->p_conv );
+        video_format_Clean( &p_rend->fmt_src );
+        video_format_Copy( &p_rend->fmt_src, &p_pic->format );
+
+        es_format_InitFromVideo( &fmt, &p_pic->format );
+        p_rend->p_conv = filter_chain_NewVideo( p_stream, false, NULL );
+        if( p_rend->p_conv )
+        {
+            filter_chain_Reset( p_rend->p_conv, &fmt,
+                                picture_GetVideoContext( p_pic ), p_enc_in );
+            if( filter_chain_AppendConverter( p_rend->p_conv, NULL ) )
+                transcode_remove_filters( &p_rend->p_conv );
+        }
+        es_format_Clean( &fmt );
+
+        if( !p_rend->p_conv )
+        {
+            msg_Err( p_stream, "cannot convert the pictures of rendition %s",
+                     p_rend->p_cfg->psz_label );
+            p_rend->b_error = true;
+            return NULL;
+        }
+    }
+
+    return filter_chain_VideoFilter( p_rend->p_conv, picture_Hold( p_pic ) );
+}
+
+/* Encodes the picture of the main encoder for the other renditions */
+static void RenditionsEncode( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
+                              picture_t *p_pic )
+{
+    for( unsigned i = 0; i < id->i_renditions; i++ )
+    {
+        struct transcode_rendition *p_rend = &id->p_renditions[i];
+
+        if( p_rend->b_error )
+            continue;
+        if( !transcode_encoder_opened( p_rend->encoder ) &&
+            RenditionOpen( p_stream, id, p_rend, p_pic ) != VLC_SUCCESS )
+        {
+            p_rend->b_error = true;
+            continue;
+        }
+
+        picture_t *p_in = RenditionConvert( p_stream, p_rend, p_pic );
+        if( !p_in )
+            continue;
+
+        block_t *p_out = transcode_encoder_encode( p_rend->encoder, p_in );
+        picture_Release( p_in );
+        block_ChainAppend( &p_out,
+                           transcode_encoder_get_output_async( p_rend->encoder ) );
+        if( p_out )
+            sout_StreamIdSend( p_stream->p_next, p_rend->downstream_id, p_out );
+    }
+}
+
+static void tag_last_block_with_flag( block_t **out, int i_flag )
+{
+    block_t *p_last = *out;
+    if( p_last )
+    {
+        while( p_last->p_next )
+            p_last = p_last->p_next;
+        p_last->i_flags |= i_flag;
+    }
+}
+
+static void RenditionsDrain( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
+                             bool b_eos )
+{
+    for( unsigned i = 0; i < id->i_renditions; i++ )
+    {
+        struct transcode_rendition *p_rend = &id->p_renditions[i];
+        block_t *p_out = NULL;
+
+        if( !transcode_encoder_opened( p_rend->encoder ) )
+            continue;
+
+        transcode_encoder_drain( p_rend->encoder, &p_out );
+        if( b_eos )
+        {
+            transcode_encoder_close( p_rend->encoder );
+            transcode_remove_filters( &p_rend->p_conv );
+            tag_last_block_with_flag( &p_out, BLOCK_FLAG_END_OF_SEQUENCE );
+        }
+        if( p_out )
+            sout_StreamIdSend( p_stream->p_next, p_rend->downstream_id, p_out );
+    }
+}
+
 static vlc_decoder_device * video_get_decoder_device( decoder_t *p_dec )
 {
     struct decoder_owner *p_owner = dec_get_owner( p_dec );
@@ -247,6 +485,13 @@ int transcode_video_init( sout_stream_t *p_stream, const es_format_t *p_fmt,
     /* Will use this format as encoder input for now */
     transcode_encoder_update_format_in( id->encoder, &encoder_tested_fmt_in );
 
+    if( RenditionsInit( p_stream, id, &encoder_tested_fmt_in ) != VLC_SUCCESS )
+    {
+        transcode_encoder_delete( id->encoder );
+        id->encoder = NULL;
+        goto error;
+    }
+
     es_format_Clean( &encoder_tested_fmt_in );
 
     return VLC_SUCCESS;
@@ -331,8 +576,10 @@ static int transcode_video_filters_init( sout_stream_t *p_stream,
     return VLC_SUCCESS;
 }
 
-void transcode_video_clean( sout_stream_id_sys_t *id )
+void transcode_video_clean( sout_stream_t *p_stream, sout_stream_id_sys_t *id )
 {
+    RenditionsClean( p_stream, id );
+
     /* Close encoder */
     transcode_encoder_close( id->encoder );
     transcode_encoder_delete( id->encoder );
@@ -422,17 +669,6 @@ static picture_t * RenderSubpictures( sout_stream_id_sys_t *id, picture_t *p_pic
     return p_pic;
 }
 
-static void tag_last_block_with_flag( block_t **out, int i_flag )
-{
-    block_t *p_last = *out;
-    if( p_last )
-    {
-        while( p_last->p_next )
-            p_last = p_last->p_next;
-        p_last->i_flags |= i_flag;
-    }
-}
-
 int transcode_video_process( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
                                     block_t *in, block_t **out )
 {
@@ -602,6 +838,8 @@ int transcode_video_process( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
 
                 if( p_in )
                 {
+                    RenditionsEncode( p_stream, id, p_in );
+
                     block_t *p_encoded = transcode_encoder_encode( id->encoder, p_in );
                     if( p_encoded )
                         block_ChainAppend( out, p_encoded );
@@ -616,6 +854,7 @@ int transcode_video_process( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
             if( transcode_encoder_drain( id->encoder, out ) != VLC_SUCCESS )
                 goto error;
             transcode_encoder_close( id->encoder );
+            RenditionsDrain( p_stream, id, true );
             /* Close filters */
             transcode_remove_filters( &id->p_f_chain );
             transcode_remove_filters( &id->p_uf_chain );
@@ -631,7 +870,8 @@ error:
         id->b_error = true;
     }
 
-    if( id->p_enccfg->video.threads.i_count >= 1 )
+    if( id->p_enccfg->video.threads.i_count >= 1 ||
+        id->p_enccfg->video.chunks.i_count >= 1 )
     {
         /* Pick up any return data the encoder thread wants to output. */
         block_ChainAppend( out, transcode_encoder_get_output_async( id->encoder ) );
@@ -641,6 +881,7 @@ error:
     if( unlikely( !id->b_error && in == NULL ) && transcode_encoder_opened( id->encoder ) )
     {
         msg_Dbg( p_stream, "Flushing thread and waiting that");
+        RenditionsDrain( p_stream, id, false );
         if( transcode_encoder_drain( id->encoder, out ) == VLC_SUCCESS )
             msg_Dbg( p_stream, "Flushing done");
         else
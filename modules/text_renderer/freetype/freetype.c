@@ -47,6 +47,7 @@
 #include "platform_fonts.h"
 #include "freetype.h"
 #include "text_layout.h"
+#include "layout_cache.h"
 #include "blend/rgb.h"
 #include "blend/yuv.h"
 
@@ -86,7 +87,8 @@ static void Destroy( filter_t * );
 #define SHADOW_ANGLE_TEXT N_("Shadow angle")
 #define SHADOW_DISTANCE_TEXT N_("Shadow distance")
 #define CACHE_SIZE_TEXT N_("Cache size")
-#define CACHE_SIZE_LONGTEXT N_("Cache size in kBytes")
+#define CACHE_SIZE_LONGTEXT N_("Cache size in kBytes. Half of it holds the " \
+    "font glyphs, the other half the laid out and rendered text lines.")
 
 #define TEXT_DIRECTION_TEXT N_("Text direction")
 #define TEXT_DIRECTION_LONGTEXT N_("Paragraph base direction for the Unicode bi-directional algorithm.")
@@ -1002,7 +1004,28 @@ static int Render( filter_t *p_filter, subpicture_region_t *p_region_out,
 
     text_block.i_max_width = i_max_width;
     text_block.i_max_height = i_max_height;
-    rv = LayoutTextBlock( p_filter, &text_block, &text_block.p_laid, &bbox, &i_max_face_height );
+
+    /* Reuse the lines of an identical block, or cache the new ones */
+    bool b_cached_lines = false;
+    char *psz_layout_key = vlc_layoutcache_GetKey( p_filter, &text_block );
+    const vlc_layoutcache_block_t *p_cached = psz_layout_key ?
+        vlc_layoutcache_Get( p_sys->layoutcache, psz_layout_key, &text_block ) : NULL;
+    if( p_cached )
+    {
+        text_block.p_laid = p_cached->p_lines;
+        bbox = p_cached->bbox;
+        i_max_face_height = p_cached->i_max_face_height;
+        b_cached_lines = true;
+    }
+    else
+    {
+        rv = LayoutTextBlock( p_filter, &text_block, &text_block.p_laid, &bbox, &i_max_face_height );
+        if( !rv && psz_layout_key &&
+            vlc_layoutcache_Insert( p_sys->layoutcache, psz_layout_key, &text_block,
+                                    text_block.p_laid, &bbox, i_max_face_height ) == VLC_SUCCESS )
+            b_cached_lines = true;
+    }
+    free( psz_layout_key );
 
     /* Don't attempt to render text that couldn't be layed out
      * properly. */
@@ -1148,7 +1171,8 @@ static int Render( filter_t *p_filter, subpicture_region_t *p_region_out,
         rv = VLC_EGENERIC;
     }
 
-    FreeLines( text_block.p_laid );
+    if( !b_cached_lines )
+        FreeLines( text_block.p_laid );
 
     free( text_block.p_uchars );
     FreeStylesArray( text_block.pp_styles, text_block.i_count );
@@ -1191,11 +1215,18 @@ static int Create( filter_t *p_filter )
         p_sys->p_stroker = NULL;
     }
 
+    /* Share the cache memory between glyphs and laid out lines */
+    unsigned i_cache_kb = var_InheritInteger( p_filter, "freetype-cache-size" );
     p_sys->ftcache = vlc_ftcache_New( VLC_OBJECT(p_filter), p_sys->p_library,
-                            var_InheritInteger( p_filter, "freetype-cache-size" ) );
+                                      i_cache_kb - i_cache_kb / 2 );
     if( !p_sys->ftcache )
         goto error;
 
+    p_sys->layoutcache = vlc_layoutcache_New( VLC_OBJECT(p_filter),
+                                              (size_t)( i_cache_kb / 2 ) << 10 );
+    if( !p_sys->layoutcache )
+        goto error;
+
     p_sys->i_scale = 100;
 
     /* default style to apply to uncomplete segmeents styles */
@@ -1262,6 +1293,10 @@ static void Destroy( filter_t *p_filter )
         DumpFamilies( p_sys->fs );
 #endif
 
+    /* Cached lines hold glyphs from the faces and styles */
+    if( p_sys->layoutcache )
+        vlc_layoutcache_Delete( p_sys->layoutcache );
+
     if( p_sys->ftcache )
         vlc_ftcache_Delete( p_sys->ftcache );
 
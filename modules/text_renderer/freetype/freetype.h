@@ -80,6 +80,7 @@ typedef uint32_t uni_char_t;
 #include "ftcache.h"
 
 typedef struct vlc_font_select_t vlc_font_select_t;
+typedef struct vlc_layoutcache_t vlc_layoutcache_t;
 
 /*****************************************************************************
  * filter_sys_t: freetype local data
@@ -117,6 +118,7 @@ typedef struct
 
     vlc_font_select_t *fs;
     vlc_ftcache_t     *ftcache;
+    vlc_layoutcache_t *layoutcache;
 
 } filter_sys_t;
 
@@ -0,0 +1,330 @@
+/*****************************************************************************
+ * layout_cache.c : Laid out text cache
+ *****************************************************************************
+ * Copyright (C) 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+#include <vlc_filter.h>
+#include <vlc_list.h>
+#include <vlc_memstream.h>
+
+#include "freetype.h"
+#include "text_layout.h"
+#include "layout_cache.h"
+
+/* Lookups between two statistics dumps */
+#define STATS_PERIOD 256
+
+typedef struct
+{
+    char *psz_key;
+    vlc_layoutcache_block_t block;
+    text_style_t **pp_styles;   /* copies referenced by the lines */
+    size_t i_styles;
+    size_t i_size;
+    struct vlc_list node;
+} vlc_layoutcache_entry_t;
+
+struct vlc_layoutcache_t
+{
+    vlc_object_t *obj;
+    vlc_dictionary_t entries;
+    struct vlc_list lru;        /* most recently used first */
+    size_t i_size;
+    size_t i_max_size;
+
+    unsigned i_hits;
+    unsigned i_misses;
+};
+
+static void EntryDelete( vlc_layoutcache_entry_t *p_entry )
+{
+    FreeLines( p_entry->block.p_lines );
+    for( size_t i = 0; i < p_entry->i_styles; i++ )
+        text_style_Delete( p_entry->pp_styles[i] );
+    free( p_entry->pp_styles );
+    free( p_entry->psz_key );
+    free( p_entry );
+}
+
+static void EntryRemove( vlc_layoutcache_t *cache,
+                         vlc_layoutcache_entry_t *p_entry )
+{
+    vlc_list_remove( &p_entry->node );
+    vlc_dictionary_remove_value_for_key( &cache->entries, p_entry->psz_key,
+                                         NULL, NULL );
+    cache->i_size -= p_entry->i_size;
+    EntryDelete( p_entry );
+}
+
+static void DumpStats( vlc_layoutcache_t *cache )
+{
+    const unsigned i_lookups = cache->i_hits + cache->i_misses;
+    msg_Dbg( cache->obj, "layout cache: %u hits, %u misses (%u%% hit rate), "
+             "%zu entries, %zu/%zu kB", cache->i_hits, cache->i_misses,
+             i_lookups ? cache->i_hits * 100 / i_lookups : 0,
+             (size_t) vlc_dictionary_keys_count( &cache->entries ),
+             cache->i_size >> 10, cache->i_max_size >> 10 );
+}
+
+vlc_layoutcache_t * vlc_layoutcache_New( vlc_object_t *obj, size_t i_max_size )
+{
+    vlc_layoutcache_t *cache = malloc( sizeof(*cache) );
+    if( !cache )
+        return NULL;
+
+    cache->obj = obj;
+    vlc_dictionary_init( &cache->entries, 64 );
+    vlc_list_init( &cache->lru );
+    cache->i_size = 0;
+    cache->i_max_size = i_max_size;
+    cache->i_hits = 0;
+    cache->i_misses = 0;
+    return cache;
+}
+
+void vlc_layoutcache_Delete( vlc_layoutcache_t *cache )
+{
+    if( cache->i_hits + cache->i_misses > 0 )
+        DumpStats( cache );
+
+    vlc_layoutcache_entry_t *p_entry;
+    vlc_list_foreach( p_entry, &cache->lru, node )
+        EntryDelete( p_entry );
+    vlc_dictionary_clear( &cache->entries, NULL, NULL );
+    free( cache );
+}
+
+static void KeyAddStyle( struct vlc_memstream *ms, const text_style_t *p_style )
+{
+    /* Only what changes the selected faces, the glyphs or the line breaks */
+    vlc_memstream_printf( ms, "{%s|%s|%x|%d|%a|%d|%d}",
+                          p_style->psz_fontname ? p_style->psz_fontname : "",
+                          p_style->psz_monofontname ? p_style->psz_monofontname : "",
+                          p_style->i_style_flags,
+                          p_style->i_font_size, p_style->f_font_relsize,
+                          p_style->e_wrapinfo,
+                          p_style->i_shadow_alpha != STYLE_ALPHA_TRANSPARENT );
+}
+
+char * vlc_layoutcache_GetKey( filter_t *p_filter,
+                               const layout_text_block_t *p_textblock )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    /* Ruby blocks are laid out separately and owned by the text block */
+    if( p_textblock->pp_ruby )
+        for( size_t i = 0; i < p_textblock->i_count; i++ )
+            if( p_textblock->pp_ruby[i] )
+                return NULL;
+
+    struct vlc_memstream ms;
+    if( vlc_memstream_open( &ms ) )
+        return NULL;
+
+    vlc_memstream_printf( &ms, "%u,%u,%d,%d,%d,%d,%u:",
+                          p_textblock->i_max_width, p_textblock->i_max_height,
+                          p_textblock->b_grid, p_textblock->b_balanced,
+                          p_sys->i_scale, p_sys->i_outline_thickness,
+                          p_filter->fmt_out.video.i_height );
+
+    const text_style_t *p_prev = NULL;
+    for( size_t i = 0; i < p_textblock->i_count; i++ )
+    {
+        if( p_textblock->pp_styles[i] != p_prev )
+        {
+            p_prev = p_textblock->pp_styles[i];
+            KeyAddStyle( &ms, p_prev );
+        }
+        vlc_memstream_printf( &ms, "%x,", (unsigned) p_textblock->p_uchars[i] );
+    }
+
+    if( vlc_memstream_close( &ms ) )
+        return NULL;
+    return ms.ptr;
+}
+
+static void CopyRenderingStyle( text_style_t *p_dst, const text_style_t *p_src )
+{
+    p_dst->i_font_color = p_src->i_font_color;
+    p_dst->i_font_alpha = p_src->i_font_alpha;
+    p_dst->i_outline_color = p_src->i_outline_color;
+    p_dst->i_outline_alpha = p_src->i_outline_alpha;
+    p_dst->i_shadow_color = p_src->i_shadow_color;
+    p_dst->i_shadow_alpha = p_src->i_shadow_alpha;
+    p_dst->i_background_color = p_src->i_background_color;
+    p_dst->i_background_alpha = p_src->i_background_alpha;
+}
+
+const vlc_layoutcache_block_t *
+vlc_layoutcache_Get( vlc_layoutcache_t *cache, const char *psz_key,
+                     const layout_text_block_t *p_textblock )
+{
+    vlc_layoutcache_entry_t *p_entry =
+            vlc_dictionary_value_for_key( &cache->entries, psz_key );
+
+    if( p_entry )
+        cache->i_hits++;
+    else
+        cache->i_misses++;
+    if( (cache->i_hits + cache->i_misses) % STATS_PERIOD == 0 )
+        DumpStats( cache );
+
+    if( !p_entry )
+        return NULL;
+
+    vlc_list_remove( &p_entry->node );
+    vlc_list_prepend( &p_entry->node, &cache->lru );
+
+    /* Same key, same sequence of styles: only refresh the colors */
+    const text_style_t *p_prev = NULL;
+    size_t i_style = 0;
+    for( size_t i = 0; i < p_textblock->i_count; i++ )
+    {
+        if( p_textblock->pp_styles[i] == p_prev )
+            continue;
+        p_prev = p_textblock->pp_styles[i];
+        assert( i_style < p_entry->i_styles );
+        CopyRenderingStyle( p_entry->pp_styles[i_style++], p_prev );
+    }
+
+    return &p_entry->block;
+}
+
+static size_t GlyphSize( FT_BitmapGlyph p_glyph )
+{
+    return sizeof(*p_glyph) + p_glyph->bitmap.rows * abs( p_glyph->bitmap.pitch );
+}
+
+static size_t LinesSize( const line_desc_t *p_lines )
+{
+    size_t i_size = 0;
+    for( const line_desc_t *p_line = p_lines; p_line; p_line = p_line->p_next )
+    {
+        i_size += sizeof(*p_line) +
+                  p_line->i_character_count * sizeof(*p_line->p_character);
+        for( int i = 0; i < p_line->i_character_count; i++ )
+        {
+            const line_character_t *ch = &p_line->p_character[i];
+            if( ch->p_glyph )
+                i_size += GlyphSize( ch->p_glyph );
+            if( ch->p_outline )
+                i_size += GlyphSize( ch->p_outline );
+            if( ch->p_shadow && ch->p_shadow != ch->p_glyph &&
+                ch->p_shadow != ch->p_outline )
+                i_size += GlyphSize( ch->p_shadow );
+        }
+    }
+    return i_size;
+}
+
+int vlc_layoutcache_Insert( vlc_layoutcache_t *cache, const char *psz_key,
+                            const layout_text_block_t *p_textblock,
+                            line_desc_t *p_lines, const FT_BBox *p_bbox,
+                            int i_max_face_height )
+{
+    assert( !vlc_dictionary_has_key( &cache->entries, psz_key ) );
+
+    const size_t i_size = strlen( psz_key ) + sizeof(vlc_layoutcache_entry_t) +
+                          LinesSize( p_lines );
+    if( i_size > cache->i_max_size )
+        return VLC_EGENERIC;
+
+    vlc_layoutcache_entry_t *p_entry = calloc( 1, sizeof(*p_entry) );
+    if( !p_entry )
+        return VLC_ENOMEM;
+
+    size_t i_styles = 0;
+    const text_style_t *p_prev = NULL;
+    for( size_t i = 0; i < p_textblock->i_count; i++ )
+        if( p_textblock->pp_styles[i] != p_prev )
+        {
+            p_prev = p_textblock->pp_styles[i];
+            i_styles++;
+        }
+
+    p_entry->psz_key = strdup( psz_key );
+    p_entry->pp_styles = calloc( i_styles, sizeof(*p_entry->pp_styles) );
+    if( !p_entry->psz_key || !p_entry->pp_styles )
+        goto error;
+
+    /* Copy the styles in text order, the lines must not reference the
+     * ones of the text block, which are released after rendering */
+    const text_style_t **pp_sources = vlc_alloc( i_styles, sizeof(*pp_sources) );
+    if( !pp_sources )
+        goto error;
+
+    p_prev = NULL;
+    for( size_t i = 0; i < p_textblock->i_count; i++ )
+    {
+        if( p_textblock->pp_styles[i] == p_prev )
+            continue;
+        p_prev = p_textblock->pp_styles[i];
+        pp_sources[p_entry->i_styles] = p_prev;
+        p_entry->pp_styles[p_entry->i_styles] = text_style_Duplicate( p_prev );
+        if( !p_entry->pp_styles[p_entry->i_styles++] )
+        {
+            free( pp_sources );
+            goto error;
+        }
+    }
+
+    for( line_desc_t *p_line = p_lines; p_line; p_line = p_line->p_next )
+        for( int i = 0; i < p_line->i_character_count; i++ )
+        {
+            line_character_t *ch = &p_line->p_character[i];
+            for( size_t j = 0; j < i_styles; j++ )
+                if( ch->p_style == pp_sources[j] )
+                {
+                    ch->p_style = p_entry->pp_styles[j];
+                    break;
+                }
+        }
+    free( pp_sources );
+
+    /* Evict the least recently used blocks */
+    while( cache->i_size + i_size > cache->i_max_size )
+    {
+        vlc_layoutcache_entry_t *p_last =
+                vlc_list_last_entry_or_null( &cache->lru,
+                                             vlc_layoutcache_entry_t, node );
+        assert( p_last );
+        EntryRemove( cache, p_last );
+    }
+
+    p_entry->block.p_lines = p_lines;
+    p_entry->block.bbox = *p_bbox;
+    p_entry->block.i_max_face_height = i_max_face_height;
+    p_entry->i_size = i_size;
+
+    vlc_dictionary_insert( &cache->entries, psz_key, p_entry );
+    vlc_list_prepend( &p_entry->node, &cache->lru );
+    cache->i_size += i_size;
+    return VLC_SUCCESS;
+
+error:
+    for( size_t i = 0; i < p_entry->i_styles; i++ )
+        text_style_Delete( p_entry->pp_styles[i] );
+    free( p_entry->pp_styles );
+    free( p_entry->psz_key );
+    free( p_entry );
+    return VLC_ENOMEM;
+}
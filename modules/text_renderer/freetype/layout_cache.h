@@ -0,0 +1,80 @@
+/*****************************************************************************
+ * layout_cache.h : Laid out text cache
+ *****************************************************************************
+ * Copyright (C) 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifndef LAYOUT_CACHE_H
+#define LAYOUT_CACHE_H
+
+/** \ingroup freetype
+ * @{
+ * \file
+ * Cache of shaped and laid out text blocks, with their rendered glyphs.
+ *
+ * Blocks are keyed on their text and on everything changing their layout
+ * (fonts, sizes, style flags, available room). Colors and alpha values are
+ * not part of the key: they are refreshed from the block being rendered on
+ * each hit, so that karaoke and live captions only blend cached glyphs.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct vlc_layoutcache_t vlc_layoutcache_t;
+
+typedef struct
+{
+    line_desc_t *p_lines;
+    FT_BBox      bbox;
+    int          i_max_face_height;
+} vlc_layoutcache_block_t;
+
+vlc_layoutcache_t * vlc_layoutcache_New( vlc_object_t *, size_t i_max_size );
+void vlc_layoutcache_Delete( vlc_layoutcache_t * );
+
+/**
+ * Returns the key of a text block, or NULL if the block can not be cached
+ */
+char * vlc_layoutcache_GetKey( filter_t *, const layout_text_block_t * );
+
+/**
+ * Looks up a laid out block.
+ *
+ * The styles of the returned lines are updated with the colors of the
+ * styles of \p p_textblock. The block stays valid until the next insertion.
+ */
+const vlc_layoutcache_block_t *
+vlc_layoutcache_Get( vlc_layoutcache_t *, const char *psz_key,
+                     const layout_text_block_t *p_textblock );
+
+/**
+ * Stores laid out lines.
+ *
+ * On success, the cache owns the lines, and their styles are replaced
+ * with copies owned by the cache.
+ */
+int vlc_layoutcache_Insert( vlc_layoutcache_t *, const char *psz_key,
+                            const layout_text_block_t *p_textblock,
+                            line_desc_t *p_lines, const FT_BBox *p_bbox,
+                            int i_max_face_height );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -34,6 +34,8 @@
 #include <vlc_mouse.h>
 #include <vlc_picture.h>
 
+#include "chain_fused.h"
+
 /*****************************************************************************
  * Module descriptor
  *****************************************************************************/
@@ -111,6 +113,7 @@ static const vlc_fourcc_t *get_allowed_chromas( filter_t *p_filter )
 
 typedef struct
 {
+    chroma_fused_t *p_fused;
     filter_chain_t *p_chain;
     filter_t *p_video_filter;
     struct vlc_filter_operations custom_ops;
@@ -156,6 +159,64 @@ static const struct vlc_filter_operations filter_ops = {
     .filter_video = Chain, .flush = Flush, .close = Destroy,
 };
 
+/*****************************************************************************
+ * Fused resize and chroma conversion
+ *****************************************************************************/
+static picture_t *Fused( filter_t *p_filter, picture_t *p_pic )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    picture_t *p_outpic = filter_NewPicture( p_filter );
+    if( p_outpic )
+    {
+        chroma_fused_Convert( p_sys->p_fused, p_outpic, p_pic );
+        picture_CopyProperties( p_outpic, p_pic );
+    }
+    picture_Release( p_pic );
+    return p_outpic;
+}
+
+static void DestroyFused( filter_t *p_filter )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    chroma_fused_Delete( p_sys->p_fused );
+    free( p_sys );
+}
+
+static const struct vlc_filter_operations filter_fused_ops = {
+    .filter_video = Fused, .close = DestroyFused,
+};
+
+static int ActivateFused( filter_t *p_filter )
+{
+    if( p_filter->vctx_in != NULL )
+        return VLC_EGENERIC;
+
+    const video_format_t *p_fmt_in = &p_filter->fmt_in.video;
+    const video_format_t *p_fmt_out = &p_filter->fmt_out.video;
+    chroma_fused_t *p_fused = chroma_fused_New( p_fmt_in, p_fmt_out,
+                                                CHROMA_FUSED_BICUBIC );
+    if( p_fused == NULL )
+        return VLC_EGENERIC;
+
+    filter_sys_t *p_sys = p_filter->p_sys = calloc( 1, sizeof( *p_sys ) );
+    if( !p_sys )
+    {
+        chroma_fused_Delete( p_fused );
+        return VLC_ENOMEM;
+    }
+    p_sys->p_fused = p_fused;
+
+    msg_Dbg( p_filter, "single pass %4.4s %ux%u -> %4.4s %ux%u",
+             (const char *)&p_fmt_in->i_chroma,
+             p_fmt_in->i_visible_width, p_fmt_in->i_visible_height,
+             (const char *)&p_fmt_out->i_chroma,
+             p_fmt_out->i_visible_width, p_fmt_out->i_visible_height );
+    p_filter->ops = &filter_fused_ops;
+    return VLC_SUCCESS;
+}
+
 /*****************************************************************************
  * Activate: allocate a chroma function
  *****************************************************************************
@@ -233,6 +294,11 @@ static int ActivateConverter( filter_t *p_filter )
     if( !b_chroma && !b_chroma_resize && !b_transform)
         return VLC_EGENERIC;
 
+    /* Common pairs are resized and converted without intermediate pictures */
+    if( b_chroma_resize && !b_transform &&
+        ActivateFused( p_filter ) == VLC_SUCCESS )
+        return VLC_SUCCESS;
+
     return Activate( p_filter, b_transform ? BuildTransformChain :
                                b_chroma_resize ? BuildChromaResize :
                                BuildChromaChain );
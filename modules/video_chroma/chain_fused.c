@@ -0,0 +1,561 @@
+/*****************************************************************************
+ * chain_fused.c : single pass resize and chroma conversion
+ *****************************************************************************
+ * Copyright (C) 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <math.h>
+#include <stdlib.h>
+
+#include <vlc_common.h>
+#include <vlc_picture.h>
+
+#include "chain_fused.h"
+
+/* Samples are processed with 14 bits of precision, filter coefficients
+ * have 14 fractional bits */
+#define SAMPLE_BITS 14
+#define COEF_BITS   14
+#define COEF_ONE    (1 << COEF_BITS)
+
+typedef struct
+{
+    unsigned taps;
+    int *start;         /**< first source sample per output sample */
+    int16_t *coefs;     /**< taps coefficients per output sample */
+} fused_filter_t;
+
+typedef struct
+{
+    /* Source samples */
+    unsigned plane;
+    unsigned offset;    /**< first sample in the row, in samples */
+    unsigned step;      /**< distance between samples, in samples */
+    unsigned src_w;
+    unsigned src_h;
+
+    unsigned dst_w;
+    unsigned dst_h;
+    fused_filter_t hfilter;
+    fused_filter_t vfilter;
+
+    int16_t *line;      /**< source row, src_w wide */
+    int16_t *ring;      /**< resized source rows, vfilter.taps x dst_w */
+    int16_t **rows;     /**< rows of the ring for the current output row */
+    unsigned next_row;  /**< first source row not in the ring yet */
+    int32_t *acc;       /**< vertical accumulator, dst_w wide */
+    int16_t *out;       /**< resized row, dst_w wide */
+} fused_channel_t;
+
+enum fused_output
+{
+    OUTPUT_PLANAR,      /**< I420 */
+    OUTPUT_SEMIPLANAR,  /**< NV12 */
+    OUTPUT_RGBA,
+    OUTPUT_BGRA,
+};
+
+struct chroma_fused
+{
+    bool high_depth;            /**< 16-bits source samples */
+    enum fused_output output;
+    fused_channel_t channels[3];
+
+    /* Offsets of the visible area, in luma samples */
+    unsigned src_x, src_y;
+    unsigned dst_x, dst_y;
+
+    /* YUV to RGB matrix */
+    int y_offset;
+    int cy, crv, cgu, cgv, cbu;
+};
+
+/*****************************************************************************
+ * Filters
+ *****************************************************************************/
+static double Kernel(double x, bool bicubic)
+{
+    x = fabs(x);
+    if (!bicubic)
+        return x < 1. ? 1. - x : 0.;
+
+    /* Catmull-Rom */
+    if (x < 1.)
+        return 1.5 * x * x * x - 2.5 * x * x + 1.;
+    if (x < 2.)
+        return -.5 * x * x * x + 2.5 * x * x - 4. * x + 2.;
+    return 0.;
+}
+
+static void FilterClean(fused_filter_t *f)
+{
+    free(f->start);
+    free(f->coefs);
+}
+
+/* The kernel is widened when downscaling, so that every source sample
+ * contributes to the output */
+static int FilterInit(fused_filter_t *f, unsigned src, unsigned dst,
+                      bool bicubic)
+{
+    const double ratio = (double)src / dst;
+    const double scale = ratio > 1. ? ratio : 1.;
+    const double radius = (bicubic ? 2. : 1.) * scale;
+    unsigned taps = ceil(2. * radius);
+
+    if (taps > src)
+        return VLC_EGENERIC;
+
+    f->taps = taps;
+    f->start = vlc_alloc(dst, sizeof (*f->start));
+    f->coefs = vlc_alloc(dst, taps * sizeof (*f->coefs));
+    if (unlikely(f->start == NULL || f->coefs == NULL))
+    {
+        FilterClean(f);
+        return VLC_ENOMEM;
+    }
+
+    double weights[taps];
+
+    for (unsigned i = 0; i < dst; i++)
+    {
+        const double center = (i + .5) * ratio - .5;
+        const int first = floor(center - radius) + 1;
+        const int start = VLC_CLIP(first, 0, (int)(src - taps));
+        double sum = 0.;
+
+        for (unsigned k = 0; k < taps; k++)
+            weights[k] = 0.;
+
+        /* Samples out of the picture are folded onto its edges */
+        for (unsigned k = 0; k < taps; k++)
+        {
+            const int pos = first + (int)k;
+            const int idx = VLC_CLIP(pos, 0, (int)src - 1) - start;
+            const double w = Kernel((pos - center) / scale, bicubic);
+
+            weights[idx] += w;
+            sum += w;
+        }
+
+        /* Quantize, keeping the sum exact */
+        int16_t *coefs = &f->coefs[i * taps];
+        int total = 0;
+        unsigned max = 0;
+
+        for (unsigned k = 0; k < taps; k++)
+        {
+            coefs[k] = lround(weights[k] / sum * COEF_ONE);
+            total += coefs[k];
+            if (coefs[k] > coefs[max])
+                max = k;
+        }
+        coefs[max] += COEF_ONE - total;
+        f->start[i] = start;
+    }
+    return VLC_SUCCESS;
+}
+
+/*****************************************************************************
+ * Row processing
+ *****************************************************************************/
+static inline void LoadU8(int16_t *restrict dst, const uint8_t *src,
+                          unsigned step, unsigned width)
+{
+    for (unsigned x = 0; x < width; x++)
+        dst[x] = src[x * step] << (SAMPLE_BITS - 8);
+}
+
+static inline void LoadU16(int16_t *restrict dst, const uint8_t *src,
+                           unsigned step, unsigned width)
+{
+    for (unsigned x = 0; x < width; x++)
+        dst[x] = ((const uint16_t *)src)[x * step] >> (16 - SAMPLE_BITS);
+}
+
+/* Constant steps let the compiler vectorize the loops */
+static void Load(int16_t *restrict dst, const uint8_t *src, unsigned step,
+                 bool high_depth, unsigned width)
+{
+    if (high_depth)
+    {
+        if (step == 1)
+            LoadU16(dst, src, 1, width);
+        else
+            LoadU16(dst, src, 2, width);
+    }
+    else
+    {
+        if (step == 1)
+            LoadU8(dst, src, 1, width);
+        else
+            LoadU8(dst, src, 2, width);
+    }
+}
+
+static inline void HorizontalN(int16_t *restrict dst, const int16_t *src,
+                               const fused_filter_t *f, unsigned width,
+                               unsigned taps)
+{
+    for (unsigned x = 0; x < width; x++)
+    {
+        const int16_t *in = src + f->start[x];
+        const int16_t *coefs = &f->coefs[x * taps];
+        int sum = 0;
+
+        for (unsigned k = 0; k < taps; k++)
+            sum += in[k] * coefs[k];
+        dst[x] = (sum + (COEF_ONE >> 1)) >> COEF_BITS;
+    }
+}
+
+static void Horizontal(int16_t *restrict dst, const int16_t *src,
+                       const fused_filter_t *f, unsigned width)
+{
+    /* Unrolled for the usual bilinear and bicubic sizes */
+    switch (f->taps)
+    {
+        case 2:
+            HorizontalN(dst, src, f, width, 2);
+            break;
+        case 4:
+            HorizontalN(dst, src, f, width, 4);
+            break;
+        case 8:
+            HorizontalN(dst, src, f, width, 8);
+            break;
+        default:
+            HorizontalN(dst, src, f, width, f->taps);
+            break;
+    }
+}
+
+static void Vertical(int16_t *restrict dst, int32_t *restrict acc,
+                     int16_t *const *rows, const int16_t *coefs,
+                     unsigned taps, unsigned width)
+{
+    for (unsigned x = 0; x < width; x++)
+        acc[x] = rows[0][x] * coefs[0];
+    for (unsigned k = 1; k < taps; k++)
+    {
+        const int16_t *row = rows[k];
+        const int c = coefs[k];
+
+        for (unsigned x = 0; x < width; x++)
+            acc[x] += row[x] * c;
+    }
+    for (unsigned x = 0; x < width; x++)
+        dst[x] = (acc[x] + (COEF_ONE >> 1)) >> COEF_BITS;
+}
+
+/* Computes the resized row y of a channel into channel->out. Each source
+ * row is only resized horizontally once, into the ring which holds the rows
+ * of the vertical filter, as the output rows go down. */
+static void ChannelRow(const chroma_fused_t *fused, fused_channel_t *ch,
+                       const picture_t *src, unsigned y)
+{
+    const plane_t *plane = &src->p[ch->plane];
+    const fused_filter_t *v = &ch->vfilter;
+    const unsigned sample_size = fused->high_depth ? 2 : 1;
+    const unsigned chroma = ch->plane > 0;
+    const unsigned x0 = chroma ? fused->src_x / 2 : fused->src_x;
+    const unsigned y0 = chroma ? fused->src_y / 2 : fused->src_y;
+    const unsigned start = v->start[y], end = start + v->taps;
+
+    for (unsigned r = __MAX(ch->next_row, start); r < end; r++)
+    {
+        const uint8_t *in = plane->p_pixels + (y0 + r) * plane->i_pitch
+                          + (x0 * ch->step + ch->offset) * sample_size;
+
+        Load(ch->line, in, ch->step, fused->high_depth, ch->src_w);
+        Horizontal(&ch->ring[(r % v->taps) * ch->dst_w], ch->line,
+                   &ch->hfilter, ch->dst_w);
+    }
+    ch->next_row = __MAX(ch->next_row, end);
+
+    for (unsigned k = 0; k < v->taps; k++)
+        ch->rows[k] = &ch->ring[((start + k) % v->taps) * ch->dst_w];
+    Vertical(ch->out, ch->acc, ch->rows, &v->coefs[y * v->taps], v->taps,
+             ch->dst_w);
+}
+
+static inline uint8_t To8(int v)
+{
+    return clip_uint8_vlc((v + (1 << (SAMPLE_BITS - 9))) >> (SAMPLE_BITS - 8));
+}
+
+static void StoreRow(uint8_t *restrict dst, unsigned step,
+                     const int16_t *src, unsigned width)
+{
+    for (unsigned x = 0; x < width; x++)
+        dst[x * step] = To8(src[x]);
+}
+
+static void StoreRGB(const chroma_fused_t *fused, uint8_t *restrict dst,
+                     unsigned width, bool bgr)
+{
+    const int16_t *ly = fused->channels[0].out;
+    const int16_t *lu = fused->channels[1].out;
+    const int16_t *lv = fused->channels[2].out;
+    const int coff = 1 << (SAMPLE_BITS - 1);
+    const int shift = COEF_BITS + SAMPLE_BITS - 8;
+    const int round = 1 << (shift - 1);
+    const unsigned ri = bgr ? 2 : 0, bi = bgr ? 0 : 2;
+
+    for (unsigned x = 0; x < width; x++)
+    {
+        const int y = fused->cy * (ly[x] - fused->y_offset) + round;
+        const int u = lu[x] - coff;
+        const int v = lv[x] - coff;
+
+        dst[4 * x + ri] = clip_uint8_vlc((y + fused->crv * v) >> shift);
+        dst[4 * x + 1] = clip_uint8_vlc((y - fused->cgu * u - fused->cgv * v)
+                                        >> shift);
+        dst[4 * x + bi] = clip_uint8_vlc((y + fused->cbu * u) >> shift);
+        dst[4 * x + 3] = 0xff;
+    }
+}
+
+/*****************************************************************************
+ * Setup
+ *****************************************************************************/
+static bool IsFullRange(const video_format_t *fmt)
+{
+    return fmt->color_range == COLOR_RANGE_FULL
+        || fmt->i_chroma == VLC_CODEC_J420;
+}
+
+static void SetMatrix(chroma_fused_t *fused, const video_format_t *in)
+{
+    video_format_t fmt = *in;
+    double kr, kb;
+
+    video_format_AdjustColorSpace(&fmt);
+    switch (fmt.space)
+    {
+        case COLOR_SPACE_BT2020:
+            kr = .2627;
+            kb = .0593;
+            break;
+        case COLOR_SPACE_BT709:
+            kr = .2126;
+            kb = .0722;
+            break;
+        default:
+            kr = .299;
+            kb = .114;
+            break;
+    }
+
+    const bool full = IsFullRange(&fmt);
+    const double ys = full ? 1. : 255. / 219.;
+    const double cs = full ? 1. : 255. / 224.;
+    const double kg = 1. - kr - kb;
+
+    fused->y_offset = full ? 0 : 16 << (SAMPLE_BITS - 8);
+    fused->cy  = lround(ys * COEF_ONE);
+    fused->crv = lround(cs * 2. * (1. - kr) * COEF_ONE);
+    fused->cgu = lround(cs * 2. * kb * (1. - kb) / kg * COEF_ONE);
+    fused->cgv = lround(cs * 2. * kr * (1. - kr) / kg * COEF_ONE);
+    fused->cbu = lround(cs * 2. * (1. - kb) * COEF_ONE);
+}
+
+void chroma_fused_Delete(chroma_fused_t *fused)
+{
+    for (unsigned i = 0; i < 3; i++)
+    {
+        fused_channel_t *ch = &fused->channels[i];
+
+        FilterClean(&ch->hfilter);
+        FilterClean(&ch->vfilter);
+        free(ch->line);
+        free(ch->ring);
+        free(ch->rows);
+        free(ch->acc);
+        free(ch->out);
+    }
+    free(fused);
+}
+
+chroma_fused_t *chroma_fused_New(const video_format_t *in,
+                                 const video_format_t *out, int scaler)
+{
+    bool semiplanar, high_depth;
+    enum fused_output output;
+
+    switch (in->i_chroma)
+    {
+        case VLC_CODEC_I420:
+        case VLC_CODEC_J420:
+            semiplanar = false;
+            high_depth = false;
+            break;
+        case VLC_CODEC_NV12:
+            semiplanar = true;
+            high_depth = false;
+            break;
+        case VLC_CODEC_P010:
+            semiplanar = true;
+            high_depth = true;
+            break;
+        default:
+            return NULL;
+    }
+
+    switch (out->i_chroma)
+    {
+        case VLC_CODEC_I420:
+            output = OUTPUT_PLANAR;
+            break;
+        case VLC_CODEC_NV12:
+            output = OUTPUT_SEMIPLANAR;
+            break;
+        case VLC_CODEC_RGBA:
+            output = OUTPUT_RGBA;
+            break;
+        case VLC_CODEC_BGRA:
+            output = OUTPUT_BGRA;
+            break;
+        default:
+            return NULL;
+    }
+
+    if (in->i_visible_width == 0 || in->i_visible_height == 0
+     || out->i_visible_width == 0 || out->i_visible_height == 0)
+        return NULL;
+
+    const bool rgb = output == OUTPUT_RGBA || output == OUTPUT_BGRA;
+
+    /* YUV samples are copied as is, without any range conversion */
+    if (!rgb && IsFullRange(in) != IsFullRange(out))
+        return NULL;
+
+    chroma_fused_t *fused = calloc(1, sizeof (*fused));
+    if (unlikely(fused == NULL))
+        return NULL;
+
+    fused->high_depth = high_depth;
+    fused->output = output;
+    fused->src_x = in->i_x_offset;
+    fused->src_y = in->i_y_offset;
+    fused->dst_x = out->i_x_offset;
+    fused->dst_y = out->i_y_offset;
+
+    const bool bicubic = scaler == CHROMA_FUSED_BICUBIC;
+
+    for (unsigned i = 0; i < 3; i++)
+    {
+        fused_channel_t *ch = &fused->channels[i];
+
+        if (i == 0)
+        {
+            ch->plane = 0;
+            ch->step = 1;
+            ch->src_w = in->i_visible_width;
+            ch->src_h = in->i_visible_height;
+        }
+        else
+        {
+            ch->plane = semiplanar ? 1 : i;
+            ch->offset = semiplanar ? i - 1 : 0;
+            ch->step = semiplanar ? 2 : 1;
+            ch->src_w = (in->i_visible_width + 1) / 2;
+            ch->src_h = (in->i_visible_height + 1) / 2;
+        }
+
+        if (i == 0 || rgb)
+        {
+            ch->dst_w = out->i_visible_width;
+            ch->dst_h = out->i_visible_height;
+        }
+        else
+        {
+            ch->dst_w = (out->i_visible_width + 1) / 2;
+            ch->dst_h = (out->i_visible_height + 1) / 2;
+        }
+
+        if (FilterInit(&ch->hfilter, ch->src_w, ch->dst_w, bicubic)
+         || FilterInit(&ch->vfilter, ch->src_h, ch->dst_h, bicubic))
+            goto error;
+
+        ch->line = vlc_alloc(ch->src_w, sizeof (*ch->line));
+        ch->ring = vlc_alloc(ch->vfilter.taps,
+                             ch->dst_w * sizeof (*ch->ring));
+        ch->rows = vlc_alloc(ch->vfilter.taps, sizeof (*ch->rows));
+        ch->acc = vlc_alloc(ch->dst_w, sizeof (*ch->acc));
+        ch->out = vlc_alloc(ch->dst_w, sizeof (*ch->out));
+        if (unlikely(ch->line == NULL || ch->ring == NULL || ch->rows == NULL
+                  || ch->acc == NULL || ch->out == NULL))
+            goto error;
+    }
+
+    if (rgb)
+        SetMatrix(fused, in);
+    return fused;
+
+error:
+    chroma_fused_Delete(fused);
+    return NULL;
+}
+
+void chroma_fused_Convert(chroma_fused_t *fused, picture_t *dst,
+                          const picture_t *src)
+{
+    for (unsigned i = 0; i < 3; i++)
+        fused->channels[i].next_row = 0;
+
+    if (fused->output == OUTPUT_RGBA || fused->output == OUTPUT_BGRA)
+    {
+        const plane_t *plane = &dst->p[0];
+        uint8_t *out = plane->p_pixels + fused->dst_y * plane->i_pitch
+                     + fused->dst_x * 4;
+
+        for (unsigned y = 0; y < fused->channels[0].dst_h; y++)
+        {
+            for (unsigned i = 0; i < 3; i++)
+                ChannelRow(fused, &fused->channels[i], src, y);
+            StoreRGB(fused, out, fused->channels[0].dst_w,
+                     fused->output == OUTPUT_BGRA);
+            out += plane->i_pitch;
+        }
+        return;
+    }
+
+    /* YUV outputs: each channel is resized on its own */
+    for (unsigned i = 0; i < 3; i++)
+    {
+        fused_channel_t *ch = &fused->channels[i];
+        const bool semiplanar = i > 0 && fused->output == OUTPUT_SEMIPLANAR;
+        const plane_t *plane = &dst->p[semiplanar ? 1 : i];
+        const unsigned step = semiplanar ? 2 : 1;
+        const unsigned x0 = i > 0 ? fused->dst_x / 2 : fused->dst_x;
+        const unsigned y0 = i > 0 ? fused->dst_y / 2 : fused->dst_y;
+        uint8_t *out = plane->p_pixels + y0 * plane->i_pitch + x0 * step
+                     + (semiplanar ? i - 1 : 0);
+
+        for (unsigned y = 0; y < ch->dst_h; y++)
+        {
+            ChannelRow(fused, ch, src, y);
+            StoreRow(out, step, ch->out, ch->dst_w);
+            out += plane->i_pitch;
+        }
+    }
+}
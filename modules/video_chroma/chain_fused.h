@@ -0,0 +1,58 @@
+/*****************************************************************************
+ * chain_fused.h : single pass resize and chroma conversion
+ *****************************************************************************
+ * Copyright (C) 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_CHROMA_CHAIN_FUSED_H
+#define VLC_CHROMA_CHAIN_FUSED_H 1
+
+/**
+ * \file
+ * Resizes and converts pictures in one pass, row by row, for the most
+ * common pairs of formats (NV12/I420/P010 to I420/NV12/RGBA/BGRA), so that
+ * no intermediate picture needs to be allocated.
+ *
+ * Each source row is resized horizontally once, then each output row is
+ * filtered vertically from the resized rows, then packed to the output
+ * format.
+ */
+
+typedef struct chroma_fused chroma_fused_t;
+
+enum chroma_fused_scaler
+{
+    CHROMA_FUSED_BILINEAR = 0,
+    CHROMA_FUSED_BICUBIC,
+};
+
+/**
+ * Creates a fused converter.
+ *
+ * YUV to YUV conversions are only handled between formats of the same
+ * color range.
+ *
+ * \return a converter, or NULL if the pair of formats is not handled
+ */
+chroma_fused_t *chroma_fused_New(const video_format_t *in,
+                                 const video_format_t *out, int scaler);
+void chroma_fused_Delete(chroma_fused_t *);
+
+void chroma_fused_Convert(chroma_fused_t *, picture_t *dst,
+                          const picture_t *src);
+
+#endif
@@ -34,6 +34,7 @@
 #include <vlc_filter.h>
 #include <vlc_picture.h>
 #include <vlc_cpu.h>
+#include <vlc_executor.h>
 
 #include <libswscale/swscale.h>
 #include <libswscale/version.h>
@@ -64,6 +65,11 @@ static const char *const ppsz_mode_descriptions[] =
   N_("Area"), N_("Luma bicubic / chroma bilinear"), N_("Gauss"),
   N_("SincR"), N_("Lanczos"), N_("Bicubic spline") };
 
+#define THREADS_TEXT N_("Scaling threads")
+#define THREADS_LONGTEXT N_("Number of threads used to scale a picture. " \
+    "Each thread scales a horizontal band of the picture with its own " \
+    "context (0 for one thread per CPU).")
+
 vlc_module_begin ()
     set_description( N_("Video scaling filter") )
     set_shortname( N_("Swscale" ) )
@@ -72,6 +78,8 @@ vlc_module_begin ()
     set_callback_video_converter( OpenScaler, 150 )
     add_integer( "swscale-mode", 2, SCALEMODE_TEXT, SCALEMODE_LONGTEXT, true )
         change_integer_list( pi_mode_values, ppsz_mode_descriptions )
+    add_integer_with_range( "swscale-threads", 1, 0, 32,
+                            THREADS_TEXT, THREADS_LONGTEXT, true )
 vlc_module_end ()
 
 /* Version checking */
@@ -79,6 +87,31 @@ vlc_module_end ()
  * Local prototypes
  ****************************************************************************/
 
+/**
+ * Horizontal band of the output picture scaled by one thread.
+ *
+ * The band is scaled with some extra lines above and below into a private
+ * picture, so that the filter taps see the same source lines as when the
+ * whole picture is scaled at once, then only its own lines are copied out.
+ */
+typedef struct
+{
+    struct vlc_runnable runnable;
+    filter_t *p_filter;
+    struct SwsContext *ctx;
+    picture_t *p_tmp;
+
+    unsigned i_src_y;   /* first source line */
+    unsigned i_src_h;   /* source lines */
+    unsigned i_tmp_y;   /* output line of the first line of p_tmp */
+    unsigned i_dst_y;   /* first output line owned by the band */
+    unsigned i_dst_h;   /* output lines owned by the band */
+
+    picture_t *p_src;
+    picture_t *p_dst;
+    int i_plane_count;
+} scaler_slice_t;
+
 /**
  * Internal swscale filter structure.
  */
@@ -103,6 +136,11 @@ typedef struct
     bool b_copy;
     bool b_swap_uvi;
     bool b_swap_uvo;
+
+    vlc_executor_t *executor;
+    unsigned i_threads;
+    scaler_slice_t *slices;
+    unsigned i_slices;
 } filter_sys_t;
 
 static picture_t *Filter( filter_t *, picture_t * );
@@ -127,12 +165,17 @@ static int GetParameters( ScalerConfiguration *,
                           int i_sws_flags_default );
 
 static int GetSwsCpuMask(void);
+static int InitSlices( filter_t *, const ScalerConfiguration * );
+static void CleanSlices( filter_sys_t * );
+static void ScaleSlice( void * );
 
 /* SwScaler point resize quality seems really bad, let our scale module do it
  * (change it to true to try) */
 #define ALLOW_YUVP (false)
 /* SwScaler does not like too small picture */
 #define MINIMUM_WIDTH (32)
+/* Do not split pictures in bands smaller than this (output lines) */
+#define MINIMUM_SLICE_HEIGHT (64)
 
 /* XXX is it always 3 even for BIG_ENDIAN (blend.c seems to think so) ? */
 #define OFFSET_A (3)
@@ -180,12 +223,25 @@ static int OpenScaler( filter_t *p_filter )
     default: p_sys->i_sws_flags = SWS_BICUBIC; i_sws_mode = 2; break;
     }
 
+    int i_threads = var_CreateGetInteger( p_filter, "swscale-threads" );
+    if( i_threads <= 0 )
+        i_threads = vlc_GetCPUCount();
+    p_sys->i_threads = VLC_CLIP( i_threads, 1, 32 );
+    if( p_sys->i_threads > 1 )
+    {
+        p_sys->executor = vlc_executor_New( p_sys->i_threads );
+        if( p_sys->executor == NULL )
+            p_sys->i_threads = 1;
+    }
+
     /* Misc init */
     memset( &p_sys->fmt_in,  0, sizeof(p_sys->fmt_in) );
     memset( &p_sys->fmt_out, 0, sizeof(p_sys->fmt_out) );
 
     if( Init( p_filter ) )
     {
+        if( p_sys->executor )
+            vlc_executor_Delete( p_sys->executor );
         if( p_sys->p_filter )
             sws_freeFilter( p_sys->p_filter );
         free( p_sys );
@@ -195,14 +251,14 @@ static int OpenScaler( filter_t *p_filter )
     /* */
     p_filter->ops = &filter_ops;
 
-    msg_Dbg( p_filter, "%ix%i (%ix%i) chroma: %4.4s -> %ix%i (%ix%i) chroma: %4.4s with scaling using %s",
+    msg_Dbg( p_filter, "%ix%i (%ix%i) chroma: %4.4s -> %ix%i (%ix%i) chroma: %4.4s with scaling using %s in %u band(s)",
              p_filter->fmt_in.video.i_visible_width, p_filter->fmt_in.video.i_visible_height,
              p_filter->fmt_in.video.i_width, p_filter->fmt_in.video.i_height,
              (char *)&p_filter->fmt_in.video.i_chroma,
              p_filter->fmt_out.video.i_visible_width, p_filter->fmt_out.video.i_visible_height,
              p_filter->fmt_out.video.i_width, p_filter->fmt_out.video.i_height,
              (char *)&p_filter->fmt_out.video.i_chroma,
-             ppsz_mode_descriptions[i_sws_mode] );
+             ppsz_mode_descriptions[i_sws_mode], __MAX( p_sys->i_slices, 1u ) );
 
     return VLC_SUCCESS;
 }
@@ -215,6 +271,8 @@ static void CloseScaler( filter_t *p_filter )
     filter_sys_t *p_sys = p_filter->p_sys;
 
     Clean( p_filter );
+    if( p_sys->executor )
+        vlc_executor_Delete( p_sys->executor );
     if( p_sys->p_filter )
         sws_freeFilter( p_sys->p_filter );
     free( p_sys );
@@ -435,6 +493,11 @@ static int Init( filter_t *p_filter )
         return VLC_EGENERIC;
     }
 
+    /* Small and padded pictures are not worth splitting */
+    if( p_sys->i_threads > 1 && !cfg.b_copy && p_sys->i_extend_factor == 1 &&
+        InitSlices( p_filter, &cfg ) )
+        msg_Warn( p_filter, "could not split scaling, using a single thread" );
+
     if (p_filter->b_allow_fmt_out_change)
     {
         /*
@@ -465,10 +528,157 @@ static int Init( filter_t *p_filter )
     return VLC_SUCCESS;
 }
 
+/* Half the number of taps of the vertical filter chosen by swscale for
+ * each scaling mode, in source lines at ratio 1 */
+static unsigned GetFilterRadius( int i_sws_flags )
+{
+    if( i_sws_flags & (SWS_SINC | SWS_SPLINE) )
+        return 10;
+    if( i_sws_flags & (SWS_X | SWS_GAUSS) )
+        return 4;
+    if( i_sws_flags & SWS_LANCZOS )
+        return 3;
+    if( i_sws_flags & (SWS_BICUBIC | SWS_BICUBLIN) )
+        return 2;
+    return 1;
+}
+
+static unsigned GetVerticalSubsampling( const vlc_chroma_description_t *desc,
+                                        unsigned i_plane )
+{
+    const unsigned i = __MIN( i_plane, desc->plane_count - 1 );
+    return desc->p[i].h.den / desc->p[i].h.num;
+}
+
+/* Source lines, in luma lines, scaled on each side of a band and thrown away
+ * afterwards, so that the filter taps at the band limits lie within the
+ * band. Subsampled planes are scaled at their own ratio, and each of their
+ * lines spans several luma lines, so every pair of source and output planes
+ * is checked. */
+static unsigned GetMargin( const filter_sys_t *p_sys, int i_sws_flags,
+                           unsigned i_src_height, unsigned i_dst_height )
+{
+    const unsigned i_radius = GetFilterRadius( i_sws_flags );
+    const unsigned i_planes = __MAX( p_sys->desc_in->plane_count,
+                                     p_sys->desc_out->plane_count );
+    unsigned i_margin = 0;
+
+    for( unsigned i = 0; i < i_planes; i++ )
+    {
+        const unsigned i_sub_in = GetVerticalSubsampling( p_sys->desc_in, i );
+        const unsigned i_sub_out = GetVerticalSubsampling( p_sys->desc_out, i );
+        const unsigned i_src = (i_src_height + i_sub_in - 1) / i_sub_in;
+        const unsigned i_dst = (i_dst_height + i_sub_out - 1) / i_sub_out;
+        const unsigned i_lines = i_radius * ((i_src + i_dst - 1) / i_dst) + 2;
+
+        i_margin = __MAX( i_margin, i_lines * i_sub_in );
+    }
+    return i_margin;
+}
+
+static unsigned GetMaxVerticalSubsampling( const vlc_chroma_description_t *desc )
+{
+    unsigned i_max = 1;
+    for( unsigned i = 0; i < desc->plane_count; i++ )
+        i_max = __MAX( i_max, desc->p[i].h.den / desc->p[i].h.num );
+    return i_max;
+}
+
+static int InitSlices( filter_t *p_filter, const ScalerConfiguration *p_cfg )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    const video_format_t *p_fmti = &p_filter->fmt_in.video;
+    const video_format_t *p_fmto = &p_filter->fmt_out.video;
+    const unsigned i_src_height = p_fmti->i_visible_height;
+    const unsigned i_dst_height = p_fmto->i_visible_height;
+
+    /* Band limits must map to whole lines of every plane, both in the source
+     * and in the output, hence multiples of the reduced scaling ratio times
+     * the chroma subsampling. */
+    unsigned i_num, i_den;
+    if( !vlc_ureduce( &i_num, &i_den, i_src_height, i_dst_height, 0 ) )
+        return VLC_EGENERIC;
+    const unsigned i_align = __MAX( GetMaxVerticalSubsampling( p_sys->desc_in ),
+                                    GetMaxVerticalSubsampling( p_sys->desc_out ) );
+    const uint64_t i_src_step = (uint64_t)i_align * i_num;
+    const uint64_t i_dst_step = (uint64_t)i_align * i_den;
+
+    unsigned i_slices = p_sys->i_threads;
+    if( i_dst_height / __MAX( i_dst_step, MINIMUM_SLICE_HEIGHT ) < i_slices )
+        i_slices = i_dst_height / __MAX( i_dst_step, MINIMUM_SLICE_HEIGHT );
+    if( i_slices < 2 )
+        return VLC_SUCCESS;
+
+    const uint64_t i_margin_src = GetMargin( p_sys, p_cfg->i_sws_flags,
+                                             i_src_height, i_dst_height );
+    const uint64_t i_margin = (i_margin_src + i_src_step - 1) / i_src_step * i_dst_step;
+
+    p_sys->slices = calloc( i_slices, sizeof(*p_sys->slices) );
+    if( p_sys->slices == NULL )
+        return VLC_ENOMEM;
+
+    for( unsigned i = 0; i < i_slices; i++ )
+    {
+        scaler_slice_t *slice = &p_sys->slices[i];
+        const uint64_t i_begin = (uint64_t)i * i_dst_height / i_slices
+                               / i_dst_step * i_dst_step;
+        const uint64_t i_end = i + 1 < i_slices
+                             ? (uint64_t)(i + 1) * i_dst_height / i_slices
+                               / i_dst_step * i_dst_step
+                             : i_dst_height;
+        const uint64_t i_tmp_begin = i_begin > i_margin ? i_begin - i_margin : 0;
+        const uint64_t i_tmp_end = __MIN( i_end + i_margin, i_dst_height );
+        const uint64_t i_src_end = i_tmp_end < i_dst_height
+                                 ? i_tmp_end / i_den * i_num : i_src_height;
+
+        slice->p_filter = p_filter;
+        slice->i_src_y = i_tmp_begin / i_den * i_num;
+        slice->i_src_h = i_src_end - slice->i_src_y;
+        slice->i_tmp_y = i_tmp_begin;
+        slice->i_dst_y = i_begin;
+        slice->i_dst_h = i_end - i_begin;
+        slice->runnable.run = ScaleSlice;
+        slice->runnable.userdata = slice;
+
+        slice->ctx = sws_getContext( p_fmti->i_visible_width, slice->i_src_h,
+                                     p_cfg->i_fmti,
+                                     p_fmto->i_visible_width,
+                                     i_tmp_end - i_tmp_begin, p_cfg->i_fmto,
+                                     p_cfg->i_sws_flags | p_sys->i_cpu_mask,
+                                     p_sys->p_filter, NULL, 0 );
+        slice->p_tmp = picture_New( p_fmto->i_chroma, p_fmto->i_visible_width,
+                                    i_tmp_end - i_tmp_begin, 1, 1 );
+        p_sys->i_slices++;
+        if( slice->ctx == NULL || slice->p_tmp == NULL )
+        {
+            CleanSlices( p_sys );
+            return VLC_EGENERIC;
+        }
+    }
+    return VLC_SUCCESS;
+}
+
+static void CleanSlices( filter_sys_t *p_sys )
+{
+    for( unsigned i = 0; i < p_sys->i_slices; i++ )
+    {
+        scaler_slice_t *slice = &p_sys->slices[i];
+        if( slice->ctx )
+            sws_freeContext( slice->ctx );
+        if( slice->p_tmp )
+            picture_Release( slice->p_tmp );
+    }
+    free( p_sys->slices );
+    p_sys->slices = NULL;
+    p_sys->i_slices = 0;
+}
+
 static void Clean( filter_t *p_filter )
 {
     filter_sys_t *p_sys = p_filter->p_sys;
 
+    CleanSlices( p_sys );
+
     if( p_sys->p_src_e )
         picture_Release( p_sys->p_src_e );
     if( p_sys->p_dst_e )
@@ -582,7 +792,8 @@ static void SwapUV( picture_t *p_dst, const picture_t *p_src )
 }
 
 static void Convert( filter_t *p_filter, struct SwsContext *ctx,
-                     picture_t *p_dst, picture_t *p_src, int i_height,
+                     picture_t *p_dst, const video_format_t *p_fmt_dst,
+                     picture_t *p_src, unsigned i_src_y, int i_height,
                      int i_plane_count, bool b_swap_uvi, bool b_swap_uvo )
 {
     filter_sys_t *p_sys = p_filter->p_sys;
@@ -593,6 +804,9 @@ static void Convert( filter_t *p_filter, struct SwsContext *ctx,
 
     GetPixels( src, src_stride, p_sys->desc_in, &p_filter->fmt_in.video,
                p_src, i_plane_count, b_swap_uvi );
+    for( unsigned i = 0; i < p_sys->desc_in->plane_count && src[i]; i++ )
+        src[i] += (size_t)(i_src_y * p_sys->desc_in->p[i].h.num /
+                           p_sys->desc_in->p[i].h.den) * src_stride[i];
     if( p_filter->fmt_in.video.i_chroma == VLC_CODEC_RGBP )
     {
         memset( palette, 0, sizeof(palette) );
@@ -603,7 +817,7 @@ static void Convert( filter_t *p_filter, struct SwsContext *ctx,
         src_stride[1] = 4;
     }
 
-    GetPixels( dst, dst_stride, p_sys->desc_out, &p_filter->fmt_out.video,
+    GetPixels( dst, dst_stride, p_sys->desc_out, p_fmt_dst,
                p_dst, i_plane_count, b_swap_uvo );
 
     for (size_t i = 0; i < ARRAY_SIZE(src); i++)
@@ -618,6 +832,75 @@ static void Convert( filter_t *p_filter, struct SwsContext *ctx,
 #endif
 }
 
+/* Copies the lines owned by a band from its private picture.
+ *
+ * A context always writes all of its output lines, and the margins of a band
+ * overlap the lines of its neighbours, which other threads write at the same
+ * time. Only the libswscale 6 slice API can output a window of lines, so
+ * the band is scaled aside; the copy then reads and writes each output line
+ * once, right after it was scaled by the same thread. */
+static void CopySlice( filter_t *p_filter, const scaler_slice_t *slice,
+                       const video_format_t *p_fmt_tmp )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    const vlc_chroma_description_t *desc = p_sys->desc_out;
+    const video_format_t *p_fmto = &p_filter->fmt_out.video;
+    uint8_t *src[4], *dst[4];
+    int src_stride[4], dst_stride[4];
+
+    GetPixels( src, src_stride, desc, p_fmt_tmp, slice->p_tmp,
+               slice->i_plane_count, false );
+    GetPixels( dst, dst_stride, desc, p_fmto, slice->p_dst,
+               slice->i_plane_count, false );
+
+    for( unsigned i = 0; i < desc->plane_count && src[i] && dst[i]; i++ )
+    {
+        const unsigned num = desc->p[i].h.num, den = desc->p[i].h.den;
+        const unsigned i_first = slice->i_dst_y * num / den;
+        const unsigned i_last = ((slice->i_dst_y + slice->i_dst_h) * num
+                                 + den - 1) / den;
+        const unsigned i_skip = (slice->i_dst_y - slice->i_tmp_y) * num / den;
+        const size_t i_size = (p_fmto->i_visible_width * desc->p[i].w.num
+                               + desc->p[i].w.den - 1) / desc->p[i].w.den
+                              * desc->pixel_size;
+
+        for( unsigned y = 0; y < i_last - i_first; y++ )
+            memcpy( &dst[i][(size_t)(i_first + y) * dst_stride[i]],
+                    &src[i][(size_t)(i_skip + y) * src_stride[i]], i_size );
+    }
+}
+
+static void ScaleSlice( void *data )
+{
+    scaler_slice_t *slice = data;
+    filter_t *p_filter = slice->p_filter;
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    video_format_t fmt_tmp = p_filter->fmt_out.video;
+    fmt_tmp.i_x_offset = fmt_tmp.i_y_offset = 0;
+
+    Convert( p_filter, slice->ctx, slice->p_tmp, &fmt_tmp, slice->p_src,
+             slice->i_src_y, slice->i_src_h, slice->i_plane_count,
+             p_sys->b_swap_uvi, p_sys->b_swap_uvo );
+    CopySlice( p_filter, slice, &fmt_tmp );
+}
+
+static void ConvertSlices( filter_t *p_filter, picture_t *p_dst,
+                           picture_t *p_src, int i_plane_count )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    for( unsigned i = 0; i < p_sys->i_slices; i++ )
+    {
+        scaler_slice_t *slice = &p_sys->slices[i];
+        slice->p_src = p_src;
+        slice->p_dst = p_dst;
+        slice->i_plane_count = i_plane_count;
+        vlc_executor_Submit( p_sys->executor, &slice->runnable );
+    }
+    vlc_executor_WaitIdle( p_sys->executor );
+}
+
 /****************************************************************************
  * Filter: the whole thing
  ****************************************************************************
@@ -665,8 +948,12 @@ static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
         /* Even if alpha is unused, swscale expects the pointer to be set */
         const int n_planes = !p_sys->ctxA && (p_src->i_planes == 4 ||
                              p_dst->i_planes == 4) ? 4 : 3;
-        Convert( p_filter, p_sys->ctx, p_dst, p_src, p_fmti->i_visible_height,
-                 n_planes, p_sys->b_swap_uvi, p_sys->b_swap_uvo );
+        if( p_sys->i_slices > 0 )
+            ConvertSlices( p_filter, p_dst, p_src, n_planes );
+        else
+            Convert( p_filter, p_sys->ctx, p_dst, &p_filter->fmt_out.video,
+                     p_src, 0, p_fmti->i_visible_height,
+                     n_planes, p_sys->b_swap_uvi, p_sys->b_swap_uvo );
     }
     if( p_sys->ctxA )
     {
@@ -678,8 +965,8 @@ static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
         else
             plane_CopyPixels( p_sys->p_src_a->p, p_src->p+A_PLANE );
 
-        Convert( p_filter, p_sys->ctxA, p_sys->p_dst_a, p_sys->p_src_a,
-                 p_fmti->i_visible_height, 1, false, false );
+        Convert( p_filter, p_sys->ctxA, p_sys->p_dst_a, &p_filter->fmt_out.video,
+                 p_sys->p_src_a, 0, p_fmti->i_visible_height, 1, false, false );
         if( p_fmto->i_chroma == VLC_CODEC_RGBA || p_fmto->i_chroma == VLC_CODEC_BGRA )
             InjectA( p_dst, p_sys->p_dst_a, OFFSET_A );
         else if( p_fmto->i_chroma == VLC_CODEC_ARGB )
@@ -0,0 +1,90 @@
+/*****************************************************************************
+ * yuv_rgb.c : SIMD YUV to RGB conversion module for vlc
+ *****************************************************************************
+ * Copyright (C) 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Preamble
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+#include <vlc_plugin.h>
+#include <vlc_filter.h>
+#include <vlc_picture.h>
+
+#include "yuv_rgb_simd.h"
+
+/*****************************************************************************
+ * Module descriptor.
+ *****************************************************************************/
+static int  Activate   ( filter_t * );
+
+vlc_module_begin ()
+    set_description( N_("SIMD I420,YV12,NV12,I42010,P010 to "
+                        "RGBA,BGRA,RV24 conversions") )
+    set_callback_video_converter( Activate, 170 )
+vlc_module_end ()
+
+VIDEO_FILTER_WRAPPER_CLOSE( Convert, Deactivate )
+
+static const char *const isa_names[] = { "C", "AVX2", "AVX-512", "NEON" };
+
+/*****************************************************************************
+ * Activate: allocate a chroma function
+ *****************************************************************************/
+static int Activate( filter_t *p_filter )
+{
+    if( p_filter->fmt_in.video.orientation != p_filter->fmt_out.video.orientation )
+        return VLC_EGENERIC;
+
+    yuv_rgb_t *conv = yuv_rgb_New( &p_filter->fmt_in.video,
+                                   &p_filter->fmt_out.video,
+                                   YUV_RGB_ISA_AUTO );
+    if( conv == NULL )
+        return VLC_EGENERIC;
+
+    /* Leave the conversion to the other modules without SIMD */
+    if( yuv_rgb_GetISA( conv ) == YUV_RGB_ISA_C )
+    {
+        yuv_rgb_Delete( conv );
+        return VLC_EGENERIC;
+    }
+
+    msg_Dbg( p_filter, "%4.4s to %4.4s conversion using %s",
+             (const char *)&p_filter->fmt_in.video.i_chroma,
+             (const char *)&p_filter->fmt_out.video.i_chroma,
+             isa_names[yuv_rgb_GetISA( conv )] );
+
+    p_filter->p_sys = conv;
+    p_filter->ops = &Convert_ops;
+    return VLC_SUCCESS;
+}
+
+static void Deactivate( filter_t *p_filter )
+{
+    yuv_rgb_Delete( p_filter->p_sys );
+}
+
+static void Convert( filter_t *p_filter, picture_t *p_src, picture_t *p_dst )
+{
+    yuv_rgb_Convert( p_filter->p_sys, p_dst, p_src );
+}
@@ -0,0 +1,1054 @@
+/*****************************************************************************
+ * yuv_rgb_simd.c : SIMD YUV to RGB conversions
+ *****************************************************************************
+ * Copyright (C) 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <math.h>
+#include <stdlib.h>
+
+#include <vlc_common.h>
+#include <vlc_picture.h>
+#include <vlc_cpu.h>
+
+#include "yuv_rgb_simd.h"
+
+#if defined (HAVE_AVX2_INTRINSICS) || defined (HAVE_AVX512_INTRINSICS)
+# include <immintrin.h>
+#endif
+#ifdef __ARM_NEON
+# include <arm_neon.h>
+#endif
+
+/*
+ * Samples are first brought to signed 16-bit values with 6 (luma) or
+ * 7 (chroma) fractional bits over the 8-bit range, whatever their depth:
+ *   y = (Y8 - offset) << 6    u = (U8 - 128) << 7
+ * Then each term is the high half of its product with a coefficient, luma
+ * coefficients having 14 fractional bits and chroma ones 13, so that every
+ * term ends up with 4 fractional bits:
+ *   R = (mulhi(y, cy) + mulhi(v, crv) + 8) >> 4
+ * All the operations fit in 16 bits, as they do in the SIMD lanes.
+ */
+#define LUMA_COEF_BITS   14
+#define CHROMA_COEF_BITS 13
+
+enum yuv_rgb_input
+{
+    INPUT_PLANAR,       /**< I420, J420, YV12 */
+    INPUT_SEMIPLANAR,   /**< NV12 */
+    INPUT_PLANAR_10,    /**< I420 10 bits, little endian */
+    INPUT_SEMIPLANAR_10,/**< P010 */
+};
+
+enum yuv_rgb_output
+{
+    OUTPUT_RGBA,
+    OUTPUT_BGRA,
+    OUTPUT_RGB24,       /**< R, G, B bytes */
+    OUTPUT_BGR24,       /**< B, G, R bytes */
+};
+
+typedef struct
+{
+    int16_t y_offset;   /**< luma offset, with 6 fractional bits */
+    int16_t cy;
+    int16_t crv;
+    int16_t cgu;        /**< negative */
+    int16_t cgv;        /**< negative */
+    int16_t cbu;
+} yuv_rgb_coefs_t;
+
+/* Converts two rows sharing the same chroma row. */
+typedef void (*yuv_rgb_rows_t)(const yuv_rgb_coefs_t *,
+                               uint8_t *dst0, uint8_t *dst1,
+                               const uint8_t *y0, const uint8_t *y1,
+                               const uint8_t *u, const uint8_t *v,
+                               unsigned width);
+
+struct yuv_rgb
+{
+    int isa;
+    enum yuv_rgb_input input;
+    bool swap_uv;
+    yuv_rgb_coefs_t coefs;
+    yuv_rgb_rows_t rows;
+
+    unsigned width, height;
+    /* Offsets of the visible area, in luma samples */
+    unsigned src_x, src_y;
+    unsigned dst_x, dst_y;
+    unsigned dst_size;  /**< bytes per output pixel */
+};
+
+/*****************************************************************************
+ * C
+ *****************************************************************************/
+static inline int16_t MulHi(int16_t a, int16_t b)
+{
+    return ((int32_t)a * b) >> 16;
+}
+
+/* Sums wrap around as in the 16-bit SIMD lanes */
+static inline uint8_t Clamp(int sum)
+{
+    const int16_t v = (int16_t)sum >> 4;
+    return v < 0 ? 0 : v > 255 ? 255 : v;
+}
+
+static inline int16_t LumaC(const yuv_rgb_coefs_t *c, int input,
+                            const uint8_t *p, unsigned x)
+{
+    const uint16_t *p16 = (const uint16_t *)p;
+    uint16_t v;
+
+    switch (input)
+    {
+        case INPUT_PLANAR:
+        case INPUT_SEMIPLANAR:
+            v = p[x] << 6;
+            break;
+        case INPUT_PLANAR_10:
+            v = p16[x] << 4;
+            break;
+        default:
+            v = p16[x] >> 2;
+            break;
+    }
+    return MulHi((int16_t)(uint16_t)(v - c->y_offset), c->cy);
+}
+
+static inline void ChromaC(int input, const uint8_t *u, const uint8_t *v,
+                           unsigned cx, int16_t *us, int16_t *vs)
+{
+    const uint16_t *u16 = (const uint16_t *)u, *v16 = (const uint16_t *)v;
+    uint16_t a, b;
+
+    switch (input)
+    {
+        case INPUT_PLANAR:
+            a = u[cx] << 7;
+            b = v[cx] << 7;
+            break;
+        case INPUT_SEMIPLANAR:
+            a = u[2 * cx] << 7;
+            b = u[2 * cx + 1] << 7;
+            break;
+        case INPUT_PLANAR_10:
+            a = u16[cx] << 5;
+            b = v16[cx] << 5;
+            break;
+        default:
+            a = u16[2 * cx] >> 1;
+            b = u16[2 * cx + 1] >> 1;
+            break;
+    }
+    *us = (int16_t)(uint16_t)(a - (1 << 14));
+    *vs = (int16_t)(uint16_t)(b - (1 << 14));
+}
+
+static inline void StoreC(int output, uint8_t *dst, unsigned x,
+                          uint8_t r, uint8_t g, uint8_t b)
+{
+    switch (output)
+    {
+        case OUTPUT_RGBA:
+            dst += 4 * x;
+            dst[0] = r; dst[1] = g; dst[2] = b; dst[3] = 0xff;
+            break;
+        case OUTPUT_BGRA:
+            dst += 4 * x;
+            dst[0] = b; dst[1] = g; dst[2] = r; dst[3] = 0xff;
+            break;
+        case OUTPUT_RGB24:
+            dst += 3 * x;
+            dst[0] = r; dst[1] = g; dst[2] = b;
+            break;
+        default:
+            dst += 3 * x;
+            dst[0] = b; dst[1] = g; dst[2] = r;
+            break;
+    }
+}
+
+/* Converts the pixels from x to the end of the rows; also used for the
+ * remainders of the SIMD implementations */
+static inline void RowsC(const yuv_rgb_coefs_t *c, int input, int output,
+                         uint8_t *dst0, uint8_t *dst1,
+                         const uint8_t *y0, const uint8_t *y1,
+                         const uint8_t *u, const uint8_t *v,
+                         unsigned x, unsigned width)
+{
+    for (; x < width; x++)
+    {
+        int16_t us, vs;
+
+        ChromaC(input, u, v, x / 2, &us, &vs);
+
+        const int16_t cr = MulHi(vs, c->crv) + 8;
+        const int16_t cg = (int16_t)(MulHi(us, c->cgu) + MulHi(vs, c->cgv)) + 8;
+        const int16_t cb = MulHi(us, c->cbu) + 8;
+
+        for (unsigned i = 0; i < 2; i++)
+        {
+            const int16_t yy = LumaC(c, input, i ? y1 : y0, x);
+
+            StoreC(output, i ? dst1 : dst0, x, Clamp(yy + cr),
+                   Clamp(yy + cg), Clamp(yy + cb));
+        }
+    }
+}
+
+/* Instantiates a rows function per pair of formats */
+#define ROWS_FUNCS(isa, generic, attr) \
+    static attr void isa##Planar##_RGBA(ROWS_ARGS) \
+    { generic(ROWS_PARAMS(INPUT_PLANAR, OUTPUT_RGBA)); } \
+    static attr void isa##Planar##_BGRA(ROWS_ARGS) \
+    { generic(ROWS_PARAMS(INPUT_PLANAR, OUTPUT_BGRA)); } \
+    static attr void isa##Planar##_RGB24(ROWS_ARGS) \
+    { generic(ROWS_PARAMS(INPUT_PLANAR, OUTPUT_RGB24)); } \
+    static attr void isa##Planar##_BGR24(ROWS_ARGS) \
+    { generic(ROWS_PARAMS(INPUT_PLANAR, OUTPUT_BGR24)); } \
+    static attr void isa##Semiplanar##_RGBA(ROWS_ARGS) \
+    { generic(ROWS_PARAMS(INPUT_SEMIPLANAR, OUTPUT_RGBA)); } \
+    static attr void isa##Semiplanar##_BGRA(ROWS_ARGS) \
+    { generic(ROWS_PARAMS(INPUT_SEMIPLANAR, OUTPUT_BGRA)); } \
+    static attr void isa##Semiplanar##_RGB24(ROWS_ARGS) \
+    { generic(ROWS_PARAMS(INPUT_SEMIPLANAR, OUTPUT_RGB24)); } \
+    static attr void isa##Semiplanar##_BGR24(ROWS_ARGS) \
+    { generic(ROWS_PARAMS(INPUT_SEMIPLANAR, OUTPUT_BGR24)); } \
+    static attr void isa##Planar10##_RGBA(ROWS_ARGS) \
+    { generic(ROWS_PARAMS(INPUT_PLANAR_10, OUTPUT_RGBA)); } \
+    static attr void isa##Planar10##_BGRA(ROWS_ARGS) \
+    { generic(ROWS_PARAMS(INPUT_PLANAR_10, OUTPUT_BGRA)); } \
+    static attr void isa##Planar10##_RGB24(ROWS_ARGS) \
+    { generic(ROWS_PARAMS(INPUT_PLANAR_10, OUTPUT_RGB24)); } \
+    static attr void isa##Planar10##_BGR24(ROWS_ARGS) \
+    { generic(ROWS_PARAMS(INPUT_PLANAR_10, OUTPUT_BGR24)); } \
+    static attr void isa##Semiplanar10##_RGBA(ROWS_ARGS) \
+    { generic(ROWS_PARAMS(INPUT_SEMIPLANAR_10, OUTPUT_RGBA)); } \
+    static attr void isa##Semiplanar10##_BGRA(ROWS_ARGS) \
+    { generic(ROWS_PARAMS(INPUT_SEMIPLANAR_10, OUTPUT_BGRA)); } \
+    static attr void isa##Semiplanar10##_RGB24(ROWS_ARGS) \
+    { generic(ROWS_PARAMS(INPUT_SEMIPLANAR_10, OUTPUT_RGB24)); } \
+    static attr void isa##Semiplanar10##_BGR24(ROWS_ARGS) \
+    { generic(ROWS_PARAMS(INPUT_SEMIPLANAR_10, OUTPUT_BGR24)); } \
+    static const yuv_rgb_rows_t isa##Rows[4][4] = { \
+        { isa##Planar_RGBA, isa##Planar_BGRA, \
+          isa##Planar_RGB24, isa##Planar_BGR24 }, \
+        { isa##Semiplanar_RGBA, isa##Semiplanar_BGRA, \
+          isa##Semiplanar_RGB24, isa##Semiplanar_BGR24 }, \
+        { isa##Planar10_RGBA, isa##Planar10_BGRA, \
+          isa##Planar10_RGB24, isa##Planar10_BGR24 }, \
+        { isa##Semiplanar10_RGBA, isa##Semiplanar10_BGRA, \
+          isa##Semiplanar10_RGB24, isa##Semiplanar10_BGR24 }, \
+    };
+
+#define ROWS_ARGS const yuv_rgb_coefs_t *c, uint8_t *dst0, uint8_t *dst1, \
+                  const uint8_t *y0, const uint8_t *y1, \
+                  const uint8_t *u, const uint8_t *v, unsigned width
+#define ROWS_PARAMS(input, output) \
+    c, input, output, dst0, dst1, y0, y1, u, v, width
+
+static inline void GenericC(const yuv_rgb_coefs_t *c, int input, int output,
+                            uint8_t *dst0, uint8_t *dst1,
+                            const uint8_t *y0, const uint8_t *y1,
+                            const uint8_t *u, const uint8_t *v,
+                            unsigned width)
+{
+    RowsC(c, input, output, dst0, dst1, y0, y1, u, v, 0, width);
+}
+
+ROWS_FUNCS(C, GenericC, )
+
+/*****************************************************************************
+ * AVX2: 32 pixels per row and iteration
+ *****************************************************************************/
+#ifdef HAVE_AVX2_INTRINSICS
+# define AVX2 __attribute__ ((__target__ ("avx2")))
+
+static inline AVX2 void Avx2Luma(const yuv_rgb_coefs_t *c, int input,
+                                 const uint8_t *p, unsigned x,
+                                 __m256i *lo, __m256i *hi)
+{
+    const uint16_t *p16 = (const uint16_t *)p;
+    __m256i a, b;
+
+    switch (input)
+    {
+        case INPUT_PLANAR:
+        case INPUT_SEMIPLANAR:
+            a = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(p + x)));
+            b = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(p + x + 16)));
+            a = _mm256_slli_epi16(a, 6);
+            b = _mm256_slli_epi16(b, 6);
+            break;
+        case INPUT_PLANAR_10:
+            a = _mm256_loadu_si256((const __m256i *)(p16 + x));
+            b = _mm256_loadu_si256((const __m256i *)(p16 + x + 16));
+            a = _mm256_slli_epi16(a, 4);
+            b = _mm256_slli_epi16(b, 4);
+            break;
+        default:
+            a = _mm256_loadu_si256((const __m256i *)(p16 + x));
+            b = _mm256_loadu_si256((const __m256i *)(p16 + x + 16));
+            a = _mm256_srli_epi16(a, 2);
+            b = _mm256_srli_epi16(b, 2);
+            break;
+    }
+
+    const __m256i offset = _mm256_set1_epi16(c->y_offset);
+    const __m256i cy = _mm256_set1_epi16(c->cy);
+    *lo = _mm256_mulhi_epi16(_mm256_sub_epi16(a, offset), cy);
+    *hi = _mm256_mulhi_epi16(_mm256_sub_epi16(b, offset), cy);
+}
+
+/* Loads 16 chroma samples */
+static inline AVX2 void Avx2Chroma(int input, const uint8_t *u,
+                                   const uint8_t *v, unsigned cx,
+                                   __m256i *us, __m256i *vs)
+{
+    const uint16_t *u16 = (const uint16_t *)u, *v16 = (const uint16_t *)v;
+    __m256i a, b;
+
+    switch (input)
+    {
+        case INPUT_PLANAR:
+            a = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(u + cx)));
+            b = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(v + cx)));
+            a = _mm256_slli_epi16(a, 7);
+            b = _mm256_slli_epi16(b, 7);
+            break;
+        case INPUT_SEMIPLANAR:
+        {
+            const __m256i uv = _mm256_loadu_si256((const __m256i *)(u + 2 * cx));
+            a = _mm256_slli_epi16(uv, 8);
+            a = _mm256_srli_epi16(a, 1);
+            b = _mm256_srli_epi16(uv, 8);
+            b = _mm256_slli_epi16(b, 7);
+            break;
+        }
+        case INPUT_PLANAR_10:
+            a = _mm256_loadu_si256((const __m256i *)(u16 + cx));
+            b = _mm256_loadu_si256((const __m256i *)(v16 + cx));
+            a = _mm256_slli_epi16(a, 5);
+            b = _mm256_slli_epi16(b, 5);
+            break;
+        default:
+        {
+            const __m256i uv0 = _mm256_loadu_si256((const __m256i *)(u16 + 2 * cx));
+            const __m256i uv1 = _mm256_loadu_si256((const __m256i *)(u16 + 2 * cx + 16));
+            const __m256i mask = _mm256_set1_epi32(0xffff);
+
+            a = _mm256_packus_epi32(_mm256_and_si256(uv0, mask),
+                                    _mm256_and_si256(uv1, mask));
+            b = _mm256_packus_epi32(_mm256_srli_epi32(uv0, 16),
+                                    _mm256_srli_epi32(uv1, 16));
+            a = _mm256_srli_epi16(_mm256_permute4x64_epi64(a, 0xd8), 1);
+            b = _mm256_srli_epi16(_mm256_permute4x64_epi64(b, 0xd8), 1);
+            break;
+        }
+    }
+
+    const __m256i half = _mm256_set1_epi16(1 << 14);
+    *us = _mm256_sub_epi16(a, half);
+    *vs = _mm256_sub_epi16(b, half);
+}
+
+static inline AVX2 __m256i Avx2Clamp(__m256i v)
+{
+    v = _mm256_srai_epi16(v, 4);
+    v = _mm256_max_epi16(v, _mm256_setzero_si256());
+    return _mm256_min_epi16(v, _mm256_set1_epi16(255));
+}
+
+/* Stores 16 pixels */
+static inline AVX2 void Avx2Store(int output, uint8_t *dst, unsigned x,
+                                  __m256i r, __m256i g, __m256i b)
+{
+    const bool rgb = output == OUTPUT_RGBA || output == OUTPUT_RGB24;
+    const __m256i c0 = rgb ? r : b, c2 = rgb ? b : r;
+    const __m256i c01 = _mm256_or_si256(c0, _mm256_slli_epi16(g, 8));
+    const __m256i c23 = _mm256_or_si256(c2, _mm256_set1_epi16(0xff00));
+    const __m256i lo = _mm256_unpacklo_epi16(c01, c23); /* 0-3, 8-11 */
+    const __m256i hi = _mm256_unpackhi_epi16(c01, c23); /* 4-7, 12-15 */
+    const __m256i p0 = _mm256_permute2x128_si256(lo, hi, 0x20);
+    const __m256i p1 = _mm256_permute2x128_si256(lo, hi, 0x31);
+
+    if (output == OUTPUT_RGBA || output == OUTPUT_BGRA)
+    {
+        _mm256_storeu_si256((__m256i *)(dst + 4 * x), p0);
+        _mm256_storeu_si256((__m256i *)(dst + 4 * x + 32), p1);
+        return;
+    }
+
+    /* Drop the fourth bytes, then gather the 24 bytes left at the start */
+    const __m256i shuffle = _mm256_setr_epi8(
+        0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+        0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    const __m256i gather = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7);
+    const __m256i q0 = _mm256_permutevar8x32_epi32(
+        _mm256_shuffle_epi8(p0, shuffle), gather);
+    const __m256i q1 = _mm256_permutevar8x32_epi32(
+        _mm256_shuffle_epi8(p1, shuffle), gather);
+    uint8_t *p = dst + 3 * x;
+
+    _mm_storeu_si128((__m128i *)p, _mm256_castsi256_si128(q0));
+    _mm_storel_epi64((__m128i *)(p + 16), _mm256_extracti128_si256(q0, 1));
+    _mm_storeu_si128((__m128i *)(p + 24), _mm256_castsi256_si128(q1));
+    _mm_storel_epi64((__m128i *)(p + 40), _mm256_extracti128_si256(q1, 1));
+}
+
+static inline AVX2 void Avx2Row(const yuv_rgb_coefs_t *c, int input,
+                                int output, uint8_t *dst, const uint8_t *y,
+                                unsigned x, const __m256i cr[2],
+                                const __m256i cg[2], const __m256i cb[2])
+{
+    __m256i yy[2];
+
+    Avx2Luma(c, input, y, x, &yy[0], &yy[1]);
+    for (unsigned i = 0; i < 2; i++)
+        Avx2Store(output, dst, x + 16 * i,
+                  Avx2Clamp(_mm256_add_epi16(yy[i], cr[i])),
+                  Avx2Clamp(_mm256_add_epi16(yy[i], cg[i])),
+                  Avx2Clamp(_mm256_add_epi16(yy[i], cb[i])));
+}
+
+/* Duplicates 16 chroma terms over 32 pixels */
+static inline AVX2 void Avx2Upsample(__m256i v, __m256i out[2])
+{
+    const __m256i lo = _mm256_unpacklo_epi16(v, v); /* 0-3, 8-11 */
+    const __m256i hi = _mm256_unpackhi_epi16(v, v); /* 4-7, 12-15 */
+
+    out[0] = _mm256_permute2x128_si256(lo, hi, 0x20);
+    out[1] = _mm256_permute2x128_si256(lo, hi, 0x31);
+}
+
+static inline AVX2 void GenericAVX2(const yuv_rgb_coefs_t *c, int input,
+                                    int output, uint8_t *dst0, uint8_t *dst1,
+                                    const uint8_t *y0, const uint8_t *y1,
+                                    const uint8_t *u, const uint8_t *v,
+                                    unsigned width)
+{
+    const __m256i crv = _mm256_set1_epi16(c->crv);
+    const __m256i cgu = _mm256_set1_epi16(c->cgu);
+    const __m256i cgv = _mm256_set1_epi16(c->cgv);
+    const __m256i cbu = _mm256_set1_epi16(c->cbu);
+    const __m256i round = _mm256_set1_epi16(8);
+    unsigned x = 0;
+
+    for (; x + 32 <= width; x += 32)
+    {
+        __m256i us, vs, cr[2], cg[2], cb[2];
+
+        Avx2Chroma(input, u, v, x / 2, &us, &vs);
+        Avx2Upsample(_mm256_add_epi16(_mm256_mulhi_epi16(vs, crv), round), cr);
+        Avx2Upsample(_mm256_add_epi16(_mm256_add_epi16(
+                         _mm256_mulhi_epi16(us, cgu),
+                         _mm256_mulhi_epi16(vs, cgv)), round), cg);
+        Avx2Upsample(_mm256_add_epi16(_mm256_mulhi_epi16(us, cbu), round), cb);
+
+        Avx2Row(c, input, output, dst0, y0, x, cr, cg, cb);
+        Avx2Row(c, input, output, dst1, y1, x, cr, cg, cb);
+    }
+    RowsC(c, input, output, dst0, dst1, y0, y1, u, v, x, width);
+}
+
+ROWS_FUNCS(AVX2, GenericAVX2, AVX2)
+#endif
+
+/*****************************************************************************
+ * AVX-512: 64 pixels per row and iteration
+ *****************************************************************************/
+#ifdef HAVE_AVX512_INTRINSICS
+# define AVX512 __attribute__ ((__target__ ("avx512f,avx512bw")))
+
+/* Permutation tables */
+static const uint16_t avx512_even[32] = {
+     0,  2,  4,  6,  8, 10, 12, 14, 16, 18, 20, 22, 24, 26, 28, 30,
+    32, 34, 36, 38, 40, 42, 44, 46, 48, 50, 52, 54, 56, 58, 60, 62,
+};
+static const uint16_t avx512_odd[32] = {
+     1,  3,  5,  7,  9, 11, 13, 15, 17, 19, 21, 23, 25, 27, 29, 31,
+    33, 35, 37, 39, 41, 43, 45, 47, 49, 51, 53, 55, 57, 59, 61, 63,
+};
+static const uint16_t avx512_dup[2][32] = {
+    {  0,  0,  1,  1,  2,  2,  3,  3,  4,  4,  5,  5,  6,  6,  7,  7,
+       8,  8,  9,  9, 10, 10, 11, 11, 12, 12, 13, 13, 14, 14, 15, 15 },
+    { 16, 16, 17, 17, 18, 18, 19, 19, 20, 20, 21, 21, 22, 22, 23, 23,
+      24, 24, 25, 25, 26, 26, 27, 27, 28, 28, 29, 29, 30, 30, 31, 31 },
+};
+static const uint16_t avx512_zip[2][32] = {
+    {  0, 32,  1, 33,  2, 34,  3, 35,  4, 36,  5, 37,  6, 38,  7, 39,
+       8, 40,  9, 41, 10, 42, 11, 43, 12, 44, 13, 45, 14, 46, 15, 47 },
+    { 16, 48, 17, 49, 18, 50, 19, 51, 20, 52, 21, 53, 22, 54, 23, 55,
+      24, 56, 25, 57, 26, 58, 27, 59, 28, 60, 29, 61, 30, 62, 31, 63 },
+};
+static const uint32_t avx512_pack24[16] = {
+    0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, 3, 7, 11, 15,
+};
+
+static inline AVX512 __m512i Avx512Load(const void *p)
+{
+    return _mm512_loadu_si512(p);
+}
+
+static inline AVX512 void Avx512Luma(const yuv_rgb_coefs_t *c, int input,
+                                     const uint8_t *p, unsigned x,
+                                     __m512i *lo, __m512i *hi)
+{
+    const uint16_t *p16 = (const uint16_t *)p;
+    __m512i a, b;
+
+    switch (input)
+    {
+        case INPUT_PLANAR:
+        case INPUT_SEMIPLANAR:
+            a = _mm512_cvtepu8_epi16(_mm256_loadu_si256((const __m256i *)(p + x)));
+            b = _mm512_cvtepu8_epi16(_mm256_loadu_si256((const __m256i *)(p + x + 32)));
+            a = _mm512_slli_epi16(a, 6);
+            b = _mm512_slli_epi16(b, 6);
+            break;
+        case INPUT_PLANAR_10:
+            a = _mm512_slli_epi16(Avx512Load(p16 + x), 4);
+            b = _mm512_slli_epi16(Avx512Load(p16 + x + 32), 4);
+            break;
+        default:
+            a = _mm512_srli_epi16(Avx512Load(p16 + x), 2);
+            b = _mm512_srli_epi16(Avx512Load(p16 + x + 32), 2);
+            break;
+    }
+
+    const __m512i offset = _mm512_set1_epi16(c->y_offset);
+    const __m512i cy = _mm512_set1_epi16(c->cy);
+    *lo = _mm512_mulhi_epi16(_mm512_sub_epi16(a, offset), cy);
+    *hi = _mm512_mulhi_epi16(_mm512_sub_epi16(b, offset), cy);
+}
+
+/* Loads 32 chroma samples */
+static inline AVX512 void Avx512Chroma(int input, const uint8_t *u,
+                                       const uint8_t *v, unsigned cx,
+                                       __m512i *us, __m512i *vs)
+{
+    const uint16_t *u16 = (const uint16_t *)u, *v16 = (const uint16_t *)v;
+    __m512i a, b;
+
+    switch (input)
+    {
+        case INPUT_PLANAR:
+            a = _mm512_cvtepu8_epi16(_mm256_loadu_si256((const __m256i *)(u + cx)));
+            b = _mm512_cvtepu8_epi16(_mm256_loadu_si256((const __m256i *)(v + cx)));
+            a = _mm512_slli_epi16(a, 7);
+            b = _mm512_slli_epi16(b, 7);
+            break;
+        case INPUT_SEMIPLANAR:
+        {
+            const __m512i uv = Avx512Load(u + 2 * cx);
+            a = _mm512_srli_epi16(_mm512_slli_epi16(uv, 8), 1);
+            b = _mm512_slli_epi16(_mm512_srli_epi16(uv, 8), 7);
+            break;
+        }
+        case INPUT_PLANAR_10:
+            a = _mm512_slli_epi16(Avx512Load(u16 + cx), 5);
+            b = _mm512_slli_epi16(Avx512Load(v16 + cx), 5);
+            break;
+        default:
+        {
+            const __m512i uv0 = Avx512Load(u16 + 2 * cx);
+            const __m512i uv1 = Avx512Load(u16 + 2 * cx + 32);
+
+            a = _mm512_permutex2var_epi16(uv0, Avx512Load(avx512_even), uv1);
+            b = _mm512_permutex2var_epi16(uv0, Avx512Load(avx512_odd), uv1);
+            a = _mm512_srli_epi16(a, 1);
+            b = _mm512_srli_epi16(b, 1);
+            break;
+        }
+    }
+
+    const __m512i half = _mm512_set1_epi16(1 << 14);
+    *us = _mm512_sub_epi16(a, half);
+    *vs = _mm512_sub_epi16(b, half);
+}
+
+static inline AVX512 __m512i Avx512Clamp(__m512i v)
+{
+    v = _mm512_srai_epi16(v, 4);
+    v = _mm512_max_epi16(v, _mm512_setzero_si512());
+    return _mm512_min_epi16(v, _mm512_set1_epi16(255));
+}
+
+/* Stores 32 pixels */
+static inline AVX512 void Avx512Store(int output, uint8_t *dst, unsigned x,
+                                      __m512i r, __m512i g, __m512i b)
+{
+    const bool rgb = output == OUTPUT_RGBA || output == OUTPUT_RGB24;
+    const __m512i c0 = rgb ? r : b, c2 = rgb ? b : r;
+    const __m512i c01 = _mm512_or_si512(c0, _mm512_slli_epi16(g, 8));
+    const __m512i c23 = _mm512_or_si512(c2, _mm512_set1_epi16(0xff00));
+
+    for (unsigned i = 0; i < 2; i++)
+    {
+        const __m512i p = _mm512_permutex2var_epi16(c01,
+                                Avx512Load(avx512_zip[i]), c23);
+
+        if (output == OUTPUT_RGBA || output == OUTPUT_BGRA)
+        {
+            _mm512_storeu_si512(dst + 4 * (x + 16 * i), p);
+            continue;
+        }
+
+        const __m512i shuffle = _mm512_broadcast_i32x4(_mm_setr_epi8(
+            0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1));
+        const __m512i q = _mm512_permutexvar_epi32(Avx512Load(avx512_pack24),
+                                    _mm512_shuffle_epi8(p, shuffle));
+        _mm512_mask_storeu_epi8(dst + 3 * (x + 16 * i),
+                                (__mmask64)0xffffffffffff, q);
+    }
+}
+
+static inline AVX512 void Avx512Row(const yuv_rgb_coefs_t *c, int input,
+                                    int output, uint8_t *dst, const uint8_t *y,
+                                    unsigned x, const __m512i cr[2],
+                                    const __m512i cg[2], const __m512i cb[2])
+{
+    __m512i yy[2];
+
+    Avx512Luma(c, input, y, x, &yy[0], &yy[1]);
+    for (unsigned i = 0; i < 2; i++)
+        Avx512Store(output, dst, x + 32 * i,
+                    Avx512Clamp(_mm512_add_epi16(yy[i], cr[i])),
+                    Avx512Clamp(_mm512_add_epi16(yy[i], cg[i])),
+                    Avx512Clamp(_mm512_add_epi16(yy[i], cb[i])));
+}
+
+/* Duplicates 32 chroma terms over 64 pixels */
+static inline AVX512 void Avx512Upsample(__m512i v, __m512i out[2])
+{
+    out[0] = _mm512_permutexvar_epi16(Avx512Load(avx512_dup[0]), v);
+    out[1] = _mm512_permutexvar_epi16(Avx512Load(avx512_dup[1]), v);
+}
+
+static inline AVX512 void GenericAVX512(const yuv_rgb_coefs_t *c, int input,
+                                        int output,
+                                        uint8_t *dst0, uint8_t *dst1,
+                                        const uint8_t *y0, const uint8_t *y1,
+                                        const uint8_t *u, const uint8_t *v,
+                                        unsigned width)
+{
+    const __m512i crv = _mm512_set1_epi16(c->crv);
+    const __m512i cgu = _mm512_set1_epi16(c->cgu);
+    const __m512i cgv = _mm512_set1_epi16(c->cgv);
+    const __m512i cbu = _mm512_set1_epi16(c->cbu);
+    const __m512i round = _mm512_set1_epi16(8);
+    unsigned x = 0;
+
+    for (; x + 64 <= width; x += 64)
+    {
+        __m512i us, vs, cr[2], cg[2], cb[2];
+
+        Avx512Chroma(input, u, v, x / 2, &us, &vs);
+        Avx512Upsample(_mm512_add_epi16(_mm512_mulhi_epi16(vs, crv), round), cr);
+        Avx512Upsample(_mm512_add_epi16(_mm512_add_epi16(
+                           _mm512_mulhi_epi16(us, cgu),
+                           _mm512_mulhi_epi16(vs, cgv)), round), cg);
+        Avx512Upsample(_mm512_add_epi16(_mm512_mulhi_epi16(us, cbu), round), cb);
+
+        Avx512Row(c, input, output, dst0, y0, x, cr, cg, cb);
+        Avx512Row(c, input, output, dst1, y1, x, cr, cg, cb);
+    }
+    RowsC(c, input, output, dst0, dst1, y0, y1, u, v, x, width);
+}
+
+ROWS_FUNCS(AVX512, GenericAVX512, AVX512)
+#endif
+
+/*****************************************************************************
+ * NEON: 16 pixels per row and iteration
+ *****************************************************************************/
+#ifdef __ARM_NEON
+static inline int16x8_t NeonMulHi(int16x8_t a, int16x8_t b)
+{
+    const int32x4_t lo = vmull_s16(vget_low_s16(a), vget_low_s16(b));
+    const int32x4_t hi = vmull_s16(vget_high_s16(a), vget_high_s16(b));
+
+    return vcombine_s16(vshrn_n_s32(lo, 16), vshrn_n_s32(hi, 16));
+}
+
+static inline void NeonLuma(const yuv_rgb_coefs_t *c, int input,
+                            const uint8_t *p, unsigned x, int16x8_t yy[2])
+{
+    const uint16_t *p16 = (const uint16_t *)p;
+    uint16x8_t a, b;
+
+    switch (input)
+    {
+        case INPUT_PLANAR:
+        case INPUT_SEMIPLANAR:
+        {
+            const uint8x16_t v = vld1q_u8(p + x);
+            a = vshll_n_u8(vget_low_u8(v), 6);
+            b = vshll_n_u8(vget_high_u8(v), 6);
+            break;
+        }
+        case INPUT_PLANAR_10:
+            a = vshlq_n_u16(vld1q_u16(p16 + x), 4);
+            b = vshlq_n_u16(vld1q_u16(p16 + x + 8), 4);
+            break;
+        default:
+            a = vshrq_n_u16(vld1q_u16(p16 + x), 2);
+            b = vshrq_n_u16(vld1q_u16(p16 + x + 8), 2);
+            break;
+    }
+
+    const uint16x8_t offset = vdupq_n_u16(c->y_offset);
+    const int16x8_t cy = vdupq_n_s16(c->cy);
+    yy[0] = NeonMulHi(vreinterpretq_s16_u16(vsubq_u16(a, offset)), cy);
+    yy[1] = NeonMulHi(vreinterpretq_s16_u16(vsubq_u16(b, offset)), cy);
+}
+
+/* Loads 8 chroma samples */
+static inline void NeonChroma(int input, const uint8_t *u, const uint8_t *v,
+                              unsigned cx, int16x8_t *us, int16x8_t *vs)
+{
+    const uint16_t *u16 = (const uint16_t *)u, *v16 = (const uint16_t *)v;
+    uint16x8_t a, b;
+
+    switch (input)
+    {
+        case INPUT_PLANAR:
+            a = vshll_n_u8(vld1_u8(u + cx), 7);
+            b = vshll_n_u8(vld1_u8(v + cx), 7);
+            break;
+        case INPUT_SEMIPLANAR:
+        {
+            const uint8x8x2_t uv = vld2_u8(u + 2 * cx);
+            a = vshll_n_u8(uv.val[0], 7);
+            b = vshll_n_u8(uv.val[1], 7);
+            break;
+        }
+        case INPUT_PLANAR_10:
+            a = vshlq_n_u16(vld1q_u16(u16 + cx), 5);
+            b = vshlq_n_u16(vld1q_u16(v16 + cx), 5);
+            break;
+        default:
+        {
+            const uint16x8x2_t uv = vld2q_u16(u16 + 2 * cx);
+            a = vshrq_n_u16(uv.val[0], 1);
+            b = vshrq_n_u16(uv.val[1], 1);
+            break;
+        }
+    }
+
+    const uint16x8_t half = vdupq_n_u16(1 << 14);
+    *us = vreinterpretq_s16_u16(vsubq_u16(a, half));
+    *vs = vreinterpretq_s16_u16(vsubq_u16(b, half));
+}
+
+static inline uint8x16_t NeonClamp(const int16x8_t yy[2],
+                                   const int16x8x2_t *c)
+{
+    return vcombine_u8(vqmovun_s16(vshrq_n_s16(vaddq_s16(yy[0], c->val[0]), 4)),
+                       vqmovun_s16(vshrq_n_s16(vaddq_s16(yy[1], c->val[1]), 4)));
+}
+
+static inline void NeonRow(const yuv_rgb_coefs_t *c, int input, int output,
+                           uint8_t *dst, const uint8_t *y, unsigned x,
+                           const int16x8x2_t *cr, const int16x8x2_t *cg,
+                           const int16x8x2_t *cb)
+{
+    int16x8_t yy[2];
+
+    NeonLuma(c, input, y, x, yy);
+
+    const uint8x16_t r = NeonClamp(yy, cr);
+    const uint8x16_t g = NeonClamp(yy, cg);
+    const uint8x16_t b = NeonClamp(yy, cb);
+
+    switch (output)
+    {
+        case OUTPUT_RGBA:
+        {
+            const uint8x16x4_t px = { { r, g, b, vdupq_n_u8(0xff) } };
+            vst4q_u8(dst + 4 * x, px);
+            break;
+        }
+        case OUTPUT_BGRA:
+        {
+            const uint8x16x4_t px = { { b, g, r, vdupq_n_u8(0xff) } };
+            vst4q_u8(dst + 4 * x, px);
+            break;
+        }
+        case OUTPUT_RGB24:
+        {
+            const uint8x16x3_t px = { { r, g, b } };
+            vst3q_u8(dst + 3 * x, px);
+            break;
+        }
+        default:
+        {
+            const uint8x16x3_t px = { { b, g, r } };
+            vst3q_u8(dst + 3 * x, px);
+            break;
+        }
+    }
+}
+
+static inline void GenericNEON(const yuv_rgb_coefs_t *c, int input,
+                               int output, uint8_t *dst0, uint8_t *dst1,
+                               const uint8_t *y0, const uint8_t *y1,
+                               const uint8_t *u, const uint8_t *v,
+                               unsigned width)
+{
+    const int16x8_t crv = vdupq_n_s16(c->crv);
+    const int16x8_t cgu = vdupq_n_s16(c->cgu);
+    const int16x8_t cgv = vdupq_n_s16(c->cgv);
+    const int16x8_t cbu = vdupq_n_s16(c->cbu);
+    const int16x8_t round = vdupq_n_s16(8);
+    unsigned x = 0;
+
+    for (; x + 16 <= width; x += 16)
+    {
+        int16x8_t us, vs;
+
+        NeonChroma(input, u, v, x / 2, &us, &vs);
+
+        const int16x8_t r = vaddq_s16(NeonMulHi(vs, crv), round);
+        const int16x8_t g = vaddq_s16(vaddq_s16(NeonMulHi(us, cgu),
+                                                NeonMulHi(vs, cgv)), round);
+        const int16x8_t b = vaddq_s16(NeonMulHi(us, cbu), round);
+        const int16x8x2_t cr = vzipq_s16(r, r);
+        const int16x8x2_t cg = vzipq_s16(g, g);
+        const int16x8x2_t cb = vzipq_s16(b, b);
+
+        NeonRow(c, input, output, dst0, y0, x, &cr, &cg, &cb);
+        NeonRow(c, input, output, dst1, y1, x, &cr, &cg, &cb);
+    }
+    RowsC(c, input, output, dst0, dst1, y0, y1, u, v, x, width);
+}
+
+ROWS_FUNCS(NEON, GenericNEON, )
+#endif
+
+/*****************************************************************************
+ * Setup
+ *****************************************************************************/
+static void SetMatrix(yuv_rgb_t *conv, const video_format_t *in)
+{
+    video_format_t fmt = *in;
+    double kr, kb;
+
+    video_format_AdjustColorSpace(&fmt);
+    switch (fmt.space)
+    {
+        case COLOR_SPACE_BT2020:
+            kr = .2627;
+            kb = .0593;
+            break;
+        case COLOR_SPACE_BT709:
+            kr = .2126;
+            kb = .0722;
+            break;
+        default:
+            kr = .299;
+            kb = .114;
+            break;
+    }
+
+    const bool full = fmt.color_range == COLOR_RANGE_FULL
+                   || fmt.i_chroma == VLC_CODEC_J420;
+    const double ys = full ? 1. : 255. / 219.;
+    const double cs = full ? 1. : 255. / 224.;
+    const double kg = 1. - kr - kb;
+    const double one = 1 << CHROMA_COEF_BITS;
+    yuv_rgb_coefs_t *c = &conv->coefs;
+
+    c->y_offset = full ? 0 : 16 << 6;
+    c->cy  = lround(ys * (1 << LUMA_COEF_BITS));
+    c->crv = lround(cs * 2. * (1. - kr) * one);
+    c->cgu = -lround(cs * 2. * kb * (1. - kb) / kg * one);
+    c->cgv = -lround(cs * 2. * kr * (1. - kr) / kg * one);
+    c->cbu = lround(cs * 2. * (1. - kb) * one);
+}
+
+static const yuv_rgb_rows_t (*GetRows(int isa))[4]
+{
+    switch (isa)
+    {
+        case YUV_RGB_ISA_C:
+            return CRows;
+#ifdef HAVE_AVX2_INTRINSICS
+        case YUV_RGB_ISA_AVX2:
+            return vlc_CPU_AVX2() ? AVX2Rows : NULL;
+#endif
+#ifdef HAVE_AVX512_INTRINSICS
+        case YUV_RGB_ISA_AVX512:
+            return vlc_CPU_AVX512() ? AVX512Rows : NULL;
+#endif
+#ifdef __ARM_NEON
+        case YUV_RGB_ISA_NEON:
+            return vlc_CPU_ARM_NEON() ? NEONRows : NULL;
+#endif
+        default:
+            return NULL;
+    }
+}
+
+yuv_rgb_t *yuv_rgb_New(const video_format_t *in, const video_format_t *out,
+                       int isa)
+{
+    enum yuv_rgb_input input;
+    enum yuv_rgb_output output;
+    bool swap_uv = false;
+
+    switch (in->i_chroma)
+    {
+        case VLC_CODEC_YV12:
+            swap_uv = true;
+            /* fall through */
+        case VLC_CODEC_I420:
+        case VLC_CODEC_J420:
+            input = INPUT_PLANAR;
+            break;
+        case VLC_CODEC_NV12:
+            input = INPUT_SEMIPLANAR;
+            break;
+        case VLC_CODEC_I420_10L:
+            input = INPUT_PLANAR_10;
+            break;
+        case VLC_CODEC_P010:
+            input = INPUT_SEMIPLANAR_10;
+            break;
+        default:
+            return NULL;
+    }
+
+    switch (out->i_chroma)
+    {
+        case VLC_CODEC_RGBA:
+            output = OUTPUT_RGBA;
+            break;
+        case VLC_CODEC_BGRA:
+            output = OUTPUT_BGRA;
+            break;
+        case VLC_CODEC_RGB24:
+            /* Masks are given as a big endian 24-bit value */
+            if (out->i_rmask == 0 || (out->i_rmask == 0xff0000
+             && out->i_gmask == 0x00ff00 && out->i_bmask == 0x0000ff))
+                output = OUTPUT_RGB24;
+            else if (out->i_rmask == 0x0000ff && out->i_gmask == 0x00ff00
+                  && out->i_bmask == 0xff0000)
+                output = OUTPUT_BGR24;
+            else
+                return NULL;
+            break;
+        default:
+            return NULL;
+    }
+
+    if (in->i_visible_width != out->i_visible_width
+     || in->i_visible_height != out->i_visible_height
+     || in->i_visible_width == 0 || in->i_visible_height == 0)
+        return NULL;
+
+    if (isa == YUV_RGB_ISA_AUTO)
+    {
+        static const int isas[] = {
+            YUV_RGB_ISA_AVX512, YUV_RGB_ISA_AVX2, YUV_RGB_ISA_NEON,
+        };
+
+        isa = YUV_RGB_ISA_C;
+        for (size_t i = 0; i < ARRAY_SIZE(isas); i++)
+            if (GetRows(isas[i]) != NULL)
+            {
+                isa = isas[i];
+                break;
+            }
+    }
+
+    const yuv_rgb_rows_t (*rows)[4] = GetRows(isa);
+    if (rows == NULL)
+        return NULL;
+
+    yuv_rgb_t *conv = malloc(sizeof (*conv));
+    if (unlikely(conv == NULL))
+        return NULL;
+
+    conv->isa = isa;
+    conv->input = input;
+    conv->swap_uv = swap_uv;
+    conv->rows = rows[input][output];
+    conv->width = in->i_visible_width;
+    conv->height = in->i_visible_height;
+    conv->src_x = in->i_x_offset & ~1u;
+    conv->src_y = in->i_y_offset & ~1u;
+    conv->dst_x = out->i_x_offset;
+    conv->dst_y = out->i_y_offset;
+    conv->dst_size = output == OUTPUT_RGBA || output == OUTPUT_BGRA ? 4 : 3;
+    SetMatrix(conv, in);
+    return conv;
+}
+
+void yuv_rgb_Delete(yuv_rgb_t *conv)
+{
+    free(conv);
+}
+
+int yuv_rgb_GetISA(const yuv_rgb_t *conv)
+{
+    return conv->isa;
+}
+
+void yuv_rgb_Convert(const yuv_rgb_t *conv, picture_t *dst,
+                     const picture_t *src)
+{
+    const bool semiplanar = conv->input == INPUT_SEMIPLANAR
+                         || conv->input == INPUT_SEMIPLANAR_10;
+    const bool high_depth = conv->input == INPUT_PLANAR_10
+                         || conv->input == INPUT_SEMIPLANAR_10;
+    const unsigned size = high_depth ? 2 : 1;
+    const plane_t *py = &src->p[Y_PLANE];
+    const plane_t *pu = &src->p[conv->swap_uv ? V_PLANE : U_PLANE];
+    const plane_t *pv = &src->p[semiplanar ? U_PLANE
+                                : conv->swap_uv ? U_PLANE : V_PLANE];
+    const plane_t *out = &dst->p[0];
+
+    const uint8_t *y = py->p_pixels + conv->src_y * py->i_pitch
+                     + conv->src_x * size;
+    const uint8_t *u = pu->p_pixels + conv->src_y / 2 * pu->i_pitch
+                     + conv->src_x / 2 * size * (semiplanar ? 2 : 1);
+    const uint8_t *v = pv->p_pixels + conv->src_y / 2 * pv->i_pitch
+                     + conv->src_x / 2 * size * (semiplanar ? 2 : 1);
+    uint8_t *d = out->p_pixels + conv->dst_y * out->i_pitch
+               + conv->dst_x * conv->dst_size;
+
+    for (unsigned row = 0; row < conv->height; row += 2)
+    {
+        /* The last row of an odd height picture is converted twice */
+        const bool pair = row + 1 < conv->height;
+
+        conv->rows(&conv->coefs, d, pair ? d + out->i_pitch : d,
+                   y, pair ? y + py->i_pitch : y, u, v, conv->width);
+        y += 2 * py->i_pitch;
+        u += pu->i_pitch;
+        v += pv->i_pitch;
+        d += 2 * out->i_pitch;
+    }
+}
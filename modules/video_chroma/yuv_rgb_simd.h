@@ -0,0 +1,63 @@
+/*****************************************************************************
+ * yuv_rgb_simd.h : SIMD YUV to RGB conversions
+ *****************************************************************************
+ * Copyright (C) 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_CHROMA_YUV_RGB_SIMD_H
+#define VLC_CHROMA_YUV_RGB_SIMD_H 1
+
+/**
+ * \file
+ * Converts 4:2:0 YUV pictures (I420, J420, YV12, NV12, 10-bit I420 and P010)
+ * to RGBA, BGRA or 24-bit RGB, with the BT.601, BT.709 or BT.2020 matrix in
+ * full or limited range.
+ *
+ * All the implementations use the same 16-bit fixed point arithmetic, so
+ * that they produce exactly the same pictures as the C one.
+ */
+
+typedef struct yuv_rgb yuv_rgb_t;
+
+enum yuv_rgb_isa
+{
+    YUV_RGB_ISA_AUTO = -1, /**< best implementation available */
+    YUV_RGB_ISA_C,
+    YUV_RGB_ISA_AVX2,
+    YUV_RGB_ISA_AVX512,
+    YUV_RGB_ISA_NEON,
+};
+
+/**
+ * Creates a converter.
+ *
+ * \param isa one of yuv_rgb_isa
+ * \return a converter, or NULL if the pair of formats is not handled or if
+ * the requested implementation is not available
+ */
+yuv_rgb_t *yuv_rgb_New(const video_format_t *in, const video_format_t *out,
+                       int isa);
+void yuv_rgb_Delete(yuv_rgb_t *);
+
+/**
+ * Returns the implementation used by a converter.
+ */
+int yuv_rgb_GetISA(const yuv_rgb_t *);
+
+void yuv_rgb_Convert(const yuv_rgb_t *, picture_t *dst, const picture_t *src);
+
+#endif
@@ -33,13 +33,37 @@
 #include <vlc_filter.h>
 #include <vlc_picture.h>
 
+#include "fps_mci.h"
+
 static int Open( filter_t * );
 static picture_t *Filter( filter_t *p_filter, picture_t *p_picture);
 
 #define CFG_PREFIX "fps-"
 
+/* Largest source picture interval interpolated over */
+#define MCI_MAX_GAP VLC_TICK_FROM_SEC(1)
+
 #define FPS_TEXT N_( "Frame rate" )
 
+#define MODE_TEXT N_( "Conversion mode" )
+#define MODE_LONGTEXT N_( "Duplicate or drop source pictures, or render " \
+    "intermediate pictures by motion compensated interpolation." )
+#define QUALITY_TEXT N_( "Interpolation quality" )
+#define QUALITY_LONGTEXT N_( "Trade-off between interpolation quality and " \
+    "speed: wider motion search and vector smoothing at higher values." )
+#define THREADS_TEXT N_( "Interpolation threads" )
+#define THREADS_LONGTEXT N_( "Number of threads used for motion " \
+    "compensated interpolation (0 for one per CPU)." )
+
+static const char *const mode_list[] = { "dup", "mci" };
+static const char *const mode_list_text[] = {
+    N_("Duplicate/drop"), N_("Motion compensated interpolation") };
+
+static const int quality_list[] = {
+    FPS_MCI_FAST, FPS_MCI_NORMAL, FPS_MCI_HIGH };
+static const char *const quality_list_text[] = {
+    N_("Fast"), N_("Normal"), N_("High") };
+
 vlc_module_begin ()
     set_description( N_("FPS conversion video filter") )
     set_shortname( N_("FPS Converter" ))
@@ -48,11 +72,19 @@ vlc_module_begin ()
 
     add_shortcut( "fps" )
     add_string( CFG_PREFIX "fps", NULL, FPS_TEXT, FPS_TEXT, false )
+    add_string( CFG_PREFIX "mode", "dup", MODE_TEXT, MODE_LONGTEXT, false )
+        change_string_list( mode_list, mode_list_text )
+    add_integer_with_range( CFG_PREFIX "quality", FPS_MCI_NORMAL,
+                            FPS_MCI_FAST, FPS_MCI_HIGH,
+                            QUALITY_TEXT, QUALITY_LONGTEXT, true )
+        change_integer_list( quality_list, quality_list_text )
+    add_integer_with_range( CFG_PREFIX "threads", 0, 0, 64,
+                            THREADS_TEXT, THREADS_LONGTEXT, true )
     set_callback_video_filter( Open )
 vlc_module_end ()
 
 static const char *const ppsz_filter_options[] = {
-    "fps",
+    "fps", "mode", "quality", "threads",
     NULL
 };
 
@@ -63,6 +95,8 @@ typedef struct
     date_t          next_output_pts; /**< output calculated PTS */
     picture_t       *p_previous_pic; /**< kept source picture used to produce filter output */
     vlc_tick_t      i_output_frame_interval;
+    fps_mci_t       *p_mci; /**< motion compensated interpolator, if enabled */
+    vlc_tick_t      i_previous_date; /**< source date of the previous picture */
 } filter_sys_t;
 
 static void SetOutputDate(filter_sys_t *p_sys, picture_t *pic)
@@ -135,6 +169,68 @@ static picture_t *Filter( filter_t *p_filter, picture_t *p_picture)
     return last_pic;
 }
 
+/* Renders every output picture due before the new source picture, in
+   between the previous source picture and the new one */
+static picture_t *FilterInterpolate( filter_t *p_filter, picture_t *p_picture )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    const vlc_tick_t src_date = p_picture->date;
+
+    if( unlikely( src_date == VLC_TICK_INVALID) )
+    {
+        msg_Dbg( p_filter, "skipping non-dated picture");
+        picture_Release( p_picture );
+        return NULL;
+    }
+
+    p_picture->format.i_frame_rate = p_filter->fmt_out.video.i_frame_rate;
+    p_picture->format.i_frame_rate_base = p_filter->fmt_out.video.i_frame_rate_base;
+
+    /* Without a previous picture, or when timestamps jumped, restart from
+        the new picture as there is nothing sensible to interpolate */
+    if( unlikely( p_sys->i_previous_date == VLC_TICK_INVALID ||
+                  src_date <= p_sys->i_previous_date ||
+                  src_date - p_sys->i_previous_date > MCI_MAX_GAP ) )
+    {
+        msg_Dbg( p_filter, "Resetting timestamps" );
+        date_Set( &p_sys->next_output_pts, src_date );
+        fps_mci_Flush( p_sys->p_mci );
+        fps_mci_Push( p_sys->p_mci, p_picture );
+        p_sys->i_previous_date = src_date;
+        SetOutputDate( p_sys, p_picture );
+        return p_picture;
+    }
+
+    const vlc_tick_t i_previous_date = p_sys->i_previous_date;
+    vlc_picture_chain_t output;
+    vlc_picture_chain_Init( &output );
+
+    fps_mci_Push( p_sys->p_mci, p_picture );
+    p_sys->i_previous_date = src_date;
+
+    while( date_Get( &p_sys->next_output_pts ) < src_date )
+    {
+        const vlc_tick_t out_date = date_Get( &p_sys->next_output_pts );
+        picture_t *p_out = picture_NewFromFormat( &p_filter->fmt_out.video );
+        if( unlikely( p_out == NULL ) )
+        {
+            date_Increment( &p_sys->next_output_pts, 1 );
+            continue;
+        }
+
+        const vlc_tick_t offset = __MAX( out_date - i_previous_date, 0 );
+        const unsigned weight = offset * 256 / ( src_date - i_previous_date );
+
+        fps_mci_Interpolate( p_sys->p_mci, p_out, weight );
+        picture_CopyProperties( p_out, p_picture );
+        SetOutputDate( p_sys, p_out );
+        vlc_picture_chain_Append( &output, p_out );
+    }
+
+    picture_Release( p_picture );
+    return vlc_picture_chain_PeekFront( &output );
+}
+
 static void Flush( filter_t *p_filter )
 {
     filter_sys_t *p_sys = p_filter->p_sys;
@@ -145,11 +241,17 @@ static void Flush( filter_t *p_filter )
         picture_Release( p_sys->p_previous_pic );
         p_sys->p_previous_pic = NULL;
     }
+    if( p_sys->p_mci )
+        fps_mci_Flush( p_sys->p_mci );
+    p_sys->i_previous_date = VLC_TICK_INVALID;
 }
 
 static void Close( filter_t *p_filter )
 {
+    filter_sys_t *p_sys = p_filter->p_sys;
     Flush( p_filter );
+    if( p_sys->p_mci )
+        fps_mci_Delete( p_sys->p_mci );
     if( p_filter->vctx_out )
         vlc_video_context_Release( p_filter->vctx_out );
 }
@@ -160,6 +262,12 @@ static const struct vlc_filter_operations filter_ops =
     .flush = Flush,
 };
 
+static const struct vlc_filter_operations filter_mci_ops =
+{
+    .filter_video = FilterInterpolate, .close = Close,
+    .flush = Flush,
+};
+
 static int Open( filter_t *p_filter )
 {
     filter_sys_t *p_sys;
@@ -207,8 +315,23 @@ static int Open( filter_t *p_filter )
                p_filter->fmt_out.video.i_frame_rate, p_filter->fmt_out.video.i_frame_rate_base );
 
     p_sys->p_previous_pic = NULL;
+    p_sys->i_previous_date = VLC_TICK_INVALID;
+    p_sys->p_mci = NULL;
+
+    char *psz_mode = var_InheritString( p_filter, CFG_PREFIX "mode" );
+    if( psz_mode != NULL && !strcmp( psz_mode, "mci" ) )
+    {
+        p_sys->p_mci = fps_mci_New( &p_filter->fmt_in.video,
+                                    var_InheritInteger( p_filter, CFG_PREFIX "quality" ),
+                                    var_InheritInteger( p_filter, CFG_PREFIX "threads" ) );
+        if( p_sys->p_mci == NULL )
+            msg_Warn( p_filter, "motion compensated interpolation not "
+                      "available for %4.4s, duplicating pictures",
+                      (const char *)&p_filter->fmt_in.video.i_chroma );
+    }
+    free( psz_mode );
 
-    p_filter->ops = &filter_ops;
+    p_filter->ops = p_sys->p_mci ? &filter_mci_ops : &filter_ops;
 
     /* We don't change neither the format nor the picture */
     if ( p_filter->vctx_in )
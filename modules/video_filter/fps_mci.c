@@ -0,0 +1,818 @@
+/*****************************************************************************
+ * fps_mci.c : motion compensated frame interpolation for the fps filter
+ *****************************************************************************
+ * Copyright (C) 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdlib.h>
+
+#include <vlc_common.h>
+#include <vlc_cpu.h>
+#include <vlc_executor.h>
+#include <vlc_picture.h>
+
+#include "fps_mci.h"
+
+#define MCI_BLOCK       16 /* luma block size at full resolution */
+#define MCI_MIN_BLOCK    8 /* smallest block matched in the pyramid */
+#define MCI_MAX_LEVELS   4
+#define MCI_MIN_SIZE    32 /* smallest plane dimension in the pyramid */
+/* Mean absolute difference per pixel above which a vector is not trusted
+ * (occlusions, scene cuts) and the block is blended without motion */
+#define MCI_MAX_MAD     24
+
+typedef struct
+{
+    int16_t x;
+    int16_t y;
+} mci_mv_t;
+
+typedef unsigned (*mci_sad_t)(const uint8_t *, ptrdiff_t,
+                              const uint8_t *, ptrdiff_t);
+typedef void (*mci_blend_t)(uint8_t *, const uint8_t *, const uint8_t *,
+                            unsigned, unsigned);
+
+typedef struct
+{
+    uint8_t *pixels;
+    ptrdiff_t pitch;
+    int width;
+    int height;
+} mci_plane_t;
+
+struct mci_row
+{
+    struct vlc_runnable runnable;
+    fps_mci_t *mci;
+    unsigned by;
+};
+
+struct fps_mci
+{
+    vlc_executor_t *executor;
+    const vlc_chroma_description_t *dsc;
+
+    unsigned levels;
+    int range;      /**< full search range at the coarsest level */
+    int refine;     /**< refinement range at the finer levels */
+    bool smooth;    /**< median filter the final vector field */
+
+    unsigned blocks_w;
+    unsigned blocks_h;
+
+    picture_t *pics[2];     /**< previous and latest source pictures */
+    mci_plane_t pyramid[2][MCI_MAX_LEVELS];
+    uint8_t *pyramid_buf[2];
+    bool estimated;
+
+    mci_mv_t *mv;
+    mci_mv_t *mv_tmp;
+    unsigned *sad;
+    struct mci_row *rows;
+
+    mci_sad_t sad16;
+    mci_sad_t sad8;
+    mci_blend_t blend;
+
+    /* Parameters of the pass being run */
+    unsigned level;
+    picture_t *dst;
+    unsigned weight;
+};
+
+/*****************************************************************************
+ * Kernels
+ *****************************************************************************/
+static inline unsigned SadC(const uint8_t *a, ptrdiff_t a_pitch,
+                            const uint8_t *b, ptrdiff_t b_pitch,
+                            unsigned size)
+{
+    unsigned sum = 0;
+
+    for (unsigned y = 0; y < size; y++)
+    {
+        for (unsigned x = 0; x < size; x++)
+            sum += abs(a[x] - b[x]);
+        a += a_pitch;
+        b += b_pitch;
+    }
+    return sum;
+}
+
+static unsigned Sad16C(const uint8_t *a, ptrdiff_t a_pitch,
+                       const uint8_t *b, ptrdiff_t b_pitch)
+{
+    return SadC(a, a_pitch, b, b_pitch, 16);
+}
+
+static unsigned Sad8C(const uint8_t *a, ptrdiff_t a_pitch,
+                      const uint8_t *b, ptrdiff_t b_pitch)
+{
+    return SadC(a, a_pitch, b, b_pitch, 8);
+}
+
+static void BlendC(uint8_t *dst, const uint8_t *a, const uint8_t *b,
+                   unsigned width, unsigned weight)
+{
+    const unsigned wa = 256 - weight;
+
+    for (unsigned x = 0; x < width; x++)
+        dst[x] = (a[x] * wa + b[x] * weight + 128) >> 8;
+}
+
+#ifdef HAVE_SSE2_INTRINSICS
+# include <emmintrin.h>
+
+__attribute__ ((__target__ ("sse2")))
+static unsigned Sad16SSE2(const uint8_t *a, ptrdiff_t a_pitch,
+                          const uint8_t *b, ptrdiff_t b_pitch)
+{
+    __m128i acc = _mm_setzero_si128();
+
+    for (unsigned y = 0; y < 16; y++)
+    {
+        const __m128i va = _mm_loadu_si128((const __m128i *)a);
+        const __m128i vb = _mm_loadu_si128((const __m128i *)b);
+
+        acc = _mm_add_epi64(acc, _mm_sad_epu8(va, vb));
+        a += a_pitch;
+        b += b_pitch;
+    }
+    return _mm_cvtsi128_si32(acc) + _mm_cvtsi128_si32(_mm_srli_si128(acc, 8));
+}
+
+__attribute__ ((__target__ ("sse2")))
+static unsigned Sad8SSE2(const uint8_t *a, ptrdiff_t a_pitch,
+                         const uint8_t *b, ptrdiff_t b_pitch)
+{
+    __m128i acc = _mm_setzero_si128();
+
+    for (unsigned y = 0; y < 8; y += 2)
+    {
+        const __m128i va = _mm_unpacklo_epi64(
+            _mm_loadl_epi64((const __m128i *)a),
+            _mm_loadl_epi64((const __m128i *)(a + a_pitch)));
+        const __m128i vb = _mm_unpacklo_epi64(
+            _mm_loadl_epi64((const __m128i *)b),
+            _mm_loadl_epi64((const __m128i *)(b + b_pitch)));
+
+        acc = _mm_add_epi64(acc, _mm_sad_epu8(va, vb));
+        a += 2 * a_pitch;
+        b += 2 * b_pitch;
+    }
+    return _mm_cvtsi128_si32(acc) + _mm_cvtsi128_si32(_mm_srli_si128(acc, 8));
+}
+
+__attribute__ ((__target__ ("sse2")))
+static void BlendSSE2(uint8_t *dst, const uint8_t *a, const uint8_t *b,
+                      unsigned width, unsigned weight)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i wa = _mm_set1_epi16(256 - weight);
+    const __m128i wb = _mm_set1_epi16(weight);
+    const __m128i rnd = _mm_set1_epi16(128);
+    unsigned x = 0;
+
+    /* a * wa + b * wb + 128 never exceeds 16 bits unsigned */
+    for (; x + 16 <= width; x += 16)
+    {
+        const __m128i va = _mm_loadu_si128((const __m128i *)(a + x));
+        const __m128i vb = _mm_loadu_si128((const __m128i *)(b + x));
+        __m128i lo = _mm_add_epi16(
+            _mm_mullo_epi16(_mm_unpacklo_epi8(va, zero), wa),
+            _mm_mullo_epi16(_mm_unpacklo_epi8(vb, zero), wb));
+        __m128i hi = _mm_add_epi16(
+            _mm_mullo_epi16(_mm_unpackhi_epi8(va, zero), wa),
+            _mm_mullo_epi16(_mm_unpackhi_epi8(vb, zero), wb));
+
+        lo = _mm_srli_epi16(_mm_add_epi16(lo, rnd), 8);
+        hi = _mm_srli_epi16(_mm_add_epi16(hi, rnd), 8);
+        _mm_storeu_si128((__m128i *)(dst + x), _mm_packus_epi16(lo, hi));
+    }
+    BlendC(dst + x, a + x, b + x, width - x, weight);
+}
+#endif
+
+#ifdef HAVE_AVX2_INTRINSICS
+# include <immintrin.h>
+
+__attribute__ ((__target__ ("avx2")))
+static unsigned Sad16AVX2(const uint8_t *a, ptrdiff_t a_pitch,
+                          const uint8_t *b, ptrdiff_t b_pitch)
+{
+    __m256i acc = _mm256_setzero_si256();
+
+    for (unsigned y = 0; y < 16; y += 2)
+    {
+        const __m256i va = _mm256_inserti128_si256(
+            _mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)a)),
+            _mm_loadu_si128((const __m128i *)(a + a_pitch)), 1);
+        const __m256i vb = _mm256_inserti128_si256(
+            _mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)b)),
+            _mm_loadu_si128((const __m128i *)(b + b_pitch)), 1);
+
+        acc = _mm256_add_epi64(acc, _mm256_sad_epu8(va, vb));
+        a += 2 * a_pitch;
+        b += 2 * b_pitch;
+    }
+
+    const __m128i sum = _mm_add_epi64(_mm256_castsi256_si128(acc),
+                                      _mm256_extracti128_si256(acc, 1));
+    return _mm_cvtsi128_si32(sum) + _mm_cvtsi128_si32(_mm_srli_si128(sum, 8));
+}
+#endif
+
+#ifdef __ARM_NEON
+# include <arm_neon.h>
+
+static inline unsigned SumNEON(uint16x8_t acc)
+{
+    const uint64x2_t sum = vpaddlq_u32(vpaddlq_u16(acc));
+    return vgetq_lane_u64(sum, 0) + vgetq_lane_u64(sum, 1);
+}
+
+static unsigned Sad16NEON(const uint8_t *a, ptrdiff_t a_pitch,
+                          const uint8_t *b, ptrdiff_t b_pitch)
+{
+    uint16x8_t acc = vdupq_n_u16(0);
+
+    for (unsigned y = 0; y < 16; y++)
+    {
+        const uint8x16_t va = vld1q_u8(a);
+        const uint8x16_t vb = vld1q_u8(b);
+
+        acc = vabal_u8(acc, vget_low_u8(va), vget_low_u8(vb));
+        acc = vabal_u8(acc, vget_high_u8(va), vget_high_u8(vb));
+        a += a_pitch;
+        b += b_pitch;
+    }
+    return SumNEON(acc);
+}
+
+static unsigned Sad8NEON(const uint8_t *a, ptrdiff_t a_pitch,
+                         const uint8_t *b, ptrdiff_t b_pitch)
+{
+    uint16x8_t acc = vdupq_n_u16(0);
+
+    for (unsigned y = 0; y < 8; y++)
+    {
+        acc = vabal_u8(acc, vld1_u8(a), vld1_u8(b));
+        a += a_pitch;
+        b += b_pitch;
+    }
+    return SumNEON(acc);
+}
+
+static void BlendNEON(uint8_t *dst, const uint8_t *a, const uint8_t *b,
+                      unsigned width, unsigned weight)
+{
+    const uint16x8_t wa = vdupq_n_u16(256 - weight);
+    const uint16x8_t wb = vdupq_n_u16(weight);
+    unsigned x = 0;
+
+    for (; x + 8 <= width; x += 8)
+    {
+        uint16x8_t sum = vmulq_u16(vmovl_u8(vld1_u8(a + x)), wa);
+
+        sum = vmlaq_u16(sum, vmovl_u8(vld1_u8(b + x)), wb);
+        vst1_u8(dst + x, vrshrn_n_u16(sum, 8));
+    }
+    BlendC(dst + x, a + x, b + x, width - x, weight);
+}
+#endif
+
+/*****************************************************************************
+ * Helpers
+ *****************************************************************************/
+static inline int DivRound(int num, int den)
+{
+    return num >= 0 ? (num + den / 2) / den : -((den / 2 - num) / den);
+}
+
+static void Downscale(mci_plane_t *restrict dst, const mci_plane_t *src)
+{
+    for (int y = 0; y < dst->height; y++)
+    {
+        const uint8_t *l0 = src->pixels + 2 * y * src->pitch;
+        const uint8_t *l1 = l0 + src->pitch;
+        uint8_t *out = dst->pixels + y * dst->pitch;
+
+        for (int x = 0; x < dst->width; x++)
+            out[x] = (l0[2 * x] + l0[2 * x + 1] + l1[2 * x] + l1[2 * x + 1]
+                      + 2) >> 2;
+    }
+}
+
+static void RunRows(fps_mci_t *mci, void (*run)(void *))
+{
+    for (unsigned by = 0; by < mci->blocks_h; by++)
+    {
+        struct mci_row *row = &mci->rows[by];
+
+        if (mci->executor != NULL)
+        {
+            row->runnable.run = run;
+            row->runnable.userdata = row;
+            vlc_executor_Submit(mci->executor, &row->runnable);
+        }
+        else
+            run(row);
+    }
+
+    if (mci->executor != NULL)
+        vlc_executor_WaitIdle(mci->executor);
+}
+
+/* Position and size of a block at a given pyramid level. Blocks smaller
+ * than MCI_MIN_BLOCK are grown around their center. */
+static void BlockGeometry(const mci_plane_t *plane, unsigned level,
+                          unsigned bx, unsigned by,
+                          int *x, int *y, int *size)
+{
+    int s = MCI_BLOCK >> level;
+    int px = (bx * MCI_BLOCK) >> level;
+    int py = (by * MCI_BLOCK) >> level;
+
+    if (s < MCI_MIN_BLOCK)
+    {
+        px -= (MCI_MIN_BLOCK - s) / 2;
+        py -= (MCI_MIN_BLOCK - s) / 2;
+        s = MCI_MIN_BLOCK;
+    }
+    *x = VLC_CLIP(px, 0, plane->width - s);
+    *y = VLC_CLIP(py, 0, plane->height - s);
+    *size = s;
+}
+
+static inline bool IsValid(const mci_plane_t *plane, int x, int y, int size,
+                           int vx, int vy)
+{
+    return x + vx >= 0 && y + vy >= 0
+        && x + vx + size <= plane->width && y + vy + size <= plane->height;
+}
+
+static inline unsigned BlockSad(const fps_mci_t *mci,
+                                const mci_plane_t *cur, const mci_plane_t *prev,
+                                int x, int y, int size, int vx, int vy)
+{
+    const mci_sad_t sad = size == 16 ? mci->sad16 : mci->sad8;
+
+    return sad(cur->pixels + y * cur->pitch + x, cur->pitch,
+               prev->pixels + (y + vy) * prev->pitch + x + vx, prev->pitch);
+}
+
+/*****************************************************************************
+ * Motion estimation
+ *****************************************************************************/
+/* Vectors point from the latest picture to the previous one: the block at
+ * p in the latest picture matches the block at p + mv in the previous one. */
+static void EstimateRow(void *data)
+{
+    struct mci_row *row = data;
+    fps_mci_t *mci = row->mci;
+    const unsigned level = mci->level;
+    const mci_plane_t *cur = &mci->pyramid[1][level];
+    const mci_plane_t *prev = &mci->pyramid[0][level];
+    const bool coarsest = level == mci->levels - 1;
+
+    for (unsigned bx = 0; bx < mci->blocks_w; bx++)
+    {
+        const unsigned i = row->by * mci->blocks_w + bx;
+        int x, y, size;
+
+        BlockGeometry(cur, level, bx, row->by, &x, &y, &size);
+
+        /* Deviation from the predictor is penalized to keep the field
+         * smooth in flat areas */
+        const unsigned lambda = size * size / 64;
+        mci_mv_t pred = { 0, 0 };
+        if (!coarsest)
+        {
+            pred.x = 2 * mci->mv[i].x;
+            pred.y = 2 * mci->mv[i].y;
+        }
+
+        mci_mv_t cands[3] = { pred, { 0, 0 }, { 0, 0 } };
+        unsigned cand_count = 2;
+        if (bx > 0)
+            cands[cand_count++] = mci->mv[i - 1];
+
+        mci_mv_t best = { 0, 0 };
+        unsigned best_sad = BlockSad(mci, cur, prev, x, y, size, 0, 0);
+        unsigned best_cost = best_sad
+                           + lambda * (abs(pred.x) + abs(pred.y));
+
+        for (unsigned c = 0; c < cand_count; c++)
+        {
+            const int vx = cands[c].x, vy = cands[c].y;
+
+            if ((vx == 0 && vy == 0) || !IsValid(prev, x, y, size, vx, vy))
+                continue;
+
+            const unsigned sad = BlockSad(mci, cur, prev, x, y, size, vx, vy);
+            const unsigned cost = sad
+                + lambda * (abs(vx - pred.x) + abs(vy - pred.y));
+            if (cost < best_cost)
+            {
+                best = cands[c];
+                best_sad = sad;
+                best_cost = cost;
+            }
+        }
+
+        /* Full search at the coarsest level, local refinement otherwise */
+        const int radius = coarsest ? mci->range : mci->refine;
+        const mci_mv_t center = coarsest ? (mci_mv_t){ 0, 0 } : best;
+
+        for (int dy = -radius; dy <= radius; dy++)
+            for (int dx = -radius; dx <= radius; dx++)
+            {
+                const int vx = center.x + dx, vy = center.y + dy;
+
+                if ((vx == best.x && vy == best.y)
+                 || !IsValid(prev, x, y, size, vx, vy))
+                    continue;
+
+                const unsigned sad = BlockSad(mci, cur, prev, x, y, size,
+                                              vx, vy);
+                const unsigned cost = sad
+                    + lambda * (abs(vx - pred.x) + abs(vy - pred.y));
+                if (cost < best_cost)
+                {
+                    best.x = vx;
+                    best.y = vy;
+                    best_sad = sad;
+                    best_cost = cost;
+                }
+            }
+
+        mci->mv[i] = best;
+        if (level == 0)
+            mci->sad[i] = best_sad;
+    }
+}
+
+static int Median5(int a, int b, int c, int d, int e)
+{
+    int v[5] = { a, b, c, d, e };
+
+    for (int i = 1; i < 5; i++)
+        for (int j = i; j > 0 && v[j - 1] > v[j]; j--)
+        {
+            const int t = v[j];
+            v[j] = v[j - 1];
+            v[j - 1] = t;
+        }
+    return v[2];
+}
+
+static void SmoothRow(void *data)
+{
+    struct mci_row *row = data;
+    fps_mci_t *mci = row->mci;
+    const mci_plane_t *cur = &mci->pyramid[1][0];
+    const mci_plane_t *prev = &mci->pyramid[0][0];
+    const unsigned w = mci->blocks_w;
+    const unsigned by = row->by;
+
+    for (unsigned bx = 0; bx < w; bx++)
+    {
+        const unsigned i = by * w + bx;
+        const mci_mv_t *self = &mci->mv[i];
+        const mci_mv_t *l = bx > 0 ? &mci->mv[i - 1] : self;
+        const mci_mv_t *r = bx + 1 < w ? &mci->mv[i + 1] : self;
+        const mci_mv_t *t = by > 0 ? &mci->mv[i - w] : self;
+        const mci_mv_t *b = by + 1 < mci->blocks_h ? &mci->mv[i + w] : self;
+        const int vx = Median5(self->x, l->x, r->x, t->x, b->x);
+        const int vy = Median5(self->y, l->y, r->y, t->y, b->y);
+        int x, y, size;
+
+        mci->mv_tmp[i] = *self;
+        if (vx == self->x && vy == self->y)
+            continue;
+
+        BlockGeometry(cur, 0, bx, by, &x, &y, &size);
+        if (!IsValid(prev, x, y, size, vx, vy))
+            continue;
+
+        /* Keep outliers that match clearly better than their neighbours */
+        const unsigned sad = BlockSad(mci, cur, prev, x, y, size, vx, vy);
+        if (sad <= mci->sad[i] + mci->sad[i] / 8 + size * size / 4)
+        {
+            mci->mv_tmp[i] = (mci_mv_t){ vx, vy };
+            mci->sad[i] = sad;
+        }
+    }
+}
+
+static void Estimate(fps_mci_t *mci)
+{
+    for (unsigned level = mci->levels; level-- > 0;)
+    {
+        mci->level = level;
+        RunRows(mci, EstimateRow);
+    }
+
+    if (mci->smooth)
+    {
+        RunRows(mci, SmoothRow);
+
+        mci_mv_t *tmp = mci->mv;
+        mci->mv = mci->mv_tmp;
+        mci->mv_tmp = tmp;
+    }
+    mci->estimated = true;
+}
+
+/*****************************************************************************
+ * Interpolation
+ *****************************************************************************/
+static void InterpolateRow(void *data)
+{
+    struct mci_row *row = data;
+    fps_mci_t *mci = row->mci;
+    const picture_t *pa = mci->pics[0];
+    const picture_t *pb = mci->pics[1];
+    picture_t *dst = mci->dst;
+    const int weight = mci->weight;
+
+    for (int p = 0; p < dst->i_planes; p++)
+    {
+        const vlc_rational_t *rw = &mci->dsc->p[p].w;
+        const vlc_rational_t *rh = &mci->dsc->p[p].h;
+        const int bw = MCI_BLOCK * rw->num / rw->den;
+        const int bh = MCI_BLOCK * rh->num / rh->den;
+        const int width = __MIN(dst->p[p].i_visible_pitch,
+                                pa->p[p].i_visible_pitch);
+        const int height = __MIN(dst->p[p].i_visible_lines,
+                                 pa->p[p].i_visible_lines);
+        const int y0 = row->by * bh;
+
+        if (y0 >= height)
+            continue;
+
+        const int lines = __MIN(bh, height - y0);
+
+        for (unsigned bx = 0; bx < mci->blocks_w; bx++)
+        {
+            const int x0 = bx * bw;
+            if (x0 >= width)
+                break;
+
+            const int cols = __MIN(bw, width - x0);
+            const unsigned i = row->by * mci->blocks_w + bx;
+            int vx = 0, vy = 0;
+
+            if (mci->sad[i] <= MCI_MAX_MAD * MCI_BLOCK * MCI_BLOCK)
+            {
+                vx = DivRound(mci->mv[i].x * rw->num, rw->den);
+                vy = DivRound(mci->mv[i].y * rh->num, rh->den);
+            }
+
+            /* The block at time t comes from p + t.mv in the previous
+             * picture and p - (1 - t).mv in the latest one */
+            const int ax = DivRound(vx * weight, 256);
+            const int ay = DivRound(vy * weight, 256);
+            const int xa = VLC_CLIP(x0 + ax, 0, width - cols);
+            const int ya = VLC_CLIP(y0 + ay, 0, height - lines);
+            const int xb = VLC_CLIP(x0 + ax - vx, 0, width - cols);
+            const int yb = VLC_CLIP(y0 + ay - vy, 0, height - lines);
+
+            const uint8_t *srca = pa->p[p].p_pixels
+                                + ya * pa->p[p].i_pitch + xa;
+            const uint8_t *srcb = pb->p[p].p_pixels
+                                + yb * pb->p[p].i_pitch + xb;
+            uint8_t *out = dst->p[p].p_pixels + y0 * dst->p[p].i_pitch + x0;
+
+            for (int y = 0; y < lines; y++)
+            {
+                mci->blend(out, srca, srcb, cols, weight);
+                srca += pa->p[p].i_pitch;
+                srcb += pb->p[p].i_pitch;
+                out += dst->p[p].i_pitch;
+            }
+        }
+    }
+}
+
+/*****************************************************************************
+ * Public API
+ *****************************************************************************/
+bool fps_mci_IsSupported(const video_format_t *fmt)
+{
+    const vlc_chroma_description_t *dsc =
+        vlc_fourcc_GetChromaDescription(fmt->i_chroma);
+
+    if (dsc == NULL || dsc->pixel_size != 1
+     || !vlc_fourcc_IsYUV(fmt->i_chroma))
+        return false;
+    /* Semi-planar chroma would need even horizontal vectors */
+    if (dsc->plane_count != 1 && dsc->plane_count != 3)
+        return false;
+    return fmt->i_visible_width >= MCI_MIN_SIZE
+        && fmt->i_visible_height >= MCI_MIN_SIZE;
+}
+
+fps_mci_t *fps_mci_New(const video_format_t *fmt, int quality,
+                       unsigned threads)
+{
+    static const struct
+    {
+        unsigned levels;
+        int range;
+        int refine;
+        bool smooth;
+    } presets[] = {
+        [FPS_MCI_FAST]   = { 2, 4, 1, false },
+        [FPS_MCI_NORMAL] = { 3, 4, 1, false },
+        [FPS_MCI_HIGH]   = { 4, 4, 2, true },
+    };
+
+    if (!fps_mci_IsSupported(fmt))
+        return NULL;
+
+    fps_mci_t *mci = calloc(1, sizeof (*mci));
+    if (unlikely(mci == NULL))
+        return NULL;
+
+    quality = VLC_CLIP(quality, FPS_MCI_FAST, FPS_MCI_HIGH);
+    mci->dsc = vlc_fourcc_GetChromaDescription(fmt->i_chroma);
+    mci->range = presets[quality].range;
+    mci->refine = presets[quality].refine;
+    mci->smooth = presets[quality].smooth;
+
+    const int width = fmt->i_visible_width;
+    const int height = fmt->i_visible_height;
+
+    mci->levels = presets[quality].levels;
+    while (mci->levels > 1
+        && ((width >> (mci->levels - 1)) < MCI_MIN_SIZE
+         || (height >> (mci->levels - 1)) < MCI_MIN_SIZE))
+        mci->levels--;
+
+    mci->blocks_w = (width + MCI_BLOCK - 1) / MCI_BLOCK;
+    mci->blocks_h = (height + MCI_BLOCK - 1) / MCI_BLOCK;
+
+    const size_t blocks = mci->blocks_w * mci->blocks_h;
+    mci->mv = calloc(blocks, sizeof (*mci->mv));
+    mci->mv_tmp = calloc(blocks, sizeof (*mci->mv_tmp));
+    mci->sad = calloc(blocks, sizeof (*mci->sad));
+    mci->rows = calloc(mci->blocks_h, sizeof (*mci->rows));
+    if (unlikely(mci->mv == NULL || mci->mv_tmp == NULL || mci->sad == NULL
+              || mci->rows == NULL))
+        goto error;
+
+    for (unsigned by = 0; by < mci->blocks_h; by++)
+    {
+        mci->rows[by].mci = mci;
+        mci->rows[by].by = by;
+    }
+
+    /* Downscaled levels; level 0 points to the source pictures */
+    size_t pyramid_size = 0;
+    for (unsigned l = 1; l < mci->levels; l++)
+        pyramid_size += (size_t)(width >> l) * (height >> l);
+
+    for (unsigned i = 0; i < 2; i++)
+    {
+        if (pyramid_size > 0)
+        {
+            mci->pyramid_buf[i] = malloc(pyramid_size);
+            if (unlikely(mci->pyramid_buf[i] == NULL))
+                goto error;
+        }
+
+        uint8_t *buf = mci->pyramid_buf[i];
+        for (unsigned l = 1; l < mci->levels; l++)
+        {
+            mci_plane_t *plane = &mci->pyramid[i][l];
+
+            plane->width = width >> l;
+            plane->height = height >> l;
+            plane->pitch = plane->width;
+            plane->pixels = buf;
+            buf += plane->width * plane->height;
+        }
+    }
+
+    mci->sad16 = Sad16C;
+    mci->sad8 = Sad8C;
+    mci->blend = BlendC;
+#ifdef HAVE_SSE2_INTRINSICS
+    if (vlc_CPU_SSE2())
+    {
+        mci->sad16 = Sad16SSE2;
+        mci->sad8 = Sad8SSE2;
+        mci->blend = BlendSSE2;
+    }
+#endif
+#ifdef HAVE_AVX2_INTRINSICS
+    if (vlc_CPU_AVX2())
+        mci->sad16 = Sad16AVX2;
+#endif
+#ifdef __ARM_NEON
+    if (vlc_CPU_ARM_NEON())
+    {
+        mci->sad16 = Sad16NEON;
+        mci->sad8 = Sad8NEON;
+        mci->blend = BlendNEON;
+    }
+#endif
+
+    if (threads == 0)
+        threads = vlc_GetCPUCount();
+    if (threads > 1)
+        mci->executor = vlc_executor_New(threads);
+    /* Without executor, rows are processed on the calling thread */
+    return mci;
+
+error:
+    fps_mci_Delete(mci);
+    return NULL;
+}
+
+void fps_mci_Delete(fps_mci_t *mci)
+{
+    fps_mci_Flush(mci);
+    if (mci->executor != NULL)
+        vlc_executor_Delete(mci->executor);
+    free(mci->pyramid_buf[0]);
+    free(mci->pyramid_buf[1]);
+    free(mci->rows);
+    free(mci->sad);
+    free(mci->mv_tmp);
+    free(mci->mv);
+    free(mci);
+}
+
+void fps_mci_Push(fps_mci_t *mci, picture_t *pic)
+{
+    if (mci->pics[0] != NULL)
+        picture_Release(mci->pics[0]);
+    mci->pics[0] = mci->pics[1];
+    mci->pics[1] = picture_Hold(pic);
+
+    /* The latest pyramid becomes the previous one */
+    mci_plane_t tmp[MCI_MAX_LEVELS];
+    memcpy(tmp, mci->pyramid[0], sizeof (tmp));
+    memcpy(mci->pyramid[0], mci->pyramid[1], sizeof (tmp));
+    memcpy(mci->pyramid[1], tmp, sizeof (tmp));
+
+    uint8_t *buf = mci->pyramid_buf[0];
+    mci->pyramid_buf[0] = mci->pyramid_buf[1];
+    mci->pyramid_buf[1] = buf;
+
+    mci_plane_t *base = &mci->pyramid[1][0];
+    base->pixels = pic->p[0].p_pixels;
+    base->pitch = pic->p[0].i_pitch;
+    base->width = pic->p[0].i_visible_pitch;
+    base->height = pic->p[0].i_visible_lines;
+
+    for (unsigned l = 1; l < mci->levels; l++)
+        Downscale(&mci->pyramid[1][l], &mci->pyramid[1][l - 1]);
+
+    mci->estimated = false;
+}
+
+void fps_mci_Flush(fps_mci_t *mci)
+{
+    for (unsigned i = 0; i < 2; i++)
+        if (mci->pics[i] != NULL)
+        {
+            picture_Release(mci->pics[i]);
+            mci->pics[i] = NULL;
+        }
+}
+
+int fps_mci_Interpolate(fps_mci_t *mci, picture_t *dst, unsigned weight)
+{
+    if (mci->pics[0] == NULL)
+        return VLC_EGENERIC;
+
+    if (!mci->estimated)
+        Estimate(mci);
+
+    mci->dst = dst;
+    mci->weight = __MIN(weight, 256);
+    RunRows(mci, InterpolateRow);
+    mci->dst = NULL;
+    return VLC_SUCCESS;
+}
@@ -0,0 +1,83 @@
+/*****************************************************************************
+ * fps_mci.h : motion compensated frame interpolation for the fps filter
+ *****************************************************************************
+ * Copyright (C) 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_FPS_MCI_H
+#define VLC_FPS_MCI_H 1
+
+/**
+ * \file
+ * Block based motion compensated interpolation between two pictures.
+ *
+ * Motion is estimated on 16x16 luma blocks with a hierarchical search over
+ * a downscaled luma pyramid, then each block of the intermediate picture is
+ * fetched from both source pictures along its vector and blended.
+ * Block rows are processed in parallel on a private executor.
+ */
+
+typedef struct fps_mci fps_mci_t;
+
+enum fps_mci_quality
+{
+    FPS_MCI_FAST = 0,   /**< two pyramid levels, small search range */
+    FPS_MCI_NORMAL,     /**< three pyramid levels */
+    FPS_MCI_HIGH,       /**< four levels, wider refinement, vector smoothing */
+};
+
+/**
+ * Checks whether pictures of the given format can be interpolated.
+ */
+bool fps_mci_IsSupported(const video_format_t *fmt);
+
+/**
+ * Creates an interpolator.
+ *
+ * \param fmt format of the input and output pictures
+ * \param quality one of fps_mci_quality
+ * \param threads number of worker threads (0 for one per CPU)
+ * \return an interpolator or NULL on error
+ */
+fps_mci_t *fps_mci_New(const video_format_t *fmt, int quality,
+                       unsigned threads);
+void fps_mci_Delete(fps_mci_t *);
+
+/**
+ * Pushes a new source picture.
+ *
+ * The interpolator keeps a reference to the two most recent pictures;
+ * interpolated pictures lie between them.
+ */
+void fps_mci_Push(fps_mci_t *, picture_t *pic);
+
+/**
+ * Drops the pictures held by the interpolator.
+ */
+void fps_mci_Flush(fps_mci_t *);
+
+/**
+ * Renders an intermediate picture.
+ *
+ * \param dst picture to render to (same format as the source pictures)
+ * \param weight position between the previous (0) and the latest (256)
+ * pushed pictures
+ * \return VLC_SUCCESS, or VLC_EGENERIC if fewer than two pictures were pushed
+ */
+int fps_mci_Interpolate(fps_mci_t *, picture_t *dst, unsigned weight);
+
+#endif
@@ -1021,6 +1021,16 @@ static const char *const ppsz_prefres[] = {
     "This allow you to configure the initial caching amount for stream output " \
     "muxer. This value should be set in milliseconds." )
 
+#define SOUT_STATS_INTERVAL_TEXT N_("Stream output statistics interval (ms)")
+#define SOUT_STATS_INTERVAL_LONGTEXT N_( \
+    "Write the statistics of each stage of the stream output chain, as a " \
+    "JSON object, at this interval in milliseconds. 0 disables them." )
+
+#define SOUT_STATS_FILE_TEXT N_("Stream output statistics file")
+#define SOUT_STATS_FILE_LONGTEXT N_( \
+    "Append the stream output statistics to this file, one JSON object per " \
+    "line, instead of the debug log." )
+
 #define PACKETIZER_TEXT N_("Preferred packetizer list")
 #define PACKETIZER_LONGTEXT N_( \
     "This allows you to select the order in which VLC will choose its " \
@@ -2056,6 +2066,10 @@ vlc_module_begin ()
                                 SOUT_SPU_LONGTEXT, true )
     add_integer( "sout-mux-caching", 1500, SOUT_MUX_CACHING_TEXT,
                                 SOUT_MUX_CACHING_LONGTEXT, true )
+    add_integer( "sout-stats-interval", 0, SOUT_STATS_INTERVAL_TEXT,
+                                SOUT_STATS_INTERVAL_LONGTEXT, true )
+    add_savefile( "sout-stats-file", NULL, SOUT_STATS_FILE_TEXT,
+                                SOUT_STATS_FILE_LONGTEXT )
 
     set_section( N_("VLM"), NULL )
     add_loadfile("vlm-conf", NULL, VLM_CONF_TEXT, VLM_CONF_LONGTEXT)
@@ -121,6 +121,7 @@ VLC_WEAK unsigned vlc_CPU_raw(void)
 
 #if defined( __i386__ ) || defined( __x86_64__ )
     unsigned int i_eax, i_ebx, i_ecx, i_edx;
+    unsigned int i_max;
     bool b_amd;
 
     /* Needed for x86 CPU capabilities detection */
@@ -130,13 +131,13 @@ VLC_WEAK unsigned vlc_CPU_raw(void)
                   "cpuid\n\t" \
                   "xchgl %%ebx,%1\n\t" \
                   : "=a" (i_eax), "=r" (i_ebx), "=c" (i_ecx), "=d" (i_edx) \
-                  : "a" (reg) \
+                  : "a" (reg), "2" (0) \
                   : "cc");
 # else
 #  define cpuid(reg) \
     asm volatile ("cpuid\n\t" \
                   : "=a" (i_eax), "=b" (i_ebx), "=c" (i_ecx), "=d" (i_edx) \
-                  : "a" (reg) \
+                  : "a" (reg), "2" (0) \
                   : "cc");
 # endif
      /* Check if the OS really supports the requested instructions */
@@ -165,6 +166,7 @@ VLC_WEAK unsigned vlc_CPU_raw(void)
 
     /* the CPU supports the CPUID instruction - get its level */
     cpuid( 0x00000000 );
+    i_max = i_eax;
 
 # if defined (__i386__) && !defined (__i586__) \
   && !defined (__i686__) && !defined (__pentium4__) \
@@ -203,6 +205,32 @@ VLC_WEAK unsigned vlc_CPU_raw(void)
             i_capabilities |= VLC_CPU_SSE4_1;
         if (i_ecx & 0x00100000)
             i_capabilities |= VLC_CPU_SSE4_2;
+
+        /* AVX needs the OS to save the YMM state (XCR0 bits 1 and 2), and
+         * AVX-512 the opmask and ZMM states too (XCR0 bits 5 to 7) */
+        if ((i_ecx & 0x18000000) == 0x18000000) /* OSXSAVE and AVX */
+        {
+            unsigned int i_xcr0, i_xcr0_high;
+
+            asm volatile ("xgetbv\n\t"
+                          : "=a" (i_xcr0), "=d" (i_xcr0_high)
+                          : "c" (0));
+            if ((i_xcr0 & 0x00000006) == 0x00000006)
+            {
+                i_capabilities |= VLC_CPU_AVX;
+
+                if (i_max >= 7)
+                {
+                    cpuid( 0x00000007 );
+                    if (i_ebx & 0x00000020)
+                        i_capabilities |= VLC_CPU_AVX2;
+                    /* AVX-512 F and BW */
+                    if ((i_ebx & 0x40010000) == 0x40010000
+                     && (i_xcr0 & 0x000000e0) == 0x000000e0)
+                        i_capabilities |= VLC_CPU_AVX512;
+                }
+            }
+        }
     }
 
     /* test for additional capabilities */
@@ -291,6 +319,8 @@ void vlc_CPU_dump (vlc_object_t *obj)
         vlc_memstream_puts(&stream, "AVX ");
     if (vlc_CPU_AVX2())
         vlc_memstream_puts(&stream, "AVX2 ");
+    if (vlc_CPU_AVX512())
+        vlc_memstream_puts(&stream, "AVX-512 ");
     if (vlc_CPU_3dNOW())
         vlc_memstream_puts(&stream, "3DNow! ");
     if (vlc_CPU_XOP())
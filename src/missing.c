@@ -81,6 +81,13 @@ noreturn ssize_t sout_AccessOutWrite(sout_access_out_t *out, block_t *block)
     vlc_assert_unreachable ();
 }
 
+noreturn void sout_AccessOutGetStats(sout_access_out_t *out,
+                                     struct sout_access_out_stats *stats)
+{
+    VLC_UNUSED (out); VLC_UNUSED (stats);
+    vlc_assert_unreachable ();
+}
+
 #undef sout_AnnounceRegisterSDP
 session_descriptor_t *sout_AnnounceRegisterSDP (vlc_object_t *obj,
                                                 const char *sdp,
@@ -150,6 +157,12 @@ noreturn void sout_MuxFlush(sout_mux_t *mux, sout_input_t *input)
     vlc_assert_unreachable ();
 }
 
+noreturn void sout_MuxGetStats(sout_mux_t *mux, struct sout_mux_stats *stats)
+{
+    VLC_UNUSED (mux); VLC_UNUSED (stats);
+    vlc_assert_unreachable ();
+}
+
 noreturn void sout_StreamChainDelete(sout_stream_t *first,
                                      sout_stream_t *end)
 {
@@ -165,6 +178,20 @@ noreturn sout_stream_t *sout_StreamChainNew(sout_instance_t *sout,
     vlc_assert_unreachable ();
 }
 
+noreturn char *sout_StreamChainGetStats(sout_stream_t *first,
+                                        sout_stream_t *end)
+{
+    (void) first; (void) end;
+    vlc_assert_unreachable ();
+}
+
+noreturn int sout_StreamGetStats(sout_stream_t *s,
+                                 struct sout_stream_stats *stats)
+{
+    (void) s; (void) stats;
+    vlc_assert_unreachable ();
+}
+
 int vlc_sdp_Start (struct vlc_memstream *sdp, vlc_object_t *obj, const char *cfg,
                      const struct sockaddr *src, size_t srclen,
                      const struct sockaddr *addr, size_t addrlen)
@@ -1226,6 +1226,11 @@ char* httpd_ServerIP(const httpd_client_t *cl, char *ip, int *port)
     return net_GetSockAddress(vlc_tls_GetFD(cl->sock), ip, port) ? NULL : ip;
 }
 
+void httpd_ClientModeStream(httpd_client_t *cl)
+{
+    cl->b_stream_mode = true;
+}
+
 static void httpd_ClientDestroy(httpd_client_t *cl)
 {
     vlc_list_remove(&cl->node);
@@ -1921,6 +1926,7 @@ static void httpdLoop(httpd_host_t *host)
                     bool do_close = false;
 
                     cl->url = NULL;
+                    cl->b_stream_mode = false;
 
                     if (cl->query.i_proto != HTTPD_PROTO_HTTP
                      || cl->query.i_version > 0)
@@ -31,6 +31,9 @@
 #endif
 
 #include <assert.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdatomic.h>
 
 #include <vlc_common.h>
 
@@ -46,6 +49,10 @@
 #include <vlc_block.h>
 #include <vlc_codec.h>
 #include <vlc_modules.h>
+#include <vlc_atomic.h>
+#include <vlc_fs.h>
+#include <vlc_list.h>
+#include <vlc_memstream.h>
 
 #include "input/input_interface.h"
 
@@ -72,6 +79,370 @@ static int  mrl_Parse( mrl_t *p_mrl, const char *psz_mrl );
 /* mrl_Clean: clean p_mrl  after a call to mrl_Parse */
 static void mrl_Clean( mrl_t *p_mrl );
 
+/*****************************************************************************
+ * Statistics
+ *****************************************************************************/
+
+static const char sout_stream_type[] = "stream out";
+static const char sout_access_type[] = "access out";
+
+/* Histogram of durations, updated without locking */
+struct sout_stats_counter
+{
+    atomic_uintmax_t count;
+    atomic_uintmax_t total;
+    atomic_uintmax_t max;
+    atomic_uintmax_t buckets[SOUT_STATS_BUCKETS];
+};
+
+static void sout_stats_Init( struct sout_stats_counter *p_counter )
+{
+    atomic_init( &p_counter->count, 0 );
+    atomic_init( &p_counter->total, 0 );
+    atomic_init( &p_counter->max, 0 );
+    for( size_t i = 0; i < SOUT_STATS_BUCKETS; i++ )
+        atomic_init( &p_counter->buckets[i], 0 );
+}
+
+static void sout_stats_Max( atomic_uintmax_t *p_max, uintmax_t i_value )
+{
+    uintmax_t i_max = atomic_load_explicit( p_max, memory_order_relaxed );
+
+    while( i_value > i_max
+        && !atomic_compare_exchange_weak_explicit( p_max, &i_max, i_value,
+                                                   memory_order_relaxed,
+                                                   memory_order_relaxed ) );
+}
+
+static void sout_stats_Add( struct sout_stats_counter *p_counter,
+                            vlc_tick_t i_duration )
+{
+    if( i_duration < 0 )
+        i_duration = 0;
+
+    unsigned long long i_us = US_FROM_VLC_TICK(i_duration);
+    size_t i_bucket = 0;
+
+    if( i_us >= 2 )
+        i_bucket = __MIN( sizeof (i_us) * CHAR_BIT - 1 - vlc_clzll( i_us ),
+                          SOUT_STATS_BUCKETS - 1 );
+
+    atomic_fetch_add_explicit( &p_counter->count, 1, memory_order_relaxed );
+    atomic_fetch_add_explicit( &p_counter->total, i_duration,
+                               memory_order_relaxed );
+    atomic_fetch_add_explicit( &p_counter->buckets[i_bucket], 1,
+                               memory_order_relaxed );
+    sout_stats_Max( &p_counter->max, i_duration );
+}
+
+static void sout_stats_Get( struct sout_stats_counter *p_counter,
+                            struct sout_stats_histogram *p_histogram )
+{
+    p_histogram->count = atomic_load_explicit( &p_counter->count,
+                                               memory_order_relaxed );
+    p_histogram->total = atomic_load_explicit( &p_counter->total,
+                                               memory_order_relaxed );
+    p_histogram->max = atomic_load_explicit( &p_counter->max,
+                                             memory_order_relaxed );
+    for( size_t i = 0; i < SOUT_STATS_BUCKETS; i++ )
+        p_histogram->buckets[i] = atomic_load_explicit(
+                            &p_counter->buckets[i], memory_order_relaxed );
+}
+
+static void sout_stats_DumpString( struct vlc_memstream *p_ms,
+                                   const char *psz )
+{
+    vlc_memstream_putc( p_ms, '"' );
+    for( const unsigned char *p = (const unsigned char *)psz; *p; p++ )
+    {
+        if( *p == '"' || *p == '\\' )
+            vlc_memstream_printf( p_ms, "\\%c", *p );
+        else if( *p < 0x20 )
+            vlc_memstream_printf( p_ms, "\\u%04x", *p );
+        else
+            vlc_memstream_putc( p_ms, *p );
+    }
+    vlc_memstream_putc( p_ms, '"' );
+}
+
+static void sout_stats_Dump( struct vlc_memstream *p_ms, const char *psz_name,
+                             struct sout_stats_counter *p_counter )
+{
+    struct sout_stats_histogram histogram;
+
+    sout_stats_Get( p_counter, &histogram );
+    vlc_memstream_printf( p_ms, ",\"%s\":{\"count\":%"PRIu64
+                          ",\"total_us\":%"PRId64",\"max_us\":%"PRId64
+                          ",\"histogram\":[", psz_name, histogram.count,
+                          US_FROM_VLC_TICK(histogram.total),
+                          US_FROM_VLC_TICK(histogram.max) );
+    for( size_t i = 0; i < SOUT_STATS_BUCKETS; i++ )
+        vlc_memstream_printf( p_ms, "%s%"PRIu64, i ? "," : "",
+                              histogram.buckets[i] );
+    vlc_memstream_puts( p_ms, "]}" );
+}
+
+#define SOUT_CLOCK_POINTS 1024
+
+/* Dates at which the input of a stream output chain reached its timestamps,
+ * kept in increasing order, to measure the latency of the outputs */
+struct sout_clock
+{
+    vlc_atomic_rc_t rc;
+    vlc_mutex_t lock;
+    size_t i_first;
+    size_t i_count;
+    struct
+    {
+        vlc_tick_t i_ts;
+        vlc_tick_t i_date;
+    } points[SOUT_CLOCK_POINTS];
+};
+
+/* The statistics are only collected when they are written */
+static bool sout_stats_Enabled( vlc_object_t *p_obj )
+{
+    return var_InheritInteger( p_obj, "sout-stats-interval" ) > 0;
+}
+
+static struct sout_clock *sout_clock_New( void )
+{
+    struct sout_clock *p_clock = malloc( sizeof (*p_clock) );
+    if( unlikely(p_clock == NULL) )
+        return NULL;
+
+    vlc_atomic_rc_init( &p_clock->rc );
+    vlc_mutex_init( &p_clock->lock );
+    p_clock->i_first = 0;
+    p_clock->i_count = 0;
+    return p_clock;
+}
+
+static struct sout_clock *sout_clock_Hold( struct sout_clock *p_clock )
+{
+    if( p_clock != NULL )
+        vlc_atomic_rc_inc( &p_clock->rc );
+    return p_clock;
+}
+
+static void sout_clock_Release( struct sout_clock *p_clock )
+{
+    if( p_clock != NULL && vlc_atomic_rc_dec( &p_clock->rc ) )
+        free( p_clock );
+}
+
+static void sout_clock_Input( struct sout_clock *p_clock, vlc_tick_t i_ts,
+                              vlc_tick_t i_date )
+{
+    vlc_mutex_lock( &p_clock->lock );
+    if( p_clock->i_count > 0 )
+    {
+        size_t i_last = (p_clock->i_first + p_clock->i_count - 1)
+                      % SOUT_CLOCK_POINTS;
+
+        if( i_ts < p_clock->points[p_clock->i_first].i_ts )
+            p_clock->i_count = 0; /* gone back, start over */
+        else if( i_ts <= p_clock->points[i_last].i_ts )
+        {
+            /* already reached */
+            vlc_mutex_unlock( &p_clock->lock );
+            return;
+        }
+    }
+
+    if( p_clock->i_count == SOUT_CLOCK_POINTS )
+    {
+        p_clock->i_first = (p_clock->i_first + 1) % SOUT_CLOCK_POINTS;
+        p_clock->i_count--;
+    }
+
+    size_t i_next = (p_clock->i_first + p_clock->i_count) % SOUT_CLOCK_POINTS;
+    p_clock->points[i_next].i_ts = i_ts;
+    p_clock->points[i_next].i_date = i_date;
+    p_clock->i_count++;
+    vlc_mutex_unlock( &p_clock->lock );
+}
+
+/* Returns the time since the input reached a timestamp, if it is known */
+static vlc_tick_t sout_clock_Latency( struct sout_clock *p_clock,
+                                      vlc_tick_t i_ts, vlc_tick_t i_date )
+{
+    vlc_tick_t i_latency = VLC_TICK_INVALID;
+
+    vlc_mutex_lock( &p_clock->lock );
+    if( p_clock->i_count > 0
+     && i_ts >= p_clock->points[p_clock->i_first].i_ts )
+    {
+        /* Find the first point at or after the timestamp */
+        size_t i_low = 0, i_high = p_clock->i_count;
+
+        while( i_low < i_high )
+        {
+            size_t i_mid = (i_low + i_high) / 2;
+            size_t i = (p_clock->i_first + i_mid) % SOUT_CLOCK_POINTS;
+
+            if( p_clock->points[i].i_ts < i_ts )
+                i_low = i_mid + 1;
+            else
+                i_high = i_mid;
+        }
+        if( i_low < p_clock->i_count )
+        {
+            size_t i = (p_clock->i_first + i_low) % SOUT_CLOCK_POINTS;
+            i_latency = i_date - p_clock->points[i].i_date;
+        }
+    }
+    vlc_mutex_unlock( &p_clock->lock );
+    return i_latency;
+}
+
+struct sout_stream_private {
+    sout_stream_t stream;
+    module_t *module;
+
+    /* stream sending to this one */
+    _Atomic(struct sout_stream_private *) upstream;
+    bool stats; /* same for the whole chain */
+    struct sout_clock *clock; /* only with the statistics */
+
+    vlc_mutex_t lock;
+    struct vlc_list chains; /* chains created by this stream */
+    struct vlc_list accesses; /* access outputs created by this stream */
+
+    atomic_uintmax_t blocks_in;
+    atomic_uintmax_t bytes_in;
+    atomic_uintmax_t blocks_out;
+    atomic_uintmax_t bytes_out;
+    atomic_uintmax_t errors;
+    struct sout_stats_counter time;
+};
+
+#define sout_stream_priv(s) \
+        container_of(s, struct sout_stream_private, stream)
+
+/* Chain created by a stream, from sout_StreamChainNew() */
+struct sout_stream_chain
+{
+    sout_stream_t *first;
+    sout_stream_t *end;
+    struct vlc_list node;
+};
+
+/* Streams may also be created by the caller of sout_StreamChainNew(), as
+ * the sink of a chain: only those created here have statistics */
+static struct sout_stream_private *sout_stream_priv_get( sout_stream_t *s )
+{
+    if( s == NULL || vlc_object_typename( VLC_OBJECT(s) ) != sout_stream_type )
+        return NULL;
+    return sout_stream_priv( s );
+}
+
+struct sout_access_out_private
+{
+    sout_access_out_t access;
+    struct sout_stream_private *owner; /* stream creating it, if any */
+    struct vlc_list node; /* in the access outputs of the owner */
+    bool b_stats;
+
+    vlc_mutex_t lock;
+    struct vlc_list muxes; /* muxers writing to this access output */
+
+    atomic_uintmax_t blocks;
+    atomic_uintmax_t bytes;
+    struct sout_stats_counter time;
+    struct sout_stats_counter latency;
+};
+
+/* Some stream outputs create their own access output for their muxer */
+static struct sout_access_out_private *
+sout_access_priv_get( sout_access_out_t *p_access )
+{
+    if( vlc_object_typename( VLC_OBJECT(p_access) ) != sout_access_type )
+        return NULL;
+    return container_of( p_access, struct sout_access_out_private, access );
+}
+
+struct sout_mux_private
+{
+    sout_mux_t mux;
+    struct sout_access_out_private *owner; /* access output, if any */
+    struct vlc_list node; /* in the muxers of the owner */
+    bool b_stats;
+
+    atomic_uintmax_t blocks;
+    atomic_uintmax_t bytes;
+    atomic_uintmax_t depth;
+    atomic_uintmax_t depth_bytes;
+    atomic_uintmax_t depth_max;
+    struct sout_stats_counter time;
+};
+
+#define sout_mux_priv(m) \
+        container_of(m, struct sout_mux_private, mux)
+
+static void sout_StatsDump( sout_instance_t *p_sout )
+{
+    char *psz_stats = sout_StreamChainGetStats( p_sout->p_stream, NULL );
+    if( psz_stats == NULL )
+        return;
+
+    if( p_sout->p_stats_file != NULL )
+    {
+        fprintf( p_sout->p_stats_file, "%s\n", psz_stats );
+        fflush( p_sout->p_stats_file );
+    }
+    else
+        msg_Dbg( p_sout->p_stream, "statistics: %s", psz_stats );
+    free( psz_stats );
+}
+
+static void sout_StatsTimer( void *data )
+{
+    sout_StatsDump( data );
+}
+
+static void sout_StatsStart( sout_instance_t *p_sout, vlc_object_t *p_parent )
+{
+    const vlc_tick_t i_interval = VLC_TICK_FROM_MS(
+                    var_InheritInteger( p_parent, "sout-stats-interval" ) );
+
+    p_sout->b_stats = false;
+    p_sout->p_stats_file = NULL;
+    if( i_interval <= 0 )
+        return;
+
+    char *psz_path = var_InheritString( p_parent, "sout-stats-file" );
+    if( psz_path != NULL )
+    {
+        p_sout->p_stats_file = vlc_fopen( psz_path, "at" );
+        if( p_sout->p_stats_file == NULL )
+            msg_Err( p_parent, "cannot open statistics file %s: %s",
+                     psz_path, vlc_strerror_c(errno) );
+        free( psz_path );
+    }
+
+    if( vlc_timer_create( &p_sout->stats_timer, sout_StatsTimer, p_sout ) )
+    {
+        if( p_sout->p_stats_file != NULL )
+            fclose( p_sout->p_stats_file );
+        return;
+    }
+    p_sout->b_stats = true;
+    vlc_timer_schedule( p_sout->stats_timer, false, i_interval, i_interval );
+}
+
+static void sout_StatsStop( sout_instance_t *p_sout )
+{
+    if( !p_sout->b_stats )
+        return;
+
+    vlc_timer_destroy( p_sout->stats_timer );
+    /* last statistics, until the end of the stream */
+    sout_StatsDump( p_sout );
+    if( p_sout->p_stats_file != NULL )
+        fclose( p_sout->p_stats_file );
+}
+
 #undef sout_NewInstance
 
 /*****************************************************************************
@@ -120,6 +491,7 @@ sout_instance_t *sout_NewInstance( vlc_object_t *p_parent, const char *psz_dest
         sout_StreamControl( p_sout->p_stream,
                             SOUT_STREAM_WANTS_SUBSTREAMS,
                             &p_sout->b_wants_substreams );
+        sout_StatsStart( p_sout, p_parent );
         return p_sout;
     }
 
@@ -137,6 +509,8 @@ sout_instance_t *sout_NewInstance( vlc_object_t *p_parent, const char *psz_dest
  *****************************************************************************/
 void sout_DeleteInstance( sout_instance_t * p_sout )
 {
+    sout_StatsStop( p_sout );
+
     /* remove the stream out chain */
     sout_StreamChainDelete( p_sout->p_stream, NULL );
 
@@ -280,13 +654,25 @@ int sout_InputSendBuffer( sout_instance_t *p_sout,
 sout_access_out_t *sout_AccessOutNew( vlc_object_t *p_sout,
                                       const char *psz_access, const char *psz_name )
 {
+    struct sout_access_out_private *priv;
     sout_access_out_t *p_access;
     char              *psz_next;
 
-    p_access = vlc_custom_create( p_sout, sizeof( *p_access ), "access out" );
-    if( !p_access )
+    priv = vlc_custom_create( p_sout, sizeof( *priv ), sout_access_type );
+    if( !priv )
         return NULL;
 
+    p_access = &priv->access;
+    priv->owner = sout_stream_priv_get( (sout_stream_t *)p_sout );
+    priv->b_stats = priv->owner != NULL ? priv->owner->stats
+                                        : sout_stats_Enabled( p_sout );
+    vlc_mutex_init( &priv->lock );
+    vlc_list_init( &priv->muxes );
+    atomic_init( &priv->blocks, 0 );
+    atomic_init( &priv->bytes, 0 );
+    sout_stats_Init( &priv->time );
+    sout_stats_Init( &priv->latency );
+
     psz_next = config_ChainCreate( &p_access->psz_access, &p_access->p_cfg,
                                    psz_access );
     free( psz_next );
@@ -312,6 +698,12 @@ error:
         return( NULL );
     }
 
+    if( priv->owner != NULL )
+    {
+        vlc_mutex_lock( &priv->owner->lock );
+        vlc_list_append( &priv->node, &priv->owner->accesses );
+        vlc_mutex_unlock( &priv->owner->lock );
+    }
     return p_access;
 }
 /*****************************************************************************
@@ -319,6 +711,17 @@ error:
  *****************************************************************************/
 void sout_AccessOutDelete( sout_access_out_t *p_access )
 {
+    struct sout_access_out_private *priv = sout_access_priv_get( p_access );
+
+    assert( priv != NULL );
+    assert( vlc_list_is_empty( &priv->muxes ) );
+    if( priv->owner != NULL )
+    {
+        vlc_mutex_lock( &priv->owner->lock );
+        vlc_list_remove( &priv->node );
+        vlc_mutex_unlock( &priv->owner->lock );
+    }
+
     if( p_access->p_module )
     {
         module_unneed( p_access, p_access->p_module );
@@ -356,7 +759,57 @@ ssize_t sout_AccessOutRead( sout_access_out_t *p_access, block_t *p_buffer )
  *****************************************************************************/
 ssize_t sout_AccessOutWrite( sout_access_out_t *p_access, block_t *p_buffer )
 {
-    return p_access->pf_write( p_access, p_buffer );
+    struct sout_access_out_private *priv = sout_access_priv_get( p_access );
+
+    if( priv == NULL || !priv->b_stats )
+        return p_access->pf_write( p_access, p_buffer );
+
+    uintmax_t i_blocks = 0, i_bytes = 0;
+    vlc_tick_t i_ts = VLC_TICK_INVALID;
+
+    for( const block_t *p = p_buffer; p != NULL; p = p->p_next )
+    {
+        if( i_ts == VLC_TICK_INVALID )
+            i_ts = p->i_dts != VLC_TICK_INVALID ? p->i_dts : p->i_pts;
+        i_blocks++;
+        i_bytes += p->i_buffer;
+    }
+
+    const vlc_tick_t i_start = vlc_tick_now();
+    ssize_t i_ret = p_access->pf_write( p_access, p_buffer );
+    const vlc_tick_t i_end = vlc_tick_now();
+
+    atomic_fetch_add_explicit( &priv->blocks, i_blocks, memory_order_relaxed );
+    atomic_fetch_add_explicit( &priv->bytes, i_bytes, memory_order_relaxed );
+    sout_stats_Add( &priv->time, i_end - i_start );
+
+    if( i_ts != VLC_TICK_INVALID && priv->owner != NULL
+     && priv->owner->clock != NULL )
+    {
+        vlc_tick_t i_latency = sout_clock_Latency( priv->owner->clock, i_ts,
+                                                   i_end );
+        if( i_latency != VLC_TICK_INVALID )
+            sout_stats_Add( &priv->latency, i_latency );
+    }
+    return i_ret;
+}
+
+void sout_AccessOutGetStats( sout_access_out_t *p_access,
+                             struct sout_access_out_stats *p_stats )
+{
+    struct sout_access_out_private *priv = sout_access_priv_get( p_access );
+
+    if( priv == NULL )
+    {
+        memset( p_stats, 0, sizeof (*p_stats) );
+        return;
+    }
+
+    p_stats->blocks = atomic_load_explicit( &priv->blocks,
+                                            memory_order_relaxed );
+    p_stats->bytes = atomic_load_explicit( &priv->bytes, memory_order_relaxed );
+    sout_stats_Get( &priv->time, &p_stats->time );
+    sout_stats_Get( &priv->latency, &p_stats->latency );
 }
 
 /**
@@ -381,13 +834,26 @@ int sout_AccessOutControl (sout_access_out_t *access, int query, ...)
  *****************************************************************************/
 sout_mux_t *sout_MuxNew( sout_access_out_t *p_access, const char *psz_mux )
 {
+    struct sout_mux_private *priv;
     sout_mux_t *p_mux;
     char       *psz_next;
 
-    p_mux = vlc_custom_create( p_access, sizeof( *p_mux ), "mux" );
-    if( p_mux == NULL )
+    priv = vlc_custom_create( p_access, sizeof( *priv ), "mux" );
+    if( priv == NULL )
         return NULL;
 
+    p_mux = &priv->mux;
+    priv->owner = sout_access_priv_get( p_access );
+    priv->b_stats = priv->owner != NULL
+                  ? priv->owner->b_stats
+                  : sout_stats_Enabled( VLC_OBJECT(p_access) );
+    atomic_init( &priv->blocks, 0 );
+    atomic_init( &priv->bytes, 0 );
+    atomic_init( &priv->depth, 0 );
+    atomic_init( &priv->depth_bytes, 0 );
+    atomic_init( &priv->depth_max, 0 );
+    sout_stats_Init( &priv->time );
+
     psz_next = config_ChainCreate( &p_mux->psz_mux, &p_mux->p_cfg, psz_mux );
     free( psz_next );
 
@@ -436,6 +902,12 @@ sout_mux_t *sout_MuxNew( sout_access_out_t *p_access, const char *psz_mux )
         }
     }
 
+    if( priv->owner != NULL )
+    {
+        vlc_mutex_lock( &priv->owner->lock );
+        vlc_list_append( &priv->node, &priv->owner->muxes );
+        vlc_mutex_unlock( &priv->owner->lock );
+    }
     return p_mux;
 }
 
@@ -444,6 +916,15 @@ sout_mux_t *sout_MuxNew( sout_access_out_t *p_access, const char *psz_mux )
  *****************************************************************************/
 void sout_MuxDelete( sout_mux_t *p_mux )
 {
+    struct sout_mux_private *priv = sout_mux_priv( p_mux );
+
+    if( priv->owner != NULL )
+    {
+        vlc_mutex_lock( &priv->owner->lock );
+        vlc_list_remove( &priv->node );
+        vlc_mutex_unlock( &priv->owner->lock );
+    }
+
     if( p_mux->p_module )
     {
         module_unneed( p_mux, p_mux->p_module );
@@ -535,10 +1016,38 @@ void sout_MuxDeleteStream( sout_mux_t *p_mux, sout_input_t *p_input )
 /*****************************************************************************
  * sout_MuxSendBuffer:
  *****************************************************************************/
+static void sout_MuxUpdateDepth( sout_mux_t *p_mux )
+{
+    struct sout_mux_private *priv = sout_mux_priv( p_mux );
+    size_t i_depth = 0, i_bytes = 0;
+
+    for( int i = 0; i < p_mux->i_nb_inputs; i++ )
+    {
+        vlc_fifo_t *p_fifo = p_mux->pp_inputs[i]->p_fifo;
+
+        vlc_fifo_Lock( p_fifo );
+        i_depth += vlc_fifo_GetCount( p_fifo );
+        i_bytes += vlc_fifo_GetBytes( p_fifo );
+        vlc_fifo_Unlock( p_fifo );
+    }
+
+    atomic_store_explicit( &priv->depth, i_depth, memory_order_relaxed );
+    atomic_store_explicit( &priv->depth_bytes, i_bytes, memory_order_relaxed );
+    sout_stats_Max( &priv->depth_max, i_depth );
+}
+
 int sout_MuxSendBuffer( sout_mux_t *p_mux, sout_input_t *p_input,
                          block_t *p_buffer )
 {
+    struct sout_mux_private *priv = sout_mux_priv( p_mux );
     vlc_tick_t i_dts = p_buffer->i_dts;
+
+    if( priv->b_stats )
+    {
+        atomic_fetch_add_explicit( &priv->blocks, 1, memory_order_relaxed );
+        atomic_fetch_add_explicit( &priv->bytes, p_buffer->i_buffer,
+                                   memory_order_relaxed );
+    }
     block_FifoPut( p_input->p_fifo, p_buffer );
 
     if( i_dts == VLC_TICK_INVALID )
@@ -553,10 +1062,38 @@ int sout_MuxSendBuffer( sout_mux_t *p_mux, sout_input_t *p_input,
 
         /* Wait until we have enough data before muxing */
         if( llabs( i_dts - p_mux->i_add_stream_start ) < i_caching )
+        {
+            if( priv->b_stats )
+                sout_MuxUpdateDepth( p_mux );
             return VLC_SUCCESS;
+        }
         p_mux->b_waiting_stream = false;
     }
-    return p_mux->pf_mux( p_mux );
+
+    if( !priv->b_stats )
+        return p_mux->pf_mux( p_mux );
+
+    const vlc_tick_t i_start = vlc_tick_now();
+    int i_ret = p_mux->pf_mux( p_mux );
+
+    sout_stats_Add( &priv->time, vlc_tick_now() - i_start );
+    sout_MuxUpdateDepth( p_mux );
+    return i_ret;
+}
+
+void sout_MuxGetStats( sout_mux_t *p_mux, struct sout_mux_stats *p_stats )
+{
+    struct sout_mux_private *priv = sout_mux_priv( p_mux );
+
+    p_stats->blocks = atomic_load_explicit( &priv->blocks,
+                                            memory_order_relaxed );
+    p_stats->bytes = atomic_load_explicit( &priv->bytes, memory_order_relaxed );
+    p_stats->depth = atomic_load_explicit( &priv->depth, memory_order_relaxed );
+    p_stats->depth_bytes = atomic_load_explicit( &priv->depth_bytes,
+                                                 memory_order_relaxed );
+    p_stats->depth_max = atomic_load_explicit( &priv->depth_max,
+                                               memory_order_relaxed );
+    sout_stats_Get( &priv->time, &p_stats->time );
 }
 
 void sout_MuxFlush( sout_mux_t *p_mux, sout_input_t *p_input )
@@ -741,14 +1278,6 @@ static void mrl_Clean( mrl_t *p_mrl )
  ****************************************************************************
  ****************************************************************************/
 
-struct sout_stream_private {
-    sout_stream_t stream;
-    module_t *module;
-};
-
-#define sout_stream_priv(s) \
-        container_of(s, struct sout_stream_private, stream)
-
 void *sout_StreamIdAdd(sout_stream_t *s, const es_format_t *fmt)
 {
     return s->ops->add(s, fmt);
@@ -759,9 +1288,78 @@ void sout_StreamIdDel(sout_stream_t *s, void *id)
     s->ops->del(s, id);
 }
 
+/* Stream output send call running on the current thread */
+struct sout_stream_call
+{
+    struct sout_stream_private *stream;
+    vlc_tick_t callees; /* time spent in the next streams */
+};
+
+static thread_local struct sout_stream_call *sout_stream_call;
+
 int sout_StreamIdSend(sout_stream_t *s, void *id, block_t *b)
 {
-    return s->ops->send(s, id, b);
+    struct sout_stream_private *priv = sout_stream_priv_get(s);
+    if (priv != NULL && !priv->stats)
+        return s->ops->send(s, id, b);
+
+    /* Sinks created by the caller of the chain count for their sender */
+    struct sout_stream_call *caller = sout_stream_call;
+    if (priv == NULL && caller == NULL)
+        return s->ops->send(s, id, b);
+
+    uintmax_t blocks = 0, bytes = 0;
+    vlc_tick_t ts = b->i_dts != VLC_TICK_INVALID ? b->i_dts : b->i_pts;
+
+    for (const block_t *p = b; p != NULL; p = p->p_next)
+    {
+        blocks++;
+        bytes += p->i_buffer;
+    }
+
+    /* Streams sending from their own threads have no caller */
+    struct sout_stream_private *from = NULL;
+    if (caller != NULL)
+        from = caller->stream;
+    else if (priv != NULL)
+        from = atomic_load_explicit(&priv->upstream, memory_order_relaxed);
+    if (from != NULL)
+    {
+        atomic_fetch_add_explicit(&from->blocks_out, blocks,
+                                  memory_order_relaxed);
+        atomic_fetch_add_explicit(&from->bytes_out, bytes,
+                                  memory_order_relaxed);
+    }
+    if (priv != NULL)
+    {
+        atomic_fetch_add_explicit(&priv->blocks_in, blocks,
+                                  memory_order_relaxed);
+        atomic_fetch_add_explicit(&priv->bytes_in, bytes,
+                                  memory_order_relaxed);
+    }
+
+    struct sout_stream_call call = { priv, 0 };
+    const vlc_tick_t start = vlc_tick_now();
+
+    /* Blocks coming from outside of the streams enter the whole chain */
+    if (caller == NULL && from == NULL && priv != NULL && priv->clock != NULL
+     && ts != VLC_TICK_INVALID)
+        sout_clock_Input(priv->clock, ts, start);
+
+    sout_stream_call = &call;
+    int ret = s->ops->send(s, id, b);
+    sout_stream_call = caller;
+
+    const vlc_tick_t time = vlc_tick_now() - start;
+    if (caller != NULL)
+        caller->callees += time;
+    if (priv != NULL)
+    {
+        sout_stats_Add(&priv->time, time - call.callees);
+        if (ret != VLC_SUCCESS)
+            atomic_fetch_add_explicit(&priv->errors, 1, memory_order_relaxed);
+    }
+    return ret;
 }
 
 void sout_StreamFlush(sout_stream_t *s, void *id)
@@ -777,6 +1375,151 @@ int sout_StreamControlVa(sout_stream_t *s, int i_query, va_list args)
     return s->ops->control(s, i_query, args);
 }
 
+int sout_StreamGetStats(sout_stream_t *s, struct sout_stream_stats *stats)
+{
+    struct sout_stream_private *priv = sout_stream_priv_get(s);
+
+    if (priv == NULL)
+        return VLC_EGENERIC;
+
+    stats->blocks_in = atomic_load_explicit(&priv->blocks_in,
+                                            memory_order_relaxed);
+    stats->bytes_in = atomic_load_explicit(&priv->bytes_in,
+                                           memory_order_relaxed);
+    stats->blocks_out = atomic_load_explicit(&priv->blocks_out,
+                                             memory_order_relaxed);
+    stats->bytes_out = atomic_load_explicit(&priv->bytes_out,
+                                            memory_order_relaxed);
+    stats->errors = atomic_load_explicit(&priv->errors, memory_order_relaxed);
+    sout_stats_Get(&priv->time, &stats->time);
+    return VLC_SUCCESS;
+}
+
+static void sout_StreamChainDump(struct vlc_memstream *ms,
+                                 sout_stream_t *first, sout_stream_t *end);
+
+static void sout_AccessOutDump(struct vlc_memstream *ms,
+                               struct sout_access_out_private *priv)
+{
+    sout_access_out_t *access = &priv->access;
+
+    vlc_memstream_puts(ms, "{\"access\":");
+    sout_stats_DumpString(ms, access->psz_access);
+    vlc_memstream_printf(ms, ",\"blocks\":%ju,\"bytes\":%ju",
+        atomic_load_explicit(&priv->blocks, memory_order_relaxed),
+        atomic_load_explicit(&priv->bytes, memory_order_relaxed));
+    sout_stats_Dump(ms, "time", &priv->time);
+    sout_stats_Dump(ms, "latency", &priv->latency);
+
+    vlc_memstream_puts(ms, ",\"muxes\":[");
+    vlc_mutex_lock(&priv->lock);
+    struct sout_mux_private *mux;
+    bool first = true;
+    vlc_list_foreach(mux, &priv->muxes, node)
+    {
+        vlc_memstream_puts(ms, first ? "{\"mux\":" : ",{\"mux\":");
+        sout_stats_DumpString(ms, mux->mux.psz_mux);
+        vlc_memstream_printf(ms, ",\"blocks\":%ju,\"bytes\":%ju"
+            ",\"depth\":%ju,\"depth_bytes\":%ju,\"depth_max\":%ju",
+            atomic_load_explicit(&mux->blocks, memory_order_relaxed),
+            atomic_load_explicit(&mux->bytes, memory_order_relaxed),
+            atomic_load_explicit(&mux->depth, memory_order_relaxed),
+            atomic_load_explicit(&mux->depth_bytes, memory_order_relaxed),
+            atomic_load_explicit(&mux->depth_max, memory_order_relaxed));
+        sout_stats_Dump(ms, "time", &mux->time);
+        vlc_memstream_putc(ms, '}');
+        first = false;
+    }
+    vlc_mutex_unlock(&priv->lock);
+    vlc_memstream_puts(ms, "]}");
+}
+
+static void sout_StreamDump(struct vlc_memstream *ms,
+                            struct sout_stream_private *priv)
+{
+    vlc_memstream_puts(ms, "{\"name\":");
+    sout_stats_DumpString(ms, priv->stream.psz_name);
+    vlc_memstream_printf(ms, ",\"blocks_in\":%ju,\"bytes_in\":%ju"
+        ",\"blocks_out\":%ju,\"bytes_out\":%ju,\"errors\":%ju",
+        atomic_load_explicit(&priv->blocks_in, memory_order_relaxed),
+        atomic_load_explicit(&priv->bytes_in, memory_order_relaxed),
+        atomic_load_explicit(&priv->blocks_out, memory_order_relaxed),
+        atomic_load_explicit(&priv->bytes_out, memory_order_relaxed),
+        atomic_load_explicit(&priv->errors, memory_order_relaxed));
+    sout_stats_Dump(ms, "time", &priv->time);
+
+    vlc_mutex_lock(&priv->lock);
+    if (!vlc_list_is_empty(&priv->chains))
+    {
+        struct sout_stream_chain *chain;
+        bool first = true;
+
+        vlc_memstream_puts(ms, ",\"chains\":[");
+        vlc_list_foreach(chain, &priv->chains, node)
+        {
+            if (!first)
+                vlc_memstream_putc(ms, ',');
+            sout_StreamChainDump(ms, chain->first, chain->end);
+            first = false;
+        }
+        vlc_memstream_putc(ms, ']');
+    }
+    if (!vlc_list_is_empty(&priv->accesses))
+    {
+        struct sout_access_out_private *access;
+        bool first = true;
+
+        vlc_memstream_puts(ms, ",\"outputs\":[");
+        vlc_list_foreach(access, &priv->accesses, node)
+        {
+            if (!first)
+                vlc_memstream_putc(ms, ',');
+            sout_AccessOutDump(ms, access);
+            first = false;
+        }
+        vlc_memstream_putc(ms, ']');
+    }
+    vlc_mutex_unlock(&priv->lock);
+    vlc_memstream_putc(ms, '}');
+}
+
+static void sout_StreamChainDump(struct vlc_memstream *ms,
+                                 sout_stream_t *first, sout_stream_t *end)
+{
+    vlc_memstream_putc(ms, '[');
+    for (sout_stream_t *s = first; s != end; s = s->p_next)
+    {
+        struct sout_stream_private *priv = sout_stream_priv_get(s);
+
+        if (priv == NULL)
+            break;
+        if (s != first)
+            vlc_memstream_putc(ms, ',');
+        sout_StreamDump(ms, priv);
+    }
+    vlc_memstream_putc(ms, ']');
+}
+
+/**
+ * Gets the statistics of a chain as a JSON object
+ *
+ * The streams of the chain are listed in order, each with the chains and the
+ * access outputs it created.
+ */
+char *sout_StreamChainGetStats(sout_stream_t *first, sout_stream_t *end)
+{
+    struct vlc_memstream ms;
+
+    if (vlc_memstream_open(&ms))
+        return NULL;
+
+    vlc_memstream_printf(&ms, "{\"date_us\":%"PRId64",\"streams\":",
+                         US_FROM_VLC_TICK(vlc_tick_now()));
+    sout_StreamChainDump(&ms, first, end);
+    vlc_memstream_putc(&ms, '}');
+    return vlc_memstream_close(&ms) ? NULL : ms.ptr;
+}
+
 /* Destroy a "stream_out" module */
 static void sout_StreamDelete( sout_stream_t *p_stream )
 {
@@ -787,6 +1530,20 @@ static void sout_StreamDelete( sout_stream_t *p_stream )
     if (priv->module != NULL)
         module_unneed(p_stream, priv->module);
 
+    assert(vlc_list_is_empty(&priv->chains));
+    assert(vlc_list_is_empty(&priv->accesses));
+
+    struct sout_stream_private *next =
+        sout_stream_priv_get(p_stream->p_next);
+    if (next != NULL)
+    {
+        struct sout_stream_private *self = priv;
+        atomic_compare_exchange_strong_explicit(&next->upstream, &self, NULL,
+                                                memory_order_relaxed,
+                                                memory_order_relaxed);
+    }
+    sout_clock_Release(priv->clock);
+
     FREENULL( p_stream->psz_name );
 
     config_ChainDestroy( p_stream->p_cfg );
@@ -804,6 +1561,26 @@ static void sout_StreamDelete( sout_stream_t *p_stream )
  */
 void sout_StreamChainDelete(sout_stream_t *p_first, sout_stream_t *end)
 {
+    struct sout_stream_private *owner = NULL;
+
+    if (p_first != end && sout_stream_priv_get(p_first) != NULL)
+        owner = sout_stream_priv_get(
+                    (sout_stream_t *)vlc_object_parent(p_first));
+    if (owner != NULL)
+    {
+        struct sout_stream_chain *chain;
+
+        vlc_mutex_lock(&owner->lock);
+        vlc_list_foreach(chain, &owner->chains, node)
+            if (chain->first == p_first)
+            {
+                vlc_list_remove(&chain->node);
+                free(chain);
+                break;
+            }
+        vlc_mutex_unlock(&owner->lock);
+    }
+
     while (p_first != end)
     {
         sout_stream_t *p_next = p_first->p_next;
@@ -818,7 +1595,8 @@ void sout_StreamChainDelete(sout_stream_t *p_first, sout_stream_t *end)
  * XXX name and p_cfg are used (-> do NOT free them)
  */
 static sout_stream_t *sout_StreamNew( vlc_object_t *parent, char *psz_name,
-                               config_chain_t *p_cfg, sout_stream_t *p_next)
+                               config_chain_t *p_cfg, sout_stream_t *p_next,
+                               bool stats, struct sout_clock *clock)
 {
     const char *cap = (p_next != NULL) ? "sout filter" : "sout output";
     struct sout_stream_private *priv;
@@ -826,10 +1604,23 @@ static sout_stream_t *sout_StreamNew( vlc_object_t *parent, char *psz_name,
 
     assert(psz_name);
 
-    priv = vlc_custom_create(parent, sizeof (*priv), "stream out");
+    priv = vlc_custom_create(parent, sizeof (*priv), sout_stream_type);
     if (unlikely(priv == NULL))
         return NULL;
 
+    atomic_init(&priv->upstream, NULL);
+    priv->stats = stats;
+    priv->clock = sout_clock_Hold(clock);
+    vlc_mutex_init(&priv->lock);
+    vlc_list_init(&priv->chains);
+    vlc_list_init(&priv->accesses);
+    atomic_init(&priv->blocks_in, 0);
+    atomic_init(&priv->bytes_in, 0);
+    atomic_init(&priv->blocks_out, 0);
+    atomic_init(&priv->bytes_out, 0);
+    atomic_init(&priv->errors, 0);
+    sout_stats_Init(&priv->time);
+
     p_stream = &priv->stream;
     p_stream->psz_name = psz_name;
     p_stream->p_cfg    = p_cfg;
@@ -851,6 +1642,14 @@ static sout_stream_t *sout_StreamNew( vlc_object_t *parent, char *psz_name,
         return NULL;
     }
 
+    struct sout_stream_private *next = sout_stream_priv_get(p_next);
+    if (next != NULL)
+    {
+        struct sout_stream_private *none = NULL;
+        atomic_compare_exchange_strong_explicit(&next->upstream, &none, priv,
+                                                memory_order_relaxed,
+                                                memory_order_relaxed);
+    }
     return p_stream;
 }
 
@@ -891,6 +1690,31 @@ sout_stream_t *sout_StreamChainNew(vlc_object_t *parent, const char *psz_chain,
         vlc_array_append_or_abort(&name, psz_name);
     }
 
+    /* Chains created by a stream, and chains in front of another one, share
+     * the statistics setting and the clock of the input of the whole chain */
+    struct sout_stream_private *owner =
+        sout_stream_priv_get((sout_stream_t *)parent);
+    struct sout_stream_private *next = sout_stream_priv_get(sink);
+    struct sout_clock *clock = NULL;
+    bool stats;
+
+    if (owner != NULL)
+    {
+        stats = owner->stats;
+        clock = sout_clock_Hold(owner->clock);
+    }
+    else if (next != NULL)
+    {
+        stats = next->stats;
+        clock = sout_clock_Hold(next->clock);
+    }
+    else
+    {
+        stats = sout_stats_Enabled(parent);
+        if (stats)
+            clock = sout_clock_New();
+    }
+
     /* Instantiate modules from back to front of chain */
     sout_stream_t *front = sink;
     size_t i = vlc_array_count(&name);
@@ -900,29 +1724,45 @@ sout_stream_t *sout_StreamChainNew(vlc_object_t *parent, const char *psz_chain,
         sout_stream_t *prev;
 
         prev = sout_StreamNew(parent, vlc_array_item_at_index(&name, i),
-                              vlc_array_item_at_index(&cfg, i), front);
+                              vlc_array_item_at_index(&cfg, i), front, stats,
+                              clock);
         if (prev == NULL)
             goto error;
 
         front = prev;
     }
 
+    sout_clock_Release(clock);
     vlc_array_clear(&name);
     vlc_array_clear(&cfg);
 
+    if (owner != NULL)
+    {
+        struct sout_stream_chain *chain = malloc(sizeof (*chain));
+
+        if (likely(chain != NULL))
+        {
+            chain->first = front;
+            chain->end = sink;
+            vlc_mutex_lock(&owner->lock);
+            vlc_list_append(&chain->node, &owner->chains);
+            vlc_mutex_unlock(&owner->lock);
+        }
+    }
     return front;
 
 error:
+    sout_clock_Release(clock);
 
     i++;    /* last module couldn't be created */
 
     /* Destroy module instances in LIFO order */
     while (front != sink)
     {
-        sout_stream_t *next = front->p_next;
+        sout_stream_t *p_next = front->p_next;
 
         sout_StreamDelete(front);
-        front = next;
+        front = p_next;
     }
 
     /* then destroy all names and config which weren't destroyed by
@@ -38,6 +38,11 @@ struct sout_instance_t
 
     vlc_mutex_t         lock;
     sout_stream_t       *p_stream;
+
+    /* periodic statistics dump */
+    bool                b_stats;
+    vlc_timer_t         stats_timer;
+    FILE                *p_stats_file;
 };
 
 sout_instance_t *sout_NewInstance( vlc_object_t *, const char * );
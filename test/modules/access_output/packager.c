@@ -0,0 +1,386 @@
+/*****************************************************************************
+ * packager.c: low latency HLS and DASH packager test
+ *****************************************************************************
+ * Copyright (C) 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include <vlc/vlc.h>
+
+#include "../../../lib/libvlc_internal.h"
+
+#include <vlc_common.h>
+#include <vlc_sout.h>
+#include <vlc_block.h>
+#include <vlc_es.h>
+#include <vlc_tick.h>
+
+#include "../../libvlc/test.h"
+#include "../mux/common.h"
+
+/* 6 seconds of a 25 frames per second video with a key frame every second,
+ * and of a 48 kHz AAC like audio, cut in 200 ms chunks */
+#define FRAMES 150
+#define FRAME_PERIOD VLC_TICK_FROM_MS(40)
+#define GOP 25
+#define AUDIO_RATE 48000
+#define AUDIO_SAMPLES 1024
+
+static unsigned port;
+
+static unsigned FreePort(void)
+{
+    struct sockaddr_in addr = { .sin_family = AF_INET };
+    socklen_t len = sizeof (addr);
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+
+    assert(fd != -1);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    assert(bind(fd, (struct sockaddr *)&addr, sizeof (addr)) == 0);
+    assert(getsockname(fd, (struct sockaddr *)&addr, &len) == 0);
+    close(fd);
+    return ntohs(addr.sin_port);
+}
+
+static void Send(int fd, const char *url, unsigned version)
+{
+    char req[256];
+    int len = snprintf(req, sizeof (req), "GET /live/%s HTTP/1.%u\r\n\r\n",
+                       url, version);
+    assert(send(fd, req, len, 0) == len);
+}
+
+/* Sends a request, the answer is read with Receive(), or ReceiveChunked()
+ * for HTTP/1.1 deferred answers */
+static int Request(const char *url, unsigned version)
+{
+    struct sockaddr_in addr = { .sin_family = AF_INET };
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+
+    assert(fd != -1);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    assert(connect(fd, (struct sockaddr *)&addr, sizeof (addr)) == 0);
+    Send(fd, url, version);
+    return fd;
+}
+
+/* Returns the status, and the body until the end of the connection */
+static int Receive(int fd, char **body, size_t *size, int timeout)
+{
+    struct pollfd ufd = { .fd = fd, .events = POLLIN };
+    char *buf = NULL;
+    size_t len = 0;
+    ssize_t val;
+
+    do
+    {
+        if (poll(&ufd, 1, timeout) != 1)
+        {
+            /* Still waiting */
+            free(buf);
+            return -1;
+        }
+        buf = realloc(buf, len + 4096 + 1);
+        assert(buf != NULL);
+        val = recv(fd, buf + len, 4096, 0);
+        assert(val >= 0);
+        len += val;
+    }
+    while (val > 0);
+    close(fd);
+    buf[len] = '\0';
+
+    int status;
+    assert(sscanf(buf, "HTTP/1.%*d %d", &status) == 1);
+    char *data = strstr(buf, "\r\n\r\n");
+    assert(data != NULL);
+    data += 4;
+    *size = len - (data - buf);
+    *body = malloc(*size + 1);
+    assert(*body != NULL);
+    memcpy(*body, data, *size + 1);
+    free(buf);
+    return status;
+}
+
+/* Reads more of an answer from a connection which is kept alive */
+static void Fill(int fd, char **buf, size_t *len)
+{
+    struct pollfd ufd = { .fd = fd, .events = POLLIN };
+
+    assert(poll(&ufd, 1, 5000) == 1);
+    *buf = realloc(*buf, *len + 4096 + 1);
+    assert(*buf != NULL);
+    ssize_t val = recv(fd, *buf + *len, 4096, 0);
+    assert(val > 0);
+    *len += val;
+    (*buf)[*len] = '\0';
+}
+
+/* Returns the status, and the body of a chunked answer, without closing */
+static int ReceiveChunked(int fd, char **body, size_t *size)
+{
+    char *buf = NULL;
+    size_t len = 0, pos;
+    const char *eol;
+
+    while (buf == NULL || (eol = strstr(buf, "\r\n\r\n")) == NULL)
+        Fill(fd, &buf, &len);
+    pos = eol + 4 - buf;
+
+    int status;
+    assert(sscanf(buf, "HTTP/1.%*d %d", &status) == 1);
+    assert(strstr(buf, "Transfer-Encoding: chunked\r\n") != NULL);
+    assert(strstr(buf, "Connection: close") == NULL);
+
+    *body = malloc(1);
+    *size = 0;
+    assert(*body != NULL);
+    for (;;)
+    {
+        while ((eol = strstr(buf + pos, "\r\n")) == NULL)
+            Fill(fd, &buf, &len);
+
+        const size_t chunk = strtoul(buf + pos, NULL, 16);
+        const size_t start = eol + 2 - buf;
+
+        while (len < start + chunk + 2)
+            Fill(fd, &buf, &len);
+        assert(!memcmp(buf + start + chunk, "\r\n", 2));
+        pos = start + chunk + 2;
+        if (chunk == 0)
+            break;
+
+        *body = realloc(*body, *size + chunk + 1);
+        assert(*body != NULL);
+        memcpy(*body + *size, buf + start, chunk);
+        *size += chunk;
+    }
+    assert(pos == len);
+    (*body)[*size] = '\0';
+    free(buf);
+    return status;
+}
+
+static int Get(const char *url, char **body, size_t *size)
+{
+    return Receive(Request(url, 0), body, size, 5000);
+}
+
+/* Tells whether a playlist came, the headers of a blocked one come first */
+static bool Answered(int fd)
+{
+    char buf[4096];
+    ssize_t len = recv(fd, buf, sizeof (buf) - 1, MSG_PEEK | MSG_DONTWAIT);
+
+    if (len <= 0)
+        return false;
+    buf[len] = '\0';
+    return strstr(buf, "#EXTM3U") != NULL;
+}
+
+/* Counts the moof boxes of a part or a segment */
+static unsigned Moofs(const char *data, size_t size)
+{
+    const uint8_t *p = (const uint8_t *)data;
+    unsigned count = 0;
+
+    while (size >= 8)
+    {
+        const uint32_t box = ((uint32_t)p[0] << 24) | (p[1] << 16)
+                           | (p[2] << 8) | p[3];
+
+        assert(box >= 8 && box <= size);
+        if (!memcmp(p + 4, "moof", 4))
+            count++;
+        p += box;
+        size -= box;
+    }
+    return count;
+}
+
+int main(void)
+{
+    test_init();
+
+    libvlc_instance_t *vlc = libvlc_new(test_defaults_nargs,
+                                        test_defaults_args);
+    assert(vlc != NULL);
+
+    vlc_object_t *obj = VLC_OBJECT(vlc->p_libvlc_int);
+    char path[32];
+
+    /* The port may be taken again before the server binds it */
+    sout_access_out_t *access = NULL;
+    for (unsigned i = 0; i < 10 && access == NULL; i++)
+    {
+        port = FreePort();
+        snprintf(path, sizeof (path), "127.0.0.1:%u/live", port);
+        access = sout_AccessOutNew(obj, "packager{seglen=1}", path);
+    }
+    assert(access != NULL);
+    sout_mux_t *mux = sout_MuxNew(access, "mp4frag{chunk-duration=200}");
+    assert(mux != NULL);
+
+    es_format_t fmt;
+    es_format_Init(&fmt, VIDEO_ES, VLC_CODEC_MP4V);
+    fmt.i_id = 1;
+    fmt.video.i_width = fmt.video.i_visible_width = 640;
+    fmt.video.i_height = fmt.video.i_visible_height = 480;
+    fmt.video.i_frame_rate = 25;
+    fmt.video.i_frame_rate_base = 1;
+    sout_input_t *video = sout_MuxAddStream(mux, &fmt);
+    assert(video != NULL);
+    es_format_Init(&fmt, AUDIO_ES, VLC_CODEC_MP4A);
+    fmt.i_id = 2;
+    fmt.audio.i_rate = AUDIO_RATE;
+    fmt.audio.i_channels = 2;
+    sout_input_t *audio = sout_MuxAddStream(mux, &fmt);
+    assert(audio != NULL);
+
+    char *body;
+    size_t size;
+    assert(Get("index.m3u8", &body, &size) == 404);
+    free(body);
+
+    const vlc_tick_t audio_period = vlc_tick_from_samples(AUDIO_SAMPLES,
+                                                          AUDIO_RATE);
+    vlc_tick_t audio_dts = VLC_TICK_0;
+    int blocking = -1, hinted = -1;
+    unsigned blocked_msn = 0, blocked_for = 0;
+
+    for (unsigned i = 0; i < FRAMES; i++)
+    {
+        const vlc_tick_t dts = VLC_TICK_0 + i * FRAME_PERIOD;
+        block_t *frame = Frame(i % GOP ? 2000 + RandomByte() * 16 : 20000,
+                               dts, FRAME_PERIOD);
+
+        if (i % GOP == 0)
+            frame->i_flags |= BLOCK_FLAG_TYPE_I;
+        sout_MuxSendBuffer(mux, video, frame);
+        while (audio_dts < dts + FRAME_PERIOD)
+        {
+            block_t *block = Frame(300 + RandomByte(), audio_dts,
+                                   audio_period);
+
+            block->i_nb_samples = AUDIO_SAMPLES;
+            sout_MuxSendBuffer(mux, audio, block);
+            audio_dts += audio_period;
+        }
+
+        if (i == FRAMES / 2)
+        {
+            /* Ask for the part of the preload hint, and for the first part
+             * of the next segment, which are not there yet */
+            static const char tag[] = "#EXT-X-PRELOAD-HINT:TYPE=PART,URI=\"";
+            assert(Get("index.m3u8", &body, &size) == 200);
+            const char *hint = strstr(body, tag);
+            assert(hint != NULL);
+            char url[64];
+            assert(sscanf(hint + strlen(tag), "%63[^\"]", url) == 1);
+            test_log("preload hint %s\n", url);
+            hinted = Request(url, 1);
+
+            unsigned msn;
+            const char *p = strstr(body, "#EXT-X-MEDIA-SEQUENCE:");
+            assert(p != NULL && sscanf(p, "#EXT-X-MEDIA-SEQUENCE:%u", &msn) == 1);
+            while ((p = strstr(p, "#EXTINF:")) != NULL)
+            {
+                msn++;
+                p++;
+            }
+            free(body);
+
+            blocked_msn = msn;
+            snprintf(url, sizeof (url), "index.m3u8?_HLS_msn=%u&_HLS_part=0",
+                     blocked_msn + 1);
+            blocking = Request(url, 1);
+        }
+        else if (blocking != -1 && !Answered(blocking))
+            blocked_for++; /* until the muxer catches up */
+        /* Pace the stream so that the server can answer meanwhile */
+        vlc_tick_sleep(VLC_TICK_FROM_MS(2));
+    }
+
+    /* The hinted part comes as it is muxed, and the connection stays */
+    assert(ReceiveChunked(hinted, &body, &size) == 200);
+    assert(Moofs(body, size) == 1);
+    free(body);
+    Send(hinted, "init.mp4", 0);
+    assert(Receive(hinted, &body, &size, 5000) == 200);
+    assert(size > 8 && !memcmp(body + 4, "ftyp", 4));
+    free(body);
+
+    assert(ReceiveChunked(blocking, &body, &size) == 200);
+    close(blocking);
+    test_log("blocking reload waited for %u frames\n", blocked_for);
+    assert(blocked_for > 0);
+    char line[32];
+    snprintf(line, sizeof (line), "\nseg-%u.m4s\n", blocked_msn);
+    assert(strstr(body, line) != NULL);
+    free(body);
+
+    /* The segments are made of their parts */
+    assert(Get("index.m3u8", &body, &size) == 200);
+    test_log("%s", body);
+    unsigned segments = 0, parts = 0;
+    for (const char *p = body; (p = strstr(p, "\nseg-")) != NULL; p++)
+    {
+        char url[32], *seg;
+        size_t seg_size;
+
+        assert(sscanf(p + 1, "%31[^\n]", url) == 1);
+        assert(Get(url, &seg, &seg_size) == 200);
+        parts += Moofs(seg, seg_size);
+        free(seg);
+        segments++;
+    }
+    assert(segments >= 2);
+    assert(parts >= segments * 4);
+    assert(strstr(body, "INDEPENDENT=YES") != NULL);
+    free(body);
+
+    assert(Get("init.mp4", &body, &size) == 200);
+    assert(size > 8 && !memcmp(body + 4, "ftyp", 4));
+    free(body);
+
+    assert(Get("index.mpd", &body, &size) == 200);
+    assert(strstr(body, "type=\"dynamic\"") != NULL);
+    assert(strstr(body, "<S t=") != NULL);
+    free(body);
+
+    sout_MuxDeleteStream(mux, audio);
+    sout_MuxDeleteStream(mux, video);
+    sout_MuxDelete(mux);
+    sout_AccessOutDelete(access);
+
+    libvlc_release(vlc);
+    return 0;
+}
@@ -0,0 +1,145 @@
+/*****************************************************************************
+ * udp.c: UDP access output test
+ *****************************************************************************
+ * Copyright (C) 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <errno.h>
+#include <stdio.h>
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include <vlc/vlc.h>
+
+#include "../../../lib/libvlc_internal.h"
+
+#include <vlc_common.h>
+#include <vlc_sout.h>
+#include <vlc_block.h>
+#include <vlc_tick.h>
+
+#include "../../libvlc/test.h"
+
+#define TS_PACKETS 7
+#define SIZE (TS_PACKETS * 188)
+#define COUNT 1000
+#define CLOCK_PERIOD 40
+
+static int Receiver(char *path, size_t size)
+{
+    struct sockaddr_in addr = { .sin_family = AF_INET };
+    socklen_t len = sizeof (addr);
+    int buf = 4 << 20;
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+
+    assert(fd != -1);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    assert(bind(fd, (struct sockaddr *)&addr, sizeof (addr)) == 0);
+    assert(getsockname(fd, (struct sockaddr *)&addr, &len) == 0);
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &buf, sizeof (buf));
+    snprintf(path, size, "127.0.0.1:%u", ntohs(addr.sin_port));
+    return fd;
+}
+
+static void Test(vlc_object_t *parent, const char *access)
+{
+    char path[32];
+    int fd = Receiver(path, sizeof (path));
+
+    test_log("%s\n", access);
+
+    sout_access_out_t *out = sout_AccessOutNew(parent, access, path);
+    assert(out != NULL);
+
+    /* The last datagram is kept until more data comes */
+    const vlc_tick_t start = vlc_tick_now();
+    for (unsigned i = 0; i <= COUNT; i++)
+    {
+        block_t *block = block_Alloc(SIZE);
+        assert(block != NULL);
+
+        memset(block->p_buffer, 0x47, SIZE);
+        memcpy(block->p_buffer + 4, &i, sizeof (i));
+        block->i_dts = start + VLC_TICK_FROM_US(100) * i;
+        if (i % CLOCK_PERIOD == 0)
+            block->i_flags |= BLOCK_FLAG_CLOCK;
+        assert(sout_AccessOutWrite(out, block) == SIZE);
+    }
+
+    unsigned received = 0;
+    uint8_t buf[2 * SIZE];
+    struct pollfd ufd = { .fd = fd, .events = POLLIN };
+
+    while (received < COUNT && poll(&ufd, 1, 2000) == 1)
+    {
+        unsigned seq;
+
+        assert(recv(fd, buf, sizeof (buf), 0) == SIZE);
+        memcpy(&seq, buf + 4, sizeof (seq));
+        assert(seq == received);
+        received++;
+    }
+    assert(received == COUNT);
+
+    struct sout_datagram_stats stats;
+    do
+    {
+        assert(sout_AccessOutControl(out, ACCESS_OUT_GET_DATAGRAM_STATS,
+                                     &stats) == VLC_SUCCESS);
+        if (stats.datagrams < COUNT)
+            vlc_tick_sleep(VLC_TICK_FROM_MS(1));
+    }
+    while (stats.datagrams < COUNT);
+
+    test_log("%"PRIu64" datagrams in %"PRIu64" calls, %"PRIu64" late, "
+             "%"PRIu64" dropped\n", stats.datagrams, stats.syscalls,
+             stats.late, stats.dropped);
+    assert(stats.datagrams == COUNT);
+    assert(stats.dropped == 0);
+    assert(stats.syscalls > 0 && stats.syscalls <= stats.datagrams);
+
+    sout_AccessOutDelete(out);
+    close(fd);
+}
+
+int main(void)
+{
+    test_init();
+
+    libvlc_instance_t *vlc = libvlc_new(test_defaults_nargs,
+                                        test_defaults_args);
+    assert(vlc != NULL);
+
+    vlc_object_t *obj = VLC_OBJECT(vlc->p_libvlc_int);
+    Test(obj, "udp{caching=20}");
+    Test(obj, "udp{caching=20,group=8}");
+    Test(obj, "udp{caching=20,batch=16}");
+    Test(obj, "udp{caching=20,batch=64,gso}");
+    Test(obj, "udp{caching=40,batch=32,txtime}");
+    Test(obj, "udp{caching=40,batch=64,gso,txtime}");
+
+    libvlc_release(vlc);
+    return 0;
+}
@@ -0,0 +1,331 @@
+/*****************************************************************************
+ * equalizer.c: equalizer filter bank test and filter chain benchmark
+ *****************************************************************************
+ * Copyright (C) 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <math.h>
+
+#include <vlc/vlc.h>
+
+#include "../../../lib/libvlc_internal.h"
+
+#include <vlc_common.h>
+#include <vlc_modules.h>
+#include <vlc_aout.h>
+#include <vlc_filter.h>
+#include <vlc_block.h>
+#include <vlc_tick.h>
+
+#include "../../../modules/audio_filter/equalizer_iir.h"
+
+#include "../../libvlc/test.h"
+#include "../random.h"
+
+#define RATE 48000
+
+static const unsigned channel_counts[] = { 1, 2, 6, 8 };
+
+/* VLC bands, but for the last one, above the Nyquist frequency */
+static const float frequencies[] = {
+    60, 170, 310, 600, 1000, 3000, 6000, 12000, 14000, 30000,
+};
+
+static const float gains_db[] = { 8, 6, -3, -6, 0, 4, 10, -12, 3, 5 };
+
+/* Same coefficients as the equalizer, with one octave wide bands */
+static eqz_coeffs_t *Coeffs(unsigned rate)
+{
+    eqz_coeffs_t *c = aligned_alloc(alignof (eqz_coeffs_t), sizeof (*c));
+    assert(c != NULL);
+    memset(c, 0, sizeof (*c));
+
+    const float factor = powf(2.f, .5f);
+    const float factor_1 = .5f * (factor + 1.f);
+    const float factor_2 = .5f * (factor - 1.f);
+
+    c->bands = ARRAY_SIZE(frequencies);
+    for (unsigned i = 0; i < c->bands; i++)
+    {
+        if (frequencies[i] <= .5f * rate)
+        {
+            const float theta_1 = 2.f * (float)M_PI * frequencies[i] / rate;
+            const float theta_2 = theta_1 / factor;
+            const float sin_ = sinf(theta_2);
+            const float sin_prd = sinf(theta_2 * factor_1)
+                                * sinf(theta_2 * factor_2);
+            const float den = .5f * sin_ + sin_prd;
+
+            c->alpha[i] = sin_prd / den;
+            c->beta[i] = (.5f * sin_ - sin_prd) / den;
+            c->gamma[i] = sin_ * cosf(theta_1) / den;
+        }
+        c->amp[i] = EQZ_IN_FACTOR * (powf(10.f, gains_db[i] / 20.f) - 1.f);
+    }
+    return c;
+}
+
+static eqz_state_t *States(unsigned channels)
+{
+    eqz_state_t *s = aligned_alloc(alignof (eqz_state_t),
+                                   channels * sizeof (*s));
+    assert(s != NULL);
+    memset(s, 0, channels * sizeof (*s));
+    return s;
+}
+
+static float *Generate(unsigned channels, unsigned frames)
+{
+    float *buf = vlc_alloc(frames * channels, sizeof (*buf));
+    assert(buf != NULL);
+
+    for (unsigned i = 0; i < frames; i++)
+        for (unsigned c = 0; c < channels; c++)
+            buf[i * channels + c] =
+                .3f * sinf(2.f * (float)M_PI * 110.f * (c + 1) * i / RATE)
+              + .2f * sinf(2.f * (float)M_PI * 5000.f * i / RATE + c)
+              + .1f * RandomFloat();
+    return buf;
+}
+
+/* The vectorized bank must output the same samples as the scalar one, but
+ * for the rounding errors of the band sums and of the fused multiply-adds,
+ * which the high Q bands carry over for a while */
+static void TestBank(void)
+{
+    eqz_coeffs_t *coeffs = Coeffs(RATE);
+    const unsigned frames = 20000;
+
+    for (size_t i = 0; i < ARRAY_SIZE(channel_counts); i++)
+        for (int passes = 1; passes <= 2; passes++)
+        {
+            const unsigned channels = channel_counts[i];
+            float *ref = Generate(channels, frames);
+            float *buf = vlc_alloc(frames * channels, sizeof (*buf));
+            assert(buf != NULL);
+            memcpy(buf, ref, frames * channels * sizeof (*buf));
+
+            eqz_state_t *state_ref = States(channels);
+            eqz_state_t *state2_ref = passes == 2 ? States(channels) : NULL;
+            eqz_state_t *state = States(channels);
+            eqz_state_t *state2 = passes == 2 ? States(channels) : NULL;
+            const float gain = passes == 2 ? .7f * .7f : .7f;
+
+            /* Odd block sizes, so that the state is carried over */
+            for (unsigned pos = 0, len = 1; pos < frames; pos += len, len += 97)
+            {
+                if (len > frames - pos)
+                    len = frames - pos;
+                eqz_Filter_C(coeffs, state_ref, state2_ref, gain,
+                             ref + pos * channels, len, channels);
+                eqz_Filter(coeffs, state, state2, gain,
+                           buf + pos * channels, len, channels);
+            }
+
+            float max_diff = 0.f, max_value = 0.f;
+            for (unsigned s = 0; s < frames * channels; s++)
+            {
+                assert(isfinite(buf[s]));
+                max_diff = fmaxf(max_diff, fabsf(buf[s] - ref[s]));
+                max_value = fmaxf(max_value, fabsf(ref[s]));
+            }
+            test_log("%u channels, %d pass: max difference %g (peak %g)\n",
+                     channels, passes, max_diff, max_value);
+            assert(max_diff <= 1e-4f * max_value); /* -80 dB */
+
+            /* The padding bands must still be silent */
+            for (unsigned c = 0; c < channels; c++)
+                for (unsigned b = coeffs->bands; b < EQZ_LANES; b++)
+                    assert(state[c].y0[b] == 0.f && state[c].y1[b] == 0.f);
+
+            aligned_free(state2);
+            aligned_free(state);
+            aligned_free(state2_ref);
+            aligned_free(state_ref);
+            free(buf);
+            free(ref);
+        }
+    aligned_free(coeffs);
+}
+
+static void BenchBank(void)
+{
+    eqz_coeffs_t *coeffs = Coeffs(RATE);
+    const unsigned channels = 6, frames = 1024, runs = 200;
+    float *in = Generate(channels, frames);
+    float *buf = vlc_alloc(frames * channels, sizeof (*buf));
+    eqz_state_t *state = States(channels);
+    assert(buf != NULL);
+
+    /* Filter the same input again and again, as the gains are not unity */
+    vlc_tick_t ref = 0, fast = 0;
+    for (unsigned i = 0; i < runs; i++)
+    {
+        memcpy(buf, in, frames * channels * sizeof (*buf));
+        vlc_tick_t start = vlc_tick_now();
+        eqz_Filter_C(coeffs, state, NULL, 1.f, buf, frames, channels);
+        ref += vlc_tick_now() - start;
+
+        memcpy(buf, in, frames * channels * sizeof (*buf));
+        start = vlc_tick_now();
+        eqz_Filter(coeffs, state, NULL, 1.f, buf, frames, channels);
+        fast += vlc_tick_now() - start;
+    }
+
+    const double samples = (double)runs * frames * channels;
+    test_log("5.1 10 bands: %.2f ns/sample scalar, %.2f ns/sample "
+             "vectorized (x%.1f)\n", (double)ref * 1000 / samples,
+             (double)fast * 1000 / samples, (double)ref / (fast ? fast : 1));
+    aligned_free(state);
+    free(buf);
+    free(in);
+    aligned_free(coeffs);
+}
+
+static filter_t *CreateFilter(vlc_object_t *parent, const char *capability,
+                              const char *name, uint32_t chans_in,
+                              uint32_t chans_out)
+{
+    filter_t *filter = vlc_object_create(parent, sizeof (*filter));
+    assert(filter != NULL);
+
+    es_format_Init(&filter->fmt_in, AUDIO_ES, VLC_CODEC_FL32);
+    filter->fmt_in.audio.i_format = VLC_CODEC_FL32;
+    filter->fmt_in.audio.i_rate = RATE;
+    filter->fmt_in.audio.i_physical_channels = chans_in;
+    aout_FormatPrepare(&filter->fmt_in.audio);
+    es_format_Copy(&filter->fmt_out, &filter->fmt_in);
+    filter->fmt_out.audio.i_physical_channels = chans_out;
+    aout_FormatPrepare(&filter->fmt_out.audio);
+
+    filter->p_module = module_need(filter, capability, name, true);
+    if (filter->p_module == NULL)
+    {
+        test_log("%s not available\n", name);
+        es_format_Clean(&filter->fmt_in);
+        es_format_Clean(&filter->fmt_out);
+        vlc_object_delete(filter);
+        return NULL;
+    }
+    return filter;
+}
+
+static void DeleteFilter(filter_t *filter)
+{
+    filter_Close(filter);
+    module_unneed(filter, filter->p_module);
+    es_format_Clean(&filter->fmt_in);
+    es_format_Clean(&filter->fmt_out);
+    vlc_object_delete(filter);
+}
+
+/* Equalizer, compressor and 5.1 to stereo downmix, as set up by the audio
+ * output for a 5.1 source on stereo speakers */
+static void BenchChain(vlc_object_t *parent)
+{
+    const unsigned channels = 6, frames = 1024, blocks = 500;
+
+    /* The equalizer and the compressor take their settings from their
+     * parent, the audio output */
+    vlc_object_t *aout = vlc_object_create(parent, sizeof (*aout));
+    assert(aout != NULL);
+    var_Create(aout, "equalizer-preset", VLC_VAR_STRING);
+    var_SetString(aout, "equalizer-preset", "rock");
+
+    filter_t *chain[] = {
+        CreateFilter(aout, "audio filter", "equalizer",
+                     AOUT_CHANS_5_1, AOUT_CHANS_5_1),
+        CreateFilter(aout, "audio filter", "compressor",
+                     AOUT_CHANS_5_1, AOUT_CHANS_5_1),
+        CreateFilter(aout, "audio converter", "simple_channel_mixer",
+                     AOUT_CHANS_5_1, AOUT_CHANS_STEREO),
+    };
+    vlc_tick_t elapsed[ARRAY_SIZE(chain)] = { 0 };
+
+    for (size_t i = 0; i < ARRAY_SIZE(chain); i++)
+        if (chain[i] == NULL)
+        {
+            test_log("skipping the filter chain benchmark\n");
+            goto end;
+        }
+
+    float *buf = Generate(channels, frames * blocks);
+
+    for (unsigned b = 0; b < blocks; b++)
+    {
+        block_t *block = block_Alloc(frames * channels * sizeof (float));
+        assert(block != NULL);
+        memcpy(block->p_buffer, &buf[b * frames * channels], block->i_buffer);
+        block->i_nb_samples = frames;
+        block->i_pts = block->i_dts = VLC_TICK_0 +
+            vlc_tick_from_samples(b * frames, RATE);
+
+        for (size_t i = 0; i < ARRAY_SIZE(chain) && block != NULL; i++)
+        {
+            vlc_tick_t start = vlc_tick_now();
+            block = chain[i]->ops->filter_audio(chain[i], block);
+            elapsed[i] += vlc_tick_now() - start;
+        }
+
+        assert(block != NULL);
+        assert(block->i_nb_samples == frames);
+        assert(block->i_buffer == frames * 2 * sizeof (float));
+        for (unsigned s = 0; s < frames * 2; s++)
+            assert(isfinite(((const float *)block->p_buffer)[s]));
+        block_Release(block);
+    }
+    free(buf);
+
+    /* Per input sample, i.e. per frame and per source channel */
+    const double samples = (double)frames * blocks * channels;
+    vlc_tick_t total = 0;
+    for (size_t i = 0; i < ARRAY_SIZE(chain); i++)
+    {
+        test_log("%-20s %6.2f ns/sample\n",
+                 module_get_object(chain[i]->p_module),
+                 (double)elapsed[i] * 1000 / samples);
+        total += elapsed[i];
+    }
+    test_log("%-20s %6.2f ns/sample, %.0fx real time\n", "chain",
+             (double)total * 1000 / samples,
+             (double)frames * blocks / RATE * CLOCK_FREQ
+             / (total ? total : 1));
+
+end:
+    for (size_t i = 0; i < ARRAY_SIZE(chain); i++)
+        if (chain[i] != NULL)
+            DeleteFilter(chain[i]);
+    vlc_object_delete(aout);
+}
+
+int main(void)
+{
+    test_init();
+
+    TestBank();
+    BenchBank();
+
+    libvlc_instance_t *vlc = libvlc_new(test_defaults_nargs,
+                                        test_defaults_args);
+    assert(vlc != NULL);
+    BenchChain(VLC_OBJECT(vlc->p_libvlc_int));
+    libvlc_release(vlc);
+    return 0;
+}
@@ -0,0 +1,373 @@
+/*****************************************************************************
+ * format.c: PCM format converter test
+ *****************************************************************************
+ * Copyright (C) 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <math.h>
+
+#include <vlc/vlc.h>
+
+#include "../../../lib/libvlc_internal.h"
+
+#include <vlc_common.h>
+#include <vlc_modules.h>
+#include <vlc_aout.h>
+#include <vlc_filter.h>
+#include <vlc_block.h>
+#include <vlc_tick.h>
+
+#include "../../../modules/audio_filter/converter/format_simd.h"
+
+#include "../../libvlc/test.h"
+#include "../random.h"
+
+static const struct
+{
+    vlc_fourcc_t fourcc;
+    size_t size;
+    const char *name;
+} formats[] =
+{
+    { VLC_CODEC_U8,   1, "u8"  },
+    { VLC_CODEC_S16N, 2, "s16" },
+    { VLC_CODEC_S32N, 4, "s32" },
+    { VLC_CODEC_FL32, 4, "f32" },
+    { VLC_CODEC_FL64, 8, "f64" },
+};
+
+static const char *const isas[] = { "c", "sse2", "avx2", "neon" };
+
+/* Values around the edges of the conversions */
+static const double specials[] =
+{
+    0., -0., 1., -1., 1.0001, -1.0001, 1e30, -1e30,
+    .5 / 128., 1.5 / 128., -2.5 / 128., 127.5 / 128.,
+    .5 / 32768., 1.5 / 32768., -2.5 / 32768., 32767.5 / 32768.,
+    .5 / 2147483648., 2147483647.5 / 2147483648., -2147483648.5 / 2147483648.,
+};
+
+static void Fill(vlc_fourcc_t fourcc, void *buf, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        uint32_t r = RandomNext() >> 8;
+        double v = (int)(r & 0xffff) / 27000. - 1.2;
+
+        if (r % 7 == 0)
+            v = specials[(r >> 16) % ARRAY_SIZE(specials)];
+        else if (r % 97 == 1)
+            v = (r & 0x10000) ? INFINITY : -INFINITY;
+        else if (r % 97 == 2)
+            v = NAN;
+
+        switch (fourcc)
+        {
+            case VLC_CODEC_U8:
+                ((uint8_t *)buf)[i] = r;
+                break;
+            case VLC_CODEC_S16N:
+                ((int16_t *)buf)[i] = r;
+                break;
+            case VLC_CODEC_S32N:
+                ((int32_t *)buf)[i] = r * 2654435761u;
+                break;
+            case VLC_CODEC_FL32:
+                ((float *)buf)[i] = v;
+                break;
+            case VLC_CODEC_FL64:
+                ((double *)buf)[i] = v;
+                break;
+        }
+    }
+}
+
+static const size_t lengths[] = { 0, 1, 3, 7, 8, 9, 15, 16, 17, 33, 1021, 4099 };
+#define MAX_LENGTH 4099
+#define MAX_OFFSET 3
+
+/* Compares the vectorized conversions with the reference ones, on odd
+ * lengths, unaligned buffers and in place */
+static void TestExactness(int isa)
+{
+    unsigned checked = 0;
+    uint8_t *in = malloc((MAX_LENGTH + MAX_OFFSET) * 8 + 1);
+    uint8_t *ref = malloc((MAX_LENGTH + MAX_OFFSET) * 8 + 1);
+    uint8_t *out = malloc((MAX_LENGTH + MAX_OFFSET) * 8 + 1);
+    uint8_t *tmp = malloc((MAX_LENGTH + MAX_OFFSET) * 8 + 1);
+    assert(in != NULL && ref != NULL && out != NULL && tmp != NULL);
+
+    for (size_t s = 0; s < ARRAY_SIZE(formats); s++)
+        for (size_t d = 0; d < ARRAY_SIZE(formats); d++)
+            for (int dither = 0; dither < 2; dither++)
+            {
+                if (s == d)
+                    continue;
+
+                vlc_fourcc_t src = formats[s].fourcc, dst = formats[d].fourcc;
+                size_t ssize = formats[s].size, dsize = formats[d].size;
+                pcm_convert_t c = pcm_GetConversion(src, dst, dither,
+                                                    PCM_CVT_ISA_C);
+                pcm_convert_t simd = pcm_GetConversion(src, dst, dither, isa);
+                assert(c != NULL);
+                if (simd == NULL)
+                    continue;
+
+                for (size_t l = 0; l < ARRAY_SIZE(lengths); l++)
+                    for (size_t off = 0; off <= MAX_OFFSET; off++)
+                    {
+                        const size_t count = lengths[l];
+                        void *ip = in + off * ssize, *rp = ref + off * dsize;
+                        void *op = out + off * dsize, *tp = tmp + off * ssize;
+                        pcm_dither_t dref, dsimd, dinplace;
+
+                        Fill(src, ip, count);
+                        pcm_DitherInit(&dref, off);
+                        dsimd = dinplace = dref;
+
+                        /* twice, to carry the dither state over */
+                        for (int pass = 0; pass < 2; pass++)
+                        {
+                            c(rp, ip, count, &dref);
+                            simd(op, ip, count, &dsimd);
+                            if (memcmp(rp, op, count * dsize))
+                            {
+                                test_log("%s->%s%s (%s) differs, "
+                                         "%zu samples, offset %zu\n",
+                                         formats[s].name, formats[d].name,
+                                         dither ? " dithered" : "",
+                                         isas[isa], count, off);
+                                abort();
+                            }
+                            assert(!memcmp(&dref, &dsimd, sizeof (dref)));
+
+                            if (dsize <= ssize)
+                            {
+                                memcpy(tp, ip, count * ssize);
+                                simd(tp, tp, count, &dinplace);
+                                assert(!memcmp(rp, tp, count * dsize));
+                            }
+                        }
+                    }
+                checked++;
+            }
+
+    if (checked == 0)
+    {
+        test_log("%s: not available\n", isas[isa]);
+    }
+    else
+    {
+        test_log("%s: %u conversions match the reference\n", isas[isa],
+                 checked);
+    }
+    free(tmp);
+    free(out);
+    free(ref);
+    free(in);
+}
+
+static void Convert(vlc_fourcc_t src, vlc_fourcc_t dst, bool dither,
+                    const void *in, void *out, size_t count)
+{
+    pcm_dither_t state;
+    pcm_convert_t c = pcm_GetConversion(src, dst, dither, PCM_CVT_ISA_C);
+
+    assert(c != NULL);
+    pcm_DitherInit(&state, 0);
+    c(out, in, count, &state);
+}
+
+/* Checks the reference conversions on known values */
+static void TestValues(void)
+{
+    static const float f32[] = {
+        1.f, -1.f, .5f / 32768.f, 1.5f / 32768.f, -2.5f / 32768.f,
+        NAN, INFINITY, -INFINITY, 0.f,
+    };
+    static const int16_t f32_s16[] = {
+        32767, -32768, 0, 2, -2, -32768, 32767, -32768, 0,
+    };
+    static const int32_t f32_s32[] = {
+        INT32_MAX, INT32_MIN, 32768, 98304, -163840,
+        INT32_MIN, INT32_MAX, INT32_MIN, 0,
+    };
+    static const uint8_t f32_u8[] = {
+        255, 0, 128, 128, 128, 0, 255, 0, 128,
+    };
+    int16_t s16[ARRAY_SIZE(f32)];
+    int32_t s32[ARRAY_SIZE(f32)];
+    uint8_t u8[ARRAY_SIZE(f32)];
+
+    Convert(VLC_CODEC_FL32, VLC_CODEC_S16N, false, f32, s16, ARRAY_SIZE(f32));
+    Convert(VLC_CODEC_FL32, VLC_CODEC_S32N, false, f32, s32, ARRAY_SIZE(f32));
+    Convert(VLC_CODEC_FL32, VLC_CODEC_U8, false, f32, u8, ARRAY_SIZE(f32));
+    assert(!memcmp(s16, f32_s16, sizeof (s16)));
+    assert(!memcmp(s32, f32_s32, sizeof (s32)));
+    assert(!memcmp(u8, f32_u8, sizeof (u8)));
+
+    static const double f64[] = { 1., -1., 2147483647.5 / 2147483648. };
+    static const int32_t f64_s32[] = { INT32_MAX, INT32_MIN, INT32_MAX };
+    Convert(VLC_CODEC_FL64, VLC_CODEC_S32N, false, f64, s32, ARRAY_SIZE(f64));
+    assert(!memcmp(s32, f64_s32, sizeof (f64_s32)));
+
+    static const uint8_t u8_in[] = { 0, 128, 255 };
+    static const int16_t u8_s16[] = { -32768, 0, 32512 };
+    float fl[3];
+    double dbl[3];
+    Convert(VLC_CODEC_U8, VLC_CODEC_S16N, false, u8_in, s16, 3);
+    assert(!memcmp(s16, u8_s16, sizeof (u8_s16)));
+    Convert(VLC_CODEC_U8, VLC_CODEC_FL32, false, u8_in, fl, 3);
+    assert(fl[0] == -1.f && fl[1] == 0.f && fl[2] == 127.f / 128.f);
+
+    static const int16_t s16_in[] = { -32768, 1, 32767 };
+    Convert(VLC_CODEC_S16N, VLC_CODEC_FL64, false, s16_in, dbl, 3);
+    assert(dbl[0] == -1. && dbl[1] == 1. / 32768. && dbl[2] == 32767. / 32768.);
+    Convert(VLC_CODEC_S16N, VLC_CODEC_U8, false, s16_in, u8, 3);
+    assert(u8[0] == 0 && u8[1] == 128 && u8[2] == 255);
+
+    /* Dither of one LSB peak leaves the mean of a constant unbiased */
+    enum { count = 65536 };
+    float *in = vlc_alloc(count, sizeof (*in));
+    int16_t *out = vlc_alloc(count, sizeof (*out));
+    assert(in != NULL && out != NULL);
+    for (size_t i = 0; i < count; i++)
+        in[i] = .25f / 32768.f;
+
+    Convert(VLC_CODEC_FL32, VLC_CODEC_S16N, true, in, out, count);
+    long sum = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        assert(out[i] >= -1 && out[i] <= 1);
+        sum += out[i];
+    }
+    test_log("dithered mean: %.3f LSB, expected 0.25\n", (double)sum / count);
+    assert(fabs((double)sum / count - .25) < .02);
+    free(out);
+    free(in);
+}
+
+/* Runs the converter module on blocks */
+static void TestFilter(vlc_object_t *parent, vlc_fourcc_t src,
+                       vlc_fourcc_t dst)
+{
+    filter_t *filter = vlc_object_create(parent, sizeof (*filter));
+    assert(filter != NULL);
+
+    es_format_Init(&filter->fmt_in, AUDIO_ES, src);
+    filter->fmt_in.audio.i_format = src;
+    filter->fmt_in.audio.i_rate = 48000;
+    filter->fmt_in.audio.i_physical_channels = AOUT_CHANS_STEREO;
+    aout_FormatPrepare(&filter->fmt_in.audio);
+    es_format_Init(&filter->fmt_out, AUDIO_ES, dst);
+    filter->fmt_out.audio = filter->fmt_in.audio;
+    filter->fmt_out.audio.i_format = dst;
+    aout_FormatPrepare(&filter->fmt_out.audio);
+
+    filter->p_module = module_need(filter, "audio converter", "audio_format",
+                                   true);
+    assert(filter->p_module != NULL);
+
+    const size_t frames = 1001;
+    const size_t ssize = aout_BitsPerSample(src) / 8;
+    const size_t dsize = aout_BitsPerSample(dst) / 8;
+    block_t *in = block_Alloc(frames * 2 * ssize);
+    assert(in != NULL);
+    Fill(src, in->p_buffer, frames * 2);
+    in->i_nb_samples = frames;
+    in->i_pts = in->i_dts = VLC_TICK_0 + VLC_TICK_FROM_MS(10);
+
+    uint8_t *ref = malloc(frames * 2 * dsize);
+    assert(ref != NULL);
+    Convert(src, dst, false, in->p_buffer, ref, frames * 2);
+
+    block_t *out = filter->ops->filter_audio(filter, in);
+    assert(out != NULL);
+    assert(out->i_buffer == frames * 2 * dsize);
+    assert(out->i_nb_samples == frames);
+    assert(out->i_pts == VLC_TICK_0 + VLC_TICK_FROM_MS(10));
+    assert(!memcmp(out->p_buffer, ref, out->i_buffer));
+
+    block_Release(out);
+    free(ref);
+    filter_Close(filter);
+    module_unneed(filter, filter->p_module);
+    es_format_Clean(&filter->fmt_in);
+    es_format_Clean(&filter->fmt_out);
+    vlc_object_delete(filter);
+}
+
+static void Benchmark(void)
+{
+    enum { count = 1 << 20, runs = 8 };
+    void *in = malloc(count * 8);
+    void *out = malloc(count * 8);
+    assert(in != NULL && out != NULL);
+
+    for (size_t s = 0; s < ARRAY_SIZE(formats); s++)
+        for (size_t d = 0; d < ARRAY_SIZE(formats); d++)
+        {
+            if (s == d)
+                continue;
+
+            vlc_fourcc_t src = formats[s].fourcc, dst = formats[d].fourcc;
+            double ns[2];
+            pcm_convert_t impl[2] = {
+                pcm_GetConversion(src, dst, false, PCM_CVT_ISA_C),
+                pcm_GetConversion(src, dst, false, PCM_CVT_ISA_AUTO),
+            };
+            pcm_dither_t dither;
+
+            pcm_DitherInit(&dither, 0);
+            Fill(src, in, count);
+            for (int k = 0; k < 2; k++)
+            {
+                vlc_tick_t begin = vlc_tick_now();
+                for (int r = 0; r < runs; r++)
+                    impl[k](out, in, count, &dither);
+                ns[k] = (double)NS_FROM_VLC_TICK(vlc_tick_now() - begin)
+                        / (runs * count);
+            }
+            test_log("%s->%s: %.2f ns per sample, %.2f with C\n",
+                     formats[s].name, formats[d].name, ns[1], ns[0]);
+        }
+    free(out);
+    free(in);
+}
+
+int main(void)
+{
+    test_init();
+
+    TestValues();
+    for (int isa = PCM_CVT_ISA_C + 1; isa < PCM_CVT_ISA_COUNT; isa++)
+        TestExactness(isa);
+    Benchmark();
+
+    libvlc_instance_t *vlc = libvlc_new(test_defaults_nargs,
+                                        test_defaults_args);
+    assert(vlc != NULL);
+    TestFilter(VLC_OBJECT(vlc->p_libvlc_int), VLC_CODEC_U8, VLC_CODEC_FL32);
+    TestFilter(VLC_OBJECT(vlc->p_libvlc_int), VLC_CODEC_FL64, VLC_CODEC_FL32);
+    TestFilter(VLC_OBJECT(vlc->p_libvlc_int), VLC_CODEC_FL32, VLC_CODEC_S16N);
+    TestFilter(VLC_OBJECT(vlc->p_libvlc_int), VLC_CODEC_S16N, VLC_CODEC_FL64);
+    libvlc_release(vlc);
+    return 0;
+}
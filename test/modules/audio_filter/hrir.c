@@ -0,0 +1,268 @@
+/*****************************************************************************
+ * hrir.c: partitioned convolution and binaural rendering test
+ *****************************************************************************
+ * Copyright (C) 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <math.h>
+
+#include <vlc/vlc.h>
+
+#include "../../../lib/libvlc_internal.h"
+
+#include <vlc_common.h>
+#include <vlc_modules.h>
+#include <vlc_aout.h>
+#include <vlc_filter.h>
+#include <vlc_block.h>
+#include <vlc_tick.h>
+
+#include "../../../modules/audio_filter/channel_mixer/convolver.h"
+
+#include "../../libvlc/test.h"
+#include "../random.h"
+
+static float *RandomBuffer(size_t count)
+{
+    float *buf = aligned_alloc(64, count * sizeof (*buf));
+
+    assert(buf != NULL);
+    for (size_t i = 0; i < count; i++)
+        buf[i] = RandomFloat();
+    return buf;
+}
+
+/* Compares the vectorized multiply-accumulate with the reference one */
+static void TestMulAdd(void)
+{
+    const size_t bins = 272;
+    float *x = RandomBuffer(2 * bins), *h = RandomBuffer(2 * bins);
+    float *acc = RandomBuffer(2 * bins), *ref = RandomBuffer(2 * bins);
+    conv_muladd_t muladd = conv_GetMulAdd();
+
+    memcpy(ref, acc, 2 * bins * sizeof (*acc));
+    for (unsigned pass = 0; pass < 3; pass++)
+    {
+        conv_MulAdd_C(ref, ref + bins, x, x + bins, h, h + bins, bins);
+        muladd(acc, acc + bins, x, x + bins, h, h + bins, bins);
+    }
+    for (size_t k = 0; k < 2 * bins; k++)
+        assert(fabsf(acc[k] - ref[k]) <= 1e-5f);
+
+    aligned_free(ref);
+    aligned_free(acc);
+    aligned_free(h);
+    aligned_free(x);
+}
+
+/* Compares the engine with the direct convolution */
+static void TestConvolution(unsigned inputs, unsigned outputs,
+                            unsigned block, size_t length, unsigned head)
+{
+    const size_t blocks = 40, frames = blocks * block;
+    float *ir = RandomBuffer((size_t)inputs * outputs * length);
+    float *in = RandomBuffer(frames * inputs);
+    float *out[2], *ref = calloc(frames * outputs, sizeof (*ref));
+    conv_engine_t *conv[2];
+
+    assert(ref != NULL);
+    for (size_t j = 0; j < frames; j++)
+        for (unsigned i = 0; i < inputs; i++)
+            for (unsigned o = 0; o < outputs; o++)
+            {
+                const float *h = ir + ((size_t)i * outputs + o) * length;
+                double sum = 0.;
+
+                for (size_t k = 0; k < length && k <= j; k++)
+                    sum += h[k] * in[(j - k) * inputs + i];
+                ref[j * outputs + o] += sum;
+            }
+
+    for (unsigned t = 0; t < 2; t++)
+    {
+        conv[t] = conv_New(inputs, outputs, block, ir, length, head, t);
+        assert(conv[t] != NULL);
+        assert(conv_Partitions(conv[t]) == (length + block - 1) / block);
+        out[t] = malloc(frames * outputs * sizeof (float));
+        assert(out[t] != NULL);
+    }
+
+    for (unsigned pass = 0; pass < 2; pass++)
+    {
+        for (unsigned t = 0; t < 2; t++)
+        {
+            for (size_t b = 0; b < blocks; b++)
+                conv_Process(conv[t], in + b * block * inputs,
+                             out[t] + b * block * outputs);
+            conv_Reset(conv[t]);
+        }
+
+        /* The worker thread computes exactly the same */
+        assert(!memcmp(out[0], out[1], frames * outputs * sizeof (float)));
+        for (size_t k = 0; k < frames * outputs; k++)
+            assert(fabsf(out[0][k] - ref[k]) <= 2e-3f);
+    }
+
+    for (unsigned t = 0; t < 2; t++)
+    {
+        conv_Delete(conv[t]);
+        free(out[t]);
+    }
+    free(ref);
+    aligned_free(in);
+    aligned_free(ir);
+}
+
+static void Benchmark(unsigned inputs, unsigned block, size_t length)
+{
+    const unsigned rate = 48000, blocks = rate / block;
+    float *ir = RandomBuffer((size_t)inputs * 2 * length);
+    float *in = RandomBuffer((size_t)inputs * block);
+    float *out = malloc(block * 2 * sizeof (*out));
+
+    assert(out != NULL);
+    for (unsigned t = 0; t < 2; t++)
+    {
+        conv_engine_t *conv = conv_New(inputs, 2, block, ir, length,
+                                       4096 / block, t);
+        assert(conv != NULL);
+
+        vlc_tick_t begin = vlc_tick_now();
+        for (unsigned b = 0; b < blocks; b++)
+            conv_Process(conv, in, out);
+        vlc_tick_t elapsed = vlc_tick_now() - begin;
+
+        test_log("%u channels, %zu taps, %u frames blocks%s: "
+                 "%.1f%% of real time\n", inputs, length, block,
+                 t ? " with worker" : "",
+                 100. * elapsed / vlc_tick_from_samples(blocks * block,
+                                                        rate));
+        conv_Delete(conv);
+    }
+    free(out);
+    aligned_free(in);
+    aligned_free(ir);
+}
+
+static void TestFilter(vlc_object_t *parent, uint32_t chans, unsigned block)
+{
+    const unsigned rate = 48000;
+    filter_t *filter = vlc_object_create(parent, sizeof (*filter));
+    assert(filter != NULL);
+
+    var_Create(filter, "hrir-partition", VLC_VAR_INTEGER);
+    var_SetInteger(filter, "hrir-partition", block);
+
+    es_format_Init(&filter->fmt_in, AUDIO_ES, VLC_CODEC_FL32);
+    filter->fmt_in.audio.i_format = VLC_CODEC_FL32;
+    filter->fmt_in.audio.i_rate = rate;
+    filter->fmt_in.audio.i_physical_channels = chans;
+    aout_FormatPrepare(&filter->fmt_in.audio);
+    es_format_Init(&filter->fmt_out, AUDIO_ES, VLC_CODEC_FL32);
+    filter->fmt_out.audio = filter->fmt_in.audio;
+    filter->fmt_out.audio.i_physical_channels = AOUT_CHANS_STEREO;
+    aout_FormatPrepare(&filter->fmt_out.audio);
+
+    filter->p_module = module_need(filter, "audio filter", "hrir", true);
+    assert(filter->p_module != NULL);
+    assert(filter->fmt_out.audio.i_channels == 2);
+
+    const unsigned inputs = filter->fmt_in.audio.i_channels;
+    const size_t frames = 1000;
+    size_t total = 0;
+    vlc_tick_t end = VLC_TICK_INVALID;
+    const vlc_tick_t delay = vlc_tick_from_samples(block, rate);
+    double energy[2] = { 0., 0. };
+
+    /* An impulse in the left channel, in blocks of various sizes */
+    for (unsigned b = 0; b < 20; b++)
+    {
+        const size_t count = frames + 37 * b;
+        block_t *in = block_Alloc(count * inputs * sizeof (float));
+        assert(in != NULL);
+
+        memset(in->p_buffer, 0, in->i_buffer);
+        if (b == 0)
+            ((float *)in->p_buffer)[0] = 1.f;
+        in->i_nb_samples = count;
+        in->i_pts = in->i_dts = VLC_TICK_0
+                              + vlc_tick_from_samples(total, rate);
+        in->i_length = vlc_tick_from_samples(count, rate);
+        end = in->i_pts + in->i_length;
+
+        const vlc_tick_t pts = in->i_pts;
+        block_t *out = filter->ops->filter_audio(filter, in);
+        assert(out != NULL);
+        assert(out->i_nb_samples == count);
+        /* Stamped with the delay of the convolution */
+        assert(out->i_pts == pts - delay);
+        assert(out->i_buffer == count * 2 * sizeof (float));
+
+        const float *samples = (const float *)out->p_buffer;
+        for (size_t k = 0; k < count; k++)
+        {
+            /* One block of latency */
+            if (total + k < block)
+                assert(samples[2 * k] == 0.f && samples[2 * k + 1] == 0.f);
+            energy[0] += samples[2 * k] * samples[2 * k];
+            energy[1] += samples[2 * k + 1] * samples[2 * k + 1];
+        }
+        total += count;
+        block_Release(out);
+    }
+
+    /* The left ear hears the left speaker louder */
+    assert(energy[0] > energy[1] && energy[1] > 0.);
+
+    block_t *out = filter->ops->drain_audio(filter);
+    assert(out != NULL);
+    assert(out->i_nb_samples == block);
+    assert(out->i_pts == end - delay);
+    block_Release(out);
+    assert(filter->ops->drain_audio(filter) == NULL);
+
+    filter_Close(filter);
+    module_unneed(filter, filter->p_module);
+    es_format_Clean(&filter->fmt_in);
+    es_format_Clean(&filter->fmt_out);
+    vlc_object_delete(filter);
+}
+
+int main(void)
+{
+    test_init();
+
+    TestMulAdd();
+    TestConvolution(1, 1, 16, 16, 1);
+    TestConvolution(1, 2, 64, 1000, 1);
+    TestConvolution(3, 2, 64, 1000, 4);
+    TestConvolution(2, 2, 256, 300, 8);
+    Benchmark(8, 256, 48000 * 35 / 100);
+    Benchmark(8, 1024, 48000 * 2);
+
+    libvlc_instance_t *vlc = libvlc_new(test_defaults_nargs,
+                                        test_defaults_args);
+    assert(vlc != NULL);
+    TestFilter(VLC_OBJECT(vlc->p_libvlc_int), AOUT_CHANS_STEREO, 256);
+    TestFilter(VLC_OBJECT(vlc->p_libvlc_int), AOUT_CHANS_5_1, 128);
+    TestFilter(VLC_OBJECT(vlc->p_libvlc_int), AOUT_CHANS_8_1, 512);
+    libvlc_release(vlc);
+    return 0;
+}
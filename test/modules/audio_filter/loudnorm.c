@@ -0,0 +1,366 @@
+/*****************************************************************************
+ * loudnorm.c: loudness meter and normalizer test
+ *****************************************************************************
+ * Copyright (C) 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <math.h>
+
+#include <vlc/vlc.h>
+
+#include "../../../lib/libvlc_internal.h"
+
+#include <vlc_common.h>
+#include <vlc_modules.h>
+#include <vlc_aout.h>
+#include <vlc_filter.h>
+#include <vlc_block.h>
+#include <vlc_tick.h>
+
+#include "../../../modules/audio_filter/loudness_r128.h"
+
+#include "../../libvlc/test.h"
+#include "../random.h"
+
+#define CHANNELS 2
+#define BLOCK_FRAMES 1024
+#define TARGET (-23.)
+#define CEILING (-1.)
+
+static const float stereo[] = { 1.f, 1.f };
+
+/* Compares the vectorized filters with the reference ones */
+static void TestKernels(void)
+{
+    const size_t frames = 4801, stride = 6;
+    float *in = vlc_alloc(frames * stride + R128_TP_TAPS, sizeof (*in));
+    r128_kweight_t kw;
+    r128_truepeak_t tp;
+
+    assert(in != NULL);
+    for (size_t i = 0; i < frames * stride + R128_TP_TAPS; i++)
+        in[i] = RandomFloat();
+
+    r128_KWeightInit(&kw, 44100);
+    for (unsigned channels = 1; channels <= R128_LANES; channels++)
+    {
+        float state[4 * R128_LANES] = { 0 }, ref_state[4 * R128_LANES] = { 0 };
+        float sums[R128_LANES], ref[R128_LANES];
+
+        for (unsigned pass = 0; pass < 2; pass++)
+        {
+            r128_KWeight_C(&kw, ref_state, in, channels, stride, frames, ref);
+            r128_KWeight(&kw, state, in, channels, stride, frames, sums);
+            for (unsigned c = 0; c < channels; c++)
+                assert(fabsf(sums[c] - ref[c]) <= 1e-4f * ref[c]);
+        }
+    }
+
+    assert(r128_TruePeakInit(&tp, 48000, 1) == VLC_SUCCESS);
+
+    float peaks[1000], ref_peaks[1000];
+    for (size_t i = 0; i < ARRAY_SIZE(peaks); i++)
+        peaks[i] = ref_peaks[i] = (i % 3) * .5f;
+
+    r128_Interpolate_C((const float (*)[4])tp.coeffs, in, ARRAY_SIZE(peaks),
+                       ref_peaks);
+    r128_Interpolate((const float (*)[4])tp.coeffs, in, ARRAY_SIZE(peaks),
+                     peaks);
+    for (size_t i = 0; i < ARRAY_SIZE(peaks); i++)
+        assert(fabsf(peaks[i] - ref_peaks[i]) <= 1e-5f);
+
+    r128_TruePeakClean(&tp);
+    free(in);
+}
+
+/* Stereo sine at a level, in dBFS */
+static void Sine(float *buf, size_t frames, unsigned rate, double freq,
+                 double level, double phase)
+{
+    const double amplitude = pow(10., level / 20.);
+
+    for (size_t i = 0; i < frames; i++)
+        buf[i * CHANNELS] = buf[i * CHANNELS + 1] =
+            amplitude * sin(2. * M_PI * freq * i / rate + phase);
+}
+
+static void Measure(r128_meter_t *meter, const float *buf, size_t frames)
+{
+    while (frames > 0)
+    {
+        size_t n = r128_Remaining(meter);
+        if (n > frames)
+            n = frames;
+        r128_Add(meter, buf, n);
+        buf += n * CHANNELS;
+        frames -= n;
+    }
+}
+
+static float TruePeak(unsigned rate, const float *buf, size_t frames)
+{
+    r128_truepeak_t tp;
+    float *peaks = vlc_alloc(frames, sizeof (*peaks));
+    float max = 0.f;
+
+    assert(peaks != NULL);
+    assert(r128_TruePeakInit(&tp, rate, CHANNELS) == VLC_SUCCESS);
+    assert(r128_TruePeak(&tp, buf, frames, peaks) == VLC_SUCCESS);
+    for (size_t i = 0; i < frames; i++)
+        if (peaks[i] > max)
+            max = peaks[i];
+    r128_TruePeakClean(&tp);
+    free(peaks);
+    return max;
+}
+
+/* EBU Tech 3341 minimum requirements tests */
+static void TestMeter(unsigned rate)
+{
+    static const struct
+    {
+        double levels[5];
+        unsigned durations[5];
+        double expected;
+    } cases[] = {
+        { { -23. }, { 20 }, -23. },
+        { { -33. }, { 20 }, -33. },
+        { { -36., -23., -36. }, { 10, 60, 10 }, -23. },
+        { { -72., -36., -23., -36., -72. }, { 10, 10, 20, 10, 10 }, -23. },
+    };
+
+    for (size_t i = 0; i < ARRAY_SIZE(cases); i++)
+    {
+        r128_meter_t meter;
+
+        assert(r128_MeterInit(&meter, rate, CHANNELS, stereo, 1000)
+               == VLC_SUCCESS);
+        for (unsigned j = 0; j < 5 && cases[i].durations[j] > 0; j++)
+        {
+            const size_t frames = cases[i].durations[j] * rate;
+            float *buf = vlc_alloc(frames * CHANNELS, sizeof (*buf));
+
+            assert(buf != NULL);
+            Sine(buf, frames, rate, 1000., cases[i].levels[j], 0.);
+            Measure(&meter, buf, frames);
+            free(buf);
+        }
+
+        const double loudness = r128_Gated(&meter);
+        test_log("%u Hz, case %zu: %.2f LUFS, expected %.1f\n", rate, i + 1,
+                 loudness, cases[i].expected);
+        assert(fabs(loudness - cases[i].expected) <= .1);
+        r128_MeterClean(&meter);
+    }
+
+    /* Momentary and short term of a steady tone are the same */
+    r128_meter_t meter;
+    const size_t frames = 4 * rate;
+    float *buf = vlc_alloc(frames * CHANNELS, sizeof (*buf));
+
+    assert(buf != NULL);
+    assert(r128_MeterInit(&meter, rate, CHANNELS, stereo, 30) == VLC_SUCCESS);
+    Sine(buf, frames, rate, 1000., -20., 0.);
+    Measure(&meter, buf, frames);
+    assert(fabs(r128_Momentary(&meter) + 20.) <= .1);
+    assert(fabs(r128_ShortTerm(&meter) + 20.) <= .1);
+    r128_MeterClean(&meter);
+
+    /* Samples of a quarter rate sine miss its peaks by 3 dB */
+    if (rate < 96000)
+    {
+        Sine(buf, frames, rate, rate / 4., -6., M_PI / 4.);
+
+        const double tp = 20. * log10(TruePeak(rate, buf, frames));
+        test_log("%u Hz, true peak: %.2f dBTP, expected -6.0\n", rate, tp);
+        assert(tp > -6.4 && tp < -5.8);
+    }
+    free(buf);
+}
+
+static filter_t *CreateFilter(vlc_object_t *parent, unsigned rate)
+{
+    filter_t *filter = vlc_object_create(parent, sizeof (*filter));
+    assert(filter != NULL);
+
+    es_format_Init(&filter->fmt_in, AUDIO_ES, VLC_CODEC_FL32);
+    filter->fmt_in.audio.i_format = VLC_CODEC_FL32;
+    filter->fmt_in.audio.i_rate = rate;
+    filter->fmt_in.audio.i_physical_channels = AOUT_CHANS_STEREO;
+    aout_FormatPrepare(&filter->fmt_in.audio);
+    es_format_Copy(&filter->fmt_out, &filter->fmt_in);
+
+    filter->p_module = module_need(filter, "audio filter", "loudnorm", true);
+    assert(filter->p_module != NULL);
+    return filter;
+}
+
+static void DeleteFilter(filter_t *filter)
+{
+    filter_Close(filter);
+    module_unneed(filter, filter->p_module);
+    es_format_Clean(&filter->fmt_in);
+    es_format_Clean(&filter->fmt_out);
+    vlc_object_delete(filter);
+}
+
+/* Program material: speech like modulated noise, loud music like tones
+ * with transients, then quiet noise */
+static float *Program(unsigned rate, size_t section)
+{
+    float *buf = vlc_alloc(3 * section * CHANNELS, sizeof (*buf));
+    float lp = 0.f;
+
+    assert(buf != NULL);
+    for (size_t i = 0; i < 3 * section; i++)
+    {
+        const double t = (double)i / rate;
+        float l, r;
+
+        lp = .9f * lp + .1f * RandomFloat();
+        switch (i / section)
+        {
+            case 0:
+            {
+                const float env = .5f + .5f * sin(2. * M_PI * 4. * t);
+                l = r = .1f * env * (lp + .3f * RandomFloat());
+                break;
+            }
+            case 1:
+            {
+                const float beat = fmod(t, .5) < .02 ? 1.f : .3f;
+                l = beat * (.4f * sin(2. * M_PI * 220. * t)
+                          + .3f * sin(2. * M_PI * 3135. * t)
+                          + .2f * RandomFloat());
+                r = beat * (.4f * sin(2. * M_PI * 330. * t)
+                          + .3f * sin(2. * M_PI * 2500. * t)
+                          + .2f * RandomFloat());
+                break;
+            }
+            default:
+                l = .02f * RandomFloat();
+                r = .02f * lp;
+                break;
+        }
+        buf[i * CHANNELS] = l;
+        buf[i * CHANNELS + 1] = r;
+    }
+    return buf;
+}
+
+static void TestNormalize(vlc_object_t *parent, unsigned rate)
+{
+    const size_t section = 20 * rate, frames = 3 * section;
+    float *in = Program(rate, section);
+    float *out = vlc_alloc(frames * CHANNELS, sizeof (*out));
+    filter_t *filter = CreateFilter(parent, rate);
+    const vlc_tick_t start = VLC_TICK_FROM_SEC(1);
+    size_t outframes = 0;
+    vlc_tick_t elapsed = 0;
+
+    assert(out != NULL);
+    for (size_t pos = 0; pos < frames; pos += BLOCK_FRAMES)
+    {
+        const size_t count = __MIN(BLOCK_FRAMES, frames - pos);
+        block_t *block = block_Alloc(count * CHANNELS * sizeof (float));
+
+        assert(block != NULL);
+        memcpy(block->p_buffer, in + pos * CHANNELS, block->i_buffer);
+        block->i_nb_samples = count;
+        block->i_pts = block->i_dts = start + vlc_tick_from_samples(pos, rate);
+        block->i_length = vlc_tick_from_samples(count, rate);
+
+        vlc_tick_t begin = vlc_tick_now();
+        block = filter->ops->filter_audio(filter, block);
+        elapsed += vlc_tick_now() - begin;
+
+        if (block == NULL)
+            continue;
+        /* The latency is compensated, up to rounding */
+        assert(llabs(block->i_pts - start
+                     - vlc_tick_from_samples(outframes, rate)) <= 1);
+        assert(outframes + block->i_nb_samples <= frames);
+        memcpy(out + outframes * CHANNELS, block->p_buffer, block->i_buffer);
+        outframes += block->i_nb_samples;
+        block_Release(block);
+    }
+
+    block_t *block = filter->ops->drain_audio(filter);
+    assert(block != NULL);
+    assert(llabs(block->i_pts - start
+                 - vlc_tick_from_samples(outframes, rate)) <= 1);
+    assert(outframes + block->i_nb_samples == frames);
+    memcpy(out + outframes * CHANNELS, block->p_buffer, block->i_buffer);
+    block_Release(block);
+
+    test_log("%u Hz: %.1f ns per frame\n", rate,
+             (double)NS_FROM_VLC_TICK(elapsed) / frames);
+
+    /* Every section ends up at the target, once the gain settled */
+    const size_t settled = 12 * rate;
+    for (unsigned s = 0; s < 3; s++)
+    {
+        r128_meter_t meter;
+        double loudness[2];
+
+        for (unsigned pass = 0; pass < 2; pass++)
+        {
+            const float *buf = pass ? out : in;
+
+            assert(r128_MeterInit(&meter, rate, CHANNELS, stereo, 200)
+                   == VLC_SUCCESS);
+            Measure(&meter, buf + (s * section + settled) * CHANNELS,
+                    section - settled);
+            loudness[pass] = r128_Gated(&meter);
+            r128_MeterClean(&meter);
+        }
+
+        test_log("section %u: %.1f LUFS in, %.1f LUFS out\n", s + 1,
+                 loudness[0], loudness[1]);
+        assert(fabs(loudness[1] - TARGET) <= 1.);
+    }
+
+    const double tp = 20. * log10(TruePeak(rate, out, frames));
+    const double tp_in = 20. * log10(TruePeak(rate, in, frames));
+    test_log("true peak: %.2f dBTP in, %.2f dBTP out\n", tp_in, tp);
+    assert(tp <= CEILING + .1);
+
+    DeleteFilter(filter);
+    free(out);
+    free(in);
+}
+
+int main(void)
+{
+    test_init();
+
+    TestKernels();
+    TestMeter(48000);
+    TestMeter(44100);
+    TestMeter(96000);
+
+    libvlc_instance_t *vlc = libvlc_new(test_defaults_nargs,
+                                        test_defaults_args);
+    assert(vlc != NULL);
+    TestNormalize(VLC_OBJECT(vlc->p_libvlc_int), 48000);
+    TestNormalize(VLC_OBJECT(vlc->p_libvlc_int), 44100);
+    libvlc_release(vlc);
+    return 0;
+}
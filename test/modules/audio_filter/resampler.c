@@ -0,0 +1,439 @@
+/*****************************************************************************
+ * resampler.c: polyphase resampler test, resamplers quality and benchmark
+ *****************************************************************************
+ * Copyright (C) 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <limits.h>
+#include <math.h>
+
+#include <vlc/vlc.h>
+
+#include "../../../lib/libvlc_internal.h"
+
+#include <vlc_common.h>
+#include <vlc_modules.h>
+#include <vlc_aout.h>
+#include <vlc_filter.h>
+#include <vlc_block.h>
+#include <vlc_tick.h>
+
+#include "../../../modules/audio_filter/resampler/polyphase_fir.h"
+
+#include "../../libvlc/test.h"
+#include "../random.h"
+
+#define CHANNELS 2
+#define BLOCK_FRAMES 1024
+
+/* Resamplers to compare, not all of them are always built */
+static const char *const modules[] = {
+    "polyphase", "soxr", "samplerate", "speex_resampler",
+    "bandlimited_resampler", "ugly_resampler",
+};
+
+/* Compares the vectorized filter with the reference one */
+static void TestKernel(void)
+{
+    static const double ratios[] = { 48000. / 44100., 44100. / 48000., .25 };
+    static const unsigned channel_counts[] = { 1, 2, 6, 8 };
+    const unsigned frames = 4096, count = 61;
+    unsigned checks = 0;
+
+    for (size_t r = 0; r < ARRAY_SIZE(ratios); r++)
+    {
+        polyphase_table_t table;
+        int ret = polyphase_TableInit(&table, 32, ratios[r], 48, 90.);
+        assert(ret == VLC_SUCCESS);
+        assert(table.taps % POLYPHASE_TAPS_ALIGN == 0);
+
+        /* Every phase has unity gain at DC */
+        for (unsigned p = 0; p <= table.phases; p++)
+        {
+            const float *row = polyphase_TableRow(&table, p);
+            double sum = 0.;
+
+            for (unsigned k = 0; k < table.taps; k++)
+                sum += row[k];
+            assert(fabs(sum - 1.) < 1e-5);
+        }
+
+        float *scratch = aligned_alloc(64, table.taps * sizeof (float));
+        assert(scratch != NULL);
+
+        for (size_t i = 0; i < ARRAY_SIZE(channel_counts); i++)
+        {
+            const unsigned channels = channel_counts[i];
+            float *buf = vlc_alloc(channels * frames, sizeof (float));
+            float *ref = vlc_alloc(channels * count, sizeof (float));
+            float *out = vlc_alloc(channels * count, sizeof (float));
+            assert(buf != NULL && ref != NULL && out != NULL);
+
+            const float *in[8];
+            for (unsigned c = 0; c < channels; c++)
+            {
+                for (unsigned j = 0; j < frames; j++)
+                    buf[c * frames + j] = RandomFloat();
+                in[c] = &buf[c * frames];
+            }
+
+            /* Fixed and interpolated phases, at unaligned offsets */
+            polyphase_point_t points[61];
+            for (unsigned j = 0; j < count; j++)
+            {
+                const unsigned phase = (j * 7) % table.phases;
+
+                points[j].row = polyphase_TableRow(&table, phase);
+                points[j].next = j % 2 ? points[j].row + table.taps : NULL;
+                points[j].frac = j % 2 ? (j % 13) / 13.f : 0.f;
+                points[j].offset = (j * 37) % (frames - table.taps + 1);
+            }
+
+            polyphase_Filter_C(ref, channels, in, points, count, table.taps,
+                               scratch);
+            polyphase_Filter(out, channels, in, points, count, table.taps,
+                             scratch);
+
+            for (unsigned s = 0; s < channels * count; s++)
+            {
+                if (fabsf(out[s] - ref[s]) > 1e-5f)
+                    test_log("ratio %.3f, %u channels, sample %u: %g "
+                             "instead of %g\n", ratios[r], channels, s,
+                             out[s], ref[s]);
+                assert(fabsf(out[s] - ref[s]) <= 1e-5f);
+                checks++;
+            }
+            free(out);
+            free(ref);
+            free(buf);
+        }
+        aligned_free(scratch);
+        polyphase_TableClean(&table);
+    }
+    test_log("%u vectorized samples match\n", checks);
+}
+
+static filter_t *CreateResampler(vlc_object_t *parent, const char *name,
+                                 unsigned in_rate, unsigned out_rate)
+{
+    filter_t *filter = vlc_object_create(parent, sizeof (*filter));
+    assert(filter != NULL);
+
+    es_format_Init(&filter->fmt_in, AUDIO_ES, VLC_CODEC_FL32);
+    filter->fmt_in.audio.i_format = VLC_CODEC_FL32;
+    filter->fmt_in.audio.i_rate = in_rate;
+    filter->fmt_in.audio.i_physical_channels = AOUT_CHANS_STEREO;
+    aout_FormatPrepare(&filter->fmt_in.audio);
+    es_format_Copy(&filter->fmt_out, &filter->fmt_in);
+    filter->fmt_out.audio.i_rate = out_rate;
+
+    filter->p_module = module_need(filter, "audio resampler", name, true);
+    if (filter->p_module == NULL)
+    {
+        es_format_Clean(&filter->fmt_in);
+        es_format_Clean(&filter->fmt_out);
+        vlc_object_delete(filter);
+        return NULL;
+    }
+    return filter;
+}
+
+static void DeleteResampler(filter_t *filter)
+{
+    filter_Close(filter);
+    module_unneed(filter, filter->p_module);
+    es_format_Clean(&filter->fmt_in);
+    es_format_Clean(&filter->fmt_out);
+    vlc_object_delete(filter);
+}
+
+/* Output of the resampler, first channel only */
+struct output
+{
+    float *samples;
+    size_t frames;
+    size_t size;
+};
+
+static void Collect(struct output *output, block_t *block)
+{
+    if (block == NULL)
+        return;
+
+    const float *src = (const float *)block->p_buffer;
+    for (unsigned j = 0; j < block->i_nb_samples; j++)
+    {
+        if (output->frames == output->size)
+        {
+            output->size = output->size ? 2 * output->size : 65536;
+            output->samples = realloc(output->samples,
+                                      output->size * sizeof (float));
+            assert(output->samples != NULL);
+        }
+        output->samples[output->frames++] = src[j * CHANNELS];
+    }
+    block_Release(block);
+}
+
+/* Feeds blocks of a sine, the input rate changes from the block change on.
+ * Returns the processing time. */
+static vlc_tick_t Run(filter_t *filter, double freq, unsigned blocks,
+                      unsigned change, unsigned changed_rate,
+                      struct output *output)
+{
+    const unsigned rate = filter->fmt_in.audio.i_rate;
+    vlc_tick_t elapsed = 0;
+
+    for (unsigned b = 0; b < blocks; b++)
+    {
+        block_t *in = block_Alloc(BLOCK_FRAMES * CHANNELS * sizeof (float));
+        assert(in != NULL);
+
+        float *dst = (float *)in->p_buffer;
+        for (unsigned j = 0; j < BLOCK_FRAMES; j++)
+        {
+            const float v = .5 * sin(2. * M_PI * freq
+                                     * (b * BLOCK_FRAMES + j) / rate);
+            for (unsigned c = 0; c < CHANNELS; c++)
+                *(dst++) = v;
+        }
+        in->i_nb_samples = BLOCK_FRAMES;
+        in->i_pts = in->i_dts = VLC_TICK_0 +
+            vlc_tick_from_samples(b * BLOCK_FRAMES, rate);
+
+        /* The audio output adjusts the input rate around each block */
+        const bool changed = b >= change;
+        if (changed)
+            filter->fmt_in.audio.i_rate = changed_rate;
+
+        vlc_tick_t start = vlc_tick_now();
+        block_t *out = filter->ops->filter_audio(filter, in);
+        elapsed += vlc_tick_now() - start;
+
+        if (changed)
+            filter->fmt_in.audio.i_rate = rate;
+        Collect(output, out);
+    }
+
+    if (filter->ops->drain_audio != NULL)
+    {
+        if (blocks > change)
+            filter->fmt_in.audio.i_rate = changed_rate;
+        Collect(output, filter->ops->drain_audio(filter));
+        filter->fmt_in.audio.i_rate = rate;
+    }
+    return elapsed;
+}
+
+/* Signal to noise and distortion ratio (dB) of a sine of known frequency,
+ * fitting its amplitude and phase */
+static double Measure(const float *samples, size_t frames, double freq,
+                      unsigned rate)
+{
+    const double w = 2. * M_PI * freq / rate;
+    double cc = 0., ss = 0., cs = 0., cy = 0., sy = 0., yy = 0.;
+
+    for (size_t n = 0; n < frames; n++)
+    {
+        const double c = cos(w * n), s = sin(w * n), y = samples[n];
+
+        cc += c * c;
+        ss += s * s;
+        cs += c * s;
+        cy += c * y;
+        sy += s * y;
+        yy += y * y;
+    }
+
+    const double det = cc * ss - cs * cs;
+    const double a = (cy * ss - sy * cs) / det;
+    const double b = (sy * cc - cy * cs) / det;
+    const double signal = a * cy + b * sy;
+    const double noise = yy - signal;
+
+    return 10. * log10(signal / (noise > 1e-30 ? noise : 1e-30));
+}
+
+static double Level(const float *samples, size_t frames)
+{
+    double sum = 0.;
+
+    for (size_t n = 0; n < frames; n++)
+        sum += samples[n] * samples[n];
+    return 10. * log10(sum / frames / .125 + 1e-30);
+}
+
+static void TestQuality(vlc_object_t *parent)
+{
+    static const struct
+    {
+        unsigned in_rate, out_rate;
+        double freq;
+        bool alias;     /* the tone cannot be represented at the output */
+    } cases[] = {
+        { 44100, 48000,  1000., false },
+        { 44100, 48000, 15000., false },
+        { 48000, 44100,  1000., false },
+        { 48000, 44100, 15000., false },
+        { 48000, 44100, 23000., true },
+        { 22050, 48000,  8000., false },
+        { 96000, 44100, 30000., true },
+    };
+
+    for (size_t m = 0; m < ARRAY_SIZE(modules); m++)
+    {
+        for (size_t i = 0; i < ARRAY_SIZE(cases); i++)
+        {
+            const unsigned in_rate = cases[i].in_rate;
+            const unsigned out_rate = cases[i].out_rate;
+            filter_t *filter = CreateResampler(parent, modules[m], in_rate,
+                                               out_rate);
+            if (filter == NULL)
+            {
+                test_log("%s not available\n", modules[m]);
+                break;
+            }
+
+            struct output output = { NULL, 0, 0 };
+            const unsigned blocks = in_rate / BLOCK_FRAMES;
+            const unsigned frames = blocks * BLOCK_FRAMES;
+            vlc_tick_t elapsed = Run(filter, cases[i].freq, blocks, UINT_MAX,
+                                     in_rate, &output);
+
+            /* Skip the start and the end of the stream */
+            const size_t margin = out_rate / 10;
+            const size_t expected = (size_t)frames * out_rate / in_rate;
+            assert(output.frames > expected - margin);
+            assert(output.frames < expected + margin);
+
+            const float *samples = &output.samples[margin];
+            const size_t count = output.frames - 2 * margin;
+            const double ns = (double)NS_FROM_VLC_TICK(elapsed)
+                            / output.frames;
+
+            if (cases[i].alias)
+            {
+                const double level = Level(samples, count);
+
+                test_log("%s %u -> %u Hz, %.0f Hz: aliasing %.1f dB, "
+                         "%.1f ns/frame\n", modules[m], in_rate, out_rate,
+                         cases[i].freq, level, ns);
+                if (!strcmp(modules[m], "polyphase"))
+                    assert(level < -90.);
+            }
+            else
+            {
+                const double snr = Measure(samples, count, cases[i].freq,
+                                           out_rate);
+
+                test_log("%s %u -> %u Hz, %.0f Hz: SINAD %.1f dB, "
+                         "%.1f ns/frame\n", modules[m], in_rate, out_rate,
+                         cases[i].freq, snr, ns);
+                if (!strcmp(modules[m], "polyphase"))
+                    assert(snr > 90.);
+            }
+            free(output.samples);
+            DeleteResampler(filter);
+        }
+    }
+}
+
+/* Clock drift correction and the playback rate change the input rate on the
+ * fly, including when the nominal rates are the same */
+static void TestDrift(vlc_object_t *parent)
+{
+    static const struct
+    {
+        unsigned in_rate, out_rate;
+        int adjust;
+    } cases[] = {
+        { 44100, 48000, 0 },
+        { 44100, 48000, 30 },
+        { 44100, 48000, -30 },
+        { 44100, 48000, 441 },
+        { 44100, 48000, 3 * 44100 }, /* playback rate */
+        { 48000, 48000, 0 },
+        { 48000, 48000, 48 },
+        { 48000, 48000, -48 },
+    };
+    const double freq = 1000.;
+
+    for (size_t i = 0; i < ARRAY_SIZE(cases); i++)
+    {
+        const unsigned in_rate = cases[i].in_rate;
+        const unsigned out_rate = cases[i].out_rate;
+        filter_t *filter = CreateResampler(parent, "polyphase", in_rate,
+                                           out_rate);
+        if (filter == NULL)
+        {
+            test_log("polyphase not available, skipping the drift test\n");
+            return;
+        }
+
+        /* Half a second at the nominal rate, then one second adjusted */
+        const unsigned change = in_rate / 2 / BLOCK_FRAMES;
+        const unsigned blocks = 3 * change;
+        const unsigned changed_rate = in_rate + cases[i].adjust;
+        struct output output = { NULL, 0, 0 };
+
+        Run(filter, freq, blocks, change, changed_rate, &output);
+
+        const double before = change * BLOCK_FRAMES;
+        const double after = (blocks - change) * BLOCK_FRAMES;
+        const double expected = before * out_rate / in_rate
+                              + after * out_rate / changed_rate;
+        test_log("%u -> %u Hz, input rate %u Hz: %zu frames out "
+                 "(expected %.0f)\n", in_rate, out_rate, changed_rate,
+                 output.frames, expected);
+        /* The frames queued in the filter at the change, up to half its
+         * length, are resampled at the new rate */
+        const double queued = 64. * fabs((double)out_rate / in_rate
+                                         - (double)out_rate / changed_rate);
+        assert(fabs(output.frames - expected) < 2. + queued);
+
+        /* The tone is played faster or slower after the change */
+        const size_t start = before * out_rate / in_rate + out_rate / 10;
+        const size_t count = after * out_rate / changed_rate / 2;
+        assert(start + count < output.frames);
+        const double snr = Measure(&output.samples[start], count,
+                                   freq * changed_rate / in_rate, out_rate);
+        test_log("%u -> %u Hz, input rate %u Hz: SINAD %.1f dB\n",
+                 in_rate, out_rate, changed_rate, snr);
+        assert(snr > 90.);
+
+        free(output.samples);
+        DeleteResampler(filter);
+    }
+}
+
+int main(void)
+{
+    test_init();
+
+    TestKernel();
+
+    libvlc_instance_t *vlc = libvlc_new(test_defaults_nargs,
+                                        test_defaults_args);
+    assert(vlc != NULL);
+    TestQuality(VLC_OBJECT(vlc->p_libvlc_int));
+    TestDrift(VLC_OBJECT(vlc->p_libvlc_int));
+    libvlc_release(vlc);
+    return 0;
+}
@@ -0,0 +1,283 @@
+/*****************************************************************************
+ * scaletempo.c: scaletempo overlap search test and benchmark
+ *****************************************************************************
+ * Copyright (C) 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <math.h>
+
+#include <vlc/vlc.h>
+
+#include "../../../lib/libvlc_internal.h"
+
+#include <vlc_common.h>
+#include <vlc_modules.h>
+#include <vlc_aout.h>
+#include <vlc_filter.h>
+#include <vlc_block.h>
+#include <vlc_tick.h>
+
+#include "../../../modules/audio_filter/scaletempo_search.h"
+
+#include "../../libvlc/test.h"
+#include "../random.h"
+
+/* Default scaletempo parameters: 30 ms stride, 20% overlap, 14 ms search */
+#define STRIDE_MS  30
+#define OVERLAP    .20
+#define SEARCH_MS  14
+
+static const unsigned channel_counts[] = { 1, 2, 6, 8 };
+static const unsigned sample_rates[] = { 44100, 48000, 96000 };
+static const double tempos[] = { .5, .75, 1.5, 2. };
+
+enum signal
+{
+    SIGNAL_TONES,
+    SIGNAL_NOISE,
+    SIGNAL_PERIODIC,  /* repeats exactly: equal correlations */
+    SIGNAL_QUANTIZED, /* 8-bit steps: many equal products */
+    SIGNAL_QUIET,     /* tones at -120 dB */
+    SIGNAL_COUNT,
+};
+
+static float Sample(enum signal signal, unsigned channel, unsigned frame,
+                    unsigned rate)
+{
+    const double t = (double)frame / rate;
+
+    switch (signal)
+    {
+        case SIGNAL_TONES:
+            return .5 * sin(2 * M_PI * (220. * (channel + 1)) * t)
+                 + .25 * sin(2 * M_PI * 1234.5 * t + channel);
+        case SIGNAL_NOISE:
+            return RandomFloat();
+        case SIGNAL_PERIODIC:
+            return ((frame % 40) - 20) / 20.f * (channel % 2 ? -1.f : 1.f);
+        case SIGNAL_QUANTIZED:
+            return roundf(127.f * sinf(2 * M_PI * 440. * t + channel)) / 128.f;
+        case SIGNAL_QUIET:
+            return 1e-6 * sin(2 * M_PI * 330. * t + channel);
+        default:
+            vlc_assert_unreachable();
+    }
+}
+
+static float *Generate(enum signal signal, unsigned channels, unsigned frames,
+                       unsigned rate)
+{
+    float *buf = vlc_alloc(frames * channels, sizeof (*buf));
+    assert(buf != NULL);
+
+    for (unsigned i = 0; i < frames; i++)
+        for (unsigned c = 0; c < channels; c++)
+            buf[i * channels + c] = Sample(signal, c, i, rate);
+    return buf;
+}
+
+/* Windowed overlap, as built by the filter */
+static float *PreCorr(const float *overlap, unsigned channels,
+                      unsigned frames_overlap)
+{
+    float *pre = vlc_alloc((frames_overlap - 1) * channels, sizeof (*pre));
+    assert(pre != NULL);
+
+    for (unsigned i = 1; i < frames_overlap; i++)
+        for (unsigned c = 0; c < channels; c++)
+            pre[(i - 1) * channels + c] = (float)(i * (frames_overlap - i))
+                                        * overlap[i * channels + c];
+    return pre;
+}
+
+/* The vectorized search must pick the same offsets as the sample order one */
+static void TestSelection(void)
+{
+    unsigned searches = 0;
+
+    for (size_t r = 0; r < ARRAY_SIZE(sample_rates); r++)
+        for (size_t c = 0; c < ARRAY_SIZE(channel_counts); c++)
+            for (int signal = 0; signal < SIGNAL_COUNT; signal++)
+            {
+                const unsigned rate = sample_rates[r];
+                const unsigned channels = channel_counts[c];
+                const unsigned frames_overlap = STRIDE_MS * rate / 1000 * OVERLAP;
+                const unsigned frames_search = SEARCH_MS * rate / 1000;
+                const unsigned frames = rate / 2;
+
+                float *buf = Generate(signal, channels, frames, rate);
+                float *corr = vlc_alloc(frames_search, sizeof (*corr));
+                assert(corr != NULL);
+
+                for (unsigned pos = 0;
+                     pos + frames_overlap + frames_search + frames_overlap < frames;
+                     pos += 3989)
+                {
+                    const float *overlap = &buf[pos * channels];
+                    const float *search =
+                        &buf[(pos + frames_overlap + 1) * channels];
+                    float *pre = PreCorr(overlap, channels, frames_overlap);
+                    const unsigned samples = (frames_overlap - 1) * channels;
+
+                    unsigned ref = scaletempo_BestOffset_C(pre, search, samples,
+                                                           channels,
+                                                           frames_search);
+                    unsigned off = scaletempo_BestOffset(pre, search, samples,
+                                                         channels,
+                                                         frames_search, corr);
+                    if (off != ref)
+                        test_log("signal %d, %u Hz, %u channels, position %u: "
+                                 "offset %u instead of %u\n", signal, rate,
+                                 channels, pos, off, ref);
+                    assert(off == ref);
+                    free(pre);
+                    searches++;
+                }
+                free(corr);
+                free(buf);
+            }
+
+    test_log("%u searches with identical offsets\n", searches);
+}
+
+static void BenchSearch(void)
+{
+    const unsigned rate = 48000, channels = 8;
+    const unsigned frames_overlap = STRIDE_MS * rate / 1000 * OVERLAP;
+    const unsigned frames_search = SEARCH_MS * rate / 1000;
+    const unsigned samples = (frames_overlap - 1) * channels;
+    const unsigned runs = 200;
+
+    float *buf = Generate(SIGNAL_TONES, channels,
+                          2 * frames_overlap + frames_search + 1, rate);
+    float *pre = PreCorr(buf, channels, frames_overlap);
+    float *corr = vlc_alloc(frames_search, sizeof (*corr));
+    assert(corr != NULL);
+    const float *search = &buf[(frames_overlap + 1) * channels];
+
+    vlc_tick_t start = vlc_tick_now();
+    for (unsigned i = 0; i < runs; i++)
+        scaletempo_BestOffset_C(pre, search, samples, channels, frames_search);
+    vlc_tick_t ref = vlc_tick_now() - start;
+
+    start = vlc_tick_now();
+    for (unsigned i = 0; i < runs; i++)
+        scaletempo_BestOffset(pre, search, samples, channels, frames_search,
+                              corr);
+    vlc_tick_t fast = vlc_tick_now() - start;
+
+    test_log("7.1 48 kHz search: %.1f us sample order, %.1f us vectorized "
+             "(x%.1f)\n", (double)ref / runs, (double)fast / runs,
+             (double)ref / (fast ? fast : 1));
+    free(corr);
+    free(pre);
+    free(buf);
+}
+
+/* Runs the whole filter at several tempos */
+static void TestFilter(vlc_object_t *parent)
+{
+    const unsigned rate = 48000, channels = 8;
+    const unsigned block_frames = 1024, blocks = 200;
+
+    float *buf = Generate(SIGNAL_TONES, channels, block_frames * blocks, rate);
+
+    for (size_t i = 0; i < ARRAY_SIZE(tempos); i++)
+    {
+        filter_t *filter = vlc_object_create(parent, sizeof (*filter));
+        assert(filter != NULL);
+
+        es_format_Init(&filter->fmt_in, AUDIO_ES, VLC_CODEC_FL32);
+        filter->fmt_in.audio.i_format = VLC_CODEC_FL32;
+        filter->fmt_in.audio.i_rate = rate;
+        filter->fmt_in.audio.i_physical_channels = AOUT_CHANS_7_1;
+        aout_FormatPrepare(&filter->fmt_in.audio);
+        es_format_Copy(&filter->fmt_out, &filter->fmt_in);
+
+        filter->p_module = module_need(filter, "audio filter", "scaletempo",
+                                       true);
+        if (filter->p_module == NULL)
+        {
+            test_log("scaletempo not available, skipping the filter test\n");
+            es_format_Clean(&filter->fmt_in);
+            es_format_Clean(&filter->fmt_out);
+            vlc_object_delete(filter);
+            break;
+        }
+
+        /* The audio output changes the input rate to change the tempo */
+        filter->fmt_in.audio.i_rate = lround(rate * tempos[i]);
+
+        size_t frames_out = 0;
+        vlc_tick_t start = vlc_tick_now();
+        for (unsigned b = 0; b < blocks; b++)
+        {
+            block_t *in = block_Alloc(block_frames * channels * sizeof (float));
+            assert(in != NULL);
+            memcpy(in->p_buffer, &buf[b * block_frames * channels],
+                   in->i_buffer);
+            in->i_nb_samples = block_frames;
+            in->i_pts = in->i_dts = VLC_TICK_0 +
+                vlc_tick_from_samples(b * block_frames, rate);
+
+            block_t *out = filter->ops->filter_audio(filter, in);
+            if (out != NULL)
+            {
+                for (size_t s = 0; s < out->i_buffer / sizeof (float); s++)
+                    assert(isfinite(((const float *)out->p_buffer)[s]));
+                frames_out += out->i_nb_samples;
+                block_Release(out);
+            }
+        }
+        vlc_tick_t elapsed = vlc_tick_now() - start;
+
+        /* Output duration is the input one divided by the tempo, but for
+         * the queued strides */
+        const double expected = block_frames * blocks / tempos[i];
+        test_log("7.1 at x%.2f: %zu frames out of %u (expected %.0f), "
+                 "%.0fx real time\n", tempos[i], frames_out,
+                 block_frames * blocks, expected,
+                 (double)(block_frames * blocks) / rate * CLOCK_FREQ
+                 / (elapsed ? elapsed : 1));
+        assert(fabs(frames_out - expected) < .1 * expected);
+
+        filter_Close(filter);
+        module_unneed(filter, filter->p_module);
+        es_format_Clean(&filter->fmt_in);
+        es_format_Clean(&filter->fmt_out);
+        vlc_object_delete(filter);
+    }
+    free(buf);
+}
+
+int main(void)
+{
+    test_init();
+
+    TestSelection();
+    BenchSearch();
+
+    libvlc_instance_t *vlc = libvlc_new(test_defaults_nargs,
+                                        test_defaults_args);
+    assert(vlc != NULL);
+    TestFilter(VLC_OBJECT(vlc->p_libvlc_int));
+    libvlc_release(vlc);
+    return 0;
+}
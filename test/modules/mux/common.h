@@ -0,0 +1,60 @@
+/*****************************************************************************
+ * common.h: muxer tests helpers
+ *****************************************************************************
+ * Copyright (C) 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+#include <vlc_tick.h>
+
+#include "../random.h"
+
+/* A frame of random data */
+static block_t *Frame(size_t size, vlc_tick_t dts, vlc_tick_t length)
+{
+    block_t *block = block_Alloc(size);
+    assert(block != NULL);
+
+    for (size_t i = 0; i < size; i++)
+        block->p_buffer[i] = RandomByte();
+    block->i_dts = block->i_pts = dts;
+    block->i_length = length;
+    return block;
+}
+
+/* Reads the whole output of a muxer, and removes it */
+static uint8_t *ReadFile(const char *path, size_t *size)
+{
+    FILE *file = fopen(path, "rb");
+    assert(file != NULL);
+
+    struct stat st;
+    assert(fstat(fileno(file), &st) == 0);
+    uint8_t *buf = malloc(st.st_size);
+    assert(buf != NULL);
+    assert(fread(buf, st.st_size, 1, file) == 1);
+    fclose(file);
+    unlink(path);
+    *size = st.st_size;
+    return buf;
+}
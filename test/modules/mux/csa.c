@@ -0,0 +1,217 @@
+/*****************************************************************************
+ * csa.c: CSA scrambler/descrambler test
+ *****************************************************************************
+ * Copyright (C) 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <vlc/vlc.h>
+
+#include "../../../lib/libvlc_internal.h"
+
+#include <vlc_common.h>
+#include <vlc_tick.h>
+
+#include "../../../modules/mux/mpeg/csa.h"
+
+#include "../../libvlc/test.h"
+#include "../random.h"
+
+#define COUNT 600
+
+static void PacketInit(uint8_t *pkt, unsigned i, uint8_t flags)
+{
+    pkt[0] = 0x47;
+    pkt[1] = 0x01;
+    pkt[2] = 0x00;
+    pkt[3] = flags | (i & 0xf);
+    for (unsigned k = 4; k < 188; k++)
+        pkt[k] = RandomByte();
+}
+
+/* Payload of a packet scrambled by the byte-oriented implementation */
+static const char kat_key[] = "0x0123456789abcdef";
+static const uint8_t kat_payload[184] = {
+    0x12, 0x7d, 0xeb, 0x94, 0xac, 0x72, 0xa4, 0x53, 0x85, 0x44, 0x40, 0x3f,
+    0x37, 0x0a, 0x8c, 0x79, 0x54, 0x68, 0x5e, 0xf1, 0xc5, 0x2f, 0x5f, 0x70,
+    0x9c, 0xc5, 0xa8, 0xb9, 0x58, 0x1a, 0x4b, 0xec, 0x4b, 0xd0, 0x14, 0x8e,
+    0x65, 0x65, 0x04, 0xdd, 0xf8, 0x2b, 0x9b, 0xe1, 0x8e, 0xa8, 0xcd, 0x9d,
+    0x49, 0xce, 0xbf, 0xca, 0x0f, 0x32, 0xd5, 0x4b, 0x40, 0xb1, 0x6f, 0xfb,
+    0x50, 0x9c, 0x2f, 0x04, 0x48, 0x09, 0xb9, 0x77, 0x8d, 0x14, 0xf1, 0x0a,
+    0x2a, 0xfb, 0x33, 0x85, 0x92, 0x28, 0x0a, 0xfa, 0x1d, 0x08, 0x0e, 0x63,
+    0x49, 0x49, 0x16, 0xdc, 0x59, 0x61, 0x9c, 0xb4, 0x23, 0xbb, 0xfb, 0xcd,
+    0x3f, 0xb0, 0x56, 0xa9, 0x8f, 0x4e, 0x52, 0xd7, 0x6d, 0x7d, 0x45, 0xb5,
+    0x75, 0x3e, 0xa7, 0x1d, 0x80, 0x2a, 0x8c, 0xb3, 0x67, 0xb1, 0x03, 0x2f,
+    0x1b, 0x21, 0xd9, 0xbb, 0xb7, 0x58, 0x0c, 0x6d, 0x9d, 0xa7, 0x4f, 0xc0,
+    0x82, 0x0f, 0xfc, 0x9e, 0xed, 0x91, 0xf0, 0x7d, 0xea, 0x04, 0x06, 0x35,
+    0x7b, 0xc5, 0x2c, 0xc4, 0x7d, 0x62, 0x39, 0x36, 0x25, 0x0e, 0x69, 0x31,
+    0x17, 0xc6, 0x89, 0x16, 0xc6, 0x5b, 0xe8, 0x26, 0x1c, 0xb4, 0x8b, 0x54,
+    0x42, 0x36, 0x02, 0xeb, 0x1c, 0x52, 0x08, 0x83, 0x7e, 0x9b, 0x93, 0x0c,
+    0xdf, 0x61, 0x9f, 0x47
+};
+
+static void TestKnownAnswer(vlc_object_t *obj)
+{
+    csa_t *csa = csa_New();
+    uint8_t pkts[CSA_BATCH_MAX][188], *ptrs[CSA_BATCH_MAX];
+
+    assert(csa != NULL);
+    assert(csa_SetCW(obj, csa, kat_key, true) == VLC_SUCCESS);
+    assert(csa_SetCW(obj, csa, kat_key, false) == VLC_SUCCESS);
+    assert(csa_UseKey(obj, csa, true) == VLC_SUCCESS);
+
+    for (unsigned count = 1; count <= CSA_BATCH_MAX; count *= 4)
+    {
+        for (unsigned i = 0; i < count; i++)
+        {
+            pkts[i][0] = 0x47;
+            pkts[i][1] = pkts[i][2] = 0x00;
+            pkts[i][3] = 0x10;
+            for (unsigned k = 4; k < 188; k++)
+                pkts[i][k] = k - 4;
+            ptrs[i] = pkts[i];
+        }
+
+        csa_EncryptBatch(csa, ptrs, count, 188);
+        for (unsigned i = 0; i < count; i++)
+        {
+            assert(pkts[i][3] == 0xd0);
+            assert(!memcmp(pkts[i] + 4, kat_payload, sizeof (kat_payload)));
+        }
+
+        csa_DecryptBatch(csa, ptrs, count, 188);
+        for (unsigned i = 0; i < count; i++)
+        {
+            assert(pkts[i][3] == 0x10);
+            for (unsigned k = 4; k < 188; k++)
+                assert(pkts[i][k] == k - 4);
+        }
+    }
+    csa_Delete(csa);
+}
+
+/* Compares the batches with the byte-oriented implementation */
+static void TestBatch(vlc_object_t *obj, unsigned count, int size)
+{
+    static uint8_t ref[COUNT][188], pkts[COUNT][188], clear[COUNT][188];
+    uint8_t *ptrs[COUNT];
+    csa_t *csa = csa_New();
+
+    assert(csa != NULL && count <= COUNT);
+    assert(csa_SetCW(obj, csa, "0x1122334455667788", true) == VLC_SUCCESS);
+    assert(csa_SetCW(obj, csa, "8877665544332211", false) == VLC_SUCCESS);
+
+    for (unsigned i = 0; i < count; i++)
+    {
+        /* With an adaptation field every other packet */
+        PacketInit(clear[i], i, (i & 1) ? 0x30 : 0x10);
+        if (i & 1)
+            clear[i][4] = RandomByte() % ((i & 2) ? 184 : 255);
+        ptrs[i] = pkts[i];
+    }
+
+    for (unsigned odd = 0; odd < 2; odd++)
+    {
+        assert(csa_UseKey(obj, csa, odd) == VLC_SUCCESS);
+        memcpy(ref, clear, sizeof (ref));
+        memcpy(pkts, clear, sizeof (pkts));
+        for (unsigned i = 0; i < count; i++)
+            csa_Encrypt(csa, ref[i], size);
+        csa_EncryptBatch(csa, ptrs, count, size);
+        assert(!memcmp(pkts, ref, count * 188));
+    }
+
+    /* Mixed keys, and some packets not scrambled */
+    for (unsigned i = 0; i < count; i++)
+    {
+        if (RandomByte() & 1)
+            pkts[i][3] ^= 0x40;
+        if (RandomByte() % 8 == 0)
+            pkts[i][3] &= 0x3f;
+    }
+    memcpy(ref, pkts, sizeof (ref));
+    for (unsigned i = 0; i < count; i++)
+        csa_Decrypt(csa, ref[i], size);
+    csa_DecryptBatch(csa, ptrs, count, size);
+    assert(!memcmp(pkts, ref, count * 188));
+
+    csa_Delete(csa);
+}
+
+static void Benchmark(vlc_object_t *obj, unsigned count)
+{
+    static uint8_t pkts[CSA_BATCH_MAX][188];
+    uint8_t *ptrs[CSA_BATCH_MAX];
+    const unsigned total = 4096;
+    csa_t *csa = csa_New();
+
+    assert(csa != NULL && count <= CSA_BATCH_MAX);
+    assert(csa_SetCW(obj, csa, "0x1122334455667788", true) == VLC_SUCCESS);
+    assert(csa_UseKey(obj, csa, true) == VLC_SUCCESS);
+    for (unsigned i = 0; i < count; i++)
+    {
+        PacketInit(pkts[i], i, 0x10);
+        ptrs[i] = pkts[i];
+    }
+
+    vlc_tick_t begin = vlc_tick_now();
+    for (unsigned done = 0; done < total; done += count)
+        for (unsigned i = 0; i < count; i++)
+            csa_Encrypt(csa, pkts[i], 188);
+    vlc_tick_t single = vlc_tick_now() - begin;
+
+    begin = vlc_tick_now();
+    for (unsigned done = 0; done < total; done += count)
+        csa_EncryptBatch(csa, ptrs, count, 188);
+    vlc_tick_t batch = vlc_tick_now() - begin;
+
+    test_log("%u packets batches: %.1f Mbit/s, %.1f Mbit/s one by one\n",
+             count, total * 188 * 8. / US_FROM_VLC_TICK(batch),
+             total * 188 * 8. / US_FROM_VLC_TICK(single));
+    csa_Delete(csa);
+}
+
+int main(void)
+{
+    test_init();
+
+    libvlc_instance_t *vlc = libvlc_new(test_defaults_nargs,
+                                        test_defaults_args);
+    assert(vlc != NULL);
+
+    vlc_object_t *obj = VLC_OBJECT(vlc->p_libvlc_int);
+    TestKnownAnswer(obj);
+
+    static const unsigned counts[] = {
+        1, 7, 8, 33, 64, 65, 100, 128, 129, 200, 256, 300, COUNT,
+    };
+    for (size_t i = 0; i < ARRAY_SIZE(counts); i++)
+    {
+        TestBatch(obj, counts[i], 188);
+        TestBatch(obj, counts[i], 100 + i);
+    }
+    TestBatch(obj, 64, 12);
+
+    Benchmark(obj, 8);
+    Benchmark(obj, 64);
+    Benchmark(obj, CSA_BATCH_MAX);
+
+    libvlc_release(vlc);
+    return 0;
+}
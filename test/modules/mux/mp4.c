@@ -0,0 +1,265 @@
+/*****************************************************************************
+ * mp4.c: fragmented MP4 muxer test
+ *****************************************************************************
+ * Copyright (C) 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <vlc/vlc.h>
+
+#include "../../../lib/libvlc_internal.h"
+
+#include <vlc_common.h>
+#include <vlc_sout.h>
+#include <vlc_block.h>
+#include <vlc_es.h>
+#include <vlc_tick.h>
+
+#include "../../libvlc/test.h"
+#include "common.h"
+
+/* 4 seconds of a 25 frames per second video with a key frame every 36
+ * frames, and of a 48 kHz AAC like audio */
+#define FRAMES 100
+#define FRAME_PERIOD VLC_TICK_FROM_MS(40)
+#define GOP 36
+#define AUDIO_RATE 48000
+#define AUDIO_SAMPLES 1024
+
+static uint32_t U32(const uint8_t *p)
+{
+    return ((uint32_t)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+static uint64_t U64(const uint8_t *p)
+{
+    return ((uint64_t)U32(p) << 32) | U32(p + 4);
+}
+
+/* Finds the first child box of the given type */
+static const uint8_t *Box(const uint8_t *p, const uint8_t *end,
+                          const char *type, const uint8_t **box_end)
+{
+    while (end - p >= 8)
+    {
+        const uint32_t size = U32(p);
+
+        assert(size >= 8 && size <= end - p);
+        if (!memcmp(p + 4, type, 4))
+        {
+            *box_end = p + size;
+            return p + 8;
+        }
+        p += size;
+    }
+    return NULL;
+}
+
+static unsigned Timescale(const uint8_t *moov, const uint8_t *moov_end,
+                          uint32_t track_id)
+{
+    const uint8_t *trak, *trak_end = moov;
+
+    while ((trak = Box(trak_end, moov_end, "trak", &trak_end)) != NULL)
+    {
+        const uint8_t *tkhd, *tkhd_end, *mdia, *mdia_end, *mdhd, *mdhd_end;
+
+        tkhd = Box(trak, trak_end, "tkhd", &tkhd_end);
+        assert(tkhd != NULL);
+        if (U32(tkhd + (tkhd[0] == 1 ? 20 : 12)) != track_id)
+            continue;
+        mdia = Box(trak, trak_end, "mdia", &mdia_end);
+        assert(mdia != NULL);
+        mdhd = Box(mdia, mdia_end, "mdhd", &mdhd_end);
+        assert(mdhd != NULL);
+        return U32(mdhd + (mdhd[0] == 1 ? 20 : 12));
+    }
+    abort();
+}
+
+/* Checks that the chunks follow each other as moof and mdat pairs, and
+ * that all the tracks of a chunk start at the same time */
+static unsigned Check(const char *path, unsigned chunk_ms)
+{
+    size_t size;
+    uint8_t *buf = ReadFile(path, &size);
+    const uint8_t *end = buf + size, *box_end;
+    const uint8_t *ftyp = Box(buf, end, "ftyp", &box_end);
+    assert(ftyp == buf + 8);
+    bool cmaf = false;
+    for (const uint8_t *brand = ftyp + 8; brand < box_end; brand += 4)
+        cmaf |= !memcmp(brand, "cmfc", 4);
+    assert(cmaf == (chunk_ms > 0));
+
+    const uint8_t *moov_end, *moov = Box(buf, end, "moov", &moov_end);
+    assert(moov != NULL);
+
+    unsigned chunks = 0;
+    double last_video = -1.;
+    const uint8_t *p = moov_end;
+    while (end - p >= 8 && !memcmp(p + 4, "moof", 4))
+    {
+        const uint8_t *moof_end = p + U32(p);
+        const uint8_t *traf, *traf_end = p + 8;
+        double min_start = 1e9, max_start = 0.;
+
+        while ((traf = Box(traf_end, moof_end, "traf", &traf_end)) != NULL)
+        {
+            const uint8_t *tfhd, *tfdt, *sub_end;
+
+            tfhd = Box(traf, traf_end, "tfhd", &sub_end);
+            tfdt = Box(traf, traf_end, "tfdt", &sub_end);
+            assert(tfhd != NULL && tfdt != NULL);
+
+            const uint32_t track_id = U32(tfhd + 4);
+            const double start = (tfdt[0] == 1 ? U64(tfdt + 4) : U32(tfdt + 4))
+                               / (double)Timescale(moov, moov_end, track_id);
+            if (start < min_start)
+                min_start = start;
+            if (start > max_start)
+                max_start = start;
+            if (track_id == 1)
+            {
+                /* Chunks end on the last frame before their boundary */
+                if (chunk_ms > 0 && last_video >= 0.)
+                    assert(start - last_video < chunk_ms / 1000.
+                                              + secf_from_vlc_tick(FRAME_PERIOD));
+                assert(start > last_video);
+                last_video = start;
+            }
+        }
+        /* Aligned within an audio frame */
+        assert(max_start - min_start <= (double)AUDIO_SAMPLES / AUDIO_RATE);
+
+        assert(end - moof_end >= 8 && !memcmp(moof_end + 4, "mdat", 4));
+        p = moof_end + U32(moof_end);
+        chunks++;
+    }
+    assert(end - p >= 8 && !memcmp(p + 4, "mfra", 4));
+    free(buf);
+    return chunks;
+}
+
+static void Test(vlc_object_t *parent, const char *mux_cfg, unsigned chunk_ms)
+{
+    char path[] = "/tmp/vlc-test-mp4-XXXXXX";
+    int fd = mkstemp(path);
+    assert(fd != -1);
+    close(fd);
+
+    sout_access_out_t *access = sout_AccessOutNew(parent, "file{overwrite}",
+                                                  path);
+    assert(access != NULL);
+
+    sout_mux_t *mux = sout_MuxNew(access, mux_cfg);
+    assert(mux != NULL);
+
+    es_format_t fmt;
+    es_format_Init(&fmt, VIDEO_ES, VLC_CODEC_MP4V);
+    fmt.i_id = 1;
+    fmt.video.i_width = fmt.video.i_visible_width = 640;
+    fmt.video.i_height = fmt.video.i_visible_height = 480;
+    fmt.video.i_frame_rate = 25;
+    fmt.video.i_frame_rate_base = 1;
+    sout_input_t *video = sout_MuxAddStream(mux, &fmt);
+    assert(video != NULL);
+    es_format_Init(&fmt, AUDIO_ES, VLC_CODEC_MP4A);
+    fmt.i_id = 2;
+    fmt.audio.i_rate = AUDIO_RATE;
+    fmt.audio.i_channels = 2;
+    sout_input_t *audio = sout_MuxAddStream(mux, &fmt);
+    assert(audio != NULL);
+
+    const vlc_tick_t audio_period = vlc_tick_from_samples(AUDIO_SAMPLES,
+                                                          AUDIO_RATE);
+    vlc_tick_t audio_dts = VLC_TICK_0;
+    off_t size = 0;
+    unsigned writes = 0;
+
+    for (unsigned i = 0; i < FRAMES; i++)
+    {
+        const vlc_tick_t dts = VLC_TICK_0 + i * FRAME_PERIOD;
+        block_t *frame = Frame(i % GOP ? 2000 + RandomByte() * 16 : 20000,
+                               dts, FRAME_PERIOD);
+
+        if (i % GOP == 0)
+            frame->i_flags |= BLOCK_FLAG_TYPE_I;
+        sout_MuxSendBuffer(mux, video, frame);
+        while (audio_dts < dts + FRAME_PERIOD)
+        {
+            block_t *block = Frame(300 + RandomByte(), audio_dts,
+                                   audio_period);
+
+            block->i_nb_samples = AUDIO_SAMPLES;
+            sout_MuxSendBuffer(mux, audio, block);
+            audio_dts += audio_period;
+        }
+
+        /* Count how many times the output grew while muxing */
+        struct stat st;
+        assert(stat(path, &st) == 0);
+        if (st.st_size != size)
+            writes++;
+        size = st.st_size;
+    }
+
+    sout_MuxDeleteStream(mux, audio);
+    sout_MuxDeleteStream(mux, video);
+    sout_MuxDelete(mux);
+    sout_AccessOutDelete(access);
+
+    unsigned chunks = Check(path, chunk_ms);
+    test_log("%s: %u fragments, written %u times while muxing\n", mux_cfg,
+             chunks, writes);
+    if (chunk_ms > 0)
+    {
+        const vlc_tick_t caching = VLC_TICK_FROM_MS(
+                            var_InheritInteger(parent, "sout-mux-caching"));
+        const vlc_tick_t duration = FRAMES * FRAME_PERIOD;
+
+        assert(chunks >= MS_FROM_VLC_TICK(duration) / chunk_ms);
+        /* Each chunk is written as soon as all its samples are there, once
+         * the muxer has started */
+        if (caching < duration)
+            assert(writes + 2 >= MS_FROM_VLC_TICK(duration - caching)
+                                 / chunk_ms);
+    }
+}
+
+int main(void)
+{
+    test_init();
+
+    libvlc_instance_t *vlc = libvlc_new(test_defaults_nargs,
+                                        test_defaults_args);
+    assert(vlc != NULL);
+
+    vlc_object_t *obj = VLC_OBJECT(vlc->p_libvlc_int);
+    Test(obj, "mp4frag", 0);
+    Test(obj, "mp4frag{chunk-duration=200}", 200);
+    Test(obj, "mp4frag{chunk-duration=500}", 500);
+
+    libvlc_release(vlc);
+    return 0;
+}
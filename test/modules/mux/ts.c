@@ -0,0 +1,250 @@
+/*****************************************************************************
+ * ts.c: MPEG-TS muxer test
+ *****************************************************************************
+ * Copyright (C) 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <vlc/vlc.h>
+
+#include "../../../lib/libvlc_internal.h"
+
+#include <vlc_common.h>
+#include <vlc_sout.h>
+#include <vlc_block.h>
+#include <vlc_es.h>
+#include <vlc_tick.h>
+
+#include "../../libvlc/test.h"
+#include "common.h"
+
+/* 4 seconds of a 20 Mbit/s video at 25 frames per second and a 192 kbit/s
+ * audio with 24 ms frames */
+#define FRAMES 100
+#define FRAME_PERIOD VLC_TICK_FROM_MS(40)
+#define FRAME_SIZE (20000000 / 8 / 25)
+#define GOP 12
+#define AUDIO_PERIOD VLC_TICK_FROM_MS(24)
+#define AUDIO_SIZE 576
+
+/* Checks the syntax, continuity and clock of the muxed stream, and that a
+ * constant bitrate stream has exactly one packet per slot of its clock */
+static unsigned Check(const char *path, unsigned muxrate)
+{
+    FILE *file = fopen(path, "rb");
+    assert(file != NULL);
+
+    uint8_t cc[8192];
+    bool seen[8192] = { false };
+    uint8_t pkt[188];
+    int64_t last_pcr = -1, first_pcr = -1;
+    unsigned count = 0, first = 0, pat = 0, pcrs = 0;
+
+    while (fread(pkt, sizeof (pkt), 1, file) == 1)
+    {
+        const unsigned pid = ((pkt[1] & 0x1f) << 8) | pkt[2];
+
+        assert(pkt[0] == 0x47);
+        if (pid == 0)
+            pat++;
+
+        if (pid == 0x1fff)
+        {
+            /* Stuffing only in constant bitrate */
+            assert(muxrate > 0);
+            count++;
+            continue;
+        }
+
+        /* All the packets of the muxer have a payload, except the PCR only
+         * ones of the constant bitrate mode which keep the counter */
+        if (pkt[3] & 0x10)
+        {
+            if (seen[pid])
+                assert((pkt[3] & 0xf) == ((cc[pid] + 1) & 0xf));
+        }
+        else
+        {
+            assert(muxrate > 0 && (pkt[3] & 0x20) && (pkt[5] & 0x10));
+            assert(seen[pid] && (pkt[3] & 0xf) == cc[pid]);
+        }
+        seen[pid] = true;
+        cc[pid] = pkt[3] & 0xf;
+
+        if ((pkt[3] & 0x20) && pkt[4] >= 7 && (pkt[5] & 0x10))
+        {
+            int64_t pcr = ((int64_t)pkt[6] << 25) | (pkt[7] << 17)
+                        | (pkt[8] << 9) | (pkt[9] << 1) | (pkt[10] >> 7);
+
+            pcr = pcr * 300 + (((pkt[10] & 1) << 8) | pkt[11]);
+            assert(pcr > last_pcr);
+            if (muxrate > 0)
+            {
+                if (first_pcr < 0)
+                {
+                    first_pcr = pcr;
+                    first = count;
+                }
+                /* 27 MHz clock of the slot, within one tick */
+                int64_t slot = (int64_t)(count - first) * 188 * 8 * 27000000
+                             / muxrate;
+                assert(llabs(pcr - first_pcr - slot) <= 1);
+            }
+            last_pcr = pcr;
+            pcrs++;
+        }
+        count++;
+    }
+    assert(feof(file));
+    fclose(file);
+
+    assert(pat > 0);
+    /* At least one PCR every 100 ms */
+    assert(pcrs >= FRAMES * MS_FROM_VLC_TICK(FRAME_PERIOD) / 100);
+    return count;
+}
+
+static void Test(vlc_object_t *parent, const char *mux_cfg,
+                 unsigned muxrate)
+{
+    char path[] = "/tmp/vlc-test-ts-XXXXXX";
+    int fd = mkstemp(path);
+    assert(fd != -1);
+    close(fd);
+
+    sout_access_out_t *access = sout_AccessOutNew(parent, "file{overwrite}",
+                                                  path);
+    assert(access != NULL);
+
+    sout_mux_t *mux = sout_MuxNew(access, mux_cfg);
+    if (mux == NULL)
+    {
+        /* The TS muxer requires libdvbpsi */
+        sout_AccessOutDelete(access);
+        unlink(path);
+        exit(77);
+    }
+
+    es_format_t fmt;
+    es_format_Init(&fmt, VIDEO_ES, VLC_CODEC_MPGV);
+    fmt.i_id = 1;
+    sout_input_t *video = sout_MuxAddStream(mux, &fmt);
+    assert(video != NULL);
+    es_format_Init(&fmt, AUDIO_ES, VLC_CODEC_MPGA);
+    fmt.i_id = 2;
+    sout_input_t *audio = sout_MuxAddStream(mux, &fmt);
+    assert(audio != NULL);
+
+    /* Prepare the frames so that only the muxing is measured */
+    block_t *frames[FRAMES];
+    block_t *audio_frames = NULL, **audio_last = &audio_frames;
+    vlc_tick_t audio_dts = VLC_TICK_0 + VLC_TICK_FROM_MS(5);
+
+    for (unsigned i = 0; i < FRAMES; i++)
+    {
+        const vlc_tick_t dts = VLC_TICK_0 + i * FRAME_PERIOD;
+        const size_t size = i % GOP
+                          ? FRAME_SIZE / 2 + RandomByte() * FRAME_SIZE / 256
+                          : 2 * FRAME_SIZE;
+
+        frames[i] = Frame(size, dts, FRAME_PERIOD);
+        if (i % GOP == 0)
+            frames[i]->i_flags |= BLOCK_FLAG_TYPE_I;
+        while (audio_dts < dts + FRAME_PERIOD)
+        {
+            block_ChainLastAppend(&audio_last,
+                                  Frame(AUDIO_SIZE, audio_dts, AUDIO_PERIOD));
+            audio_dts += AUDIO_PERIOD;
+        }
+    }
+
+    vlc_tick_t start = vlc_tick_now();
+    for (unsigned i = 0; i < FRAMES; i++)
+    {
+        const vlc_tick_t end = frames[i]->i_dts + FRAME_PERIOD;
+
+        sout_MuxSendBuffer(mux, video, frames[i]);
+        while (audio_frames != NULL && audio_frames->i_dts < end)
+        {
+            block_t *block = audio_frames;
+
+            audio_frames = block->p_next;
+            block->p_next = NULL;
+            sout_MuxSendBuffer(mux, audio, block);
+        }
+    }
+    vlc_tick_t elapsed = vlc_tick_now() - start;
+    block_ChainRelease(audio_frames);
+
+    struct sout_mux_cbr_stats stats;
+    int ret = sout_MuxControl(mux, MUX_GET_CBR_STATS, &stats);
+
+    sout_MuxDeleteStream(mux, audio);
+    sout_MuxDeleteStream(mux, video);
+    sout_MuxDelete(mux);
+    sout_AccessOutDelete(access);
+
+    unsigned packets = Check(path, muxrate);
+    assert(packets >= FRAMES / 2 * FRAME_SIZE / 184);
+    test_log("%s: %u packets, %.0f packets/s\n", mux_cfg, packets,
+             packets / secf_from_vlc_tick(elapsed > 0 ? elapsed : 1));
+
+    if (muxrate > 0)
+    {
+        /* The last packets are counted when sent */
+        assert(ret == VLC_SUCCESS);
+        assert(stats.packets > 0 && stats.packets <= packets);
+        assert(stats.null_packets > 0 && stats.overflows == 0);
+        assert(stats.pcr_interval_max <= VLC_TICK_FROM_MS(40));
+        assert(stats.pcr_accuracy_max <= 500);
+        test_log("%.1f%% filled, %"PRIu64" PCR only packets, PCR interval "
+                 "%"PRId64" ms\n",
+                 100. * (stats.packets - stats.null_packets
+                         - stats.pcr_packets) / stats.packets,
+                 stats.pcr_packets, MS_FROM_VLC_TICK(stats.pcr_interval_max));
+    }
+    else
+        assert(ret != VLC_SUCCESS);
+    unlink(path);
+}
+
+int main(void)
+{
+    test_init();
+
+    libvlc_instance_t *vlc = libvlc_new(test_defaults_nargs,
+                                        test_defaults_args);
+    assert(vlc != NULL);
+
+    vlc_object_t *obj = VLC_OBJECT(vlc->p_libvlc_int);
+    Test(obj, "ts{block-packets=1}", 0);
+    Test(obj, "ts", 0);
+    Test(obj, "ts{block-packets=64}", 0);
+    Test(obj, "ts{use-key-frames}", 0);
+    Test(obj, "ts{csa-ck=0123456789abcdef}", 0);
+    Test(obj, "ts{muxrate=40000000}", 40000000);
+    Test(obj, "ts{muxrate=40000000,use-key-frames}", 40000000);
+
+    libvlc_release(vlc);
+    return 0;
+}
@@ -0,0 +1,42 @@
+/*****************************************************************************
+ * random.h: reproducible test data
+ *****************************************************************************
+ * Copyright (C) 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include <stdint.h>
+
+/* The data does not depend on the C run-time, so that the same test runs
+ * with the same data everywhere */
+static uint32_t seed = 1;
+
+static inline uint32_t RandomNext(void)
+{
+    seed = seed * 1103515245 + 12345;
+    return seed;
+}
+
+static inline uint8_t RandomByte(void)
+{
+    return RandomNext() >> 16;
+}
+
+/* Uniform in [-1, 1) */
+static inline float RandomFloat(void)
+{
+    return (int)(RandomNext() >> 8) / (float)(1 << 23) - 1.f;
+}
@@ -0,0 +1,293 @@
+/*****************************************************************************
+ * amix.c: audio mixer alignment test
+ *****************************************************************************
+ * Copyright (C) 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <math.h>
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+#include <vlc_tick.h>
+
+#include "../../../modules/stream_out/amix_mixer.h"
+
+#include "../../libvlc/test.h"
+#include "../random.h"
+
+#define RATE 48000
+#define CHANNELS 2
+#define CHUNK (RATE / 50)
+#define LATENCY VLC_TICK_FROM_MS(200)
+#define TOLERANCE VLC_TICK_FROM_MS(10)
+#define START VLC_TICK_FROM_SEC(1)
+
+static vlc_tick_t Time(size_t frames)
+{
+    return START + vlc_tick_from_samples(frames, RATE);
+}
+
+static void Queue(amix_mixer_t *mixer, amix_input_t *input, float value,
+                  size_t count, vlc_tick_t pts)
+{
+    float *buf = vlc_alloc(count * CHANNELS, sizeof (*buf));
+    assert(buf != NULL);
+
+    for (size_t i = 0; i < count * CHANNELS; i++)
+        buf[i] = value;
+    assert(amix_Queue(mixer, input, buf, count, pts) == VLC_SUCCESS);
+    free(buf);
+}
+
+/* Mixes all the ready chunks into out, from the first mixed frame */
+static size_t Mix(amix_mixer_t *mixer, bool drain, float *out, size_t size)
+{
+    size_t mixed = 0;
+    block_t *block;
+
+    while ((block = amix_Mix(mixer, drain)) != NULL)
+    {
+        const size_t at = samples_from_vlc_tick(block->i_pts - mixer->start
+                                                + VLC_TICK_FROM_US(1), RATE);
+
+        assert(block->i_nb_samples == CHUNK);
+        assert(block->i_buffer == CHUNK * CHANNELS * sizeof (float));
+        assert(block->i_length == vlc_tick_from_samples(CHUNK, RATE));
+        assert(at + CHUNK <= size);
+        memcpy(out + at * CHANNELS, block->p_buffer, block->i_buffer);
+        mixed += CHUNK;
+        block_Release(block);
+    }
+    return mixed;
+}
+
+static void Expect(const float *out, size_t begin, size_t end, float value)
+{
+    for (size_t i = begin * CHANNELS; i < end * CHANNELS; i++)
+        if (fabsf(out[i] - value) > 1e-6f)
+        {
+            test_log("frame %zu: %f, expected %f\n", i / CHANNELS, out[i],
+                     value);
+            assert(!"wrong mixed value");
+        }
+}
+
+static void TestAlign(void)
+{
+    const size_t size = 8000, offset = 480, count = 4800;
+    float *out = calloc(size * CHANNELS, sizeof (*out));
+    amix_mixer_t mixer;
+
+    assert(out != NULL);
+    amix_Init(&mixer, RATE, CHANNELS, CHUNK, LATENCY, TOLERANCE);
+
+    amix_input_t *a = amix_AddInput(&mixer, .5f);
+    amix_input_t *b = amix_AddInput(&mixer, .25f);
+    assert(a != NULL && b != NULL);
+
+    /* Nothing is mixed until every input started */
+    Queue(&mixer, b, 2.f, count, Time(offset));
+    assert(Mix(&mixer, false, out, size) == 0);
+    Queue(&mixer, a, 1.f, count, Time(0));
+
+    size_t mixed = Mix(&mixer, false, out, size);
+    assert(mixed == count / CHUNK * CHUNK);
+
+    amix_EndInput(&mixer, a);
+    amix_EndInput(&mixer, b);
+    mixed += Mix(&mixer, true, out, size);
+    assert(mixed >= count + offset && mixed < count + offset + CHUNK);
+    assert(vlc_list_is_empty(&mixer.inputs));
+
+    Expect(out, 0, offset, .5f);
+    Expect(out, offset, count, 1.f);
+    Expect(out, count, count + offset, .5f);
+    Expect(out, count + offset, mixed, 0.f);
+    assert(mixer.late == 0 && mixer.gaps == 0 && mixer.overlaps == 0);
+    assert(mixer.missing == 0 && mixer.restarts == 0);
+
+    amix_Clean(&mixer);
+    free(out);
+}
+
+static void TestDiscontinuities(void)
+{
+    const size_t size = 8000;
+    float *out = calloc(size * CHANNELS, sizeof (*out));
+    amix_mixer_t mixer;
+
+    assert(out != NULL);
+    amix_Init(&mixer, RATE, CHANNELS, CHUNK, LATENCY, TOLERANCE);
+
+    amix_input_t *a = amix_AddInput(&mixer, 1.f);
+    assert(a != NULL);
+
+    /* Jitter within the tolerance is absorbed */
+    Queue(&mixer, a, 1.f, 960, Time(0));
+    Queue(&mixer, a, 1.f, 960, Time(960) + VLC_TICK_FROM_MS(2));
+    assert(mixer.gaps == 0 && mixer.overlaps == 0);
+
+    /* Gaps are filled with silence */
+    Queue(&mixer, a, 2.f, 960, Time(2880));
+    assert(mixer.gaps == 960);
+
+    /* Overlapping frames are dropped */
+    Queue(&mixer, a, 3.f, 960, Time(3840 - 720));
+    assert(mixer.overlaps == 720);
+
+    /* Beyond the latency, the input restarts */
+    Queue(&mixer, a, 4.f, 960, Time(4080) + LATENCY + VLC_TICK_FROM_MS(1));
+    assert(mixer.restarts == 1);
+
+    size_t mixed = Mix(&mixer, false, out, size);
+    amix_EndInput(&mixer, a);
+    mixed += Mix(&mixer, true, out, size);
+    assert(mixed == 960);
+    Expect(out, 0, 960, 4.f);
+    amix_Clean(&mixer);
+
+    /* Same without restart */
+    amix_Init(&mixer, RATE, CHANNELS, CHUNK, LATENCY, TOLERANCE);
+    a = amix_AddInput(&mixer, 1.f);
+    assert(a != NULL);
+    Queue(&mixer, a, 1.f, 960, Time(0));
+    Queue(&mixer, a, 2.f, 960, Time(1920));
+    Queue(&mixer, a, 3.f, 960, Time(2880 - 720));
+    amix_EndInput(&mixer, a);
+    mixed = Mix(&mixer, true, out, size);
+    assert(mixed == 3 * CHUNK + CHUNK);
+    Expect(out, 0, 960, 1.f);
+    Expect(out, 960, 1920, 0.f);
+    Expect(out, 1920, 2880, 2.f);
+    Expect(out, 2880, 3120, 3.f);
+    Expect(out, 3120, mixed, 0.f);
+    amix_Clean(&mixer);
+    free(out);
+}
+
+static void TestLatency(void)
+{
+    const size_t size = 48000;
+    float *out = calloc(size * CHANNELS, sizeof (*out));
+    amix_mixer_t mixer;
+
+    assert(out != NULL);
+    amix_Init(&mixer, RATE, CHANNELS, CHUNK, LATENCY, TOLERANCE);
+
+    amix_input_t *a = amix_AddInput(&mixer, 1.f);
+    amix_input_t *b = amix_AddInput(&mixer, 1.f);
+    assert(a != NULL && b != NULL);
+
+    /* b stalls after its first chunk: the mix goes on without it, no more
+     * than the latency behind a */
+    Queue(&mixer, b, 2.f, CHUNK, Time(0));
+    Queue(&mixer, a, 1.f, 24000, Time(0));
+
+    const size_t lag = samples_from_vlc_tick(LATENCY, RATE);
+    size_t mixed = Mix(&mixer, false, out, size);
+    assert(mixed == (24000 - lag) / CHUNK * CHUNK);
+    assert(mixer.missing == mixed - CHUNK);
+    Expect(out, 0, CHUNK, 3.f);
+    Expect(out, CHUNK, mixed, 1.f);
+
+    /* What b sends later, if already mixed, is dropped */
+    const size_t late = mixed - CHUNK;
+    Queue(&mixer, b, 2.f, late + CHUNK, Time(CHUNK));
+    size_t more = Mix(&mixer, false, out, size);
+    assert(mixer.late == late);
+    assert(more == CHUNK);
+    Expect(out, mixed, mixed + CHUNK, 3.f);
+    mixed += more;
+
+    /* Once ended, b does not hold the mix back */
+    amix_EndInput(&mixer, b);
+    more = Mix(&mixer, false, out, size);
+    assert(mixed + more == 24000 / CHUNK * CHUNK);
+    Expect(out, mixed, mixed + more, 1.f);
+    assert(vlc_list_is_empty(&mixer.inputs) == false);
+
+    amix_Clean(&mixer);
+    free(out);
+}
+
+static void TestFlush(void)
+{
+    const size_t size = 8000;
+    float *out = calloc(size * CHANNELS, sizeof (*out));
+    amix_mixer_t mixer;
+
+    assert(out != NULL);
+    amix_Init(&mixer, RATE, CHANNELS, CHUNK, LATENCY, TOLERANCE);
+
+    amix_input_t *a = amix_AddInput(&mixer, 1.f);
+    amix_input_t *b = amix_AddInput(&mixer, 1.f);
+    assert(a != NULL && b != NULL);
+
+    Queue(&mixer, a, 1.f, 2000, Time(0));
+    Queue(&mixer, b, 1.f, 2000, Time(0));
+    assert(Mix(&mixer, false, out, size) == 1920);
+
+    /* After a flush, the mix restarts at new timestamps, even earlier ones */
+    amix_Flush(&mixer);
+    Queue(&mixer, a, 1.f, 960, Time(0));
+    assert(Mix(&mixer, false, out, size) == 0);
+    Queue(&mixer, b, 2.f, 960, Time(0));
+    memset(out, 0, size * CHANNELS * sizeof (*out));
+    assert(Mix(&mixer, false, out, size) == 960);
+    Expect(out, 0, 960, 3.f);
+    assert(mixer.late == 0 && mixer.restarts == 0);
+
+    amix_DelInput(&mixer, a);
+    amix_Clean(&mixer);
+    free(out);
+}
+
+static void TestAccumulate(void)
+{
+    float src[263], dst[263], ref[263];
+
+    for (size_t i = 0; i < ARRAY_SIZE(src); i++)
+    {
+        src[i] = RandomFloat();
+        ref[i] = dst[i] = i / (float)ARRAY_SIZE(src);
+    }
+
+    for (size_t n = 0; n <= ARRAY_SIZE(src); n += 1 + n / 4)
+        for (size_t offset = 0; offset < 4 && offset + n <= ARRAY_SIZE(src);
+             offset++)
+        {
+            amix_Accumulate_C(ref + offset, src + offset, .7f, n);
+            amix_Accumulate(dst + offset, src + offset, .7f, n);
+            for (size_t i = 0; i < ARRAY_SIZE(src); i++)
+                assert(fabsf(dst[i] - ref[i]) <= 1e-5f);
+        }
+}
+
+int main(void)
+{
+    test_init();
+
+    TestAlign();
+    TestDiscontinuities();
+    TestLatency();
+    TestFlush();
+    TestAccumulate();
+    return 0;
+}
@@ -0,0 +1,317 @@
+/*****************************************************************************
+ * duplicate.c: duplicate stream output test
+ *****************************************************************************
+ * Copyright (C) 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <vlc/vlc.h>
+
+#include "../../../lib/libvlc_internal.h"
+
+#include <vlc_common.h>
+#include <vlc_sout.h>
+#include <vlc_block.h>
+#include <vlc_es.h>
+#include <vlc_tick.h>
+
+#include "../../libvlc/test.h"
+#include "../mux/common.h"
+#include "sink.h"
+
+#define BLOCKS 100
+#define VIDEO_SIZE 200000 /* 50 Mbit/s at 25 frames per second */
+#define AUDIO_SIZE 768
+
+/* A frame filled with its index */
+static block_t *Filled(size_t size, unsigned index)
+{
+    block_t *block = block_Alloc(size);
+    assert(block != NULL);
+
+    memset(block->p_buffer, index, size);
+    block->i_dts = block->i_pts = VLC_TICK_0 + index * VLC_TICK_FROM_MS(40);
+    return block;
+}
+
+static void CheckBranch(sout_stream_t *dup, unsigned branch,
+                        uint64_t blocks, uint64_t bytes, uint64_t copies,
+                        uint64_t dropped)
+{
+    struct sout_stream_branch_stats stats;
+
+    assert(sout_StreamControl(dup, SOUT_STREAM_GET_BRANCH_STATS, branch,
+                              &stats) == VLC_SUCCESS);
+    assert(stats.blocks == blocks && stats.bytes == bytes);
+    assert(stats.copies == copies && stats.dropped == dropped);
+}
+
+/* Checks that a branch got the blocks of an ES, with their data or with a
+ * copy of it */
+static void CheckBlocks(const struct sink_id *id, int es,
+                        uint8_t *const *data, size_t size, bool copy)
+{
+    unsigned i = 0;
+
+    assert(id->fmt.i_id == es);
+    for (const block_t *block = id->blocks; block; block = block->p_next, i++)
+    {
+        assert(i < BLOCKS);
+        assert(block->i_buffer == size);
+        assert(block->i_pts == VLC_TICK_0 + i * VLC_TICK_FROM_MS(40));
+        assert((block->p_buffer == data[i]) == !copy);
+        assert(block->p_buffer[0] == (uint8_t)i
+            && block->p_buffer[size - 1] == (uint8_t)i);
+    }
+    /* The corrupted block was dropped */
+    assert(i == BLOCKS - 1);
+}
+
+static void Test(vlc_object_t *parent)
+{
+    sout_stream_t *sink = SinkNew(parent, true);
+    sout_stream_t *dup = sout_StreamChainNew(parent,
+        "duplicate{dst=\"\",share,dst=\"\",share,dst=\"\",select=audio,share,"
+        "dst=\"\"}",
+        sink);
+    assert(dup != NULL);
+
+    es_format_t fmt;
+    es_format_Init(&fmt, VIDEO_ES, VLC_CODEC_H264);
+    fmt.i_id = 1;
+    void *video = sout_StreamIdAdd(dup, &fmt);
+    assert(video != NULL);
+    es_format_Init(&fmt, AUDIO_ES, VLC_CODEC_MPGA);
+    fmt.i_id = 2;
+    void *audio = sout_StreamIdAdd(dup, &fmt);
+    assert(audio != NULL);
+    /* The video is not sent to the audio only branch */
+    assert(sink_count == 7);
+
+    uint8_t *video_data[BLOCKS], *audio_data[BLOCKS];
+    for (unsigned i = 0; i < BLOCKS; i++)
+    {
+        block_t *v = Filled(VIDEO_SIZE, i), *a = Filled(AUDIO_SIZE, i);
+
+        /* Dropped by all the branches */
+        if (i == BLOCKS - 1)
+        {
+            v->i_flags |= BLOCK_FLAG_CORRUPTED;
+            a->i_flags |= BLOCK_FLAG_CORRUPTED;
+        }
+        video_data[i] = v->p_buffer;
+        audio_data[i] = a->p_buffer;
+        assert(sout_StreamIdSend(dup, video, v) == VLC_SUCCESS);
+        assert(sout_StreamIdSend(dup, audio, a) == VLC_SUCCESS);
+    }
+
+    /* All but the last branch share the data of the blocks */
+    CheckBlocks(&sink_ids[0], 1, video_data, VIDEO_SIZE, false);
+    CheckBlocks(&sink_ids[1], 1, video_data, VIDEO_SIZE, false);
+    CheckBlocks(&sink_ids[2], 1, video_data, VIDEO_SIZE, true);
+    CheckBlocks(&sink_ids[3], 2, audio_data, AUDIO_SIZE, false);
+    CheckBlocks(&sink_ids[4], 2, audio_data, AUDIO_SIZE, false);
+    CheckBlocks(&sink_ids[5], 2, audio_data, AUDIO_SIZE, false);
+    CheckBlocks(&sink_ids[6], 2, audio_data, AUDIO_SIZE, true);
+
+    const uint64_t sent = BLOCKS - 1;
+    CheckBranch(dup, 0, 2 * sent, sent * (VIDEO_SIZE + AUDIO_SIZE), 0, 2);
+    CheckBranch(dup, 1, 2 * sent, sent * (VIDEO_SIZE + AUDIO_SIZE), 0, 2);
+    CheckBranch(dup, 2, sent, sent * AUDIO_SIZE, 0, 1);
+    CheckBranch(dup, 3, 2 * sent, sent * (VIDEO_SIZE + AUDIO_SIZE),
+                2 * BLOCKS, 2);
+
+    struct sout_stream_branch_stats stats;
+    assert(sout_StreamControl(dup, SOUT_STREAM_GET_BRANCH_STATS, 4u,
+                              &stats) != VLC_SUCCESS);
+
+    /* The branches release the shared blocks in any order */
+    sout_StreamIdDel(dup, video);
+    sout_StreamIdDel(dup, audio);
+    sout_StreamChainDelete(dup, sink);
+    vlc_object_delete(sink);
+    SinkClean();
+}
+
+#define NAL_SIZE 32
+
+/* An H.264 IDR slice in Annex B, which the MP4 muxer converts in place to
+ * a length prefixed one */
+static block_t *AnnexBFrame(unsigned index)
+{
+    block_t *block = block_Alloc(4 + NAL_SIZE);
+    assert(block != NULL);
+
+    memcpy(block->p_buffer, "\x00\x00\x00\x01\x65", 5);
+    memset(block->p_buffer + 5, 0x80 | index, NAL_SIZE - 1);
+    block->i_dts = block->i_pts = VLC_TICK_0 + index * VLC_TICK_FROM_MS(40);
+    block->i_length = VLC_TICK_FROM_MS(40);
+    block->i_flags |= BLOCK_FLAG_TYPE_I;
+    return block;
+}
+
+/* Counts the frames which the MP4 file has, length prefixed */
+static unsigned CheckMP4(const char *path)
+{
+    size_t size;
+    uint8_t *buf = ReadFile(path, &size);
+    const uint8_t *p = memmem(buf, size, "mdat", 4), *end = buf + size;
+    unsigned count = 0;
+
+    assert(p != NULL);
+    for (p += 4; end - p >= 4 + NAL_SIZE; p += 4 + NAL_SIZE, count++)
+    {
+        if (memcmp(p, "\x00\x00\x00\x20\x65", 5))
+            break;
+        assert(p[5] == (0x80 | count) && p[3 + NAL_SIZE] == (0x80 | count));
+    }
+    free(buf);
+    return count;
+}
+
+/* Counts the frames which the TS file has, still in Annex B */
+static unsigned CheckTS(const char *path)
+{
+    size_t size;
+    uint8_t *buf = ReadFile(path, &size);
+    unsigned count = 0;
+
+    assert(size > 0 && size % 188 == 0);
+    for (unsigned i = 0; i < BLOCKS; i++)
+    {
+        uint8_t nal[8] = { 0x00, 0x00, 0x00, 0x01, 0x65 };
+
+        memset(nal + 5, 0x80 | i, 3);
+        if (memmem(buf, size, nal, sizeof (nal)) != NULL)
+            count++;
+    }
+    free(buf);
+    return count;
+}
+
+/* Sends an H.264 video to an MP4 and a TS muxer, which must both get the
+ * original data whether the TS branch shares it or not */
+static void TestMuxes(vlc_object_t *parent, bool share)
+{
+    char mp4[] = "/tmp/vlc-test-duplicate-mp4-XXXXXX";
+    char ts[] = "/tmp/vlc-test-duplicate-ts-XXXXXX";
+    int fd = mkstemp(mp4);
+    assert(fd != -1);
+    close(fd);
+    fd = mkstemp(ts);
+    assert(fd != -1);
+    close(fd);
+
+    char chain[256];
+    snprintf(chain, sizeof (chain), "duplicate{"
+             "dst=std{access=file{overwrite},mux=mp4,dst=%s},"
+             "dst=std{access=file{overwrite},mux=ts,dst=%s}%s}", mp4, ts,
+             share ? ",share" : "");
+    sout_stream_t *dup = sout_StreamChainNew(parent, chain, NULL);
+    assert(dup != NULL);
+
+    es_format_t fmt;
+    es_format_Init(&fmt, VIDEO_ES, VLC_CODEC_H264);
+    fmt.i_id = 1;
+    fmt.video.i_width = fmt.video.i_visible_width = 320;
+    fmt.video.i_height = fmt.video.i_visible_height = 240;
+    fmt.video.i_frame_rate = 25;
+    fmt.video.i_frame_rate_base = 1;
+    void *video = sout_StreamIdAdd(dup, &fmt);
+    assert(video != NULL);
+
+    for (unsigned i = 0; i < BLOCKS; i++)
+        assert(sout_StreamIdSend(dup, video, AnnexBFrame(i)) == VLC_SUCCESS);
+
+    sout_StreamIdDel(dup, video);
+    sout_StreamChainDelete(dup, NULL);
+
+    /* The muxers may keep their last frames, but none is altered */
+    unsigned mp4_frames = CheckMP4(mp4), ts_frames = CheckTS(ts);
+    test_log("%s TS branch: %u MP4 frames, %u TS frames\n",
+             share ? "sharing" : "copying", mp4_frames, ts_frames);
+    assert(mp4_frames > BLOCKS / 2);
+    assert(ts_frames > BLOCKS / 2);
+}
+
+/* Fans a 50 Mbit/s video out to several branches */
+static void Bench(vlc_object_t *parent, unsigned branches, bool copy)
+{
+    char chain[256] = "duplicate{";
+    for (unsigned i = 0; i < branches; i++)
+    {
+        if (i > 0)
+            strcat(chain, ",");
+        strcat(chain, copy ? "dst=\"\"" : "dst=\"\",share");
+    }
+    strcat(chain, "}");
+
+    sout_stream_t *sink = SinkNew(parent, false);
+    sout_stream_t *dup = sout_StreamChainNew(parent, chain, sink);
+    assert(dup != NULL);
+
+    es_format_t fmt;
+    es_format_Init(&fmt, VIDEO_ES, VLC_CODEC_H264);
+    fmt.i_id = 1;
+    void *video = sout_StreamIdAdd(dup, &fmt);
+    assert(video != NULL);
+
+    vlc_tick_t elapsed = 0;
+    for (unsigned i = 0; i < 10 * BLOCKS; i++)
+    {
+        block_t *block = Filled(VIDEO_SIZE, i);
+        vlc_tick_t start = vlc_tick_now();
+
+        assert(sout_StreamIdSend(dup, video, block) == VLC_SUCCESS);
+        elapsed += vlc_tick_now() - start;
+    }
+    test_log("%u %s branches: %.0f MB/s\n", branches,
+             copy ? "copying" : "sharing",
+             10. * BLOCKS * VIDEO_SIZE / 1000000.
+             / secf_from_vlc_tick(elapsed > 0 ? elapsed : 1));
+
+    sout_StreamIdDel(dup, video);
+    sout_StreamChainDelete(dup, sink);
+    vlc_object_delete(sink);
+    SinkClean();
+}
+
+int main(void)
+{
+    test_init();
+
+    libvlc_instance_t *vlc = libvlc_new(test_defaults_nargs,
+                                        test_defaults_args);
+    assert(vlc != NULL);
+
+    vlc_object_t *obj = VLC_OBJECT(vlc->p_libvlc_int);
+    Test(obj);
+    TestMuxes(obj, false);
+    TestMuxes(obj, true);
+    Bench(obj, 8, true);
+    Bench(obj, 8, false);
+
+    libvlc_release(vlc);
+    return 0;
+}
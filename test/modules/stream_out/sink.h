@@ -0,0 +1,103 @@
+/*****************************************************************************
+ * sink.h: end of the stream output chains under test
+ *****************************************************************************
+ * Copyright (C) 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include <vlc_common.h>
+#include <vlc_sout.h>
+#include <vlc_block.h>
+#include <vlc_es.h>
+
+/* The ES which the sink got, kept after their deletion to be checked */
+struct sink_id
+{
+    es_format_t fmt;
+    unsigned count; /* of the blocks */
+    bool keep;
+    block_t *blocks;
+    block_t **last;
+};
+
+static struct sink_id sink_ids[16];
+static unsigned sink_count;
+
+static void *SinkAdd(sout_stream_t *stream, const es_format_t *fmt)
+{
+    assert(sink_count < ARRAY_SIZE(sink_ids));
+
+    struct sink_id *id = &sink_ids[sink_count++];
+    es_format_Copy(&id->fmt, fmt);
+    id->count = 0;
+    id->keep = stream->p_sys != NULL;
+    id->blocks = NULL;
+    id->last = &id->blocks;
+    return id;
+}
+
+static void SinkDel(sout_stream_t *stream, void *id_)
+{
+    struct sink_id *id = id_;
+
+    (void)stream;
+    block_ChainRelease(id->blocks);
+    id->blocks = NULL;
+    id->last = &id->blocks;
+}
+
+static int SinkSend(sout_stream_t *stream, void *id_, block_t *block)
+{
+    struct sink_id *id = id_;
+
+    (void)stream;
+    if (block->i_flags & BLOCK_FLAG_CORRUPTED)
+    {
+        block_ChainRelease(block);
+        return VLC_EGENERIC;
+    }
+    for (const block_t *b = block; b != NULL; b = b->p_next)
+        id->count++;
+    if (id->keep)
+        block_ChainLastAppend(&id->last, block);
+    else
+        block_ChainRelease(block);
+    return VLC_SUCCESS;
+}
+
+static const struct sout_stream_operations sink_ops = {
+    SinkAdd, SinkDel, SinkSend, NULL, NULL,
+};
+
+/* Forgets the ES of the previous sinks */
+static void SinkClean(void)
+{
+    for (unsigned i = 0; i < sink_count; i++)
+        es_format_Clean(&sink_ids[i].fmt);
+    sink_count = 0;
+}
+
+/* Creates the end of a chain, which keeps the blocks if asked to */
+static sout_stream_t *SinkNew(vlc_object_t *parent, bool keep)
+{
+    sout_stream_t *sink = vlc_object_create(parent, sizeof (*sink));
+    assert(sink != NULL);
+
+    sink->ops = &sink_ops;
+    sink->p_sys = keep ? sink : NULL;
+    SinkClean();
+    return sink;
+}
@@ -0,0 +1,309 @@
+/*****************************************************************************
+ * transcode.c: transcode chunked video encoding and renditions test
+ *****************************************************************************
+ * Copyright (C) 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <vlc/vlc.h>
+
+#include "../../../lib/libvlc_internal.h"
+
+#include <vlc_common.h>
+#include <vlc_codec.h>
+#include <vlc_picture.h>
+#include <vlc_sout.h>
+#include <vlc_block.h>
+#include <vlc_tick.h>
+
+#include "../../../modules/stream_out/transcode/transcode.h"
+
+#include "../../libvlc/test.h"
+#include "sink.h"
+
+#define WIDTH 480
+#define HEIGHT 272
+#define FRAMES 200
+#define CHUNK_FRAMES 25
+#define FRAME_PERIOD VLC_TICK_FROM_MS(40)
+
+static const vlc_fourcc_t codecs[] = {
+    VLC_CODEC_MP4V, VLC_CODEC_H264, VLC_CODEC_MJPG,
+};
+
+/* A moving gradient with some noise, so that the encoders have work */
+static picture_t *Picture(const video_format_t *fmt, unsigned index)
+{
+    picture_t *pic = picture_NewFromFormat(fmt);
+    assert(pic != NULL);
+
+    uint32_t seed = index + 1;
+    for (int p = 0; p < pic->i_planes; p++)
+    {
+        plane_t *plane = &pic->p[p];
+
+        for (int y = 0; y < plane->i_visible_lines; y++)
+        {
+            uint8_t *line = plane->p_pixels + y * plane->i_pitch;
+
+            for (int x = 0; x < plane->i_visible_pitch; x++)
+            {
+                seed = seed * 1103515245 + 12345;
+                line[x] = (x + y + 4 * index * (p + 1)) + ((seed >> 16) & 7);
+            }
+        }
+    }
+    pic->date = VLC_TICK_0 + index * FRAME_PERIOD;
+    return pic;
+}
+
+static transcode_encoder_t *Open(vlc_object_t *parent,
+                                 transcode_encoder_config_t *cfg,
+                                 vlc_fourcc_t codec)
+{
+    es_format_t fmt, wanted;
+
+    es_format_Init(&fmt, VIDEO_ES, VLC_CODEC_I420);
+    video_format_Setup(&fmt.video, VLC_CODEC_I420, WIDTH, HEIGHT,
+                       WIDTH, HEIGHT, 1, 1);
+    fmt.video.i_frame_rate = 25;
+    fmt.video.i_frame_rate_base = 1;
+    es_format_Init(&wanted, VIDEO_ES, 0);
+
+    cfg->i_codec = codec;
+    if (transcode_encoder_test(sout_EncoderCreate(parent, sizeof (encoder_t)),
+                               cfg, &fmt, VLC_CODEC_I420, &wanted))
+    {
+        es_format_Clean(&wanted);
+        es_format_Clean(&fmt);
+        return NULL;
+    }
+
+    transcode_encoder_t *enc =
+        transcode_encoder_new(sout_EncoderCreate(parent, sizeof (encoder_t)),
+                              &wanted);
+    assert(enc != NULL);
+    transcode_encoder_video_configure(parent, &fmt.video, cfg, &fmt.video,
+                                      NULL, enc);
+    es_format_Clean(&wanted);
+    es_format_Clean(&fmt);
+
+    if (transcode_encoder_open(enc, cfg) != VLC_SUCCESS)
+    {
+        transcode_encoder_delete(enc);
+        return NULL;
+    }
+    return enc;
+}
+
+static void Check(block_t *out, unsigned chunk_frames)
+{
+    vlc_tick_t last_dts = VLC_TICK_INVALID, delay = 0;
+    unsigned count = 0;
+    bool seen[FRAMES] = { false };
+
+    for (block_t *block = out; block != NULL; block = block->p_next, count++)
+    {
+        assert(count < FRAMES);
+        assert(block->i_pts != VLC_TICK_INVALID);
+
+        /* Each chunk starts with a keyframe, which may be delayed, along
+         * with the rest of the chunk, not to overlap the previous chunk */
+        if (chunk_frames > 0 && count % chunk_frames == 0)
+        {
+            const vlc_tick_t start = VLC_TICK_0 + count * FRAME_PERIOD;
+
+            assert(block->i_flags & BLOCK_FLAG_TYPE_I);
+            assert(block->i_pts >= start + delay);
+            delay = block->i_pts - start;
+        }
+
+        const unsigned index = (block->i_pts - delay - VLC_TICK_0)
+                             / FRAME_PERIOD;
+        assert(index < FRAMES && !seen[index]);
+        seen[index] = true;
+
+        if (block->i_dts != VLC_TICK_INVALID)
+        {
+            /* Chunks must not pack their leading frames together */
+            assert(last_dts == VLC_TICK_INVALID ||
+                   block->i_dts >= last_dts + FRAME_PERIOD);
+            assert(block->i_dts <= block->i_pts);
+            last_dts = block->i_dts;
+        }
+    }
+    assert(count == FRAMES);
+    /* The delay stays within the reordering delay of the encoder */
+    assert(chunk_frames > 0 ? delay < chunk_frames * FRAME_PERIOD
+                            : delay == 0);
+}
+
+static bool Test(vlc_object_t *parent, vlc_fourcc_t codec, unsigned chunks)
+{
+    transcode_encoder_config_t cfg;
+
+    transcode_encoder_config_init(&cfg);
+    cfg.video.threads.pool_size = 10;
+    cfg.video.chunks.i_count = chunks;
+    cfg.video.chunks.i_frames = CHUNK_FRAMES;
+
+    transcode_encoder_t *enc = Open(parent, &cfg, codec);
+    if (enc == NULL)
+    {
+        test_log("no %4.4s encoder\n", (const char *)&codec);
+        return false;
+    }
+
+    const video_format_t *fmt = &transcode_encoder_format_in(enc)->video;
+    picture_t *pics[FRAMES];
+    block_t *out = NULL;
+
+    for (unsigned i = 0; i < FRAMES; i++)
+        pics[i] = Picture(fmt, i);
+
+    vlc_tick_t start = vlc_tick_now();
+    for (unsigned i = 0; i < FRAMES; i++)
+    {
+        block_ChainAppend(&out, transcode_encoder_encode(enc, pics[i]));
+        picture_Release(pics[i]);
+        block_ChainAppend(&out, transcode_encoder_get_output_async(enc));
+    }
+    assert(transcode_encoder_drain(enc, &out) == VLC_SUCCESS);
+    vlc_tick_t elapsed = vlc_tick_now() - start;
+
+    transcode_encoder_close(enc);
+    transcode_encoder_delete(enc);
+
+    Check(out, chunks > 0 ? CHUNK_FRAMES : 0);
+    test_log("%4.4s with %u chunk encoders: %.1f frames/s\n",
+             (const char *)&codec, chunks,
+             FRAMES / secf_from_vlc_tick(elapsed > 0 ? elapsed : 1));
+    block_ChainRelease(out);
+    return true;
+}
+
+/* Checks an ES that the transcoder outputs */
+static void CheckES(int es, int group, unsigned width, unsigned height)
+{
+    for (unsigned i = 0; i < sink_count; i++)
+    {
+        const struct sink_id *id = &sink_ids[i];
+
+        if (id->fmt.i_id != es)
+            continue;
+        assert(id->fmt.i_cat == VIDEO_ES);
+        assert(id->fmt.i_group == group);
+        assert(id->fmt.video.i_visible_width == width);
+        assert(id->fmt.video.i_visible_height == height);
+        assert(id->count > 0);
+        return;
+    }
+    assert(!"missing ES");
+}
+
+/* Encodes the pictures of one decoder into the main video and two renditions */
+static void TestRenditions(vlc_object_t *parent, vlc_fourcc_t codec)
+{
+    char chain[256];
+    snprintf(chain, sizeof (chain), "transcode{vcodec=%4.4s,vb=800,"
+             "renditions=half{vb=300,width=%u}:quarter{vb=100,width=%u,"
+             "height=%u}}", (const char *)&codec, WIDTH / 2, WIDTH / 4,
+             HEIGHT / 4);
+
+    sout_stream_t *sink = SinkNew(parent, false);
+
+    sout_stream_t *transcode = sout_StreamChainNew(parent, chain, sink);
+    assert(transcode != NULL);
+
+    es_format_t fmt;
+    es_format_Init(&fmt, VIDEO_ES, VLC_CODEC_I420);
+    video_format_Setup(&fmt.video, VLC_CODEC_I420, WIDTH, HEIGHT,
+                       WIDTH, HEIGHT, 1, 1);
+    fmt.video.i_frame_rate = 25;
+    fmt.video.i_frame_rate_base = 1;
+    fmt.i_id = 4;
+    fmt.i_group = 2;
+    void *id = sout_StreamIdAdd(transcode, &fmt);
+    assert(id != NULL);
+
+    for (unsigned i = 0; i < CHUNK_FRAMES; i++)
+    {
+        picture_t *pic = Picture(&fmt.video, i);
+        block_t *block = block_Alloc(WIDTH * HEIGHT * 3 / 2);
+        assert(block != NULL);
+
+        uint8_t *dst = block->p_buffer;
+        for (int p = 0; p < pic->i_planes; p++)
+            for (int y = 0; y < pic->p[p].i_visible_lines; y++)
+            {
+                memcpy(dst, pic->p[p].p_pixels + y * pic->p[p].i_pitch,
+                       pic->p[p].i_visible_pitch);
+                dst += pic->p[p].i_visible_pitch;
+            }
+        block->i_dts = block->i_pts = pic->date;
+        block->i_length = FRAME_PERIOD;
+        picture_Release(pic);
+        assert(sout_StreamIdSend(transcode, id, block) == VLC_SUCCESS);
+    }
+
+    sout_StreamIdDel(transcode, id);
+    sout_StreamChainDelete(transcode, sink);
+    vlc_object_delete(sink);
+
+    /* Each rendition is its own ES and group, which a TS muxer would not
+     * mix up with the main one */
+    assert(sink_count == 3);
+    CheckES(4, 2, WIDTH, HEIGHT);
+    CheckES(TRANSCODE_RENDITION_ID(4, 0), TRANSCODE_RENDITION_ID(2, 0),
+            WIDTH / 2, HEIGHT / 2);
+    CheckES(TRANSCODE_RENDITION_ID(4, 1), TRANSCODE_RENDITION_ID(2, 1),
+            WIDTH / 4, HEIGHT / 4);
+    for (unsigned i = 0; i < sink_count; i++)
+        for (unsigned j = i + 1; j < sink_count; j++)
+            assert((sink_ids[i].fmt.i_id & 0x1fff) !=
+                   (sink_ids[j].fmt.i_id & 0x1fff));
+
+    SinkClean();
+    es_format_Clean(&fmt);
+}
+
+int main(void)
+{
+    test_init();
+
+    libvlc_instance_t *vlc = libvlc_new(test_defaults_nargs,
+                                        test_defaults_args);
+    assert(vlc != NULL);
+
+    vlc_object_t *obj = VLC_OBJECT(vlc->p_libvlc_int);
+    unsigned tested = 0;
+    for (size_t i = 0; i < ARRAY_SIZE(codecs); i++)
+        if (Test(obj, codecs[i], 0))
+        {
+            bool ok = Test(obj, codecs[i], 1) && Test(obj, codecs[i], 4);
+            assert(ok);
+            if (tested == 0)
+                TestRenditions(obj, codecs[i]);
+            tested++;
+        }
+
+    libvlc_release(vlc);
+    /* No video encoder plugin was built */
+    return tested > 0 ? 0 : 77;
+}
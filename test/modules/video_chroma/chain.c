@@ -0,0 +1,198 @@
+/*****************************************************************************
+ * chain.c: single pass resize and chroma conversion test
+ *****************************************************************************
+ * Copyright (C) 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <math.h>
+#include <string.h>
+
+#include <vlc/vlc.h>
+
+#include "../../../lib/libvlc_internal.h"
+
+#include <vlc_common.h>
+#include <vlc_modules.h>
+#include <vlc_filter.h>
+#include <vlc_picture.h>
+
+#include "../../libvlc/test.h"
+
+/* Standard definition, so that both paths use the BT.601 matrix */
+#define SRC_WIDTH  720
+#define SRC_HEIGHT 576
+#define DST_WIDTH  352
+#define DST_HEIGHT 288
+
+/* The range conversions are left to the chain of generic converters */
+static const struct
+{
+    vlc_fourcc_t in;
+    vlc_fourcc_t out;
+    bool fused;
+} pairs[] = {
+    { VLC_CODEC_I420, VLC_CODEC_NV12, true },
+    { VLC_CODEC_NV12, VLC_CODEC_I420, true },
+    { VLC_CODEC_I420, VLC_CODEC_RGBA, true },
+    { VLC_CODEC_J420, VLC_CODEC_RGBA, true },
+    { VLC_CODEC_J420, VLC_CODEC_NV12, false },
+    { VLC_CODEC_J420, VLC_CODEC_I420, false },
+};
+
+/* Set when the chain module reports its single pass path */
+static bool fused_taken;
+
+static void Log(void *data, int level, const libvlc_log_t *ctx,
+                const char *fmt, va_list ap)
+{
+    const char *module;
+
+    (void) data; (void) level; (void) ap;
+    libvlc_log_get_context(ctx, &module, NULL, NULL);
+    if (module != NULL && strcmp(module, "chain") == 0
+     && strncmp(fmt, "single pass", 11) == 0)
+        fused_taken = true;
+}
+
+static filter_t *CreateConverter(vlc_object_t *parent, vlc_fourcc_t in,
+                                 vlc_fourcc_t out, const char *name)
+{
+    filter_t *filter = vlc_object_create(parent, sizeof (*filter));
+    assert(filter != NULL);
+
+    es_format_Init(&filter->fmt_in, VIDEO_ES, in);
+    video_format_Setup(&filter->fmt_in.video, in, SRC_WIDTH, SRC_HEIGHT,
+                       SRC_WIDTH, SRC_HEIGHT, 1, 1);
+    es_format_Init(&filter->fmt_out, VIDEO_ES, out);
+    video_format_Setup(&filter->fmt_out.video, out, DST_WIDTH, DST_HEIGHT,
+                       DST_WIDTH, DST_HEIGHT, 1, 1);
+
+    filter->p_module = module_need(filter, "video converter", name, true);
+    if (filter->p_module == NULL)
+    {
+        es_format_Clean(&filter->fmt_in);
+        es_format_Clean(&filter->fmt_out);
+        vlc_object_delete(filter);
+        return NULL;
+    }
+    return filter;
+}
+
+static void DeleteConverter(filter_t *filter)
+{
+    filter_Close(filter);
+    module_unneed(filter, filter->p_module);
+    es_format_Clean(&filter->fmt_in);
+    es_format_Clean(&filter->fmt_out);
+    vlc_object_delete(filter);
+}
+
+/* Smooth content, so that the differences between the kernels of both
+ * paths stay small */
+static void Fill(picture_t *pic)
+{
+    for (int i = 0; i < pic->i_planes; i++)
+    {
+        plane_t *p = &pic->p[i];
+        for (int y = 0; y < p->i_lines; y++)
+            for (int x = 0; x < p->i_pitch; x++)
+                p->p_pixels[y * p->i_pitch + x] =
+                    128 + 60 * sin(x / (20. + 10 * i)) * cos(y / 25.);
+    }
+}
+
+/* Largest difference between two pictures; sets the mean one */
+static int Compare(const picture_t *a, const picture_t *b, double *mean)
+{
+    uint64_t sum = 0, count = 0;
+    int max = 0;
+
+    for (int i = 0; i < a->i_planes; i++)
+        for (int y = 0; y < a->p[i].i_visible_lines; y++)
+            for (int x = 0; x < a->p[i].i_visible_pitch; x++)
+            {
+                int d = abs(a->p[i].p_pixels[y * a->p[i].i_pitch + x]
+                          - b->p[i].p_pixels[y * b->p[i].i_pitch + x]);
+                sum += d;
+                count++;
+                if (d > max)
+                    max = d;
+            }
+    *mean = (double)sum / count;
+    return max;
+}
+
+int main(void)
+{
+    test_init();
+
+    libvlc_instance_t *vlc = libvlc_new(test_defaults_nargs,
+                                        test_defaults_args);
+    assert(vlc != NULL);
+    vlc_object_t *obj = VLC_OBJECT(vlc->p_libvlc_int);
+    libvlc_log_set(vlc, Log, NULL);
+
+    for (size_t i = 0; i < ARRAY_SIZE(pairs); i++)
+    {
+        filter_t *reference = CreateConverter(obj, pairs[i].in,
+                                              pairs[i].out, "swscale");
+        if (reference == NULL)
+        {
+            test_log("no swscale for %4.4s -> %4.4s, skipping\n",
+                     (const char *)&pairs[i].in, (const char *)&pairs[i].out);
+            continue;
+        }
+        fused_taken = false;
+        filter_t *fused = CreateConverter(obj, pairs[i].in, pairs[i].out,
+                                          "chain");
+        assert(fused != NULL);
+        assert(fused_taken == pairs[i].fused);
+
+        picture_t *src = picture_New(pairs[i].in, SRC_WIDTH, SRC_HEIGHT,
+                                     1, 1);
+        assert(src != NULL);
+        Fill(src);
+
+        picture_t *ref = reference->ops->filter_video(reference,
+                                                      picture_Hold(src));
+        picture_t *dst = fused->ops->filter_video(fused, picture_Hold(src));
+        assert(ref != NULL && dst != NULL);
+
+        double mean;
+        int max = Compare(ref, dst, &mean);
+        test_log("%4.4s -> %4.4s: max diff %d, mean %.3f\n",
+                 (const char *)&pairs[i].in, (const char *)&pairs[i].out,
+                 max, mean);
+        /* Levels would be off by several steps in average, were the range
+         * not converted */
+        assert(mean < 1.5);
+        assert(max <= 8);
+
+        picture_Release(dst);
+        picture_Release(ref);
+        picture_Release(src);
+        DeleteConverter(fused);
+        DeleteConverter(reference);
+    }
+
+    libvlc_log_unset(vlc);
+    libvlc_release(vlc);
+    return 0;
+}
@@ -0,0 +1,219 @@
+/*****************************************************************************
+ * swscale.c: sliced swscale scaler test and benchmark
+ *****************************************************************************
+ * Copyright (C) 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <vlc/vlc.h>
+
+#include "../../../lib/libvlc_internal.h"
+
+#include <vlc_common.h>
+#include <vlc_modules.h>
+#include <vlc_filter.h>
+#include <vlc_picture.h>
+#include <vlc_tick.h>
+
+#include "../../libvlc/test.h"
+
+/* Built with BENCH defined, the program also prints the frame rates */
+#ifdef BENCH
+# define FRAMES 50
+#else
+# define FRAMES 1
+#endif
+
+/* The last ones scale subsampled chroma planes at odd ratios, with band
+ * limits in the middle of their filter taps */
+static const struct
+{
+    vlc_fourcc_t in, out;
+    unsigned src_width, src_height;
+    unsigned dst_width, dst_height;
+} scales[] = {
+    { VLC_CODEC_I420, VLC_CODEC_I420, 3840, 2160, 1920, 1080 },
+    { VLC_CODEC_I420, VLC_CODEC_I420, 3840, 2160, 1280,  720 },
+    { VLC_CODEC_I420, VLC_CODEC_I420, 1920, 1080, 1280,  720 },
+    { VLC_CODEC_I420, VLC_CODEC_I420, 1920, 1080,  960,  540 },
+    { VLC_CODEC_I420, VLC_CODEC_I420, 1920, 1080, 1152,  648 },
+    { VLC_CODEC_I444, VLC_CODEC_I420, 1920, 1080, 1440,  810 },
+    { VLC_CODEC_I420, VLC_CODEC_I444, 2560, 1440, 1120,  630 },
+};
+
+static const unsigned thread_counts[] = { 1, 2, 4, 8 };
+
+static filter_t *CreateScaler(vlc_object_t *parent, vlc_fourcc_t in,
+                              vlc_fourcc_t out,
+                              unsigned src_width, unsigned src_height,
+                              unsigned dst_width, unsigned dst_height,
+                              unsigned threads)
+{
+    filter_t *filter = vlc_object_create(parent, sizeof (*filter));
+    assert(filter != NULL);
+
+    es_format_Init(&filter->fmt_in, VIDEO_ES, in);
+    video_format_Setup(&filter->fmt_in.video, in, src_width, src_height,
+                       src_width, src_height, 1, 1);
+    es_format_Init(&filter->fmt_out, VIDEO_ES, out);
+    video_format_Setup(&filter->fmt_out.video, out, dst_width, dst_height,
+                       dst_width, dst_height, 1, 1);
+
+    var_Create(filter, "swscale-threads", VLC_VAR_INTEGER);
+    var_SetInteger(filter, "swscale-threads", threads);
+
+    filter->p_module = module_need(filter, "video converter", "swscale", true);
+    if (filter->p_module == NULL)
+    {
+        es_format_Clean(&filter->fmt_in);
+        es_format_Clean(&filter->fmt_out);
+        vlc_object_delete(filter);
+        return NULL;
+    }
+    return filter;
+}
+
+static void DeleteScaler(filter_t *filter)
+{
+    filter_Close(filter);
+    module_unneed(filter, filter->p_module);
+    es_format_Clean(&filter->fmt_in);
+    es_format_Clean(&filter->fmt_out);
+    vlc_object_delete(filter);
+}
+
+static void Fill(picture_t *pic)
+{
+    for (int i = 0; i < pic->i_planes; i++)
+    {
+        plane_t *p = &pic->p[i];
+        for (int y = 0; y < p->i_lines; y++)
+            for (int x = 0; x < p->i_pitch; x++)
+                p->p_pixels[y * p->i_pitch + x] =
+                    (x * 7 + y * 13 + ((x * y) >> 6) + i * 50) & 0xff;
+    }
+}
+
+/* Largest difference between two pictures */
+static int Compare(const picture_t *a, const picture_t *b)
+{
+    int max = 0;
+
+    for (int i = 0; i < a->i_planes; i++)
+        for (int y = 0; y < a->p[i].i_visible_lines; y++)
+            for (int x = 0; x < a->p[i].i_visible_pitch; x++)
+            {
+                int d = abs(a->p[i].p_pixels[y * a->p[i].i_pitch + x]
+                          - b->p[i].p_pixels[y * b->p[i].i_pitch + x]);
+                if (d > max)
+                    max = d;
+            }
+    return max;
+}
+
+/* Scales FRAMES pictures, returns the last one */
+static picture_t *Run(filter_t *filter, picture_t *src, unsigned threads)
+{
+    picture_t *dst = NULL;
+    vlc_tick_t start = vlc_tick_now();
+
+    for (unsigned i = 0; i < FRAMES; i++)
+    {
+        if (dst != NULL)
+            picture_Release(dst);
+        dst = filter->ops->filter_video(filter, picture_Hold(src));
+        assert(dst != NULL);
+    }
+#ifdef BENCH
+    const vlc_tick_t elapsed = vlc_tick_now() - start;
+    const video_format_t *in = &filter->fmt_in.video;
+    const video_format_t *out = &filter->fmt_out.video;
+    test_log("%4.4s %ux%u -> %4.4s %ux%u, %u thread(s): %.1f fps\n",
+             (const char *)&in->i_chroma,
+             in->i_visible_width, in->i_visible_height,
+             (const char *)&out->i_chroma,
+             out->i_visible_width, out->i_visible_height, threads,
+             FRAMES * (double)CLOCK_FREQ / (elapsed > 0 ? elapsed : 1));
+#else
+    (void)start; (void)threads;
+#endif
+    return dst;
+}
+
+int main(void)
+{
+    test_init();
+
+    libvlc_instance_t *vlc = libvlc_new(test_defaults_nargs,
+                                        test_defaults_args);
+    assert(vlc != NULL);
+    vlc_object_t *obj = VLC_OBJECT(vlc->p_libvlc_int);
+
+    for (size_t i = 0; i < ARRAY_SIZE(scales); i++)
+    {
+        picture_t *src = picture_New(scales[i].in, scales[i].src_width,
+                                     scales[i].src_height, 1, 1);
+        assert(src != NULL);
+        Fill(src);
+
+        picture_t *ref = NULL;
+        for (size_t j = 0; j < ARRAY_SIZE(thread_counts); j++)
+        {
+            filter_t *filter = CreateScaler(obj, scales[i].in, scales[i].out,
+                                            scales[i].src_width,
+                                            scales[i].src_height,
+                                            scales[i].dst_width,
+                                            scales[i].dst_height,
+                                            thread_counts[j]);
+            if (filter == NULL)
+            {
+                test_log("swscale not available, skipping\n");
+                picture_Release(src);
+                libvlc_release(vlc);
+                return 77;
+            }
+
+            picture_t *dst = Run(filter, src, thread_counts[j]);
+            DeleteScaler(filter);
+
+            if (ref == NULL)
+            {
+                ref = dst;
+                continue;
+            }
+
+            /* Bands scale the same source lines with the same filters as
+             * the single context, a seam or a misplaced line would show */
+            int max = Compare(ref, dst);
+            test_log("%4.4s %ux%u -> %4.4s %ux%u, %u thread(s): "
+                     "max diff %d\n", (const char *)&scales[i].in,
+                     scales[i].src_width, scales[i].src_height,
+                     (const char *)&scales[i].out,
+                     scales[i].dst_width, scales[i].dst_height,
+                     thread_counts[j], max);
+            assert(max <= 1);
+            picture_Release(dst);
+        }
+        picture_Release(ref);
+        picture_Release(src);
+    }
+
+    libvlc_release(vlc);
+    return 0;
+}
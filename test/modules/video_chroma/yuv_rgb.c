@@ -0,0 +1,347 @@
+/*****************************************************************************
+ * yuv_rgb.c: SIMD YUV to RGB conversions test and benchmark
+ *****************************************************************************
+ * Copyright (C) 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <math.h>
+
+#include <vlc/vlc.h>
+
+#include "../../../lib/libvlc_internal.h"
+
+#include <vlc_common.h>
+#include <vlc_modules.h>
+#include <vlc_filter.h>
+#include <vlc_picture.h>
+#include <vlc_tick.h>
+
+#include "../../../modules/video_chroma/yuv_rgb_simd.h"
+
+#include "../../libvlc/test.h"
+
+#define WIDTH  1917 /* odd, and not a multiple of any vector size */
+#define HEIGHT 7
+#define BENCH_WIDTH  1920
+#define BENCH_HEIGHT 1080
+#define BENCH_FRAMES 20
+
+static const vlc_fourcc_t inputs[] = {
+    VLC_CODEC_I420, VLC_CODEC_J420, VLC_CODEC_YV12, VLC_CODEC_NV12,
+    VLC_CODEC_I420_10L, VLC_CODEC_P010,
+};
+
+static const struct
+{
+    vlc_fourcc_t chroma;
+    uint32_t rmask, gmask, bmask;
+} outputs[] = {
+    { VLC_CODEC_RGBA, 0, 0, 0 },
+    { VLC_CODEC_BGRA, 0, 0, 0 },
+    { VLC_CODEC_RGB24, 0xff0000, 0x00ff00, 0x0000ff },
+    { VLC_CODEC_RGB24, 0x0000ff, 0x00ff00, 0xff0000 },
+};
+
+static const char *const isa_names[] = { "C", "AVX2", "AVX-512", "NEON" };
+
+static uint32_t seed = 1;
+
+static unsigned Random(void)
+{
+    seed = seed * 1103515245 + 12345;
+    return seed >> 16;
+}
+
+/* Fills the picture with random samples; with garbage, the unused bits of
+ * 10-bit samples are set as well */
+static void Fill(picture_t *pic, bool garbage)
+{
+    const vlc_fourcc_t chroma = pic->format.i_chroma;
+    const bool high = chroma == VLC_CODEC_I420_10L || chroma == VLC_CODEC_P010;
+
+    for (int i = 0; i < pic->i_planes; i++)
+    {
+        plane_t *p = &pic->p[i];
+
+        for (int y = 0; y < p->i_lines; y++)
+        {
+            uint8_t *row = &p->p_pixels[y * p->i_pitch];
+
+            for (int x = 0; x < p->i_pitch / (high ? 2 : 1); x++)
+            {
+                unsigned v = Random();
+
+                if (!high)
+                    row[x] = v;
+                else if (garbage)
+                    ((uint16_t *)row)[x] = v;
+                else if (chroma == VLC_CODEC_P010)
+                    ((uint16_t *)row)[x] = (v & 0x3ff) << 6;
+                else
+                    ((uint16_t *)row)[x] = v & 0x3ff;
+            }
+        }
+    }
+}
+
+static void SetupFormats(video_format_t *in, video_format_t *out,
+                         vlc_fourcc_t chroma, size_t output,
+                         unsigned width, unsigned height)
+{
+    video_format_Init(in, chroma);
+    video_format_Setup(in, chroma, width, height, width, height, 1, 1);
+    video_format_Init(out, outputs[output].chroma);
+    video_format_Setup(out, outputs[output].chroma, width, height,
+                       width, height, 1, 1);
+    out->i_rmask = outputs[output].rmask;
+    out->i_gmask = outputs[output].gmask;
+    out->i_bmask = outputs[output].bmask;
+}
+
+static bool SamePixels(const picture_t *a, const picture_t *b)
+{
+    const plane_t *pa = &a->p[0], *pb = &b->p[0];
+
+    for (int y = 0; y < pa->i_visible_lines; y++)
+        if (memcmp(&pa->p_pixels[y * pa->i_pitch],
+                   &pb->p_pixels[y * pb->i_pitch], pa->i_visible_pitch))
+            return false;
+    return true;
+}
+
+/* Every implementation must produce the same pictures as the C one */
+static void TestExact(void)
+{
+    unsigned compared = 0;
+
+    for (size_t i = 0; i < ARRAY_SIZE(inputs); i++)
+        for (size_t o = 0; o < ARRAY_SIZE(outputs); o++)
+            for (int space = COLOR_SPACE_BT601; space <= COLOR_SPACE_BT2020;
+                 space++)
+                for (int range = COLOR_RANGE_FULL;
+                     range <= COLOR_RANGE_LIMITED; range++)
+                {
+                    video_format_t in, out;
+
+                    SetupFormats(&in, &out, inputs[i], o, WIDTH, HEIGHT);
+                    in.space = space;
+                    in.color_range = range;
+
+                    picture_t *src = picture_NewFromFormat(&in);
+                    picture_t *ref = picture_NewFromFormat(&out);
+                    picture_t *dst = picture_NewFromFormat(&out);
+                    assert(src != NULL && ref != NULL && dst != NULL);
+
+                    yuv_rgb_t *c = yuv_rgb_New(&in, &out, YUV_RGB_ISA_C);
+                    assert(c != NULL);
+
+                    for (int garbage = 0; garbage < 2; garbage++)
+                    {
+                        Fill(src, garbage);
+                        yuv_rgb_Convert(c, ref, src);
+
+                        for (int isa = YUV_RGB_ISA_AVX2;
+                             isa <= YUV_RGB_ISA_NEON; isa++)
+                        {
+                            yuv_rgb_t *conv = yuv_rgb_New(&in, &out, isa);
+                            if (conv == NULL)
+                                continue;
+
+                            yuv_rgb_Convert(conv, dst, src);
+                            if (!SamePixels(ref, dst))
+                            {
+                                test_log("%4.4s to %4.4s (space %d, range %d)"
+                                         " differs with %s\n",
+                                         (const char *)&in.i_chroma,
+                                         (const char *)&out.i_chroma,
+                                         space, range, isa_names[isa]);
+                                assert(!"not bit exact");
+                            }
+                            yuv_rgb_Delete(conv);
+                            compared++;
+                        }
+                    }
+
+                    yuv_rgb_Delete(c);
+                    picture_Release(dst);
+                    picture_Release(ref);
+                    picture_Release(src);
+                }
+
+    test_log("%u conversions bit exact\n", compared);
+}
+
+/* The fixed point results must stay close to the exact conversion */
+static void TestAccuracy(void)
+{
+    video_format_t in, out;
+
+    SetupFormats(&in, &out, VLC_CODEC_I420, 0, WIDTH, HEIGHT);
+    in.space = COLOR_SPACE_BT709;
+    in.color_range = COLOR_RANGE_LIMITED;
+
+    picture_t *src = picture_NewFromFormat(&in);
+    picture_t *dst = picture_NewFromFormat(&out);
+    assert(src != NULL && dst != NULL);
+    Fill(src, false);
+
+    yuv_rgb_t *conv = yuv_rgb_New(&in, &out, YUV_RGB_ISA_C);
+    assert(conv != NULL);
+    yuv_rgb_Convert(conv, dst, src);
+    yuv_rgb_Delete(conv);
+
+    const double kr = .2126, kb = .0722, kg = 1. - kr - kb;
+    int max = 0;
+
+    for (unsigned y = 0; y < HEIGHT; y++)
+        for (unsigned x = 0; x < WIDTH; x++)
+        {
+            const double l = (src->p[0].p_pixels[y * src->p[0].i_pitch + x]
+                              - 16) * 255. / 219.;
+            const double u = (src->p[1].p_pixels[y / 2 * src->p[1].i_pitch
+                              + x / 2] - 128) * 255. / 224.;
+            const double v = (src->p[2].p_pixels[y / 2 * src->p[2].i_pitch
+                              + x / 2] - 128) * 255. / 224.;
+            const double rgb[3] = {
+                l + 2. * (1. - kr) * v,
+                l - 2. * kb * (1. - kb) / kg * u - 2. * kr * (1. - kr) / kg * v,
+                l + 2. * (1. - kb) * u,
+            };
+            const uint8_t *px = &dst->p[0].p_pixels[y * dst->p[0].i_pitch
+                                                    + 4 * x];
+
+            for (unsigned i = 0; i < 3; i++)
+            {
+                const int exact = lround(fmin(fmax(rgb[i], 0.), 255.));
+                const int diff = abs(exact - px[i]);
+                if (diff > max)
+                    max = diff;
+            }
+        }
+
+    test_log("largest difference with the exact conversion: %d\n", max);
+    assert(max <= 1);
+    picture_Release(dst);
+    picture_Release(src);
+}
+
+static double Bench(yuv_rgb_t *conv, picture_t *dst, picture_t *src)
+{
+    vlc_tick_t start = vlc_tick_now();
+
+    for (unsigned i = 0; i < BENCH_FRAMES; i++)
+        yuv_rgb_Convert(conv, dst, src);
+    return BENCH_FRAMES * (double)CLOCK_FREQ / (vlc_tick_now() - start);
+}
+
+/* Throughput of the existing I420 to RGB32 modules, if they are built */
+static void BenchLegacy(picture_t *src)
+{
+    libvlc_instance_t *vlc = libvlc_new(test_defaults_nargs,
+                                        test_defaults_args);
+    assert(vlc != NULL);
+
+    filter_t *filter = vlc_object_create(vlc->p_libvlc_int, sizeof (*filter));
+    assert(filter != NULL);
+
+    es_format_Init(&filter->fmt_in, VIDEO_ES, VLC_CODEC_I420);
+    video_format_Copy(&filter->fmt_in.video, &src->format);
+    es_format_Init(&filter->fmt_out, VIDEO_ES, VLC_CODEC_RGB32);
+    video_format_Setup(&filter->fmt_out.video, VLC_CODEC_RGB32,
+                       BENCH_WIDTH, BENCH_HEIGHT, BENCH_WIDTH, BENCH_HEIGHT,
+                       1, 1);
+    filter->fmt_out.video.i_rmask = 0x00ff0000;
+    filter->fmt_out.video.i_gmask = 0x0000ff00;
+    filter->fmt_out.video.i_bmask = 0x000000ff;
+
+    filter->p_module = module_need(filter, "video converter",
+                                   "i420_rgb_sse2,i420_rgb_mmx,i420_rgb", true);
+    if (filter->p_module != NULL)
+    {
+        picture_t *dst = NULL;
+        vlc_tick_t start = vlc_tick_now();
+
+        for (unsigned i = 0; i < BENCH_FRAMES; i++)
+        {
+            if (dst != NULL)
+                picture_Release(dst);
+            dst = filter->ops->filter_video(filter, picture_Hold(src));
+            assert(dst != NULL);
+        }
+        test_log("I420 to RV32 with %s: %.1f fps\n",
+                 module_get_object(filter->p_module),
+                 BENCH_FRAMES * (double)CLOCK_FREQ / (vlc_tick_now() - start));
+        picture_Release(dst);
+
+        filter_Close(filter);
+        module_unneed(filter, filter->p_module);
+    }
+    else
+        test_log("i420_rgb not available\n");
+
+    es_format_Clean(&filter->fmt_in);
+    es_format_Clean(&filter->fmt_out);
+    vlc_object_delete(filter);
+    libvlc_release(vlc);
+}
+
+static void TestBench(void)
+{
+    for (size_t i = 0; i < ARRAY_SIZE(inputs); i++)
+    {
+        video_format_t in, out;
+
+        if (inputs[i] == VLC_CODEC_J420 || inputs[i] == VLC_CODEC_YV12)
+            continue;
+        SetupFormats(&in, &out, inputs[i], 1, BENCH_WIDTH, BENCH_HEIGHT);
+
+        picture_t *src = picture_NewFromFormat(&in);
+        picture_t *dst = picture_NewFromFormat(&out);
+        assert(src != NULL && dst != NULL);
+        Fill(src, false);
+
+        for (int isa = YUV_RGB_ISA_C; isa <= YUV_RGB_ISA_NEON; isa++)
+        {
+            yuv_rgb_t *conv = yuv_rgb_New(&in, &out, isa);
+            if (conv == NULL)
+                continue;
+            test_log("%4.4s to BGRA with %s: %.1f fps\n",
+                     (const char *)&in.i_chroma, isa_names[isa],
+                     Bench(conv, dst, src));
+            yuv_rgb_Delete(conv);
+        }
+
+        if (inputs[i] == VLC_CODEC_I420)
+            BenchLegacy(src);
+
+        picture_Release(dst);
+        picture_Release(src);
+    }
+}
+
+int main(void)
+{
+    test_init();
+
+    TestExact();
+    TestAccuracy();
+    TestBench();
+    return 0;
+}
@@ -0,0 +1,139 @@
+/*****************************************************************************
+ * fps_mci.c: motion compensated interpolation test and benchmark
+ *****************************************************************************
+ * Copyright (C) 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <math.h>
+
+#include <vlc_common.h>
+#include <vlc_picture.h>
+
+#include "../../../modules/video_filter/fps_mci.h"
+
+#include "../../libvlc/test.h"
+
+#define WIDTH  1920
+#define HEIGHT 1080
+#define BORDER 32
+#define BENCH_FRAMES 24
+
+static uint8_t Texture(int x, int y)
+{
+    const double v = 128. + 60. * sin(x * .07) * cos(y * .05)
+                   + 30. * sin((x + 2 * y) * .13);
+    return lround(v);
+}
+
+/* Fills the luma with the texture moved by (dx, dy) and a flat chroma */
+static void Fill(picture_t *pic, int dx, int dy)
+{
+    for (int y = 0; y < pic->p[0].i_visible_lines; y++)
+        for (int x = 0; x < pic->p[0].i_visible_pitch; x++)
+            pic->p[0].p_pixels[y * pic->p[0].i_pitch + x] =
+                Texture(x - dx, y - dy);
+    for (int i = 1; i < pic->i_planes; i++)
+        memset(pic->p[i].p_pixels, 128,
+               pic->p[i].i_pitch * pic->p[i].i_lines);
+}
+
+/* Mean absolute luma difference, away from the picture edges */
+static double Error(const picture_t *a, const picture_t *b)
+{
+    uint64_t sum = 0;
+    unsigned count = 0;
+
+    for (int y = BORDER; y < a->p[0].i_visible_lines - BORDER; y++)
+        for (int x = BORDER; x < a->p[0].i_visible_pitch - BORDER; x++)
+        {
+            sum += abs(a->p[0].p_pixels[y * a->p[0].i_pitch + x]
+                     - b->p[0].p_pixels[y * b->p[0].i_pitch + x]);
+            count++;
+        }
+    return (double)sum / count;
+}
+
+static int Run(int quality, unsigned threads)
+{
+    video_format_t fmt;
+    video_format_Init(&fmt, VLC_CODEC_I420);
+    video_format_Setup(&fmt, VLC_CODEC_I420, WIDTH, HEIGHT, WIDTH, HEIGHT,
+                       1, 1);
+
+    fps_mci_t *mci = fps_mci_New(&fmt, quality, threads);
+    assert(mci != NULL);
+
+    picture_t *prev = picture_NewFromFormat(&fmt);
+    picture_t *cur = picture_NewFromFormat(&fmt);
+    picture_t *expected = picture_NewFromFormat(&fmt);
+    picture_t *out = picture_NewFromFormat(&fmt);
+    assert(prev && cur && expected && out);
+
+    Fill(prev, 0, 0);
+    Fill(cur, 8, 4);
+    Fill(expected, 4, 2);
+
+    assert(fps_mci_Interpolate(mci, out, 128) == VLC_EGENERIC);
+    fps_mci_Push(mci, prev);
+    fps_mci_Push(mci, cur);
+
+    /* The end points are the source pictures */
+    assert(fps_mci_Interpolate(mci, out, 0) == VLC_SUCCESS);
+    assert(Error(out, prev) == 0.);
+    assert(fps_mci_Interpolate(mci, out, 256) == VLC_SUCCESS);
+    assert(Error(out, cur) == 0.);
+
+    /* Half-way, the texture must have moved half-way */
+    assert(fps_mci_Interpolate(mci, out, 128) == VLC_SUCCESS);
+    const double error = Error(out, expected);
+    test_log("quality %d: mean error %.2f\n", quality, error);
+    assert(error < 1.);
+
+    /* Benchmark: one estimation and two interpolated pictures per source
+     * picture, as for a 25 to 60 fps conversion */
+    const vlc_tick_t start = vlc_tick_now();
+    for (unsigned i = 0; i < BENCH_FRAMES; i++)
+    {
+        fps_mci_Push(mci, (i & 1) ? cur : prev);
+        fps_mci_Interpolate(mci, out, 106);
+        fps_mci_Interpolate(mci, out, 213);
+    }
+    const vlc_tick_t elapsed = vlc_tick_now() - start;
+    test_log("quality %d, %u thread(s): %.1f source fps at %dx%d\n",
+             quality, threads, BENCH_FRAMES * (double)CLOCK_FREQ / elapsed,
+             WIDTH, HEIGHT);
+
+    fps_mci_Delete(mci);
+    picture_Release(out);
+    picture_Release(expected);
+    picture_Release(cur);
+    picture_Release(prev);
+    return 0;
+}
+
+int main(void)
+{
+    test_init();
+
+    for (int quality = FPS_MCI_FAST; quality <= FPS_MCI_HIGH; quality++)
+        Run(quality, 1);
+    Run(FPS_MCI_NORMAL, 0);
+    return 0;
+}
@@ -26,6 +26,7 @@
 #include <vlc_stream.h>
 #include <vlc_rand.h>
 #include <vlc_fs.h>
+#include <vlc_modules.h>
 
 #include <inttypes.h>
 #include <limits.h>
@@ -34,7 +35,8 @@
 #include <unistd.h>
 
 #ifndef TEST_NET
-#define RAND_FILE_SIZE (1024 * 1024)
+/* Larger than a memory mapped window of the file access */
+#define RAND_FILE_SIZE (10 * 1024 * 1024)
 #else
 #define HTTP_URL "http://streams.videolan.org/streams/ogm/MJPEG.ogm"
 #define HTTP_MD5 "4eaf9e8837759b670694398a33f02bc0"
@@ -183,7 +185,7 @@ stream_close( struct reader *p_reader )
 }
 
 static struct reader *
-stream_open( const char *psz_url )
+stream_open( const char *psz_url, bool b_mmap, bool b_uring )
 {
     libvlc_instance_t *p_vlc;
     struct reader *p_reader;
@@ -195,6 +197,7 @@ stream_open( const char *psz_url )
         "--no-media-library",
         "--vout=dummy",
         "--aout=dummy",
+        b_mmap ? "--file-mmap" : "--no-file-mmap",
     };
 
     p_reader = calloc( 1, sizeof(struct reader) );
@@ -203,6 +206,19 @@ stream_open( const char *psz_url )
     p_vlc = libvlc_new( ARRAY_SIZE(argv), argv );
     assert( p_vlc != NULL );
 
+    if( b_uring )
+    {
+        /* The option only exists if the module is built */
+        if( !module_exists( "uring" ) )
+        {
+            libvlc_release( p_vlc );
+            free( p_reader );
+            return NULL;
+        }
+        var_Create( p_vlc->p_libvlc_int, "file-uring", VLC_VAR_BOOL );
+        var_SetBool( p_vlc->p_libvlc_int, "file-uring", true );
+    }
+
     p_reader->u.s = vlc_stream_NewURL( p_vlc->p_libvlc_int, psz_url );
     if( !p_reader->u.s )
     {
@@ -217,7 +233,8 @@ stream_open( const char *psz_url )
     p_reader->pf_tell = stream_tell;
     p_reader->pf_seek = stream_seek;
     p_reader->p_data = p_vlc;
-    p_reader->psz_name = "stream";
+    p_reader->psz_name = b_mmap ? "mmap stream"
+                       : b_uring ? "uring stream" : "stream";
     return p_reader;
 }
 
@@ -363,7 +380,7 @@ fill_rand( int i_fd, size_t i_size )
 int
 main( void )
 {
-    struct reader *pp_readers[3];
+    struct reader *pp_readers[4];
 
     test_init();
 
@@ -375,15 +392,21 @@ main( void )
     test_log( "Generating random file...\n" );
     i_tmp_fd = vlc_mkstemp( psz_tmp_path );
     fill_rand( i_tmp_fd, RAND_FILE_SIZE );
-    test_log( "Testing random file with libc, and stream...\n" );
+    test_log( "Testing random file with libc, stream, mmap stream and uring stream...\n" );
     assert( i_tmp_fd != -1 );
     assert( asprintf( &psz_url, "file://%s", psz_tmp_path ) != -1 );
 
     assert( ( pp_readers[0] = libc_open( psz_tmp_path ) ) );
-    assert( ( pp_readers[1] = stream_open( psz_url ) ) );
-
-    test( pp_readers, 2, NULL );
-    for( unsigned int i = 0; i < 2; ++i )
+    assert( ( pp_readers[1] = stream_open( psz_url, false, false ) ) );
+    assert( ( pp_readers[2] = stream_open( psz_url, true, false ) ) );
+    unsigned int i_readers = 3;
+    if( ( pp_readers[3] = stream_open( psz_url, false, true ) ) )
+        i_readers++;
+    else
+        test_log( "WARNING: uring module not built, skipping it\n" );
+
+    test( pp_readers, i_readers, NULL );
+    for( unsigned int i = 0; i < i_readers; ++i )
         pp_readers[i]->pf_close( pp_readers[i] );
     free( psz_url );
 
@@ -392,7 +415,7 @@ main( void )
 
     test_log( "Testing http url with stream...\n" );
     alarm( 0 );
-    if( !( pp_readers[0] = stream_open( HTTP_URL ) ) )
+    if( !( pp_readers[0] = stream_open( HTTP_URL, false, false ) ) )
     {
         test_log( "WARNING: can't test http url" );
         return 0;
@@ -0,0 +1,136 @@
+/*****************************************************************************
+ * stats.c: stream output statistics test
+ *****************************************************************************
+ * Copyright (C) 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <vlc/vlc.h>
+
+#include "../../../lib/libvlc_internal.h"
+
+#include <vlc_common.h>
+#include <vlc_sout.h>
+#include <vlc_block.h>
+#include <vlc_es.h>
+#include <vlc_tick.h>
+
+#include "../../libvlc/test.h"
+
+/* 4 seconds of a 25 frames per second video */
+#define FRAMES 100
+#define FRAME_SIZE 1000
+#define FRAME_PERIOD VLC_TICK_FROM_MS(40)
+
+/* Reads a counter following a key in the JSON statistics */
+static uintmax_t Counter(const char *json, const char *key)
+{
+    char pattern[64];
+    uintmax_t value;
+
+    snprintf(pattern, sizeof (pattern), "\"%s\":", key);
+    const char *p = strstr(json, pattern);
+    assert(p != NULL);
+    assert(sscanf(p + strlen(pattern), "%ju", &value) == 1);
+    return value;
+}
+
+int main(void)
+{
+    test_init();
+
+    libvlc_instance_t *vlc = libvlc_new(test_defaults_nargs,
+                                        test_defaults_args);
+    assert(vlc != NULL);
+
+    vlc_object_t *obj = VLC_OBJECT(vlc->p_libvlc_int);
+    /* The muxers only measure their depth with the statistics enabled */
+    var_Create(obj, "sout-stats-interval", VLC_VAR_INTEGER);
+    var_SetInteger(obj, "sout-stats-interval", 1000);
+
+    char path[] = "/tmp/vlc-test-sout-stats-XXXXXX";
+    int fd = mkstemp(path);
+    assert(fd != -1);
+    close(fd);
+
+    char chain[128];
+    snprintf(chain, sizeof (chain),
+             "duplicate{dst=std{access=file,mux=raw,dst=%s}}", path);
+    sout_stream_t *stream = sout_StreamChainNew(obj, chain, NULL);
+    assert(stream != NULL);
+
+    es_format_t fmt;
+    es_format_Init(&fmt, VIDEO_ES, VLC_CODEC_MP4V);
+    fmt.i_id = 1;
+    void *id = sout_StreamIdAdd(stream, &fmt);
+    assert(id != NULL);
+
+    for (unsigned i = 0; i < FRAMES; i++)
+    {
+        block_t *block = block_Alloc(FRAME_SIZE);
+        assert(block != NULL);
+
+        memset(block->p_buffer, i, FRAME_SIZE);
+        block->i_dts = block->i_pts = VLC_TICK_0 + i * FRAME_PERIOD;
+        assert(sout_StreamIdSend(stream, id, block) == VLC_SUCCESS);
+    }
+
+    struct sout_stream_stats stats;
+    assert(sout_StreamGetStats(stream, &stats) == VLC_SUCCESS);
+    assert(stats.blocks_in == FRAMES && stats.bytes_in == FRAMES * FRAME_SIZE);
+    assert(stats.blocks_out == FRAMES && stats.bytes_out == FRAMES * FRAME_SIZE);
+    assert(stats.errors == 0);
+    assert(stats.time.count == FRAMES);
+
+    uint64_t count = 0;
+    for (size_t i = 0; i < SOUT_STATS_BUCKETS; i++)
+        count += stats.time.buckets[i];
+    assert(count == FRAMES);
+
+    char *json = sout_StreamChainGetStats(stream, NULL);
+    assert(json != NULL);
+    test_log("%s\n", json);
+
+    /* The chain of the duplicate stream, with its output */
+    const char *branch = strstr(json, "\"chains\":[[{\"name\":\"std\"");
+    assert(branch != NULL);
+    assert(Counter(branch, "blocks_in") == FRAMES);
+    const char *output = strstr(branch, "\"outputs\":[{\"access\":\"file\"");
+    assert(output != NULL);
+    const char *mux = strstr(output, "\"muxes\":[{\"mux\":\"raw\"");
+    assert(mux != NULL);
+
+    /* The muxer waited for its caching before writing */
+    assert(Counter(mux, "blocks") == FRAMES);
+    assert(Counter(mux, "depth_max") > 1);
+    assert(Counter(output, "blocks") > 0);
+    assert(Counter(strstr(output, "\"latency\":"), "count") > 0);
+    free(json);
+
+    sout_StreamIdDel(stream, id);
+    sout_StreamChainDelete(stream, NULL);
+    unlink(path);
+
+    libvlc_release(vlc);
+    return 0;
+}
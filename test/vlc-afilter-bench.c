@@ -0,0 +1,728 @@
+/**
+ * @file vlc-afilter-bench.c
+ * Audio filter chain benchmark
+ */
+/*****************************************************************************
+ * Copyright (C) 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <errno.h>
+#include <getopt.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <vlc/vlc.h>
+
+#include "../lib/libvlc_internal.h"
+
+#include <vlc_common.h>
+#include <vlc_aout.h>
+#include <vlc_block.h>
+#include <vlc_filter.h>
+#include <vlc_modules.h>
+#include <vlc_variables.h>
+
+/*
+ * Counts the allocations of the benchmark thread while a filter runs.
+ */
+#ifdef __GLIBC__
+# define HAVE_ALLOCATION_COUNT 1
+
+extern void *__libc_malloc(size_t);
+extern void *__libc_calloc(size_t, size_t);
+extern void *__libc_realloc(void *, size_t);
+extern void *__libc_memalign(size_t, size_t);
+
+static _Thread_local bool counting;
+static _Thread_local unsigned long allocations;
+
+static inline void Count(void)
+{
+    if (counting)
+        allocations++;
+}
+
+void *malloc(size_t size)
+{
+    Count();
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t n, size_t size)
+{
+    Count();
+    return __libc_calloc(n, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+    Count();
+    return __libc_realloc(ptr, size);
+}
+
+void *aligned_alloc(size_t align, size_t size)
+{
+    Count();
+    return __libc_memalign(align, size);
+}
+
+int posix_memalign(void **ptr, size_t align, size_t size)
+{
+    Count();
+
+    void *p = __libc_memalign(align, size);
+    if (p == NULL)
+        return ENOMEM;
+    *ptr = p;
+    return 0;
+}
+#else
+static bool counting;
+static unsigned long allocations;
+#endif
+
+static uint64_t Now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * UINT64_C(1000000000) + ts.tv_nsec;
+}
+
+enum signal
+{
+    SIGNAL_SINE,
+    SIGNAL_NOISE,
+    SIGNAL_SWEEP,
+    SIGNAL_SILENCE,
+};
+
+static const char *const signal_names[] = { "sine", "noise", "sweep", "silence" };
+
+struct source
+{
+    enum signal signal;
+    audio_sample_format_t fmt;
+    uint64_t frames;        /**< total */
+    uint64_t pos;
+    uint32_t seed;
+    float *scratch;
+};
+
+/* Synthesizes interleaved frames with a peak of -6 dBFS */
+static void Synthesize(struct source *src, float *buf, size_t frames)
+{
+    const unsigned channels = src->fmt.i_channels;
+    const double rate = src->fmt.i_rate;
+
+    for (size_t i = 0; i < frames; i++)
+    {
+        const double t = (src->pos + i) / rate;
+
+        for (unsigned c = 0; c < channels; c++)
+        {
+            float v = 0.f;
+
+            switch (src->signal)
+            {
+                case SIGNAL_SINE:
+                    v = .5 * sin(2. * M_PI * 997. * t + c * M_PI / 4.);
+                    break;
+                case SIGNAL_NOISE:
+                    src->seed = src->seed * 1103515245 + 12345;
+                    v = (int)(src->seed >> 8) / (float)(1 << 24) - .5f;
+                    break;
+                case SIGNAL_SWEEP:
+                {
+                    /* logarithmic, from 20 Hz to 90 % of Nyquist */
+                    const double f0 = 20., f1 = .45 * rate;
+                    const double T = src->frames / rate, k = log(f1 / f0);
+                    v = .5 * sin(2. * M_PI * f0 * T / k
+                                 * (exp(t / T * k) - 1.));
+                    break;
+                }
+                case SIGNAL_SILENCE:
+                    break;
+            }
+            buf[i * channels + c] = v;
+        }
+    }
+}
+
+static void Store(vlc_fourcc_t format, void *dst, const float *src, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+        switch (format)
+        {
+            case VLC_CODEC_U8:
+                ((uint8_t *)dst)[i] = lrintf(src[i] * 127.f) + 128;
+                break;
+            case VLC_CODEC_S16N:
+                ((int16_t *)dst)[i] = lrintf(src[i] * 32767.f);
+                break;
+            case VLC_CODEC_S32N:
+                ((int32_t *)dst)[i] = lrint(src[i] * 2147483647.);
+                break;
+            case VLC_CODEC_FL32:
+                ((float *)dst)[i] = src[i];
+                break;
+            case VLC_CODEC_FL64:
+                ((double *)dst)[i] = src[i];
+                break;
+            default:
+                vlc_assert_unreachable();
+        }
+}
+
+static block_t *Generate(struct source *src, size_t frames)
+{
+    if (src->pos >= src->frames)
+        return NULL;
+    if (frames > src->frames - src->pos)
+        frames = src->frames - src->pos;
+
+    block_t *block = block_Alloc(frames * src->fmt.i_bytes_per_frame);
+    if (unlikely(block == NULL))
+        return NULL;
+
+    Synthesize(src, src->scratch, frames);
+    Store(src->fmt.i_format, block->p_buffer, src->scratch,
+          frames * src->fmt.i_channels);
+    block->i_nb_samples = frames;
+    block->i_pts = block->i_dts = VLC_TICK_0
+        + vlc_tick_from_samples(src->pos, src->fmt.i_rate);
+    block->i_length = vlc_tick_from_samples(frames, src->fmt.i_rate);
+    src->pos += frames;
+    return block;
+}
+
+#define MAX_STAGES 32
+
+struct stage
+{
+    filter_t *filter;
+    char *name;
+    uint64_t ns;
+    unsigned long allocations;
+    unsigned long blocks;
+    uint64_t frames_in;
+    uint64_t frames_out;
+};
+
+struct chain
+{
+    vlc_object_t *obj;
+    struct stage stages[MAX_STAGES];
+    unsigned count;
+};
+
+static filter_t *CreateFilter(vlc_object_t *obj, const char *type,
+                              const char *name,
+                              const audio_sample_format_t *infmt,
+                              const audio_sample_format_t *outfmt)
+{
+    filter_t *filter = vlc_object_create(obj, sizeof (*filter));
+    if (unlikely(filter == NULL))
+        return NULL;
+
+    es_format_Init(&filter->fmt_in, AUDIO_ES, infmt->i_format);
+    filter->fmt_in.audio = *infmt;
+    es_format_Init(&filter->fmt_out, AUDIO_ES, outfmt->i_format);
+    filter->fmt_out.audio = *outfmt;
+
+    filter->p_module = module_need(filter, type, name, name != NULL);
+    if (filter->p_module == NULL)
+    {
+        vlc_object_delete(filter);
+        return NULL;
+    }
+    return filter;
+}
+
+static void DeleteFilter(filter_t *filter)
+{
+    filter_Close(filter);
+    module_unneed(filter, filter->p_module);
+    es_format_Clean(&filter->fmt_in);
+    es_format_Clean(&filter->fmt_out);
+    vlc_object_delete(filter);
+}
+
+static int AddStage(struct chain *chain, filter_t *filter, const char *name)
+{
+    if (chain->count >= MAX_STAGES)
+    {
+        DeleteFilter(filter);
+        return VLC_EGENERIC;
+    }
+
+    struct stage *stage = &chain->stages[chain->count];
+    memset(stage, 0, sizeof (*stage));
+    stage->filter = filter;
+    if (name != NULL)
+        stage->name = strdup(name);
+    else if (asprintf(&stage->name, "converter %4.4s>%4.4s",
+                      (const char *)&filter->fmt_in.audio.i_format,
+                      (const char *)&filter->fmt_out.audio.i_format) < 0)
+        stage->name = NULL;
+    if (unlikely(stage->name == NULL))
+    {
+        DeleteFilter(filter);
+        return VLC_ENOMEM;
+    }
+    chain->count++;
+    return VLC_SUCCESS;
+}
+
+/* Converts directly or through FL32, as the audio output does */
+static int AddConverters(struct chain *chain, audio_sample_format_t *fmt,
+                         const audio_sample_format_t *target)
+{
+    if (AOUT_FMTS_IDENTICAL(fmt, target))
+        return VLC_SUCCESS;
+
+    filter_t *filter = CreateFilter(chain->obj, "audio converter", NULL,
+                                    fmt, target);
+    if (filter == NULL && fmt->i_format != VLC_CODEC_FL32
+     && target->i_format != VLC_CODEC_FL32)
+    {
+        audio_sample_format_t mid = *fmt;
+
+        mid.i_format = VLC_CODEC_FL32;
+        aout_FormatPrepare(&mid);
+        if (AddConverters(chain, fmt, &mid))
+            return VLC_EGENERIC;
+        filter = CreateFilter(chain->obj, "audio converter", NULL,
+                              fmt, target);
+    }
+    if (filter == NULL)
+    {
+        fprintf(stderr, "no converter from %4.4s to %4.4s\n",
+                (const char *)&fmt->i_format,
+                (const char *)&target->i_format);
+        return VLC_EGENERIC;
+    }
+    if (AddStage(chain, filter, NULL))
+        return VLC_EGENERIC;
+    *fmt = *target;
+    return VLC_SUCCESS;
+}
+
+static int AddFilter(struct chain *chain, const char *name,
+                     audio_sample_format_t *fmt,
+                     const audio_sample_format_t *outfmt)
+{
+    filter_t *filter = CreateFilter(chain->obj, "audio filter", name,
+                                    fmt, outfmt);
+    if (filter == NULL)
+    {
+        fprintf(stderr, "cannot create audio filter \"%s\"\n", name);
+        return VLC_EGENERIC;
+    }
+
+    audio_sample_format_t filter_in = filter->fmt_in.audio;
+    if (AddConverters(chain, fmt, &filter_in))
+    {
+        DeleteFilter(filter);
+        return VLC_EGENERIC;
+    }
+    *fmt = filter->fmt_out.audio;
+    return AddStage(chain, filter, name);
+}
+
+static void DeleteChain(struct chain *chain)
+{
+    for (unsigned i = 0; i < chain->count; i++)
+    {
+        DeleteFilter(chain->stages[i].filter);
+        free(chain->stages[i].name);
+    }
+    chain->count = 0;
+}
+
+/* Builds the chain the audio output would build from --audio-filter */
+static int CreateChain(struct chain *chain, vlc_object_t *obj,
+                       const char *filters,
+                       const audio_sample_format_t *infmt,
+                       const audio_sample_format_t *outfmt)
+{
+    audio_sample_format_t fmt = *infmt;
+    char *str = strdup(filters != NULL ? filters : "");
+    if (unlikely(str == NULL))
+        return VLC_ENOMEM;
+
+    chain->obj = obj;
+    chain->count = 0;
+
+    int ret = VLC_SUCCESS;
+    if (var_InheritBool(obj, "audio-time-stretch"))
+        ret = AddFilter(chain, "scaletempo", &fmt, outfmt);
+
+    char *p = str, *name;
+    while (ret == VLC_SUCCESS && (name = strsep(&p, " :")) != NULL)
+        if (*name != '\0')
+            ret = AddFilter(chain, name, &fmt, outfmt);
+    free(str);
+
+    if (ret == VLC_SUCCESS)
+        ret = AddConverters(chain, &fmt, outfmt);
+    if (ret != VLC_SUCCESS)
+        DeleteChain(chain);
+    return ret;
+}
+
+static void RunChain(struct chain *chain, struct source *src, size_t frames)
+{
+    block_t *block;
+
+    while ((block = Generate(src, frames)) != NULL)
+    {
+        for (unsigned i = 0; i < chain->count && block != NULL; i++)
+        {
+            struct stage *stage = &chain->stages[i];
+            filter_t *filter = stage->filter;
+
+            stage->frames_in += block->i_nb_samples;
+            stage->blocks++;
+
+            allocations = 0;
+            counting = true;
+            uint64_t start = Now();
+            block = filter->ops->filter_audio(filter, block);
+            stage->ns += Now() - start;
+            counting = false;
+            stage->allocations += allocations;
+
+            if (block != NULL)
+                stage->frames_out += block->i_nb_samples;
+        }
+        if (block != NULL)
+            block_Release(block);
+    }
+
+    /* Drain, without measuring */
+    for (unsigned i = 0; i < chain->count; i++)
+    {
+        filter_t *filter = chain->stages[i].filter;
+
+        if (filter->ops->drain_audio == NULL)
+            continue;
+        block = filter->ops->drain_audio(filter);
+        for (unsigned j = i + 1; j < chain->count && block != NULL; j++)
+        {
+            filter = chain->stages[j].filter;
+            block = filter->ops->filter_audio(filter, block);
+        }
+        if (block != NULL)
+            block_Release(block);
+    }
+}
+
+struct result
+{
+    uint64_t ns;
+    unsigned long allocations;
+    unsigned long blocks;
+    uint64_t frames_in, frames_out;
+    unsigned rate_in, rate_out;
+    unsigned channels;
+};
+
+static void Print(const char *name, const char *format, const struct result *r)
+{
+    const double samples = (double)r->frames_in * r->channels;
+    /* frames held by the filter, before draining */
+    const double latency = 1000. * ((double)r->frames_in / r->rate_in
+                                    - (double)r->frames_out / r->rate_out);
+
+    printf("%-28s %-10s %10.2f ", name, format,
+           samples > 0. ? r->ns / samples : 0.);
+#ifdef HAVE_ALLOCATION_COUNT
+    printf("%12.2f ", r->blocks ? (double)r->allocations / r->blocks : 0.);
+#else
+    printf("%12s ", "n/a");
+#endif
+    printf("%12.2f\n", latency);
+}
+
+/* Runs the whole aout_FiltersNew() pipeline */
+static int RunPipeline(vlc_object_t *parent, const char *filters,
+                       struct source *src, size_t frames,
+                       const audio_sample_format_t *outfmt,
+                       struct result *r)
+{
+    vlc_object_t *obj = vlc_object_create(parent, sizeof (*obj));
+    if (unlikely(obj == NULL))
+        return VLC_ENOMEM;
+
+    var_Create(obj, "audio-filter", VLC_VAR_STRING);
+    var_SetString(obj, "audio-filter", filters != NULL ? filters : "");
+
+    aout_filters_t *pipeline = aout_FiltersNew(obj, &src->fmt, outfmt, NULL);
+    if (pipeline == NULL)
+    {
+        vlc_object_delete(obj);
+        return VLC_EGENERIC;
+    }
+
+    block_t *block;
+    while ((block = Generate(src, frames)) != NULL)
+    {
+        r->frames_in += block->i_nb_samples;
+        r->blocks++;
+
+        allocations = 0;
+        counting = true;
+        uint64_t start = Now();
+        block = aout_FiltersPlay(pipeline, block, 1.f);
+        r->ns += Now() - start;
+        counting = false;
+        r->allocations += allocations;
+
+        if (block != NULL)
+        {
+            r->frames_out += block->i_nb_samples;
+            block_Release(block);
+        }
+    }
+
+    block = aout_FiltersDrain(pipeline);
+    if (block != NULL)
+        block_ChainRelease(block);
+    aout_FiltersDelete(obj, pipeline);
+    vlc_object_delete(obj);
+    return VLC_SUCCESS;
+}
+
+static int ParseFormat(const char *str, vlc_fourcc_t *format)
+{
+    vlc_fourcc_t fourcc = vlc_fourcc_GetCodecFromString(AUDIO_ES, str);
+
+    switch (fourcc)
+    {
+        case VLC_CODEC_U8:
+        case VLC_CODEC_S16N:
+        case VLC_CODEC_S32N:
+        case VLC_CODEC_FL32:
+        case VLC_CODEC_FL64:
+            *format = fourcc;
+            return 0;
+    }
+    fprintf(stderr, "unsupported sample format \"%s\"\n", str);
+    return -1;
+}
+
+static void Usage(const char *name)
+{
+    printf("Usage: %s [options] [-- VLC options]\n"
+        "Measures each filter of an audio filter chain, then the whole\n"
+        "audio output filter pipeline.\n\n"
+        "  -a, --audio-filter=LIST  audio filters, as --audio-filter\n"
+        "  -r, --rate=RATE          sample rate (default 48000)\n"
+        "  -c, --channels=COUNT     channels, 1 to %d (default 2)\n"
+        "  -f, --format=FOURCC      sample format: u8, s16l, s32l, f32l or\n"
+        "                           f64l (default f32l)\n"
+        "  -o, --output=FOURCC      output sample format (default: input)\n"
+        "  -s, --signal=NAME        sine, noise, sweep or silence\n"
+        "                           (default sine)\n"
+        "  -b, --block=FRAMES       frames per block (default 1024)\n"
+        "  -d, --duration=SECONDS   signal duration (default 10)\n"
+        "  -h, --help               show this help\n\n"
+        "The time is given per input sample, the latency is the signal held\n"
+        "by the filter before draining. Filter options are given as VLC\n"
+        "options, e.g. -- --equalizer-preset=rock. Time stretching is\n"
+        "measured unless --no-audio-time-stretch is given.\n",
+        name, (int)ARRAY_SIZE(vlc_chan_maps) - 1);
+}
+
+int main(int argc, char *argv[])
+{
+    static const struct option opts[] =
+    {
+        { "audio-filter", required_argument, NULL, 'a' },
+        { "rate",         required_argument, NULL, 'r' },
+        { "channels",     required_argument, NULL, 'c' },
+        { "format",       required_argument, NULL, 'f' },
+        { "output",       required_argument, NULL, 'o' },
+        { "signal",       required_argument, NULL, 's' },
+        { "block",        required_argument, NULL, 'b' },
+        { "duration",     required_argument, NULL, 'd' },
+        { "help",         no_argument,       NULL, 'h' },
+        { NULL,           0,                 NULL, 0   },
+    };
+    const char *filters = NULL;
+    unsigned rate = 48000, channels = 2;
+    vlc_fourcc_t format = VLC_CODEC_FL32, output = 0;
+    enum signal sig = SIGNAL_SINE;
+    unsigned long block_frames = 1024;
+    double duration = 10.;
+    int c;
+
+    while ((c = getopt_long(argc, argv, "+a:r:c:f:o:s:b:d:h", opts,
+                            NULL)) != -1)
+    {
+        switch (c)
+        {
+            case 'a':
+                filters = optarg;
+                break;
+            case 'r':
+                rate = strtoul(optarg, NULL, 10);
+                break;
+            case 'c':
+                channels = strtoul(optarg, NULL, 10);
+                break;
+            case 'f':
+                if (ParseFormat(optarg, &format))
+                    return 1;
+                break;
+            case 'o':
+                if (ParseFormat(optarg, &output))
+                    return 1;
+                break;
+            case 's':
+                for (sig = 0; sig < ARRAY_SIZE(signal_names); sig++)
+                    if (!strcmp(optarg, signal_names[sig]))
+                        break;
+                if (sig == ARRAY_SIZE(signal_names))
+                {
+                    fprintf(stderr, "unknown signal \"%s\"\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'b':
+                block_frames = strtoul(optarg, NULL, 10);
+                break;
+            case 'd':
+                duration = strtod(optarg, NULL);
+                break;
+            case 'h':
+                Usage(argv[0]);
+                return 0;
+            default:
+                Usage(argv[0]);
+                return 1;
+        }
+    }
+
+    if (rate == 0 || channels == 0 || channels >= ARRAY_SIZE(vlc_chan_maps)
+     || block_frames == 0 || !(duration > 0.))
+    {
+        Usage(argv[0]);
+        return 1;
+    }
+
+    struct source src = {
+        .signal = sig,
+        .frames = llround(duration * rate),
+        .seed = 1,
+    };
+    src.fmt.i_format = format;
+    src.fmt.i_rate = rate;
+    src.fmt.i_physical_channels = vlc_chan_maps[channels];
+    src.fmt.channel_type = AUDIO_CHANNEL_TYPE_BITMAP;
+    aout_FormatPrepare(&src.fmt);
+    src.scratch = vlc_alloc(block_frames * channels, sizeof (float));
+    if (src.scratch == NULL)
+        return 1;
+
+    audio_sample_format_t outfmt = src.fmt;
+    if (output != 0)
+    {
+        outfmt.i_format = output;
+        aout_FormatPrepare(&outfmt);
+    }
+
+    /* VLC options follow "--" */
+    const char **args = vlc_alloc(argc - optind + 1, sizeof (*args));
+    if (args == NULL)
+        return 1;
+    args[0] = "--ignore-config";
+    for (int i = optind; i < argc; i++)
+        args[i - optind + 1] = argv[i];
+
+    setenv("VLC_PLUGIN_PATH", "../modules", 0);
+    libvlc_instance_t *vlc = libvlc_new(argc - optind + 1, args);
+    if (vlc == NULL)
+    {
+        fprintf(stderr, "cannot create a LibVLC instance\n");
+        return 1;
+    }
+    vlc_object_t *obj = VLC_OBJECT(vlc->p_libvlc_int);
+
+    struct chain chain;
+    int ret = 1;
+    if (CreateChain(&chain, obj, filters, &src.fmt, &outfmt))
+        goto out;
+
+    printf("%4.4s, %u Hz, %u channels, %s, %lu frames per block, %.1f s\n\n",
+           (const char *)&format, rate, channels, signal_names[sig],
+           block_frames, duration);
+    printf("%-28s %-10s %10s %12s %12s\n", "filter", "format", "ns/sample",
+           "allocs/block", "latency (ms)");
+
+    RunChain(&chain, &src, block_frames);
+    for (unsigned i = 0; i < chain.count; i++)
+    {
+        const struct stage *stage = &chain.stages[i];
+        const filter_t *filter = stage->filter;
+        const struct result r = {
+            .ns = stage->ns,
+            .allocations = stage->allocations,
+            .blocks = stage->blocks,
+            .frames_in = stage->frames_in,
+            .frames_out = stage->frames_out,
+            .rate_in = filter->fmt_in.audio.i_rate,
+            .rate_out = filter->fmt_out.audio.i_rate,
+            .channels = filter->fmt_in.audio.i_channels,
+        };
+        char fmt[10];
+
+        snprintf(fmt, sizeof (fmt), "%4.4s>%4.4s",
+                 (const char *)&filter->fmt_in.audio.i_format,
+                 (const char *)&filter->fmt_out.audio.i_format);
+        Print(stage->name, fmt, &r);
+    }
+    DeleteChain(&chain);
+
+    struct result total = {
+        .rate_in = src.fmt.i_rate,
+        .rate_out = outfmt.i_rate,
+        .channels = src.fmt.i_channels,
+    };
+    src.pos = 0;
+    src.seed = 1;
+    if (RunPipeline(obj, filters, &src, block_frames, &outfmt, &total))
+    {
+        fprintf(stderr, "cannot create the audio filter pipeline\n");
+        goto out;
+    }
+    Print("aout_FiltersNew() pipeline", "", &total);
+    ret = 0;
+out:
+    libvlc_release(vlc);
+    free(args);
+    free(src.scratch);
+    return ret;
+}